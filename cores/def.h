@@ -53,6 +53,14 @@
 
 #define SYSTEM_COMMAND_REGISTER 0xFFFF
 #define SYSTEM_COMMAND_INSPECT  0xFFFE
+#define SYSTEM_COMMAND_PIPELINE 0xFFFD
+#define SYSTEM_COMMAND_SHM      0xFFFC
+#define SYSTEM_COMMAND_SUBSCRIBE    0xFFFB
+#define SYSTEM_COMMAND_UNSUBSCRIBE  0xFFFA
+#define SYSTEM_COMMAND_EVENT        0xFFF9
+#define SYSTEM_COMMAND_PING         0xFFF8
+#define SYSTEM_COMMAND_DEADLINE     0xFFF7
+#define SYSTEM_COMMAND_CANCEL       0xFFF6
 
 #define PROTO_OPTION_MORE_PACKET 0x8000
 
@@ -101,6 +109,10 @@ enum {AAOS_OK, AAOS_EACCES, AAOS_EAGAIN, AAOS_EBADF, AAOS_EBADMSG, AAOS_EBUSY, A
 #define _RPC_PRIORITY_          102
 #endif
 
+#ifndef _LOG_RPC_PRIORITY_
+#define _LOG_RPC_PRIORITY_      103
+#endif
+
 #ifndef _SERIAL_PRIORITY_
 #define _SERIAL_PRIORITY_       101
 #endif
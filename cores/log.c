@@ -10,13 +10,43 @@
 #include "log.h"
 #include "log_r.h"
 #include "log_def.h"
+#include "rpc.h"
 #include "wrapper.h"
 
 #ifndef NUMBER_OF_LOG_LEVELS
 #define NUMBER_OF_LOG_LEVELS 8
 #endif
 
-static const char *__LOG_LEVELS[] = {"emerg", "aler", "crit", "err", "warn", "notice", "info", "debug"};
+#define LOG_LINE_SIZE (LOG_RECORD_MAX_LENGTH + TIMESTAMPSIZE + 16)
+
+static const char *__LOG_LEVELS[] = {"emerg", "alert", "crit", "err", "warn", "notice", "info", "debug"};
+
+static double
+__log_monotonic(void)
+{
+    struct timespec tp;
+    
+    Clock_gettime(CLOCK_MONOTONIC, &tp);
+    
+    return tp.tv_sec + tp.tv_nsec / 1000000000.;
+}
+
+/*
+ * Name of the most severe level of a record.
+ */
+static const char *
+__log_level_name(unsigned int level)
+{
+    size_t i;
+    
+    for (i = 0; i < NUMBER_OF_LOG_LEVELS; i++) {
+        if (level & (LOG_LEVEL_EMERG >> i)) {
+            return __LOG_LEVELS[i];
+        }
+    }
+    
+    return __LOG_LEVELS[NUMBER_OF_LOG_LEVELS - 1];
+}
 
 const char *
 __log_get_facility(void *_self)
@@ -41,6 +71,61 @@ __Log_get_facility(void *_self)
     return (const char *) self->facility;
 }
 
+/*
+ * Writes the buffer out in one system call, and pushes the lines to the subscribers as one event,
+ * so that a tail keeps up with a burst. Called with the mutex held.
+ */
+static int
+__Log_flush_nl(struct __Log *self)
+{
+    char topic[PATHSIZE];
+    ssize_t n;
+    int ret = AAOS_OK;
+    
+    if (self->length != 0) {
+        if ((n = Writen(self->fd, self->buf, self->length)) < 0) {
+            ret = AAOS_ERROR;
+        } else {
+            self->size += (size_t) n;
+        }
+        if (rpc_has_subscriber()) {
+            snprintf(topic, PATHSIZE, "log/%s", self->facility);
+            rpc_publish(topic, self->buf, self->length);
+        }
+        self->length = 0;
+    }
+    
+    return ret;
+}
+
+static int
+__Log_rotate_nl(struct __Log *self)
+{
+    char from[PATHSIZE], to[PATHSIZE];
+    int i, fd;
+    
+    __Log_flush_nl(self);
+    if (self->max_files > 0) {
+        for (i = self->max_files - 1; i > 0; i--) {
+            snprintf(from, PATHSIZE, "%s.%d", self->path, i);
+            snprintf(to, PATHSIZE, "%s.%d", self->path, i + 1);
+            rename(from, to);
+        }
+        snprintf(to, PATHSIZE, "%s.1", self->path);
+        rename(self->path, to);
+    } else {
+        unlink(self->path);
+    }
+    if ((fd = Open(self->path, O_RDWR | O_CREAT | O_APPEND, FMODE)) < 0) {
+        return AAOS_ERROR;
+    }
+    Close(self->fd);
+    self->fd = fd;
+    self->size = 0;
+    
+    return AAOS_OK;
+}
+
 int
 __log_write(void *_self, unsigned int level, const char *message)
 {
@@ -59,60 +144,151 @@ __log_write(void *_self, unsigned int level, const char *message)
 static int
 __Log_write(void *_self, unsigned int level, const char *message)
 {
-    struct __Log *self = cast(__Log(), _self);
     struct timespec tp;
-    struct tm t;
-    char log_buf[LOG_RECORD_MAX_LENGTH + TIMESTAMPSIZE], time_buf[TIMESTAMPSIZE];
-    ssize_t n;
     
-    clock_gettime(CLOCK_REALTIME, &tp);
-    gmtime_r(&tp.tv_sec, &t);
-    strftime(time_buf, TIMESTAMPSIZE, "%Y-%m-%dT%H:%M:%S", &t);
-    snprintf(log_buf, LOG_RECORD_MAX_LENGTH + TIMESTAMPSIZE, "[%s.%d]: %s\n", time_buf, (int) (tp.tv_nsec/1000), message);
+    Clock_gettime(CLOCK_REALTIME, &tp);
     
-    if (level&LOG_LEVEL_DEBUG) {
-        n = Write(self->fds[7], log_buf, strlen(log_buf));
+    return __log_write_record(_self, tp.tv_sec + tp.tv_nsec / 1000000000., level, message);
+}
+
+int
+__log_write_record(void *_self, double timestamp, unsigned int level, const char *message)
+{
+    const struct __LogClass *class = (const struct __LogClass *) classOf(_self);
+    
+    if (isOf(class, __LogClass()) && class->write_record.method) {
+        return ((int (*)(void *, double, unsigned int, const char *)) class->write_record.method)(_self, timestamp, level, message);
+        
+    } else {
+        int result;
+        forward(_self, &result, (Method) __log_write_record, "write_record", _self, timestamp, level, message);
+        return result;
+    }
+}
+
+/*
+ * One line per record, `[2026-10-19T12:00:00.123456] err: message`, whatever its levels are.
+ */
+static int
+__Log_write_record(void *_self, double timestamp, unsigned int level, const char *message)
+{
+    struct __Log *self = cast(__Log(), _self);
+    
+    struct tm t;
+    time_t sec;
+    char line[LOG_LINE_SIZE], time_buf[TIMESTAMPSIZE];
+    size_t length;
+    double now;
+    int ret = AAOS_OK;
+    
+    if (!(level & self->level)) {
+        return AAOS_OK;
     }
-    if (level&LOG_LEVEL_INFO) {
-        n = Write(self->fds[6], log_buf, strlen(log_buf));
+    
+    sec = (time_t) timestamp;
+    gmtime_r(&sec, &t);
+    strftime(time_buf, TIMESTAMPSIZE, "%Y-%m-%dT%H:%M:%S", &t);
+    snprintf(line, LOG_LINE_SIZE, "[%s.%06d] %s: %.*s", time_buf, (int) ((timestamp - sec) * 1000000), __log_level_name(level), LOG_RECORD_MAX_LENGTH, message);
+    length = strlen(line);
+    if (length > 0 && line[length - 1] == '\n') {
+        length--;
     }
-    if (level&LOG_LEVEL_NOTICE) {
-        n = Write(self->fds[5], log_buf, strlen(log_buf));
+    line[length++] = '\n';
+    
+    now = __log_monotonic();
+    Pthread_mutex_lock(&self->mtx);
+    if (self->length + length > self->buffer_size) {
+        ret = __Log_flush_nl(self);
     }
-    if (level&LOG_LEVEL_WARNING) {
-        n = Write(self->fds[4], log_buf, strlen(log_buf));
+    if (self->length == 0) {
+        self->first = now;
     }
-    if (level&LOG_LEVEL_ERR) {
-        n = Write(self->fds[3], log_buf, strlen(log_buf));
+    memcpy(self->buf + self->length, line, length);
+    self->length += length;
+    if ((level & LOG_LEVEL_URGENT) || now - self->first >= self->flush_interval) {
+        ret = __Log_flush_nl(self);
     }
-    if (level&LOG_LEVEL_CRIT) {
-        n = Write(self->fds[2], log_buf, strlen(log_buf));
+    if (self->max_size != 0 && self->size >= self->max_size) {
+        __Log_rotate_nl(self);
     }
-    if (level&LOG_LEVEL_ALERT) {
-        n = Write(self->fds[1], log_buf, strlen(log_buf));
+    Pthread_mutex_unlock(&self->mtx);
+    
+    return ret;
+}
+
+int
+__log_flush(void *_self)
+{
+    const struct __LogClass *class = (const struct __LogClass *) classOf(_self);
+    
+    if (isOf(class, __LogClass()) && class->flush.method) {
+        return ((int (*)(void *)) class->flush.method)(_self);
+        
+    } else {
+        int result;
+        forward(_self, &result, (Method) __log_flush, "flush", _self);
+        return result;
     }
-    if (level&LOG_LEVEL_EMERG) {
-        n = Write(self->fds[0], log_buf, strlen(log_buf));
+}
+
+static int
+__Log_flush(void *_self)
+{
+    struct __Log *self = cast(__Log(), _self);
+    
+    int ret;
+    
+    Pthread_mutex_lock(&self->mtx);
+    ret = __Log_flush_nl(self);
+    if (self->max_size != 0 && self->size >= self->max_size) {
+        __Log_rotate_nl(self);
     }
+    Pthread_mutex_unlock(&self->mtx);
     
-    return AAOS_OK;
+    return ret;
+}
+
+int
+__log_rotate(void *_self)
+{
+    const struct __LogClass *class = (const struct __LogClass *) classOf(_self);
+    
+    if (isOf(class, __LogClass()) && class->rotate.method) {
+        return ((int (*)(void *)) class->rotate.method)(_self);
+        
+    } else {
+        int result;
+        forward(_self, &result, (Method) __log_rotate, "rotate", _self);
+        return result;
+    }
 }
 
 static int
 __Log_rotate(void *_self)
 {
-    return AAOS_OK;
+    struct __Log *self = cast(__Log(), _self);
+    
+    int ret;
+    
+    Pthread_mutex_lock(&self->mtx);
+    ret = __Log_rotate_nl(self);
+    Pthread_mutex_unlock(&self->mtx);
+    
+    return ret;
 }
 
+/*
+ * new(__Log(), facility, work_directory, key, value, ..., '\0'), with the keys
+ * "level" (unsigned int), "buffer_size" (size_t), "flush_interval" (double), "max_size" (size_t) and "max_files" (int).
+ */
 static void *
 __Log_ctor(void *_self, va_list *app)
 {
     struct __Log *self = super_ctor(__Log(), _self, app);
     
-    size_t i;
     char path[PATHSIZE];
-    
-    const char *s;
+    struct stat st;
+    const char *s, *key;
     
     s = va_arg(*app, const char *);
     if (s) {
@@ -126,11 +302,56 @@ __Log_ctor(void *_self, va_list *app)
         snprintf(self->work_directory, strlen(s) + 1, "%s", s);
     }
     
-    for (i = 0; i < NUMBER_OF_LOG_LEVELS; i++) {
-        snprintf(path, PATHSIZE, "%s/%s.%s.log", self->work_directory, self->facility, __LOG_LEVELS[i]);
-        self->fds[i] = Open(path, O_RDWR | O_CREAT | O_APPEND, FMODE);
+    self->level = LOG_LEVEL_ALL;
+    self->buffer_size = LOG_BUFFER_SIZE;
+    self->flush_interval = LOG_FLUSH_INTERVAL;
+    self->max_size = LOG_MAX_SIZE;
+    self->max_files = LOG_MAX_FILES;
+    while ((key = va_arg(*app, const char *))) {
+        if (strcmp(key, "level") == 0) {
+            self->level = va_arg(*app, unsigned int);
+            continue;
+        }
+        if (strcmp(key, "buffer_size") == 0) {
+            self->buffer_size = va_arg(*app, size_t);
+            continue;
+        }
+        if (strcmp(key, "flush_interval") == 0) {
+            self->flush_interval = va_arg(*app, double);
+            continue;
+        }
+        if (strcmp(key, "max_size") == 0) {
+            self->max_size = va_arg(*app, size_t);
+            continue;
+        }
+        if (strcmp(key, "max_files") == 0) {
+            self->max_files = va_arg(*app, int);
+            continue;
+        }
+    }
+    if (self->buffer_size < LOG_LINE_SIZE) {
+        self->buffer_size = LOG_LINE_SIZE;
     }
     
+    snprintf(path, PATHSIZE, "%s/%s.log", self->work_directory != NULL ? self->work_directory : ".", self->facility != NULL ? self->facility : "aaos");
+    self->path = (char *) Malloc(strlen(path) + 1);
+    snprintf(self->path, strlen(path) + 1, "%s", path);
+    self->buf = (char *) Malloc(self->buffer_size);
+    if ((self->fd = Open(self->path, O_RDWR | O_CREAT | O_APPEND, FMODE)) < 0 || self->buf == NULL) {
+        if (self->fd >= 0) {
+            Close(self->fd);
+        }
+        free(self->buf);
+        free(self->path);
+        free(self->facility);
+        free(self->work_directory);
+        return NULL;
+    }
+    if (fstat(self->fd, &st) == 0) {
+        self->size = (size_t) st.st_size;
+    }
+    Pthread_mutex_init(&self->mtx, NULL);
+    
     return (void *) self;
 }
 
@@ -139,15 +360,15 @@ __Log_dtor(void *_self)
 {
     struct __Log *self = cast(__Log(), _self);
     
-    size_t i;
+    __Log_flush_nl(self);
+    Close(self->fd);
+    Pthread_mutex_destroy(&self->mtx);
     
+    free(self->buf);
+    free(self->path);
     free(self->facility);
     free(self->work_directory);
     
-    for (i = 0; i < 8; i++) {
-        Close(self->fds[i]);
-    }
-    
     return super_dtor(__Log(), _self);
 }
 
@@ -175,6 +396,14 @@ __LogClass_ctor(void *_self, va_list *app)
             self->write.method = method;
             continue;
         }
+        if (selector == (Method) __log_write_record) {
+            if (tag) {
+                self->write_record.tag = tag;
+                self->write_record.selector = selector;
+            }
+            self->write_record.method = method;
+            continue;
+        }
         if (selector == (Method) __log_get_facility) {
             if (tag) {
                 self->get_facility.tag = tag;
@@ -183,6 +412,22 @@ __LogClass_ctor(void *_self, va_list *app)
             self->get_facility.method = method;
             continue;
         }
+        if (selector == (Method) __log_flush) {
+            if (tag) {
+                self->flush.tag = tag;
+                self->flush.selector = selector;
+            }
+            self->flush.method = method;
+            continue;
+        }
+        if (selector == (Method) __log_rotate) {
+            if (tag) {
+                self->rotate.tag = tag;
+                self->rotate.selector = selector;
+            }
+            self->rotate.method = method;
+            continue;
+        }
     }
     
 #ifdef va_copy
@@ -236,8 +481,11 @@ __Log_initialize(void)
     ___Log = new(__LogClass(), "__Log", Object(), sizeof(struct __Log),
                  ctor, "ctor", __Log_ctor,
                  dtor, "dtor", __Log_dtor,
-                 __log_write, "read", __Log_write,
+                 __log_write, "write", __Log_write,
+                 __log_write_record, "write_record", __Log_write_record,
                  __log_get_facility, "get_facility", __Log_get_facility,
+                 __log_flush, "flush", __Log_flush,
+                 __log_rotate, "rotate", __Log_rotate,
                  (void *) 0);
 #ifndef _USE_COMPILER_ATTRIBUTION_
     atexit(__Log_destroy);
@@ -13,8 +13,17 @@
 extern "C" {
 #endif
 
+/*
+ * A log writes the records of a facility to <work_directory>/<facility>.log through a buffer,
+ * see log_def.h, and pushes the lines it writes out to the subscribers of "log/<facility>".
+ * __log_write stamps the record with the current time, __log_write_record keeps the time given by the sender.
+ */
+
 const char *__log_get_facility(void *_self);
 int __log_write(void *_self, unsigned int level, const char *message);
+int __log_write_record(void *_self, double timestamp, unsigned int level, const char *message);
+int __log_flush(void *_self);
+int __log_rotate(void *_self);
 
 extern const void *__Log(void);
 extern const void *__LogClass(void);
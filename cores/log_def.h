@@ -9,6 +9,8 @@
 #ifndef log_def_h
 #define log_def_h
 
+#include <stdint.h>
+
 #define LOG_RECORD_MAX_LENGTH 1024
 
 #define LOG_LEVEL_DEFAULT   4
@@ -21,4 +23,30 @@
 #define LOG_LEVEL_ALERT     64
 #define LOG_LEVEL_EMERG     128
 
+#define LOG_LEVEL_ALL       0xFF
+#define LOG_LEVEL_URGENT    (LOG_LEVEL_ERR | LOG_LEVEL_CRIT | LOG_LEVEL_ALERT | LOG_LEVEL_EMERG)
+
+/*
+ * Records are buffered, and written out when the buffer is full, when an urgent record comes,
+ * or when the oldest record buffered is flush_interval seconds old.
+ * A file is rotated once it reaches max_size bytes, keeping max_files old files, <facility>.log.1 the newest.
+ */
+#define LOG_BUFFER_SIZE     65536
+#define LOG_FLUSH_INTERVAL  1.
+#define LOG_MAX_SIZE        67108864
+#define LOG_MAX_FILES       8
+
+/*
+ * A record on the wire, followed by length bytes of message including the terminating '\0',
+ * and padded to LOG_RECORD_ALIGN bytes. A LOG_COMMAND_SUBMIT packet carries a batch of records.
+ */
+struct LogRecord {
+    double timestamp;   /* CLOCK_REALTIME, in seconds */
+    uint32_t level;
+    uint32_t length;
+};
+
+#define LOG_RECORD_ALIGN    8
+#define LOG_RECORD_SIZE(length) ((sizeof(struct LogRecord) + (length) + LOG_RECORD_ALIGN - 1) & ~((size_t) LOG_RECORD_ALIGN - 1))
+
 #endif /* log_def_h */
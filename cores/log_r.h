@@ -14,22 +14,33 @@
 
 #include "rpc_r.h"
 
-#define _LOG_RPC_PRIORITY_ _RPC_PRIORITY_ + 1
-
-#define MAX_LEVEL_LENGTH    16
+#include <stdbool.h>
 
 struct __Log {
     const struct Object _;
     pthread_mutex_t mtx;
-    int fds[MAX_LEVEL_LENGTH];
+    int fd;
     char *facility;
     char *work_directory;
+    char *path;
+    unsigned int level;     /* levels written */
+    char *buf;
+    size_t buffer_size;
+    size_t length;          /* bytes buffered */
+    double first;           /* when the oldest record buffered came, CLOCK_MONOTONIC */
+    double flush_interval;
+    size_t size;            /* of the file */
+    size_t max_size;
+    int max_files;
 };
 
 struct __LogClass {
     const struct Class _;
     struct Method write;
+    struct Method write_record;
     struct Method get_facility;
+    struct Method flush;
+    struct Method rotate;
 };
 
 #endif /* log_r_h */
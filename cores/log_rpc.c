@@ -7,6 +7,7 @@
 
 #include "def.h"
 #include "log.h"
+#include "log_def.h"
 #include "log_rpc.h"
 #include "log_rpc_r.h"
 #include "rpc.h"
@@ -14,30 +15,25 @@
 #include "protocol.h"
 #include "wrapper.h"
 
-#define LOG_CONNECT_TIMEOUT 1.0
+#define LOG_CALL_TIMEOUT 1.0
 
 void **logs;
 size_t n_log;
-pthread_t *log_tids;
-size_t n_log_thread;
 
-
-static void *
-get_log_by_facility(const char *facility)
+static int
+get_index_by_facility(const char *facility, int *index)
 {
     size_t i;
-    const char *s = NULL;
+    const char *s;
    
     for (i = 0; i < n_log; i++) {
-        if (logs[i] != NULL) {
-            s = __log_get_facility(logs[i]);
-        }
-        if (facility != NULL && s != NULL && strcmp(facility, s) == 0) {
-            return  logs[i];
+        if (logs[i] != NULL && (s = __log_get_facility(logs[i])) != NULL && strcmp(facility, s) == 0) {
+            *index = (int) i + 1;
+            return AAOS_OK;
         }
     }
     
-    return logs[0];
+    return AAOS_ENOTFOUND;
 }
 
 static void *
@@ -50,12 +46,22 @@ get_log_by_index(int index)
     }
 }
 
+static double
+log_monotonic(void)
+{
+    struct timespec tp;
+    
+    Clock_gettime(CLOCK_MONOTONIC, &tp);
+    
+    return tp.tv_sec + tp.tv_nsec / 1000000000.;
+}
+
 inline static int
 Log_protocol_check(void *_self)
 {
     uint16_t protocol;
     protobuf_get(_self, PACKET_PROTOCOL, &protocol);
-    if (protocol != PROTO_LOG && protocol != PROTO_SYSTEM) {
+    if (protocol != PROTO_LOG) {
         protobuf_set(_self, PACKET_ERRORCODE, AAOS_EPROTOWRONG);
         protobuf_set(_self, PACKET_LENGTH, 0);
         return AAOS_EPROTOWRONG;
@@ -69,7 +75,7 @@ log_get_index_by_facility(void *_self, const char *facility)
 {
     const struct LogClass *class = (const struct LogClass *) classOf(_self);
         
-    if (isOf(class, SerialClass()) && class->get_index_by_facility.method) {
+    if (isOf(class, LogClass()) && class->get_index_by_facility.method) {
         return ((int (*)(void *, const char *)) class->get_index_by_facility.method)(_self, facility);
     } else {
         int result;
@@ -78,12 +84,18 @@ log_get_index_by_facility(void *_self, const char *facility)
     } 
 }
 
+/*
+ * The index is kept by the connection, and every following batch goes to the facility.
+ */
 static int
 Log_get_index_by_facility(void *_self, const char *facility)
 {
-    struct Log *self = cast(Serial(), _self);
+    struct Log *self = cast(Log(), _self);
+    
     size_t length;
+    int ret;
     
+    Pthread_mutex_lock(&self->mtx);
     protobuf_set(self, PACKET_PROTOCOL, PROTO_LOG);
     protobuf_set(self, PACKET_COMMAND, LOG_COMMAND_GET_INDEX_BY_FACILITY);
     protobuf_set(self, PACKET_INDEX, 0);
@@ -106,56 +118,146 @@ Log_get_index_by_facility(void *_self, const char *facility)
         protobuf_set(self, PACKET_LENGTH, len + 1);
     }
     
-    return rpc_call(self);
+    if ((ret = rpc_call(self)) == AAOS_OK) {
+        protobuf_get(self, PACKET_INDEX, &self->index);
+    }
+    Pthread_mutex_unlock(&self->mtx);
+    
+    return ret;
+}
+
+/*
+ * Sends the records queued as one batch, called with the mutex held.
+ */
+static int
+Log_flush_nl(struct Log *self)
+{
+    int ret;
+    
+    if (self->n_record == 0) {
+        return AAOS_OK;
+    }
+    
+    protobuf_set(self, PACKET_PROTOCOL, PROTO_LOG);
+    protobuf_set(self, PACKET_COMMAND, LOG_COMMAND_SUBMIT);
+    protobuf_set(self, PACKET_INDEX, self->index);
+    protobuf_set(self, PACKET_U32F0, self->n_record);
+    protobuf_set(self, PACKET_BUF, self->queue, self->length);
+    
+    ret = rpc_call(self);
+    self->length = 0;
+    self->n_record = 0;
+    
+    return ret;
+}
+
+int
+log_submit(void *_self, unsigned int level, const char *message)
+{
+    const struct LogClass *class = (const struct LogClass *) classOf(_self);
+    
+    if (isOf(class, LogClass()) && class->submit.method) {
+        return ((int (*)(void *, unsigned int, const char *)) class->submit.method)(_self, level, message);
+    } else {
+        int result;
+        forward(_self, &result, (Method) log_submit, "submit", _self, level, message);
+        return result;
+    }
+}
+
+static int
+Log_submit(void *_self, unsigned int level, const char *message)
+{
+    struct Log *self = cast(Log(), _self);
+    
+    struct LogRecord record;
+    struct timespec tp;
+    size_t length, size;
+    double now;
+    int ret = AAOS_OK;
+    
+    length = strnlen(message, LOG_RECORD_MAX_LENGTH);
+    size = LOG_RECORD_SIZE(length + 1);
+    Clock_gettime(CLOCK_REALTIME, &tp);
+    record.timestamp = tp.tv_sec + tp.tv_nsec / 1000000000.;
+    record.level = level;
+    record.length = (uint32_t) length + 1;
+    now = log_monotonic();
+    
+    Pthread_mutex_lock(&self->mtx);
+    if (self->queue == NULL) {
+        if ((self->queue = (char *) Malloc(LOG_BUFFER_SIZE)) == NULL) {
+            Pthread_mutex_unlock(&self->mtx);
+            return AAOS_ENOMEM;
+        }
+        self->size = LOG_BUFFER_SIZE;
+    }
+    if (self->length + size > self->size) {
+        ret = Log_flush_nl(self);
+    }
+    if (self->n_record == 0) {
+        self->first = now;
+    }
+    memset(self->queue + self->length, '\0', size);
+    memcpy(self->queue + self->length, &record, sizeof(record));
+    memcpy(self->queue + self->length + sizeof(record), message, length);
+    self->length += size;
+    self->n_record++;
+    if ((level & LOG_LEVEL_URGENT) || now - self->first >= LOG_FLUSH_INTERVAL) {
+        ret = Log_flush_nl(self);
+    }
+    Pthread_mutex_unlock(&self->mtx);
+    
+    return ret;
 }
 
 int
-log_submit(void *_self, const char *msg)
+log_flush(void *_self)
 {
     const struct LogClass *class = (const struct LogClass *) classOf(_self);
     
-    if (isOf(class, LogClass()) && class->sumit.method) {
-        return ((int (*)(void *, const char *)) class->info.method)(_self, msg);
+    if (isOf(class, LogClass()) && class->flush.method) {
+        return ((int (*)(void *)) class->flush.method)(_self);
     } else {
         int result;
-        forward(_self, &result, (Method) log_submit, "submit", _self, msg);
+        forward(_self, &result, (Method) log_flush, "flush", _self);
         return result;
     }
 }
 
 static int
-Log_submit(void *_self, const char *msg)
+Log_flush(void *_self)
 {
     struct Log *self = cast(Log(), _self);
     
-    void *protobuf = self->_.protobuf;
     int ret;
     
-    protobuf_set(protobuf, PACKET_PROTOCOL, PROTO_LOG);
-    protobuf_set(protobuf, PACKET_COMMAND, LOG_COMMAND_SUBMIT);
+    Pthread_mutex_lock(&self->mtx);
+    ret = Log_flush_nl(self);
+    Pthread_mutex_unlock(&self->mtx);
     
     return ret;
 }
 
 static int
-Log_execute_get_index_by_facility(void *_self)
+Log_execute_get_index_by_facility(struct Log *self)
 {
-    char *facilyt;
+    char *facility;
     int index, ret;
     uint16_t idx;
     uint32_t length;
 
     protobuf_get(self, PACKET_LENGTH, &length);
     /*
-     * if lenght == 0, use str field.
+     * if length == 0, use str field.
      */
     if (length == 0) {
         protobuf_get(self, PACKET_STR, &facility);
     } else {
-        protobuf_get(self, PACKET_BUF, &name, NULL);
+        protobuf_get(self, PACKET_BUF, &facility, NULL);
     }
     
-    if ((ret = get_index_by_name(facility, &index)) != AAOS_OK) {
+    if ((ret = get_index_by_facility(facility, &index)) != AAOS_OK) {
         return ret;
     } else {
         idx = (uint16_t) index;
@@ -166,30 +268,48 @@ Log_execute_get_index_by_facility(void *_self)
     return AAOS_OK;
 }
 
+/*
+ * The records of a batch are buffered by the log of the facility, and written out together.
+ */
 static int
-Log_execute_submit(void *_self)
+Log_execute_submit(struct Log *self)
 {
-    struct Log *self = cast(Log(), _self);
-
     void *log_; 
-    uint16_t idx, level;
-    char *msg;
+    struct LogRecord record;
+    uint16_t idx;
+    uint32_t n_record, i;
+    char *buf;
+    size_t size, offset;
     int ret = AAOS_OK;
 
     protobuf_get(self, PACKET_INDEX, &idx);
-    protobuf_get(self, PACKET_CHANNEL, &level);
-    protobuf_get(self, PACKET_BUF, &msg, NULL);
+    protobuf_get(self, PACKET_U32F0, &n_record);
+    protobuf_get(self, PACKET_BUF, &buf, &size);
+    protobuf_set(self, PACKET_LENGTH, 0);
 
-    log_ = get_log_by_index(idx);
+    if ((log_ = get_log_by_index(idx)) == NULL) {
+        return AAOS_ENOTFOUND;
+    }
 
-    if (log_ != NULL) {
-        __log_write(log_, level, msg);
+    for (i = 0, offset = 0; i < n_record; i++) {
+        if (offset + sizeof(record) > size) {
+            return AAOS_EBADMSG;
+        }
+        memcpy(&record, buf + offset, sizeof(record));
+        if (record.length == 0 || record.length > size - offset - sizeof(record) || buf[offset + sizeof(record) + record.length - 1] != '\0') {
+            return AAOS_EBADMSG;
+        }
+        if ((ret = __log_write_record(log_, record.timestamp, record.level, buf + offset + sizeof(record))) != AAOS_OK) {
+            break;
+        }
+        offset += LOG_RECORD_SIZE(record.length);
     }
 
+    return ret;
 }
 
 static int
-Log_execute_default(void *_self)
+Log_execute_default(struct Log *self)
 {
     return AAOS_EBADCMD;
 }
@@ -209,7 +329,7 @@ Log_execute(void *_self)
         case LOG_COMMAND_GET_INDEX_BY_FACILITY:
             return Log_execute_get_index_by_facility(self);
             break;
-        case SERIAL_COMMAND_SUBMIT:
+        case LOG_COMMAND_SUBMIT:
             return Log_execute_submit(self);
             break;
         default:
@@ -220,141 +340,356 @@ Log_execute(void *_self)
     return AAOS_OK;
 }
 
-static int
-Log_read(void *_self)
+static const void *log_virtual_table(void);
+
+static void *
+Log_ctor(void *_self, va_list *app)
 {
-    struct RPC *self = cast(RPC(), _self);
+    struct Log *self = super_ctor(Log(), _self, app);
     
-    void *protobuf = self->protobuf, *header, *buf;
-    int ret;
-    uint32_t length;
-    size_t payload;
-    uint16_t errorcode;
+    self->_._vtab = log_virtual_table();
+    Pthread_mutex_init(&self->mtx, NULL);
     
-    for (; ;) {
-        header = protobuf_header(protobuf);
-        if ((ret = tcp_socket_read_nb(self, header, PACKETHEADERSIZE, NULL)) != AAOS_OK) {
-            return -1 * ret;
-        }
-        protobuf_get(self, PACKET_LENGTH, &length);
-        if (length == 0) {
-            /*
-             * execute.
-             */
-            rpc_execute(self);
-            return ret;
+    return (void *) self;
+}
+
+static void *
+Log_dtor(void *_self)
+{
+    struct Log *self = cast(Log(), _self);
+    
+    Log_flush_nl(self);
+    Pthread_mutex_destroy(&self->mtx);
+    free(self->queue);
+
+    return super_dtor(Log(), _self);
+}
+
+static void *
+LogClass_ctor(void *_self, va_list *app)
+{
+    struct LogClass *self = super_ctor(LogClass(), _self, app);
+    Method selector;
+
+    self->_.execute.method = (Method) 0;
+    
+#ifdef va_copy
+    va_list ap;
+    va_copy(ap, *app);
+#else
+    va_list ap = *app;
+#endif
+    
+    while ((selector = va_arg(ap, Method))) {
+        const char *tag = va_arg(ap, const char *);
+        Method method = va_arg(ap, Method);
+        
+        if (selector == (Method) log_get_index_by_facility) {
+            if (tag) {
+                self->get_index_by_facility.tag = tag;
+                self->get_index_by_facility.selector = selector;
+            }
+            self->get_index_by_facility.method = method;
+            continue;
         }
-        payload = protobuf_payload(protobuf);
-        if (payload < length) {
-            if ((ret = protobuf_reallocate(self, (size_t) length)) != AAOS_OK) {
-                return ret;
+        if (selector == (Method) log_submit) {
+            if (tag) {
+                self->submit.tag = tag;
+                self->submit.selector = selector;
             }
+            self->submit.method = method;
+            continue;
         }
-        protobuf_get(protobuf, PACKET_BUF, &buf, NULL);
-        if ((ret = tcp_socket_read_nb(self, buf, (size_t) length, NULL)) != AAOS_OK) {
-            return -1 * ret;
+        if (selector == (Method) log_flush) {
+            if (tag) {
+                self->flush.tag = tag;
+                self->flush.selector = selector;
+            }
+            self->flush.method = method;
+            continue;
         }
-        rpc_execute(self);
-        protobuf_get(self, PACKET_ERRORCODE, &errorcode);
     }
-    
-    return errorcode;
+
+#ifdef va_copy
+    va_end(ap);
+#endif
+    return (void *) self;
 }
 
-static int
-Log_write(void *_self)
+static void *_LogClass;
+
+static void
+LogClass_destroy(void)
 {
-    struct RPC *self = cast(RPC(), _self);
+    free((void *) _LogClass);
+}
     
-    void *protobuf = self->protobuf, *header;
-    int ret;
-    uint32_t length;
+static void
+LogClass_initialize(void)
+{
+    _LogClass = new(RPCClass(), "LogClass", RPCClass(), sizeof(struct LogClass),
+                    ctor, "ctor", LogClass_ctor,
+                    (void *) 0);
 
-    header = protobuf_header(protobuf);
-    protobuf_get(self, PACKET_LENGTH, &length);
-    if ((ret = tcp_socket_write(self, header, (size_t) length + PACKETHEADERSIZE, NULL)) != AAOS_OK) {
-        return -1 * ret;
-    }
-    
-    return AAOS_OK;
+#ifndef _USE_COMPILER_ATTRIBUTION_
+    atexit(LogClass_destroy);
+#endif
 }
 
-static int
-Log_process(void *_self)
+const void *
+LogClass(void)
 {
-    int ret;
-    uint16_t command, error_code;
-
-    while ((ret = rpc_read(_self) != AAOS_OK)) {
-        ret = rpc_execute(_self);
-        protobuf_get(_self, PACKET_COMMAND, &command);
-        if (command != LOG_COMMAND_SUBMIT) {
-            error_code = (uint16_t) ret;
-            protobuf_set(_self, PACKET_ERRODCODE, error_code);
-            rpc_write(_self);        
-        }
-    }
+#ifndef _USE_COMPILER_ATTRIBUTION_
+    static pthread_once_t once = PTHREAD_ONCE_INIT;
+    pthread_once(&once, LogClass_initialize);
+#endif
 
-    return ret;
+    return _LogClass;
 }
 
-static int
-Log_call(void *_self)
+static void *_Log;
+
+static void
+Log_destroy(void)
 {
-    int ret;
-    uint16_t command;
+    free((void *) _Log);
+}
+
+static void
+Log_initialize(void)
+{
+    _Log = new(LogClass(), "Log", RPC(), sizeof(struct Log),
+               ctor, "ctor", Log_ctor,
+               dtor, "dtor", Log_dtor,
+               log_get_index_by_facility, "get_index_by_facility", Log_get_index_by_facility,
+               log_submit, "submit", Log_submit,
+               log_flush, "flush", Log_flush,
+               (void *) 0);
     
-    if ((ret = rpc_write(_self)) != AAOS_OK) {
-        return ret;
-    }
+#ifndef _USE_COMPILER_ATTRIBUTION_
+    atexit(Log_destroy);
+#endif
+}
 
-    protobuf_get(_self, PACKET_COMMAND, &command);
+const void *
+Log(void)
+{
+#ifndef _USE_COMPILER_ATTRIBUTION_
+    static pthread_once_t once = PTHREAD_ONCE_INIT;
+    pthread_once(&once, Log_initialize);
+#endif
+    
+    return _Log;
+}
 
-    if (command == LOG_COMMAND_SUBMIT) {
-        return ret;
-    }
+static const void *_log_virtual_table;
+
+static void
+log_virtual_table_destroy(void)
+{
+    delete((void *) _log_virtual_table);
+}
+
+static void
+log_virtual_table_initialize(void)
+{
+    _log_virtual_table = new(RPCVirtualTable(),
+                             rpc_execute, "execute", Log_execute,
+                             (void *)0);
+    
+#ifndef _USE_COMPILER_ATTRIBUTION_
+    atexit(log_virtual_table_destroy);
+#endif
+}
 
-    return rpc_read(_self);
+static const void *
+log_virtual_table(void)
+{
+#ifndef _USE_COMPILER_ATTRIBUTION_
+    static pthread_once_t once_control = PTHREAD_ONCE_INIT;
+    Pthread_once(&once_control, log_virtual_table_initialize);
+#endif
+    
+    return _log_virtual_table;
 }
 
+/*
+ * Log client
+ */
+
+static const void *log_client_virtual_table(void);
+
 static int
 LogClient_connect(void *_self, void **client)
 {
     struct LogClient *self = cast(LogClient(), _self);
 
+    int ret = AAOS_OK;
     int cfd;
     
     if (self->_._.address != NULL && Access(self->_._.address, F_OK) == 0) {
-        cfd = Un_stream_connect_nb(self->_._.address, LOG_CONNECT_TIMEOUT);
+        cfd = Un_stream_connect(self->_._.address);
     } else {
-        cfd = Tcp_connect_nb(self->_._.address, self->_._.port, NULL, NULL, LOG_CONNECT_TIMEOUT);
+        cfd = Tcp_connect(self->_._.address, self->_._.port, NULL, NULL);
     }
     
     if (cfd < 0) {
-        *client = NULL;
-        return AAOS_ERROR;
-    } else {
-        *client = new(Log(), cfd);
+        switch (errno) {
+            case ECONNREFUSED:
+                ret = AAOS_ECONNREFUSED;
+                break;
+            case ENETUNREACH:
+                ret = AAOS_ENETUNREACH;
+                break;
+            case ETIMEDOUT:
+                ret = AAOS_ETIMEDOUT;
+                break;
+            default:
+                ret = AAOS_ERROR;
+                break;
+        }
     }
     
+    *client = new(Log(), cfd);
     protobuf_set(*client, PACKET_PROTOCOL, PROTO_LOG);
+    rpc_set_timeout(*client, LOG_CALL_TIMEOUT);
     
-    return AAOS_OK;
+    return ret;
 }
 
+static void *
+LogClient_ctor(void *_self, va_list *app)
+{
+    struct LogClient *self = super_ctor(LogClient(), _self, app);
+    
+    self->_._vtab = log_client_virtual_table();
+    
+    return (void *) self;
+}
 
-static const void *log_server_virtual_table(void);
+static void *
+LogClient_dtor(void *_self)
+{
+    return super_dtor(LogClient(), _self);
+}
+
+static void *
+LogClientClass_ctor(void *_self, va_list *app)
+{
+    struct LogClientClass *self = super_ctor(LogClientClass(), _self, app);
+    
+    self->_.connect.method = (Method) 0;
+    
+    return self;
+}
+
+static void *_LogClientClass;
+
+static void
+LogClientClass_destroy(void)
+{
+    free((void *) _LogClientClass);
+}
+
+static void
+LogClientClass_initialize(void)
+{
+    _LogClientClass = new(RPCClientClass(), "LogClientClass", RPCClientClass(), sizeof(struct LogClientClass),
+                          ctor, "ctor", LogClientClass_ctor,
+                          (void *) 0);
+    
+#ifndef _USE_COMPILER_ATTRIBUTION_
+    atexit(LogClientClass_destroy);
+#endif
+}
+
+const void *
+LogClientClass(void)
+{
+#ifndef _USE_COMPILER_ATTRIBUTION_
+    static pthread_once_t once = PTHREAD_ONCE_INIT;
+    pthread_once(&once, LogClientClass_initialize);
+#endif
+    
+    return _LogClientClass;
+}
 
+static void *_LogClient;
+
+static void
+LogClient_destroy(void)
+{
+    free((void *) _LogClient);
+}
+
+static void
+LogClient_initialize(void)
+{
+    _LogClient = new(LogClientClass(), "LogClient", RPCClient(), sizeof(struct LogClient),
+                     ctor, "ctor", LogClient_ctor,
+                     dtor, "dtor", LogClient_dtor,
+                     (void *) 0);
+    
+#ifndef _USE_COMPILER_ATTRIBUTION_
+    atexit(LogClient_destroy);
+#endif
+}
+
+const void *
+LogClient(void)
+{
+#ifndef _USE_COMPILER_ATTRIBUTION_
+    static pthread_once_t once = PTHREAD_ONCE_INIT;
+    pthread_once(&once, LogClient_initialize);
+#endif
+    
+    return _LogClient;
+}
+
+static const void *_log_client_virtual_table;
+
+static void
+log_client_virtual_table_destroy(void)
+{
+    delete((void *) _log_client_virtual_table);
+}
+
+static void
+log_client_virtual_table_initialize(void)
+{
+    _log_client_virtual_table = new(RPCClientVirtualTable(),
+                                    rpc_client_connect, "connect", LogClient_connect,
+                                    (void *) 0);
+#ifndef _USE_COMPILER_ATTRIBUTION_
+    atexit(log_client_virtual_table_destroy);
+#endif
+}
+
+static const void *
+log_client_virtual_table(void)
+{
+#ifndef _USE_COMPILER_ATTRIBUTION_
+    static pthread_once_t once_control = PTHREAD_ONCE_INIT;
+    Pthread_once(&once_control, log_client_virtual_table_initialize);
+#endif
+    
+    return _log_client_virtual_table;
+}
+
+/*
+ * Log server, served by the event loop of RPCServer over TCP and Unix domain sockets.
+ */
+
+static const void *log_server_virtual_table(void);
 
 static int
 LogServer_accept(void *_self, void **client)
 {
     struct RPCServer *self = cast(RPCServer(), _self);
     
-    int lfd, cfd;
+    int cfd;
     
-    lfd = tcp_server_get_lfd(self);
-    cfd = Accept(lfd, NULL, NULL);
+    cfd = rpc_server_accept_fd(self, TCPSERVER_OPTION_TCP);
     if (cfd < 0) {
         *client = NULL;
         return AAOS_ERROR;
@@ -363,7 +698,6 @@ LogServer_accept(void *_self, void **client)
             Close(cfd);
             return AAOS_ERROR;
         }
-        Fcntl(cfd, F_SETFL, O_NONBLOCK);
         return AAOS_OK;
     }
 }
@@ -373,12 +707,9 @@ LogServer_accept2(void *_self, void **client)
 {
     struct RPCServer *self = cast(RPCServer(), _self);
     
-    int lfd, cfd, lfds[2];
-    
-    tcp_server_get_lfds(self, lfds);
-    lfd = lfds[1];
+    int cfd;
     
-    cfd = Accept(lfd, NULL, NULL);
+    cfd = rpc_server_accept_fd(self, TCPSERVER_OPTION_UDS);
     if (cfd < 0) {
         *client = NULL;
         return AAOS_ERROR;
@@ -387,171 +718,10 @@ LogServer_accept2(void *_self, void **client)
             Close(cfd);
             return AAOS_ERROR;
         }
-        Fcntl(cfd, F_SETFL, O_NONBLOCK);
         return AAOS_OK;
     }
 }
 
-static void *
-LogServer_thr(void *arg)
-{
-    struct LogServer *myarg = (struct LogServer *) arg;
-    
-    int lfd = myarg->_._.lfd, lfd2 = myarg->_._.lfd2, cfd;
-    int ret;
-    void *client;
-#ifdef LINUX
-    int efd, nfds, timeout, i;
-    struct epoll_event ev, *evs;
-    if (self->timeout < 0) {
-        timeout = -1;
-    } else {
-        tiemout = (int) self->timeout * 1000;
-    }
-    evs = (struct epoll_event *) Malloc(myarg->n_event * sizeof(struct epoll_event));
-    efd = epoll_create(1);
-    if (lfd != -1) {
-        ev.events = EPOLLIN;
-        ev.data.fd = lfd;
-        epoll_ctl(efd, EPOLL_CTL_ADD, lfd, &ev);
-    }
-    if (lfd2 != -1) {
-        ev.events = EPOLLIN;
-        ev.data.fd = lfd2;
-        epoll_ctl(efd, EPOLL_CTL_ADD, lfd2, &ev);
-    }
-    for (; ;) {
-        if ((nfds = epoll_wait(efd, evs, myarg->n_event, timeout)) != -1) {
-            for (i = 0; i < nfds; i++) {
-                if (evs[i].data.ptr != NULL && ((struct Object *)evs[i].data.ptr)->magic == MAGIC) {
-                    ret = rpc_process(client);
-                    if (ret != AAOS_OK && ret != AAOS_EAGAIN) {
-                        cfd = tcp_socket_get_sockfd(client);
-                        epoll_ctl(efd, EPOLL_CTL_DEL, cfd, &ev);
-                        delete(client);
-                    }
-                } else {
-                    *client = NULL;
-                    if (evs[i].data.fd == lfd) {
-                        LogServer_accept(myarg, &client);
-                    } else if (evs[i].data.fd == lfd2) {
-                        LogServer_accept2(myarg, &client);
-                    }
-                    if (client != NULL) {
-                        ev.events = EPOLLIN | EPOLLET;
-                        ev.data.ptr = client;
-                        epoll_ctl(efd, EPOLL_CTL_ADD, tcp_socket_get_sockfd(client), &ev);
-                    }
-                }
-            }
-        }
-    }
-#endif
-#ifdef MACOSX
-    int kq, nchanges = 0, nevents = (int) myarg->n_event, n, i, j;
-    struct kevent kev, *changelist, *eventlist;
-    struct timespec tp;
-    tp->tv_sec = floor(self->timeout);
-    tp->tv_nsec = (self->timeout - tp->tv_sec) * 1000000000;
-    
-    changelist = (struct kevent *) Malloc(sizeof(struct kevent) * myarg->n_event);
-    memset(changelist, '\0', sizeof(struct kevent) * myarg->n_event);
-    eventlist = (struct kevent *) Malloc(sizeof(struct kevent) * myarg->n_event);
-    
-    if (lfd != -1) {
-        EV_SET(&changelist[nchanges], lfd, EVFILT_READ, EV_ADD, 0, 0, myarg);
-        nchanges++;
-    }
-    if (lfd2 != -1) {
-        EV_SET(&changelist[nchanges], lfd2, EVFILT_READ, EV_ADD, 0, 0, myarg);
-        nchanges++;
-    }
-    nchanges = myarg->n_event;
-    for (; ;) {
-        if ((n = kevent(kq, changelist, nchanges, eventlist, nevents, &tp)) > 0) {
-            for (i = 0; i < n; i++) {
-                if (eventlist[i].ident == lfd) {
-                    ret = LogServer_accept(myarg, &client);
-                    if (ret == AAOS_OK && client != NULL) {
-                        for (j = 0; i < nchanges; j++) {
-                            if (changelist[j].udata == NULL) {
-                                EV_SET(&changelist[j], tcp_socket_get_sockfd(client), EVFILT_READ, EV_ADD | EV_ENABLE, 0, 0, client);
-                                break;
-                            }
-                        }
-                        if (j == nchanges) {
-                            delete(client);
-                        }
-                    }
-                } else if (eventlist[i].ident == lfd2) {
-                    ret = LogServer_accept2(myarg, &client);
-                    if (ret == AAOS_OK && client != NULL) {
-                        for (j = 0; j < nchanges; i++) {
-                            if (changelist[j].udata == NULL) {
-                                EV_SET(&changelist[j], tcp_socket_get_sockfd(client), EVFILT_READ, EV_ADD | EV_ENABLE, 0, 0, client);
-                                break;
-                            }
-                        }
-                        if (i == nchanges) {
-                            delete(client);
-                        }
-                    }
-                } else {
-                    client = eventlist[i].udata;
-                    cfd = eventlist[i].ident;
-                    if (client != NULL && tcp_socket_get_sockfd(client) == cfd) {
-                        ret = rpc_process(client);
-                        if (ret != AAOS_OK && ret != AAOS_EAGAIN) {
-                            for (j = 0; j < nchanges; j++) {
-                                if (client == changelist[j].udata) {
-                                    EV_SET(&changelist[j], cfd, EVFILT_READ, EV_DELETE, 0, 0, NULL);
-                                    delete(client);
-                                    break;
-                                }
-                            }
-                            
-                        }
-                    }
-                }
-            }
-            
-        }
-    }
-#endif
-    
-    return NULL;
-}
-
-static int
-LogServer_start(void *_self)
-{
-    struct LogServer *self = cast(LogServer(), _self);
-    
-    size_t i;
-    pthread_t *tids;
-    
-    tids = (pthread_t *) Malloc(sizeof(pthread_t) * self->n_thread);
-    
-    
-    if (self->_._.address != NULL && self->_._.port != NULL && (self->_._.lfd = Tcp_listen(self->_._.address, self->_._.port, NULL, NULL)) >= 0) {
-        Fcntl(self->_._.lfd, F_SETFL, O_NONBLOCK);
-        self->count++;
-    }
-    if (self->_._.path != NULL && (self->_._.lfd2 = self->_._.lfd2 = Un_stream_listen(self->_._.path)) >= 0) {
-        Fcntl(self->_._.lfd2, F_SETFL, O_NONBLOCK);
-        self->count++;
-    }
-    
-    for (i = 0; i < self->n_thread; i++) {
-        Pthread_create(&tids[i], NULL, LogServer_thr, self);
-    }
-    
-    for (i = 0; i < self->n_thread; i++) {
-        Pthread_join(tids[i], NULL);
-    }
-    return AAOS_OK;
-}
-
 static void *
 LogServer_ctor(void *_self, va_list *app)
 {
@@ -577,7 +747,6 @@ LogServerClass_ctor(void *_self, va_list *app)
     
     self->_.accept.method = (Method) 0;
     self->_.accept2.method = (Method) 0;
-    self->_.start.method = (Method) 0;
     
     return self;
 }
@@ -633,7 +802,7 @@ LogServer_initialize(void)
 }
 
 const void *
-SerialServer(void)
+LogServer(void)
 {
 #ifndef _USE_COMPILER_ATTRIBUTION_
     static pthread_once_t once = PTHREAD_ONCE_INIT;
@@ -655,8 +824,8 @@ static void
 log_server_virtual_table_initialize(void)
 {
     _log_server_virtual_table = new(RPCServerVirtualTable(),
-                                    //rpc_server_accept, "accept", SerialServer_accept,
-                                    //rpc_server_accept2, "accept2", SerialServer_accept2,
+                                    rpc_server_accept, "accept", LogServer_accept,
+                                    rpc_server_accept2, "accept2", LogServer_accept2,
                                     (void *)0);
 #ifndef _USE_COMPILER_ATTRIBUTION_
     atexit(log_server_virtual_table_destroy);
@@ -674,6 +843,36 @@ log_server_virtual_table(void)
     return _log_server_virtual_table;
 }
 
+#ifdef _USE_COMPILER_ATTRIBUTION_
+static void __constructor__(void) __attribute__ ((constructor(_LOG_RPC_PRIORITY_)));
 
+static void
+__constructor__(void)
+{
+    log_virtual_table_initialize();
+    LogClass_initialize();
+    Log_initialize();
+    log_client_virtual_table_initialize();
+    LogClientClass_initialize();
+    LogClient_initialize();
+    log_server_virtual_table_initialize();
+    LogServerClass_initialize();
+    LogServer_initialize();
+}
 
+static void __destructor__(void) __attribute__ ((destructor(_LOG_RPC_PRIORITY_)));
 
+static void
+__destructor__(void)
+{
+    LogServer_destroy();
+    LogServerClass_destroy();
+    log_server_virtual_table_destroy();
+    LogClient_destroy();
+    LogClientClass_destroy();
+    log_client_virtual_table_destroy();
+    Log_destroy();
+    LogClass_destroy();
+    log_virtual_table_destroy();
+}
+#endif
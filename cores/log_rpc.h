@@ -8,17 +8,32 @@
 #ifndef log_rpc_h
 #define log_rpc_h
 
+#include "rpc.h"
+
 #define LOG_COMMAND_SUBMIT                  1
-#define LPG_COMMAND_GET_INDEX_BY_FACILITY   2
+#define LOG_COMMAND_GET_INDEX_BY_FACILITY   2
+
+/*
+ * Centralised logging.
+ * A daemon connects a LogClient to the log server, and resolves its facility once by log_get_index_by_facility.
+ * log_submit queues a record on the connection, the records are sent as one batch when the batch is full,
+ * when an urgent record comes, or when the oldest record queued is LOG_FLUSH_INTERVAL seconds old,
+ * and by log_flush, which a daemon should call from time to time and before it exits.
+ * If a batch cannot be sent, its records are dropped, a daemon never waits on the log server for long.
+ * To tail the logs, subscribe the connection to "log/<facility>", or to "log/" followed by an asterisk for all facilities,
+ * every event is a run of lines of the log.
+ */
 
-#ifdef __cpluscplus
+#ifdef __cplusplus
 extern "C" {
 #endif
 
-int log_submit(void *_self, const char *message);
+int log_get_index_by_facility(void *_self, const char *facility);
+int log_submit(void *_self, unsigned int level, const char *message);
+int log_flush(void *_self);
 
 extern const void *Log(void);
-extern const void *logClass(void);
+extern const void *LogClass(void);
 
 extern const void *LogClient(void);
 extern const void *LogClientClass(void);
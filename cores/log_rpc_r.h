@@ -14,14 +14,20 @@
 
 struct Log {
     struct RPC _;
-    void *queue;
+    pthread_mutex_t mtx;
+    uint16_t index;         /* of the facility on the server */
+    char *queue;            /* records not sent yet */
     size_t size;
+    size_t length;
+    uint32_t n_record;
+    double first;           /* when the oldest record was queued, CLOCK_MONOTONIC */
 };
 
 struct LogClass {
     struct RPCClass _;
     struct Method get_index_by_facility;
     struct Method submit;
+    struct Method flush;
 };
 
 struct LogClient {
@@ -34,13 +40,6 @@ struct LogClientClass {
 
 struct LogServer {
     struct RPCServer _;
-    void *queue;
-    int efd;
-    unsigned long long count;
-    size_t n_thread;
-    size_t n_event;
-    pthread_t *tids;
-    double timeout;
 };
 
 struct LogServerClass {
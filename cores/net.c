@@ -6,6 +6,10 @@
 //  Copyright © 2018年 National Astronomical Observatories, Chinese Academy of Sciences. All rights reserved.
 //
 
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE     /* F_ADD_SEALS */
+#endif
+
 #include "def.h"
 #include "net_r.h"
 #include "net.h"
@@ -99,13 +103,106 @@ tcp_socket_read(void *_self, void *read_buffer, size_t request_size, size_t *rea
     return result;
 }
 
+static int TCPSocket_shm_read(struct TCPSocket *self, void *read_buffer, size_t request_size, size_t *read_size);
+static int TCPSocket_shm_write(struct TCPSocket *self, const void *write_buffer, size_t request_size, size_t *write_size);
+static void TCPSocket_shm_destroy(struct TCPSocketSHM *shm);
+
+/*
+ * Milliseconds left before the deadline, for poll.
+ */
+static int
+TCPSocket_remaining(const struct TCPSocket *self)
+{
+    struct timespec tp;
+    double remaining;
+    
+    Clock_gettime(CLOCK_MONOTONIC, &tp);
+    remaining = self->deadline - (tp.tv_sec + tp.tv_nsec / 1000000000.);
+    
+    return remaining > 0. ? (int) (remaining * 1000.) + 1 : 0;
+}
+
+/*
+ * Transfer iov in full before the deadline, waiting with poll and never blocking in the transfer itself.
+ * Returns the number of bytes transferred like Readn and Writen do, or -1 with errno set to ETIMEDOUT
+ * once the deadline has passed.
+ */
+static ssize_t
+TCPSocket_transfer(struct TCPSocket *self, struct iovec *iov, int iovcnt, bool write)
+{
+    struct pollfd pfd;
+    struct msghdr msg;
+    size_t ntransferred = 0;
+    ssize_t n;
+    int timeout;
+    
+    while (iovcnt > 0) {
+        if (iov->iov_len == 0) {
+            iov++;
+            iovcnt--;
+            continue;
+        }
+        memset(&msg, '\0', sizeof(msg));
+        msg.msg_iov = iov;
+        msg.msg_iovlen = iovcnt;
+        n = write ? sendmsg(self->sockfd, &msg, MSG_DONTWAIT) : recvmsg(self->sockfd, &msg, MSG_DONTWAIT);
+        if (n < 0) {
+            if (errno == EINTR && !(self->option & TCPSOCKET_OPTION_DO_NOT_RESTART_ON_SIGNAL)) {
+                continue;
+            } else if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                return -1;
+            }
+            if ((timeout = TCPSocket_remaining(self)) == 0) {
+                errno = ETIMEDOUT;
+                return -1;
+            }
+            pfd.fd = self->sockfd;
+            pfd.events = write ? POLLOUT : POLLIN;
+            pfd.revents = 0;
+            if (poll(&pfd, 1, timeout) < 0 && (errno != EINTR || (self->option & TCPSOCKET_OPTION_DO_NOT_RESTART_ON_SIGNAL))) {
+                return -1;
+            }
+            continue;
+        } else if (n == 0 && !write) {
+            break;
+        }
+        ntransferred += n;
+        while (n > 0 && (size_t) n >= iov->iov_len) {
+            n -= iov->iov_len;
+            iov++;
+            iovcnt--;
+        }
+        if (n > 0) {
+            iov->iov_base = (char *) iov->iov_base + n;
+            iov->iov_len -= n;
+        }
+    }
+    
+    return ntransferred;
+}
+
+void
+tcp_socket_set_deadline(void *_self, double deadline)
+{
+    struct TCPSocket *self = cast(TCPSocket(), _self);
+    
+    self->deadline = deadline;
+}
+
 static int
 TCPSocket_read(const void *_self, void *read_buffer, size_t request_size, size_t *read_size)
 {
     struct TCPSocket *self = cast(TCPSocket(), _self);
     ssize_t n;
     
-    if (self->option & TCPSOCKET_OPTION_DO_NOT_RESTART_ON_SIGNAL) {
+    if (self->shm != NULL && self->shm->enabled) {
+        return TCPSocket_shm_read(self, read_buffer, request_size, read_size);
+    }
+    
+    if (self->deadline > 0.) {
+        struct iovec iov = {read_buffer, request_size};
+        n = TCPSocket_transfer(self, &iov, 1, false);
+    } else if (self->option & TCPSOCKET_OPTION_DO_NOT_RESTART_ON_SIGNAL) {
         n = Readn2(self->sockfd, read_buffer, request_size);
     } else {
         n = Readn(self->sockfd, read_buffer, request_size);
@@ -292,7 +389,14 @@ TCPSocket_write(void *_self, const void *write_buffer, size_t request_size, size
     struct TCPSocket *self = cast(TCPSocket(), _self);
     ssize_t n;
     
-    if (self->option & TCPSOCKET_OPTION_DO_NOT_RESTART_ON_SIGNAL) {
+    if (self->shm != NULL && self->shm->enabled) {
+        return TCPSocket_shm_write(self, write_buffer, request_size, write_size);
+    }
+    
+    if (self->deadline > 0.) {
+        struct iovec iov = {(void *) write_buffer, request_size};
+        n = TCPSocket_transfer(self, &iov, 1, true);
+    } else if (self->option & TCPSOCKET_OPTION_DO_NOT_RESTART_ON_SIGNAL) {
         n = Writen2(self->sockfd, write_buffer, request_size);
     } else {
         n = Writen(self->sockfd, write_buffer, request_size);
@@ -323,6 +427,9 @@ TCPSocket_write(void *_self, const void *write_buffer, size_t request_size, size
             case EPIPE:
                 return AAOS_EPIPE;
                 break;
+            case ETIMEDOUT:
+                return AAOS_ETIMEDOUT;
+                break;
             default:
                 return AAOS_ERROR;
                 break;
@@ -330,6 +437,528 @@ TCPSocket_write(void *_self, const void *write_buffer, size_t request_size, size
     }
 }
 
+/*
+ * Shared-memory transport.
+ */
+
+#ifdef LINUX
+
+static void
+TCPSocket_shm_notify(struct TCPSocketSHM *shm)
+{
+    int peer = 1 - shm->endpoint;
+    uint64_t one = 1;
+    
+    /*
+     * Pairs with the fence in TCPSocket_shm_wait, either the peer sees the new position,
+     * or we see its waiting flag.
+     */
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&shm->header->waiting[peer], __ATOMIC_RELAXED)) {
+        write(shm->efd[peer], &one, sizeof(one));
+    }
+}
+
+/*
+ * Wait until *position moves away from old, or the peer hangs up.
+ */
+static int
+TCPSocket_shm_wait(struct TCPSocket *self, uint64_t *position, uint64_t old)
+{
+    struct TCPSocketSHM *shm = self->shm;
+    struct pollfd pfd[2];
+    uint64_t value;
+    int n, timeout, ret = AAOS_OK;
+    
+    __atomic_store_n(&shm->header->waiting[shm->endpoint], 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    while (__atomic_load_n(position, __ATOMIC_ACQUIRE) == old) {
+        pfd[0].fd = shm->efd[shm->endpoint];
+        pfd[0].events = POLLIN;
+        pfd[0].revents = 0;
+        pfd[1].fd = self->sockfd;
+        pfd[1].events = POLLIN;
+        pfd[1].revents = 0;
+        if (self->deadline > 0.) {
+            timeout = TCPSocket_remaining(self);
+        } else {
+            timeout = self->timeout > 0. ? (int) (self->timeout * 1000.) : -1;
+        }
+        n = poll(pfd, 2, timeout);
+        if (n < 0) {
+            if (errno == EINTR && !(self->option & TCPSOCKET_OPTION_DO_NOT_RESTART_ON_SIGNAL)) {
+                continue;
+            }
+            ret = (errno == EINTR) ? AAOS_EINTR : AAOS_ERROR;
+            break;
+        } else if (n == 0) {
+            ret = AAOS_ETIMEDOUT;
+            break;
+        }
+        /*
+         * Nothing is sent on the socket after the switch, so it can only become readable on hang-up.
+         */
+        if (pfd[1].revents) {
+            ret = AAOS_ECLOSED;
+            break;
+        }
+        if (pfd[0].revents & POLLIN) {
+            read(pfd[0].fd, &value, sizeof(value));
+        }
+    }
+    __atomic_store_n(&shm->header->waiting[shm->endpoint], 0, __ATOMIC_RELAXED);
+    
+    return ret;
+}
+
+/*
+ * The indices live in memory the peer can write, a ring that holds more than it can
+ * means the peer is broken or hostile. Drop the mapping and hang up, the socket can
+ * not be used for the byte stream either, since the two sides are out of step.
+ */
+static int
+TCPSocket_shm_abort(struct TCPSocket *self)
+{
+    struct TCPSocketSHM *shm = self->shm;
+    
+    self->shm = NULL;
+    TCPSocket_shm_destroy(shm);
+    shutdown(self->sockfd, SHUT_RDWR);
+    
+    return AAOS_EBADMSG;
+}
+
+static int
+TCPSocket_shm_read(struct TCPSocket *self, void *read_buffer, size_t request_size, size_t *read_size)
+{
+    struct TCPSocketSHM *shm = self->shm;
+    int peer = 1 - shm->endpoint;
+    struct TCPSocketSHMRing *ring = &shm->header->ring[peer];
+    const char *data = shm->data[peer];
+    size_t size = shm->ring_size, offset, chunk, first, nread = 0;
+    uint64_t head, tail;
+    int ret;
+    
+    while (nread < request_size) {
+        tail = __atomic_load_n(&ring->tail, __ATOMIC_RELAXED);
+        head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+        if (head - tail > size) {
+            if (read_size != NULL) {
+                *read_size = nread;
+            }
+            return TCPSocket_shm_abort(self);
+        }
+        if (head == tail) {
+            if ((ret = TCPSocket_shm_wait(self, &ring->head, head)) != AAOS_OK) {
+                if (read_size != NULL) {
+                    *read_size = nread;
+                }
+                return ret;
+            }
+            continue;
+        }
+        chunk = (size_t) (head - tail);
+        if (chunk > request_size - nread) {
+            chunk = request_size - nread;
+        }
+        offset = (size_t) (tail & (size - 1));
+        first = (chunk < size - offset) ? chunk : size - offset;
+        memcpy((char *) read_buffer + nread, data + offset, first);
+        memcpy((char *) read_buffer + nread + first, data, chunk - first);
+        __atomic_store_n(&ring->tail, tail + chunk, __ATOMIC_RELEASE);
+        TCPSocket_shm_notify(shm);
+        nread += chunk;
+    }
+    if (read_size != NULL) {
+        *read_size = nread;
+    }
+    
+    return AAOS_OK;
+}
+
+static int
+TCPSocket_shm_write(struct TCPSocket *self, const void *write_buffer, size_t request_size, size_t *write_size)
+{
+    struct TCPSocketSHM *shm = self->shm;
+    struct TCPSocketSHMRing *ring = &shm->header->ring[shm->endpoint];
+    char *data = shm->data[shm->endpoint];
+    size_t size = shm->ring_size, offset, chunk, first, nwritten = 0;
+    uint64_t head, tail;
+    int ret;
+    
+    while (nwritten < request_size) {
+        head = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+        tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+        if (head - tail > size) {
+            if (write_size != NULL) {
+                *write_size = nwritten;
+            }
+            return TCPSocket_shm_abort(self);
+        }
+        if (head - tail == size) {
+            if ((ret = TCPSocket_shm_wait(self, &ring->tail, tail)) != AAOS_OK) {
+                if (write_size != NULL) {
+                    *write_size = nwritten;
+                }
+                return ret == AAOS_ECLOSED ? AAOS_EPIPE : ret;
+            }
+            continue;
+        }
+        chunk = size - (size_t) (head - tail);
+        if (chunk > request_size - nwritten) {
+            chunk = request_size - nwritten;
+        }
+        offset = (size_t) (head & (size - 1));
+        first = (chunk < size - offset) ? chunk : size - offset;
+        memcpy(data + offset, (const char *) write_buffer + nwritten, first);
+        memcpy(data, (const char *) write_buffer + nwritten + first, chunk - first);
+        __atomic_store_n(&ring->head, head + chunk, __ATOMIC_RELEASE);
+        TCPSocket_shm_notify(shm);
+        nwritten += chunk;
+    }
+    if (write_size != NULL) {
+        *write_size = nwritten;
+    }
+    
+    return AAOS_OK;
+}
+
+static void
+TCPSocket_shm_destroy(struct TCPSocketSHM *shm)
+{
+    if (shm->header != NULL) {
+        munmap(shm->header, shm->length);
+    }
+    if (shm->efd[0] >= 0) {
+        Close(shm->efd[0]);
+    }
+    if (shm->efd[1] >= 0) {
+        Close(shm->efd[1]);
+    }
+    free(shm);
+}
+
+static struct TCPSocketSHM *
+TCPSocket_shm_map(int memfd, size_t length, int endpoint)
+{
+    struct TCPSocketSHM *shm;
+    void *addr;
+    
+    if ((addr = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_SHARED, memfd, 0)) == MAP_FAILED) {
+        return NULL;
+    }
+    shm = (struct TCPSocketSHM *) Malloc(sizeof(struct TCPSocketSHM));
+    shm->header = (struct TCPSocketSHMHeader *) addr;
+    shm->length = length;
+    shm->endpoint = endpoint;
+    shm->enabled = false;
+    shm->efd[0] = shm->efd[1] = -1;
+    
+    return shm;
+}
+
+static void
+TCPSocket_shm_layout(struct TCPSocketSHM *shm)
+{
+    shm->data[0] = (char *) shm->header + sizeof(struct TCPSocketSHMHeader);
+    shm->data[1] = shm->data[0] + shm->header->ring_size;
+    shm->ring_size = shm->header->ring_size;
+}
+
+int
+tcp_socket_shm_offer(void *_self, size_t ring_size, const void *buffer, size_t size)
+{
+    struct TCPSocket *self = cast(TCPSocket(), _self);
+    
+    struct TCPSocketSHM *shm;
+    struct msghdr msg;
+    struct iovec iov;
+    struct cmsghdr *cmsg;
+    union {
+        char buf[CMSG_SPACE(sizeof(int) * 3)];
+        struct cmsghdr align;
+    } control;
+    size_t length, n = 4096;
+    int memfd, fds[3];
+    ssize_t ret;
+    
+    if (self->shm != NULL) {
+        return AAOS_EALREADY;
+    }
+    while (n < ring_size && n < TCPSOCKET_SHM_RING_SIZE_MAX) {
+        n <<= 1;
+    }
+    length = sizeof(struct TCPSocketSHMHeader) + 2 * n;
+    
+    if ((memfd = memfd_create("aaos-rpc", MFD_CLOEXEC | MFD_ALLOW_SEALING)) < 0) {
+        return AAOS_ENOTSUP;
+    }
+    if (ftruncate(memfd, (off_t) length) < 0 || (shm = TCPSocket_shm_map(memfd, length, 1)) == NULL) {
+        Close(memfd);
+        return AAOS_ENOMEM;
+    }
+    /*
+     * Neither side may resize the region once the peer has mapped it,
+     * a shrunk region would fault the other side with SIGBUS.
+     */
+    if (fcntl(memfd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL) < 0) {
+        Close(memfd);
+        TCPSocket_shm_destroy(shm);
+        return AAOS_ENOTSUP;
+    }
+    memset(shm->header, '\0', sizeof(struct TCPSocketSHMHeader));
+    shm->header->magic = TCPSOCKET_SHM_MAGIC;
+    shm->header->ring_size = (uint32_t) n;
+    TCPSocket_shm_layout(shm);
+    if ((shm->efd[0] = eventfd(0, EFD_CLOEXEC)) < 0 || (shm->efd[1] = eventfd(0, EFD_CLOEXEC)) < 0) {
+        Close(memfd);
+        TCPSocket_shm_destroy(shm);
+        return AAOS_ERROR;
+    }
+    
+    fds[0] = memfd;
+    fds[1] = shm->efd[0];
+    fds[2] = shm->efd[1];
+    memset(&msg, '\0', sizeof(msg));
+    iov.iov_base = (void *) buffer;
+    iov.iov_len = size;
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = sizeof(control.buf);
+    cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+    memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+    
+    while ((ret = sendmsg(self->sockfd, &msg, MSG_NOSIGNAL)) < 0 && errno == EINTR) {
+    }
+    Close(memfd);
+    if (ret < 0) {
+        TCPSocket_shm_destroy(shm);
+        return errno == EPIPE ? AAOS_EPIPE : AAOS_ERROR;
+    }
+    /*
+     * The descriptors have gone with the first byte, the rest is an ordinary write.
+     */
+    if ((size_t) ret < size && Writen(self->sockfd, (const char *) buffer + ret, size - ret) < 0) {
+        TCPSocket_shm_destroy(shm);
+        return AAOS_EPIPE;
+    }
+    
+    shm->enabled = true;
+    self->shm = shm;
+    
+    return AAOS_OK;
+}
+
+int
+tcp_socket_shm_accept(void *_self, void *buffer, size_t size)
+{
+    struct TCPSocket *self = cast(TCPSocket(), _self);
+    
+    struct TCPSocketSHM *shm;
+    struct msghdr msg;
+    struct iovec iov;
+    struct cmsghdr *cmsg;
+    struct stat st;
+    union {
+        char buf[CMSG_SPACE(sizeof(int) * 3)];
+        struct cmsghdr align;
+    } control;
+    int fds[3], n_fd = 0, i, seals;
+    ssize_t ret;
+    
+    memset(&msg, '\0', sizeof(msg));
+    iov.iov_base = buffer;
+    iov.iov_len = size;
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = sizeof(control.buf);
+    
+    while ((ret = recvmsg(self->sockfd, &msg, MSG_CMSG_CLOEXEC)) < 0 && errno == EINTR) {
+    }
+    if (ret < 0) {
+        return errno == ECONNRESET ? AAOS_ECONNRESET : AAOS_ERROR;
+    } else if (ret == 0) {
+        return AAOS_ECLOSED;
+    }
+    for (cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+            n_fd = (int) ((cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int));
+            if (n_fd > 3) {
+                n_fd = 3;
+            }
+            memcpy(fds, CMSG_DATA(cmsg), sizeof(int) * n_fd);
+        }
+    }
+    if ((size_t) ret < size && Readn(self->sockfd, (char *) buffer + ret, size - ret) <= 0) {
+        for (i = 0; i < n_fd; i++) {
+            Close(fds[i]);
+        }
+        return AAOS_ECLOSED;
+    }
+    if (n_fd != 3) {
+        for (i = 0; i < n_fd; i++) {
+            Close(fds[i]);
+        }
+        return AAOS_ENOTSUP;
+    }
+    
+    if ((seals = fcntl(fds[0], F_GET_SEALS)) < 0 || (seals & (F_SEAL_SHRINK | F_SEAL_GROW)) != (F_SEAL_SHRINK | F_SEAL_GROW)) {
+        for (i = 0; i < 3; i++) {
+            Close(fds[i]);
+        }
+        return AAOS_EBADMSG;
+    }
+    if (fstat(fds[0], &st) < 0 || (size_t) st.st_size < sizeof(struct TCPSocketSHMHeader) || (shm = TCPSocket_shm_map(fds[0], (size_t) st.st_size, 0)) == NULL) {
+        for (i = 0; i < 3; i++) {
+            Close(fds[i]);
+        }
+        return AAOS_ERROR;
+    }
+    Close(fds[0]);
+    shm->efd[0] = fds[1];
+    shm->efd[1] = fds[2];
+    if (shm->header->magic != TCPSOCKET_SHM_MAGIC || shm->header->ring_size == 0 || (shm->header->ring_size & (shm->header->ring_size - 1)) != 0 || sizeof(struct TCPSocketSHMHeader) + 2 * (size_t) shm->header->ring_size != shm->length) {
+        TCPSocket_shm_destroy(shm);
+        return AAOS_EBADMSG;
+    }
+    TCPSocket_shm_layout(shm);
+    shm->enabled = true;
+    self->shm = shm;
+    
+    return AAOS_OK;
+}
+
+#else
+
+static int
+TCPSocket_shm_read(struct TCPSocket *self, void *read_buffer, size_t request_size, size_t *read_size)
+{
+    return AAOS_ENOTSUP;
+}
+
+static int
+TCPSocket_shm_write(struct TCPSocket *self, const void *write_buffer, size_t request_size, size_t *write_size)
+{
+    return AAOS_ENOTSUP;
+}
+
+static void
+TCPSocket_shm_destroy(struct TCPSocketSHM *shm)
+{
+    free(shm);
+}
+
+int
+tcp_socket_shm_offer(void *_self, size_t ring_size, const void *buffer, size_t size)
+{
+    return AAOS_ENOTSUP;
+}
+
+int
+tcp_socket_shm_accept(void *_self, void *buffer, size_t size)
+{
+    struct TCPSocket *self = cast(TCPSocket(), _self);
+    
+    if (Readn(self->sockfd, buffer, size) <= 0) {
+        return AAOS_ECLOSED;
+    }
+    
+    return AAOS_ENOTSUP;
+}
+
+#endif
+
+bool
+tcp_socket_shm_enabled(const void *_self)
+{
+    const struct TCPSocket *self = cast(TCPSocket(), _self);
+    
+    return self->shm != NULL && self->shm->enabled;
+}
+
+/*
+ * Write iovcnt buffers with a single system call where possible.
+ */
+int
+tcp_socket_writev(void *_self, struct iovec *iov, int iovcnt, size_t *write_size)
+{
+    struct TCPSocket *self = cast(TCPSocket(), _self);
+    size_t nwritten = 0, n;
+    ssize_t s;
+    int i, ret = AAOS_OK;
+    
+    if (self->shm != NULL && self->shm->enabled) {
+        for (i = 0; i < iovcnt; i++) {
+            if (iov[i].iov_len == 0) {
+                continue;
+            }
+            n = 0;
+            ret = TCPSocket_shm_write(self, iov[i].iov_base, iov[i].iov_len, &n);
+            nwritten += n;
+            if (ret != AAOS_OK) {
+                break;
+            }
+        }
+        if (write_size != NULL) {
+            *write_size = nwritten;
+        }
+        return ret;
+    }
+    
+    if ((s = (self->deadline > 0.) ? TCPSocket_transfer(self, iov, iovcnt, true) : Writevn(self->sockfd, iov, iovcnt)) < 0) {
+        if (write_size != NULL) {
+            *write_size = 0;
+        }
+        switch (errno) {
+            case EINTR:
+                return AAOS_EINTR;
+            case ECONNRESET:
+                return AAOS_ECONNRESET;
+            case ENETDOWN:
+                return AAOS_ENETDOWN;
+            case ENETUNREACH:
+                return AAOS_ENETUNREACH;
+            case EPIPE:
+                return AAOS_EPIPE;
+            case ETIMEDOUT:
+                return AAOS_ETIMEDOUT;
+            default:
+                return AAOS_ERROR;
+        }
+    }
+    if (write_size != NULL) {
+        *write_size = (size_t) s;
+    }
+    
+    return AAOS_OK;
+}
+
+/*
+ * Hold back partial segments while cork is true, and push them out when it turns false.
+ * Only takes effect on TCP connections with TCPSOCKET_OPTION_CORK set.
+ */
+void
+tcp_socket_cork(void *_self, bool cork)
+{
+    struct TCPSocket *self = cast(TCPSocket(), _self);
+    int optval = cork ? 1 : 0;
+    
+    if (!(self->option & TCPSOCKET_OPTION_CORK) || (self->shm != NULL && self->shm->enabled)) {
+        return;
+    }
+#ifdef LINUX
+    setsockopt(self->sockfd, IPPROTO_TCP, TCP_CORK, &optval, sizeof(optval));
+#endif
+#ifdef MACOSX
+    setsockopt(self->sockfd, IPPROTO_TCP, TCP_NOPUSH, &optval, sizeof(optval));
+#endif
+}
+
 int
 tcp_socket_get_sockfd(const void *_self)
 {
@@ -379,6 +1008,13 @@ TCPSocket_set_option(void *_self, unsigned int option)
     if (!(old_option&TCPSOCKET_OPTION_NOBLOCKING) && (option&TCPSOCKET_OPTION_NOBLOCKING)) {
         Fcntl(self->sockfd, F_SETFL, O_NONBLOCK);
     }
+    if (!(old_option&TCPSOCKET_OPTION_NODELAY) && (option&TCPSOCKET_OPTION_NODELAY)) {
+        int optval = 1;
+        /*
+         * Fails harmlessly on Unix domain sockets.
+         */
+        setsockopt(self->sockfd, IPPROTO_TCP, TCP_NODELAY, &optval, sizeof(optval));
+    }
 
     return old_option;
 }
@@ -415,6 +1051,7 @@ TCPSocket_cctor(void *_self, const void *_from)
     self->_vtab = from->_vtab;
     self->sockfd = dup(from->sockfd);
     self->option = from->option;
+    self->shm = NULL;
     
     return self;
 }
@@ -429,7 +1066,9 @@ TCPSocket_mctor(void *_self, void *_from)
     self->option = from->option;
     self->sockfd = from->sockfd;
     self->timeout = from->timeout;
+    self->shm = from->shm;
     from->sockfd = -1;
+    from->shm = NULL;
     
     return self;
 }
@@ -451,6 +1090,9 @@ TCPSocket_dtor(void *_self)
 {
     struct TCPSocket *self = cast(TCPSocket(), _self);
     
+    if (self->shm != NULL) {
+        TCPSocket_shm_destroy(self->shm);
+    }
     if (self->sockfd >= 0) {
         Close(self->sockfd);
     }
@@ -1102,6 +1744,37 @@ TCPServer_set_option(const void *_self, unsigned int option)
     return AAOS_OK;
 }
 
+void
+tcp_server_set_threads(void *_self, size_t n_threads, size_t max_events)
+{
+    struct TCPServer *self = cast(TCPServer(), _self);
+    
+    if (n_threads > 0) {
+        self->n_threads = n_threads;
+    }
+    if (max_events > 0) {
+        self->max_events = max_events;
+    }
+}
+
+void
+tcp_server_set_timeout(void *_self, double timeout)
+{
+    struct TCPServer *self = cast(TCPServer(), _self);
+    
+    self->timeout = timeout;
+}
+
+void
+tcp_server_set_limits(void *_self, size_t max_connections, size_t max_per_peer, double idle_timeout)
+{
+    struct TCPServer *self = cast(TCPServer(), _self);
+    
+    self->max_connections = max_connections;
+    self->max_per_peer = max_per_peer;
+    self->idle_timeout = idle_timeout;
+}
+
 void
 tcp_server_start(void *_self)
 {
@@ -1175,6 +1848,7 @@ TCPServer_ctor(void *_self, va_list *app)
 {
     struct TCPServer *self = super_ctor(TCPServer(), _self, app);
     const char *s;
+    long n;
     
     s = va_arg(*app, const char *);
     self->port = (char *) Malloc(strlen(s) + 1);
@@ -1183,6 +1857,13 @@ TCPServer_ctor(void *_self, va_list *app)
     self->lfd2 = -1;
     
     self->option = TCPSERVER_OPTION_DEFAULT;
+    if ((n = sysconf(_SC_NPROCESSORS_ONLN)) > 0) {
+        self->n_threads = (size_t) n;
+    } else {
+        self->n_threads = 1;
+    }
+    self->max_events = TCPSERVER_MAX_EVENTS;
+    self->timeout = TCPSERVER_TIMEOUT;
     
     return (void *) self;
 }
@@ -11,9 +11,13 @@
 
 #include "object.h"
 #include "virtual.h"
+#include <stdbool.h>
+#include <sys/uio.h>
 
 #define TCPSOCKET_OPTION_DO_NOT_RESTART_ON_SIGNAL 0x01
 #define TCPSOCKET_OPTION_NOBLOCKING 0x02
+#define TCPSOCKET_OPTION_NODELAY 0x04
+#define TCPSOCKET_OPTION_CORK 0x08
 
 #define TCPSERVER_OPTION_BLOCK_PERTHREAD            0x0001
 #define TCPSERVER_OPTION_NONBLOCK_PERTHREAD         0x0002
@@ -23,6 +27,37 @@
 #define TCPSERVER_OPTION_TCP                        0x0100
 #define TCPSERVER_OPTION_UDS                        0x0200
 
+/*
+ * Socket policy of accepted TCP connections.
+ * NODELAY disables Nagle's algorithm, CORK lets batched replies (rpc_batch_begin) go out in full segments.
+ */
+#define TCPSERVER_OPTION_NODELAY                    0x0400
+#define TCPSERVER_OPTION_CORK                       0x0800
+
+/*
+ * Every event loop of NONBLOCK_PRETHEADED mode listens on a TCP socket of its own,
+ * bound to the same port with SO_REUSEPORT, so that the kernel spreads connections over the loops.
+ */
+#define TCPSERVER_OPTION_REUSEPORT                  0x1000
+
+#define TCPSERVER_OPTION_MODE_MASK                  0x00FF
+
+/*
+ * Threading of a server.
+ * BLOCK_PERTHREAD:     a detached thread with blocking reads for every connection.
+ * NONBLOCK_PERTHREAD:  a thread for every connection, which waits for requests with poll(2)
+ *                      and gives up on a peer stalled for timeout seconds in the middle of a packet or a reply.
+ * BLOCK_PRETHEADED:    n_threads workers with blocking reads, fed with connections through an accept queue
+ *                      of max_events entries; a worker serves one connection until it is closed.
+ * NONBLOCK_PRETHEADED: n_threads event loops (epoll or kqueue), each watching up to max_events connections.
+ * A mode set by tcp_server_set_option replaces the default BLOCK_PERTHREAD.
+ */
+#define TCPSERVER_MAX_EVENTS                        64
+#define TCPSERVER_TIMEOUT                           5.
+
+#define TCPSOCKET_SHM_RING_SIZE     (1 << 20)
+#define TCPSOCKET_SHM_RING_SIZE_MAX (1 << 26)
+
 #define TCPSERVER_OPTION_DEFAULT (TCPSERVER_OPTION_BLOCK_PERTHREAD | TCPSERVER_OPTION_TCP | TCPSERVER_OPTION_UDS)
 
 #ifdef __cpluspus
@@ -30,11 +65,34 @@ extern "C" {
 #endif
 
 int tcp_socket_get_sockfd(const void *_self);
+unsigned int tcp_socket_set_option(void *_self, unsigned int option);
 int tcp_socket_read(void *_self, void *read_buffer, size_t request_size, size_t *read_size);
 int tcp_socket_read_until(void *_self, void *read_buffer, size_t request_size, size_t *read_size, const char *delim);
 int tcp_socket_write(void *_self, const void *write_buffer, size_t request_size, size_t *write_size);
 int tcp_socket_read_nb(void *_self, void *read_buffer, size_t request_size, size_t *read_size);
 int tcp_socket_write_nb(void *_self, void *read_buffer, size_t request_size, size_t *read_size);
+int tcp_socket_writev(void *_self, struct iovec *iov, int iovcnt, size_t *write_size);
+void tcp_socket_cork(void *_self, bool cork);
+/*
+ * Bound tcp_socket_read, tcp_socket_write and tcp_socket_writev by deadline, in seconds of CLOCK_MONOTONIC.
+ * Once it has passed, they fail with AAOS_ETIMEDOUT, possibly after a part of the buffer has been transferred.
+ * A deadline of 0 lets them block as long as it takes.
+ */
+void tcp_socket_set_deadline(void *_self, double deadline);
+
+/*
+ * Shared-memory transport, for Unix domain socket connections on Linux.
+ * tcp_socket_shm_offer creates the shared memory and eventfds, sends them with the message in buffer to the peer,
+ * and switches the connection over to shared memory.
+ * tcp_socket_shm_accept reads a message of size bytes into buffer, and switches the connection over
+ * if the message carries the shared memory and eventfds; otherwise the connection is left as it is and
+ * AAOS_ENOTSUP is returned.
+ * Once switched, tcp_socket_read and tcp_socket_write go through the rings, the socket itself is only watched for hang-up.
+ * If the peer leaves the ring indices inconsistent, they return AAOS_EBADMSG, and the connection is shut down.
+ */
+int tcp_socket_shm_offer(void *_self, size_t ring_size, const void *buffer, size_t size);
+int tcp_socket_shm_accept(void *_self, void *buffer, size_t size);
+bool tcp_socket_shm_enabled(const void *_self);
 
 extern const void *TCPSocket(void);
 extern const void *TCPSocketClass(void);
@@ -55,6 +113,16 @@ int tcp_server_accept2(void *_self, void **client);
 void tcp_server_start(void *_self);
 void tcp_server_set_path(void *_self, const char *path);
 void tcp_server_set_addrss(void *_self, const char *address);
+void tcp_server_set_threads(void *_self, size_t n_threads, size_t max_events);
+void tcp_server_set_timeout(void *_self, double timeout);
+
+/*
+ * Limits of accepted connections, 0 for none.
+ * Connections over max_connections, or over max_per_peer from the same IP address, are closed at once,
+ * counted and logged by an RPC server, see rpc_server_get_stats;
+ * a connection which has sent no request for idle_timeout seconds is shut down, unless it has subscribed to events.
+ */
+void tcp_server_set_limits(void *_self, size_t max_connections, size_t max_per_peer, double idle_timeout);
 
 extern const void *TCPServer(void);
 extern const void *TCPServerClass(void);
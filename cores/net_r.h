@@ -11,6 +11,8 @@
 
 #include "object_r.h"
 #include "virtual_r.h"
+#include <stdbool.h>
+#include <stdint.h>
 
 //#define  _NET_PRIORITY_ _VIRTUAL_PRIORITY_ + 1
 
@@ -20,12 +22,48 @@ struct TCPSocketVirtualTable {
     struct Method write;
 };
 
+/*
+ * Shared-memory transport of a Unix domain socket connection.
+ * Each endpoint writes its own single-producer/single-consumer ring,
+ * and blocks on its own eventfd when the peer ring is empty or its own ring is full.
+ */
+
+#define TCPSOCKET_SHM_MAGIC 0x41414F53
+
+struct TCPSocketSHMRing {
+    uint64_t head;          /* written by the producer */
+    char pad0[56];
+    uint64_t tail;          /* written by the consumer */
+    char pad1[56];
+};
+
+struct TCPSocketSHMHeader {
+    uint32_t magic;
+    uint32_t ring_size;     /* power of two */
+    char pad0[56];
+    uint32_t waiting[2];    /* endpoint is about to block on its eventfd */
+    char pad1[56];
+    struct TCPSocketSHMRing ring[2];    /* ring[i] is written by endpoint i */
+};
+
+struct TCPSocketSHM {
+    struct TCPSocketSHMHeader *header;
+    size_t length;
+    size_t ring_size;       /* private copy, the shared one is not trusted after the handshake */
+    int endpoint;           /* 0 for the client, 1 for the server */
+    bool enabled;
+    char *data[2];
+    int efd[2];
+};
+
 struct TCPSocket {
     struct Object _;
     const void *_vtab;
     int sockfd;
     unsigned int option;
     double timeout;
+    double deadline;
+    struct TCPSocketSHM *shm;
 };
 
 struct TCPSocketClass {
@@ -76,6 +114,9 @@ struct TCPServer {
     size_t max_events;
     unsigned int option; /* for future use */
     double timeout;
+    size_t max_connections;
+    size_t max_per_peer;
+    double idle_timeout;
 };
 
 struct TCPServerClass {
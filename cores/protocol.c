@@ -11,6 +11,118 @@
 #include "protocol.h"
 #include "wrapper.h"
 
+/*
+ * Slab pools of packet buffers.
+ */
+
+static pthread_mutex_t protobuf_pool_mtx = PTHREAD_MUTEX_INITIALIZER;
+static void *protobuf_pool_free[PROTOBUF_SLAB_N_CLASS];
+static size_t protobuf_pool_n_free[PROTOBUF_SLAB_N_CLASS];
+static size_t protobuf_max_packet = PROTOBUF_PACKET_SIZE_MAX;
+static double protobuf_idle_timeout = PROTOBUF_IDLE_TIMEOUT;
+
+void
+protobuf_pool_configure(size_t max_packet, double idle_timeout)
+{
+    Pthread_mutex_lock(&protobuf_pool_mtx);
+    if (max_packet > 0) {
+        protobuf_max_packet = max_packet;
+    }
+    if (idle_timeout >= 0.) {
+        protobuf_idle_timeout = idle_timeout;
+    }
+    Pthread_mutex_unlock(&protobuf_pool_mtx);
+}
+
+size_t
+protobuf_get_max_packet(void)
+{
+    size_t max_packet;
+    
+    Pthread_mutex_lock(&protobuf_pool_mtx);
+    max_packet = protobuf_max_packet;
+    Pthread_mutex_unlock(&protobuf_pool_mtx);
+    
+    return max_packet;
+}
+
+/*
+ * Size of the buffer holding size bytes, header included.
+ */
+static size_t
+ProtoBuf_slab_size(size_t size, int *i)
+{
+    size_t slab = PROTOBUF_SLAB_MIN;
+    
+    for (*i = 0; *i < PROTOBUF_SLAB_N_CLASS; (*i)++, slab <<= 2) {
+        if (size <= slab) {
+            return slab;
+        }
+    }
+    
+    return size;
+}
+
+static struct Packet *
+ProtoBuf_slab_get(size_t size)
+{
+    void *buf = NULL;
+    int i;
+    
+    size = ProtoBuf_slab_size(size, &i);
+    if (i < PROTOBUF_SLAB_N_CLASS) {
+        Pthread_mutex_lock(&protobuf_pool_mtx);
+        if ((buf = protobuf_pool_free[i]) != NULL) {
+            protobuf_pool_free[i] = *(void **) buf;
+            protobuf_pool_n_free[i]--;
+        }
+        Pthread_mutex_unlock(&protobuf_pool_mtx);
+    }
+    if (buf == NULL) {
+        buf = Malloc(size);
+    }
+    
+    return (struct Packet *) buf;
+}
+
+static void
+ProtoBuf_slab_put(struct Packet *packet, size_t size)
+{
+    int i;
+    
+    size = ProtoBuf_slab_size(size, &i);
+    if (i < PROTOBUF_SLAB_N_CLASS) {
+        Pthread_mutex_lock(&protobuf_pool_mtx);
+        if ((protobuf_pool_n_free[i] + 1) * size <= PROTOBUF_SLAB_CACHE) {
+            *(void **) packet = protobuf_pool_free[i];
+            protobuf_pool_free[i] = packet;
+            protobuf_pool_n_free[i]++;
+            packet = NULL;
+        }
+        Pthread_mutex_unlock(&protobuf_pool_mtx);
+    }
+    free(packet);
+}
+
+/*
+ * Allocate the buffer for a payload of at least size bytes.
+ */
+static int
+ProtoBuf_allocate(struct ProtoBuf *self, size_t size)
+{
+    struct Packet *packet;
+    int i;
+    
+    size = ProtoBuf_slab_size(size + sizeof(struct Packet), &i);
+    if ((packet = ProtoBuf_slab_get(size)) == NULL) {
+        return AAOS_ENOMEM;
+    }
+    self->packet = packet;
+    self->packet_size = size - sizeof(struct Packet);
+    
+    return AAOS_OK;
+}
+
 void
 protobuf_set(void *_self, unsigned int field, ...)
 {
@@ -157,7 +269,7 @@ ProtoBuf_set(void *_self, unsigned int field, va_list *app)
             uint64_t value = va_arg(*app, uint64_t);
             self->packet->carrier.uint64_2.field1 = value;
         }
-            
+            break;
         case PACKET_FF0:
         {
             double value = va_arg(*app, double);
@@ -209,8 +321,8 @@ ProtoBuf_set(void *_self, unsigned int field, va_list *app)
             const void *value = va_arg(*app, const void *);
             size_t size = va_arg(*app, size_t);
             if (self->packet->buf != value) {
-                if (self->packet_size < size) {
-                    protobuf_reallocate(self, size);
+                if (self->packet_size < size && protobuf_reallocate(self, size) != AAOS_OK) {
+                    return;
                 }
             
                 memcpy(self->packet->buf, value, size);
@@ -372,18 +484,71 @@ ProtoBuf_reallocate(void *_self, size_t size)
 {
     struct ProtoBuf *self = cast(ProtoBuf(), _self);
     
-    void *packet;
+    struct Packet *packet;
+    size_t old_size = self->packet_size + sizeof(struct Packet);
+    int i;
     
-    packet = Realloc(self->packet, size + sizeof(struct Packet));
-    if (!packet) {
-        return AAOS_ENOMEM;
+    size = ProtoBuf_slab_size(size + sizeof(struct Packet), &i);
+    if (size == old_size) {
+        return AAOS_OK;
+    }
+    if (size > PROTOBUF_SLAB_MAX && old_size > PROTOBUF_SLAB_MAX) {
+        if ((packet = (struct Packet *) Realloc(self->packet, size)) == NULL) {
+            return AAOS_ENOMEM;
+        }
+    } else {
+        if ((packet = ProtoBuf_slab_get(size)) == NULL) {
+            return AAOS_ENOMEM;
+        }
+        memcpy(packet, self->packet, size < old_size ? size : old_size);
+        ProtoBuf_slab_put(self->packet, old_size);
     }
     self->packet = packet;
-    self->packet_size = size;
+    self->packet_size = size - sizeof(struct Packet);
+    
+    return AAOS_OK;
+}
+
+int
+protobuf_reserve(void *_self, size_t size)
+{
+    struct ProtoBuf *self = cast(ProtoBuf(), _self);
+    int ret;
+    
+    if (self->packet_size < size && (ret = protobuf_reallocate(self, size)) != AAOS_OK) {
+        return ret;
+    }
+    if (self->reserved < size) {
+        self->reserved = size;
+    }
     
     return AAOS_OK;
 }
 
+void
+protobuf_trim(void *_self, size_t used)
+{
+    struct ProtoBuf *self = cast(ProtoBuf(), _self);
+    struct timespec tp;
+    double now;
+    
+    if (self->packet_size <= self->reserved) {
+        return;
+    }
+    if (self->packet_size + sizeof(struct Packet) > PROTOBUF_SLAB_MAX) {
+        protobuf_reallocate(self, self->reserved);
+        return;
+    }
+    
+    Clock_gettime(CLOCK_MONOTONIC, &tp);
+    now = tp.tv_sec + tp.tv_nsec / 1000000000.;
+    if (used > self->reserved) {
+        self->last_large = now;
+    } else if (now - self->last_large >= protobuf_idle_timeout) {
+        protobuf_reallocate(self, self->reserved);
+    }
+}
+
 size_t
 protobuf_payload(const void *_self)
 {
@@ -438,9 +603,11 @@ ProtoBuf_cctor(void *_self, const void *_from)
     struct ProtoBuf *self = super_cctor(ProtoBuf(), _self);
     struct ProtoBuf *from = cast(ProtoBuf(), _from);
     
-    self->packet_size = from->packet_size;
-    self->packet = (struct Packet *) Malloc(sizeof(struct Packet) + self->packet_size);
-    memcpy(self->packet, from->packet, self->packet_size);
+    if (ProtoBuf_allocate(self, from->packet_size) != AAOS_OK) {
+        return NULL;
+    }
+    memcpy(self->packet, from->packet, sizeof(struct Packet) + from->packet_size);
+    self->reserved = from->reserved;
     
     return (void *) self;
 }
@@ -453,13 +620,14 @@ ProtoBuf_ctor(void *_self, va_list *app)
     size_t size = va_arg(*app, size_t);
     
     if (size == 0) {
-        self->packet_size = DEFAULTPACKETSIZE;
-    } else {
-        self->packet_size = size;
+        size = DEFAULTPACKETSIZE;
     }
     
-    self->packet = (struct Packet *) Malloc(sizeof(struct Packet) + self->packet_size);
+    if (ProtoBuf_allocate(self, size) != AAOS_OK) {
+        return NULL;
+    }
     memset(self->packet, '\0', sizeof(struct Packet) + self->packet_size);
+    self->reserved = size;
     
     return (void *) self;
 }
@@ -469,7 +637,7 @@ ProtoBuf_dtor(void *_self)
 {
     struct ProtoBuf *self = cast(ProtoBuf(), _self);
     
-    free(self->packet);
+    ProtoBuf_slab_put(self->packet, sizeof(struct Packet) + self->packet_size);
     
     return super_dtor(ProtoBuf(), _self);
 }
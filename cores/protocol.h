@@ -45,6 +45,9 @@
 #define PACKETHEADERSIZE 32
 #define PACKETPARAMETERSIZE 16
 
+#define PROTOBUF_PACKET_SIZE_MAX    67108864
+#define PROTOBUF_IDLE_TIMEOUT       10.
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -55,6 +58,21 @@ int protobuf_reallocate(void *_self, size_t size);
 size_t protobuf_payload(const void *_self);
 void *protobuf_header(const void *_self);
 
+/*
+ * Buffer reuse.
+ * Packet buffers come from size-classed slab pools shared by the process.
+ * A server refuses a request of more than max_packet bytes of payload with AAOS_ENOMEM,
+ * replies and packets read by a client are not limited.
+ * protobuf_reserve grows the buffer and keeps it at least size bytes from then on.
+ * protobuf_trim is called once a request is done, with the largest payload it used;
+ * a buffer grown beyond the reserved size goes back to the pool after it has not been
+ * needed for idle_timeout seconds, or at once if it is larger than the slab classes.
+ */
+void protobuf_pool_configure(size_t max_packet, double idle_timeout);
+size_t protobuf_get_max_packet(void);
+int protobuf_reserve(void *_self, size_t size);
+void protobuf_trim(void *_self, size_t used);
+
 extern const void *ProtoBuf(void);
 extern const void *ProtoBufClass(void);
 #ifdef __cplusplus
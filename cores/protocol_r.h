@@ -10,11 +10,22 @@
 #define protocol_r_h
 
 #include <stdint.h>
+#include <string.h>
 #include "object_r.h"
 
 #define CARRIERSIZE 16
 #define DEFAULTPACKETSIZE 992
 
+/*
+ * Packet buffers of up to PROTOBUF_SLAB_MAX bytes, header included, are taken from
+ * size classes of PROTOBUF_SLAB_MIN << (2 * i) bytes, and each class keeps at most
+ * PROTOBUF_SLAB_CACHE bytes of released buffers for reuse.
+ */
+#define PROTOBUF_SLAB_MIN       1024
+#define PROTOBUF_SLAB_N_CLASS   6
+#define PROTOBUF_SLAB_MAX       (PROTOBUF_SLAB_MIN << (2 * (PROTOBUF_SLAB_N_CLASS - 1)))
+#define PROTOBUF_SLAB_CACHE     (4 * 1048576)
+
 #define _PROTOCOL_PRIORITY_ 102
 
 struct Packet {
@@ -57,6 +68,14 @@ struct Packet {
             double field1;
         } double_2;
         char string_1[CARRIERSIZE];
+        /*
+         * Indexed views of the same bytes, for the typed accessors.
+         */
+        uint16_t u16[8];
+        uint32_t u32[4];
+        uint64_t u64[2];
+        float ff[4];
+        double df[2];
     } carrier;
     char buf[];
 };
@@ -69,6 +88,8 @@ struct ProtoBuf {
     struct Object _;
     struct Packet *packet;
     size_t packet_size;
+    size_t reserved;        /* protobuf_trim does not shrink below it */
+    double last_large;      /* when a payload larger than reserved was last used */
 };
 
 struct ProtoBufClass {
@@ -80,4 +101,42 @@ struct ProtoBufClass {
     struct Method header;
 };
 
+/*
+ * Typed fast path.
+ * The fields of the packet are read and written directly, without the variadic dispatch of
+ * protobuf_get and protobuf_set, e.g., packet->command, packet->carrier.u32[0], packet->carrier.df[1].
+ * The packet moves when its payload is reallocated, so fetch it again after protobuf_reallocate,
+ * or protobuf_set with PACKET_BUF.
+ */
+static inline struct Packet *
+protobuf_packet(const void *_self)
+{
+    return ((const struct ProtoBuf *) _self)->packet;
+}
+
+/*
+ * Copy the header in one go, e.g., to keep the request while the reply is written into the packet.
+ */
+static inline void
+packet_decode(const struct Packet *packet, struct Packet *header)
+{
+    memcpy(header, packet, sizeof(struct Packet));
+}
+
+/*
+ * The name carried by a request, in the carrier if there is no payload, otherwise in the payload.
+ */
+static inline char *
+packet_string(struct Packet *packet)
+{
+    return packet->length == 0 ? packet->carrier.string_1 : packet->buf;
+}
+
+static inline void
+packet_reply(struct Packet *packet, uint16_t errorcode, uint32_t length)
+{
+    packet->errorcode = errorcode;
+    packet->length = length;
+}
+
 #endif /* protocol_r_h */
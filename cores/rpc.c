@@ -6,6 +6,9 @@
 //  Copyright © 2018年 National Astronomical Observatories, Chinese Academy of Sciences. All rights reserved.
 //
 
+#include <fnmatch.h>
+#include <syslog.h>
+
 #include "def.h"
 #include "rpc_r.h"
 #include "rpc.h"
@@ -102,6 +105,62 @@ RPCVirtualTable_ctor(void *_self, va_list *app)
             self->reg.method = method;
             continue;
         }
+        if (selector == (Method) rpc_pipeline) {
+            if (tag) {
+                self->pipeline.tag = tag;
+                self->pipeline.selector = selector;
+            }
+            self->pipeline.method = method;
+            continue;
+        }
+        if (selector == (Method) rpc_call_async) {
+            if (tag) {
+                self->call_async.tag = tag;
+                self->call_async.selector = selector;
+            }
+            self->call_async.method = method;
+            continue;
+        }
+        if (selector == (Method) rpc_wait) {
+            if (tag) {
+                self->wait.tag = tag;
+                self->wait.selector = selector;
+            }
+            self->wait.method = method;
+            continue;
+        }
+        if (selector == (Method) rpc_shm) {
+            if (tag) {
+                self->shm.tag = tag;
+                self->shm.selector = selector;
+            }
+            self->shm.method = method;
+            continue;
+        }
+        if (selector == (Method) rpc_batch_begin) {
+            if (tag) {
+                self->batch_begin.tag = tag;
+                self->batch_begin.selector = selector;
+            }
+            self->batch_begin.method = method;
+            continue;
+        }
+        if (selector == (Method) rpc_batch_end) {
+            if (tag) {
+                self->batch_end.tag = tag;
+                self->batch_end.selector = selector;
+            }
+            self->batch_end.method = method;
+            continue;
+        }
+        if (selector == (Method) rpc_abort) {
+            if (tag) {
+                self->abort.tag = tag;
+                self->abort.selector = selector;
+            }
+            self->abort.method = method;
+            continue;
+        }
     }
     
     return _self;
@@ -163,279 +222,1523 @@ rpc_process(void *_self)
 }
 
 /*
- * return AAOS_OK if there is no networking problem.
- * if properly set errorcode according to rpc_execute return value.
- * positive return value means error happen when excecuting rpc_execute
- * negative return value means networking error.
+ * Pipelined connection.
  */
 
-static int
-RPC_process(void *_self)
+static struct RPCPipeline *
+RPCPipeline_new(void)
 {
-    struct RPC *self = cast(RPC(), _self);
-    uint32_t length;
-    int ret;
-    size_t payload;
-    void *buf, *header;
+    struct RPCPipeline *pipeline = (struct RPCPipeline *) Malloc(sizeof(struct RPCPipeline));
     
-    /*
-     * Read header.
-     */
-    header = protobuf_header(self);
-    if ((ret = tcp_socket_read(self, header, PACKETHEADERSIZE, NULL)) != AAOS_OK) {
-        return -1 * ret;
-    }
+    Pthread_mutex_init(&pipeline->mtx, NULL);
+    Pthread_cond_init(&pipeline->cond, NULL);
+    pipeline->refcount = 1;
+    pipeline->next_id = 0;
+    pipeline->pending = NULL;
+    pipeline->in_flight = 0;
+    pipeline->last_reply = 0.;
+    pipeline->sockfd = -1;
     
-    protobuf_get(self, PACKET_LENGTH, &length);
+    return pipeline;
+}
 
-    /*
-     * if any payload, read it.
-     */
-   
-    if (length != 0) {
-        payload = protobuf_payload(self);
-        if (payload < length) {
-            if ((ret = protobuf_reallocate(self, payload)) != AAOS_OK) {
-                protobuf_set(self, PACKET_LENGTH, 0);
-                protobuf_set(self, PACKET_ERRORCODE, AAOS_ENOMEM);
-                tcp_socket_write(self, header, PACKETHEADERSIZE, NULL);
-                return ret;
-            }
-            header = protobuf_header(self);
-        }
-        protobuf_get(self, PACKET_BUF, &buf, NULL);
-        if ((ret = tcp_socket_read(self, buf, (size_t) length, NULL)) != AAOS_OK) {
-            return ret;
-        }
-    }
+static struct RPCPipeline *
+RPCPipeline_retain(struct RPCPipeline *pipeline)
+{
+    __atomic_add_fetch(&pipeline->refcount, 1, __ATOMIC_RELAXED);
     
-    /*
-     * call virtual execute function.
-     * if rpc_execute failed, tell the RPC caller executing error, return AAOS_OK;
-     */
-    uint16_t cmd;
-    protobuf_get(self, PACKET_COMMAND, &cmd);
+    return pipeline;
+}
 
-    if ((ret = rpc_execute(self)) != AAOS_OK) {
-        if (ret < 0) {
-            ret = -1 * ret;
+static void
+RPCPipeline_release(struct RPCPipeline *pipeline)
+{
+    struct RPCPending *pending;
+    struct RPCReply *reply;
+    
+    if (__atomic_sub_fetch(&pipeline->refcount, 1, __ATOMIC_ACQ_REL) != 0) {
+        return;
+    }
+    while ((pending = pipeline->pending) != NULL) {
+        pipeline->pending = pending->next;
+        while ((reply = pending->reply) != NULL) {
+            pending->reply = reply->next;
+            free(reply);
         }
-        uint16_t errorcode = (uint16_t) ret;
-        protobuf_set(self, PACKET_ERRORCODE, errorcode);
-        protobuf_set(self, PACKET_LENGTH, 0);
-        tcp_socket_write(self, header, PACKETHEADERSIZE, NULL);
-        return AAOS_OK;
+        free(pending);
     }
-    /*
-     * return result to the caller
-     */
-    protobuf_set(self, PACKET_ERRORCODE, AAOS_OK);
-    header = protobuf_header(self);
-    protobuf_get(self, PACKET_LENGTH, &length);
-    if ((ret = tcp_socket_write(self, header, (size_t) length + PACKETHEADERSIZE, NULL)) != AAOS_OK) {
-        return -1 * ret;
+    if (pipeline->sockfd >= 0) {
+        Close(pipeline->sockfd);
     }
+    Pthread_cond_destroy(&pipeline->cond);
+    Pthread_mutex_destroy(&pipeline->mtx);
+    free(pipeline);
+}
 
-    return ret;
+/*
+ * Mark the connection active now and no longer busy, the reaper reads both without the thread of the connection.
+ */
+static void
+RPCConnection_touch(struct RPCConnection *connection)
+{
+    struct timespec tp;
+    double now;
+    
+    Clock_gettime(CLOCK_MONOTONIC, &tp);
+    now = tp.tv_sec + tp.tv_nsec / 1000000000.;
+    __atomic_store(&connection->last_active, &now, __ATOMIC_RELAXED);
+    __atomic_store_n(&connection->busy, false, __ATOMIC_RELEASE);
 }
 
-int
-rpc_execute(void *_self)
+/*
+ * Event subscription, server side.
+ * rpc_event_mtx guards the list of subscribers, their subscriptions and event queues.
+ */
+
+static pthread_mutex_t rpc_event_mtx = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t rpc_event_cond = PTHREAD_COND_INITIALIZER;
+static struct RPCSubscriber *rpc_subscribers;
+static unsigned int rpc_n_subscriber;
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+static int RPC_write_packet(struct RPC *self, const void *packet, size_t length);
+
+static void
+RPCSubscriber_clear(struct RPCSubscriber *subscriber)
 {
-    struct RPCClass *class = (struct RPCClass *) classOf(_self);
+    struct RPCEvent *event;
     
-    if (isOf(class, RPCClass()) && class->execute.method) {
-        return ((int (*)(void *)) class->execute.method)(_self);
-    } else {
-        int result;
-        forward(_self, &result, (Method) rpc_execute, "execute", _self);
-        return result;
+    while ((event = subscriber->head) != NULL) {
+        subscriber->head = event->next;
+        free(event);
     }
+    subscriber->tail = NULL;
+    subscriber->n_event = 0;
 }
 
-static int
-RPC_execute(void *_self)
+/*
+ * Send the events queued for subscribers, without blocking on any of them.
+ */
+static void *
+RPC_event_thr(void *arg)
 {
-    char *s;
-    size_t size;
-    protobuf_get(_self, PACKET_BUF, &s, &size);
-    printf("%s\n", s);
-    char c = s[0];
-    memset(s, c, size - 1);
+    struct RPCSubscriber *subscriber;
+    struct RPCEvent *event;
+    struct timespec tp;
+    bool pending;
+    ssize_t n;
     
-    return AAOS_OK;
+    Pthread_detach(pthread_self());
+    
+    Pthread_mutex_lock(&rpc_event_mtx);
+    for (;;) {
+        pending = false;
+        for (subscriber = rpc_subscribers; subscriber != NULL; subscriber = subscriber->next) {
+            if (subscriber->head == NULL || subscriber->closed) {
+                continue;
+            }
+            if (pthread_mutex_trylock(&subscriber->mtx) != 0) {
+                pending = true;
+                continue;
+            }
+            while ((event = subscriber->head) != NULL) {
+                n = send(subscriber->sockfd, event->packet + event->offset, event->length - event->offset, MSG_DONTWAIT | MSG_NOSIGNAL);
+                if (n < 0) {
+                    if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+                        pending = true;
+                    } else {
+                        subscriber->closed = true;
+                        RPCSubscriber_clear(subscriber);
+                    }
+                    break;
+                }
+                event->offset += n;
+                if (event->offset < event->length) {
+                    pending = true;
+                    break;
+                }
+                if ((subscriber->head = event->next) == NULL) {
+                    subscriber->tail = NULL;
+                }
+                subscriber->n_event--;
+                free(event);
+            }
+            Pthread_mutex_unlock(&subscriber->mtx);
+        }
+        if (pending) {
+            Clock_gettime(CLOCK_REALTIME, &tp);
+            tp.tv_nsec += 10000000;
+            if (tp.tv_nsec >= 1000000000) {
+                tp.tv_sec++;
+                tp.tv_nsec -= 1000000000;
+            }
+            pthread_cond_timedwait(&rpc_event_cond, &rpc_event_mtx, &tp);
+        } else {
+            Pthread_cond_wait(&rpc_event_cond, &rpc_event_mtx);
+        }
+    }
+    Pthread_mutex_unlock(&rpc_event_mtx);
+    
+    return NULL;
 }
 
-int
-rpc_read(void *_self)
+static void
+RPC_event_initialize(void)
 {
-    struct RPCClass *class = (struct RPCClass *) classOf(_self);
+    pthread_t tid;
     
-    if (isOf(class, RPCClass()) && class->read.method) {
-        return ((int (*)(void *)) class->read.method)(_self);
-    } else {
-        int result;
-        forward(_self, &result, (Method) rpc_read, "read", _self);
-        return result;
-    }
+    Pthread_create(&tid, NULL, RPC_event_thr, NULL);
 }
 
-static int
-RPC_read(void *_self)
+/*
+ * Send the rest of an event the push thread has started,
+ * called with the mutex of the subscriber held before the connection writes a packet of its own.
+ */
+static void
+RPCSubscriber_finish(struct RPCSubscriber *subscriber)
 {
-    struct RPC *self = cast(RPC(), _self);
+    struct RPCEvent *event;
     
-    void *protobuf = self->protobuf, *header, *buf;
-    int ret;
-    uint32_t length;
-    size_t payload;
-    uint16_t errorcode;
+    Pthread_mutex_lock(&rpc_event_mtx);
+    event = subscriber->head;
+    Pthread_mutex_unlock(&rpc_event_mtx);
+    if (event == NULL || event->offset == 0) {
+        return;
+    }
     
-    header = protobuf_header(protobuf);
-    if ((ret = tcp_socket_read(self, header, PACKETHEADERSIZE, NULL)) != AAOS_OK) {
-        return -1 * ret;
+    /*
+     * The event being sent is never dropped, so it can be written outside rpc_event_mtx.
+     */
+    if (Writen(subscriber->sockfd, event->packet + event->offset, event->length - event->offset) < 0) {
+        Pthread_mutex_lock(&rpc_event_mtx);
+        subscriber->closed = true;
+        RPCSubscriber_clear(subscriber);
+        Pthread_mutex_unlock(&rpc_event_mtx);
+        return;
     }
-    protobuf_get(self, PACKET_LENGTH, &length);
-    if (length == 0) {
-        return ret;
+    Pthread_mutex_lock(&rpc_event_mtx);
+    if ((subscriber->head = event->next) == NULL) {
+        subscriber->tail = NULL;
     }
-    payload = protobuf_payload(protobuf);
-    if (payload < length) {
-        if ((ret = protobuf_reallocate(self, (size_t) length)) != AAOS_OK) {
-            return ret;
+    subscriber->n_event--;
+    Pthread_mutex_unlock(&rpc_event_mtx);
+    free(event);
+}
+
+static void
+RPCSubscriber_release(struct RPCSubscriber *subscriber)
+{
+    struct RPCSubscriber **p;
+    struct RPCSubscription *subscription;
+    
+    Pthread_mutex_lock(&rpc_event_mtx);
+    for (p = &rpc_subscribers; *p != NULL; p = &(*p)->next) {
+        if (*p == subscriber) {
+            *p = subscriber->next;
+            __atomic_sub_fetch(&rpc_n_subscriber, 1, __ATOMIC_RELAXED);
+            break;
         }
     }
-    protobuf_get(protobuf, PACKET_BUF, &buf, NULL);
-    if ((ret = tcp_socket_read(self, buf, (size_t) length, NULL)) != AAOS_OK) {
-        return -1 * ret;
+    RPCSubscriber_clear(subscriber);
+    Pthread_mutex_unlock(&rpc_event_mtx);
+    
+    while ((subscription = subscriber->subscriptions) != NULL) {
+        subscriber->subscriptions = subscription->next;
+        free(subscription->pattern);
+        free(subscription);
     }
-    protobuf_get(self, PACKET_ERRORCODE, &errorcode);
-
-    return errorcode;
+    Pthread_mutex_destroy(&subscriber->mtx);
+    free(subscriber);
 }
 
-int
-rpc_write(void *_self)
+/*
+ * Add or remove a subscription of the connection, and acknowledge it.
+ */
+static int
+RPC_process_subscription(struct RPC *self, struct Packet *packet)
 {
-    struct RPCClass *class = (struct RPCClass *) classOf(_self);
-    
-    if (isOf(class, RPCClass()) && class->write.method) {
-        return ((int (*)(void *)) class->write.method)(_self);
-    } else {
-        int result;
-        forward(_self, &result, (Method) rpc_write, "write", _self);
-        return result;
+    static pthread_once_t once = PTHREAD_ONCE_INIT;
+    struct RPCSubscription *subscription, **p;
+    uint16_t command = packet->command;
+    uint16_t errorcode = AAOS_OK;
+    char *pattern;
+    
+    if ((pattern = strdup(packet_string(packet))) == NULL) {
+        errorcode = AAOS_ENOMEM;
+    } else if (self->pipeline != NULL || tcp_socket_shm_enabled(self)) {
+        errorcode = AAOS_ENOTSUP;
+    } else if (command == SYSTEM_COMMAND_SUBSCRIBE) {
+        subscription = (struct RPCSubscription *) Malloc(sizeof(struct RPCSubscription));
+        subscription->pattern = pattern;
+        pattern = NULL;
+        if (self->subscriber == NULL) {
+            self->subscriber = (struct RPCSubscriber *) calloc(1, sizeof(struct RPCSubscriber));
+            self->subscriber->sockfd = tcp_socket_get_sockfd(self);
+            Pthread_mutex_init(&self->subscriber->mtx, NULL);
+            Pthread_once(&once, RPC_event_initialize);
+            Pthread_mutex_lock(&rpc_event_mtx);
+            self->subscriber->next = rpc_subscribers;
+            rpc_subscribers = self->subscriber;
+            __atomic_add_fetch(&rpc_n_subscriber, 1, __ATOMIC_RELAXED);
+            Pthread_mutex_unlock(&rpc_event_mtx);
+        }
+        Pthread_mutex_lock(&rpc_event_mtx);
+        subscription->next = self->subscriber->subscriptions;
+        self->subscriber->subscriptions = subscription;
+        Pthread_mutex_unlock(&rpc_event_mtx);
+    } else if (self->subscriber != NULL) {
+        Pthread_mutex_lock(&rpc_event_mtx);
+        p = &self->subscriber->subscriptions;
+        while ((subscription = *p) != NULL) {
+            if (pattern[0] == '\0' || strcmp(subscription->pattern, pattern) == 0) {
+                *p = subscription->next;
+                free(subscription->pattern);
+                free(subscription);
+            } else {
+                p = &subscription->next;
+            }
+        }
+        Pthread_mutex_unlock(&rpc_event_mtx);
     }
+    free(pattern);
+    
+    packet_reply(packet, errorcode, 0);
+    
+    return RPC_write_packet(self, packet, PACKETHEADERSIZE);
 }
 
+/*
+ * Send the pending bytes of the batch, followed by length bytes of packet,
+ * and the request ID of the packet if the connection is pipelined, in a single write.
+ */
 static int
-RPC_write(void *_self)
+RPC_write_iov(struct RPC *self, const void *packet, size_t length)
 {
-    struct RPC *self = cast(RPC(), _self);
+    struct RPCPipelineHeader prefix;
+    struct iovec iov[3];
+    int iovcnt = 0, ret;
     
-    void *protobuf = self->protobuf, *header;
-    int ret;
-    uint32_t length;
-
-    header = protobuf_header(protobuf);
-    protobuf_get(self, PACKET_LENGTH, &length);
-    if ((ret = tcp_socket_write(self, header, (size_t) length + PACKETHEADERSIZE, NULL)) != AAOS_OK) {
-        return -1 * ret;
+    if (self->batch.length > 0) {
+        iov[iovcnt].iov_base = self->batch.buf;
+        iov[iovcnt].iov_len = self->batch.length;
+        iovcnt++;
+    }
+    if (packet != NULL) {
+        if (self->pipeline != NULL) {
+            prefix.id = self->request_id;
+            prefix.reserved = 0;
+            iov[iovcnt].iov_base = &prefix;
+            iov[iovcnt].iov_len = sizeof(prefix);
+            iovcnt++;
+        }
+        iov[iovcnt].iov_base = (void *) packet;
+        iov[iovcnt].iov_len = length;
+        iovcnt++;
+    }
+    if (iovcnt == 0) {
+        return AAOS_OK;
     }
     
-    return AAOS_OK;
+    if (self->pipeline != NULL) {
+        Pthread_mutex_lock(&self->pipeline->mtx);
+        ret = tcp_socket_writev(self, iov, iovcnt, NULL);
+        Pthread_mutex_unlock(&self->pipeline->mtx);
+    } else if (self->subscriber != NULL) {
+        Pthread_mutex_lock(&self->subscriber->mtx);
+        RPCSubscriber_finish(self->subscriber);
+        ret = tcp_socket_writev(self, iov, iovcnt, NULL);
+        Pthread_mutex_unlock(&self->subscriber->mtx);
+    } else {
+        ret = tcp_socket_writev(self, iov, iovcnt, NULL);
+    }
+    self->batch.length = 0;
+    
+    return ret;
 }
 
-int
-rpc_call(void *_self)
+/*
+ * Write a packet of length bytes, header included,
+ * prefixed by the request ID if the connection is pipelined.
+ * Inside a batch, the packet is only queued if it fits.
+ */
+static int
+RPC_write_packet(struct RPC *self, const void *packet, size_t length)
 {
-    struct RPCClass *class = (struct RPCClass *) classOf(_self);
+    struct RPCPipelineHeader prefix;
+    size_t size = length;
     
-    if (isOf(class, RPCClass()) && class->call.method) {
-        return ((int (*)(void *)) class->call.method)(_self);
-    } else {
-        int result;
-        forward(_self, &result, (Method) rpc_call, "call", _self);
-        return result;
+    if (self->batch.depth > 0) {
+        if (self->pipeline != NULL) {
+            size += sizeof(prefix);
+        }
+        if (self->batch.length + size <= RPC_BATCH_SIZE) {
+            if (self->batch.buf == NULL) {
+                self->batch.buf = (char *) Malloc(RPC_BATCH_SIZE);
+            }
+            if (self->pipeline != NULL) {
+                prefix.id = self->request_id;
+                prefix.reserved = 0;
+                memcpy(self->batch.buf + self->batch.length, &prefix, sizeof(prefix));
+                self->batch.length += sizeof(prefix);
+            }
+            memcpy(self->batch.buf + self->batch.length, packet, length);
+            self->batch.length += length;
+            return AAOS_OK;
+        }
     }
+    
+    return RPC_write_iov(self, packet, length);
 }
 
 /*
- * return a negtive error means a local error, otherwise, remote error.
- * a return value of AAOS_EMOREPACKET means the caller should issue calls
- * until the return value is other than AAOS_EMOREPACKET.
+ * Read a packet into the protobuf, and the request ID if the connection is pipelined.
+ * Returns a negative number on a network failure.
  */
 static int
-RPC_call(void *_self)
+RPC_read_packet(struct RPC *self, uint32_t *id)
 {
-    struct RPC *self = cast(RPC(), _self);
-    
+    struct RPCPipelineHeader prefix;
     uint32_t length;
-    uint16_t option;
     int ret;
-    size_t payload;
     void *buf, *header;
     
-    /*
+    if (self->pipeline != NULL) {
+        if ((ret = tcp_socket_read(self, &prefix, sizeof(prefix), NULL)) != AAOS_OK) {
+            return -1 * ret;
+        }
+        *id = prefix.id;
+    } else {
+        *id = 0;
+    }
+    header = protobuf_header(self);
+    if ((ret = tcp_socket_read(self, header, PACKETHEADERSIZE, NULL)) != AAOS_OK) {
+        return -1 * ret;
+    }
+    protobuf_get(self, PACKET_LENGTH, &length);
+    if (length == 0) {
+        return AAOS_OK;
+    }
+    if (protobuf_payload(self) < length) {
+        if ((ret = protobuf_reallocate(self, (size_t) length)) != AAOS_OK) {
+            return -1 * ret;
+        }
+    }
+    protobuf_get(self, PACKET_BUF, &buf, NULL);
+    if ((ret = tcp_socket_read(self, buf, (size_t) length, NULL)) != AAOS_OK) {
+        return -1 * ret;
+    }
+    
+    return AAOS_OK;
+}
+
+/*
+ * Execute the request in the protobuf, and send the reply.
+ */
+static int
+RPC_execute_reply(struct RPC *self)
+{
+    struct Packet *packet;
+    uint32_t length = rpc_packet(self)->length;
+    int ret;
+    
+    /*
+     * Skip a request whose caller has given up already.
+     */
+    if (self->deadline != 0.) {
+        struct timespec tp;
+        double deadline = self->deadline;
+        self->deadline = 0.;
+        Clock_gettime(CLOCK_MONOTONIC, &tp);
+        if (tp.tv_sec + tp.tv_nsec / 1000000000. >= deadline) {
+            packet = rpc_packet(self);
+            packet_reply(packet, AAOS_ETIMEDOUT, 0);
+            ret = RPC_write_packet(self, packet, PACKETHEADERSIZE);
+            protobuf_trim(self->protobuf, length);
+            return -1 * ret;
+        }
+    }
+    
+    /*
+     * call virtual execute function.
+     * if rpc_execute failed, tell the RPC caller executing error, return AAOS_OK;
+     */
+    if ((ret = rpc_execute(self)) != AAOS_OK) {
+        if (ret < 0) {
+            ret = -1 * ret;
+        }
+        packet = rpc_packet(self);
+        packet_reply(packet, (uint16_t) ret, 0);
+        RPC_write_packet(self, packet, PACKETHEADERSIZE);
+        if (self->batch.depth > 0) {
+            self->batch.depth = 1;
+            rpc_batch_end(self);
+        }
+        protobuf_trim(self->protobuf, length);
+        return AAOS_OK;
+    }
+    /*
+     * return result to the caller
+     */
+    packet = rpc_packet(self);
+    packet->errorcode = AAOS_OK;
+    if (packet->length > length) {
+        length = packet->length;
+    }
+    if ((ret = RPC_write_packet(self, packet, (size_t) packet->length + PACKETHEADERSIZE)) != AAOS_OK) {
+        self->batch.depth = 0;
+        self->batch.length = 0;
+        return -1 * ret;
+    }
+    /*
+     * Flush the batch left open by rpc_execute, the final reply included.
+     */
+    if (self->batch.depth > 0) {
+        self->batch.depth = 1;
+        ret = rpc_batch_end(self);
+    }
+    protobuf_trim(self->protobuf, length);
+    
+    return ret;
+}
+
+/*
+ * A worker writes on the socket of the connection, which it does not own.
+ */
+static void
+RPC_worker_delete(struct RPC *worker)
+{
+    worker->_.sockfd = -1;
+    delete(worker);
+}
+
+static void *
+RPC_execute_thr(void *arg)
+{
+    struct RPC *worker = (struct RPC *) arg;
+    struct RPCPipeline *pipeline = worker->pipeline;
+    struct timespec tp;
+    double now;
+    
+    Pthread_detach(pthread_self());
+    
+    RPC_execute_reply(worker);
+    Clock_gettime(CLOCK_MONOTONIC, &tp);
+    now = tp.tv_sec + tp.tv_nsec / 1000000000.;
+    __atomic_store(&pipeline->last_reply, &now, __ATOMIC_RELAXED);
+    Pthread_mutex_lock(&pipeline->mtx);
+    __atomic_sub_fetch(&pipeline->in_flight, 1, __ATOMIC_RELEASE);
+    Pthread_cond_signal(&pipeline->cond);
+    Pthread_mutex_unlock(&pipeline->mtx);
+    RPC_worker_delete(worker);
+    
+    return NULL;
+}
+
+/*
+ * Execute the request on the thread of the connection, which the reaper leaves alone until it is answered.
+ */
+static int
+RPC_execute_in_place(struct RPC *self)
+{
+    int ret;
+    
+    if (self->connection != NULL) {
+        __atomic_store_n(&self->connection->busy, true, __ATOMIC_RELEASE);
+    }
+    ret = RPC_execute_reply(self);
+    if (self->connection != NULL) {
+        RPCConnection_touch(self->connection);
+    }
+    
+    return ret;
+}
+
+/*
+ * Hand the request over to a worker of the same class sharing the connection,
+ * so that a slow request does not hold back the replies of the others.
+ * The workers write on the socket of the connection under the lock of the pipeline.
+ */
+static int
+RPC_execute_async(struct RPC *self)
+{
+    struct RPC *worker;
+    uint32_t length;
+    pthread_t tid;
+    
+    /*
+     * At the limit, the connection is not read until a worker has answered, so that the client is held back by TCP.
+     * Only the thread of the connection hands requests over, so the count cannot grow behind its back.
+     */
+    Pthread_mutex_lock(&self->pipeline->mtx);
+    while (__atomic_load_n(&self->pipeline->in_flight, __ATOMIC_ACQUIRE) >= RPC_PIPELINE_MAX_IN_FLIGHT) {
+        Pthread_cond_wait(&self->pipeline->cond, &self->pipeline->mtx);
+    }
+    Pthread_mutex_unlock(&self->pipeline->mtx);
+    
+    worker = (struct RPC *) new(classOf(self), tcp_socket_get_sockfd(self));
+    worker->request_id = self->request_id;
+    worker->pipeline = RPCPipeline_retain(self->pipeline);
+    worker->deadline = self->deadline;
+    self->deadline = 0.;
+    
+    protobuf_get(self, PACKET_LENGTH, &length);
+    if (protobuf_payload(worker) < length && protobuf_reallocate(worker, (size_t) length) != AAOS_OK) {
+        RPC_worker_delete(worker);
+        protobuf_set(self, PACKET_ERRORCODE, AAOS_ENOMEM);
+        protobuf_set(self, PACKET_LENGTH, 0);
+        RPC_write_packet(self, protobuf_header(self), PACKETHEADERSIZE);
+        return AAOS_OK;
+    }
+    memcpy(protobuf_header(worker), protobuf_header(self), (size_t) length + PACKETHEADERSIZE);
+    
+    __atomic_add_fetch(&self->pipeline->in_flight, 1, __ATOMIC_RELAXED);
+    if (Pthread_create(&tid, NULL, RPC_execute_thr, worker) != 0) {
+        __atomic_sub_fetch(&self->pipeline->in_flight, 1, __ATOMIC_RELEASE);
+        RPC_worker_delete(worker);
+        return RPC_execute_in_place(self);
+    }
+    
+    return AAOS_OK;
+}
+
+/*
+ * return AAOS_OK if there is no networking problem.
+ * if properly set errorcode according to rpc_execute return value.
+ * positive return value means error happen when excecuting rpc_execute
+ * negative return value means networking error.
+ */
+
+static int
+RPC_process(void *_self)
+{
+    struct RPC *self = cast(RPC(), _self);
+    uint32_t length;
+    int ret;
+    size_t payload;
+    void *buf, *header;
+    
+    /*
+     * Read header.
+     */
+read:
+    if (self->pipeline != NULL) {
+        struct RPCPipelineHeader prefix;
+        if ((ret = tcp_socket_read(self, &prefix, sizeof(prefix), NULL)) != AAOS_OK) {
+            return -1 * ret;
+        }
+        self->request_id = prefix.id;
+    }
+    header = protobuf_header(self);
+    if ((ret = tcp_socket_read(self, header, PACKETHEADERSIZE, NULL)) != AAOS_OK) {
+        return -1 * ret;
+    }
+    if (self->connection != NULL) {
+        RPCConnection_touch(self->connection);
+    }
+    
+    protobuf_get(self, PACKET_LENGTH, &length);
+
+    /*
+     * if any payload, read it.
+     */
+   
+    if (length != 0) {
+        payload = protobuf_payload(self);
+        /*
+         * Only the requests a server accepts are limited to max_packet.
+         */
+        if ((size_t) length > protobuf_get_max_packet()) {
+            ret = AAOS_ENOMEM;
+        } else if (payload < length && (ret = protobuf_reallocate(self, (size_t) length)) == AAOS_OK) {
+            header = protobuf_header(self);
+        }
+        if (ret != AAOS_OK) {
+            protobuf_set(self, PACKET_LENGTH, 0);
+            protobuf_set(self, PACKET_ERRORCODE, AAOS_ENOMEM);
+            RPC_write_packet(self, header, PACKETHEADERSIZE);
+            return ret;
+        }
+        protobuf_get(self, PACKET_BUF, &buf, NULL);
+        if ((ret = tcp_socket_read(self, buf, (size_t) length, NULL)) != AAOS_OK) {
+            return ret;
+        }
+    }
+    
+    struct Packet *packet = rpc_packet(self);
+    
+    /*
+     * The budget of the request that follows, counted from now.
+     */
+    if (packet->protocol == PROTO_SYSTEM && packet->command == SYSTEM_COMMAND_DEADLINE) {
+        struct timespec tp;
+        if (packet->option & RPC_DEADLINE_PROBE) {
+            packet_reply(packet, AAOS_OK, 0);
+            return -1 * RPC_write_packet(self, header, PACKETHEADERSIZE);
+        }
+        Clock_gettime(CLOCK_MONOTONIC, &tp);
+        self->deadline = tp.tv_sec + tp.tv_nsec / 1000000000. + packet->carrier.df[0];
+        goto read;
+    }
+
+    /*
+     * Switch the connection to pipelined mode after acknowledging it.
+     */
+    if (packet->protocol == PROTO_SYSTEM && packet->command == SYSTEM_COMMAND_PIPELINE) {
+        bool refused = tcp_socket_shm_enabled(self) || self->subscriber != NULL;
+        packet_reply(packet, refused ? AAOS_ENOTSUP : AAOS_OK, 0);
+        if (refused) {
+            return -1 * RPC_write_packet(self, header, PACKETHEADERSIZE);
+        }
+        if ((ret = RPC_write_packet(self, header, PACKETHEADERSIZE)) != AAOS_OK) {
+            return -1 * ret;
+        }
+        if (self->pipeline == NULL) {
+            __atomic_store_n(&self->pipeline, RPCPipeline_new(), __ATOMIC_RELEASE);
+        }
+        return AAOS_OK;
+    }
+    
+    /*
+     * Offer shared memory to a local client, the reply carries the descriptors.
+     */
+    if (packet->protocol == PROTO_SYSTEM && packet->command == SYSTEM_COMMAND_SHM) {
+        uint32_t ring_size = packet->carrier.u32[0];
+        packet->length = 0;
+        if (self->pipeline == NULL && self->subscriber == NULL && !tcp_socket_shm_enabled(self)) {
+            packet->errorcode = AAOS_OK;
+            if (tcp_socket_shm_offer(self, ring_size == 0 ? TCPSOCKET_SHM_RING_SIZE : ring_size, header, PACKETHEADERSIZE) == AAOS_OK) {
+                return AAOS_OK;
+            }
+        }
+        packet->errorcode = AAOS_ENOTSUP;
+        return -1 * RPC_write_packet(self, header, PACKETHEADERSIZE);
+    }
+    
+    /*
+     * Echo a ping without going through rpc_execute.
+     */
+    if (packet->protocol == PROTO_SYSTEM && packet->command == SYSTEM_COMMAND_PING) {
+        packet->errorcode = AAOS_OK;
+        return -1 * RPC_write_packet(self, header, PACKETHEADERSIZE + (size_t) packet->length);
+    }
+    
+    if (packet->protocol == PROTO_SYSTEM && (packet->command == SYSTEM_COMMAND_SUBSCRIBE || packet->command == SYSTEM_COMMAND_UNSUBSCRIBE)) {
+        return -1 * RPC_process_subscription(self, packet);
+    }
+    
+    /*
+     * Abort the long operation in progress on another connection.
+     */
+    if (packet->protocol == PROTO_SYSTEM && packet->command == SYSTEM_COMMAND_CANCEL) {
+        self->deadline = 0.;
+        if ((ret = rpc_abort(self)) < 0) {
+            ret = -1 * ret;
+        }
+        packet = rpc_packet(self);
+        packet_reply(packet, (uint16_t) ret, 0);
+        return -1 * RPC_write_packet(self, packet, PACKETHEADERSIZE);
+    }
+    
+    if (self->pipeline != NULL) {
+        return RPC_execute_async(self);
+    }
+
+    return RPC_execute_in_place(self);
+}
+
+int
+rpc_execute(void *_self)
+{
+    struct RPCClass *class = (struct RPCClass *) classOf(_self);
+    
+    if (isOf(class, RPCClass()) && class->execute.method) {
+        return ((int (*)(void *)) class->execute.method)(_self);
+    } else {
+        int result;
+        forward(_self, &result, (Method) rpc_execute, "execute", _self);
+        return result;
+    }
+}
+
+static int
+RPC_execute(void *_self)
+{
+    char *s;
+    size_t size;
+    protobuf_get(_self, PACKET_BUF, &s, &size);
+    printf("%s\n", s);
+    char c = s[0];
+    memset(s, c, size - 1);
+    
+    return AAOS_OK;
+}
+
+int
+rpc_read(void *_self)
+{
+    struct RPCClass *class = (struct RPCClass *) classOf(_self);
+    
+    if (isOf(class, RPCClass()) && class->read.method) {
+        return ((int (*)(void *)) class->read.method)(_self);
+    } else {
+        int result;
+        forward(_self, &result, (Method) rpc_read, "read", _self);
+        return result;
+    }
+}
+
+static int
+RPC_read(void *_self)
+{
+    struct RPC *self = cast(RPC(), _self);
+    
+    void *protobuf = self->protobuf, *header, *buf;
+    int ret;
+    uint32_t length;
+    size_t payload;
+    uint16_t errorcode;
+    
+    /*
+     * Packets are read by the connection, not by the request, when it is pipelined.
+     */
+    if (self->pipeline != NULL) {
+        return -1 * AAOS_ENOTSUP;
+    }
+    
+    header = protobuf_header(protobuf);
+    if ((ret = tcp_socket_read(self, header, PACKETHEADERSIZE, NULL)) != AAOS_OK) {
+        return -1 * ret;
+    }
+    protobuf_get(self, PACKET_LENGTH, &length);
+    if (length == 0) {
+        return ret;
+    }
+    payload = protobuf_payload(protobuf);
+    if (payload < length) {
+        if ((ret = protobuf_reallocate(self, (size_t) length)) != AAOS_OK) {
+            return ret;
+        }
+    }
+    protobuf_get(protobuf, PACKET_BUF, &buf, NULL);
+    if ((ret = tcp_socket_read(self, buf, (size_t) length, NULL)) != AAOS_OK) {
+        return -1 * ret;
+    }
+    protobuf_get(self, PACKET_ERRORCODE, &errorcode);
+
+    return errorcode;
+}
+
+int
+rpc_write(void *_self)
+{
+    struct RPCClass *class = (struct RPCClass *) classOf(_self);
+    
+    if (isOf(class, RPCClass()) && class->write.method) {
+        return ((int (*)(void *)) class->write.method)(_self);
+    } else {
+        int result;
+        forward(_self, &result, (Method) rpc_write, "write", _self);
+        return result;
+    }
+}
+
+static int
+RPC_write(void *_self)
+{
+    struct RPC *self = cast(RPC(), _self);
+    
+    void *protobuf = self->protobuf, *header;
+    int ret;
+    uint32_t length;
+
+    header = protobuf_header(protobuf);
+    protobuf_get(self, PACKET_LENGTH, &length);
+    if ((ret = RPC_write_packet(self, header, (size_t) length + PACKETHEADERSIZE)) != AAOS_OK) {
+        return -1 * ret;
+    }
+    
+    return AAOS_OK;
+}
+
+int
+rpc_call(void *_self)
+{
+    struct RPCClass *class = (struct RPCClass *) classOf(_self);
+    
+    if (isOf(class, RPCClass()) && class->call.method) {
+        return ((int (*)(void *)) class->call.method)(_self);
+    } else {
+        int result;
+        forward(_self, &result, (Method) rpc_call, "call", _self);
+        return result;
+    }
+}
+
+/*
+ * Send the request after a SYSTEM_COMMAND_DEADLINE packet carrying the budget of the call,
+ * so that the server knows when the reply is no longer awaited.
+ */
+static int
+RPC_write_deadline(struct RPC *self, void *header, size_t length)
+{
+    struct Packet preamble;
+    struct iovec iov[2];
+    
+    memset(&preamble, '\0', PACKETHEADERSIZE);
+    preamble.protocol = PROTO_SYSTEM;
+    preamble.command = SYSTEM_COMMAND_DEADLINE;
+    preamble.carrier.df[0] = self->timeout;
+    iov[0].iov_base = &preamble;
+    iov[0].iov_len = PACKETHEADERSIZE;
+    iov[1].iov_base = header;
+    iov[1].iov_len = length;
+    
+    return tcp_socket_writev(self, iov, 2, NULL);
+}
+
+/*
+ * Ask the server once whether it takes the deadline preamble. A server which does not
+ * would answer the preamble itself, and every later reply would be one call late.
+ * The packet of the call is kept aside meanwhile.
+ */
+static int
+RPC_probe_deadline(struct RPC *self)
+{
+    char saved[PACKETHEADERSIZE];
+    void *header = protobuf_header(self);
+    uint32_t length;
+    uint16_t errorcode;
+    int ret;
+    
+    /*
+     * Events may be read in place of the answer on a subscribed connection.
+     */
+    if (self->subscriber != NULL) {
+        self->deadline_support = RPC_DEADLINE_UNSUPPORTED;
+        return AAOS_OK;
+    }
+    
+    memcpy(saved, header, PACKETHEADERSIZE);
+    protobuf_set(self, PACKET_PROTOCOL, PROTO_SYSTEM);
+    protobuf_set(self, PACKET_COMMAND, SYSTEM_COMMAND_DEADLINE);
+    protobuf_set(self, PACKET_OPTION, RPC_DEADLINE_PROBE);
+    protobuf_set(self, PACKET_ERRORCODE, 0);
+    protobuf_set(self, PACKET_LENGTH, 0);
+    if ((ret = tcp_socket_write(self, header, PACKETHEADERSIZE, NULL)) == AAOS_OK && (ret = tcp_socket_read(self, header, PACKETHEADERSIZE, NULL)) == AAOS_OK) {
+        protobuf_get(self, PACKET_LENGTH, &length);
+        protobuf_get(self, PACKET_ERRORCODE, &errorcode);
+        if (length != 0) {
+            ret = AAOS_EBADMSG;
+        } else {
+            self->deadline_support = (errorcode == AAOS_OK) ? RPC_DEADLINE_SUPPORTED : RPC_DEADLINE_UNSUPPORTED;
+        }
+    }
+    memcpy(header, saved, PACKETHEADERSIZE);
+    
+    return ret;
+}
+
+static int RPC_call_once(struct RPC *self);
+static int rpc_pool_reopen(struct RPC *self);
+static bool rpc_pool_probe(void *rpc);
+
+/*
+ * Bound the call by the timeout of the client, see rpc_set_timeout.
+ */
+static int
+RPC_call_timed(struct RPC *self)
+{
+    struct timespec tp;
+    int ret;
+    
+    if (self->timeout == 0. || self->pipeline != NULL) {
+        return RPC_call_once(self);
+    }
+    
+    Clock_gettime(CLOCK_MONOTONIC, &tp);
+    tcp_socket_set_deadline(self, tp.tv_sec + tp.tv_nsec / 1000000000. + self->timeout);
+    if (self->deadline_support != RPC_DEADLINE_UNKNOWN || (ret = RPC_probe_deadline(self)) == AAOS_OK) {
+        ret = RPC_call_once(self);
+    } else {
+        ret = -1 * ret;
+    }
+    tcp_socket_set_deadline(self, 0.);
+    if (ret == -1 * AAOS_ETIMEDOUT || ret == -1 * AAOS_EBADMSG) {
+        shutdown(tcp_socket_get_sockfd(self), SHUT_RDWR);
+    }
+    
+    return ret;
+}
+
+/*
+ * return a negtive error means a local error, otherwise, remote error.
+ * a return value of AAOS_EMOREPACKET means the caller should issue calls
+ * until the return value is other than AAOS_EMOREPACKET.
+ */
+static int
+RPC_call(void *_self)
+{
+    struct RPC *self = cast(RPC(), _self);
+    
+    char header[PACKETHEADERSIZE];
+    bool reused = self->reused;
+    int ret;
+    
+    /*
+     * The peer may have closed a connection while it sat in the pool, reopen it before sending.
+     */
+    if (reused) {
+        self->reused = false;
+        if (!rpc_pool_probe(self)) {
+            rpc_pool_reopen(self);
+        }
+        memcpy(header, protobuf_header(self), PACKETHEADERSIZE);
+    }
+    self->sent = false;
+    ret = RPC_call_timed(self);
+    
+    /*
+     * If it is closed while the request is being written, the server has not got the whole request,
+     * send it once more. Once the request is out, the server may have executed it, the error is returned.
+     */
+    if (reused && !self->sent && (ret == -1 * AAOS_EPIPE || ret == -1 * AAOS_ECONNRESET || ret == -1 * AAOS_ECLOSED) && rpc_pool_reopen(self) == AAOS_OK) {
+        memcpy(protobuf_header(self), header, PACKETHEADERSIZE);
+        ret = RPC_call_timed(self);
+    }
+    
+    return ret;
+}
+
+static int
+RPC_call_once(struct RPC *self)
+{
+    uint32_t length;
+    uint16_t option;
+    int ret;
+    size_t payload;
+    void *buf, *header;
+    
+    /*
      * Make a remote procedure call
      */
     header = protobuf_header(self);
     protobuf_get(self, PACKET_OPTION, &option);
     protobuf_set(self, PACKET_ERRORCODE, 0);
+    if (self->pipeline != NULL) {
+        uint32_t id;
+        self->sent = true;
+        if (option & PROTO_OPTION_MORE_PACKET) {
+            id = self->request_id;
+        } else if ((ret = rpc_call_async(self, NULL, NULL, &id)) != AAOS_OK) {
+            return ret;
+        }
+        self->request_id = id;
+        return rpc_wait(self, id);
+    }
     if (option & PROTO_OPTION_MORE_PACKET) {
         /*
          * skip send command.
          */
     } else {
         protobuf_get(self, PACKET_LENGTH, &length);
-        if ((ret = tcp_socket_write(self, header, (size_t) length + PACKETHEADERSIZE, NULL)) != AAOS_OK) {
+        if (self->timeout > 0. && self->deadline_support == RPC_DEADLINE_SUPPORTED) {
+            ret = RPC_write_deadline(self, header, (size_t) length + PACKETHEADERSIZE);
+        } else {
+            ret = tcp_socket_write(self, header, (size_t) length + PACKETHEADERSIZE, NULL);
+        }
+        if (ret != AAOS_OK) {
             protobuf_set(self, PACKET_OPTION, option & ~PROTO_OPTION_MORE_PACKET);
             return -1 * ret;
         }
     }
+    self->sent = true;
+    
+    /*
+     * Read header from the server
+     */
+    if ((ret = tcp_socket_read(self, header, PACKETHEADERSIZE, NULL)) != AAOS_OK) {
+        protobuf_set(self, PACKET_OPTION, option & ~PROTO_OPTION_MORE_PACKET);
+        return -1 * ret;
+    }
+    protobuf_get(self, PACKET_LENGTH, &length);
+    protobuf_get(self, PACKET_OPTION, &option);
+    if (length == 0) {
+        uint16_t errorcode;
+        protobuf_get(self, PACKET_ERRORCODE, &errorcode);
+        ret = errorcode;
+        if (ret == AAOS_OK && (option & PROTO_OPTION_MORE_PACKET)) {
+            ret = AAOS_EMOREPACK;
+        }
+        return ret;
+    }
+    /*
+     * if any  payload, read it.
+     */
+    payload = protobuf_payload(self->protobuf);
+    if (payload < length) {
+        if ((ret = protobuf_reallocate(self, (size_t) length)) != AAOS_OK) {
+            protobuf_set(self, PACKET_OPTION, option & ~PROTO_OPTION_MORE_PACKET);
+            return ret;
+        }
+    }
+    protobuf_get(self, PACKET_BUF, &buf, NULL);
+
+    if ((ret = tcp_socket_read(self, buf, (size_t) length, NULL)) != AAOS_OK) {
+        protobuf_set(self, PACKET_OPTION, option & ~PROTO_OPTION_MORE_PACKET);
+        return -1 * ret;
+    } else {
+        uint16_t errorcode;
+        protobuf_get(self, PACKET_ERRORCODE, &errorcode);
+        ret = errorcode;
+        if (ret == AAOS_OK && (option & PROTO_OPTION_MORE_PACKET)) {
+            ret = AAOS_EMOREPACK;
+        }
+        return ret;
+    }
+}
+
+int
+rpc_pipeline(void *_self)
+{
+    struct RPCClass *class = (struct RPCClass *) classOf(_self);
+    
+    if (isOf(class, RPCClass()) && class->pipeline.method) {
+        return ((int (*)(void *)) class->pipeline.method)(_self);
+    } else {
+        int result;
+        forward(_self, &result, (Method) rpc_pipeline, "pipeline", _self);
+        return result;
+    }
+}
+
+static int
+RPC_pipeline(void *_self)
+{
+    struct RPC *self = cast(RPC(), _self);
+    
+    int ret;
+    
+    if (self->pipeline != NULL) {
+        return AAOS_OK;
+    }
+    if (tcp_socket_shm_enabled(self)) {
+        return -1 * AAOS_ENOTSUP;
+    }
+    
+    protobuf_set(self, PACKET_PROTOCOL, PROTO_SYSTEM);
+    protobuf_set(self, PACKET_COMMAND, SYSTEM_COMMAND_PIPELINE);
+    protobuf_set(self, PACKET_OPTION, 0);
+    protobuf_set(self, PACKET_LENGTH, 0);
+    
+    if ((ret = rpc_call(self)) != AAOS_OK) {
+        return ret;
+    }
+    self->pipeline = RPCPipeline_new();
+    
+    return AAOS_OK;
+}
+
+int
+rpc_shm(void *_self, size_t ring_size)
+{
+    struct RPCClass *class = (struct RPCClass *) classOf(_self);
+    
+    if (isOf(class, RPCClass()) && class->shm.method) {
+        return ((int (*)(void *, size_t)) class->shm.method)(_self, ring_size);
+    } else {
+        int result;
+        forward(_self, &result, (Method) rpc_shm, "shm", _self, ring_size);
+        return result;
+    }
+}
+
+static int
+RPC_shm(void *_self, size_t ring_size)
+{
+    struct RPC *self = cast(RPC(), _self);
+    
+    uint16_t protocol, errorcode;
+    void *header;
+    int ret;
+    
+    if (tcp_socket_shm_enabled(self)) {
+        return AAOS_OK;
+    }
+    if (self->pipeline != NULL) {
+        return -1 * AAOS_ENOTSUP;
+    }
     
-    /*
-     * Read header from the server
-     */
-    if ((ret = tcp_socket_read(self, header, PACKETHEADERSIZE, NULL)) != AAOS_OK) {
-        protobuf_set(self, PACKET_OPTION, option & ~PROTO_OPTION_MORE_PACKET);
+    header = protobuf_header(self);
+    protobuf_get(self, PACKET_PROTOCOL, &protocol);
+    protobuf_set(self, PACKET_PROTOCOL, PROTO_SYSTEM);
+    protobuf_set(self, PACKET_COMMAND, SYSTEM_COMMAND_SHM);
+    protobuf_set(self, PACKET_OPTION, 0);
+    protobuf_set(self, PACKET_ERRORCODE, 0);
+    protobuf_set(self, PACKET_LENGTH, 0);
+    protobuf_set(self, PACKET_U32F0, (uint32_t) ring_size);
+    
+    if ((ret = tcp_socket_write(self, header, PACKETHEADERSIZE, NULL)) != AAOS_OK) {
         return -1 * ret;
     }
-    protobuf_get(self, PACKET_LENGTH, &length);
-    protobuf_get(self, PACKET_OPTION, &option);
-    if (length == 0) {
-        uint16_t errorcode;
-        protobuf_get(self, PACKET_ERRORCODE, &errorcode);
-        ret = errorcode;
-        if (ret == AAOS_OK && (option & PROTO_OPTION_MORE_PACKET)) {
-            ret = AAOS_EMOREPACK;
+    ret = tcp_socket_shm_accept(self, header, PACKETHEADERSIZE);
+    protobuf_get(self, PACKET_ERRORCODE, &errorcode);
+    protobuf_set(self, PACKET_PROTOCOL, protocol);
+    if (ret == AAOS_OK || ret == AAOS_ENOTSUP) {
+        return errorcode != AAOS_OK ? errorcode : ret;
+    }
+    
+    return -1 * ret;
+}
+
+int
+rpc_batch_begin(void *_self)
+{
+    struct RPCClass *class = (struct RPCClass *) classOf(_self);
+    
+    if (isOf(class, RPCClass()) && class->batch_begin.method) {
+        return ((int (*)(void *)) class->batch_begin.method)(_self);
+    } else {
+        int result;
+        forward(_self, &result, (Method) rpc_batch_begin, "batch_begin", _self);
+        return result;
+    }
+}
+
+static int
+RPC_batch_begin(void *_self)
+{
+    struct RPC *self = cast(RPC(), _self);
+    
+    if (self->batch.depth++ == 0) {
+        tcp_socket_cork(self, true);
+    }
+    
+    return AAOS_OK;
+}
+
+int
+rpc_batch_end(void *_self)
+{
+    struct RPCClass *class = (struct RPCClass *) classOf(_self);
+    
+    if (isOf(class, RPCClass()) && class->batch_end.method) {
+        return ((int (*)(void *)) class->batch_end.method)(_self);
+    } else {
+        int result;
+        forward(_self, &result, (Method) rpc_batch_end, "batch_end", _self);
+        return result;
+    }
+}
+
+static int
+RPC_batch_end(void *_self)
+{
+    struct RPC *self = cast(RPC(), _self);
+    
+    int ret;
+    
+    if (self->batch.depth == 0) {
+        return AAOS_OK;
+    }
+    if (--self->batch.depth > 0) {
+        return AAOS_OK;
+    }
+    ret = RPC_write_iov(self, NULL, 0);
+    tcp_socket_cork(self, false);
+    
+    return -1 * ret;
+}
+
+int
+rpc_abort(void *_self)
+{
+    struct RPCClass *class = (struct RPCClass *) classOf(_self);
+    
+    if (isOf(class, RPCClass()) && class->abort.method) {
+        return ((int (*)(void *)) class->abort.method)(_self);
+    } else {
+        int result;
+        forward(_self, &result, (Method) rpc_abort, "abort", _self);
+        return result;
+    }
+}
+
+static int
+RPC_abort(void *_self)
+{
+    return AAOS_ENOTSUP;
+}
+
+void
+rpc_set_timeout(void *_self, double timeout)
+{
+    struct RPC *self = cast(RPC(), _self);
+    
+    self->timeout = timeout > 0. ? timeout : 0.;
+}
+
+int
+rpc_cancel(void *_self, uint16_t index, const char *name)
+{
+    struct RPC *self = cast(RPC(), _self);
+    
+    protobuf_set(self, PACKET_PROTOCOL, PROTO_SYSTEM);
+    protobuf_set(self, PACKET_COMMAND, SYSTEM_COMMAND_CANCEL);
+    protobuf_set(self, PACKET_OPTION, 0);
+    protobuf_set(self, PACKET_INDEX, index);
+    protobuf_set(self, PACKET_LENGTH, 0);
+    if (name != NULL) {
+        protobuf_set(self, PACKET_STR, name);
+    }
+    
+    return rpc_call(self);
+}
+
+/*
+ * The helpers below are called with pipeline->mtx held.
+ */
+static struct RPCPending *
+RPC_find_pending(struct RPC *self, uint32_t id)
+{
+    struct RPCPending *pending;
+    
+    for (pending = self->pipeline->pending; pending != NULL; pending = pending->next) {
+        if (pending->id == id) {
+            break;
         }
-        return ret;
     }
-    /*
-     * if any  payload, read it.
-     */
-    payload = protobuf_payload(self->protobuf);
-    if (payload < length) {
-        if ((ret = protobuf_reallocate(self, (size_t) length)) != AAOS_OK) {
-            protobuf_set(self, PACKET_OPTION, option & ~PROTO_OPTION_MORE_PACKET);
-            return ret;
+    
+    return pending;
+}
+
+static void
+RPC_remove_pending(struct RPC *self, struct RPCPending *pending)
+{
+    struct RPCPending **pp;
+    struct RPCReply *reply;
+    
+    for (pp = &self->pipeline->pending; *pp != NULL; pp = &(*pp)->next) {
+        if (*pp == pending) {
+            *pp = pending->next;
+            break;
         }
     }
-    protobuf_get(self, PACKET_BUF, &buf, NULL);
+    while ((reply = pending->reply) != NULL) {
+        pending->reply = reply->next;
+        free(reply);
+    }
+    free(pending);
+}
 
-    if ((ret = tcp_socket_read(self, buf, (size_t) length, NULL)) != AAOS_OK) {
-        protobuf_set(self, PACKET_OPTION, option & ~PROTO_OPTION_MORE_PACKET);
-        return -1 * ret;
+static bool
+RPC_all_answered(struct RPC *self)
+{
+    struct RPCPending *pending;
+    
+    for (pending = self->pipeline->pending; pending != NULL; pending = pending->next) {
+        if (!pending->answered) {
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+int
+rpc_call_async(void *_self, rpc_completion completion, void *arg, uint32_t *id)
+{
+    struct RPCClass *class = (struct RPCClass *) classOf(_self);
+    
+    if (isOf(class, RPCClass()) && class->call_async.method) {
+        return ((int (*)(void *, rpc_completion, void *, uint32_t *)) class->call_async.method)(_self, completion, arg, id);
     } else {
-        uint16_t errorcode;
-        protobuf_get(self, PACKET_ERRORCODE, &errorcode);
-        ret = errorcode;
-        if (ret == AAOS_OK && (option & PROTO_OPTION_MORE_PACKET)) {
-            ret = AAOS_EMOREPACK;
+        int result;
+        forward(_self, &result, (Method) rpc_call_async, "call_async", _self, completion, arg, id);
+        return result;
+    }
+}
+
+static int
+RPC_call_async(void *_self, rpc_completion completion, void *arg, uint32_t *id)
+{
+    struct RPC *self = cast(RPC(), _self);
+    
+    struct RPCPending *pending, **pp;
+    uint32_t length;
+    uint16_t option;
+    int ret;
+    
+    if (self->pipeline == NULL) {
+        ret = rpc_call(self);
+        if (completion != NULL) {
+            completion(self, 0, ret, arg);
+        }
+        if (id != NULL) {
+            *id = 0;
         }
         return ret;
     }
+    
+    pending = (struct RPCPending *) Malloc(sizeof(struct RPCPending));
+    memset(pending, '\0', sizeof(struct RPCPending));
+    pending->completion = completion;
+    pending->arg = arg;
+    Pthread_mutex_lock(&self->pipeline->mtx);
+    if (++self->pipeline->next_id == 0) {
+        ++self->pipeline->next_id;
+    }
+    pending->id = self->pipeline->next_id;
+    for (pp = &self->pipeline->pending; *pp != NULL; pp = &(*pp)->next) {
+    }
+    *pp = pending;
+    Pthread_mutex_unlock(&self->pipeline->mtx);
+    
+    protobuf_get(self, PACKET_OPTION, &option);
+    protobuf_set(self, PACKET_OPTION, option & ~PROTO_OPTION_MORE_PACKET);
+    protobuf_set(self, PACKET_ERRORCODE, 0);
+    protobuf_get(self, PACKET_LENGTH, &length);
+    self->request_id = pending->id;
+    if ((ret = RPC_write_packet(self, protobuf_header(self), (size_t) length + PACKETHEADERSIZE)) != AAOS_OK) {
+        Pthread_mutex_lock(&self->pipeline->mtx);
+        RPC_remove_pending(self, pending);
+        Pthread_mutex_unlock(&self->pipeline->mtx);
+        return -1 * ret;
+    }
+    if (id != NULL) {
+        *id = pending->id;
+    }
+    
+    return AAOS_OK;
+}
+
+/*
+ * Result of the reply in the protobuf, as returned by rpc_call.
+ */
+static int
+RPC_reply_result(struct RPC *self)
+{
+    uint16_t errorcode, option;
+    
+    protobuf_get(self, PACKET_ERRORCODE, &errorcode);
+    protobuf_get(self, PACKET_OPTION, &option);
+    if (errorcode == AAOS_OK && (option & PROTO_OPTION_MORE_PACKET)) {
+        return AAOS_EMOREPACK;
+    }
+    
+    return errorcode;
+}
+
+int
+rpc_wait(void *_self, uint32_t id)
+{
+    struct RPCClass *class = (struct RPCClass *) classOf(_self);
+    
+    if (isOf(class, RPCClass()) && class->wait.method) {
+        return ((int (*)(void *, uint32_t)) class->wait.method)(_self, id);
+    } else {
+        int result;
+        forward(_self, &result, (Method) rpc_wait, "wait", _self, id);
+        return result;
+    }
+}
+
+static int
+RPC_wait(void *_self, uint32_t id)
+{
+    struct RPC *self = cast(RPC(), _self);
+    
+    struct RPCPending *pending;
+    struct RPCReply *reply;
+    rpc_completion completion;
+    void *arg;
+    uint32_t rid, length;
+    int ret, result;
+    
+    if (self->pipeline == NULL) {
+        return id == 0 ? AAOS_OK : -1 * AAOS_ENOTFOUND;
+    }
+    
+    for (; ;) {
+        Pthread_mutex_lock(&self->pipeline->mtx);
+        if (id == 0) {
+            if (RPC_all_answered(self)) {
+                Pthread_mutex_unlock(&self->pipeline->mtx);
+                return AAOS_OK;
+            }
+        } else {
+            if ((pending = RPC_find_pending(self, id)) == NULL) {
+                Pthread_mutex_unlock(&self->pipeline->mtx);
+                return -1 * AAOS_ENOTFOUND;
+            }
+            /*
+             * The reply has arrived while waiting for another call.
+             */
+            if ((reply = pending->reply) != NULL) {
+                pending->reply = reply->next;
+                if (pending->answered && pending->reply == NULL) {
+                    RPC_remove_pending(self, pending);
+                }
+                Pthread_mutex_unlock(&self->pipeline->mtx);
+                length = (uint32_t) (reply->length - PACKETHEADERSIZE);
+                if (protobuf_payload(self) < length && (ret = protobuf_reallocate(self, (size_t) length)) != AAOS_OK) {
+                    free(reply);
+                    return -1 * ret;
+                }
+                memcpy(protobuf_header(self), reply->packet, reply->length);
+                result = reply->result;
+                free(reply);
+                return result;
+            }
+        }
+        Pthread_mutex_unlock(&self->pipeline->mtx);
+        
+        if ((ret = RPC_read_packet(self, &rid)) != AAOS_OK) {
+            return ret;
+        }
+        Pthread_mutex_lock(&self->pipeline->mtx);
+        if ((pending = RPC_find_pending(self, rid)) == NULL) {
+            Pthread_mutex_unlock(&self->pipeline->mtx);
+            continue;
+        }
+        result = RPC_reply_result(self);
+        if (result != AAOS_EMOREPACK) {
+            pending->answered = true;
+        }
+        if (rid == id) {
+            if (pending->answered) {
+                RPC_remove_pending(self, pending);
+            }
+            Pthread_mutex_unlock(&self->pipeline->mtx);
+            return result;
+        }
+        if (pending->completion != NULL) {
+            /*
+             * The completion may issue calls of its own, so it runs without the lock.
+             */
+            completion = pending->completion;
+            arg = pending->arg;
+            if (pending->answered) {
+                RPC_remove_pending(self, pending);
+            }
+            Pthread_mutex_unlock(&self->pipeline->mtx);
+            completion(self, rid, result, arg);
+        } else {
+            struct RPCReply **rp;
+            protobuf_get(self, PACKET_LENGTH, &length);
+            reply = (struct RPCReply *) Malloc(sizeof(struct RPCReply) + PACKETHEADERSIZE + length);
+            reply->next = NULL;
+            reply->result = result;
+            reply->length = PACKETHEADERSIZE + length;
+            memcpy(reply->packet, protobuf_header(self), reply->length);
+            for (rp = &pending->reply; *rp != NULL; rp = &(*rp)->next) {
+            }
+            *rp = reply;
+            Pthread_mutex_unlock(&self->pipeline->mtx);
+        }
+    }
 }
 
 int
@@ -530,6 +1833,19 @@ RPC_forward(const void *_self, void *result, Method selector, const char *name,
     
     if (selector == (Method) rpc_call || selector == (Method) rpc_execute || selector == (Method) rpc_process || selector == (Method) rpc_inspect || selector == (Method) rpc_read || selector == (Method) rpc_write) {
         *((int *) result) = ((int (*)(void *)) method)(obj);
+    } else if (selector == (Method) rpc_pipeline || selector == (Method) rpc_batch_begin || selector == (Method) rpc_batch_end || selector == (Method) rpc_abort) {
+        *((int *) result) = ((int (*)(void *)) method)(obj);
+    } else if (selector == (Method) rpc_call_async) {
+        rpc_completion completion = va_arg(ap, rpc_completion);
+        void *arg = va_arg(ap, void *);
+        uint32_t *id = va_arg(ap, uint32_t *);
+        *((int *) result) = ((int (*)(void *, rpc_completion, void *, uint32_t *)) method)(obj, completion, arg, id);
+    } else if (selector == (Method) rpc_shm) {
+        size_t ring_size = va_arg(ap, size_t);
+        *((int *) result) = ((int (*)(void *, size_t)) method)(obj, ring_size);
+    } else if (selector == (Method) rpc_wait) {
+        uint32_t id = va_arg(ap, uint32_t);
+        *((int *) result) = ((int (*)(void *, uint32_t)) method)(obj, id);
     } else if (selector == (Method) rpc_register) {
         double timeout = va_arg(ap, double);
         *((int *) result) = ((int (*)(void *, double)) method)(obj, timeout);
@@ -642,6 +1958,14 @@ RPC_cctor(void *_self, const void *_from)
     self->_vtab = from->_vtab;
     self->option = from->option;
     self->protobuf = ocopy(ProtoBuf(), from->protobuf);
+    self->request_id = 0;
+    self->pipeline = NULL;
+    memset(&self->batch, '\0', sizeof(struct RPCBatch));
+    self->subscriber = NULL;
+    self->events = NULL;
+    self->connection = NULL;
+    self->timeout = from->timeout;
+    self->deadline = 0.;
     
     return self;
 }
@@ -656,11 +1980,35 @@ RPC_ctor(void *_self, va_list *app)
     return (void *) self;
 }
 
+static void RPCConnection_release(struct RPCConnection *connection);
+
 static void *
 RPC_dtor(void *_self)
 {
     struct RPC *self = cast(RPC(), _self);
     
+    if (self->connection != NULL) {
+        RPCConnection_release(self->connection);
+    }
+    if (self->pipeline != NULL) {
+        /*
+         * Workers may still answer on the socket, it is closed with the pipeline.
+         */
+        if (self->_.sockfd >= 0) {
+            self->pipeline->sockfd = self->_.sockfd;
+            self->_.sockfd = -1;
+        }
+        RPCPipeline_release(self->pipeline);
+    }
+    if (self->subscriber != NULL) {
+        RPCSubscriber_release(self->subscriber);
+    }
+    while (self->events != NULL) {
+        struct RPCReply *reply = self->events;
+        self->events = reply->next;
+        free(reply);
+    }
+    free(self->batch.buf);
     delete(self->protobuf);
     
     return super_dtor(RPC(), _self);
@@ -731,12 +2079,68 @@ RPCClass_ctor(void *_self, va_list *app)
             self->inspect.method = method;
             continue;
         }
-        if (selector == (Method) rpc_register) {
+        if (selector == (Method) rpc_register) {
+            if (tag) {
+                self->reg.tag = tag;
+                self->reg.selector = selector;
+            }
+            self->reg.method = method;
+            continue;
+        }
+        if (selector == (Method) rpc_pipeline) {
+            if (tag) {
+                self->pipeline.tag = tag;
+                self->pipeline.selector = selector;
+            }
+            self->pipeline.method = method;
+            continue;
+        }
+        if (selector == (Method) rpc_call_async) {
+            if (tag) {
+                self->call_async.tag = tag;
+                self->call_async.selector = selector;
+            }
+            self->call_async.method = method;
+            continue;
+        }
+        if (selector == (Method) rpc_wait) {
+            if (tag) {
+                self->wait.tag = tag;
+                self->wait.selector = selector;
+            }
+            self->wait.method = method;
+            continue;
+        }
+        if (selector == (Method) rpc_shm) {
+            if (tag) {
+                self->shm.tag = tag;
+                self->shm.selector = selector;
+            }
+            self->shm.method = method;
+            continue;
+        }
+        if (selector == (Method) rpc_batch_begin) {
+            if (tag) {
+                self->batch_begin.tag = tag;
+                self->batch_begin.selector = selector;
+            }
+            self->batch_begin.method = method;
+            continue;
+        }
+        if (selector == (Method) rpc_batch_end) {
+            if (tag) {
+                self->batch_end.tag = tag;
+                self->batch_end.selector = selector;
+            }
+            self->batch_end.method = method;
+            continue;
+        }
+        if (selector == (Method) rpc_abort) {
             if (tag) {
-                self->reg.tag = tag;
-                self->reg.selector = selector;
+                self->abort.tag = tag;
+                self->abort.selector = selector;
             }
-            self->reg.method = method;
+            self->abort.method = method;
             continue;
         }
     }
@@ -802,6 +2206,13 @@ RPC_initialize(void)
                rpc_call, "call", RPC_call,
                rpc_register, "register", RPC_register,
                rpc_inspect, "inspect", RPC_inspect,
+               rpc_pipeline, "pipeline", RPC_pipeline,
+               rpc_call_async, "call_async", RPC_call_async,
+               rpc_wait, "wait", RPC_wait,
+               rpc_shm, "shm", RPC_shm,
+               rpc_batch_begin, "batch_begin", RPC_batch_begin,
+               rpc_batch_end, "batch_end", RPC_batch_end,
+               rpc_abort, "abort", RPC_abort,
                (void *) 0);
 #ifndef _USE_COMPILER_ATTRIBUTION_
     atexit(RPC_destroy);
@@ -900,29 +2311,42 @@ rpc_client_connect(void *_self, void **client)
     }
 }
 
+/*
+ * An address ending with ".sock" is the path of a Unix domain socket.
+ */
 static int
-RPCClient_connect(void *_self, void **client)
+RPCClient_open(const char *address, const char *port)
 {
-    struct RPCClient *self = cast(RPCClient(), _self);
-    
     int cfd;
-    if (self->_.address == NULL) {
-        cfd = Tcp_connect("localhost", self->_.port, NULL, NULL);
+    if (address == NULL) {
+        cfd = Tcp_connect("localhost", port, NULL, NULL);
     } else {
-        size_t length = strlen(self->_.address);
-        char *idx;
+        size_t length = strlen(address);
+        const char *idx;
         if (length > 6) {
-            idx = self->_.address + length - 5;
+            idx = address + length - 5;
             if (strcmp(idx, ".sock") == 0) {
-                cfd = Un_stream_connect(self->_.address);
+                cfd = Un_stream_connect(address);
             } else {
-                cfd = Tcp_connect(self->_.address, self->_.port, NULL, NULL);
+                cfd = Tcp_connect(address, port, NULL, NULL);
             }
         } else {
-            cfd = Tcp_connect(self->_.address, self->_.port, NULL, NULL);
+            cfd = Tcp_connect(address, port, NULL, NULL);
         }
     }
     
+    return cfd;
+}
+
+static int
+RPCClient_connect(void *_self, void **client)
+{
+    struct RPCClient *self = cast(RPCClient(), _self);
+    
+    int cfd;
+    
+    cfd = RPCClient_open(self->_.address, self->_.port);
+    
     if (cfd < 0) {
         *client = NULL;
         switch (errno) {
@@ -972,121 +2396,579 @@ RPCClient_forward(const void *_self, void *result, Method selector, const char *
         assert(0);
     }
     
-#ifdef va_copy
-    va_end(ap);
-#endif
+#ifdef va_copy
+    va_end(ap);
+#endif
+}
+
+static void *
+RPCClient_ctor(void *_self, va_list *app)
+{
+    struct RPCClient *self = super_ctor(RPCClient(), _self, app);
+    
+    return (void *) self;
+}
+
+static void *
+RPCClient_dtor(void *_self)
+{
+    //struct RPCClient *self = cast(RPCClient(), _self);
+    
+    return super_dtor(RPCClient(), _self); 
+}
+
+static void *
+RPCClientClass_ctor(void *_self, va_list *app)
+{
+    struct RPCClientClass *self = super_ctor(RPCClientClass(), _self, app);
+    Method selector;
+    
+#ifdef va_copy
+    va_list ap;
+    va_copy(ap, *app);
+#else
+    va_list ap = *app;
+#endif
+    
+    while ((selector = va_arg(ap, Method))) {
+        const char *tag = va_arg(ap, const char *);
+        Method method = va_arg(ap, Method);
+        
+        if (selector == (Method) rpc_client_connect) {
+            if (tag) {
+                self->connect.tag = tag;
+                self->connect.selector = selector;
+            }
+            self->connect.method = method;
+            continue;
+        }
+    }
+    
+#ifdef va_copy
+    va_end(ap);
+#endif
+    
+    return self;
+}
+
+static const void *_RPCClientClass;
+
+static void
+RPCClientClass_destroy(void)
+{
+    free((void *)_RPCClientClass);
+}
+
+static void
+RPCClientClass_initialize(void)
+{
+    _RPCClientClass = new(TCPClientClass(), "RPCClientClass", TCPClientClass(), sizeof(struct RPCClientClass),
+                          ctor, "ctor", RPCClientClass_ctor,
+                          (void *) 0);
+#ifndef _USE_COMPILER_ATTRIBUTION_
+    atexit(RPCClientClass_destroy);
+#endif
+}
+
+const void *
+RPCClientClass(void)
+{
+#ifndef _USE_COMPILER_ATTRIBUTION_
+    static pthread_once_t once = PTHREAD_ONCE_INIT;
+    pthread_once(&once, RPCClientClass_initialize);
+#endif
+    return _RPCClientClass;
+}
+
+static const void *_RPCClient;
+
+static void
+RPCClient_destroy(void)
+{
+    free((void *)_RPCClient);
+}
+
+static void
+RPCClient_initialize(void)
+{
+    _RPCClient = new(RPCClientClass(), "RPCClient", TCPClient(), sizeof(struct RPCClient),
+                     ctor, "ctor", RPCClient_ctor,
+                     ctor, "ctor", RPCClient_ctor,
+                     dtor, "dtor", RPCClient_dtor,
+                     forward, "forward", RPCClient_forward,
+                     rpc_client_connect, "connect", RPCClient_connect,
+                     (void *) 0);
+#ifndef _USE_COMPILER_ATTRIBUTION_
+    atexit(RPCClient_destroy);
+#endif
+}
+
+const void *
+RPCClient(void)
+{
+#ifndef _USE_COMPILER_ATTRIBUTION_
+    static pthread_once_t once = PTHREAD_ONCE_INIT;
+    pthread_once(&once, RPCClient_initialize);
+#endif
+    return _RPCClient;
+}
+
+/*
+ * RPC connection pool.
+ * Connections are kept per address, port and client class, the last of which determines the protocol.
+ */
+
+static pthread_mutex_t rpc_pool_mtx = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t rpc_pool_cond = PTHREAD_COND_INITIALIZER;
+static struct RPCPoolHost *rpc_pool_hosts;
+static double rpc_pool_idle_timeout = RPC_POOL_IDLE_TIMEOUT;
+static size_t rpc_pool_max_per_host = RPC_POOL_MAX_PER_HOST;
+
+static double
+rpc_pool_time(void)
+{
+    struct timespec tp;
+    
+    Clock_gettime(CLOCK_MONOTONIC, &tp);
+    
+    return tp.tv_sec + tp.tv_nsec / 1000000000.;
+}
+
+static bool
+rpc_pool_same(const char *s1, const char *s2)
+{
+    if (s1 == NULL || s2 == NULL) {
+        return s1 == s2;
+    }
+    
+    return strcmp(s1, s2) == 0;
+}
+
+/*
+ * An idle connection is healthy if the peer has neither closed it nor sent anything unsolicited.
+ */
+static bool
+rpc_pool_probe(void *rpc)
+{
+    char c;
+    ssize_t n;
+    
+    n = recv(tcp_socket_get_sockfd(rpc), &c, 1, MSG_PEEK | MSG_DONTWAIT);
+    
+    return n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+}
+
+/*
+ * The driver wrappers differ in the sign of the network errors of rpc_call, judge the code by its magnitude.
+ */
+static bool
+rpc_pool_network_error(int result)
+{
+    switch (result < 0 ? -1 * result : result) {
+        case AAOS_EBADMSG:
+        case AAOS_ECONNREFUSED:
+        case AAOS_ECONNRESET:
+        case AAOS_ECLOSED:
+        case AAOS_EHOSTUNREACH:
+        case AAOS_ENETDOWN:
+        case AAOS_ENETUNREACH:
+        case AAOS_EPIPE:
+        case AAOS_ETIMEDOUT:
+            return true;
+        default:
+            return false;
+    }
+}
+
+static struct RPCPoolHost *
+rpc_pool_host(const void *class, const char *address, const char *port)
+{
+    struct RPCPoolHost *host;
+    
+    for (host = rpc_pool_hosts; host != NULL; host = host->next) {
+        if (host->class == class && rpc_pool_same(host->address, address) && rpc_pool_same(host->port, port)) {
+            return host;
+        }
+    }
+    
+    host = (struct RPCPoolHost *) Malloc(sizeof(struct RPCPoolHost));
+    memset(host, '\0', sizeof(struct RPCPoolHost));
+    host->class = class;
+    if (address != NULL) {
+        host->address = (char *) Malloc(strlen(address) + 1);
+        snprintf(host->address, strlen(address) + 1, "%s", address);
+    }
+    if (port != NULL) {
+        host->port = (char *) Malloc(strlen(port) + 1);
+        snprintf(host->port, strlen(port) + 1, "%s", port);
+    }
+    host->next = rpc_pool_hosts;
+    rpc_pool_hosts = host;
+    
+    return host;
+}
+
+static struct RPCPoolConnection *
+rpc_pool_find_busy(void *rpc, struct RPCPoolHost **host)
+{
+    struct RPCPoolConnection *connection;
+    
+    for (*host = rpc_pool_hosts; *host != NULL; *host = (*host)->next) {
+        for (connection = (*host)->busy; connection != NULL; connection = connection->next) {
+            if (connection->rpc == rpc) {
+                return connection;
+            }
+        }
+    }
+    
+    return NULL;
+}
+
+void
+rpc_pool_configure(double idle_timeout, size_t max_per_host)
+{
+    Pthread_mutex_lock(&rpc_pool_mtx);
+    rpc_pool_idle_timeout = idle_timeout;
+    rpc_pool_max_per_host = max_per_host;
+    Pthread_cond_broadcast(&rpc_pool_cond);
+    Pthread_mutex_unlock(&rpc_pool_mtx);
+}
+
+int
+rpc_pool_get(void *client, void **rpc)
+{
+    struct RPCClient *self = cast(RPCClient(), client);
+    
+    struct RPCPoolHost *host;
+    struct RPCPoolConnection *connection, **cp;
+    double now;
+    int ret;
+    
+    Pthread_mutex_lock(&rpc_pool_mtx);
+    host = rpc_pool_host(classOf(self), self->_.address, self->_.port);
+    for (; ;) {
+        /*
+         * Close the connections which have been idle for too long, or are no longer healthy.
+         */
+        now = rpc_pool_time();
+        for (cp = &host->idle; (connection = *cp) != NULL;) {
+            if ((rpc_pool_idle_timeout > 0. && now - connection->last_used > rpc_pool_idle_timeout) || !rpc_pool_probe(connection->rpc)) {
+                *cp = connection->next;
+                delete(connection->rpc);
+                free(connection);
+            } else {
+                cp = &connection->next;
+            }
+        }
+        if ((connection = host->idle) != NULL) {
+            host->idle = connection->next;
+            ((struct RPC *) connection->rpc)->reused = true;
+            break;
+        }
+        if (rpc_pool_max_per_host == 0 || host->n_busy < rpc_pool_max_per_host) {
+            host->n_busy++;
+            Pthread_mutex_unlock(&rpc_pool_mtx);
+            ret = rpc_client_connect(client, rpc);
+            Pthread_mutex_lock(&rpc_pool_mtx);
+            if (ret != AAOS_OK) {
+                host->n_busy--;
+                Pthread_cond_signal(&rpc_pool_cond);
+                Pthread_mutex_unlock(&rpc_pool_mtx);
+                return ret;
+            }
+            connection = (struct RPCPoolConnection *) Malloc(sizeof(struct RPCPoolConnection));
+            connection->rpc = *rpc;
+            connection->next = host->busy;
+            host->busy = connection;
+            Pthread_mutex_unlock(&rpc_pool_mtx);
+            return AAOS_OK;
+        }
+        Pthread_cond_wait(&rpc_pool_cond, &rpc_pool_mtx);
+    }
+    host->n_busy++;
+    connection->next = host->busy;
+    host->busy = connection;
+    *rpc = connection->rpc;
+    Pthread_mutex_unlock(&rpc_pool_mtx);
+    
+    return AAOS_OK;
+}
+
+void
+rpc_pool_put(void *rpc, int result)
+{
+    struct RPCPoolHost *host;
+    struct RPCPoolConnection *connection, **cp;
+    uint16_t protocol;
+    
+    Pthread_mutex_lock(&rpc_pool_mtx);
+    if ((connection = rpc_pool_find_busy(rpc, &host)) == NULL) {
+        Pthread_mutex_unlock(&rpc_pool_mtx);
+        delete(rpc);
+        return;
+    }
+    for (cp = &host->busy; *cp != connection; cp = &(*cp)->next) {
+    }
+    *cp = connection->next;
+    host->n_busy--;
+    
+    /*
+     * A network failure leaves the connection in an unknown state, the next get reconnects.
+     */
+    ((struct RPC *) rpc)->reused = false;
+    if (rpc_pool_network_error(result) || !rpc_pool_probe(rpc)) {
+        delete(rpc);
+        free(connection);
+    } else {
+        protobuf_get(rpc, PACKET_PROTOCOL, &protocol);
+        memset(protobuf_header(rpc), '\0', PACKETHEADERSIZE);
+        protobuf_set(rpc, PACKET_PROTOCOL, protocol);
+        connection->last_used = rpc_pool_time();
+        connection->next = host->idle;
+        host->idle = connection;
+    }
+    Pthread_cond_signal(&rpc_pool_cond);
+    Pthread_mutex_unlock(&rpc_pool_mtx);
+}
+
+/*
+ * Reopen the connection of self, which has been taken from the pool, to the same peer.
+ */
+static int
+rpc_pool_reopen(struct RPC *self)
+{
+    struct RPCPoolHost *host;
+    char *address = NULL, *port = NULL;
+    int cfd;
+    
+    Pthread_mutex_lock(&rpc_pool_mtx);
+    if (rpc_pool_find_busy(self, &host) != NULL) {
+        address = host->address;
+        port = host->port;
+    }
+    Pthread_mutex_unlock(&rpc_pool_mtx);
+    
+    if (host == NULL || (cfd = RPCClient_open(address, port)) < 0) {
+        return AAOS_ECLOSED;
+    }
+    dup2(cfd, tcp_socket_get_sockfd(self));
+    Close(cfd);
+    
+    return AAOS_OK;
+}
+
+void
+rpc_pool_flush(void)
+{
+    struct RPCPoolHost *host;
+    struct RPCPoolConnection *connection;
+    
+    Pthread_mutex_lock(&rpc_pool_mtx);
+    for (host = rpc_pool_hosts; host != NULL; host = host->next) {
+        while ((connection = host->idle) != NULL) {
+            host->idle = connection->next;
+            delete(connection->rpc);
+            free(connection);
+        }
+    }
+    Pthread_mutex_unlock(&rpc_pool_mtx);
+}
+
+/*
+ * Event subscription, client side and publishing.
+ */
+
+static int
+RPC_subscription(struct RPC *self, uint16_t command, const char *pattern)
+{
+    struct Packet *packet;
+    struct RPCReply *reply, **last;
+    uint32_t id;
+    int ret;
+    
+    protobuf_set(self, PACKET_PROTOCOL, PROTO_SYSTEM);
+    protobuf_set(self, PACKET_COMMAND, command);
+    protobuf_set(self, PACKET_ERRORCODE, AAOS_OK);
+    protobuf_set(self, PACKET_BUF, pattern, strlen(pattern) + 1);
+    packet = rpc_packet(self);
+    if ((ret = RPC_write_packet(self, packet, (size_t) packet->length + PACKETHEADERSIZE)) != AAOS_OK) {
+        return -1 * ret;
+    }
+    
+    /*
+     * Keep the events which arrive before the acknowledgement for rpc_next_event.
+     */
+    for (last = &self->events; *last != NULL; last = &(*last)->next) {
+    }
+    for (;;) {
+        if ((ret = RPC_read_packet(self, &id)) != AAOS_OK) {
+            return ret;
+        }
+        packet = rpc_packet(self);
+        if (packet->protocol != PROTO_SYSTEM || packet->command != SYSTEM_COMMAND_EVENT) {
+            break;
+        }
+        reply = (struct RPCReply *) Malloc(sizeof(struct RPCReply) + PACKETHEADERSIZE + packet->length);
+        reply->next = NULL;
+        reply->result = AAOS_OK;
+        reply->length = PACKETHEADERSIZE + packet->length;
+        memcpy(reply->packet, packet, reply->length);
+        *last = reply;
+        last = &reply->next;
+    }
+    
+    return packet->errorcode;
 }
 
-static void *
-RPCClient_ctor(void *_self, va_list *app)
+int
+rpc_subscribe(void *_self, const char *pattern)
 {
-    struct RPCClient *self = super_ctor(RPCClient(), _self, app);
+    struct RPC *self = cast(RPC(), _self);
     
-    return (void *) self;
+    return RPC_subscription(self, SYSTEM_COMMAND_SUBSCRIBE, pattern);
 }
 
-static void *
-RPCClient_dtor(void *_self)
+int
+rpc_unsubscribe(void *_self, const char *pattern)
 {
-    //struct RPCClient *self = cast(RPCClient(), _self);
+    struct RPC *self = cast(RPC(), _self);
     
-    return super_dtor(RPCClient(), _self); 
+    return RPC_subscription(self, SYSTEM_COMMAND_UNSUBSCRIBE, pattern == NULL ? "" : pattern);
 }
 
-static void *
-RPCClientClass_ctor(void *_self, va_list *app)
+int
+rpc_next_event(void *_self, double timeout, const char **topic, const void **event, size_t *size)
 {
-    struct RPCClientClass *self = super_ctor(RPCClientClass(), _self, app);
-    Method selector;
+    struct RPC *self = cast(RPC(), _self);
     
-#ifdef va_copy
-    va_list ap;
-    va_copy(ap, *app);
-#else
-    va_list ap = *app;
-#endif
+    struct RPCReply *reply;
+    struct Packet *packet;
+    struct pollfd pfd;
+    uint32_t id;
+    size_t topic_size;
+    int ret;
     
-    while ((selector = va_arg(ap, Method))) {
-        const char *tag = va_arg(ap, const char *);
-        Method method = va_arg(ap, Method);
-        
-        if (selector == (Method) rpc_client_connect) {
-            if (tag) {
-                self->connect.tag = tag;
-                self->connect.selector = selector;
+    if ((reply = self->events) != NULL) {
+        self->events = reply->next;
+        if (protobuf_payload(self) < reply->length - PACKETHEADERSIZE && (ret = protobuf_reallocate(self, reply->length - PACKETHEADERSIZE)) != AAOS_OK) {
+            free(reply);
+            return ret;
+        }
+        memcpy(protobuf_header(self), reply->packet, reply->length);
+        free(reply);
+    } else {
+        if (timeout >= 0. && !tcp_socket_shm_enabled(self)) {
+            pfd.fd = tcp_socket_get_sockfd(self);
+            pfd.events = POLLIN;
+            while ((ret = poll(&pfd, 1, (int) (timeout * 1000.))) < 0 && errno == EINTR) {
             }
-            self->connect.method = method;
-            continue;
+            if (ret == 0) {
+                return AAOS_ETIMEDOUT;
+            } else if (ret < 0) {
+                return -1 * AAOS_ERROR;
+            }
+        }
+        if ((ret = RPC_read_packet(self, &id)) != AAOS_OK) {
+            return ret;
         }
     }
     
-#ifdef va_copy
-    va_end(ap);
-#endif
+    packet = rpc_packet(self);
+    if (packet->protocol != PROTO_SYSTEM || packet->command != SYSTEM_COMMAND_EVENT) {
+        return AAOS_EBADMSG;
+    }
+    if ((topic_size = strnlen(packet->buf, packet->length)) == packet->length) {
+        return AAOS_EBADMSG;
+    }
+    *topic = packet->buf;
+    *event = packet->buf + topic_size + 1;
+    *size = packet->length - topic_size - 1;
     
-    return self;
-}
-
-static const void *_RPCClientClass;
-
-static void
-RPCClientClass_destroy(void)
-{
-    free((void *)_RPCClientClass);
-}
-
-static void
-RPCClientClass_initialize(void)
-{
-    _RPCClientClass = new(TCPClientClass(), "RPCClientClass", TCPClientClass(), sizeof(struct RPCClientClass),
-                          ctor, "ctor", RPCClientClass_ctor,
-                          (void *) 0);
-#ifndef _USE_COMPILER_ATTRIBUTION_
-    atexit(RPCClientClass_destroy);
-#endif
-}
-
-const void *
-RPCClientClass(void)
-{
-#ifndef _USE_COMPILER_ATTRIBUTION_
-    static pthread_once_t once = PTHREAD_ONCE_INIT;
-    pthread_once(&once, RPCClientClass_initialize);
-#endif
-    return _RPCClientClass;
-}
-
-static const void *_RPCClient;
-
-static void
-RPCClient_destroy(void)
-{
-    free((void *)_RPCClient);
+    return AAOS_OK;
 }
 
-static void
-RPCClient_initialize(void)
+bool
+rpc_has_subscriber(void)
 {
-    _RPCClient = new(RPCClientClass(), "RPCClient", TCPClient(), sizeof(struct RPCClient),
-                     ctor, "ctor", RPCClient_ctor,
-                     ctor, "ctor", RPCClient_ctor,
-                     dtor, "dtor", RPCClient_dtor,
-                     forward, "forward", RPCClient_forward,
-                     rpc_client_connect, "connect", RPCClient_connect,
-                     (void *) 0);
-#ifndef _USE_COMPILER_ATTRIBUTION_
-    atexit(RPCClient_destroy);
-#endif
+    return __atomic_load_n(&rpc_n_subscriber, __ATOMIC_RELAXED) != 0;
 }
 
-const void *
-RPCClient(void)
+int
+rpc_publish(const char *topic, const void *event, size_t size)
 {
-#ifndef _USE_COMPILER_ATTRIBUTION_
-    static pthread_once_t once = PTHREAD_ONCE_INIT;
-    pthread_once(&once, RPCClient_initialize);
-#endif
-    return _RPCClient;
+    struct RPCSubscriber *subscriber;
+    struct RPCSubscription *subscription;
+    struct RPCEvent *e, *victim, **p;
+    struct Packet header;
+    struct timespec tp;
+    size_t topic_size, length;
+    bool notify = false;
+    
+    if (!rpc_has_subscriber()) {
+        return AAOS_OK;
+    }
+    
+    topic_size = strlen(topic) + 1;
+    length = sizeof(struct Packet) + topic_size + size;
+    memset(&header, '\0', sizeof(struct Packet));
+    header.protocol = PROTO_SYSTEM;
+    header.command = SYSTEM_COMMAND_EVENT;
+    header.length = (uint32_t) (topic_size + size);
+    Clock_gettime(CLOCK_REALTIME, &tp);
+    header.carrier.df[1] = tp.tv_sec + tp.tv_nsec / 1000000000.;
+    
+    Pthread_mutex_lock(&rpc_event_mtx);
+    for (subscriber = rpc_subscribers; subscriber != NULL; subscriber = subscriber->next) {
+        if (subscriber->closed) {
+            continue;
+        }
+        for (subscription = subscriber->subscriptions; subscription != NULL; subscription = subscription->next) {
+            if (fnmatch(subscription->pattern, topic, 0) == 0) {
+                break;
+            }
+        }
+        if (subscription == NULL) {
+            continue;
+        }
+        if ((e = (struct RPCEvent *) Malloc(sizeof(struct RPCEvent) + length)) == NULL) {
+            continue;
+        }
+        e->next = NULL;
+        e->length = length;
+        e->offset = 0;
+        header.carrier.u64[0] = ++subscriber->sequence;
+        memcpy(e->packet, &header, sizeof(struct Packet));
+        memcpy(e->packet + sizeof(struct Packet), topic, topic_size);
+        memcpy(e->packet + sizeof(struct Packet) + topic_size, event, size);
+        /*
+         * Drop the oldest event of a slow subscriber, unless it is being sent.
+         */
+        if (subscriber->n_event >= RPC_EVENT_QUEUE_SIZE) {
+            p = subscriber->head->offset == 0 ? &subscriber->head : &subscriber->head->next;
+            if ((victim = *p) != NULL) {
+                *p = victim->next;
+                if (subscriber->tail == victim) {
+                    subscriber->tail = subscriber->head;
+                }
+                subscriber->n_event--;
+                free(victim);
+            }
+        }
+        if (subscriber->tail == NULL) {
+            subscriber->head = e;
+        } else {
+            subscriber->tail->next = e;
+        }
+        subscriber->tail = e;
+        subscriber->n_event++;
+        notify = true;
+    }
+    if (notify) {
+        Pthread_cond_signal(&rpc_event_cond);
+    }
+    Pthread_mutex_unlock(&rpc_event_mtx);
+    
+    return AAOS_OK;
 }
 
 /*
@@ -1168,84 +3050,384 @@ RPCServerVirtualTable(void)
 }
 
 /*
- * RPC server class.
+ * RPC server class.
+ */
+
+int
+rpc_server_accept(void *_self, void **client)
+{
+    struct RPCServerClass *class = (struct RPCServerClass *) classOf(_self);
+    
+    int result;
+    if (isOf(class, RPCServerClass()) && class->accept.method) {
+       return ((int (*)(void *, void **)) class->accept.method)(_self, client);
+    } else {
+        forward(_self, &result, (Method) rpc_server_accept, "accept", _self, client);
+        return result;
+    }
+}
+
+static int
+RPCServer_accept(void *_self, void **client)
+{
+    struct RPCServer *self = cast(RPCServer(), _self);
+    
+    int cfd;
+    
+    cfd = rpc_server_accept_fd(self, TCPSERVER_OPTION_TCP);
+    if (cfd < 0) {
+        *client = NULL;
+        return AAOS_ERROR;
+    } else {
+        *client = new(RPC(), cfd);
+        return AAOS_OK;
+    }
+}
+
+int
+rpc_server_accept2(void *_self, void **client)
+{
+    struct RPCServerClass *class = (struct RPCServerClass *) classOf(_self);
+    
+    int result;
+    if (isOf(class, RPCServerClass()) && class->accept2.method) {
+       return ((int (*)(void *, void **)) class->accept2.method)(_self, client);
+    } else {
+        forward(_self, &result, (Method) rpc_server_accept2, "accept2", _self, client);
+        return result;
+    }
+}
+
+static int
+RPCServer_accept2(void *_self, void **client)
+{
+    struct RPCServer *self = cast(RPCServer(), _self);
+    
+    int cfd;
+    
+    cfd = rpc_server_accept_fd(self, TCPSERVER_OPTION_UDS);
+    if (cfd < 0) {
+        *client = NULL;
+        return AAOS_ERROR;
+    } else {
+        *client = new(RPC(), cfd);
+        return AAOS_OK;
+    }
+}
+
+void
+rpc_server_start(void *_self)
+{
+    struct RPCServerClass *class = (struct RPCServerClass *) classOf(_self);
+    
+    if (isOf(class, RPCServerClass()) && class->start.method) {
+       return ((void (*)(void *)) class->start.method)(_self);
+    } else {
+       forward(_self, 0, (Method) rpc_server_start, "start", _self);
+    }
+}
+
+/*
+ * Accept subsystem.
+ */
+
+/*
+ * Listening socket of the event loop running in this thread, when it has one of its own.
+ */
+static __thread int rpc_server_shard_lfd = -1;
+
+/*
+ * Count a connection refused over the limits, and log the refusals, rate-limited.
+ * peer is NULL when the connection is closed before its address is known.
+ */
+static void
+RPCServer_refuse(struct RPCServer *self, const char *peer)
+{
+    struct RPCAdmission *admission = &self->admission;
+    struct timespec tp;
+    double now;
+    
+    Clock_gettime(CLOCK_MONOTONIC, &tp);
+    now = tp.tv_sec + tp.tv_nsec / 1000000000.;
+    Pthread_mutex_lock(&admission->mtx);
+    admission->n_refused++;
+    admission->n_unlogged++;
+    if (admission->last_log == 0. || now - admission->last_log >= RPC_SERVER_REFUSE_LOG_INTERVAL) {
+        syslog(LOG_WARNING, "%llu connection(s) refused over the limits, %zu open, last from %s, %llu refused in all.",
+               (unsigned long long) admission->n_unlogged, admission->n_connection,
+               (peer != NULL && peer[0] != '\0') ? peer : "an unknown peer", (unsigned long long) admission->n_refused);
+        admission->n_unlogged = 0;
+        admission->last_log = now;
+    }
+    Pthread_mutex_unlock(&admission->mtx);
+}
+
+int
+rpc_server_accept_fd(void *_self, unsigned int listener)
+{
+    struct RPCServer *self = cast(RPCServer(), _self);
+    
+    int lfd, cfd, lfds[2];
+    
+    if (listener == TCPSERVER_OPTION_UDS) {
+        tcp_server_get_lfds(self, lfds);
+        lfd = lfds[1];
+    } else if (rpc_server_shard_lfd >= 0) {
+        lfd = rpc_server_shard_lfd;
+    } else {
+        lfd = tcp_server_get_lfd(self);
+    }
+    
+    /*
+     * Accepted sockets stay blocking, the packet reader cannot resume a partial read.
+     */
+    while ((cfd = Accept4(lfd, NULL, NULL, SOCK_CLOEXEC)) < 0) {
+        if (errno == EINTR || errno == ECONNABORTED) {
+            continue;
+        }
+        if (errno == EMFILE || errno == ENFILE || errno == ENOBUFS || errno == ENOMEM) {
+            /*
+             * Out of descriptors, back off instead of spinning on a listening socket which stays readable.
+             */
+            Nanosleep(0.1);
+        }
+        return -1;
+    }
+    
+    if (self->_.max_connections > 0 && __atomic_load_n(&self->admission.n_connection, __ATOMIC_RELAXED) >= self->_.max_connections) {
+        Close(cfd);
+        RPCServer_refuse(self, NULL);
+        return -1;
+    }
+    
+    return cfd;
+}
+
+void
+rpc_server_get_stats(const void *_self, struct RPCServerStats *stats)
+{
+    struct RPCServer *self = cast(RPCServer(), _self);
+    
+    Pthread_mutex_lock(&self->admission.mtx);
+    stats->n_connection = self->admission.n_connection;
+    stats->n_refused = self->admission.n_refused;
+    Pthread_mutex_unlock(&self->admission.mtx);
+}
+
+/*
+ * Count an accepted connection against the limits of the server, it is refused with AAOS_EBUSY.
  */
+static int
+RPCServer_admit(struct RPCServer *self, void *client, bool tcp)
+{
+    struct RPCAdmission *admission = &self->admission;
+    struct RPCConnection *connection, *p;
+    struct sockaddr_storage addr;
+    socklen_t addrlen = sizeof(addr);
+    struct timespec tp;
+    size_t n_peer = 0;
+    
+    if (self->_.max_connections == 0 && self->_.max_per_peer == 0 && self->_.idle_timeout <= 0.) {
+        return AAOS_OK;
+    }
+    
+    connection = (struct RPCConnection *) Malloc(sizeof(struct RPCConnection));
+    memset(connection, '\0', sizeof(struct RPCConnection));
+    connection->admission = admission;
+    connection->rpc = client;
+    Clock_gettime(CLOCK_MONOTONIC, &tp);
+    connection->last_active = tp.tv_sec + tp.tv_nsec / 1000000000.;
+    if (tcp && getpeername(tcp_socket_get_sockfd(client), (struct sockaddr *) &addr, &addrlen) == 0) {
+        if (getnameinfo((struct sockaddr *) &addr, addrlen, connection->peer, sizeof(connection->peer), NULL, 0, NI_NUMERICHOST) != 0) {
+            connection->peer[0] = '\0';
+        }
+    }
+    
+    Pthread_mutex_lock(&admission->mtx);
+    if (self->_.max_per_peer > 0 && connection->peer[0] != '\0') {
+        for (p = admission->head; p != NULL; p = p->next) {
+            if (strcmp(p->peer, connection->peer) == 0) {
+                n_peer++;
+            }
+        }
+    }
+    if ((self->_.max_connections > 0 && admission->n_connection >= self->_.max_connections) || (self->_.max_per_peer > 0 && n_peer >= self->_.max_per_peer)) {
+        Pthread_mutex_unlock(&admission->mtx);
+        RPCServer_refuse(self, connection->peer);
+        free(connection);
+        return AAOS_EBUSY;
+    }
+    connection->next = admission->head;
+    if (admission->head != NULL) {
+        admission->head->prev = connection;
+    }
+    admission->head = connection;
+    __atomic_add_fetch(&admission->n_connection, 1, __ATOMIC_RELAXED);
+    cast(RPC(), client);
+    ((struct RPC *) client)->connection = connection;
+    Pthread_mutex_unlock(&admission->mtx);
+    
+    return AAOS_OK;
+}
 
-int
-rpc_server_accept(void *_self, void **client)
+static void
+RPCConnection_release(struct RPCConnection *connection)
 {
-    struct RPCServerClass *class = (struct RPCServerClass *) classOf(_self);
+    struct RPCAdmission *admission = connection->admission;
     
-    int result;
-    if (isOf(class, RPCServerClass()) && class->accept.method) {
-       return ((int (*)(void *, void **)) class->accept.method)(_self, client);
+    Pthread_mutex_lock(&admission->mtx);
+    if (connection->prev != NULL) {
+        connection->prev->next = connection->next;
     } else {
-        forward(_self, &result, (Method) rpc_server_accept, "accept", _self, client);
-        return result;
+        admission->head = connection->next;
+    }
+    if (connection->next != NULL) {
+        connection->next->prev = connection->prev;
     }
+    __atomic_sub_fetch(&admission->n_connection, 1, __ATOMIC_RELAXED);
+    Pthread_mutex_unlock(&admission->mtx);
+    free(connection);
 }
 
-static int
-RPCServer_accept(void *_self, void **client)
+/*
+ * Shut down idle connections, the threads serving them see the end of file and delete them.
+ * A connection is unlinked in its destructor before its socket is closed, so the socket is still open here.
+ */
+static void *
+RPCServer_reaper_thr(void *arg)
 {
-    struct RPCServer *self = cast(RPCServer(), _self);
+    struct RPCServer *self = (struct RPCServer *) arg;
+    struct RPCConnection *connection;
+    struct RPCPipeline *pipeline;
+    struct RPC *rpc;
+    struct timespec tp;
+    double now, last_active, last_reply;
     
-    int lfd, cfd;
+    Pthread_detach(pthread_self());
     
-    lfd = tcp_server_get_lfd(self);
-    cfd = Accept(lfd, NULL, NULL);
-    if (cfd < 0) {
-        *client = NULL;
-        return AAOS_ERROR;
-    } else {
-        *client = new(RPC(), cfd);
-        return AAOS_OK;
+    for (;;) {
+        Nanosleep(self->_.idle_timeout / 2.);
+        Clock_gettime(CLOCK_MONOTONIC, &tp);
+        now = tp.tv_sec + tp.tv_nsec / 1000000000.;
+        Pthread_mutex_lock(&self->admission.mtx);
+        for (connection = self->admission.head; connection != NULL; connection = connection->next) {
+            rpc = (struct RPC *) connection->rpc;
+            if (connection->reaped || rpc->subscriber != NULL || __atomic_load_n(&connection->busy, __ATOMIC_ACQUIRE)) {
+                continue;
+            }
+            __atomic_load(&connection->last_active, &last_active, __ATOMIC_RELAXED);
+            if ((pipeline = __atomic_load_n(&rpc->pipeline, __ATOMIC_ACQUIRE)) != NULL) {
+                if (__atomic_load_n(&pipeline->in_flight, __ATOMIC_ACQUIRE) != 0) {
+                    continue;
+                }
+                __atomic_load(&pipeline->last_reply, &last_reply, __ATOMIC_RELAXED);
+                if (last_reply > last_active) {
+                    last_active = last_reply;
+                }
+            }
+            if (now - last_active > self->_.idle_timeout) {
+                shutdown(tcp_socket_get_sockfd(connection->rpc), SHUT_RDWR);
+                connection->reaped = true;
+            }
+        }
+        Pthread_mutex_unlock(&self->admission.mtx);
     }
+    
+    return NULL;
 }
 
-int
-rpc_server_accept2(void *_self, void **client)
+/*
+ * Apply the socket policy of the server to an accepted TCP connection.
+ */
+static void
+RPCServer_set_policy(struct RPCServer *self, void *client)
 {
-    struct RPCServerClass *class = (struct RPCServerClass *) classOf(_self);
+    unsigned int option = 0;
     
-    int result;
-    if (isOf(class, RPCServerClass()) && class->accept2.method) {
-       return ((int (*)(void *, void **)) class->accept2.method)(_self, client);
-    } else {
-        forward(_self, &result, (Method) rpc_server_accept2, "accept2", _self, client);
-        return result;
+    if (self->_.option & TCPSERVER_OPTION_NODELAY) {
+        option |= TCPSOCKET_OPTION_NODELAY;
+    }
+    if (self->_.option & TCPSERVER_OPTION_CORK) {
+        option |= TCPSOCKET_OPTION_CORK;
+    }
+    if (option != 0) {
+        tcp_socket_set_option(client, option);
     }
 }
 
+/*
+ * A listening socket, with the accept selector of its kind.
+ */
+struct RPCServerListener {
+    struct RPCServer *server;
+    int lfd;
+    int (*accept)(void *, void **);
+    bool tcp;
+};
+
+/*
+ * Accept a connection, admit it, and apply the socket policy.
+ * AAOS_EBUSY means a connection has been refused, and there may be more to accept.
+ */
 static int
-RPCServer_accept2(void *_self, void **client)
+RPCServer_accept_client(struct RPCServerListener *listener, void **client)
 {
-    struct RPCServer *self = cast(RPCServer(), _self);
+    struct RPCServer *self = listener->server;
     
-    int lfd, cfd, lfds[2];
+    if (listener->accept(self, client) != AAOS_OK) {
+        return AAOS_ERROR;
+    }
+    if (RPCServer_admit(self, *client, listener->tcp) != AAOS_OK) {
+        delete(*client);
+        *client = NULL;
+        return AAOS_EBUSY;
+    }
+    if (listener->tcp) {
+        RPCServer_set_policy(self, *client);
+    }
     
-    tcp_server_get_lfds(self, lfds);
-    lfd = lfds[1];
+    return AAOS_OK;
+}
+
+/*
+ * Bound the time a connection of a non-blocking mode may stall in the middle of a packet or a reply.
+ * Requests are only read once poll(2), epoll or kqueue has seen them arrive.
+ */
+static void
+RPCServer_set_timeout(struct RPCServer *self, void *client)
+{
+    struct timeval tv;
+    int sockfd = tcp_socket_get_sockfd(client);
     
-    cfd = Accept(lfd, NULL, NULL);
-    if (cfd < 0) {
-        *client = NULL;
-        return AAOS_ERROR;
-    } else {
-        *client = new(RPC(), cfd);
-        return AAOS_OK;
+    if (self->_.timeout <= 0.) {
+        return;
     }
+    tv.tv_sec = (time_t) floor(self->_.timeout);
+    tv.tv_usec = (suseconds_t) ((self->_.timeout - tv.tv_sec) * 1000000);
+    setsockopt(sockfd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(sockfd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
 }
 
-void
-rpc_server_start(void *_self)
+/*
+ * Serve the requests a connection has sent so far.
+ * Return AAOS_EAGAIN once it has to wait for more, AAOS_OK if it has moved to shared memory,
+ * or AAOS_ECLOSED if it has been closed or has failed.
+ */
+static int
+RPCServer_drain(void *client)
 {
-    struct RPCServerClass *class = (struct RPCServerClass *) classOf(_self);
+    char c;
     
-    if (isOf(class, RPCServerClass()) && class->start.method) {
-       return ((void (*)(void *)) class->start.method)(_self);
-    } else {
-       forward(_self, 0, (Method) rpc_server_start, "start", _self);
+    for (;;) {
+        if (rpc_process(client) != AAOS_OK) {
+            return AAOS_ECLOSED;
+        }
+        if (tcp_socket_shm_enabled(client)) {
+            return AAOS_OK;
+        }
+        if (recv(tcp_socket_get_sockfd(client), &c, 1, MSG_PEEK | MSG_DONTWAIT) < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return AAOS_EAGAIN;
+        }
     }
 }
 
@@ -1267,119 +3449,270 @@ RPCServer_process_thr(void *arg)
     return NULL;
 }
 
+static void *
+RPCServer_process_nb_thr(void *arg)
+{
+    struct pollfd pfd;
+    int ret;
+    
+    Pthread_detach(pthread_self());
+    
+    pfd.fd = tcp_socket_get_sockfd(arg);
+    pfd.events = POLLIN;
+    for (;;) {
+        if ((ret = poll(&pfd, 1, -1)) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        if ((ret = RPCServer_drain(arg)) == AAOS_OK) {
+            while (rpc_process(arg) == AAOS_OK) {
+            }
+            break;
+        } else if (ret != AAOS_EAGAIN) {
+            break;
+        }
+    }
+    
+    delete(arg);
+    
+    return NULL;
+}
+
+/*
+ * Accept queue of BLOCK_PRETHEADED mode.
+ */
+struct RPCServerQueue {
+    pthread_mutex_t mtx;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+    void **clients;
+    size_t capacity;
+    size_t head;
+    size_t n;
+};
+
+static void *
+RPCServer_worker_thr(void *arg)
+{
+    struct RPCServerQueue *queue = (struct RPCServerQueue *) arg;
+    void *client;
+    
+    for (;;) {
+        Pthread_mutex_lock(&queue->mtx);
+        while (queue->n == 0) {
+            Pthread_cond_wait(&queue->not_empty, &queue->mtx);
+        }
+        client = queue->clients[queue->head];
+        queue->head = (queue->head + 1) % queue->capacity;
+        queue->n--;
+        Pthread_cond_signal(&queue->not_full);
+        Pthread_mutex_unlock(&queue->mtx);
+        
+        while (rpc_process(client) == AAOS_OK) {
+        }
+        delete(client);
+    }
+    
+    return NULL;
+}
+
+static void
+RPCServer_serve_prethreaded(struct RPCServerListener *listener)
+{
+    struct RPCServer *self = listener->server;
+    struct RPCServerQueue queue;
+    pthread_t *tids;
+    void *client;
+    size_t i;
+    
+    Pthread_mutex_init(&queue.mtx, NULL);
+    Pthread_cond_init(&queue.not_empty, NULL);
+    Pthread_cond_init(&queue.not_full, NULL);
+    queue.capacity = self->_.max_events;
+    queue.clients = (void **) Malloc(sizeof(void *) * queue.capacity);
+    queue.head = 0;
+    queue.n = 0;
+    
+    tids = (pthread_t *) Malloc(sizeof(pthread_t) * self->_.n_threads);
+    for (i = 0; i < self->_.n_threads; i++) {
+        Pthread_create(&tids[i], NULL, RPCServer_worker_thr, &queue);
+    }
+    
+    /*
+     * When every worker is busy and the queue is full, stop accepting
+     * and leave the connections in the backlog of the listening socket.
+     */
+    for (;;) {
+        if (RPCServer_accept_client(listener, &client) != AAOS_OK) {
+            continue;
+        }
+        Pthread_mutex_lock(&queue.mtx);
+        while (queue.n == queue.capacity) {
+            Pthread_cond_wait(&queue.not_full, &queue.mtx);
+        }
+        queue.clients[(queue.head + queue.n) % queue.capacity] = client;
+        queue.n++;
+        Pthread_cond_signal(&queue.not_empty);
+        Pthread_mutex_unlock(&queue.mtx);
+    }
+    
+    for (i = 0; i < self->_.n_threads; i++) {
+        Pthread_join(tids[i], NULL);
+    }
+    free(tids);
+    free(queue.clients);
+}
+
 static void *
 RPCServer_process_thr2(void *arg)
 {
-    struct RPCServer *self = (struct RPCServer *) arg;
+    struct RPCServerListener *listener = (struct RPCServerListener *) arg;
+    struct RPCServer *self = listener->server;
 
-    int lfd = self->_.lfd, sockfd, ret, n_events;
+    int lfd = listener->lfd, sockfd, ret, n_events;
     size_t i;
+    pthread_t tid;
+    void *client;
+
+    if (listener->tcp) {
+        rpc_server_shard_lfd = lfd;
+    }
 
 #ifdef LINUX
     int efd = epoll_create(1);
     struct epoll_event ev, *events;
 
+    /*
+     * The listening socket is level-triggered, so that connections left over
+     * after a refused or failed accept are reported again.
+     */
     events = (struct epoll_event *) Malloc(sizeof(struct epoll_event) * self->_.max_events);
-    ev.events = EPOLLIN | EPOLLET | EPOLLEXCLUSIVE;
-    ev.data.ptr = self;
+    ev.events = EPOLLIN | EPOLLEXCLUSIVE;
+    ev.data.ptr = listener;
     epoll_ctl(efd, EPOLL_CTL_ADD, lfd, &ev);
-    int timeout = self->_.timeout * 1000;
     for (;;) {
-        n_events = epoll_wait(efd, events, self->_.max_events, timeout);
+        n_events = epoll_wait(efd, events, self->_.max_events, -1);
         for (i = 0; i < n_events; i++) {
-            if (events[i].data.ptr == self) {
-                void *client;
+            if (events[i].data.ptr == listener) {
                 for (;;) {
-                    ret = rpc_server_accept(self, &client);
-                    if (ret != AAOS_OK) {
+                    ret = RPCServer_accept_client(listener, &client);
+                    if (ret == AAOS_EBUSY) {
+                        continue;
+                    } else if (ret != AAOS_OK) {
                         break;
                     }
+                    RPCServer_set_timeout(self, client);
                     ev.events = EPOLLIN | EPOLLET;
                     ev.data.ptr = client;
                     sockfd = tcp_socket_get_sockfd(client);
                     epoll_ctl(efd, EPOLL_CTL_ADD, sockfd, &ev);
                 }
             } else {
-                for (;;) {
-                    ret = rpc_process(events[i].data.ptr);
-                    if (ret == AAOS_OK) {
-                        continue;
-                    } else if (ret == AAOS_EAGAIN) {
-                        break;
-                    } else {
-                        sockfd = tcp_socket_get_sockfd(events[i].data.ptr);
-                        epoll_ctl(efd, EPOLL_CTL_DEL, sockfd, NULL);
-                        delete(events[i].data.ptr);
-                        break;
-                    }
+                client = events[i].data.ptr;
+                ret = RPCServer_drain(client);
+                if (ret == AAOS_EAGAIN) {
+                    continue;
+                }
+                sockfd = tcp_socket_get_sockfd(client);
+                epoll_ctl(efd, EPOLL_CTL_DEL, sockfd, NULL);
+                if (ret == AAOS_OK) {
+                    /*
+                     * Shared memory is not watched by the loop, the connection gets a thread of its own.
+                     */
+                    Pthread_create(&tid, NULL, RPCServer_process_thr, client);
+                } else {
+                    delete(client);
                 }
             }
         }
     }
 
-error:
     Close(efd);
     free(events);
 #endif 
 
 #ifdef MACOSX
-    int kq, cfd, j = 1;
+    int kq, cfd, n_changes;
     struct kevent *changelist, *eventlist;
-    struct timespec tp;
-    void *client;
-
-    tp.tv_sec = floor(self->_.timeout);
-    tp.tv_nsec = (self->_.timeout - tp.tv_sec) * 1000000000;
 
     kq = kqueue();
     eventlist = (struct kevent *) Malloc(sizeof(struct kevent) * self->_.max_events);
     changelist = (struct kevent *) Malloc(sizeof(struct kevent) * self->_.max_events);
-    EV_SET(&changelist[0], lfd, EVFILT_READ, EV_ADD, 0, 0, &self);
+    /*
+     * The listening socket is level-triggered, so that connections left over
+     * when changelist is full are reported again, connections are edge-triggered.
+     */
+    EV_SET(&changelist[0], lfd, EVFILT_READ, EV_ADD, 0, 0, listener);
+    n_changes = 1;
     for (;;) {
-        n_events = kevent(kq, changelist, j, eventlist, self->_.max_events, &tp);
+        n_events = kevent(kq, changelist, n_changes, eventlist, self->_.max_events, NULL);
+        n_changes = 0;
         for (i = 0; i < n_events; i++) {
-            if (eventlist[i].udata == self) {
-                for (j = 1; j < self->_.max_events; j++) {
-                    ret = rpc_server_accept(self, &client);
-                    if (ret != AAOS_OK) {
+            if (eventlist[i].udata == listener) {
+                while (n_changes < self->_.max_events) {
+                    ret = RPCServer_accept_client(listener, &client);
+                    if (ret == AAOS_EBUSY) {
+                        continue;
+                    } else if (ret != AAOS_OK) {
                         break;
                     }
+                    RPCServer_set_timeout(self, client);
                     cfd = tcp_socket_get_sockfd(client);
-                    EV_SET(&changelist[j], cfd, EVFILT_READ, EV_ADD, 0, 0, client);
+                    EV_SET(&changelist[n_changes], cfd, EVFILT_READ, EV_ADD | EV_CLEAR, 0, 0, client);
+                    n_changes++;
                 }
             } else {
-                for (;;) {
-                    ret = rpc_process(changelist[i].udata);
-                    if (ret == AAOS_OK) {
-                        continue;
-                    } else if (ret == AAOS_EAGAIN) {
-                        break;
-                    } else {
-                        delete(changelist[i].udata);
-                        break;
-                    }
+                client = eventlist[i].udata;
+                ret = RPCServer_drain(client);
+                if (ret == AAOS_EAGAIN) {
+                    continue;
+                }
+                /*
+                 * Closing the socket removes it from kq.
+                 */
+                if (ret == AAOS_OK) {
+                    EV_SET(&changelist[n_changes], tcp_socket_get_sockfd(client), EVFILT_READ, EV_DELETE, 0, 0, NULL);
+                    kevent(kq, &changelist[n_changes], 1, NULL, 0, NULL);
+                    Pthread_create(&tid, NULL, RPCServer_process_thr, client);
+                } else {
+                    delete(client);
                 }
             }
         }
     }
-error:
+
     free(changelist);
     free(eventlist);
     Close(kq);
-    free(eventlist);
 #endif
 
     return NULL;
 }
 
+/*
+ * Mode of the server, a mode set by tcp_server_set_option replaces the default.
+ */
+static uint16_t
+RPCServer_mode(struct RPCServer *self)
+{
+    uint16_t mode = self->_.option & TCPSERVER_OPTION_MODE_MASK;
 
-static void *
-RPCServer_start_tcp_thr(void *arg)
+    if (mode & ~TCPSERVER_OPTION_BLOCK_PERTHREAD) {
+        mode &= ~TCPSERVER_OPTION_BLOCK_PERTHREAD;
+    }
+    
+    return mode & -mode;
+}
+
+static void
+RPCServer_serve(struct RPCServerListener *listener)
 {
-    struct RPCServer *self = (struct RPCServer *) arg;
+    struct RPCServer *self = listener->server;
     
+    struct RPCServerListener *listeners;
     void *client;
-    uint16_t option = self->_.option&(~(TCPSERVER_OPTION_TCP|TCPSERVER_OPTION_UDS));
     pthread_t tid, *tids;
     size_t i;
     sigset_t set;
@@ -1389,28 +3722,60 @@ RPCServer_start_tcp_thr(void *arg)
     sigaddset(&set, SIGPIPE);
     Pthread_sigmask(SIG_BLOCK, &set, NULL);
     
-    switch (option) {
+    switch (RPCServer_mode(self)) {
         case TCPSERVER_OPTION_BLOCK_PERTHREAD:
             for (;;) {
-                if ((ret = rpc_server_accept(self, &client)) == AAOS_OK) {
+                if ((ret = RPCServer_accept_client(listener, &client)) == AAOS_OK) {
                     Pthread_create(&tid, NULL, RPCServer_process_thr, client);
                 }
             }
             break;
+        case TCPSERVER_OPTION_NONBLOCK_PERTHREAD:
+            for (;;) {
+                if ((ret = RPCServer_accept_client(listener, &client)) == AAOS_OK) {
+                    RPCServer_set_timeout(self, client);
+                    Pthread_create(&tid, NULL, RPCServer_process_nb_thr, client);
+                }
+            }
+            break;
+        case TCPSERVER_OPTION_BLOCK_PRETHEADED:
+            RPCServer_serve_prethreaded(listener);
+            break;
         case TCPSERVER_OPTION_NONBLOCK_PRETHEADED:
-            Fcntl(self->_.lfd, F_SETFL, O_NONBLOCK);
             tids = (pthread_t *) Malloc(sizeof(pthread_t) * self->_.n_threads);
+            listeners = (struct RPCServerListener *) Malloc(sizeof(struct RPCServerListener) * self->_.n_threads);
             for (i = 0; i < self->_.n_threads; i ++) {
-                Pthread_create(&tids[i], NULL, RPCServer_process_thr2, self);
+                listeners[i] = *listener;
+                if (i > 0 && listener->tcp && (self->_.option & TCPSERVER_OPTION_REUSEPORT)) {
+                    if ((listeners[i].lfd = Tcp_listen_reuseport(self->_.address, self->_.port)) < 0) {
+                        listeners[i].lfd = listener->lfd;
+                    }
+                }
+                Fcntl(listeners[i].lfd, F_SETFL, O_NONBLOCK);
+                Pthread_create(&tids[i], NULL, RPCServer_process_thr2, &listeners[i]);
             }
             for (i = 0; i < self->_.n_threads; i++) {
                 Pthread_join(tids[i], NULL);
             }
+            free(listeners);
             free(tids);
             break;
         default:
             break;
     }
+}
+
+static void *
+RPCServer_start_tcp_thr(void *arg)
+{
+    struct RPCServer *self = (struct RPCServer *) arg;
+    struct RPCServerListener listener;
+    
+    listener.server = self;
+    listener.lfd = self->_.lfd;
+    listener.accept = rpc_server_accept;
+    listener.tcp = true;
+    RPCServer_serve(&listener);
     
     return NULL;
 }
@@ -1419,40 +3784,13 @@ static void *
 RPCServer_start_uds_thr(void *arg)
 {
     struct RPCServer *self = (struct RPCServer *) arg;
+    struct RPCServerListener listener;
     
-    void *client;
-    uint16_t option = self->_.option&(~(TCPSERVER_OPTION_TCP|TCPSERVER_OPTION_UDS));
-    pthread_t tid, *tids;
-    size_t i;
-    sigset_t set;
-    int ret;
-    
-    sigemptyset(&set);
-    sigaddset(&set, SIGPIPE);
-    Pthread_sigmask(SIG_BLOCK, &set, NULL);
-    
-    switch (option) {
-        case TCPSERVER_OPTION_BLOCK_PERTHREAD:
-            for (;;) {
-                if ((ret = rpc_server_accept2(self, &client)) == AAOS_OK) {
-                    Pthread_create(&tid, NULL, RPCServer_process_thr, client);
-                }
-            }
-            break;
-        case TCPSERVER_OPTION_NONBLOCK_PRETHEADED:
-            Fcntl(self->_.lfd, F_SETFL, O_NONBLOCK);
-            tids = (pthread_t *) Malloc(sizeof(pthread_t) * self->_.n_threads);
-            for (i = 0; i < self->_.n_threads; i ++) {
-                Pthread_create(&tids[i], NULL, RPCServer_process_thr2, self);
-            }
-            for (i = 0; i < self->_.n_threads; i++) {
-                Pthread_join(tids[i], NULL);
-            }
-            free(tids);
-            break;
-        default:
-            break;
-    }
+    listener.server = self;
+    listener.lfd = self->_.lfd2;
+    listener.accept = rpc_server_accept2;
+    listener.tcp = false;
+    RPCServer_serve(&listener);
     
     return NULL;
 }
@@ -1463,15 +3801,28 @@ RPCServer_start(void *_self)
 {
     struct RPCServer *self = cast(RPCServer(), _self);
     
-    pthread_t tids[2];
+    pthread_t tid, tids[2];
+    
+    if (self->_.idle_timeout > 0.) {
+        Pthread_create(&tid, NULL, RPCServer_reaper_thr, self);
+    }
     
     if (self->_.option&TCPSERVER_OPTION_TCP) {
-        self->_.lfd = Tcp_listen(self->_.address, self->_.port, NULL, NULL);
+        if (self->_.option&TCPSERVER_OPTION_REUSEPORT) {
+            self->_.lfd = Tcp_listen_reuseport(self->_.address, self->_.port);
+        } else {
+            self->_.lfd = Tcp_listen(self->_.address, self->_.port, NULL, NULL);
+        }
         Pthread_create(&tids[0], NULL, RPCServer_start_tcp_thr, self);
     }
     
     if (self->_.option&TCPSERVER_OPTION_UDS && self->_.path != NULL) {
-        self->_.lfd2 = Un_stream_listen(self->_.path);
+        /*
+         * tcp_server_set_path listens already, listening again would strand the clients of the first socket.
+         */
+        if (self->_.lfd2 < 0) {
+            self->_.lfd2 = Un_stream_listen(self->_.path);
+        }
         Pthread_create(&tids[1], NULL, RPCServer_start_uds_thr, self);
     }
     if (self->_.option&TCPSERVER_OPTION_TCP) {
@@ -1519,6 +3870,13 @@ RPCServer_ctor(void *_self, va_list *app)
 {
     struct RPCServer *self = super_ctor(RPCServer(), _self, app);
     
+    Pthread_mutex_init(&self->admission.mtx, NULL);
+    self->admission.head = NULL;
+    self->admission.n_connection = 0;
+    self->admission.n_refused = 0;
+    self->admission.n_unlogged = 0;
+    self->admission.last_log = 0.;
+    
     return (void *) self;
 }
 
@@ -1527,6 +3885,8 @@ RPCServer_dtor(void *_self)
 {
     struct RPCServer *self = cast(RPCServer(), _self);
     
+    Pthread_mutex_destroy(&self->admission.mtx);
+    
     return (void *) super_dtor(RPCServer(), self); 
 }
 
@@ -11,10 +11,19 @@
 
 #include "net.h"
 #include "protocol.h"
+#include <stdint.h>
 
 /*
  * That rpc_call returns a positive number means a failure occurs on the server side, otherwise, means a network failure.
  */
+
+#define RPC_BATCH_SIZE  65536
+
+/*
+ * Completion of an asynchronous call. When it is called, the reply is in the protobuf of rpc.
+ */
+typedef void (*rpc_completion)(void *rpc, uint32_t id, int result, void *arg);
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -27,6 +36,57 @@ int rpc_execute(void *_self);
 int rpc_register(void *_self, double timeout);
 int rpc_inspect(void *_self);
 
+/*
+ * Pipelined calls.
+ * rpc_pipeline asks the server to switch the connection to pipelined mode,
+ * it fails with the error of the server if the server does not support it.
+ * rpc_call_async sends the request in the protobuf and returns without waiting,
+ * so the protobuf can be filled with the next request at once.
+ * Replies may arrive in any order; they are read by rpc_wait (and by rpc_call on a pipelined connection),
+ * which calls the completion of each reply, or keeps the reply until rpc_wait is called with its ID
+ * if completion is NULL. rpc_wait with ID 0 waits until every call in flight has been answered.
+ * On a connection that is not pipelined, rpc_call_async makes the call synchronously.
+ * A server executes at most RPC_PIPELINE_MAX_IN_FLIGHT requests of a connection at once,
+ * and stops reading the connection until one of them has been answered.
+ * The protobuf of an RPC object is not thread-safe, as before, so the calls in flight should be waited by the thread issuing them.
+ */
+int rpc_pipeline(void *_self);
+int rpc_call_async(void *_self, rpc_completion completion, void *arg, uint32_t *id);
+int rpc_wait(void *_self, uint32_t id);
+
+/*
+ * Ask the server to move a Unix domain socket connection to shared memory with rings of ring_size bytes
+ * (0 for the default). On failure, the connection keeps working over the socket.
+ * A connection cannot be both pipelined and in shared memory.
+ */
+int rpc_shm(void *_self, size_t ring_size);
+
+/*
+ * Batched writes.
+ * Packets written by rpc_write between rpc_batch_begin and rpc_batch_end, such as the packets of
+ * a PROTO_OPTION_MORE_PACKET reply, are gathered and sent with as few system calls as possible.
+ * The batch is flushed whenever RPC_BATCH_SIZE bytes are pending, and by rpc_batch_end.
+ * Batches may be nested, only the outermost rpc_batch_end flushes.
+ * A batch left open by rpc_execute is flushed together with the final reply.
+ */
+int rpc_batch_begin(void *_self);
+int rpc_batch_end(void *_self);
+
+/*
+ * Deadlines and cancellation.
+ * rpc_set_timeout gives every following rpc_call on the connection timeout seconds (0 for no limit).
+ * The first such call asks the server whether it takes the budget. If it does, the budget is sent ahead of
+ * every request, and the server replies AAOS_ETIMEDOUT without executing a request which has already
+ * expired when its turn comes. Either way, the client gives up with -AAOS_ETIMEDOUT once it is spent. The connection is shut down then, since the late reply would be read by the next call.
+ * Calls on a pipelined connection are not bounded.
+ * rpc_cancel asks the server, on another connection than the one waiting, to abort the long operation
+ * in progress, such as a slew or an exposure, on the device of index, or of name if index is 0.
+ * rpc_abort is the server side of rpc_cancel; it is not supported unless the server class implements it.
+ */
+void rpc_set_timeout(void *_self, double timeout);
+int rpc_cancel(void *_self, uint16_t index, const char *name);
+int rpc_abort(void *_self);
+
 const void *RPC(void);
 const void *RPCClass(void);
 const void *RPCVirtualTable(void);
@@ -37,10 +97,64 @@ extern const void *RPCClient(void);
 extern const void *RPCClientClass(void);
 extern const void *RPCClientVirtualTable(void);
 
+/*
+ * Connection pool.
+ * rpc_pool_get returns an idle connection to the address and port of client, or connects a new one,
+ * blocking while max_per_host connections of the same client class are in use.
+ * Idle connections are probed before being reused, and closed after idle_timeout seconds.
+ * rpc_pool_put returns the connection with the result of the last call, of either sign,
+ * it is closed on a network failure or if the peer has closed it.
+ * If the peer has reset or closed a connection reused from the pool before its first call,
+ * rpc_call reopens it and sends the request once more.
+ */
+void rpc_pool_configure(double idle_timeout, size_t max_per_host);
+int rpc_pool_get(void *client, void **rpc);
+void rpc_pool_put(void *rpc, int result);
+void rpc_pool_flush(void);
+
+/*
+ * Event subscription.
+ * rpc_subscribe and rpc_unsubscribe add and remove a topic pattern in fnmatch(3) syntax, such as "dome/" followed by an asterisk,
+ * on a connection, which is then used for events only; an empty pattern to rpc_unsubscribe removes all.
+ * rpc_next_event waits up to timeout seconds (forever if negative) for the next event,
+ * returning AAOS_ETIMEDOUT if none arrives. Its topic and payload point into the protobuf,
+ * PACKET_U64F0 carries the sequence number of the event on the connection, which has gaps
+ * where events have been dropped for a slow subscriber, and PACKET_DF1 the time of publishing.
+ * rpc_publish sends an event to every connection subscribed to a matching pattern, without blocking.
+ * Pipelined and shared-memory connections cannot subscribe.
+ */
+int rpc_subscribe(void *_self, const char *pattern);
+int rpc_unsubscribe(void *_self, const char *pattern);
+int rpc_next_event(void *_self, double timeout, const char **topic, const void **event, size_t *size);
+int rpc_publish(const char *topic, const void *event, size_t size);
+bool rpc_has_subscriber(void);
+
 int rpc_server_accept(void *_self, void **client);
 int rpc_server_accept2(void *_self, void **client);
+
+/*
+ * Accept a connection on the TCP (TCPSERVER_OPTION_TCP) or Unix domain (TCPSERVER_OPTION_UDS)
+ * listening socket of a server, for the accept methods of servers.
+ * The descriptor is close-on-exec; -1 is returned if there is nothing to accept,
+ * or if the server is already at max_connections.
+ */
+int rpc_server_accept_fd(void *_self, unsigned int listener);
 void rpc_server_start(void *_self);
 
+/*
+ * Statistics of the connections of a server. A connection refused over its limits
+ * is counted in n_refused, and logged to syslog at most once per RPC_SERVER_REFUSE_LOG_INTERVAL seconds,
+ * with the number refused since the last log.
+ */
+#define RPC_SERVER_REFUSE_LOG_INTERVAL 60.
+
+struct RPCServerStats {
+    uint64_t n_connection;
+    uint64_t n_refused;
+};
+
+void rpc_server_get_stats(const void *_self, struct RPCServerStats *stats);
+
 extern const void *RPCServer(void);
 extern const void *RPCServerClass(void);
 extern const void *RPCServerVirtualTable(void);
@@ -56,4 +170,11 @@ extern const void *RPCServerVirtualTable(void);
 
 #define RPC_DEFAULT         (RPC_PER_THREAD|RPC_TCP)
 
+#define RPC_POOL_IDLE_TIMEOUT   60.
+#define RPC_POOL_MAX_PER_HOST   8
+
+#define RPC_EVENT_QUEUE_SIZE    64
+
+#define RPC_PIPELINE_MAX_IN_FLIGHT  64
+
 #endif /* rpc_h */
@@ -10,17 +10,133 @@
 #define rpc_r_h
 
 #include "net_r.h"
+#include "protocol_r.h"
+#include "rpc.h"
 #include "virtual_r.h"
+#include <netinet/in.h>
+#include <pthread.h>
+#include <stdbool.h>
 
 //#define _RPC_PRIORITY_ _VIRTUAL_PRIORITY_ + 1
 
+/*
+ * Once a connection is pipelined, every packet on it in both directions
+ * is prefixed by struct RPCPipelineHeader, which carries the request ID.
+ */
+struct RPCPipelineHeader {
+    uint32_t id;
+    uint32_t reserved;
+};
+
+/*
+ * A SYSTEM_COMMAND_DEADLINE packet with this option is a probe, answered on its own,
+ * otherwise it is the preamble of the request that follows and is not answered.
+ * Servers which do not know the command answer the probe with an error.
+ */
+#define RPC_DEADLINE_PROBE  0x0001
+
+#define RPC_DEADLINE_UNKNOWN        0
+#define RPC_DEADLINE_SUPPORTED      1
+#define RPC_DEADLINE_UNSUPPORTED    2
+
+struct RPCReply {
+    struct RPCReply *next;
+    int result;
+    size_t length;      /* header and payload */
+    char packet[];
+};
+
+struct RPCPending {
+    struct RPCPending *next;
+    uint32_t id;
+    rpc_completion completion;
+    void *arg;
+    bool answered;
+    struct RPCReply *reply;     /* replies kept for rpc_wait when there is no completion */
+};
+
+/*
+ * Shared by a server connection and the workers executing its requests.
+ */
+struct RPCPipeline {
+    pthread_mutex_t mtx;        /* serializes packets written to the socket, and guards next_id and pending */
+    pthread_cond_t cond;        /* signalled when a worker has answered */
+    unsigned int refcount;
+    uint32_t next_id;
+    struct RPCPending *pending;
+    unsigned int in_flight;     /* requests handed to workers and not answered yet */
+    double last_reply;          /* CLOCK_MONOTONIC, when a worker last answered */
+    int sockfd;                 /* the socket of a connection gone while workers still answer on it */
+};
+
+/*
+ * Packets written between rpc_batch_begin and rpc_batch_end, not yet sent.
+ */
+struct RPCBatch {
+    unsigned int depth;
+    char *buf;
+    size_t length;
+};
+
+struct RPCSubscription {
+    struct RPCSubscription *next;
+    char *pattern;
+};
+
+/*
+ * An event queued for a subscriber, in its wire form.
+ */
+struct RPCEvent {
+    struct RPCEvent *next;
+    size_t length;      /* header and payload */
+    size_t offset;      /* bytes already sent */
+    char packet[];
+};
+
+/*
+ * Server side of a connection subscribed to events.
+ * Events are queued by rpc_publish and sent by the push thread without blocking,
+ * replies sent by the connection itself wait for a partially sent event first.
+ */
+struct RPCSubscriber {
+    struct RPCSubscriber *next;
+    int sockfd;
+    pthread_mutex_t mtx;        /* serializes packets written to the socket */
+    struct RPCSubscription *subscriptions;
+    struct RPCEvent *head;
+    struct RPCEvent *tail;
+    size_t n_event;
+    uint64_t sequence;
+    bool closed;
+};
+
 struct RPC {
     struct TCPSocket _;
     const void *_vtab;
     unsigned int option;
     void *protobuf;
+    uint32_t request_id;
+    struct RPCPipeline *pipeline;
+    struct RPCBatch batch;
+    struct RPCSubscriber *subscriber;
+    struct RPCReply *events;    /* events read by the client while waiting for a reply */
+    struct RPCConnection *connection;
+    double timeout;             /* time allowed to every call made by the client, 0 for no limit */
+    int deadline_support;       /* whether the server takes the deadline preamble, RPC_DEADLINE_* */
+    double deadline;            /* when the request being served expires, in seconds of CLOCK_MONOTONIC */
+    bool reused;                /* taken from the idle connections of the pool, until the first call */
+    bool sent;                  /* the request of the current call has been written in full */
 };
 
+/*
+ * Typed fast path to the packet of an RPC object, see protobuf_packet.
+ */
+static inline struct Packet *
+rpc_packet(const void *_self)
+{
+    return protobuf_packet(((const struct RPC *) _self)->protobuf);
+}
+
 struct RPCClass {
     struct TCPSocketClass _;
     struct Method read;
@@ -30,6 +146,13 @@ struct RPCClass {
     struct Method execute;
     struct Method inspect;
     struct Method reg;
+    struct Method pipeline;
+    struct Method call_async;
+    struct Method wait;
+    struct Method shm;
+    struct Method batch_begin;
+    struct Method batch_end;
+    struct Method abort;
 };
 
 struct RPCVirtualTable {
@@ -41,6 +164,13 @@ struct RPCVirtualTable {
     struct Method execute;
     struct Method inspect;
     struct Method reg;
+    struct Method pipeline;
+    struct Method call_async;
+    struct Method wait;
+    struct Method shm;
+    struct Method batch_begin;
+    struct Method batch_end;
+    struct Method abort;
 };
 
 struct RPCClient {
@@ -59,10 +189,53 @@ struct RPCClientVirtualTable {
     struct Method connect;
 };
 
+struct RPCPoolConnection {
+    struct RPCPoolConnection *next;
+    void *rpc;
+    double last_used;
+};
+
+struct RPCPoolHost {
+    struct RPCPoolHost *next;
+    const void *class;      /* class of the client */
+    char *address;
+    char *port;
+    size_t n_busy;
+    struct RPCPoolConnection *idle;
+    struct RPCPoolConnection *busy;
+};
+
+/*
+ * An accepted connection, counted against the limits of its server.
+ */
+struct RPCConnection {
+    struct RPCConnection *prev;
+    struct RPCConnection *next;
+    struct RPCAdmission *admission;
+    void *rpc;
+    char peer[INET6_ADDRSTRLEN];    /* empty for Unix domain sockets */
+    double last_active;             /* CLOCK_MONOTONIC, written by the connection only */
+    bool busy;                      /* a request is being executed in place */
+    bool reaped;
+};
+
+/*
+ * Connections of a server, see tcp_server_set_limits.
+ */
+struct RPCAdmission {
+    pthread_mutex_t mtx;
+    struct RPCConnection *head;
+    size_t n_connection;
+    uint64_t n_refused;
+    uint64_t n_unlogged;            /* refused since the last log */
+    double last_log;                /* CLOCK_MONOTONIC */
+};
+
 struct RPCServer {
     struct TCPServer _;
     const void *_vtab;
     int option;
+    struct RPCAdmission admission;
 };
 
 struct RPCServerClass {
@@ -6,6 +6,10 @@
 //  Copyright © 2018年 National Astronomical Observatories, Chinese Academy of Sciences. All rights reserved.
 //
 
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE     /* accept4 */
+#endif
+
 #include "def.h"
 #include "wrapper.h"
 
@@ -212,6 +216,32 @@ Accept(int sockfd, SA *sockaddr, socklen_t *addrlen)
     return s;
 }
 
+/*
+ * accept4(2) where it exists, flags are SOCK_NONBLOCK and SOCK_CLOEXEC.
+ * Errors a server is expected to retry or to wait out are not reported.
+ */
+int
+Accept4(int sockfd, SA *sockaddr, socklen_t *addrlen, int flags)
+{
+    int s;
+#ifdef LINUX
+    s = accept4(sockfd, sockaddr, addrlen, flags);
+#else
+    if ((s = accept(sockfd, sockaddr, addrlen)) >= 0) {
+        if (flags & SOCK_CLOEXEC) {
+            fcntl(s, F_SETFD, FD_CLOEXEC);
+        }
+        if (flags & SOCK_NONBLOCK) {
+            fcntl(s, F_SETFL, fcntl(s, F_GETFL, 0) | O_NONBLOCK);
+        }
+    }
+#endif
+    if (s < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR && errno != ECONNABORTED) {
+        err_warn("accept4", errno);
+    }
+    return s;
+}
+
 int
 Access(const char *path, int amode)
 {
@@ -1360,7 +1390,7 @@ Tcp_connect(const char *hostname, const char *servname, SA *sockaddr, socklen_t
 }
 
 static int
-tcp_listen(const char *hostname, const char *servname, SA *sockaddr, socklen_t *addrlen)
+tcp_listen_option(const char *hostname, const char *servname, SA *sockaddr, socklen_t *addrlen, bool reuseport)
 {
     struct addrinfo *ailist, *aip;
     struct addrinfo hint;
@@ -1389,6 +1419,11 @@ tcp_listen(const char *hostname, const char *servname, SA *sockaddr, socklen_t *
         if (lfd < 0)
             continue;
         Setsockopt(lfd, SOL_SOCKET, SO_REUSEADDR, &optval, (socklen_t) sizeof(optval));
+#ifdef SO_REUSEPORT
+        if (reuseport) {
+            Setsockopt(lfd, SOL_SOCKET, SO_REUSEPORT, &optval, (socklen_t) sizeof(optval));
+        }
+#endif
         if (bind(lfd, aip->ai_addr, aip->ai_addrlen) == 0) {
             if (addrlen != NULL) {
                 *addrlen = aip->ai_addrlen;
@@ -1405,6 +1440,26 @@ tcp_listen(const char *hostname, const char *servname, SA *sockaddr, socklen_t *
     return lfd;
 }
 
+static int
+tcp_listen(const char *hostname, const char *servname, SA *sockaddr, socklen_t *addrlen)
+{
+    return tcp_listen_option(hostname, servname, sockaddr, addrlen, false);
+}
+
+/*
+ * Listen with SO_REUSEPORT, so that several sockets can listen on the same port.
+ */
+int
+Tcp_listen_reuseport(const char *hostname, const char *servname)
+{
+    int s;
+    s = tcp_listen_option(hostname, servname, NULL, NULL, true);
+    if (s < 0) {
+        err_warn("tcp_listen_reuseport", errno);
+    }
+    return s;
+}
+
 int
 Tcp_listen(const char *hostname, const char *servname, SA *sockaddr, socklen_t *addrlen)
 {
@@ -1460,6 +1515,41 @@ Writen2(int fd, const void *vptr, size_t n)
     return n;
 }
 
+/*
+ * Write all the iovcnt buffers, restarting after short writes and signals.
+ * The iov array is modified in place.
+ */
+ssize_t
+Writevn(int fd, struct iovec *iov, int iovcnt)
+{
+    size_t n = 0;
+    ssize_t nwritten;
+    
+    while (iovcnt > 0 && iov->iov_len == 0) {
+        iov++;
+        iovcnt--;
+    }
+    while (iovcnt > 0) {
+        if ((nwritten = writev(fd, iov, iovcnt)) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        n += nwritten;
+        while (iovcnt > 0 && (size_t) nwritten >= iov->iov_len) {
+            nwritten -= iov->iov_len;
+            iov++;
+            iovcnt--;
+        }
+        if (iovcnt > 0) {
+            iov->iov_base = (char *) iov->iov_base + nwritten;
+            iov->iov_len -= nwritten;
+        }
+    }
+    return n;
+}
+
 ssize_t
 Sendfile(int fd, int sockfd, off_t offset, off_t *len, struct sf_hdtr *hdtr, int flags)
 {
@@ -40,6 +40,7 @@
 #include <getopt.h>
 #include <libgen.h>
 #include <netdb.h>
+#include <poll.h>
 #include <pthread.h>
 #include <pwd.h>
 #include <regex.h>
@@ -68,6 +69,7 @@
 #ifdef LINUX
 #include <mntent.h>
 #include <sys/epoll.h>
+#include <sys/eventfd.h>
 #endif
 
 typedef struct sockaddr SA;
@@ -92,6 +94,16 @@ struct sf_hdtr {
 };
 #endif
 
+/*
+ * Flags of Accept4 where accept4(2) does not exist.
+ */
+#ifndef SOCK_CLOEXEC
+#define SOCK_CLOEXEC    O_CLOEXEC
+#endif
+#ifndef SOCK_NONBLOCK
+#define SOCK_NONBLOCK   O_NONBLOCK
+#endif
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -108,6 +120,7 @@ int Tcgetattr(int, struct termios *);
 int Tcsetattr(int, int, const struct termios *);
 
 int Accept(int, SA *, socklen_t *);
+int Accept4(int, SA *, socklen_t *, int);
 int Access(const char *, int);
 int Chdir(const char *);
 int Clock_gettime(clockid_t, struct timespec *);
@@ -173,10 +186,12 @@ ssize_t Readn(int, void *, size_t);
 ssize_t Writen2(int, const void *, size_t);
 ssize_t Readn2(int, void *, size_t);
 ssize_t Readn3(int, void *, size_t, const void *, size_t);
+ssize_t Writevn(int, struct iovec *, int);
 ssize_t Sendfile(int, int, off_t, off_t *, struct sf_hdtr *, int);
 int Tcp_connect(const char *, const char *, SA *, socklen_t *);
 int Tcp_connect_nb(const char *, const char *, SA *, socklen_t *, double);
 int Tcp_listen(const char *, const char *, SA *, socklen_t *);
+int Tcp_listen_reuseport(const char *, const char *);
 int Un_stream_connect(const char *);
 int Un_stream_connect_nb(const char *, double);
 int Un_stream_listen(const char *);
@@ -6,6 +6,11 @@
 //  Copyright © 2019 NAOC. All rights reserved.
 //
 
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#ifdef __USE_ASCOM__
 #include <curl/curl.h>
 
 #include "ascom.h"
@@ -18,56 +23,38 @@ struct MemoryStruct {
     size_t *size;
 };
 
-static void
-ASCOM_cleanup(void *arg)
-{
-    CURL *curl_handle = (CURL *) arg;
-    
-    curl_easy_cleanup(curl_handle);
-}
+static CURLSH *ascom_share;
+static pthread_mutex_t ascom_share_mtx[CURL_LOCK_DATA_LAST];
 
 static void
-curl_handle_cleanup(void *arg)
+ascom_share_lock(CURL *handle, curl_lock_data data, curl_lock_access access, void *userp)
 {
-    CURL *curl_handle = (CURL *) arg;
-    
-    curl_easy_cleanup(curl_handle);
+    Pthread_mutex_lock(&ascom_share_mtx[data]);
 }
 
 static void
-curl_slist_cleanup(void *arg)
+ascom_share_unlock(CURL *handle, curl_lock_data data, void *userp)
 {
-    struct curl_slist *list = (struct curl_slist *) arg;
-    
-    curl_slist_free_all(list);
+    Pthread_mutex_unlock(&ascom_share_mtx[data]);
 }
 
-static size_t
-ReadMemoryCallback(void *data, size_t size, size_t nmemb, void *userp)
+static void
+ASCOM_cleanup(void *arg)
 {
-    char *s = (char *) userp;
-    
-    if (s == NULL) {
-        return size * nmemb;
-    }
-    
-    size_t realsize = strlen(s) + 1;
-
-    if (realsize > size * nmemb) {
-        realsize = size * nmemb;
-    }
-    
-    memcpy(data, s, realsize);
+    CURL *curl_handle = (CURL *) arg;
     
-    return realsize;
+    curl_easy_cleanup(curl_handle);
 }
 
-static size_t
-ReadMenoryCallback(void *ptr, size_t size, size_t nmemb, void *userp)
+/*
+ * The reply of a cancelled request, which the write callback may have reallocated.
+ */
+static void
+ASCOM_cleanup_memory(void *arg)
 {
-    memcpy(ptr, userp, size * nmemb);
+    struct MemoryStruct *user_data = (struct MemoryStruct *) arg;
     
-    return size * nmemb;
+    free(user_data->memory);
 }
 
 static size_t
@@ -93,154 +80,281 @@ WriteMemoryCallback(void *contents, size_t size, size_t nmemb, void *userp)
     return realsize;
 }
 
-int
-ascom_get(void *_self, const char *command, char *response_data, size_t *size)
+/*
+ * Take an idle handle from the pool, or make a new one.
+ */
+static CURL *
+ASCOM_acquire(struct ASCOM *self)
 {
-    const struct ASCOMClass *class = (const struct ASCOMClass *) classOf(_self);
+    CURL *curl_handle = NULL;
+    double connect_timeout, timeout;
     
-    if (isOf(class, ASCOMClass()) && class->get.method) {
-        return ((int (*)(void *, const char *, char *, size_t *)) class->get.method)(_self, command, response_data, size);
+    Pthread_mutex_lock(&self->mtx);
+    if (self->n_handle > 0) {
+        curl_handle = self->handles[--self->n_handle];
+    }
+    connect_timeout = self->connect_timeout;
+    timeout = self->timeout;
+    Pthread_mutex_unlock(&self->mtx);
+    
+    if (curl_handle == NULL) {
+        if ((curl_handle = curl_easy_init()) == NULL) {
+            return NULL;
+        }
+        curl_easy_setopt(curl_handle, CURLOPT_SHARE, ascom_share);
+        curl_easy_setopt(curl_handle, CURLOPT_NOSIGNAL, 1L);
+        curl_easy_setopt(curl_handle, CURLOPT_TCP_KEEPALIVE, 1L);
+        curl_easy_setopt(curl_handle, CURLOPT_HTTPHEADER, self->headers);
+        curl_easy_setopt(curl_handle, CURLOPT_WRITEFUNCTION, WriteMemoryCallback);
+    }
+    curl_easy_setopt(curl_handle, CURLOPT_CONNECTTIMEOUT_MS, (long) (connect_timeout * 1000.));
+    curl_easy_setopt(curl_handle, CURLOPT_TIMEOUT_MS, (long) (timeout * 1000.));
+    
+    return curl_handle;
+}
+
+/*
+ * Put a handle back to the pool, its connection stays in the shared cache.
+ */
+static void
+ASCOM_release(struct ASCOM *self, CURL *curl_handle)
+{
+    Pthread_mutex_lock(&self->mtx);
+    if (self->n_handle < ASCOM_MAX_HANDLE) {
+        self->handles[self->n_handle++] = curl_handle;
+        curl_handle = NULL;
+    }
+    Pthread_mutex_unlock(&self->mtx);
+    
+    if (curl_handle != NULL) {
+        curl_easy_cleanup(curl_handle);
+    }
+}
+
+static void
+ASCOM_prepare(CURL *curl_handle, const char *URL, bool put, const char *request_data, struct MemoryStruct *user_data)
+{
+    curl_easy_setopt(curl_handle, CURLOPT_URL, URL);
+    if (put) {
+        curl_easy_setopt(curl_handle, CURLOPT_POSTFIELDS, (request_data != NULL) ? request_data : "");
+        curl_easy_setopt(curl_handle, CURLOPT_CUSTOMREQUEST, "PUT");
     } else {
-        int result;
-        forward(_self, &result, (Method) ascom_get, "get", _self, command, response_data, size);
-        return result;
+        curl_easy_setopt(curl_handle, CURLOPT_HTTPGET, 1L);
+        curl_easy_setopt(curl_handle, CURLOPT_CUSTOMREQUEST, NULL);
     }
+    curl_easy_setopt(curl_handle, CURLOPT_WRITEDATA, (void *) user_data);
 }
 
 static int
-ASCOM_get(void *_self, const char *command, void *response_data, size_t *size)
+ASCOM_result(CURL *curl_handle, CURLcode res)
+{
+    long http_code = 0;
+    
+    switch (res) {
+        case CURLE_OK:
+            break;
+        case CURLE_OPERATION_TIMEDOUT:
+            return AAOS_ETIMEDOUT;
+        case CURLE_COULDNT_RESOLVE_HOST:
+            return AAOS_EHOSTUNREACH;
+        case CURLE_COULDNT_CONNECT:
+            return AAOS_ECONNREFUSED;
+        case CURLE_SEND_ERROR:
+        case CURLE_RECV_ERROR:
+        case CURLE_GOT_NOTHING:
+            return AAOS_ECONNRESET;
+        default:
+            return AAOS_ERROR;
+    }
+    curl_easy_getinfo(curl_handle, CURLINFO_RESPONSE_CODE, &http_code);
+    if (http_code == 400) {
+        return AAOS_EINVAL;
+    } else if (http_code != 200) {
+        return AAOS_EFAILED;
+    }
+    
+    return AAOS_OK;
+}
+
+static int
+ASCOM_request(struct ASCOM *self, const char *command, bool put, const char *request_data, char **response_data, size_t *size)
 {
-    struct ASCOM *self = cast(ASCOM(), _self);
-    
     char URL[BUFSIZE];
-    CURL *curl_handle = NULL;
+    CURL *curl_handle;
     CURLcode res;
     struct MemoryStruct user_data;
-    struct curl_slist *list = NULL;
-   
-    int ret = AAOS_OK;
+    size_t length = 0;
+    int ret;
     
-    if (self->port) {
-        snprintf(URL, BUFSIZE, "%s:%s/api/%s/%s/%ud", self->address, self->port, self->version, self->device_type, self->device_number);
-    } else {
-        snprintf(URL, BUFSIZE, "%s/api/%s/%s/%ud", self->address, self->version, self->device_type, self->device_number);
+    snprintf(URL, BUFSIZE, "%s/%s", self->url, command);
+    if ((curl_handle = ASCOM_acquire(self)) == NULL) {
+        return AAOS_ENOMEM;
     }
     
-    curl_handle = curl_easy_init();
-    if (curl_handle == NULL) {
-        ret = AAOS_ERROR;
-        goto error;
-    }
-    pthread_cleanup_push(curl_handle_cleanup, curl_handle);
-    pthread_cleanup_push(curl_slist_cleanup, curl_handle);
+    user_data.memory = (response_data != NULL) ? *response_data : NULL;
+    user_data.size = (size != NULL) ? size : &length;
+    *user_data.size = 0;
+    ASCOM_prepare(curl_handle, URL, put, request_data, &user_data);
     
-    curl_easy_setopt(curl_handle, CURLOPT_URL, URL);
-    list = curl_slist_append(list, "Content-Type: application/x-www-form-urlencoded");
-    curl_easy_setopt(curl_handle, CURLOPT_HTTPHEADER, list);
-    curl_easy_setopt(curl_handle, CURLOPT_READDATA, command);
-    curl_easy_setopt(curl_handle, CURLOPT_READFUNCTION, ReadMemoryCallback);
+    /*
+     * A handle cancelled in the middle of a request is not reusable, nor is its reply returned.
+     */
+    pthread_cleanup_push(ASCOM_cleanup_memory, &user_data);
+    pthread_cleanup_push(ASCOM_cleanup, curl_handle);
+    res = curl_easy_perform(curl_handle);
+    pthread_cleanup_pop(0);
+    pthread_cleanup_pop(0);
     
-    user_data.memory = response_data;
-    if (size != NULL) {
-        user_data.size = size;
+    if (response_data != NULL) {
+        *response_data = user_data.memory;
     } else {
-        user_data.size = NULL;
+        free(user_data.memory);
     }
+    ret = ASCOM_result(curl_handle, res);
+    ASCOM_release(self, curl_handle);
     
-    curl_easy_setopt(curl_handle, CURLOPT_WRITEDATA, (void *) &user_data);
-    curl_easy_setopt(curl_handle, CURLOPT_WRITEFUNCTION, WriteMemoryCallback);
-    
-    res = curl_easy_perform(curl_handle);
-    
-    response_data = user_data.memory;
+    return ret;
+}
+
+int
+ascom_get(void *_self, const char *command, char **response_data, size_t *size)
+{
+    const struct ASCOMClass *class = (const struct ASCOMClass *) classOf(_self);
     
-    if (res != CURLE_OK) {
-        ret = AAOS_ERROR;
-        goto error;
+    if (isOf(class, ASCOMClass()) && class->get.method) {
+        return ((int (*)(void *, const char *, char **, size_t *)) class->get.method)(_self, command, response_data, size);
+    } else {
+        int result;
+        forward(_self, &result, (Method) ascom_get, "get", _self, command, response_data, size);
+        return result;
     }
+}
+
+static int
+ASCOM_get(void *_self, const char *command, char **response_data, size_t *size)
+{
+    struct ASCOM *self = cast(ASCOM(), _self);
     
-    
-    pthread_cleanup_pop(0);
-    pthread_cleanup_pop(0);
-    
-error:
-    curl_slist_free_all(list);
-    curl_easy_cleanup(curl_handle);
-    return ret;
+    return ASCOM_request(self, command, false, NULL, response_data, size);
 }
 
 int
-ascom_put(void *_self, const char *command, const char *request_data, char *response_data, size_t *size)
+ascom_put(void *_self, const char *command, const char *request_data, char **response_data, size_t *size)
 {
     const struct ASCOMClass *class = (const struct ASCOMClass *) classOf(_self);
     
     if (isOf(class, ASCOMClass()) && class->put.method) {
-        return ((int (*)(void *, const char *, const char *, char *, size_t *)) class->put.method)(_self, command, request_data, response_data, size);
+        return ((int (*)(void *, const char *, const char *, char **, size_t *)) class->put.method)(_self, command, request_data, response_data, size);
     } else {
         int result;
-        forward(_self, &result, (Method) ascom_get, "put", _self, command, request_data, response_data, size);
+        forward(_self, &result, (Method) ascom_put, "put", _self, command, request_data, response_data, size);
         return result;
     }
 }
 
 static int
-ASCOM_put(void *_self, const char *command, const char *request_data, char *response_data, size_t *size)
+ASCOM_put(void *_self, const char *command, const char *request_data, char **response_data, size_t *size)
+{
+    struct ASCOM *self = cast(ASCOM(), _self);
+    
+    return ASCOM_request(self, command, true, request_data, response_data, size);
+}
+
+/*
+ * GET several properties at once, the requests go out in parallel through curl_multi.
+ * results[i] is the error code of commands[i], the first error is returned.
+ * Cancellation is deferred until the transfers are over, so that the easy handles
+ * go back to the pool and the responses to the caller.
+ */
+int
+ascom_get_multi(void *_self, size_t n, const char **commands, char **response_data, size_t *sizes, int *results)
 {
     struct ASCOM *self = cast(ASCOM(), _self);
     
     char URL[BUFSIZE];
-    CURL *curl_handle;
-    CURLcode res;
-    struct MemoryStruct user_data;
+    CURLM *multi_handle;
+    CURLMsg *msg;
+    CURL **curl_handles;
+    struct MemoryStruct *user_data;
+    size_t i;
+    int running, n_msg, state, ret = AAOS_OK;
    
-    int ret = AAOS_OK;
-    
-    if (self->port) {
-        snprintf(URL, BUFSIZE, "%s:%s/api/%s/%s/%ud/%s", self->address, self->port, self->version, self->device_type, self->device_number, command);
-    } else {
-        snprintf(URL, BUFSIZE, "%s/api/%s/%s/%ud/%s", self->address, self->version, self->device_type, self->device_number, command);
+    if (n == 0) {
+        return AAOS_OK;
+    }
+    if ((multi_handle = curl_multi_init()) == NULL) {
+        return AAOS_ENOMEM;
+    }
+    Pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &state);
+    curl_handles = (CURL **) Malloc(sizeof(CURL *) * n);
+    user_data = (struct MemoryStruct *) Malloc(sizeof(struct MemoryStruct) * n);
+    
+    for (i = 0; i < n; i++) {
+        user_data[i].memory = response_data[i];
+        user_data[i].size = &sizes[i];
+        sizes[i] = 0;
+        if ((curl_handles[i] = ASCOM_acquire(self)) == NULL) {
+            results[i] = AAOS_ENOMEM;
+            continue;
+        }
+        results[i] = AAOS_ERROR;
+        snprintf(URL, BUFSIZE, "%s/%s", self->url, commands[i]);
+        ASCOM_prepare(curl_handles[i], URL, false, NULL, &user_data[i]);
+        curl_multi_add_handle(multi_handle, curl_handles[i]);
     }
     
+    do {
+        if (curl_multi_perform(multi_handle, &running) != CURLM_OK) {
+            break;
+        }
+        if (running) {
+            curl_multi_wait(multi_handle, NULL, 0, 1000, NULL);
+        }
+    } while (running);
     
-    curl_handle = curl_easy_init();
-    if (curl_handle == NULL) {
-        ret = AAOS_ERROR;
-        goto error;
+    while ((msg = curl_multi_info_read(multi_handle, &n_msg)) != NULL) {
+        if (msg->msg != CURLMSG_DONE) {
+            continue;
+        }
+        for (i = 0; i < n; i++) {
+            if (curl_handles[i] == msg->easy_handle) {
+                results[i] = ASCOM_result(curl_handles[i], msg->data.result);
+                break;
+            }
+        }
     }
     
-    pthread_cleanup_push(ASCOM_cleanup, curl_handle);
-    
-    curl_easy_setopt(curl_handle, CURLOPT_URL, URL);
-    curl_easy_setopt(curl_handle, CURLOPT_READFUNCTION, ReadMemoryCallback);
-    curl_easy_setopt(curl_handle, CURLOPT_READDATA, request_data);
-    curl_easy_setopt(curl_handle, CURLOPT_UPLOAD, 1L);
-    curl_easy_setopt(curl_handle, CURLOPT_PUT, 1L);
-    
-    
-    user_data.memory = response_data;
-    if (size != NULL) {
-        user_data.size = size;
-    } else {
-        user_data.size = 0;
+    for (i = 0; i < n; i++) {
+        response_data[i] = user_data[i].memory;
+        if (curl_handles[i] != NULL) {
+            curl_multi_remove_handle(multi_handle, curl_handles[i]);
+            ASCOM_release(self, curl_handles[i]);
+        }
+        if (results[i] != AAOS_OK && ret == AAOS_OK) {
+            ret = results[i];
+        }
     }
+    curl_multi_cleanup(multi_handle);
+    free(curl_handles);
+    free(user_data);
+    Pthread_setcancelstate(state, NULL);
     
-    curl_easy_setopt(curl_handle, CURLOPT_WRITEFUNCTION, WriteMemoryCallback);
-    curl_easy_setopt(curl_handle, CURLOPT_WRITEDATA, (void *) &user_data);
-    
-    res = curl_easy_perform(curl_handle);
-    
-    response_data = user_data.memory;
+    return ret;
+}
+
+void
+ascom_set_timeout(void *_self, double connect_timeout, double timeout)
+{
+    struct ASCOM *self = cast(ASCOM(), _self);
     
-    if (res != CURLE_OK) {
-        ret = AAOS_ERROR;
-        goto error;
+    Pthread_mutex_lock(&self->mtx);
+    if (connect_timeout > 0.) {
+        self->connect_timeout = connect_timeout;
     }
-    
-    pthread_cleanup_pop(0);
-error:
-    curl_easy_cleanup(curl_handle);
-    
-    return ret;
+    if (timeout > 0.) {
+        self->timeout = timeout;
+    }
+    Pthread_mutex_unlock(&self->mtx);
 }
 
 static void *
@@ -249,6 +363,7 @@ ASCOM_ctor(void *_self, va_list *app)
     struct ASCOM *self = super_ctor(ASCOM(), _self, app);
     
     const char *s;
+    int len;
     
     s = va_arg(*app, const char *);
     if (s) {
@@ -272,6 +387,21 @@ ASCOM_ctor(void *_self, va_list *app)
     }
     self->device_number = va_arg(*app, unsigned int);
     
+    if (self->port) {
+        s = "%s:%s/api/%s/%s/%u";
+        len = snprintf(NULL, 0, s, self->address, self->port, self->version, self->device_type, self->device_number) + 1;
+        self->url = (char *) Malloc(len);
+        snprintf(self->url, len, s, self->address, self->port, self->version, self->device_type, self->device_number);
+    } else {
+        s = "%s/api/%s/%s/%u";
+        len = snprintf(NULL, 0, s, self->address, self->version, self->device_type, self->device_number) + 1;
+        self->url = (char *) Malloc(len);
+        snprintf(self->url, len, s, self->address, self->version, self->device_type, self->device_number);
+    }
+    self->connect_timeout = ASCOM_CONNECT_TIMEOUT;
+    self->timeout = ASCOM_TIMEOUT;
+    self->headers = curl_slist_append(NULL, "Accept: application/json");
+    Pthread_mutex_init(&self->mtx, NULL);
     
     return (void *) self;
 }
@@ -281,7 +411,14 @@ ASCOM_dtor(void *_self)
 {
     struct ASCOM *self = cast(ASCOM(), _self);
     
+    size_t i;
    
+    for (i = 0; i < self->n_handle; i++) {
+        curl_easy_cleanup(self->handles[i]);
+    }
+    curl_slist_free_all(self->headers);
+    Pthread_mutex_destroy(&self->mtx);
+    free(self->url);
     free(self->address);
     free(self->port);
     free(self->version);
@@ -366,12 +503,31 @@ static const void *_ASCOM;
 static void
 ASCOM_destroy(void)
 {
+    int i;
+    
     free((void *)_ASCOM);
+    curl_share_cleanup(ascom_share);
+    for (i = 0; i < CURL_LOCK_DATA_LAST; i++) {
+        Pthread_mutex_destroy(&ascom_share_mtx[i]);
+    }
+    curl_global_cleanup();
 }
 
 static void
 ASCOM_initialize(void)
 {
+    int i;
+    
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+    for (i = 0; i < CURL_LOCK_DATA_LAST; i++) {
+        Pthread_mutex_init(&ascom_share_mtx[i], NULL);
+    }
+    ascom_share = curl_share_init();
+    curl_share_setopt(ascom_share, CURLSHOPT_LOCKFUNC, ascom_share_lock);
+    curl_share_setopt(ascom_share, CURLSHOPT_UNLOCKFUNC, ascom_share_unlock);
+    curl_share_setopt(ascom_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+    curl_share_setopt(ascom_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+    
     _ASCOM = new(ASCOMClass(), "ASCOM", Object(), sizeof(struct ASCOM),
                  ctor, "ctor", ASCOM_ctor,
                  dtor, "dtor", ASCOM_dtor,
@@ -400,8 +556,8 @@ static void __destructor__(void) __attribute__ ((destructor(_ASCOM_PRIORITY_)));
 static void
 __destructor__(void)
 {
-    Ascom_destroy();
-    AscomClass_destroy();
+    ASCOM_destroy();
+    ASCOMClass_destroy();
 }
 
 static void __constructor__(void) __attribute__ ((constructor(_ASCOM_PRIORITY_)));
@@ -409,8 +565,8 @@ static void __constructor__(void) __attribute__ ((constructor(_ASCOM_PRIORITY_))
 static void
 __constructor__(void)
 {
-    AscomClass_initialize();
-    Ascom_initialize();
+    ASCOMClass_initialize();
+    ASCOM_initialize();
 }
 #endif
 
@@ -429,18 +585,21 @@ ascom_get_bool_value(const char *response, bool *value)
     
     error_code_cjson = cJSON_GetObjectItemCaseSensitive(response_json, "ErrorNumber");
     if (!(cJSON_IsNumber(error_code_cjson))) {
+        status = AAOS_ERROR;
         goto error;
     }
     error_code = error_code_cjson->valueint;
     if (error_code != AAOS_OK) {
+        status = AAOS_EFAILED;
         goto error;
     }
     
     value_json = cJSON_GetObjectItemCaseSensitive(response_json, "Value");
-    if (!(cJSON_IsNumber(value_json))) {
+    if (!(cJSON_IsBool(value_json))) {
+        status = AAOS_ERROR;
         goto error;
     }
-    *value = value_json->valueint;
+    *value = cJSON_IsTrue(value_json);
     
 error:
     cJSON_Delete(response_json);
@@ -461,15 +620,18 @@ ascom_get_integer_value(const char *response, int *value)
     
     error_code_cjson = cJSON_GetObjectItemCaseSensitive(response_json, "ErrorNumber");
     if (!(cJSON_IsNumber(error_code_cjson))) {
+        status = AAOS_ERROR;
         goto error;
     }
     error_code = error_code_cjson->valueint;
     if (error_code != AAOS_OK) {
+        status = AAOS_EFAILED;
         goto error;
     }
     
     value_json = cJSON_GetObjectItemCaseSensitive(response_json, "Value");
     if (!(cJSON_IsNumber(value_json))) {
+        status = AAOS_ERROR;
         goto error;
     }
     *value = value_json->valueint;
@@ -492,15 +654,18 @@ ascom_get_double_value(const char *response, double *value)
     
     error_code_cjson = cJSON_GetObjectItemCaseSensitive(response_json, "ErrorNumber");
     if (!(cJSON_IsNumber(error_code_cjson))) {
+        status = AAOS_ERROR;
         goto error;
     }
     error_code = error_code_cjson->valueint;
     if (error_code != AAOS_OK) {
+        status = AAOS_EFAILED;
         goto error;
     }
     
     value_json = cJSON_GetObjectItemCaseSensitive(response_json, "Value");
     if (!(cJSON_IsNumber(value_json))) {
+        status = AAOS_ERROR;
         goto error;
     }
     *value = value_json->valuedouble;
@@ -523,15 +688,18 @@ ascom_get_string_value(const char *response, char *value, size_t size)
     
     error_code_cjson = cJSON_GetObjectItemCaseSensitive(response_json, "ErrorNumber");
     if (!(cJSON_IsNumber(error_code_cjson))) {
+        status = AAOS_ERROR;
         goto error;
     }
     error_code = error_code_cjson->valueint;
     if (error_code != AAOS_OK) {
+        status = AAOS_EFAILED;
         goto error;
     }
     
     value_json = cJSON_GetObjectItemCaseSensitive(response_json, "Value");
-    if (!(cJSON_IsNumber(value_json))) {
+    if (!(cJSON_IsString(value_json))) {
+        status = AAOS_ERROR;
         goto error;
     }
     
@@ -555,6 +723,7 @@ ascom_get_error_code(const char *response, int *error_code)
     
     error_code_cjson = cJSON_GetObjectItemCaseSensitive(response_json, "ErrorNumber");
     if (!(cJSON_IsNumber(error_code_cjson))) {
+        status = AAOS_ERROR;
         goto error;
     }
     *error_code = error_code_cjson->valueint;
@@ -734,3 +903,5 @@ error:
     return ret;
 }
 */
+
+#endif /* __USE_ASCOM__ */
@@ -17,8 +17,14 @@ extern "C"
 #include <string.h>
 #include <stdbool.h>
 
-int ascom_put(void *_self, const char *command, const char *request_data, char *response_data, size_t *size);
-int ascom_get(void *_self, const char *command, char *response_data, size_t *size);
+/*
+ * *response_data is reallocated to hold the response, and must be freed by the caller.
+ */
+int ascom_put(void *_self, const char *command, const char *request_data, char **response_data, size_t *size);
+int ascom_get(void *_self, const char *command, char **response_data, size_t *size);
+
+int ascom_get_multi(void *_self, size_t n, const char **commands, char **response_data, size_t *sizes, int *results);
+void ascom_set_timeout(void *_self, double connect_timeout, double timeout);
 
 int ascom_get_bool_value(const char *response, bool *value);
 int ascom_get_integer_value(const char *response, int *value);
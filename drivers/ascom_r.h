@@ -9,9 +9,21 @@
 #ifndef ascom_r_h
 #define ascom_r_h
 
+#include <pthread.h>
+#include <curl/curl.h>
+
 #include "object_r.h"
 #define _ASCOM_PRIORITY_ 102
 
+#define ASCOM_CONNECT_TIMEOUT   2.
+#define ASCOM_TIMEOUT           10.
+#define ASCOM_MAX_HANDLE        4
+
+/*
+ * Handles are kept in a pool of every device, and their connections are kept alive
+ * in a connection cache, shared by all the devices together with a DNS cache,
+ * so that devices on the same Alpaca server use the same connections.
+ */
 struct ASCOM {
     struct Object _;
     char *address;
@@ -19,6 +31,13 @@ struct ASCOM {
     char *version;
     char *device_type;
     unsigned int device_number;
+    char *url;
+    double connect_timeout;
+    double timeout;
+    struct curl_slist *headers;
+    CURL *handles[ASCOM_MAX_HANDLE];
+    size_t n_handle;
+    pthread_mutex_t mtx;
 };
 
 struct ASCOMClass {
@@ -10,11 +10,13 @@
  * Segmentation error, index -1 VS -2.
  */
 
+#include "aws_archive.h"
 #include "aws_def.h"
 #include "aws.h"
 #include "aws_r.h"
 #include "def.h"
 #include "protocol.h"
+#include "rtd.h"
 #include "serial_rpc.h"
 #include "wrapper.h"
 
@@ -643,6 +645,23 @@ Sensor(void)
 
 static int KLAWSController_try_connect(struct KLAWSController *self);
 
+/*
+ * Exchange the command of a sensor with the serial server, or take the reply
+ * prefetched for it by the batch sweep running in this thread. A read from any
+ * other thread goes to the serial server. Called with the controller lock held,
+ * which also guards the prefetched reply.
+ */
+static int
+Sensor_raw(struct Sensor *self, void *serial, char *buf, size_t size)
+{
+    if (self->reply != NULL && pthread_equal(self->reply_thread, pthread_self())) {
+        memcpy(buf, self->reply, size < BUFSIZE ? size : BUFSIZE);
+        return self->reply_status;
+    }
+    
+    return serial_raw(serial, self->command, strlen(self->command), buf, size, NULL);
+}
+
 /*
  * PT100 temperature sensor.
  */
@@ -697,6 +716,10 @@ PT100Class_initialize(void)
     _PT100Class = new(SensorClass(), "PT100Class", SensorClass(), sizeof(struct PT100Class),
                            ctor, "", PT100Class_ctor,
                            (void *) 0);
+    /*
+     * Build the conversion table before any PT100 sensor is read.
+     */
+    rtd_pt100();
 #ifndef _USE_COMPILER_ATTRIBUTION_
     atexit(PT100Class_destroy);
 #endif
@@ -745,270 +768,10 @@ PT100(void)
     return _PT100;
 }
 
-#ifdef __USE_GSL__
-static const double PT100_resistance[] = {
-    18.52, 18.95, 19.38, 19.82, 20.25, 20.68, 21.11, 21.54, 21.97, 22.40,
-    22.83, 23.25, 23.68, 24.11, 24.54, 24.97, 25.39, 25.82, 26.24, 26.67,
-    27.10, 27.52, 27.95, 28.37, 28.80, 29.22, 29.64, 30.07, 30.49, 30.91,
-    31.34, 31.76, 32.18, 32.60, 33.02, 33.44, 33.86, 34.28, 34.70, 35.12,
-    35.54, 35.96, 36.38, 36.80, 37.22, 37.64, 38.05, 38.47, 38.89, 39.31,
-    39.72, 40.14, 40.56, 40.97, 41.39, 41.80, 42.22, 42.63, 43.05, 43.46,
-    43.88, 44.29, 44.70, 45.12, 45.53, 45.94, 46.36, 46.77, 47.18, 47.59,
-    48.00, 48.42, 48.83, 49.24, 49.65, 50.06, 50.47, 50.88, 51.29, 51.70,
-    52.11, 52.52, 52.93, 53.34, 53.75, 54.15, 54.56, 54.97, 55.38, 55.79,
-    56.19, 56.60, 57.01, 57.41, 57.82, 58.23, 58.63, 59.04, 59.44, 59.85,
-    60.26, 60.66, 61.07, 61.47, 61.88, 62.28, 62.68, 63.09, 63.49, 63.90,
-    64.30, 64.70, 65.11, 65.51, 65.91, 66.31, 66.72, 67.12, 67.52, 67.92,
-    68.33, 68.73, 69.13, 69.53, 69.93, 70.33, 70.73, 71.13, 71.53, 71.93,
-    72.33, 72.73, 73.13, 73.53, 73.93, 74.33, 74.73, 75.13, 75.53, 75.93,
-    76.33, 76.73, 77.13, 77.52, 77.92, 78.32, 78.72, 79.11, 79.51, 79.91,
-    80.31, 80.70, 81.10, 81.50, 81.89, 82.29, 82.69, 83.08, 83.48, 83.88,
-    84.27, 84.67, 85.06, 85.46, 85.85, 86.25, 86.64, 87.04, 87.43, 87.83,
-    88.22, 88.62, 89.01, 89.40, 89.80, 90.19, 90.59, 90.93, 91.37, 91.77,
-    92.16, 92.55, 92.95, 93.34, 93.73, 94.12, 94.52, 94.91, 95.30, 95.69,
-    96.09, 96.48, 96.87, 97.26, 97.65, 98.04, 98.44, 98.83, 99.22, 99.61,
-    100.00, 100.39, 100.78, 101.17, 101.56, 101.95, 102.34, 102.73, 103.12, 103.51,
-    103.90, 104.29, 104.68, 105.07, 105.46, 105.85, 106.24, 106.63, 107.02, 107.40,
-    107.79, 108.18, 108.75, 108.96, 109.35, 109.73, 110.12, 110.51, 110.90, 111.28,
-    111.67, 112.06, 112.45, 112.83, 113.22, 113.61, 113.99, 114.38, 114.77, 115.15,
-    115.54, 115.93, 116.31, 116.70, 117.08, 117.47, 117.85, 118.24, 118.62, 119.01,
-    119.40, 119.78, 120.16, 120.55, 120.93, 121.32, 121.70, 122.09, 122.47, 122.86,
-    123.24, 123.62, 124.01, 124.39, 124.77, 125.16, 125.54, 125.92, 126.31, 126.69,
-    127.07, 127.45, 127.84, 128.22, 128.60, 128.98, 129.37, 129.75, 130.13, 130.51,
-    130.89, 131.27, 131.66, 132.04, 132.42, 132.80, 133.18, 133.56, 133.94, 134.32,
-    134.70, 135.08, 135.46, 135.84, 136.22, 136.60, 136.98, 137.36, 137.74, 138.12,
-    138.50, 138.88, 139.26, 139.64, 140.02, 140.39, 140.77, 141.15, 141.53, 141.91,
-    142.29, 142.66, 143.04, 143.42, 143.80, 144.17, 144.55, 144.93, 145.31, 145.68,
-    146.06, 146.44, 146.81, 147.19, 147.57, 147.94, 148.32, 148.70, 149.07, 149.45,
-    149.82, 150.20, 150.57, 150.95, 151.33, 151.70, 152.08, 152.45, 152.83, 153.20,
-    153.58, 153.95, 154.32, 154.70, 155.07, 155.45, 155.82, 156.19, 156.57, 156.94,
-    157.31, 157.69, 158.06, 158.43, 158.81, 159.18, 159.55, 159.93, 160.30, 160.67,
-    161.04, 161.42, 161.79, 162.16, 162.53, 162.90, 163.27, 163.65, 164.02, 164.39,
-    164.76, 165.13, 165.50, 165.87, 166.24, 166.61, 166.98, 167.35, 167.72, 168.09,
-    168.46, 168.83, 169.20, 169.57, 169.94, 170.31, 170.68, 171.05, 171.42, 171.79,
-    172.16, 172.53, 172.90, 173.26, 173.63, 174.00, 174.37, 174.74, 175.10, 175.47,
-    175.84, 176.21, 176.57, 176.94, 177.31, 177.68, 178.04, 178.41, 178.78, 179.14,
-    179.51, 179.88, 180.24, 180.61, 180.97, 181.34, 181.71, 182.07, 182.44, 182.80,
-    183.17, 183.53, 183.90, 184.26, 184.63, 184.99, 185.36, 185.72, 186.09, 186.45,
-    186.82, 187.18, 187.54, 187.91, 188.27, 188.63, 189.00, 189.36, 189.72, 190.09,
-    190.45, 190.81, 191.18, 191.54, 191.90, 192.26, 192.63, 192.99, 193.35, 193.71,
-    194.07, 194.44, 194.80, 195.16, 195.52, 195.88, 196.24, 196.60, 196.96, 197.33,
-    197.69, 198.05, 198.41, 198.77, 199.13, 199.49, 199.85, 200.21, 200.57, 200.93,
-    201.29, 201.65, 202.01, 202.36, 202.72, 203.08, 203.44, 203.80, 204.16, 204.52,
-    204.88, 205.23, 205.59, 205.95, 206.31, 206.67, 207.02, 207.38, 207.74, 208.10,
-    208.45, 208.81, 209.17, 209.52, 209.88, 210.24, 210.59, 210.95, 211.31, 211.66,
-    212.02, 212.37, 212.73, 213.09, 213.44, 213.80, 214.15, 214.51, 214.86, 215.22,
-    215.57, 215.93, 216.28, 216.64, 216.99, 217.35, 217.70, 218.05, 218.41, 218.76,
-    219.12, 219.47, 219.82, 220.18, 220.53, 220.88, 221.24, 221.59, 221.94, 222.29,
-    222.65, 223.00, 223.35, 223.70, 224.06, 224.41, 224.76, 225.11, 225.46, 225.81,
-    226.17, 226.52, 226.87, 227.22, 227.57, 227.92, 228.27, 228.62, 228.97, 229.32,
-    229.62, 230.02, 230.42, 230.82, 231.22, 231.62, 232.02, 232.42, 232.82, 233.01,
-    233.17, 233.52, 233.87, 234.22, 234.56, 234.91, 235.26, 235.61, 235.96, 236.31,
-    236.65, 237.00, 237.35, 237.70, 238.04, 238.39, 238.74, 239.09, 239.45, 239.78,
-    240.13, 240.47, 240.82, 241.17, 241.51, 241.86, 242.20, 242.55, 242.90, 243.24,
-    243.59, 243.93, 244.28, 244.62, 244.97, 245.31, 245.66, 246.00, 246.35, 246.69,
-    247.04, 247.38, 247.73, 248.07, 248.41, 248.76, 249.10, 249.45, 249.79, 250.13,
-    250.48, 250.82, 251.16, 251.50, 251.85, 252.19, 252.53, 252.87, 253.22, 253.56,
-    253.90, 254.24, 254.59, 254.93, 255.27, 255.61, 255.95, 256.29, 256.64, 256.98,
-    257.32, 257.66, 258.00, 258.34, 258.68, 259.02, 259.36, 259.70, 260.04, 260.38,
-    260.72, 261.06, 261.40, 261.74, 262.08, 262.42, 262.76, 263.10, 263.43, 263.77,
-    264.11, 264.45, 264.79, 265.13, 265.47, 265.80, 266.14, 266.48, 266.82, 267.15,
-    267.49, 267.83, 268.17, 268.50, 268.84, 269.18, 269.51, 269.85, 270.19, 270.52,
-    270.86, 271.20, 271.53, 271.87, 272.20, 272.54, 272.88, 273.21, 273.55, 273.88,
-    274.22, 274.55, 274.89, 275.22, 275.56, 275.89, 276.23, 276.56, 276.89, 277.23,
-    277.56, 277.90, 278.23, 278.56, 278.90, 279.23, 279.56, 279.90, 280.23, 280.56,
-    280.90, 281.23, 281.56, 281.89, 282.23, 282.56, 282.89, 283.22, 283.55, 283.89,
-    284.22, 284.55, 284.88, 285.21, 285.54, 285.87, 286.21, 286.54, 286.87, 287.20,
-    287.53, 287.86, 288.19, 288.52, 288.85, 289.18, 289.51, 289.84, 290.17, 290.50,
-    290.83, 291.16, 291.49, 291.81, 292.14, 292.47, 292.80, 293.13, 293.46, 293.79,
-    294.11, 294.44, 294.77, 295.10, 295.43, 295.75, 296.08, 296.41, 296.74, 297.06,
-    297.39, 297.72, 298.04, 298.37, 298.70, 299.02, 299.35, 299.68, 300.00, 300.33,
-    300.65, 300.98, 301.31, 301.63, 301.96, 302.28, 302.61, 302.93, 303.26, 303.58,
-    303.91, 304.23, 304.56, 304.88, 305.20, 305.53, 305.85, 306.18, 306.50, 306.82,
-    307.15, 307.47, 307.79, 308.12, 308.44, 308.76, 309.09, 309.41, 309.73, 310.05,
-    310.38, 310.70, 311.02, 311.34, 311.67, 311.99, 312.31, 312.63, 312.95, 313.27,
-    313.59, 313.92, 314.24, 314.56, 314.88, 315.20, 315.52, 315.84, 316.16, 316.48,
-    316.80, 317.12, 317.44, 317.76, 318.08, 318.40, 318.72, 319.04, 319.36, 319.68,
-    319.99, 320.31, 320.63, 320.95, 321.27, 321.59, 321.91, 322.22, 322.54, 322.86,
-    323.18, 323.49, 323.81, 324.13, 324.45, 324.76, 325.08, 325.40, 325.72, 326.03,
-    326.35, 326.66, 326.98, 327.30, 327.61, 327.93, 328.25, 328.56, 328.88, 329.19,
-    329.51, 329.82, 330.14, 330.45, 330.77, 331.08, 331.40, 331.71, 332.03, 332.34,
-    332.66, 332.97, 333.28, 333.60, 333.91, 334.23, 334.54, 334.85, 335.17, 335.48,
-    335.79, 336.11, 336.42, 336.73, 337.04, 337.36, 337.67, 337.98, 338.29, 338.61,
-    338.92, 339.23, 339.54, 339.85, 340.16, 340.48, 340.79, 341.10, 341.41, 341.72,
-    342.03, 342.34, 342.65, 342.96, 343.27, 343.58, 343.89, 344.20, 344.51, 344.82,
-    345.13, 345.44, 345.75, 346.06, 346.37, 346.68, 346.99, 347.30, 347.60, 347.91,
-    348.22, 348.53, 348.84, 349.15, 349.45, 349.76, 350.07, 350.38, 350.69, 350.99,
-    351.30, 351.61, 351.91, 352.22, 352.53, 352.83, 353.14, 353.45, 353.75, 354.06,
-    354.37, 354.67, 354.98, 355.28, 355.59, 355.90, 356.20, 356.51, 356.81, 357.12,
-    357.42, 357.73, 358.03, 358.34, 358.64, 358.95, 359.25, 359.55, 359.86, 360.16,
-    360.47, 360.77, 361.07, 361.38, 361.68, 361.98, 362.29, 362.59, 362.89, 363.19,
-    363.50, 363.80, 364.10, 364.40, 364.71, 365.01, 365.31, 365.61, 365.91, 366.22,
-    366.52, 366.82, 367.12, 367.42, 367.72, 368.02, 368.32, 368.63, 368.93, 369.23,
-    369.53, 369.83, 370.13, 370.43, 370.73, 371.03, 371.33, 371.63, 371.93, 372.22,
-    372.52, 372.82, 373.12, 373.42, 373.72, 374.02, 374.32, 374.61, 374.91, 375.21,
-    375.51, 375.81, 376.10, 376.40, 376.70, 377.00, 377.29, 377.59, 377.89, 378.19
-};
-
-static const double PT100_temperature[] = {
-    -200.00, -199.00, -198.00, -197.00, -196.00, -195.00, -194.00, -193.00, -192.00, -191.00,
-    -190.00, -189.00, -188.00, -187.00, -186.00, -185.00, -184.00, -183.00, -182.00, -181.00,
-    -180.00, -179.00, -178.00, -177.00, -176.00, -175.00, -174.00, -173.00, -172.00, -171.00,
-    -170.00, -169.00, -168.00, -167.00, -166.00, -165.00, -164.00, -163.00, -162.00, -161.00,
-    -160.00, -159.00, -158.00, -157.00, -156.00, -155.00, -154.00, -153.00, -152.00, -151.00,
-    -150.00, -149.00, -148.00, -147.00, -146.00, -145.00, -144.00, -143.00, -142.00, -141.00,
-    -140.00, -139.00, -138.00, -137.00, -136.00, -135.00, -134.00, -133.00, -132.00, -131.00,
-    -130.00, -129.00, -128.00, -127.00, -126.00, -125.00, -124.00, -123.00, -122.00, -121.00,
-    -120.00, -119.00, -118.00, -117.00, -116.00, -115.00, -114.00, -113.00, -112.00, -111.00,
-    -110.00, -109.00, -108.00, -107.00, -106.00, -105.00, -104.00, -103.00, -102.00, -101.00,
-    -100.00, -99.00, -98.00, -97.00, -96.00, -95.00, -94.00, -93.00, -92.00, -91.00,
-    -90.00, -89.00, -88.00, -87.00, -86.00, -85.00, -84.00, -83.00, -82.00, -81.00,
-    -80.00, -79.00, -78.00, -77.00, -76.00, -75.00, -74.00, -73.00, -72.00, -71.00,
-    -70.00, -69.00, -68.00, -67.00, -66.00, -65.00, -64.00, -63.00, -62.00, -61.00,
-    -60.00, -59.00, -58.00, -57.00, -56.00, -55.00, -54.00, -53.00, -52.00, -51.00,
-    -50.00, -49.00, -48.00, -47.00, -46.00, -45.00, -44.00, -43.00, -42.00, -41.00,
-    -40.00, -39.00, -38.00, -37.00, -36.00, -35.00, -34.00, -33.00, -32.00, -31.00,
-    -30.00, -29.00, -28.00, -27.00, -26.00, -25.00, -24.00, -23.00, -22.00, -21.00,
-    -20.00, -19.00, -18.00, -17.00, -16.00, -15.00, -14.00, -13.00, -12.00, -11.00,
-    -10.00, -9.00, -8.00, -7.00, -6.00, -5.00, -4.00, -3.00, -2.00, -1.00,
-    0.00, 1.00, 2.00, 3.00, 4.00, 5.00, 6.00, 7.00, 8.00, 9.00,
-    10.00, 11.00, 12.00, 13.00, 14.00, 15.00, 16.00, 17.00, 18.00, 19.00,
-    20.00, 21.00, 22.00, 23.00, 24.00, 25.00, 26.00, 27.00, 28.00, 29.00,
-    30.00, 31.00, 32.00, 33.00, 34.00, 35.00, 36.00, 37.00, 38.00, 39.00,
-    40.00, 41.00, 42.00, 43.00, 44.00, 45.00, 46.00, 47.00, 48.00, 49.00,
-    50.00, 51.00, 52.00, 53.00, 54.00, 55.00, 56.00, 57.00, 58.00, 59.00,
-    60.00, 61.00, 62.00, 63.00, 64.00, 65.00, 66.00, 67.00, 68.00, 69.00,
-    70.00, 71.00, 72.00, 73.00, 74.00, 75.00, 76.00, 77.00, 78.00, 79.00,
-    80.00, 81.00, 82.00, 83.00, 84.00, 85.00, 86.00, 87.00, 88.00, 89.00,
-    90.00, 91.00, 92.00, 93.00, 94.00, 95.00, 96.00, 97.00, 98.00, 99.00,
-    100.00, 101.00, 102.00, 103.00, 104.00, 105.00, 106.00, 107.00, 108.00, 109.00,
-    110.00, 111.00, 112.00, 113.00, 114.00, 115.00, 116.00, 117.00, 118.00, 119.00,
-    120.00, 121.00, 122.00, 123.00, 124.00, 125.00, 126.00, 127.00, 128.00, 129.00,
-    130.00, 131.00, 132.00, 133.00, 134.00, 135.00, 136.00, 137.00, 138.00, 139.00,
-    140.00, 141.00, 142.00, 143.00, 144.00, 145.00, 146.00, 147.00, 148.00, 149.00,
-    150.00, 151.00, 152.00, 153.00, 154.00, 155.00, 156.00, 157.00, 158.00, 159.00,
-    160.00, 161.00, 162.00, 163.00, 164.00, 165.00, 166.00, 167.00, 168.00, 169.00,
-    170.00, 171.00, 172.00, 173.00, 174.00, 175.00, 176.00, 177.00, 178.00, 179.00,
-    180.00, 181.00, 182.00, 183.00, 184.00, 185.00, 186.00, 187.00, 188.00, 189.00,
-    190.00, 191.00, 192.00, 193.00, 194.00, 195.00, 196.00, 197.00, 198.00, 199.00,
-    200.00, 201.00, 202.00, 203.00, 204.00, 205.00, 206.00, 207.00, 208.00, 209.00,
-    210.00, 211.00, 212.00, 213.00, 214.00, 215.00, 216.00, 217.00, 218.00, 219.00,
-    220.00, 221.00, 222.00, 223.00, 224.00, 225.00, 226.00, 227.00, 228.00, 229.00,
-    230.00, 231.00, 232.00, 233.00, 234.00, 235.00, 236.00, 237.00, 238.00, 239.00,
-    240.00, 241.00, 242.00, 243.00, 244.00, 245.00, 246.00, 247.00, 248.00, 249.00,
-    250.00, 251.00, 252.00, 253.00, 254.00, 255.00, 256.00, 257.00, 258.00, 259.00,
-    260.00, 261.00, 262.00, 263.00, 264.00, 265.00, 266.00, 267.00, 268.00, 269.00,
-    270.00, 271.00, 272.00, 273.00, 274.00, 275.00, 276.00, 277.00, 278.00, 279.00,
-    280.00, 281.00, 282.00, 283.00, 284.00, 285.00, 286.00, 287.00, 288.00, 289.00,
-    290.00, 291.00, 292.00, 293.00, 294.00, 295.00, 296.00, 297.00, 298.00, 299.00,
-    300.00, 301.00, 302.00, 303.00, 304.00, 305.00, 306.00, 307.00, 308.00, 309.00,
-    310.00, 311.00, 312.00, 313.00, 314.00, 315.00, 316.00, 317.00, 318.00, 319.00,
-    320.00, 321.00, 322.00, 323.00, 324.00, 325.00, 326.00, 327.00, 328.00, 329.00,
-    330.00, 331.00, 332.00, 333.00, 334.00, 335.00, 336.00, 337.00, 338.00, 339.00,
-    340.00, 341.00, 342.00, 343.00, 344.00, 345.00, 346.00, 347.00, 348.00, 349.00,
-    350.00, 351.00, 352.00, 353.00, 354.00, 355.00, 356.00, 357.00, 358.00, 359.00,
-    360.00, 361.00, 362.00, 363.00, 364.00, 365.00, 366.00, 367.00, 368.00, 369.00,
-    370.00, 371.00, 372.00, 373.00, 374.00, 375.00, 376.00, 377.00, 378.00, 379.00,
-    380.00, 381.00, 382.00, 383.00, 384.00, 385.00, 386.00, 387.00, 388.00, 389.00,
-    390.00, 391.00, 392.00, 393.00, 394.00, 395.00, 396.00, 397.00, 398.00, 399.00,
-    400.00, 401.00, 402.00, 403.00, 404.00, 405.00, 406.00, 407.00, 408.00, 409.00,
-    410.00, 411.00, 412.00, 413.00, 414.00, 415.00, 416.00, 417.00, 418.00, 419.00,
-    420.00, 421.00, 422.00, 423.00, 424.00, 425.00, 426.00, 427.00, 428.00, 429.00,
-    430.00, 431.00, 432.00, 433.00, 434.00, 435.00, 436.00, 437.00, 438.00, 439.00,
-    440.00, 441.00, 442.00, 443.00, 444.00, 445.00, 446.00, 447.00, 448.00, 449.00,
-    450.00, 451.00, 452.00, 453.00, 454.00, 455.00, 456.00, 457.00, 458.00, 459.00,
-    460.00, 461.00, 462.00, 463.00, 464.00, 465.00, 466.00, 467.00, 468.00, 469.00,
-    470.00, 471.00, 472.00, 473.00, 474.00, 475.00, 476.00, 477.00, 478.00, 479.00,
-    480.00, 481.00, 482.00, 483.00, 484.00, 485.00, 486.00, 487.00, 488.00, 489.00,
-    490.00, 491.00, 492.00, 493.00, 494.00, 495.00, 496.00, 497.00, 498.00, 499.00,
-    500.00, 501.00, 502.00, 503.00, 504.00, 505.00, 506.00, 507.00, 508.00, 509.00,
-    510.00, 511.00, 512.00, 513.00, 514.00, 515.00, 516.00, 517.00, 518.00, 519.00,
-    520.00, 521.00, 522.00, 523.00, 524.00, 525.00, 526.00, 527.00, 528.00, 529.00,
-    530.00, 531.00, 532.00, 533.00, 534.00, 535.00, 536.00, 537.00, 538.00, 539.00,
-    540.00, 541.00, 542.00, 543.00, 544.00, 545.00, 546.00, 547.00, 548.00, 549.00,
-    550.00, 551.00, 552.00, 553.00, 554.00, 555.00, 556.00, 557.00, 558.00, 559.00,
-    560.00, 561.00, 562.00, 563.00, 564.00, 565.00, 566.00, 567.00, 568.00, 569.00,
-    570.00, 571.00, 572.00, 573.00, 574.00, 575.00, 576.00, 577.00, 578.00, 579.00,
-    580.00, 581.00, 582.00, 583.00, 584.00, 585.00, 586.00, 587.00, 588.00, 589.00,
-    590.00, 591.00, 592.00, 593.00, 594.00, 595.00, 596.00, 597.00, 598.00, 599.00,
-    600.00, 601.00, 602.00, 603.00, 604.00, 605.00, 606.00, 607.00, 608.00, 609.00,
-    610.00, 611.00, 612.00, 613.00, 614.00, 615.00, 616.00, 617.00, 618.00, 619.00,
-    620.00, 621.00, 622.00, 623.00, 624.00, 625.00, 626.00, 627.00, 628.00, 629.00,
-    630.00, 631.00, 632.00, 633.00, 634.00, 635.00, 636.00, 637.00, 638.00, 639.00,
-    640.00, 641.00, 642.00, 643.00, 644.00, 645.00, 646.00, 647.00, 648.00, 649.00,
-    650.00, 651.00, 652.00, 653.00, 654.00, 655.00, 656.00, 657.00, 658.00, 659.00,
-    660.00, 661.00, 662.00, 663.00, 664.00, 665.00, 666.00, 667.00, 668.00, 669.00,
-    670.00, 671.00, 672.00, 673.00, 674.00, 675.00, 676.00, 677.00, 678.00, 679.00,
-    680.00, 681.00, 682.00, 683.00, 684.00, 685.00, 686.00, 687.00, 688.00, 689.00,
-    690.00, 691.00, 692.00, 693.00, 694.00, 695.00, 696.00, 697.00, 698.00, 699.00,
-    700.00, 701.00, 702.00, 703.00, 704.00, 705.00, 706.00, 707.00, 708.00, 709.00,
-    710.00, 711.00, 712.00, 713.00, 714.00, 715.00, 716.00, 717.00, 718.00, 719.00,
-    720.00, 721.00, 722.00, 723.00, 724.00, 725.00, 726.00, 727.00, 728.00, 729.00,
-    730.00, 731.00, 732.00, 733.00, 734.00, 735.00, 736.00, 737.00, 738.00, 739.00,
-    740.00, 741.00, 742.00, 743.00, 744.00, 745.00, 746.00, 747.00, 748.00, 749.00,
-    750.00, 751.00, 752.00, 753.00, 754.00, 755.00, 756.00, 757.00, 758.00, 759.00,
-    760.00, 761.00, 762.00, 763.00, 764.00, 765.00, 766.00, 767.00, 768.00, 769.00,
-    770.00, 771.00, 772.00, 773.00, 774.00, 775.00, 776.00, 777.00, 778.00, 779.00,
-    780.00, 781.00, 782.00, 783.00, 784.00, 785.00, 786.00, 787.00, 788.00, 789.00,
-    790.00, 791.00, 792.00, 793.00, 794.00, 795.00, 796.00, 797.00, 798.00, 799.00,
-    800.00, 801.00, 802.00, 803.00, 804.00, 805.00, 806.00, 807.00, 808.00, 809.00
-};
-
-#include <gsl/gsl_errno.h>
-#include <gsl/gsl_spline.h>
-
-static gsl_interp_accel *PT100_acc;
-static gsl_spline *PT100_spline;
-
-#else
-
-#define A -2.45002301e+02
-#define B 2.33913372e-01
-#define C 1.10965165e-05
-
-#define A_ -2.45679585e+02
-#define B_ 2.35566770e-01
-#define C_ 1.01150208e-05
-
-double
-PT100_r2t_1(double r)
-{
-    r = r * 10.;
-    return A + B * r + C * r * r;
-}
-
-double
-PT100_r2t_2(double r)
-{
-    r = r * 10.;
-    return A_ + B_ * r + C_ * r * r;
-}
-
-#endif
-
 static double
 PT100_r2t(double resistance)
 {
-#ifdef __USE_GSL__
-    
-    double temperature;
-    int ret;
-    
-    if ((ret = gsl_spline_eval_e(PT100_spline, resistance, PT100_acc, &temperature)) == GSL_SUCCESS) {
-        return temperature;
-    } else {
-        return 9999.;
-    }
-#else
-    if (resistance <= 100.) {
-        return PT100_r2t_1(resistance);
-    } else if (resistance > 100. && resistance < 900.){
-        return PT100_r2t_2(resistance);
-    } else {
-        return 9999.;
-    }
-#endif
-    
+    return rtd_r2t(rtd_pt100(), resistance);
 }
 
 static int
@@ -1033,7 +796,7 @@ PT100_read_data(void *_self, double *data, size_t size)
     }
     protobuf_set(serial, PACKET_INDEX, index);
     
-    if ((ret = serial_raw(serial, self->command, strlen(self->command), buf, BUFSIZE, NULL)) == AAOS_OK) {
+    if ((ret = Sensor_raw(self, serial, buf, BUFSIZE)) == AAOS_OK) {
         const char *s = buf + 1;
         data[0] = atof(s);
         struct PT100 *myself = cast(PT100(), _self);
@@ -1054,7 +817,7 @@ PT100_read_data(void *_self, double *data, size_t size)
             case -1 * AAOS_ETIMEDOUT:
             case -1 * AAOS_ENETDOWN:
             case -1 * AAOS_ENETUNREACH:
-                if ((ret = KLAWSController_try_connect(self->controller)) == AAOS_OK && (ret = serial_raw(serial, self->command, strlen(self->command), buf, BUFSIZE, NULL)) == AAOS_OK) {
+                if ((ret = KLAWSController_try_connect(self->controller)) == AAOS_OK && (ret = Sensor_raw(self, serial, buf, BUFSIZE)) == AAOS_OK) {
                     const char *s = buf + 1;
                     data[0] = atof(s);
                     struct PT100 *myself = cast(PT100(), _self);
@@ -1097,7 +860,7 @@ PT100_read_raw_data(void *_self, void *data, size_t size)
         }
     }
     protobuf_set(serial, PACKET_INDEX, index);
-    if ((ret = serial_raw(serial, self->command, strlen(self->command), buf, BUFSIZE, NULL)) == AAOS_OK) {
+    if ((ret = Sensor_raw(self, serial, buf, BUFSIZE)) == AAOS_OK) {
         const char *s = buf + 1;
         snprintf(data, size, "%s", s);
     } else {
@@ -1107,7 +870,7 @@ PT100_read_raw_data(void *_self, void *data, size_t size)
             case -1 * AAOS_ETIMEDOUT:
             case -1 * AAOS_ENETDOWN:
             case -1 * AAOS_ENETUNREACH:
-                if ((ret = KLAWSController_try_connect(self->controller)) == AAOS_OK && (ret = serial_raw(serial, self->command, strlen(self->command), buf, BUFSIZE, NULL)) == AAOS_OK) {
+                if ((ret = KLAWSController_try_connect(self->controller)) == AAOS_OK && (ret = Sensor_raw(self, serial, buf, BUFSIZE)) == AAOS_OK) {
                     const char *s = buf + 1;
                     snprintf(data, size, "%s", s);
                 }
@@ -1202,6 +965,7 @@ AAGPDUPT1000Class_initialize(void)
     _AAGPDUPT1000Class = new(SensorClass(), "AAGPDUPT1000Class", SensorClass(), sizeof(struct AAGPDUPT1000Class),
                            ctor, "", AAGPDUPT1000Class_ctor,
                            (void *) 0);
+    rtd_pt100();
 #ifndef _USE_COMPILER_ATTRIBUTION_
     atexit(AAGPDUPT1000Class_destroy);
 #endif
@@ -1272,7 +1036,7 @@ AAGPDUPT1000_read_data(void *_self, double *data, size_t size)
     }
     protobuf_set(serial, PACKET_INDEX, index);
     
-    if ((ret = serial_raw(serial, self->command, strlen(self->command), buf, BUFSIZE, NULL)) == AAOS_OK) {
+    if ((ret = Sensor_raw(self, serial, buf, BUFSIZE)) == AAOS_OK) {
         const char *s = strrchr(buf, ':');
         if (s != NULL) {
             s++;
@@ -1298,7 +1062,7 @@ AAGPDUPT1000_read_data(void *_self, double *data, size_t size)
             case -1 * AAOS_ETIMEDOUT:
             case -1 * AAOS_ENETDOWN:
             case -1 * AAOS_ENETUNREACH:
-                if ((ret = KLAWSController_try_connect(self->controller)) == AAOS_OK && (ret = serial_raw(serial, self->command, strlen(self->command), buf, BUFSIZE, NULL)) == AAOS_OK) {
+                if ((ret = KLAWSController_try_connect(self->controller)) == AAOS_OK && (ret = Sensor_raw(self, serial, buf, BUFSIZE)) == AAOS_OK) {
                     const char *s = strrchr(buf, ':');
                     if (s != NULL) {
                         s++;
@@ -1346,7 +1110,7 @@ AAGPDUPT1000_read_raw_data(void *_self, void *data, size_t size)
         }
     }
     protobuf_set(serial, PACKET_INDEX, index);
-    if ((ret = serial_raw(serial, self->command, strlen(self->command), buf, BUFSIZE, NULL)) == AAOS_OK) {
+    if ((ret = Sensor_raw(self, serial, buf, BUFSIZE)) == AAOS_OK) {
         const char *s = strrchr(buf, ':');
         if (s != NULL) {
             s++;
@@ -1359,7 +1123,7 @@ AAGPDUPT1000_read_raw_data(void *_self, void *data, size_t size)
             case -1 * AAOS_ETIMEDOUT:
             case -1 * AAOS_ENETDOWN:
             case -1 * AAOS_ENETUNREACH:
-                if ((ret = KLAWSController_try_connect(self->controller)) == AAOS_OK && (ret = serial_raw(serial, self->command, strlen(self->command), buf, BUFSIZE, NULL)) == AAOS_OK) {
+                if ((ret = KLAWSController_try_connect(self->controller)) == AAOS_OK && (ret = Sensor_raw(self, serial, buf, BUFSIZE)) == AAOS_OK) {
                     const char *s = strrchr(buf, ':');
                     if (s != NULL) {
                         s++;
@@ -1543,7 +1307,7 @@ Young41342_read_data(void *_self, double *data, size_t size)
     protobuf_set(serial, PACKET_INDEX, index);
     
     
-    if ((ret = serial_raw(serial, self->command, strlen(self->command), buf, BUFSIZE, NULL)) == AAOS_OK) {
+    if ((ret = Sensor_raw(self, serial, buf, BUFSIZE)) == AAOS_OK) {
         const char *s = buf + 1;
         data[0] = atof(s);
         struct Young41342 *myself = cast(Young41342(), _self);
@@ -1565,7 +1329,7 @@ Young41342_read_data(void *_self, double *data, size_t size)
             case -1 * AAOS_ETIMEDOUT:
             case -1 * AAOS_ENETDOWN:
             case -1 * AAOS_ENETUNREACH:
-                if ((ret = KLAWSController_try_connect(self->controller)) == AAOS_OK && (ret = serial_raw(serial, self->command, strlen(self->command), buf, BUFSIZE, NULL)) == AAOS_OK) {
+                if ((ret = KLAWSController_try_connect(self->controller)) == AAOS_OK && (ret = Sensor_raw(self, serial, buf, BUFSIZE)) == AAOS_OK) {
                     const char *s = buf + 1;
                     data[0] = atof(s);
                     struct Young41342 *myself = cast(Young41342(), _self);
@@ -1609,7 +1373,7 @@ Young41342_read_raw_data(void *_self, void *data, size_t size)
         }
     }
     protobuf_set(serial, PACKET_INDEX, index);
-    if ((ret = serial_raw(serial, self->command, strlen(self->command), buf, BUFSIZE, NULL)) == AAOS_OK) {
+    if ((ret = Sensor_raw(self, serial, buf, BUFSIZE)) == AAOS_OK) {
         const char *s = buf + 1;
         snprintf(data, size, "%s", s);
     } else {
@@ -1619,7 +1383,7 @@ Young41342_read_raw_data(void *_self, void *data, size_t size)
             case -1 * AAOS_ETIMEDOUT:
             case -1 * AAOS_ENETDOWN:
             case -1 * AAOS_ENETUNREACH:
-                if ((ret = KLAWSController_try_connect(self->controller)) == AAOS_OK && (ret = serial_raw(serial, self->command, strlen(self->command), buf, BUFSIZE, NULL)) == AAOS_OK) {
+                if ((ret = KLAWSController_try_connect(self->controller)) == AAOS_OK && (ret = Sensor_raw(self, serial, buf, BUFSIZE)) == AAOS_OK) {
                     const char *s = buf + 1;
                     snprintf(data, size, "%s", s);
                 }
@@ -1780,7 +1544,7 @@ Young05305VS_read_data(void *_self, double *data, size_t size)
         }
     }
     protobuf_set(serial, PACKET_INDEX, index);
-    if ((ret = serial_raw(serial, self->command, strlen(self->command), buf, BUFSIZE, NULL)) == AAOS_OK) {
+    if ((ret = Sensor_raw(self, serial, buf, BUFSIZE)) == AAOS_OK) {
         const char *s = buf + 1;
         data[0] = atof(s);
         data[0] *= 20.;
@@ -1791,7 +1555,7 @@ Young05305VS_read_data(void *_self, double *data, size_t size)
             case -1 * AAOS_ETIMEDOUT:
             case -1 * AAOS_ENETDOWN:
             case -1 * AAOS_ENETUNREACH:
-                if ((ret = KLAWSController_try_connect(self->controller)) == AAOS_OK && (ret = serial_raw(serial, self->command, strlen(self->command), buf, BUFSIZE, NULL)) == AAOS_OK) {
+                if ((ret = KLAWSController_try_connect(self->controller)) == AAOS_OK && (ret = Sensor_raw(self, serial, buf, BUFSIZE)) == AAOS_OK) {
                     const char *s = buf + 1;
                     data[0] = atof(s);
                     data[0] *= 20.;
@@ -1827,7 +1591,7 @@ Young05305VS_read_raw_data(void *_self, void *data, size_t size)
             return AAOS_ENOTFOUND;
         }
     }
-    if ((ret = serial_raw(serial, self->command, strlen(self->command), buf, BUFSIZE, NULL)) == AAOS_OK) {
+    if ((ret = Sensor_raw(self, serial, buf, BUFSIZE)) == AAOS_OK) {
         const char *s = buf + 1;
         snprintf(data, size, "%s", s);
     } else {
@@ -1837,7 +1601,7 @@ Young05305VS_read_raw_data(void *_self, void *data, size_t size)
             case -1 * AAOS_ETIMEDOUT:
             case -1 * AAOS_ENETDOWN:
             case -1 * AAOS_ENETUNREACH:
-                if ((ret = KLAWSController_try_connect(self->controller)) == AAOS_OK && (ret = serial_raw(serial, self->command, strlen(self->command), buf, BUFSIZE, NULL)) == AAOS_OK) {
+                if ((ret = KLAWSController_try_connect(self->controller)) == AAOS_OK && (ret = Sensor_raw(self, serial, buf, BUFSIZE)) == AAOS_OK) {
                     const char *s = buf + 1;
                     snprintf(data, size, "%s", s);
                 }
@@ -2008,7 +1772,7 @@ Young05305VD_read_data(void *_self, double *data, size_t size)
         }
     }
     protobuf_set(serial, PACKET_INDEX, index);
-    if ((ret = serial_raw(serial, self->command, strlen(self->command), buf, BUFSIZE, NULL)) == AAOS_OK) {
+    if ((ret = Sensor_raw(self, serial, buf, BUFSIZE)) == AAOS_OK) {
         const char *s = buf + 1;
         data[0] = atof(s) * 72. + myself->offset;
         if (data[0] > 360.) {
@@ -2021,7 +1785,7 @@ Young05305VD_read_data(void *_self, double *data, size_t size)
             case -1 * AAOS_ETIMEDOUT:
             case -1 * AAOS_ENETDOWN:
             case -1 * AAOS_ENETUNREACH:
-                if ((ret = KLAWSController_try_connect(self->controller)) == AAOS_OK && (ret = serial_raw(serial, self->command, strlen(self->command), buf, BUFSIZE, NULL)) == AAOS_OK) {
+                if ((ret = KLAWSController_try_connect(self->controller)) == AAOS_OK && (ret = Sensor_raw(self, serial, buf, BUFSIZE)) == AAOS_OK) {
                     const char *s = buf + 1;
                     data[0] = atof(s) * 72. + myself->offset;
                     if (data[0] > 360.) {
@@ -2059,7 +1823,7 @@ Young05305VD_read_raw_data(void *_self, void *data, size_t size)
         }
     }
     protobuf_set(serial, PACKET_INDEX, index);
-    if ((ret = serial_raw(serial, self->command, strlen(self->command), buf, BUFSIZE, NULL)) == AAOS_OK) {
+    if ((ret = Sensor_raw(self, serial, buf, BUFSIZE)) == AAOS_OK) {
         const char *s = buf + 1;
         snprintf(data, size, "%s", s);
     } else {
@@ -2069,7 +1833,7 @@ Young05305VD_read_raw_data(void *_self, void *data, size_t size)
             case -1 * AAOS_ETIMEDOUT:
             case -1 * AAOS_ENETDOWN:
             case -1 * AAOS_ENETUNREACH:
-                if ((ret = KLAWSController_try_connect(self->controller)) == AAOS_OK && (ret = serial_raw(serial, self->command, strlen(self->command), buf, BUFSIZE, NULL)) == AAOS_OK) {
+                if ((ret = KLAWSController_try_connect(self->controller)) == AAOS_OK && (ret = Sensor_raw(self, serial, buf, BUFSIZE)) == AAOS_OK) {
                     const char *s = buf + 1;
                     snprintf(data, size, "%s", s);
                 }
@@ -2230,7 +1994,7 @@ Young61302V_read_data(void *_self, double *data, size_t size)
         }
     }
     protobuf_set(serial, PACKET_INDEX, index);
-    if ((ret = serial_raw(serial, self->command, strlen(self->command), buf, BUFSIZE, NULL)) == AAOS_OK) {
+    if ((ret = Sensor_raw(self, serial, buf, BUFSIZE)) == AAOS_OK) {
         const char *s = buf + 1;
         data[0] = atof(s);
         data[0] = data[0] * 120. + 500.;
@@ -2241,7 +2005,7 @@ Young61302V_read_data(void *_self, double *data, size_t size)
             case -1 * AAOS_ETIMEDOUT:
             case -1 * AAOS_ENETDOWN:
             case -1 * AAOS_ENETUNREACH:
-                if ((ret = KLAWSController_try_connect(self->controller)) == AAOS_OK && (ret = serial_raw(serial, self->command, strlen(self->command), buf, BUFSIZE, NULL)) == AAOS_OK) {
+                if ((ret = KLAWSController_try_connect(self->controller)) == AAOS_OK && (ret = Sensor_raw(self, serial, buf, BUFSIZE)) == AAOS_OK) {
                     const char *s = buf + 1;
                     data[0] = atof(s);
                     data[0] = data[0] * 120. + 500.;
@@ -2278,7 +2042,7 @@ Young61302V_read_raw_data(void *_self, void *data, size_t size)
         }
     }
     protobuf_set(serial, PACKET_INDEX, index);
-    if ((ret = serial_raw(serial, self->command, strlen(self->command), buf, BUFSIZE, NULL)) == AAOS_OK) {
+    if ((ret = Sensor_raw(self, serial, buf, BUFSIZE)) == AAOS_OK) {
         const char *s = buf + 1;
         snprintf(data, size, "%s", s);
     } else {
@@ -2288,7 +2052,7 @@ Young61302V_read_raw_data(void *_self, void *data, size_t size)
             case -1 * AAOS_ETIMEDOUT:
             case -1 * AAOS_ENETDOWN:
             case -1 * AAOS_ENETUNREACH:
-                if ((ret = KLAWSController_try_connect(self->controller)) == AAOS_OK && (ret = serial_raw(serial, self->command, strlen(self->command), buf, BUFSIZE, NULL)) == AAOS_OK) {
+                if ((ret = KLAWSController_try_connect(self->controller)) == AAOS_OK && (ret = Sensor_raw(self, serial, buf, BUFSIZE)) == AAOS_OK) {
                     const char *s = buf + 1;
                     snprintf(data, size, "%s", s);
                 }
@@ -2448,7 +2212,7 @@ PTB210_read_data(void *_self, double *data, size_t size)
         }
     }
     protobuf_set(serial, PACKET_INDEX, index);
-    if ((ret = serial_raw(serial, self->command, strlen(self->command), buf, BUFSIZE, NULL)) == AAOS_OK) {
+    if ((ret = Sensor_raw(self, serial, buf, BUFSIZE)) == AAOS_OK) {
         data[0] = atof(buf);
     } else {
         switch (ret) {
@@ -2457,7 +2221,7 @@ PTB210_read_data(void *_self, double *data, size_t size)
             case -1 * AAOS_ETIMEDOUT:
             case -1 * AAOS_ENETDOWN:
             case -1 * AAOS_ENETUNREACH:
-                if ((ret = KLAWSController_try_connect(self->controller)) == AAOS_OK && (ret = serial_raw(serial, self->command, strlen(self->command), buf, BUFSIZE, NULL)) == AAOS_OK) {
+                if ((ret = KLAWSController_try_connect(self->controller)) == AAOS_OK && (ret = Sensor_raw(self, serial, buf, BUFSIZE)) == AAOS_OK) {
                     data[0] = atof(buf);
                 }
                 break;
@@ -2492,7 +2256,7 @@ PTB210_read_raw_data(void *_self, void *data, size_t size)
         }
     }
     protobuf_set(serial, PACKET_INDEX, index);
-    if ((ret = serial_raw(serial, self->command, strlen(self->command), buf, BUFSIZE, NULL)) == AAOS_OK) {
+    if ((ret = Sensor_raw(self, serial, buf, BUFSIZE)) == AAOS_OK) {
         snprintf(data, size, "%s", buf);
     } else {
         switch (ret) {
@@ -2501,7 +2265,7 @@ PTB210_read_raw_data(void *_self, void *data, size_t size)
             case -1 * AAOS_ETIMEDOUT:
             case -1 * AAOS_ENETDOWN:
             case -1 * AAOS_ENETUNREACH:
-                if ((ret = KLAWSController_try_connect(self->controller)) == AAOS_OK && (ret = serial_raw(serial, self->command, strlen(self->command), buf, BUFSIZE, NULL)) == AAOS_OK) {
+                if ((ret = KLAWSController_try_connect(self->controller)) == AAOS_OK && (ret = Sensor_raw(self, serial, buf, BUFSIZE)) == AAOS_OK) {
                     snprintf(data, size, "%s", buf);
                 }
                 break;
@@ -2661,7 +2425,7 @@ Young41382VCR_read_data(void *_self, double *data, size_t size)
         }
     }
     protobuf_set(serial, PACKET_INDEX, index);
-    if ((ret = serial_raw(serial, self->command, strlen(self->command), buf, BUFSIZE, NULL)) == AAOS_OK) {
+    if ((ret = Sensor_raw(self, serial, buf, BUFSIZE)) == AAOS_OK) {
         const char *s = buf + 1;
         data[0] = atof(s);
     } else {
@@ -2671,7 +2435,7 @@ Young41382VCR_read_data(void *_self, double *data, size_t size)
             case -1 * AAOS_ETIMEDOUT:
             case -1 * AAOS_ENETDOWN:
             case -1 * AAOS_ENETUNREACH:
-                if ((ret = KLAWSController_try_connect(self->controller)) == AAOS_OK && (ret = serial_raw(serial, self->command, strlen(self->command), buf, BUFSIZE, NULL)) == AAOS_OK) {
+                if ((ret = KLAWSController_try_connect(self->controller)) == AAOS_OK && (ret = Sensor_raw(self, serial, buf, BUFSIZE)) == AAOS_OK) {
                     const char *s = buf + 1;
                     data[0] = atof(s);
                 }
@@ -2706,7 +2470,7 @@ Young41382VCR_read_raw_data(void *_self, void *data, size_t size)
         }
     }
     protobuf_set(serial, PACKET_INDEX, index);
-    if ((ret = serial_raw(serial, self->command, strlen(self->command), buf, BUFSIZE, NULL)) == AAOS_OK) {
+    if ((ret = Sensor_raw(self, serial, buf, BUFSIZE)) == AAOS_OK) {
         const char *s = buf + 1;
         snprintf(data, size, "%s", s);
     } else {
@@ -2716,7 +2480,7 @@ Young41382VCR_read_raw_data(void *_self, void *data, size_t size)
             case -1 * AAOS_ETIMEDOUT:
             case -1 * AAOS_ENETDOWN:
             case -1 * AAOS_ENETUNREACH:
-                if ((ret = KLAWSController_try_connect(self->controller)) == AAOS_OK && (ret = serial_raw(serial, self->command, strlen(self->command), buf, BUFSIZE, NULL)) == AAOS_OK) {
+                if ((ret = KLAWSController_try_connect(self->controller)) == AAOS_OK && (ret = Sensor_raw(self, serial, buf, BUFSIZE)) == AAOS_OK) {
                     const char *s = buf + 1;
                     snprintf(data, size, "%s", s);
                 }
@@ -2877,7 +2641,7 @@ Young41382VCT_read_data(void *_self, double *data, size_t size)
         }
     }
     protobuf_set(serial, PACKET_INDEX, index);
-    if ((ret = serial_raw(serial, self->command, strlen(self->command), buf, BUFSIZE, NULL)) == AAOS_OK) {
+    if ((ret = Sensor_raw(self, serial, buf, BUFSIZE)) == AAOS_OK) {
         const char *s = buf + 1;
         data[0] = atof(s);
         data[0] = data[0] * 100. - 50.;
@@ -2888,7 +2652,7 @@ Young41382VCT_read_data(void *_self, double *data, size_t size)
             case -1 * AAOS_ETIMEDOUT:
             case -1 * AAOS_ENETDOWN:
             case -1 * AAOS_ENETUNREACH:
-                if ((ret = KLAWSController_try_connect(self->controller)) == AAOS_OK && (ret = serial_raw(serial, self->command, strlen(self->command), buf, BUFSIZE, NULL)) == AAOS_OK) {
+                if ((ret = KLAWSController_try_connect(self->controller)) == AAOS_OK && (ret = Sensor_raw(self, serial, buf, BUFSIZE)) == AAOS_OK) {
                     const char *s = buf + 1;
                     data[0] = atof(s);
                     data[0] = data[0] * 100. - 50.;
@@ -2924,7 +2688,7 @@ Young41382VCT_read_raw_data(void *_self, void *data, size_t size)
         }
     }
     protobuf_set(serial, PACKET_INDEX, index);
-    if ((ret = serial_raw(serial, self->command, strlen(self->command), buf, BUFSIZE, NULL)) == AAOS_OK) {
+    if ((ret = Sensor_raw(self, serial, buf, BUFSIZE)) == AAOS_OK) {
         const char *s = buf + 1;
         snprintf(data, size, "%s", s);
     } else {
@@ -2934,7 +2698,7 @@ Young41382VCT_read_raw_data(void *_self, void *data, size_t size)
             case -1 * AAOS_ETIMEDOUT:
             case -1 * AAOS_ENETDOWN:
             case -1 * AAOS_ENETUNREACH:
-                if ((ret = KLAWSController_try_connect(self->controller)) == AAOS_OK && (ret = serial_raw(serial, self->command, strlen(self->command), buf, BUFSIZE, NULL)) == AAOS_OK) {
+                if ((ret = KLAWSController_try_connect(self->controller)) == AAOS_OK && (ret = Sensor_raw(self, serial, buf, BUFSIZE)) == AAOS_OK) {
                     const char *s = buf + 1;
                     snprintf(data, size, "%s", s);
                 }
@@ -3106,7 +2870,7 @@ SkyQualityMonitor_read_data(void *_self, double *data, size_t size)
         }
     }
     protobuf_set(serial, PACKET_INDEX, index);
-    if ((ret = serial_raw(serial, self->command, strlen(self->command), buf, BUFSIZE, NULL)) == AAOS_OK) {
+    if ((ret = Sensor_raw(self, serial, buf, BUFSIZE)) == AAOS_OK) {
         size_t n = min(size, 5), i;
         size_t start[] = {3, 10, 23, 35, 48}, end[] = {8, 20, 33, 46, 54};
         char mybuf[32];
@@ -3125,7 +2889,7 @@ SkyQualityMonitor_read_data(void *_self, double *data, size_t size)
             case -1 * AAOS_ETIMEDOUT:
             case -1 * AAOS_ENETDOWN:
             case -1 * AAOS_ENETUNREACH:
-                if ((ret = KLAWSController_try_connect(self->controller)) == AAOS_OK && (ret = serial_raw(serial, self->command, strlen(self->command), buf, BUFSIZE, NULL)) == AAOS_OK) {
+                if ((ret = KLAWSController_try_connect(self->controller)) == AAOS_OK && (ret = Sensor_raw(self, serial, buf, BUFSIZE)) == AAOS_OK) {
                     size_t n = min(size, 5), i;
                     size_t start[] = {3, 10, 23, 35, 48}, end[] = {8, 20, 33, 46, 54};
                     char mybuf[32];
@@ -3169,7 +2933,7 @@ SkyQualityMonitor_read_raw_data(void *_self, void *data, size_t size)
         }
     }
     protobuf_set(serial, PACKET_INDEX, index);
-    if ((ret = serial_raw(serial, self->command, strlen(self->command), buf, BUFSIZE, NULL)) == AAOS_OK) {
+    if ((ret = Sensor_raw(self, serial, buf, BUFSIZE)) == AAOS_OK) {
         const char *s = buf;
         snprintf(data, size, "%s", s);
     } else {
@@ -3179,7 +2943,7 @@ SkyQualityMonitor_read_raw_data(void *_self, void *data, size_t size)
             case -1 * AAOS_ETIMEDOUT:
             case -1 * AAOS_ENETDOWN:
             case -1 * AAOS_ENETUNREACH:
-                if ((ret = KLAWSController_try_connect(self->controller)) == AAOS_OK && (ret = serial_raw(serial, self->command, strlen(self->command), buf, BUFSIZE, NULL)) == AAOS_OK) {
+                if ((ret = KLAWSController_try_connect(self->controller)) == AAOS_OK && (ret = Sensor_raw(self, serial, buf, BUFSIZE)) == AAOS_OK) {
                     const char *s = buf;
                     snprintf(data, size, "%s", s);
                 }
@@ -3229,6 +2993,14 @@ sky_quality_monitor_virtual_table(void)
  * WS100UMB sensor.
  */
 
+/*
+ * Columns of the fields in a WS100UMB reply, HCD6817C replies share the layout.
+ */
+static const size_t ws100umb_field_start[] = {89, 76, 97, 5, 15, 25, 35, 45, 56, 66};
+static const size_t ws100umb_field_end[] = {93, 85, 104, 11, 21, 31, 41, 52, 62, 72};
+
+#define WS100UMB_N_FIELD (sizeof(ws100umb_field_start) / sizeof(ws100umb_field_start[0]))
+
 static const void *ws100umb_virtual_table(void);
 
 static void *
@@ -3237,6 +3009,7 @@ WS100UMB_ctor(void *_self, va_list *app)
     struct WS100UMB *self = super_ctor(WS100UMB(), _self, app);
     
     self->_._vtab= ws100umb_virtual_table();
+    self->_.n_field = WS100UMB_N_FIELD;
     
     return (void *) self;
 }
@@ -3342,13 +3115,12 @@ WS100UMB_read_data(void *_self, double *data, size_t size)
         }
     }
     protobuf_set(serial, PACKET_INDEX, index);
-    if ((ret = serial_raw(serial, self->command, strlen(self->command), buf, BUFSIZE, NULL)) == AAOS_OK) {
-        size_t n = min(size, 10), i;
-        size_t start[] = {89, 76, 97, 5, 15, 25, 35, 45, 56, 66}, end[] = {93, 85, 104, 11, 21, 31, 41, 52, 62, 72};
+    if ((ret = Sensor_raw(self, serial, buf, BUFSIZE)) == AAOS_OK) {
+        size_t n = min(size, self->n_field), i;
         char mybuf[32];
         for (i = 0; i < n; i++) {
             memset(mybuf, '\0', 32);
-            memcpy(mybuf, buf + start[i], end[i] - start[i]);
+            memcpy(mybuf, buf + ws100umb_field_start[i], ws100umb_field_end[i] - ws100umb_field_start[i]);
             data[i] = atof(mybuf);
         }
     } else {
@@ -3358,13 +3130,12 @@ WS100UMB_read_data(void *_self, double *data, size_t size)
             case -1 * AAOS_ETIMEDOUT:
             case -1 * AAOS_ENETDOWN:
             case -1 * AAOS_ENETUNREACH:
-                if ((ret = KLAWSController_try_connect(self->controller)) == AAOS_OK && (ret = serial_raw(serial, self->command, strlen(self->command), buf, BUFSIZE, NULL)) == AAOS_OK) {
-                    size_t n = min(size, 10), i;
-                    size_t start[] = {89, 76, 97, 5, 15, 25, 35, 45, 56, 66}, end[] = {93, 85, 104, 11, 21, 31, 41, 52, 62, 72};
+                if ((ret = KLAWSController_try_connect(self->controller)) == AAOS_OK && (ret = Sensor_raw(self, serial, buf, BUFSIZE)) == AAOS_OK) {
+                    size_t n = min(size, self->n_field), i;
                     char mybuf[32];
                     for (i = 0; i < n; i++) {
                         memset(mybuf, '\0', 32);
-                        memcpy(mybuf, buf + start[i], end[i] - start[i]);
+                        memcpy(mybuf, buf + ws100umb_field_start[i], ws100umb_field_end[i] - ws100umb_field_start[i]);
                         data[i] = atof(mybuf);
                     }
                 }
@@ -3399,7 +3170,7 @@ WS100UMB_read_raw_data(void *_self, void *data, size_t size)
         }
     }
     protobuf_set(serial, PACKET_INDEX, index);
-    if ((ret = serial_raw(serial, self->command, strlen(self->command), buf, BUFSIZE, NULL)) == AAOS_OK) {
+    if ((ret = Sensor_raw(self, serial, buf, BUFSIZE)) == AAOS_OK) {
         const char *s = buf;
         snprintf(data, size, "%s", s);
     } else {
@@ -3409,7 +3180,7 @@ WS100UMB_read_raw_data(void *_self, void *data, size_t size)
             case -1 * AAOS_ETIMEDOUT:
             case -1 * AAOS_ENETDOWN:
             case -1 * AAOS_ENETUNREACH:
-                if ((ret = KLAWSController_try_connect(self->controller)) == AAOS_OK && (ret = serial_raw(serial, self->command, strlen(self->command), buf, BUFSIZE, NULL)) == AAOS_OK) {
+                if ((ret = KLAWSController_try_connect(self->controller)) == AAOS_OK && (ret = Sensor_raw(self, serial, buf, BUFSIZE)) == AAOS_OK) {
                     const char *s = buf;
                     snprintf(data, size, "%s", s);
                 }
@@ -3488,6 +3259,7 @@ HCD6817C_ctor(void *_self, va_list *app)
     struct HCD6817C *self = super_ctor(HCD6817C(), _self, app);
     
     self->_._vtab= hcd6817c_virtual_table();
+    self->_.n_field = WS100UMB_N_FIELD;
     
     self->n_function = va_arg(*app, size_t);
     
@@ -3624,13 +3396,12 @@ HCD6817C_read_data(void *_self, double *data, size_t size)
         }
     }
     protobuf_set(serial, PACKET_INDEX, index);
-    if ((ret = serial_raw(serial, self->command, strlen(self->command), buf, BUFSIZE, NULL)) == AAOS_OK) {
-        size_t n = min(size, 10), i;
-        size_t start[] = {89, 76, 97, 5, 15, 25, 35, 45, 56, 66}, end[] = {93, 85, 104, 11, 21, 31, 41, 52, 62, 72};
+    if ((ret = Sensor_raw(self, serial, buf, BUFSIZE)) == AAOS_OK) {
+        size_t n = min(size, self->n_field), i;
         char mybuf[32];
         for (i = 0; i < n; i++) {
             memset(mybuf, '\0', 32);
-            memcpy(mybuf, buf + start[i], end[i] - start[i]);
+            memcpy(mybuf, buf + ws100umb_field_start[i], ws100umb_field_end[i] - ws100umb_field_start[i]);
             data[i] = atof(mybuf);
         }
     } else {
@@ -3640,13 +3411,12 @@ HCD6817C_read_data(void *_self, double *data, size_t size)
             case -1 * AAOS_ETIMEDOUT:
             case -1 * AAOS_ENETDOWN:
             case -1 * AAOS_ENETUNREACH:
-                if ((ret = KLAWSController_try_connect(self->controller)) == AAOS_OK && (ret = serial_raw(serial, self->command, strlen(self->command), buf, BUFSIZE, NULL)) == AAOS_OK) {
-                    size_t n = min(size, 10), i;
-                    size_t start[] = {89, 76, 97, 5, 15, 25, 35, 45, 56, 66}, end[] = {93, 85, 104, 11, 21, 31, 41, 52, 62, 72};
+                if ((ret = KLAWSController_try_connect(self->controller)) == AAOS_OK && (ret = Sensor_raw(self, serial, buf, BUFSIZE)) == AAOS_OK) {
+                    size_t n = min(size, self->n_field), i;
                     char mybuf[32];
                     for (i = 0; i < n; i++) {
                         memset(mybuf, '\0', 32);
-                        memcpy(mybuf, buf + start[i], end[i] - start[i]);
+                        memcpy(mybuf, buf + ws100umb_field_start[i], ws100umb_field_end[i] - ws100umb_field_start[i]);
                         data[i] = atof(mybuf);
                     }
                 }
@@ -3681,7 +3451,7 @@ HCD6817C_read_raw_data(void *_self, void *data, size_t size)
         }
     }
     protobuf_set(serial, PACKET_INDEX, index);
-    if ((ret = serial_raw(serial, self->command, strlen(self->command), buf, BUFSIZE, NULL)) == AAOS_OK) {
+    if ((ret = Sensor_raw(self, serial, buf, BUFSIZE)) == AAOS_OK) {
         const char *s = buf;
         snprintf(data, size, "%s", s);
     } else {
@@ -3691,7 +3461,7 @@ HCD6817C_read_raw_data(void *_self, void *data, size_t size)
             case -1 * AAOS_ETIMEDOUT:
             case -1 * AAOS_ENETDOWN:
             case -1 * AAOS_ENETUNREACH:
-                if ((ret = KLAWSController_try_connect(self->controller)) == AAOS_OK && (ret = serial_raw(serial, self->command, strlen(self->command), buf, BUFSIZE, NULL)) == AAOS_OK) {
+                if ((ret = KLAWSController_try_connect(self->controller)) == AAOS_OK && (ret = Sensor_raw(self, serial, buf, BUFSIZE)) == AAOS_OK) {
                     const char *s = buf;
                     snprintf(data, size, "%s", s);
                 }
@@ -5274,6 +5044,108 @@ __aws_inspect(void *_self)
     }
 }
 
+void
+__aws_set_archive(void *_self, void *archive)
+{
+    const struct __AWSClass *class = (const struct __AWSClass *) classOf(_self);
+    
+    if (isOf(class, __AWSClass()) && class->set_archive.method) {
+        ((void (*)(void *, void *)) class->set_archive.method)(_self, archive);
+    } else {
+        forward(_self, 0, (Method) __aws_set_archive, "set_archive", _self, archive);
+    }
+}
+
+static void
+__AWS_set_archive(void *_self, void *archive)
+{
+    struct __AWS *self = cast(__AWS(), _self);
+    
+    self->archive = archive;
+}
+
+void *
+__aws_get_archive(void *_self)
+{
+    const struct __AWSClass *class = (const struct __AWSClass *) classOf(_self);
+    
+    if (isOf(class, __AWSClass()) && class->get_archive.method) {
+        return ((void * (*)(void *)) class->get_archive.method)(_self);
+    } else {
+        void *result;
+        forward(_self, &result, (Method) __aws_get_archive, "get_archive", _self);
+        return result;
+    }
+}
+
+static void *
+__AWS_get_archive(void *_self)
+{
+    struct __AWS *self = cast(__AWS(), _self);
+    
+    return self->archive;
+}
+
+int
+__aws_archive(void *_self)
+{
+    const struct __AWSClass *class = (const struct __AWSClass *) classOf(_self);
+    
+    if (isOf(class, __AWSClass()) && class->archive.method) {
+        return ((int (*)(void *)) class->archive.method)(_self);
+    } else {
+        int result;
+        forward(_self, &result, (Method) __aws_archive, "archive", _self);
+        return result;
+    }
+}
+
+/*
+ * Sample all the sensors once and append one record to the archive.
+ * A sensor failing to read is recorded as NAN.
+ */
+static int
+__AWS_archive(void *_self)
+{
+    struct __AWS *self = cast(__AWS(), _self);
+    
+    struct Sensor *sensor;
+    struct timespec tp;
+    double *data, timestamp;
+    size_t i, j, n, n_column = 0;
+    int ret;
+    
+    if (self->archive == NULL) {
+        return AAOS_EUNINIT;
+    }
+    
+    for (i = 0; i < self->n_sensors; i++) {
+        sensor = (struct Sensor *) self->sensors[i];
+        n_column += (sensor != NULL && sensor->n_field != 0) ? sensor->n_field : 1;
+    }
+    if ((data = (double *) Malloc(sizeof(double) * n_column)) == NULL) {
+        return AAOS_ENOMEM;
+    }
+    
+    Clock_gettime(CLOCK_REALTIME, &tp);
+    timestamp = tp.tv_sec + tp.tv_nsec / 1000000000.;
+    for (i = 0, j = 0; i < self->n_sensors; i++) {
+        sensor = (struct Sensor *) self->sensors[i];
+        n = (sensor != NULL && sensor->n_field != 0) ? sensor->n_field : 1;
+        if (sensor == NULL || sensor_read_data(sensor, data + j, n) != AAOS_OK) {
+            size_t k;
+            for (k = 0; k < n; k++) {
+                data[j + k] = NAN;
+            }
+        }
+        j += n;
+    }
+    ret = aws_archive_append(self->archive, timestamp, data, n_column);
+    free(data);
+    
+    return ret;
+}
+
 static void
 __AWS_forward(const void *_self, void *result, Method selector, const char *name, va_list *app)
 {
@@ -5386,6 +5258,9 @@ __AWS_dtor(void *_self)
             delete(self->sensors[i]);
         }
     }
+    if (self->archive != NULL) {
+        delete(self->archive);
+    }
     Pthread_mutex_destroy(&self->mtx);
     Pthread_cond_destroy(&self->cond);
     
@@ -5631,6 +5506,30 @@ __AWSClass_ctor(void *_self, va_list *app)
             self->wait.method = method;
             continue;
         }
+        if (selector == (Method) __aws_set_archive) {
+            if (tag) {
+                self->set_archive.tag = tag;
+                self->set_archive.selector = selector;
+            }
+            self->set_archive.method = method;
+            continue;
+        }
+        if (selector == (Method) __aws_get_archive) {
+            if (tag) {
+                self->get_archive.tag = tag;
+                self->get_archive.selector = selector;
+            }
+            self->get_archive.method = method;
+            continue;
+        }
+        if (selector == (Method) __aws_archive) {
+            if (tag) {
+                self->archive.tag = tag;
+                self->archive.selector = selector;
+            }
+            self->archive.method = method;
+            continue;
+        }
     }
     
 #ifdef va_copy
@@ -5709,6 +5608,9 @@ __AWS_initialize(void)
                  __aws_data_field, "data_field", __AWS_data_field,
                  __aws_status, "status", __AWS_status,
                  __aws_wait, "wait", __AWS_wait,
+                 __aws_set_archive, "set_archive", __AWS_set_archive,
+                 __aws_get_archive, "get_archive", __AWS_get_archive,
+                 __aws_archive, "archive", __AWS_archive,
                  (void *) 0);
 #ifndef _USE_COMPILER_ATTRIBUTION_
     atexit(__AWS_destroy);
@@ -5780,6 +5682,135 @@ KLAWS_get_controller(void *_self, size_t index)
     }
 }
 
+/*
+ * Read the sensors attached to the same controller in one batch transaction,
+ * and leave the replies on the sensors, so that the per-sensor reads of a sweep
+ * do not go to the serial server one by one. The replies are published and
+ * withdrawn under the controller lock, and only the sweeping thread takes them. Sensors which are not batched,
+ * or whose controller talks to a serial server without batch, are read on their own.
+ * Returns the reply buffer, to be given back to KLAWS_release.
+ */
+static char *
+KLAWS_prefetch(struct KLAWS *self)
+{
+    size_t i, j, n, k, n_sensor = self->_.n_sensors;
+    struct Sensor *sensor;
+    void **sensors;
+    char *replies;
+    int *status;
+    
+    sensors = (void **) Malloc(sizeof(void *) * n_sensor);
+    status = (int *) Malloc(sizeof(int) * n_sensor);
+    replies = (char *) Malloc(BUFSIZE * n_sensor);
+    if (sensors == NULL || status == NULL || replies == NULL) {
+        free(sensors);
+        free(status);
+        free(replies);
+        return NULL;
+    }
+    
+    for (j = 0, k = 0; j < self->n_controller; j++) {
+        if (self->controllers[j] == NULL) {
+            continue;
+        }
+        for (i = 0, n = 0; i < n_sensor; i++) {
+            sensor = cast(Sensor(), self->_.sensors[i]);
+            /*
+             * WTGAHRS3 talks a binary protocol with several commands per read.
+             */
+            if (sensor->controller == self->controllers[j] && sensor->command != NULL && !isOf(sensor, WTGAHRS3())) {
+                sensors[n++] = sensor;
+            }
+        }
+        if (n == 0 || klaws_controller_transact(self->controllers[j], sensors, n, replies + k * BUFSIZE, BUFSIZE, status) == AAOS_EBADCMD) {
+            continue;
+        }
+        /*
+         * The batch has already retried a broken connection, a failed item must
+         * not trigger another round-trip from the reader.
+         */
+        klaws_controller_lock(self->controllers[j]);
+        for (i = 0; i < n; i++) {
+            sensor = (struct Sensor *) sensors[i];
+            sensor->reply = replies + (k + i) * BUFSIZE;
+            sensor->reply_thread = pthread_self();
+            sensor->reply_status = status[i] < 0 ? -1 * status[i] : status[i];
+        }
+        klaws_controller_unlock(self->controllers[j]);
+        k += n;
+    }
+    free(sensors);
+    free(status);
+    
+    return replies;
+}
+
+static void
+KLAWS_release(struct KLAWS *self, char *replies)
+{
+    size_t i;
+    struct Sensor *sensor;
+    
+    for (i = 0; i < self->_.n_sensors; i++) {
+        sensor = (struct Sensor *) self->_.sensors[i];
+        if (sensor->controller == NULL) {
+            continue;
+        }
+        klaws_controller_lock(sensor->controller);
+        sensor->reply = NULL;
+        klaws_controller_unlock(sensor->controller);
+    }
+    free(replies);
+}
+    
+/*
+ * Sweeps of KLAWS, status, data log and archive, go through the batch prefetch.
+ */
+static void
+KLAWS_status(void *_self, FILE *fp)
+{
+    struct KLAWS *self = cast(KLAWS(), _self);
+    
+    char *replies;
+    
+    Pthread_mutex_lock(&self->sweep_mtx);
+    replies = KLAWS_prefetch(self);
+    __AWS_status(_self, fp);
+    KLAWS_release(self, replies);
+    Pthread_mutex_unlock(&self->sweep_mtx);
+}
+
+static void
+KLAWS_data_log(void *_self, FILE *fp)
+{
+    struct KLAWS *self = cast(KLAWS(), _self);
+    
+    char *replies;
+    
+    Pthread_mutex_lock(&self->sweep_mtx);
+    replies = KLAWS_prefetch(self);
+    __AWS_data_log(_self, fp);
+    KLAWS_release(self, replies);
+    Pthread_mutex_unlock(&self->sweep_mtx);
+}
+
+static int
+KLAWS_archive(void *_self)
+{
+    struct KLAWS *self = cast(KLAWS(), _self);
+    
+    char *replies;
+    int ret;
+    
+    Pthread_mutex_lock(&self->sweep_mtx);
+    replies = KLAWS_prefetch(self);
+    ret = __AWS_archive(_self);
+    KLAWS_release(self, replies);
+    Pthread_mutex_unlock(&self->sweep_mtx);
+    
+    return ret;
+}
+
 static int
 KLAWS_inspect(void *_self)
 {
@@ -5820,6 +5851,7 @@ KLAWS_ctor(void *_self, va_list *app)
         return NULL;
     }
     memset(self->controllers, '\0', sizeof(void *) * n_controller);
+    Pthread_mutex_init(&self->sweep_mtx, NULL);
     self->_._vtab = klaws_virtual_table();
     
     return (void *) self;
@@ -5838,6 +5870,7 @@ KLAWS_dtor(void *_self)
         }
     }
     free(self->controllers);
+    Pthread_mutex_destroy(&self->sweep_mtx);
     
     return super_dtor(KLAWS(), _self);
 }
@@ -5934,6 +5967,9 @@ KLAWS_initialize(void)
                  dtor, "dtor", KLAWS_dtor,
                  klaws_set_controller, "set_controller", KLAWS_set_controller,
                  klaws_get_controller, "get_controller", KLAWS_get_controller,
+                 __aws_status, "status", KLAWS_status,
+                 __aws_data_log, "data_log", KLAWS_data_log,
+                 __aws_archive, "archive", KLAWS_archive,
                  (void *) 0);
 #ifndef _USE_COMPILER_ATTRIBUTION_
     atexit(KLAWS_destroy);
@@ -6141,6 +6177,138 @@ KLAWSController_inspect(void *_self)
     return AAOS_OK;
 }
 
+int
+klaws_controller_transact(void *_self, void **sensors, size_t n_sensor, char *replies, size_t reply_size, int *status)
+{
+    const struct KLAWSControllerClass *class = (const struct KLAWSControllerClass *) classOf(_self);
+    
+    if (isOf(class, KLAWSControllerClass()) && class->transact.method) {
+        return ((int (*)(void *, void **, size_t, char *, size_t, int *)) class->transact.method)(_self, sensors, n_sensor, replies, reply_size, status);
+    } else {
+        int result;
+        forward(_self, &result, (Method) klaws_controller_transact, "transact", _self, sensors, n_sensor, replies, reply_size, status);
+        return result;
+    }
+}
+
+/*
+ * Send the commands of `n_sensor` sensors attached to the controller in one
+ * serial_batch call, holding the controller lock once for the whole transaction.
+ * If `replies` is not NULL, it is an array of n_sensor strings of `reply_size` bytes,
+ * which receives the raw replies. status[i] is the error code of the i-th sensor.
+ */
+static int
+KLAWSController_transact(void *_self, void **sensors, size_t n_sensor, char *replies, size_t reply_size, int *status)
+{
+    struct KLAWSController *self = cast(KLAWSController(), _self);
+    
+    struct Sensor *sensor;
+    char *request, *reply;
+    const void *data;
+    size_t i, j, n, *items, request_size, request_length, reply_buffer_size, reply_length, offset, data_size;
+    uint16_t index, errorcode;
+    int ret;
+    
+    if (n_sensor == 0) {
+        return AAOS_OK;
+    }
+    /*
+     * Do not send every sweep to an old serial server just to be refused.
+     */
+    if (self->no_batch) {
+        return AAOS_EBADCMD;
+    }
+    
+    request_size = 0;
+    for (i = 0; i < n_sensor; i++) {
+        sensor = cast(Sensor(), sensors[i]);
+        request_size += strlen(sensor->command) + PACKETPARAMETERSIZE;
+    }
+    reply_buffer_size = n_sensor * (BUFSIZE + PACKETPARAMETERSIZE);
+    request = (char *) Malloc(request_size);
+    reply = (char *) Malloc(reply_buffer_size);
+    items = (size_t *) Malloc(sizeof(size_t) * n_sensor);
+    if (request == NULL || reply == NULL || items == NULL) {
+        free(request);
+        free(reply);
+        free(items);
+        return AAOS_ENOMEM;
+    }
+    
+    Pthread_mutex_lock(&self->mtx);
+    offset = 0;
+    for (i = 0, n = 0; i < n_sensor; i++) {
+        sensor = (struct Sensor *) sensors[i];
+        if (replies != NULL) {
+            replies[i * reply_size] = '\0';
+        }
+        if ((index = klaws_device_get_index(sensor->device)) == 0) {
+            klaws_device_set_index(sensor->device, self->serial);
+            if ((index = klaws_device_get_index(sensor->device)) == 0) {
+                status[i] = AAOS_ENOTFOUND;
+                continue;
+            }
+        }
+        serial_batch_put(request, request_size, &offset, index, sensor->command, strlen(sensor->command));
+        items[n++] = i;
+    }
+    request_length = offset;
+    
+    if (n == 0) {
+        ret = AAOS_ENOTFOUND;
+    } else if ((ret = serial_batch(self->serial, request, request_length, n, reply, reply_buffer_size, &reply_length)) != AAOS_OK) {
+        /*
+         * When detecting network problem, try re-connect again.
+         */
+        switch (ret) {
+            case -1 * AAOS_EPIPE:
+            case -1 * AAOS_ECONNRESET:
+            case -1 * AAOS_ETIMEDOUT:
+            case -1 * AAOS_ENETDOWN:
+            case -1 * AAOS_ENETUNREACH:
+                if ((ret = KLAWSController_try_connect(self)) == AAOS_OK) {
+                    ret = serial_batch(self->serial, request, request_length, n, reply, reply_buffer_size, &reply_length);
+                }
+                break;
+            default:
+                break;
+        }
+    }
+    if (ret == AAOS_EBADCMD) {
+        self->no_batch = 1;
+    }
+    
+    if (ret == AAOS_OK) {
+        offset = 0;
+        for (j = 0; j < n; j++) {
+            i = items[j];
+            if (serial_batch_get(reply, reply_length, &offset, NULL, &errorcode, &data, &data_size) != AAOS_OK) {
+                status[i] = AAOS_EBADMSG;
+                continue;
+            }
+            status[i] = errorcode;
+            if (errorcode == AAOS_OK && replies != NULL && reply_size > 0) {
+                if (data_size >= reply_size) {
+                    data_size = reply_size - 1;
+                }
+                memcpy(replies + i * reply_size, data, data_size);
+                replies[i * reply_size + data_size] = '\0';
+            }
+        }
+    } else {
+        for (j = 0; j < n; j++) {
+            status[items[j]] = ret;
+        }
+    }
+    Pthread_mutex_unlock(&self->mtx);
+    
+    free(request);
+    free(reply);
+    free(items);
+    
+    return ret;
+}
+
 static int
 KLAWSController_try_connect(struct KLAWSController *self)
 {
@@ -6150,6 +6318,10 @@ KLAWSController_try_connect(struct KLAWSController *self)
     client = new(SerialClient(), self->address, self->port);
     
     ret = rpc_client_connect(client, &self->serial);
+    /*
+     * The serial server may have been upgraded meanwhile.
+     */
+    self->no_batch = 0;
     
     if (old_serial != NULL) {
         delete(old_serial);
@@ -6285,6 +6457,14 @@ KLAWSControllerClass_ctor(void *_self, va_list *app)
             self->inspect.method = method;
             continue;
         }
+        if (selector == (Method) klaws_controller_transact) {
+            if (tag) {
+                self->transact.tag = tag;
+                self->transact.selector = selector;
+            }
+            self->transact.method = method;
+            continue;
+        }
     }
     
 #ifdef va_copy
@@ -6344,6 +6524,7 @@ KLAWSController_initialize(void)
                            klaws_controller_lock, "lock", KLAWSController_lock,
                            klaws_controller_unlock, "unlock", KLAWSController_unlock,
                            klaws_controller_inspect, "inspect", KLAWSController_inspect,
+                           klaws_controller_transact, "transact", KLAWSController_transact,
                            (void *) 0);
 #ifndef _USE_COMPILER_ATTRIBUTION_
     atexit(KLAWSController_destroy);
@@ -6646,27 +6827,6 @@ KLAWSDevice(void)
     return _KLAWSDevice;
 }
 
-#ifdef __USE_GSL__
-static void __spline_destructor__(void) __attribute__ ((destructor(101)));
-static void
-__spline_destructor__(void)
-{
-    gsl_spline_free(PT100_spline);
-    gsl_interp_accel_free(PT100_acc);
-}
-
-static void __spline_constructor__(void) __attribute__ ((constructor(101)));
-
-static void
-__spline_constructor__(void)
-{
-    PT100_acc = gsl_interp_accel_alloc();
-    PT100_spline = gsl_spline_alloc(gsl_interp_cspline, sizeof(PT100_resistance)/sizeof(double));
-    gsl_spline_init(PT100_spline, PT100_resistance, PT100_temperature, sizeof(PT100_resistance)/sizeof(double));
-    gsl_set_error_handler_off();
-}
-#endif
-
 /*
  * Compiler-dependant initializer.
  */
@@ -92,6 +92,9 @@ void __aws_data_field(void *_self, FILE *fp);
 void __aws_status(void *_self, FILE *fp);
 int __aws_wait(void *_self, double timeout);
 int __aws_inspect(void *_self);
+void __aws_set_archive(void *_self, void *archive);
+void *__aws_get_archive(void *_self);
+int __aws_archive(void *_self);
 
 extern const void *KLAWS(void);
 extern const void *KLAWSClass(void);
@@ -108,6 +111,7 @@ void *klaws_controller_get_serial(void *_self);
 void klaws_controller_lock(void *_self);
 void klaws_controller_unlock(void *_self);
 int klaws_controller_inspect(void *_self);
+int klaws_controller_transact(void *_self, void **sensors, size_t n_sensor, char *replies, size_t reply_size, int *status);
 
 extern const void *KLAWSDevice(void);
 extern const void *KLAWSDeviceClass(void);
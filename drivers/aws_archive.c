@@ -0,0 +1,630 @@
+//
+//  aws_archive.c
+//  AAOS
+//
+
+#include "def.h"
+#include "aws_archive.h"
+#include "aws_archive_r.h"
+#include "wrapper.h"
+
+/*
+ * Segment layout helpers.
+ */
+
+static size_t
+AWSArchive_tier_length(double width)
+{
+    return (size_t) (AWS_ARCHIVE_DAY / width);
+}
+
+static size_t
+AWSArchive_segment_size(size_t n_column, size_t capacity)
+{
+    size_t size = sizeof(struct AWSArchiveHeader);
+    
+    size += (n_column + 1) * capacity * sizeof(double);
+    size += 4 * n_column * AWSArchive_tier_length(AWS_ARCHIVE_MINUTE) * sizeof(double);
+    size += 4 * n_column * AWSArchive_tier_length(AWS_ARCHIVE_HOUR) * sizeof(double);
+    
+    return size;
+}
+
+/*
+ * Column `column` of the raw records, column 0 is the time stamp.
+ */
+static double *
+AWSArchive_raw(const void *segment, size_t column)
+{
+    const struct AWSArchiveHeader *header = (const struct AWSArchiveHeader *) segment;
+    
+    return (double *) ((char *) segment + sizeof(struct AWSArchiveHeader)) + column * header->capacity;
+}
+
+/*
+ * Tier of `width` seconds. For column c, min, max, sum and count of the buckets
+ * are stored at offsets (4 * c + 0, 1, 2, 3) * number of buckets.
+ */
+static double *
+AWSArchive_tier(const void *segment, double width)
+{
+    const struct AWSArchiveHeader *header = (const struct AWSArchiveHeader *) segment;
+    double *tier = AWSArchive_raw(segment, header->n_column + 1);
+    
+    if (width == AWS_ARCHIVE_HOUR) {
+        tier += 4 * header->n_column * AWSArchive_tier_length(AWS_ARCHIVE_MINUTE);
+    }
+    
+    return tier;
+}
+
+static void
+AWSArchive_tier_update(void *segment, double width, double timestamp, const double *data)
+{
+    const struct AWSArchiveHeader *header = (const struct AWSArchiveHeader *) segment;
+    double *tier = AWSArchive_tier(segment, width);
+    size_t i, n = AWSArchive_tier_length(width), bucket;
+    
+    bucket = (size_t) ((timestamp - header->start) / width);
+    if (bucket >= n) {
+        return;
+    }
+    for (i = 0; i < header->n_column; i++) {
+        double *min = tier + 4 * i * n, *max = min + n, *sum = max + n, *count = sum + n;
+        if (isnan(data[i])) {
+            continue;
+        }
+        if (count[bucket] == 0.) {
+            min[bucket] = data[i];
+            max[bucket] = data[i];
+            sum[bucket] = data[i];
+        } else {
+            if (data[i] < min[bucket]) {
+                min[bucket] = data[i];
+            }
+            if (data[i] > max[bucket]) {
+                max[bucket] = data[i];
+            }
+            sum[bucket] += data[i];
+        }
+        count[bucket] += 1.;
+    }
+}
+
+/*
+ * Create the segment `path` under a temporary name, and rename it once its header is written,
+ * so that a crash never leaves a segment without a header.
+ */
+static void *
+AWSArchive_create(const char *path, double start, size_t n_column, size_t capacity, double interval, size_t *size)
+{
+    char tmp_path[PATHSIZE];
+    struct AWSArchiveHeader *header;
+    void *segment;
+    int fd;
+    
+    snprintf(tmp_path, PATHSIZE, "%s.tmp", path);
+    if ((fd = Open(tmp_path, O_RDWR | O_CREAT | O_TRUNC, 0644)) < 0) {
+        return NULL;
+    }
+    *size = AWSArchive_segment_size(n_column, capacity);
+    if (Ftruncate(fd, (off_t) *size) < 0) {
+        Close(fd);
+        unlink(tmp_path);
+        return NULL;
+    }
+    if ((segment = mmap(NULL, *size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)) == MAP_FAILED) {
+        Close(fd);
+        unlink(tmp_path);
+        return NULL;
+    }
+    header = (struct AWSArchiveHeader *) segment;
+    header->magic = AWS_ARCHIVE_MAGIC;
+    header->version = AWS_ARCHIVE_VERSION;
+    header->n_column = (uint32_t) n_column;
+    header->capacity = (uint32_t) capacity;
+    header->n_record = 0;
+    header->start = start;
+    header->interval = interval;
+    if (msync(segment, sizeof(struct AWSArchiveHeader), MS_SYNC) < 0 || fsync(fd) < 0 || rename(tmp_path, path) < 0) {
+        munmap(segment, *size);
+        Close(fd);
+        unlink(tmp_path);
+        return NULL;
+    }
+    Close(fd);
+    
+    return segment;
+}
+
+/*
+ * Map the segment of the day beginning at `start`.
+ * If `create` is true, the segment is mapped writable and created if absent,
+ * otherwise, it is mapped read-only and NULL is returned if absent.
+ */
+static void *
+AWSArchive_map(const char *directory, double start, size_t n_column, size_t capacity, double interval, bool create, size_t *size)
+{
+    char path[PATHSIZE];
+    time_t t = (time_t) start;
+    struct tm tm;
+    struct stat sb;
+    struct AWSArchiveHeader *header;
+    void *segment;
+    int fd;
+    
+    gmtime_r(&t, &tm);
+    snprintf(path, PATHSIZE, "%s/%04d%02d%02d.dat", directory, tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday);
+    
+    if ((fd = open(path, create ? O_RDWR : O_RDONLY)) < 0) {
+        if (create && errno == ENOENT) {
+            return AWSArchive_create(path, start, n_column, capacity, interval, size);
+        }
+        return NULL;
+    }
+    if (fstat(fd, &sb) < 0) {
+        Close(fd);
+        return NULL;
+    }
+    
+    *size = (size_t) sb.st_size;
+    if (*size < sizeof(struct AWSArchiveHeader)) {
+        Close(fd);
+        return NULL;
+    }
+    if ((segment = mmap(NULL, *size, create ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0)) == MAP_FAILED) {
+        Close(fd);
+        return NULL;
+    }
+    Close(fd);
+    header = (struct AWSArchiveHeader *) segment;
+    if (header->magic != AWS_ARCHIVE_MAGIC || header->version != AWS_ARCHIVE_VERSION || *size < AWSArchive_segment_size(header->n_column, header->capacity) || (create && header->n_column != n_column)) {
+        munmap(segment, *size);
+        return NULL;
+    }
+    
+    return segment;
+}
+
+int
+aws_archive_append(void *_self, double timestamp, const double *data, size_t n_column)
+{
+    const struct AWSArchiveClass *class = (const struct AWSArchiveClass *) classOf(_self);
+    
+    if (isOf(class, AWSArchiveClass()) && class->append.method) {
+        return ((int (*)(void *, double, const double *, size_t)) class->append.method)(_self, timestamp, data, n_column);
+    } else {
+        int result;
+        forward(_self, &result, (Method) aws_archive_append, "append", _self, timestamp, data, n_column);
+        return result;
+    }
+}
+
+static int
+AWSArchive_append(void *_self, double timestamp, const double *data, size_t n_column)
+{
+    struct AWSArchive *self = cast(AWSArchive(), _self);
+    
+    struct AWSArchiveHeader *header;
+    double start, *column;
+    size_t i, index;
+    
+    Pthread_mutex_lock(&self->mtx);
+    if (self->n_column == 0) {
+        self->n_column = n_column;
+    } else if (self->n_column != n_column) {
+        Pthread_mutex_unlock(&self->mtx);
+        return AAOS_EINVAL;
+    }
+    
+    start = floor(timestamp / AWS_ARCHIVE_DAY) * AWS_ARCHIVE_DAY;
+    if (self->segment == NULL || start != self->start) {
+        if (self->segment != NULL) {
+            Munmap(self->segment, self->segment_size);
+        }
+        if ((self->segment = AWSArchive_map(self->directory, start, self->n_column, self->capacity, self->interval, true, &self->segment_size)) == NULL) {
+            Pthread_mutex_unlock(&self->mtx);
+            return AAOS_EIO;
+        }
+        self->start = start;
+    }
+    
+    header = (struct AWSArchiveHeader *) self->segment;
+    if ((index = header->n_record) >= header->capacity) {
+        Pthread_mutex_unlock(&self->mtx);
+        return AAOS_ENOSPC;
+    }
+    column = AWSArchive_raw(self->segment, 0);
+    column[index] = timestamp;
+    for (i = 0; i < n_column; i++) {
+        column = AWSArchive_raw(self->segment, i + 1);
+        column[index] = data[i];
+    }
+    AWSArchive_tier_update(self->segment, AWS_ARCHIVE_MINUTE, timestamp, data);
+    AWSArchive_tier_update(self->segment, AWS_ARCHIVE_HOUR, timestamp, data);
+    __sync_synchronize();
+    header->n_record = (uint32_t) (index + 1);
+    Pthread_mutex_unlock(&self->mtx);
+    
+    return AAOS_OK;
+}
+
+/*
+ * Accumulator of one output row, min, max, sum and count of every column.
+ */
+static void
+AWSArchive_accumulate(double *acc, size_t column, double min, double max, double sum, double count)
+{
+    double *a = acc + 4 * column;
+    
+    if (count == 0.) {
+        return;
+    }
+    if (a[3] == 0.) {
+        a[0] = min;
+        a[1] = max;
+        a[2] = sum;
+    } else {
+        if (min < a[0]) {
+            a[0] = min;
+        }
+        if (max > a[1]) {
+            a[1] = max;
+        }
+        a[2] += sum;
+    }
+    a[3] += count;
+}
+
+static bool
+AWSArchive_flush(double *acc, size_t n_column, double timestamp, double *data, size_t size, size_t *n_row)
+{
+    size_t i, width = 1 + 3 * n_column;
+    double *row;
+    
+    if ((*n_row + 1) * width > size) {
+        return false;
+    }
+    row = data + (*n_row) * width;
+    row[0] = timestamp;
+    for (i = 0; i < n_column; i++) {
+        if (acc[4 * i + 3] == 0.) {
+            row[3 * i + 1] = NAN;
+            row[3 * i + 2] = NAN;
+            row[3 * i + 3] = NAN;
+        } else {
+            row[3 * i + 1] = acc[4 * i];
+            row[3 * i + 2] = acc[4 * i + 1];
+            row[3 * i + 3] = acc[4 * i + 2] / acc[4 * i + 3];
+        }
+    }
+    memset(acc, '\0', sizeof(double) * 4 * n_column);
+    (*n_row)++;
+    
+    return true;
+}
+
+int
+aws_archive_query(void *_self, double start, double end, double step, double *data, size_t size, size_t *n_row, size_t *n_column, bool *truncated)
+{
+    const struct AWSArchiveClass *class = (const struct AWSArchiveClass *) classOf(_self);
+    
+    if (isOf(class, AWSArchiveClass()) && class->query.method) {
+        return ((int (*)(void *, double, double, double, double *, size_t, size_t *, size_t *, bool *)) class->query.method)(_self, start, end, step, data, size, n_row, n_column, truncated);
+    } else {
+        int result;
+        forward(_self, &result, (Method) aws_archive_query, "query", _self, start, end, step, data, size, n_row, n_column, truncated);
+        return result;
+    }
+}
+
+/*
+ * Return the records in [start, end), decimated into buckets of `step` seconds.
+ * Each output row is the bucket time followed by (min, max, mean) of every column.
+ * Steps of at least one minute or one hour are served from the downsampled tiers,
+ * a step of zero returns every raw record.
+ * If `data` is full, the query stops early and sets `truncated`,
+ * the caller may continue from the time of the last row plus one step, or just after it for raw records.
+ */
+static int
+AWSArchive_query(void *_self, double start, double end, double step, double *data, size_t size, size_t *n_row, size_t *n_column, bool *truncated)
+{
+    struct AWSArchive *self = cast(AWSArchive(), _self);
+    
+    const struct AWSArchiveHeader *header;
+    double day, width, bucket = 0., key, *acc = NULL;
+    size_t i, j, k, n, m = 0, segment_size;
+    bool have = false, full = false;
+    void *segment;
+    
+    *n_row = 0;
+    if (end <= start || step < 0.) {
+        return AAOS_EINVAL;
+    }
+    if (step >= AWS_ARCHIVE_HOUR) {
+        width = AWS_ARCHIVE_HOUR;
+    } else if (step >= AWS_ARCHIVE_MINUTE) {
+        width = AWS_ARCHIVE_MINUTE;
+    } else {
+        width = 0.;
+    }
+    
+    for (day = floor(start / AWS_ARCHIVE_DAY) * AWS_ARCHIVE_DAY; day < end && !full; day += AWS_ARCHIVE_DAY) {
+        if ((segment = AWSArchive_map(self->directory, day, 0, 0, 0., false, &segment_size)) == NULL) {
+            continue;
+        }
+        header = (const struct AWSArchiveHeader *) segment;
+        if (m == 0) {
+            m = header->n_column;
+            if ((acc = (double *) Malloc(sizeof(double) * 4 * m)) == NULL) {
+                munmap(segment, segment_size);
+                return AAOS_ENOMEM;
+            }
+            memset(acc, '\0', sizeof(double) * 4 * m);
+        } else if (m != header->n_column) {
+            munmap(segment, segment_size);
+            continue;
+        }
+    
+        if (width == 0.) {
+            const double *t = AWSArchive_raw(segment, 0);
+            n = header->n_record;
+            for (i = 0; i < n && !full; i++) {
+                if (t[i] < start || t[i] >= end) {
+                    continue;
+                }
+                key = (step > 0.) ? floor(t[i] / step) * step : t[i];
+                if (have && key != bucket) {
+                    full = !AWSArchive_flush(acc, m, bucket, data, size, n_row);
+                }
+                bucket = key;
+                have = true;
+                for (j = 0; j < m; j++) {
+                    double v = AWSArchive_raw(segment, j + 1)[i];
+                    if (!isnan(v)) {
+                        AWSArchive_accumulate(acc, j, v, v, v, 1.);
+                    }
+                }
+            }
+        } else {
+            const double *tier = AWSArchive_tier(segment, width);
+            n = AWSArchive_tier_length(width);
+            for (i = 0; i < n && !full; i++) {
+                double t = day + i * width;
+                bool empty = true;
+                if (t < start || t >= end) {
+                    continue;
+                }
+                for (j = 0; j < m; j++) {
+                    if (tier[(4 * j + 3) * n + i] != 0.) {
+                        empty = false;
+                        break;
+                    }
+                }
+                if (empty) {
+                    continue;
+                }
+                key = floor(t / step) * step;
+                if (have && key != bucket) {
+                    full = !AWSArchive_flush(acc, m, bucket, data, size, n_row);
+                }
+                bucket = key;
+                have = true;
+                for (j = 0; j < m; j++) {
+                    k = 4 * j * n + i;
+                    AWSArchive_accumulate(acc, j, tier[k], tier[k + n], tier[k + 2 * n], tier[k + 3 * n]);
+                }
+            }
+        }
+        munmap(segment, segment_size);
+    }
+    if (have && !full) {
+        AWSArchive_flush(acc, m, bucket, data, size, n_row);
+    }
+    free(acc);
+    if (n_column != NULL) {
+        *n_column = m;
+    }
+    if (truncated != NULL) {
+        *truncated = full;
+    }
+    
+    return AAOS_OK;
+}
+
+double
+aws_archive_get_interval(const void *_self)
+{
+    const struct AWSArchiveClass *class = (const struct AWSArchiveClass *) classOf(_self);
+    
+    if (isOf(class, AWSArchiveClass()) && class->get_interval.method) {
+        return ((double (*)(const void *)) class->get_interval.method)(_self);
+    } else {
+        double result;
+        forward(_self, &result, (Method) aws_archive_get_interval, "get_interval", _self);
+        return result;
+    }
+}
+
+static double
+AWSArchive_get_interval(const void *_self)
+{
+    const struct AWSArchive *self = cast(AWSArchive(), _self);
+    
+    return self->interval;
+}
+
+static void *
+AWSArchive_ctor(void *_self, va_list *app)
+{
+    struct AWSArchive *self = super_ctor(AWSArchive(), _self, app);
+    
+    const char *directory;
+    double interval;
+    
+    directory = va_arg(*app, const char *);
+    interval = va_arg(*app, double);
+    
+    self->directory = (char *) Malloc(strlen(directory) + 1);
+    snprintf(self->directory, strlen(directory) + 1, "%s", directory);
+    if (interval <= 0.) {
+        interval = AWS_ARCHIVE_MINUTE;
+    }
+    self->interval = interval;
+    /*
+     * leave room for jitter of the sampling clock.
+     */
+    self->capacity = (size_t) (2. * AWS_ARCHIVE_DAY / interval) + 1;
+    Pthread_mutex_init(&self->mtx, NULL);
+    
+    return (void *) self;
+}
+
+static void *
+AWSArchive_dtor(void *_self)
+{
+    struct AWSArchive *self = cast(AWSArchive(), _self);
+    
+    if (self->segment != NULL) {
+        msync(self->segment, self->segment_size, MS_ASYNC);
+        Munmap(self->segment, self->segment_size);
+    }
+    free(self->directory);
+    Pthread_mutex_destroy(&self->mtx);
+    
+    return super_dtor(AWSArchive(), _self);
+}
+
+static void *
+AWSArchiveClass_ctor(void *_self, va_list *app)
+{
+    struct AWSArchiveClass *self = super_ctor(AWSArchiveClass(), _self, app);
+    Method selector;
+    
+#ifdef va_copy
+    va_list ap;
+    va_copy(ap, *app);
+#else
+    va_list ap = *app;
+#endif
+    
+    while ((selector = va_arg(ap, Method))) {
+        const char *tag = va_arg(ap, const char *);
+        Method method = va_arg(ap, Method);
+    
+        if (selector == (Method) aws_archive_append) {
+            if (tag) {
+                self->append.tag = tag;
+                self->append.selector = selector;
+            }
+            self->append.method = method;
+            continue;
+        }
+        if (selector == (Method) aws_archive_query) {
+            if (tag) {
+                self->query.tag = tag;
+                self->query.selector = selector;
+            }
+            self->query.method = method;
+            continue;
+        }
+        if (selector == (Method) aws_archive_get_interval) {
+            if (tag) {
+                self->get_interval.tag = tag;
+                self->get_interval.selector = selector;
+            }
+            self->get_interval.method = method;
+            continue;
+        }
+    }
+    
+#ifdef va_copy
+    va_end(ap);
+#endif
+    
+    return (void *) self;
+}
+
+static const void *_AWSArchiveClass;
+
+static void
+AWSArchiveClass_destroy(void)
+{
+    free((void *) _AWSArchiveClass);
+}
+
+static void
+AWSArchiveClass_initialize(void)
+{
+    _AWSArchiveClass = new(Class(), "AWSArchiveClass", Class(), sizeof(struct AWSArchiveClass),
+                           ctor, "ctor", AWSArchiveClass_ctor,
+                           (void *) 0);
+#ifndef _USE_COMPILER_ATTRIBUTION_
+    atexit(AWSArchiveClass_destroy);
+#endif
+}
+
+const void *
+AWSArchiveClass(void)
+{
+#ifndef _USE_COMPILER_ATTRIBUTION_
+    static pthread_once_t once_control = PTHREAD_ONCE_INIT;
+    Pthread_once(&once_control, AWSArchiveClass_initialize);
+#endif
+    
+    return _AWSArchiveClass;
+}
+
+static const void *_AWSArchive;
+
+static void
+AWSArchive_destroy(void)
+{
+    free((void *)_AWSArchive);
+}
+
+static void
+AWSArchive_initialize(void)
+{
+    _AWSArchive = new(AWSArchiveClass(), "AWSArchive", Object(), sizeof(struct AWSArchive),
+                      ctor, "ctor", AWSArchive_ctor,
+                      dtor, "dtor", AWSArchive_dtor,
+                      aws_archive_append, "append", AWSArchive_append,
+                      aws_archive_query, "query", AWSArchive_query,
+                      aws_archive_get_interval, "get_interval", AWSArchive_get_interval,
+                      (void *) 0);
+#ifndef _USE_COMPILER_ATTRIBUTION_
+    atexit(AWSArchive_destroy);
+#endif
+}
+
+const void *
+AWSArchive(void)
+{
+#ifndef _USE_COMPILER_ATTRIBUTION_
+    static pthread_once_t once_control = PTHREAD_ONCE_INIT;
+    Pthread_once(&once_control, AWSArchive_initialize);
+#endif
+    
+    return _AWSArchive;
+}
+
+#ifdef _USE_COMPILER_ATTRIBUTION_
+static void __constructor__(void) __attribute__ ((constructor(_AWS_ARCHIVE_PRIORITY_)));
+
+static void
+__constructor__(void)
+{
+    AWSArchiveClass_initialize();
+    AWSArchive_initialize();
+}
+
+static void __destructor__(void) __attribute__ ((destructor(_AWS_ARCHIVE_PRIORITY_)));
+
+static void
+__destructor__(void)
+{
+    AWSArchive_destroy();
+    AWSArchiveClass_destroy();
+}
+#endif
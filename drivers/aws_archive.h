@@ -0,0 +1,49 @@
+//
+//  aws_archive.h
+//  AAOS
+//
+
+#ifndef aws_archive_h
+#define aws_archive_h
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Time-series archive of AWS data.
+ *
+ * One memory-mapped segment file per UTC day, named YYYYMMDD.dat under the archive directory.
+ * A segment holds fixed-size raw records stored column by column (time column first),
+ * followed by two downsampled tiers (per minute and per hour) keeping min, max, sum
+ * and count of every column.
+ */
+
+#define AWS_ARCHIVE_MAGIC       0x53574141
+#define AWS_ARCHIVE_VERSION     1
+
+#define AWS_ARCHIVE_DAY         86400.
+#define AWS_ARCHIVE_MINUTE      60.
+#define AWS_ARCHIVE_HOUR        3600.
+
+/*
+ * Maximum number of doubles returned by one archive query over RPC.
+ */
+#define AWS_ARCHIVE_QUERY_SIZE  131072
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int aws_archive_append(void *_self, double timestamp, const double *data, size_t n_column);
+int aws_archive_query(void *_self, double start, double end, double step, double *data, size_t size, size_t *n_row, size_t *n_column, bool *truncated);
+double aws_archive_get_interval(const void *_self);
+
+extern const void *AWSArchive(void);
+extern const void *AWSArchiveClass(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* aws_archive_h */
@@ -0,0 +1,49 @@
+//
+//  aws_archive_r.h
+//  AAOS
+//
+
+#ifndef aws_archive_r_h
+#define aws_archive_r_h
+
+#include "object_r.h"
+#include <pthread.h>
+
+#define _AWS_ARCHIVE_PRIORITY_  _VIRTUAL_PRIORITY_ + 1
+
+/*
+ * On-disk header of a segment.
+ * n_record is published after the record it counts has been written,
+ * so that readers mapping the same file never see a partial record.
+ */
+struct AWSArchiveHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t n_column;
+    uint32_t capacity;
+    volatile uint32_t n_record;
+    uint32_t reserved;
+    double start;       /* UTC seconds of the beginning of the day */
+    double interval;    /* nominal sampling interval */
+};
+
+struct AWSArchive {
+    struct Object _;
+    char *directory;
+    double interval;
+    size_t n_column;
+    size_t capacity;
+    void *segment;      /* mapped segment of the current day */
+    size_t segment_size;
+    double start;
+    pthread_mutex_t mtx;
+};
+
+struct AWSArchiveClass {
+    struct Class _;
+    struct Method append;
+    struct Method query;
+    struct Method get_interval;
+};
+
+#endif /* aws_archive_r_h */
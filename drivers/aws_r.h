@@ -31,6 +31,9 @@ struct Sensor {
     void *device;       /* Device */
     size_t n_field;
     char *fields;
+    char *reply;        /* reply prefetched by a batch sweep, or NULL */
+    int reply_status;
+    pthread_t reply_thread; /* thread of the sweep which prefetched reply */
 };
 
 struct SensorClass {
@@ -185,6 +188,7 @@ struct __AWS {
     pthread_cond_t cond;
     int state;
     size_t n_sensors;
+    void *archive;      /* time-series archive, may be NULL */
 };
 
 struct __AWSClass {
@@ -214,6 +218,9 @@ struct __AWSClass {
     struct Method status;
     struct Method inspect;
     struct Method wait;
+    struct Method set_archive;
+    struct Method get_archive;
+    struct Method archive;
 };
 
 struct __AWSVirtualTable {
@@ -260,6 +267,7 @@ struct KLAWSController {
     struct KLAWSDevice **devices;
     size_t n_device;
     int critical;
+    int no_batch;       /* the serial server does not know SERIAL_COMMAND_BATCH */
     pthread_mutex_t mtx;
 };
 
@@ -271,6 +279,7 @@ struct KLAWSControllerClass {
     struct Method set_device;
     struct Method get_serial;
     struct Method inspect;
+    struct Method transact;
 };
 
 struct KLAWS {
@@ -279,6 +288,7 @@ struct KLAWS {
     void **controllers;
     size_t n_controller;
     size_t n_deivce;
+    pthread_mutex_t sweep_mtx;
 };
 
 struct KLAWSClass {
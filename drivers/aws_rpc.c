@@ -6,6 +6,7 @@
 //  Copyright © 2020 NAOC. All rights reserved.
 //
 
+#include "aws_archive.h"
 #include "aws_def.h"
 #include "aws_rpc.h"
 #include "aws_rpc_r.h"
@@ -238,6 +239,68 @@ aws_get_data_by_channel(void *_self, unsigned int index, unsigned int channel, d
     return aws_get_data(_self, data, size);
 }
 
+struct AWSDataCall {
+    double *data;
+    int *result;
+};
+
+static void
+aws_get_data_completion(void *rpc, uint32_t id, int result, void *arg)
+{
+    struct AWSDataCall *call = (struct AWSDataCall *) arg;
+    uint32_t length;
+    
+    *call->result = result;
+    if (result != AAOS_OK) {
+        return;
+    }
+    protobuf_get(rpc, PACKET_LENGTH, &length);
+    if (length == 0) {
+        protobuf_get(rpc, PACKET_DF0, call->data);
+    } else if (length >= sizeof(double)) {
+        const char *buf;
+        protobuf_get(rpc, PACKET_BUF, &buf, NULL);
+        memcpy(call->data, buf, sizeof(double));
+    } else {
+        *call->result = AAOS_EBADMSG;
+    }
+}
+
+int
+aws_get_data_by_channels(void *_self, unsigned int index, const unsigned int *channels, double *data, int *results, size_t n)
+{
+    struct AWSDataCall *calls;
+    size_t i;
+    int ret = AAOS_OK, ret2;
+    
+    calls = (struct AWSDataCall *) Malloc(sizeof(struct AWSDataCall) * n);
+    for (i = 0; i < n; i++) {
+        calls[i].data = &data[i];
+        calls[i].result = &results[i];
+        results[i] = AAOS_ENOTFOUND;
+    }
+    for (i = 0; i < n; i++) {
+        protobuf_set(_self, PACKET_PROTOCOL, PROTO_AWS);
+        protobuf_set(_self, PACKET_COMMAND, AWS_COMMAND_GET_DATA);
+        protobuf_set(_self, PACKET_INDEX, index);
+        protobuf_set(_self, PACKET_CHANNEL, channels[i]);
+        protobuf_set(_self, PACKET_U32F0, 1);
+        protobuf_set(_self, PACKET_LENGTH, 0);
+        if ((ret = rpc_call_async(_self, aws_get_data_completion, &calls[i], NULL)) < 0) {
+            break;
+        }
+    }
+    /*
+     * Collect the replies of the calls sent, even if a later one failed.
+     */
+    if ((ret2 = rpc_wait(_self, 0)) < 0 && ret >= 0) {
+        ret = ret2;
+    }
+    free(calls);
+    
+    return ret < 0 ? ret : AAOS_OK;
+}
+
 int
 aws_get_raw_data_by_name(void *_self, const char *aws_name, const char *channel_name, void *data, size_t size)
 {
@@ -895,6 +958,77 @@ AWS_data_log(void *_self, FILE *fp)
     return AAOS_OK;
 }
 
+int
+aws_query_archive(void *_self, double start, double end, double step, double *data, size_t size, size_t *n_row, size_t *n_column, bool *truncated)
+{
+    const struct AWSClass *class = (const struct AWSClass *) classOf(_self);
+    
+    if (isOf(class, AWSClass()) && class->query_archive.method) {
+        return ((int (*)(void *, double, double, double, double *, size_t, size_t *, size_t *, bool *)) class->query_archive.method)(_self, start, end, step, data, size, n_row, n_column, truncated);
+    } else {
+        int result;
+        forward(_self, &result, (Method) aws_query_archive, "query_archive", _self, start, end, step, data, size, n_row, n_column, truncated);
+        return result;
+    }
+}
+
+/*
+ * Query the time-series archive in [start, end), decimated by `step` seconds.
+ * Each row of `data` is the time followed by (min, max, mean) of every column,
+ * so a row has 1 + 3 * n_column elements.
+ * `truncated` is set if the rows did not fit in `data`, or in one reply, see aws_archive_query.
+ */
+static int
+AWS_query_archive(void *_self, double start, double end, double step, double *data, size_t size, size_t *n_row, size_t *n_column, bool *truncated)
+{
+    struct AWS *self = cast(AWS(), _self);
+    
+    int ret;
+    uint16_t option;
+    uint32_t length, n, m;
+    char buf[3 * sizeof(double)];
+    const char *s;
+    
+    memcpy(buf, &start, sizeof(double));
+    memcpy(buf + sizeof(double), &end, sizeof(double));
+    memcpy(buf + 2 * sizeof(double), &step, sizeof(double));
+    
+    protobuf_set(self, PACKET_PROTOCOL, PROTO_AWS);
+    protobuf_set(self, PACKET_COMMAND, AWS_COMMAND_QUERY_ARCHIVE);
+    protobuf_set(self, PACKET_BUF, buf, sizeof(buf));
+    
+    if ((ret = rpc_call(self)) != AAOS_OK) {
+        return ret;
+    }
+    
+    protobuf_get(self, PACKET_OPTION, &option);
+    protobuf_get(self, PACKET_LENGTH, &length);
+    protobuf_get(self, PACKET_U32F0, &n);
+    protobuf_get(self, PACKET_U32F1, &m);
+    protobuf_get(self, PACKET_BUF, &s, NULL);
+    if (truncated != NULL) {
+        *truncated = (option & AWS_ARCHIVE_TRUNCATED) ? true : false;
+    }
+    if (n > size / (1 + 3 * m)) {
+        n = (uint32_t) (size / (1 + 3 * m));
+        if (truncated != NULL) {
+            *truncated = true;
+        }
+    }
+    if (length < n * (1 + 3 * m) * sizeof(double)) {
+        return AAOS_EBADMSG;
+    }
+    memcpy(data, s, n * (1 + 3 * m) * sizeof(double));
+    if (n_row != NULL) {
+        *n_row = n;
+    }
+    if (n_column != NULL) {
+        *n_column = m;
+    }
+    
+    return AAOS_OK;
+}
+
 int
 aws_data_field(void *_self, FILE *fp)
 {
@@ -1504,6 +1638,48 @@ AWS_execute_data_field(struct AWS *self)
     return AAOS_OK;
 }
 
+static int
+AWS_execute_query_archive(struct AWS *self)
+{
+    void *aws, *archive;
+    uint16_t index;
+    uint32_t length;
+    double start, end, step, *data;
+    size_t n_row, n_column;
+    bool truncated;
+    char *buf;
+    int ret;
+    
+    protobuf_get(self, PACKET_INDEX, &index);
+    if ((aws = get_aws_by_index(index)) == NULL) {
+        return AAOS_ENOTFOUND;
+    }
+    if ((archive = __aws_get_archive(aws)) == NULL) {
+        return AAOS_ENOTSUP;
+    }
+    protobuf_get(self, PACKET_LENGTH, &length);
+    if (length < 3 * sizeof(double)) {
+        return AAOS_EINVAL;
+    }
+    protobuf_get(self, PACKET_BUF, &buf, NULL);
+    memcpy(&start, buf, sizeof(double));
+    memcpy(&end, buf + sizeof(double), sizeof(double));
+    memcpy(&step, buf + 2 * sizeof(double), sizeof(double));
+    
+    if ((data = (double *) Malloc(sizeof(double) * AWS_ARCHIVE_QUERY_SIZE)) == NULL) {
+        return AAOS_ENOMEM;
+    }
+    if ((ret = aws_archive_query(archive, start, end, step, data, AWS_ARCHIVE_QUERY_SIZE, &n_row, &n_column, &truncated)) == AAOS_OK) {
+        protobuf_set(self, PACKET_OPTION, truncated ? AWS_ARCHIVE_TRUNCATED : 0);
+        protobuf_set(self, PACKET_U32F0, (uint32_t) n_row);
+        protobuf_set(self, PACKET_U32F1, (uint32_t) n_column);
+        protobuf_set(self, PACKET_BUF, data, n_row * (1 + 3 * n_column) * sizeof(double));
+    }
+    free(data);
+    
+    return ret;
+}
+
 static int
 AWS_execute_inspect(struct AWS *self)
 {
@@ -1636,6 +1812,9 @@ AWS_execute(void *_self)
         case AWS_COMMAND_STATUS:
             ret = AWS_execute_status(self);
             break;
+        case AWS_COMMAND_QUERY_ARCHIVE:
+            ret = AWS_execute_query_archive(self);
+            break;
         case SYSTEM_COMMAND_INSPECT:
             ret = AWS_execute_inspect(self);
             break;
@@ -1793,6 +1972,14 @@ AWSClass_ctor(void *_self, va_list *app)
             self->status.method = method;
             continue;
         }
+        if (selector == (Method) aws_query_archive) {
+            if (tag) {
+                self->query_archive.tag = tag;
+                self->query_archive.selector = selector;
+            }
+            self->query_archive.method = method;
+            continue;
+        }
         if (selector == (Method) aws_data_log) {
             if (tag) {
                 self->data_log.tag = tag;
@@ -1892,6 +2079,7 @@ AWS_initialize(void)
                aws_get_data, "get_data", AWS_get_data,
                aws_get_raw_data, "get_raw_data", AWS_get_raw_data,
                aws_data_log, "data_log", AWS_data_log,
+               aws_query_archive, "query_archive", AWS_query_archive,
                aws_data_field, "data_field", AWS_data_field,
                aws_status, "status", AWS_status,
                aws_inspect, "inspect", AWS_inspect,
@@ -2120,10 +2308,9 @@ AWSServer_accept(void *_self, void **client)
 {
     struct RPCServer *self = cast(RPCServer(), _self);
     
-    int lfd, cfd;
+    int cfd;
     
-    lfd = tcp_server_get_lfd(self);
-    cfd = Accept(lfd, NULL, NULL);
+    cfd = rpc_server_accept_fd(self, TCPSERVER_OPTION_TCP);
     if (cfd < 0) {
         *client = NULL;
         return AAOS_ERROR;
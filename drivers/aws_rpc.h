@@ -10,6 +10,7 @@
 #define aws_rpc_h
 
 #include "rpc.h"
+#include <stdbool.h>
 #include <string.h>
 #include <stdio.h>
 
@@ -25,9 +26,15 @@
 #define AWS_COMMAND_DATA_LOG                10
 #define AWS_COMMAND_DATA_FIELD              11
 #define AWS_COMMAND_STATUS                  12
+#define AWS_COMMAND_QUERY_ARCHIVE           13
 #define AWS_COMMAND_INSPECT                 0xFFFE
 #define AWS_COMMAND_REGISTER                0xFFFF
 
+/*
+ * Option of an AWS_COMMAND_QUERY_ARCHIVE reply, the rows did not fit in it.
+ */
+#define AWS_ARCHIVE_TRUNCATED               0x0001
+
 #define AWS_COMMAND_GET_INDEX_BY_NAME 23
 #define AWS_COMMAND_GET_CHANNEL_BY_NAME 24
 
@@ -57,11 +64,18 @@ int aws_get_precipitation_by_name(void *_self, const char *aws_name, const char
 int aws_get_precipitation_by_channel(void *_self, unsigned int index, unsigned int channel, double *precipitation, size_t size);
 int aws_get_data_by_name(void *_self, const char *aws_name, const char *channel_name, double *data, size_t size);
 int aws_get_data_by_channel(void *_self, unsigned int index, unsigned int channel, double *data, size_t size);
+/*
+ * Read one value from each of n channels of the weather station of index, pipelined if the connection is,
+ * see rpc_pipeline. results[i] is the result of channel i, data[i] is set only if it is AAOS_OK.
+ * Returns AAOS_OK unless the connection fails, with the negative error of rpc_call then.
+ */
+int aws_get_data_by_channels(void *_self, unsigned int index, const unsigned int *channels, double *data, int *results, size_t n);
 int aws_get_raw_data_by_name(void *_self, const char *aws_name, const char *channel_name, void *data, size_t size);
 int aws_get_raw_data_by_channel(void *_self, unsigned int index, unsigned int channel, void *data, size_t size);
 int aws_status(void *_self, FILE *fp);
 int aws_data_log(void *_self, FILE *fp);
 int aws_data_field(void *_self, FILE *fp);
+int aws_query_archive(void *_self, double start, double end, double step, double *data, size_t size, size_t *n_row, size_t *n_column, bool *truncated);
 int aws_register(void *_self, double timeout);
 int aws_inspect(void *_self);
 
@@ -33,6 +33,7 @@ struct AWSClass {
     struct Method status;
     struct Method data_log;
     struct Method data_field;
+    struct Method query_archive;
     struct Method reg;
     struct Method inspect;
 };
@@ -14,12 +14,31 @@
 #include "object.h"
 #include "protocol.h"
 #include "rpc.h"
+#include "simulator.h"
 #include "virtual.h"
 #include "wrapper.h"
 
 #include <fitsio2.h>
 #include <cjson/cJSON.h>
 
+/*
+ * Wake up the waiters of the state, and push it to the subscribers of "detector/<name>".
+ * Called with d_state.mtx held.
+ */
+static void
+__Detector_state_broadcast(struct __Detector *self)
+{
+    char topic[PATH_MAX];
+    uint32_t state;
+    
+    Pthread_cond_broadcast(&self->d_state.cond);
+    if (rpc_has_subscriber()) {
+        state = (uint32_t) self->d_state.state;
+        snprintf(topic, PATH_MAX, "detector/%s", self->name == NULL ? "" : self->name);
+        rpc_publish(topic, &state, sizeof(state));
+    }
+}
+
 struct DetectorDataFrame {
     void *buffer;
     struct timespec tp;
@@ -4157,13 +4176,13 @@ VirtualDetector_do_expose(void *arg)
         Pthread_mutex_lock(&detector->_.d_state.mtx);
         detector->_.d_state.state = DETECTOR_STATE_EXPOSING;
         Pthread_mutex_unlock(&detector->_.d_state.mtx);
-        Nanosleep(detector->_.d_param.exposure_time);
+        simulator_sleep(detector->_.d_param.exposure_time);
         
        
         Pthread_mutex_lock(&detector->_.d_state.mtx);
         detector->_.d_state.state = DETECTOR_STATE_READING;
         Pthread_mutex_unlock(&detector->_.d_state.mtx);
-        Nanosleep(readout_time);
+        simulator_sleep(readout_time);
         
         
         if (detector->_.d_exp.notify_last_frame_filling && i == n - 1) {
@@ -4217,7 +4236,7 @@ VirtualDetector_do_expose(void *arg)
             }
         }
         if (gap_time > 0.00001) {
-            Nanosleep(gap_time);
+            simulator_sleep(gap_time);
         }
         Pthread_mutex_lock(&detector->_.d_state.mtx);
         detector->_.d_state.state = DETECTOR_STATE_IDLE;
@@ -4262,7 +4281,7 @@ VirtualDetector_write_image(struct VirtualDetector *detector, fitsfile *fptr, vo
     struct tm tm_buf;
     char buf[TIMESTAMPSIZE];
     
-    Clock_gettime(CLOCK_REALTIME, &tp);
+    simulator_timespec(&tp);
     
     naxes[0] = width * x_n_chip;
     naxes[1] = height * y_n_chip;
@@ -4364,7 +4383,7 @@ VirtualDetector_do_expose_thr(void *arg)
              */
             
             Pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, NULL);
-            Nanosleep(detector->_.d_param.exposure_time);
+            simulator_sleep(detector->_.d_param.exposure_time);
             Pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
             
             Pthread_mutex_lock(&detector->_.d_exp.mtx);
@@ -4402,7 +4421,7 @@ VirtualDetector_do_expose_thr(void *arg)
             detector->_.d_proc.img_fptr = fptr;
             
             Pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, NULL);
-            Nanosleep(1./detector->_.d_param.frame_rate - detector->_.d_param.exposure_time);
+            simulator_sleep(1./detector->_.d_param.frame_rate - detector->_.d_param.exposure_time);
             Pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
             
             VirtualDetector_generate_frame(detector, &data);
@@ -4465,7 +4484,7 @@ VirtualDetector_do_expose_thr(void *arg)
             detector->_.d_state.state |= DETECTOR_STATE_EXPOSING;
             Pthread_mutex_unlock(&detector->_.d_state.mtx);
             Pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, NULL);
-            Nanosleep(detector->_.d_param.exposure_time);
+            simulator_sleep(detector->_.d_param.exposure_time);
             Pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
             
             Pthread_mutex_lock(&detector->_.d_exp.mtx);
@@ -4482,7 +4501,7 @@ VirtualDetector_do_expose_thr(void *arg)
             detector->_.d_state.state |= DETECTOR_STATE_READING;
             Pthread_mutex_unlock(&detector->_.d_state.mtx);
             Pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, NULL);
-            Nanosleep(1./detector->_.d_param.frame_rate - detector->_.d_param.exposure_time);
+            simulator_sleep(1./detector->_.d_param.frame_rate - detector->_.d_param.exposure_time);
             Pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
             VirtualDetector_generate_frame(detector, &data);
             detector->_.d_exp.success_frames++;
@@ -4583,8 +4602,8 @@ VirtualDetector_expose(void *_self, double exposure_time, uint32_t n_frame, va_l
         Pthread_mutex_lock(&self->_.d_state.mtx);
         self->_.d_state.state &= DETECTOR_STATE_MALFUNCTION;
         self->_.d_state.state |= DETECTOR_STATE_IDLE;
+        __Detector_state_broadcast(&self->_);
         Pthread_mutex_unlock(&self->_.d_state.mtx);
-        Pthread_cond_broadcast(&self->_.d_state.cond);
 	
         if (retval == PTHREAD_CANCELED) {
             return AAOS_ECANCELED;
@@ -4705,7 +4724,7 @@ VirtualDetector_inspect(void *_self)
     Pthread_mutex_lock(&self->_.d_state.mtx);
     if (self->_.d_state.state&DETECTOR_STATE_MALFUNCTION) {
         self->_.d_state.state = DETECTOR_STATE_IDLE;
-        Pthread_cond_broadcast(&self->_.d_state.cond);
+        __Detector_state_broadcast(&self->_);
     }
     Pthread_mutex_unlock(&self->_.d_state.mtx);
 
@@ -6175,30 +6194,30 @@ SitianCam_expose(void *_self, double exposure_time, uint32_t n_frames, va_list *
                 case 1:
                     Pthread_mutex_lock(&self->_.d_state.mtx);
                     self->_.d_state.state = DETECTOR_STATE_IDLE;
+                    __Detector_state_broadcast(&self->_);
                     Pthread_mutex_unlock(&self->_.d_state.mtx);
-                    Pthread_cond_broadcast(&self->_.d_state.cond);
                     return AAOS_EBADCMD;
                     break;
                 case 2:
                     Pthread_mutex_lock(&self->_.d_state.mtx);
                     self->_.d_state.state = DETECTOR_STATE_IDLE;
+                    __Detector_state_broadcast(&self->_);
                     Pthread_mutex_unlock(&self->_.d_state.mtx);
-                    Pthread_cond_broadcast(&self->_.d_state.cond);
                     return AAOS_EINVAL;
                     break;
                 case 3:
                 case 4:
                     Pthread_mutex_lock(&self->_.d_state.mtx);
                     self->_.d_state.state = DETECTOR_STATE_IDLE;
+                    __Detector_state_broadcast(&self->_);
                     Pthread_mutex_unlock(&self->_.d_state.mtx);
-                    Pthread_cond_broadcast(&self->_.d_state.cond);
                     return AAOS_EINTR;
                     break;
                 default:
                     Pthread_mutex_lock(&self->_.d_state.mtx);
                     self->_.d_state.state = DETECTOR_STATE_IDLE;
+                    __Detector_state_broadcast(&self->_);
                     Pthread_mutex_unlock(&self->_.d_state.mtx);
-                    Pthread_cond_broadcast(&self->_.d_state.cond);
                     return AAOS_ERROR;
                     break;
             }
@@ -6219,8 +6238,8 @@ SitianCam_expose(void *_self, double exposure_time, uint32_t n_frames, va_list *
     
     Pthread_mutex_lock(&self->_.d_state.mtx);
     self->_.d_state.state = DETECTOR_STATE_IDLE;
+    __Detector_state_broadcast(&self->_);
     Pthread_mutex_unlock(&self->_.d_state.mtx);
-    Pthread_cond_broadcast(&self->_.d_state.cond);
     
     return ret;
 }
@@ -8048,7 +8067,7 @@ GenICam_expose_video(struct GenICam *self, double exposure_time, uint32_t n_fram
             g_clear_error(&error);
         }
         self->_.d_state.state = (self->_.d_state.state&DETECTOR_STATE_MALFUNCTION)|DETECTOR_STATE_IDLE;
-        Pthread_cond_broadcast(&self->_.d_state.cond);
+        __Detector_state_broadcast(&self->_);
     }
 error:
     Pthread_mutex_unlock(&self->_.d_state.mtx);
@@ -8243,7 +8262,7 @@ GenICam_expose_snapshot(struct GenICam *self, double exposure_time, uint32_t n_f
     
     Pthread_mutex_lock(&self->_.d_state.mtx);
     self->_.d_state.state = (self->_.d_state.state&DETECTOR_STATE_MALFUNCTION)|DETECTOR_STATE_IDLE;
-    Pthread_cond_broadcast(&self->_.d_state.cond);
+    __Detector_state_broadcast(&self->_);
     
 error:
     Pthread_mutex_unlock(&self->_.d_state.mtx);
@@ -8310,7 +8329,7 @@ GenICam_wait_for_last_completion(void *_self)
     self->stream = NULL;
     Pthread_mutex_lock(&self->_.d_state.mtx);
     self->_.d_state.state = (self->_.d_state.state&DETECTOR_STATE_MALFUNCTION)|DETECTOR_STATE_IDLE;
-    Pthread_cond_broadcast(&self->_.d_state.cond);
+    __Detector_state_broadcast(&self->_);
     Pthread_mutex_unlock(&self->_.d_state.mtx);
 	
     return ret;
@@ -9116,8 +9135,8 @@ GenICam_inspect(void *_self)
     } else {
         self->_.d_state.state &= ~DETECTOR_STATE_MALFUNCTION;
     }
+    __Detector_state_broadcast(&self->_);
     Pthread_mutex_unlock(&self->_.d_state.mtx);
-    Pthread_cond_broadcast(&self->_.d_state.cond);
     
     return ret;
 }
@@ -15397,8 +15416,8 @@ ASICamera_expose_video(struct ASICamera *self, double exposure_time, uint32_t n_
         Pthread_mutex_unlock(&self->_.d_exp.mtx);
         Pthread_mutex_lock(&self->_.d_state.mtx);
         self->_.d_state.state = (state&DETECTOR_STATE_MALFUNCTION) | DETECTOR_STATE_IDLE;
+        __Detector_state_broadcast(&self->_);
         Pthread_mutex_unlock(&self->_.d_state.mtx);
-        Pthread_cond_broadcast(&self->_.d_state.cond);
         threadsafe_queue_push(self->_.d_proc.queue, NULL);
         Pthread_join(self->_.d_state.tid, &retval);
         Pthread_mutex_lock(&self->_.d_exp.mtx);
@@ -15463,8 +15482,8 @@ ASICamera_expose_video(struct ASICamera *self, double exposure_time, uint32_t n_
     
     Pthread_mutex_lock(&self->_.d_state.mtx);
     self->_.d_state.state = (state&DETECTOR_STATE_MALFUNCTION) | DETECTOR_STATE_IDLE;
+    __Detector_state_broadcast(&self->_);
     Pthread_mutex_unlock(&self->_.d_state.mtx);
-    Pthread_cond_broadcast(&self->_.d_state.cond);
 
     if (retval == PTHREAD_CANCELED) {
         ret = AAOS_ECANCELED;
@@ -19790,8 +19809,8 @@ LeadingCamera_expose(void *_self, double exposure_time, uint32_t n_frame, va_lis
         Pthread_mutex_unlock(&self->_.d_exp.mtx);
         Pthread_mutex_lock(&self->_.d_state.mtx);
         self->_.d_state.state = (state&DETECTOR_STATE_MALFUNCTION) | DETECTOR_STATE_IDLE;
+        __Detector_state_broadcast(&self->_);
         Pthread_mutex_unlock(&self->_.d_state.mtx);
-        Pthread_cond_broadcast(&self->_.d_state.cond);
         threadsafe_queue_push(self->_.d_proc.queue, NULL);
         Pthread_join(self->_.d_state.tid, &retval);
         Pthread_mutex_lock(&self->_.d_exp.mtx);
@@ -19822,8 +19841,8 @@ LeadingCamera_expose(void *_self, double exposure_time, uint32_t n_frame, va_lis
     
     Pthread_mutex_lock(&self->_.d_state.mtx);
     self->_.d_state.state = (state&DETECTOR_STATE_MALFUNCTION) | DETECTOR_STATE_IDLE;
+    __Detector_state_broadcast(&self->_);
     Pthread_mutex_unlock(&self->_.d_state.mtx);
-    Pthread_cond_broadcast(&self->_.d_state.cond);
 
     if (retval == PTHREAD_CANCELED) {
         ret = AAOS_ECANCELED;
@@ -22482,8 +22501,8 @@ QHYCamera_expose_video(struct QHYCamera *self, double exposure_time, uint32_t n_
     Pthread_mutex_lock(&self->_.d_state.mtx);
     state = DETECTOR_STATE_IDLE;
     self->_.d_state.state &= state;
+    __Detector_state_broadcast(&self->_);
     Pthread_mutex_unlock(&self->_.d_state.mtx);
-    Pthread_cond_broadcast(&self->_.d_state.cond);
 
     return ret;
 }
@@ -23165,8 +23184,8 @@ YNAOIRCamera_expose(void *_self, double exposure_time, uint32_t n_frame, va_list
         Pthread_mutex_unlock(&self->_.d_exp.mtx);
         Pthread_mutex_lock(&self->_.d_state.mtx);
         self->_.d_state.state = (state&DETECTOR_STATE_MALFUNCTION) | DETECTOR_STATE_IDLE;
+        __Detector_state_broadcast(&self->_);
         Pthread_mutex_unlock(&self->_.d_state.mtx);
-        Pthread_cond_broadcast(&self->_.d_state.cond);
         threadsafe_queue_push(self->_.d_proc.queue, NULL);
         Pthread_join(self->_.d_state.tid, &retval);
         Pthread_mutex_lock(&self->_.d_exp.mtx);
@@ -23232,8 +23251,8 @@ YNAOIRCamera_expose(void *_self, double exposure_time, uint32_t n_frame, va_list
     
     Pthread_mutex_lock(&self->_.d_state.mtx);
     self->_.d_state.state = (state&DETECTOR_STATE_MALFUNCTION) | DETECTOR_STATE_IDLE;
+    __Detector_state_broadcast(&self->_);
     Pthread_mutex_unlock(&self->_.d_state.mtx);
-    Pthread_cond_broadcast(&self->_.d_state.cond);
 
     if (retval == PTHREAD_CANCELED) {
         ret = AAOS_ECANCELED;
@@ -4452,14 +4452,17 @@ Detector_execute_get_image(struct Detector *self)
                     break;
             }
         }
+        rpc_batch_begin(self);
         protobuf_set(self, PACKET_LENGTH, 0);
         if ((ret = rpc_write(self)) != AAOS_OK) {
+            rpc_batch_end(self);
             Close(fd);
             return ret;
         }
         nleft = sb.st_size;
         while (nleft > 0) {
             if ((nread = Read(fd, buffer, BUFSIZE)) < 0) {
+                rpc_batch_end(self);
                 Close(fd);
                 protobuf_set(self, PACKET_LENGTH, 0);
                 return AAOS_ERROR;
@@ -4468,10 +4471,15 @@ Detector_execute_get_image(struct Detector *self)
             protobuf_set(self, PACKET_ERRORCODE, AAOS_OK);
             nleft -= nread;
             if ((ret = rpc_write(self)) != AAOS_OK) {
+                rpc_batch_end(self);
                 Close(fd);
                 return AAOS_ERROR;
             }
         }
+        Close(fd);
+        /*
+         * The batch is flushed with the final reply.
+         */
     }
     protobuf_set(self, PACKET_LENGTH, 0);
     protobuf_set(self, PACKET_ERRORCODE, AAOS_OK);
@@ -4594,6 +4602,17 @@ Detector_execute_get_index_by_name(struct Detector *self)
     return AAOS_OK;
 }
 
+/*
+ * Cancellation from another connection, the exposure in progress is aborted.
+ */
+static int
+Detector_cancel(void *_self)
+{
+    struct Detector *self = cast(Detector(), _self);
+    
+    return Detector_execute_abort(self);
+}
+
 static int
 Detector_execute(void *_self)
 {
@@ -4776,7 +4795,7 @@ Detector_ctor(void *_self, va_list *app)
 {
     struct Detector *self = super_ctor(Detector(), _self, app);
 
-    protobuf_reallocate(self, 1048576);
+    protobuf_reserve(self->_.protobuf, 1048576);
     
     self->_._vtab = detector_virtual_table();
     
@@ -5226,6 +5245,7 @@ DetectorClass_ctor(void *_self, va_list *app)
 #endif
     
     self->_.execute.method = (Method) 0;
+    self->_.abort.method = (Method) 0;
     
     return self;
 }
@@ -5356,6 +5376,7 @@ detector_virtual_table_initialize(void)
 {
     _detector_virtual_table = new(RPCVirtualTable(),
                                 rpc_execute, "execute", Detector_execute,
+                                rpc_abort, "abort", Detector_cancel,
                                 (void *)0);
     
 #ifndef _USE_COMPILER_ATTRIBUTION_
@@ -5535,10 +5556,9 @@ DetectorServer_accept(void *_self, void **client)
 {
     struct RPCServer *self = cast(RPCServer(), _self);
     
-    int lfd, cfd;
+    int cfd;
     
-    lfd = tcp_server_get_lfd(self);
-    cfd = Accept(lfd, NULL, NULL);
+    cfd = rpc_server_accept_fd(self, TCPSERVER_OPTION_TCP);
     if (cfd < 0) {
         *client = NULL;
         return AAOS_ERROR;
@@ -5556,12 +5576,9 @@ DetectorServer_accept2(void *_self, void **client)
 {
     struct RPCServer *self = cast(RPCServer(), _self);
     
-    int lfd, cfd, lfds[2];
-    
-    tcp_server_get_lfds(self, lfds);
-    lfd = lfds[1];
+    int cfd;
     
-    cfd = Accept(lfd, NULL, NULL);
+    cfd = rpc_server_accept_fd(self, TCPSERVER_OPTION_UDS);
     if (cfd < 0) {
         *client = NULL;
         return AAOS_ERROR;
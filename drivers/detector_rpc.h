@@ -17,6 +17,11 @@
 #include <stddef.h>
 #include <stdint.h>
 
+/*
+ * Every change of the state of a detector is published to the topic "detector/<name>",
+ * with the new state as a uint32_t payload, see rpc_subscribe.
+ */
+
 #define DETECTOR_COMMAND_RAW                    1
 
 #define DETECTOR_COMMAND_EXPOSE                 2
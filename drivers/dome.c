@@ -5,15 +5,37 @@
 //  Created by huyi on 2025/4/27.
 //
 
+#include "astro.h"
 #include "def.h"
 #include "dome.h"
 #include "dome_r.h"
 #include "dome_def.h"
 #include "object.h"
+#include "rpc.h"
+#include "simulator.h"
 #include "virtual.h"
 #include "wrapper.h"
 
 #include <cjson/cJSON.h>
+#include <math.h>
+
+/*
+ * Wake up the waiters of the state, and push it to the subscribers of "dome/<name>".
+ * Called with d_state.mtx held.
+ */
+static void
+__Dome_state_broadcast(struct __Dome *self)
+{
+    char topic[PATH_MAX];
+    uint32_t state;
+    
+    Pthread_cond_broadcast(&self->d_state.cond);
+    if (rpc_has_subscriber()) {
+        state = (uint32_t) self->d_state.state;
+        snprintf(topic, PATH_MAX, "dome/%s", self->name == NULL ? "" : self->name);
+        rpc_publish(topic, &state, sizeof(state));
+    }
+}
 
 /*
  * Dome virtual table.
@@ -141,6 +163,14 @@ __DomeVirtualTable_ctor(void *_self, va_list *app)
             self->slew.method = method;
             continue;
         }
+        if (selector == (Method) __dome_get_azimuth) {
+            if (tag) {
+                self->get_azimuth.tag = tag;
+                self->get_azimuth.selector = selector;
+            }
+            self->get_azimuth.method = method;
+            continue;
+        }
         if (selector == (Method) __dome_park) {
             if (tag) {
                 self->park.tag = tag;
@@ -436,6 +466,68 @@ __Dome_slew(void *_self, double ra, double dec)
     return AAOS_ENOTSUP;
 }
 
+int
+__dome_get_azimuth(void *_self, double *azimuth)
+{
+    const struct __DomeClass *class = (const struct __DomeClass *) classOf(_self);
+    
+    if (isOf(class, __DomeClass()) && class->get_azimuth.method) {
+        return ((int (*)(void *, double *)) class->get_azimuth.method) (_self, azimuth);
+    } else {
+        int result;
+        forward(_self, &result, (Method) __dome_get_azimuth, "get_azimuth", _self, azimuth);
+        return result;
+    }
+}
+
+static int
+__Dome_get_azimuth(void *_self, double *azimuth)
+{
+    return AAOS_ENOTSUP;
+}
+
+int
+__dome_get_geometry(void *_self, struct DomeGeometry *geometry)
+{
+    const struct __DomeClass *class = (const struct __DomeClass *) classOf(_self);
+    
+    if (isOf(class, __DomeClass()) && class->get_geometry.method) {
+        return ((int (*)(void *, struct DomeGeometry *)) class->get_geometry.method) (_self, geometry);
+    } else {
+        int result;
+        forward(_self, &result, (Method) __dome_get_geometry, "get_geometry", _self, geometry);
+        return result;
+    }
+}
+
+/*
+ * The geometry is configured on the dome only, the slaves of observation threads read it from here.
+ */
+static int
+__Dome_get_geometry(void *_self, struct DomeGeometry *geometry)
+{
+    struct __Dome *self = cast(__Dome(), _self);
+    
+    *geometry = self->geometry;
+    
+    return AAOS_OK;
+}
+
+/*
+ * Azimuth of the slit for a telescope pointing at (ra, dec) now, from the geometry of the dome.
+ * Now is on the clock of the simulation, which is the wall clock unless compressed.
+ */
+static int
+__Dome_target_azimuth(struct __Dome *self, double ra, double dec, double *azimuth)
+{
+    double alt, az, ha;
+    
+    radec2altaz(jd(simulator_time()), ra, dec, self->longitude, self->latitude, self->altitude, -1., -300., &alt, &az, NULL);
+    dome_geometry_hadec(self->geometry.latitude, alt, az, &ha, &dec);
+    
+    return dome_geometry_azimuth(&self->geometry, ha, dec, azimuth);
+}
+
 int
 __dome_park(void *_self)
 {
@@ -623,9 +715,13 @@ __Dome_forward(const void *_self, void *result, Method selector, const char *nam
     } else if (selector == (Method) __dome_register || selector == (Method) __dome_set_window_open_speed || selector == (Method) __dome_set_window_close_speed) {
         double value = va_arg(*app, double);
         *((int *) result) = ((int (*)(void *, double)) method)(obj, value);
-    } else if (selector == (Method) __dome_get_window_position || selector == (Method) __dome_get_window_open_speed || selector == (Method) __dome_get_window_close_speed) {
+    } else if (selector == (Method) __dome_get_window_position || selector == (Method) __dome_get_window_open_speed || selector == (Method) __dome_get_window_close_speed || selector == (Method) __dome_get_azimuth) {
         double *value = va_arg(*app, double *);
         *((int *) result) = ((int (*)(void *, double *)) method)(obj, value);
+    } else if (selector == (Method) __dome_slew) {
+        double ra = va_arg(*app, double);
+        double dec = va_arg(*app, double);
+        *((int *) result) = ((int (*)(void *, double, double)) method)(obj, ra, dec);
     } else {
         assert(0);
     }
@@ -665,7 +761,52 @@ __Dome_ctor(void *_self, va_list *app)
 			self->window_close_speed = va_arg(*app, double);
 			continue;
 		}
+		if (strcmp(key, "slew_speed") == 0) {
+			self->slew_speed = va_arg(*app, double);
+			continue;
+		}
+		if (strcmp(key, "latitude") == 0) {
+			self->latitude = va_arg(*app, double);
+			continue;
+		}
+		if (strcmp(key, "longitude") == 0) {
+			self->longitude = va_arg(*app, double);
+			continue;
+		}
+		if (strcmp(key, "altitude") == 0) {
+			self->altitude = va_arg(*app, double);
+			continue;
+		}
+		if (strcmp(key, "radius") == 0) {
+			self->geometry.radius = va_arg(*app, double);
+			continue;
+		}
+		if (strcmp(key, "mount_east") == 0) {
+			self->geometry.east = va_arg(*app, double);
+			continue;
+		}
+		if (strcmp(key, "mount_north") == 0) {
+			self->geometry.north = va_arg(*app, double);
+			continue;
+		}
+		if (strcmp(key, "mount_up") == 0) {
+			self->geometry.up = va_arg(*app, double);
+			continue;
+		}
+		if (strcmp(key, "mount_offset") == 0) {
+			self->geometry.offset = va_arg(*app, double);
+			continue;
+		}
+		if (strcmp(key, "simulation") == 0) {
+			const struct Simulator *simulator = va_arg(*app, const struct Simulator *);
+			if (simulator != NULL) {
+				self->simulator = *simulator;
+			}
+			continue;
+		}
     }
+    self->geometry.latitude = self->latitude;
+    self->slew_available = (self->slew_speed > 0.);
     self->d_state.state = DOME_STATE_UNINITIALIZED;
     Pthread_mutex_init(&self->d_state.mtx, NULL);
     Pthread_cond_init(&self->d_state.cond, NULL);
@@ -863,6 +1004,22 @@ __DomeClass_ctor(void *_self, va_list *app)
             self->slew.method = method;
             continue;
         }
+        if (selector == (Method) __dome_get_azimuth) {
+            if (tag) {
+                self->get_azimuth.tag = tag;
+                self->get_azimuth.selector = selector;
+            }
+            self->get_azimuth.method = method;
+            continue;
+        }
+        if (selector == (Method) __dome_get_geometry) {
+            if (tag) {
+                self->get_geometry.tag = tag;
+                self->get_geometry.selector = selector;
+            }
+            self->get_geometry.method = method;
+            continue;
+        }
         if (selector == (Method) __dome_park) {
             if (tag) {
                 self->park.tag = tag;
@@ -953,6 +1110,8 @@ __Dome_initialize(void)
                   __dome_register, "register", __Dome_register,
                   __dome_get_name, "get_name", __Dome_get_name,
                   __dome_slew, "slew", __Dome_slew,
+                  __dome_get_azimuth, "get_azimuth", __Dome_get_azimuth,
+                  __dome_get_geometry, "get_geometry", __Dome_get_geometry,
                   __dome_abort, "abort", __Dome_abort,
                   __dome_stop, "stop", __Dome_stop,
                   __dome_park, "park", __Dome_park,
@@ -1018,6 +1177,8 @@ VirtualDomeClass_ctor(void *_self, va_list *app)
 	self->_.set_window_open_speed.method = (Method) 0;
 	self->_.get_window_close_speed.method = (Method) 0;
 	self->_.set_window_close_speed.method = (Method) 0;
+	self->_.slew.method = (Method) 0;
+	self->_.get_azimuth.method = (Method) 0;
 	
     return self;
 }
@@ -1115,26 +1276,110 @@ VirtualDome_simulate_thr(void *arg)
 {
     double *sleep_time = (double *) arg;
     
-    Nanosleep(*sleep_time);
+    simulator_sleep(*sleep_time);
     
     return NULL;
 }
 
+/*
+ * The window moves on the y axis of the simulator, from window_position,
+ * and the dome turns on the x axis, from slew_from, the shortest way.
+ */
+static double
+VirtualDome_window_position(struct VirtualDome *self, unsigned int state)
+{
+    double position = self->_.window_position;
+    
+    if (state&DOME_STATE_WINDOW_OPENING) {
+        position += simulator_axis_travel(&self->_.simulator.y, self->_.window_open_speed, 1. - position, simulator_time() - self->last_window_open_time);
+    } else if (state&DOME_STATE_WINDOW_CLOSING) {
+        position -= simulator_axis_travel(&self->_.simulator.y, self->_.window_close_speed, position, simulator_time() - self->last_window_close_time);
+    }
+    
+    return position;
+}
+
+static double
+VirtualDome_current_azimuth(struct VirtualDome *self)
+{
+    double distance;
+    
+    if (!(self->_.d_state.state&DOME_STATE_SLEWING)) {
+        return self->_.azimuth;
+    }
+    distance = fmod(self->slew_to - self->slew_from + 540., 360.) - 180.;
+    
+    return fmod(self->slew_from + simulator_axis_travel(&self->_.simulator.x, self->_.slew_speed, distance, simulator_time() - self->last_slew_time) + 360., 360.);
+}
+
+/*
+ * Called with d_state.mtx held, returns with it released.
+ * Whoever cancels the move updates the window position.
+ */
+static int
+VirtualDome_move_window(struct VirtualDome *self, unsigned int moving)
+{
+    double speed, distance, duration;
+    int fault, ret;
+    pthread_t tid;
+    void *result;
+    
+    fault = simulator_fault_move(&self->_.simulator.fault);
+    if (fault == SIMULATOR_FAULT_TIMEOUT) {
+        Pthread_mutex_unlock(&self->_.d_state.mtx);
+        simulator_sleep(self->_.simulator.fault.timeout_after > 0. ? self->_.simulator.fault.timeout_after : SIMULATOR_TIMEOUT_AFTER);
+        return AAOS_ETIMEDOUT;
+    }
+    if (moving == DOME_STATE_WINDOW_OPENING) {
+        self->last_window_open_time = simulator_time();
+        speed = self->_.window_open_speed;
+        distance = 1. - self->_.window_position;
+    } else {
+        self->last_window_close_time = simulator_time();
+        speed = self->_.window_close_speed;
+        distance = self->_.window_position;
+    }
+    duration = simulator_axis_duration(&self->_.simulator.y, speed, distance);
+    if (fault == SIMULATOR_FAULT_STALL) {
+        duration *= simulator_fault_stall_fraction(&self->_.simulator.fault);
+    }
+    Pthread_create(&tid, NULL, VirtualDome_simulate_thr, &duration);
+    self->tid = tid;
+    self->_.d_state.state = (self->_.d_state.state&0xFFF0) | moving;
+    Pthread_mutex_unlock(&self->_.d_state.mtx);
+    Pthread_join(tid, &result);
+    Pthread_mutex_lock(&self->_.d_state.mtx);
+    if (result != NULL) {
+        ret = AAOS_ECANCELED;
+    } else if (fault == SIMULATOR_FAULT_STALL) {
+        self->_.window_position = VirtualDome_window_position(self, moving);
+        self->_.d_state.state = (self->_.d_state.state&0xFFF0) | DOME_STATE_WINDOW_STOPPED;
+        ret = AAOS_EDEVMAL;
+    } else if (moving == DOME_STATE_WINDOW_OPENING) {
+        self->_.window_position = 1.;
+        self->_.d_state.state = (self->_.d_state.state&0xFFF0) | DOME_STATE_WINDOW_OPENED;
+        ret = AAOS_OK;
+    } else {
+        self->_.window_position = 0.;
+        self->_.d_state.state = (self->_.d_state.state&0xFFF0) | DOME_STATE_WINDOW_CLOSED;
+        ret = AAOS_OK;
+    }
+    __Dome_state_broadcast(&self->_);
+    Pthread_mutex_unlock(&self->_.d_state.mtx);
+    
+    return ret;
+}
+
 static int
 VirtualDome_open_window(void *_self)
 {
     struct VirtualDome *self = cast(VirtualDome(), _self);
     
-	unsigned int state, tmp;
+	unsigned int state;
     int ret = AAOS_OK;
-    double duration;
-    pthread_t tid;
-    struct timespec tp;
-    void *result;
     
     Pthread_mutex_lock(&self->_.d_state.mtx);
 	state = self->_.d_state.state;
-    tmp = 0xFFF0&state;
 	if (state&DOME_STATE_MALFUNCTION) {
 		Pthread_mutex_unlock(&self->_.d_state.mtx);
 		return AAOS_EDEVMAL;
@@ -1147,59 +1392,12 @@ VirtualDome_open_window(void *_self)
     switch (state) {
         case DOME_STATE_WINDOW_CLOSED:
         case DOME_STATE_WINDOW_STOPPED:
-            Clock_gettime(CLOCK_MONOTONIC, &tp);
-            self->last_window_open_time = tp.tv_sec + tp.tv_nsec / 1000000000.;
-            duration = (1. - self->_.window_position) / self->_.window_open_speed;
-            Pthread_create(&tid, NULL, VirtualDome_simulate_thr, &duration);
-            self->tid = tid;
-            self->_.d_state.state = DOME_STATE_WINDOW_OPENING;
-            Pthread_mutex_unlock(&self->_.d_state.mtx);
-            Pthread_join(tid, &result);
-            Pthread_mutex_lock(&self->_.d_state.mtx);
-            if (result == NULL) {
-                self->_.d_state.state = tmp | DOME_STATE_WINDOW_OPENED;
-                self->_.window_position = 1.;
-                ret = AAOS_OK;
-            } else {
-                Clock_gettime(CLOCK_MONOTONIC, &tp);
-                self->_.window_position += (tp.tv_sec + tp.tv_nsec / 1000000000. - self->last_window_open_time) * self->_.window_open_speed;
-                if (self->_.window_position > 1.) {
-                    self->_.window_position = 1.;
-                }
-                ret = AAOS_ECANCELED;
-            }
-            Pthread_mutex_unlock(&self->_.d_state.mtx);
-            Pthread_cond_broadcast(&self->_.d_state.cond);
+            ret = VirtualDome_move_window(self, DOME_STATE_WINDOW_OPENING);
             break;
         case DOME_STATE_WINDOW_CLOSING:
             Pthread_cancel(self->tid);
-            Clock_gettime(CLOCK_MONOTONIC, &tp);
-            self->last_window_open_time = tp.tv_sec + tp.tv_nsec / 1000000000.;
-            self->_.window_position -= (self->last_window_open_time - self->last_window_close_time) * self->_.window_close_speed;
-            if (self->_.window_position < 0.) {
-                self->_.window_position = 0.;
-            }
-            duration = (1. - self->_.window_position) / self->_.window_open_speed;
-            Pthread_create(&tid, NULL, VirtualDome_simulate_thr, &duration);
-            self->tid = tid;
-            self->_.d_state.state = tmp | DOME_STATE_WINDOW_OPENING;
-            Pthread_mutex_unlock(&self->_.d_state.mtx);
-            Pthread_join(tid, &result);
-            Pthread_mutex_lock(&self->_.d_state.mtx);
-            if (result == NULL) {
-                self->_.d_state.state = tmp | DOME_STATE_WINDOW_OPENED;
-                self->_.window_position = 1.;
-                ret = AAOS_OK;
-            } else {
-                Clock_gettime(CLOCK_MONOTONIC, &tp);
-                self->_.window_position += (tp.tv_sec + tp.tv_nsec / 1000000000. - self->last_window_open_time) * self->_.window_open_speed;
-                if (self->_.window_position > 1.) {
-                    self->_.window_position = 1.;
-                }
-                ret = AAOS_ECANCELED;
-            }
-            Pthread_mutex_unlock(&self->_.d_state.mtx);
-            Pthread_cond_broadcast(&self->_.d_state.cond);
+            self->_.window_position = VirtualDome_window_position(self, state);
+            ret = VirtualDome_move_window(self, DOME_STATE_WINDOW_OPENING);
             break;
         case DOME_STATE_WINDOW_OPENING:
             while (self->_.d_state.state&DOME_STATE_WINDOW_OPENING) {
@@ -1234,16 +1432,11 @@ VirtualDome_close_window(void *_self)
 {
     struct VirtualDome *self = cast(VirtualDome(), _self);
     
-    unsigned int state, tmp;
+    unsigned int state;
     int ret = AAOS_OK;
-    double duration;
-    pthread_t tid;
-    struct timespec tp;
-    void *result;
     
     Pthread_mutex_lock(&self->_.d_state.mtx);
     state = self->_.d_state.state;
-    tmp = 0xFFF0&state;
     if (state&DOME_STATE_MALFUNCTION) {
         Pthread_mutex_unlock(&self->_.d_state.mtx);
         return AAOS_EDEVMAL;
@@ -1256,59 +1449,12 @@ VirtualDome_close_window(void *_self)
     switch (state) {
         case DOME_STATE_WINDOW_OPENED:
         case DOME_STATE_WINDOW_STOPPED:
-            Clock_gettime(CLOCK_MONOTONIC, &tp);
-            self->last_window_close_time = tp.tv_sec + tp.tv_nsec / 1000000000.;
-            duration =  self->_.window_position / self->_.window_close_speed;
-            Pthread_create(&tid, NULL, VirtualDome_simulate_thr, &duration);
-            self->tid = tid;
-            self->_.d_state.state = tmp | DOME_STATE_WINDOW_CLOSING;
-            Pthread_mutex_unlock(&self->_.d_state.mtx);
-            Pthread_join(tid, &result);
-            Pthread_mutex_lock(&self->_.d_state.mtx);
-            if (result == NULL) {
-                self->_.d_state.state = tmp | DOME_STATE_WINDOW_CLOSED;
-                self->_.window_position = 0.;
-                ret = AAOS_OK;
-            } else {
-                Clock_gettime(CLOCK_MONOTONIC, &tp);
-                self->_.window_position -= (tp.tv_sec + tp.tv_nsec / 1000000000. - self->last_window_close_time) * self->_.window_close_speed;
-                if (self->_.window_position < 0.) {
-                    self->_.window_position = 0.;
-                }
-                ret = AAOS_ECANCELED;
-            }
-            Pthread_mutex_unlock(&self->_.d_state.mtx);
-            Pthread_cond_broadcast(&self->_.d_state.cond);
+            ret = VirtualDome_move_window(self, DOME_STATE_WINDOW_CLOSING);
             break;
         case DOME_STATE_WINDOW_OPENING:
             Pthread_cancel(self->tid);
-            Clock_gettime(CLOCK_MONOTONIC, &tp);
-            self->last_window_close_time = tp.tv_sec + tp.tv_nsec / 1000000000.;
-            self->_.window_position += (self->last_window_close_time - self->last_window_open_time) * self->_.window_open_speed;
-            if (self->_.window_position > 1.) {
-                self->_.window_position = 1.;
-            }
-            duration = self->_.window_position / self->_.window_close_speed;
-            Pthread_create(&tid, NULL, VirtualDome_simulate_thr, &duration);
-            self->tid = tid;
-            self->_.d_state.state = tmp | DOME_STATE_WINDOW_CLOSING;
-            Pthread_mutex_unlock(&self->_.d_state.mtx);
-            Pthread_join(tid, &result);
-            Pthread_mutex_lock(&self->_.d_state.mtx);
-            if (result == NULL) {
-                self->_.d_state.state = tmp | DOME_STATE_WINDOW_CLOSED;
-                self->_.window_position = 0.;
-                ret = AAOS_OK;
-            } else {
-                Clock_gettime(CLOCK_MONOTONIC, &tp);
-                self->_.window_position -= (tp.tv_sec + tp.tv_nsec / 1000000000. - self->last_window_close_time) * self->_.window_open_speed;
-                if (self->_.window_position < 0.) {
-                    self->_.window_position = 0.;
-                }
-                ret = AAOS_ECANCELED;
-            }
-            Pthread_mutex_unlock(&self->_.d_state.mtx);
-            Pthread_cond_broadcast(&self->_.d_state.cond);
+            self->_.window_position = VirtualDome_window_position(self, state);
+            ret = VirtualDome_move_window(self, DOME_STATE_WINDOW_CLOSING);
             break;
         case DOME_STATE_WINDOW_CLOSING:
             while (self->_.d_state.state&DOME_STATE_WINDOW_CLOSING) {
@@ -1319,7 +1465,7 @@ VirtualDome_close_window(void *_self)
             if (state&DOME_STATE_MALFUNCTION) {
                 ret = AAOS_EDEVMAL;
             } else {
-                state &= ~DOME_STATE_MALFUNCTION;
+                state &= 0x000F;
                 if (state == DOME_STATE_WINDOW_CLOSED) {
                     ret = AAOS_OK;
                 } else {
@@ -1345,10 +1491,6 @@ VirtualDome_stop_window(void *_self)
     
     unsigned int state, tmp;
     int ret = AAOS_OK;
-    double duration;
-    pthread_t tid;
-    struct timespec tp;
-    void *result;
     
     Pthread_mutex_lock(&self->_.d_state.mtx);
     state = self->_.d_state.state;
@@ -1361,37 +1503,19 @@ VirtualDome_stop_window(void *_self)
         Pthread_mutex_unlock(&self->_.d_state.mtx);
         return AAOS_EUNINIT;
     }
-    state &= ~DOME_STATE_MALFUNCTION;
+    state &= 0x000F;
     switch (state) {
-        case DOME_STATE_WINDOW_OPENED:
-        case DOME_STATE_WINDOW_STOPPED:
-        case DOME_STATE_WINDOW_CLOSED:
-            Pthread_mutex_unlock(&self->_.d_state.mtx);
-            ret = AAOS_OK;
-            break;
         case DOME_STATE_WINDOW_OPENING:
-            Pthread_cancel(self->tid);
-            Clock_gettime(CLOCK_MONOTONIC, &tp);
-            self->_.d_state.state = tmp|DOME_STATE_WINDOW_STOPPED;
-            self->_.window_position += (tp.tv_sec + tp.tv_nsec / 1000000000. -  self->last_window_open_time) * self->_.window_open_speed;
-            if (self->_.window_position > 1.) {
-                self->_.window_position = 1.;
-            }
-            Pthread_mutex_unlock(&self->_.d_state.mtx);
-            ret = AAOS_OK;
-            break;
         case DOME_STATE_WINDOW_CLOSING:
             Pthread_cancel(self->tid);
-            Clock_gettime(CLOCK_MONOTONIC, &tp);
+            self->_.window_position = VirtualDome_window_position(self, state);
             self->_.d_state.state = tmp|DOME_STATE_WINDOW_STOPPED;
-            self->_.window_position -= (tp.tv_sec + tp.tv_nsec / 1000000000. -  self->last_window_close_time) * self->_.window_open_speed;
-            if (self->_.window_position < 0.) {
-                self->_.window_position = 0.;
-            }
             Pthread_mutex_unlock(&self->_.d_state.mtx);
             ret = AAOS_OK;
             break;
         default:
+            Pthread_mutex_unlock(&self->_.d_state.mtx);
+            ret = AAOS_OK;
             break;
     }
     
@@ -1405,9 +1529,14 @@ VirtualDome_status(void *_self, void *status_buffer, size_t size, size_t *length
     
     unsigned int state, state2, tmp;
     bool status;
-    double position = 0., open_speed = 0., close_speed = 0.;
-    struct timespec tp;
+    double position = 0., open_speed = 0., close_speed = 0., azimuth;
 
+    /*
+     * A garbled reply.
+     */
+    if (simulator_fault_noise(&self->_.simulator.fault)) {
+        return AAOS_EBADMSG;
+    }
     Pthread_mutex_lock(&self->_.d_state.mtx);
     state = self->_.d_state.state;
     state2 = state;
@@ -1420,21 +1549,12 @@ VirtualDome_status(void *_self, void *status_buffer, size_t size, size_t *length
     state &= 0x000F;
     if (state == DOME_STATE_WINDOW_CLOSED || state == DOME_STATE_WINDOW_OPENED || state == DOME_STATE_WINDOW_OPENED) {
         position = self->_.window_position;
-    } else if (state == DOME_STATE_WINDOW_CLOSING) {
-        Clock_gettime(CLOCK_MONOTONIC, &tp);
-        position = self->_.window_position - (tp.tv_sec + tp.tv_nsec/1000000000. - self->last_window_close_time) * self->_.window_close_speed;
-        if (position < 0.) {
-            position = 0.;
-        }
-    } else if (state == DOME_STATE_WINDOW_OPENING) {
-        Clock_gettime(CLOCK_MONOTONIC, &tp);
-        position = self->_.window_position + (tp.tv_sec + tp.tv_nsec/1000000000. - self->last_window_open_time) * self->_.window_open_speed;
-        if (position > 1.) {
-            position = 1.;
-        }
+    } else if (state == DOME_STATE_WINDOW_CLOSING || state == DOME_STATE_WINDOW_OPENING || state == DOME_STATE_WINDOW_STOPPED) {
+        position = VirtualDome_window_position(self, state);
     }
     open_speed = self->_.window_open_speed;
     close_speed = self->_.window_close_speed;
+    azimuth = VirtualDome_current_azimuth(self);
     Pthread_mutex_unlock(&self->_.d_state.mtx);
     
     cJSON *root_json;
@@ -1471,6 +1591,9 @@ VirtualDome_status(void *_self, void *status_buffer, size_t size, size_t *length
         cJSON_AddNumberToObject(root_json, "open_speed", open_speed);
         cJSON_AddNumberToObject(root_json, "close_speed", close_speed);
         cJSON_AddNumberToObject(root_json, "position", position);
+        if (self->_.slew_available) {
+            cJSON_AddNumberToObject(root_json, "azimuth", azimuth);
+        }
         cJSON_PrintPreallocated(root_json, status_buffer, (int) size, true);
         cJSON_Delete(root_json);
         if (length != NULL) {
@@ -1549,7 +1672,6 @@ VirtualDome_get_window_position(void *_self, double *position)
     struct VirtualDome *self = cast(VirtualDome(), _self);
     
     unsigned int state;
-    struct timespec tp;
     
     Pthread_mutex_lock(&self->_.d_state.mtx);
     state = self->_.d_state.state;
@@ -1569,18 +1691,8 @@ VirtualDome_get_window_position(void *_self, double *position)
             *position = self->_.window_position;
             break;
         case DOME_STATE_WINDOW_OPENING:
-            Clock_gettime(CLOCK_MONOTONIC, &tp);
-            *position = self->_.window_position + (tp.tv_sec + tp.tv_nsec/ 1000000000. - self->last_window_open_time) * self->_.window_open_speed;
-            if (*position > 1.) {
-                *position = 1.;
-            }
-            break;
         case DOME_STATE_WINDOW_CLOSING:
-            Clock_gettime(CLOCK_MONOTONIC, &tp);
-            *position = self->_.window_position - (tp.tv_sec + tp.tv_nsec/ 1000000000. - self->last_window_close_time) * self->_.window_close_speed;
-            if (*position < 0.) {
-                *position = 0.;
-            }
+            *position = VirtualDome_window_position(self, state);
             break;
         default:
             break;
@@ -1590,6 +1702,82 @@ VirtualDome_get_window_position(void *_self, double *position)
     return AAOS_OK;
 }
 
+static int
+VirtualDome_slew(void *_self, double ra, double dec)
+{
+    struct VirtualDome *self = cast(VirtualDome(), _self);
+    
+    unsigned int state;
+    double azimuth, duration;
+    int fault, ret = AAOS_OK;
+    
+    if (!self->_.slew_available) {
+        return AAOS_ENOTSUP;
+    }
+    if ((ret = __Dome_target_azimuth(&self->_, ra, dec, &azimuth)) != AAOS_OK) {
+        return ret;
+    }
+    
+    Pthread_mutex_lock(&self->_.d_state.mtx);
+    state = self->_.d_state.state;
+    if (state&DOME_STATE_MALFUNCTION) {
+        Pthread_mutex_unlock(&self->_.d_state.mtx);
+        return AAOS_EDEVMAL;
+    }
+    if (state&DOME_STATE_UNINITIALIZED) {
+        Pthread_mutex_unlock(&self->_.d_state.mtx);
+        return AAOS_EUNINIT;
+    }
+    if (state&DOME_STATE_SLEWING) {
+        Pthread_mutex_unlock(&self->_.d_state.mtx);
+        return AAOS_EBUSY;
+    }
+    fault = simulator_fault_move(&self->_.simulator.fault);
+    if (fault == SIMULATOR_FAULT_TIMEOUT) {
+        Pthread_mutex_unlock(&self->_.d_state.mtx);
+        simulator_sleep(self->_.simulator.fault.timeout_after > 0. ? self->_.simulator.fault.timeout_after : SIMULATOR_TIMEOUT_AFTER);
+        return AAOS_ETIMEDOUT;
+    }
+    self->last_slew_time = simulator_time();
+    self->slew_from = self->_.azimuth;
+    self->slew_to = azimuth;
+    duration = simulator_axis_duration(&self->_.simulator.x, self->_.slew_speed, fmod(azimuth - self->_.azimuth + 540., 360.) - 180.);
+    if (fault == SIMULATOR_FAULT_STALL) {
+        duration *= simulator_fault_stall_fraction(&self->_.simulator.fault);
+    }
+    self->_.d_state.state = (state & ~DOME_STATE_PARKED) | DOME_STATE_SLEWING;
+    Pthread_mutex_unlock(&self->_.d_state.mtx);
+    
+    simulator_sleep(duration);
+    
+    Pthread_mutex_lock(&self->_.d_state.mtx);
+    if (fault == SIMULATOR_FAULT_STALL) {
+        self->_.azimuth = VirtualDome_current_azimuth(self);
+        ret = AAOS_EDEVMAL;
+    } else {
+        self->_.azimuth = azimuth;
+    }
+    self->_.d_state.state &= ~DOME_STATE_SLEWING;
+    Pthread_mutex_unlock(&self->_.d_state.mtx);
+    
+    return ret;
+}
+
+static int
+VirtualDome_get_azimuth(void *_self, double *azimuth)
+{
+    struct VirtualDome *self = cast(VirtualDome(), _self);
+    
+    if (!self->_.slew_available) {
+        return AAOS_ENOTSUP;
+    }
+    Pthread_mutex_lock(&self->_.d_state.mtx);
+    *azimuth = VirtualDome_current_azimuth(self);
+    Pthread_mutex_unlock(&self->_.d_state.mtx);
+    
+    return AAOS_OK;
+}
+
 static int
 VirtualDome_inspect(void *_self)
 {
@@ -1626,6 +1814,8 @@ virtual_dome_virtual_table_initialize(void)
                                       __dome_get_window_position, "get_window_position", VirtualDome_get_window_position,
                                       __dome_inspect, "inspect", VirtualDome_inspect,
                                       __dome_register, "register", VirtualDome_register,
+                                      __dome_slew, "slew", VirtualDome_slew,
+                                      __dome_get_azimuth, "get_azimuth", VirtualDome_get_azimuth,
                                       (void *) 0);
 #ifndef _USE_COMPILER_ATTRIBUTION_
     atexit(virtual_dome_virtual_table_destroy);
@@ -12,6 +12,8 @@
 #include "object.h"
 #include "virtual.h"
 
+struct DomeGeometry;
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -29,6 +31,8 @@ int __dome_set_window_open_speed(void *_self, double speed);
 int __dome_get_window_close_speed(void *_self, double *speed);
 int __dome_set_window_close_speed(void *_self, double speed);
 int __dome_slew(void *_self, double ra, double dec);
+int __dome_get_azimuth(void *_self, double *azimuth);
+int __dome_get_geometry(void *_self, struct DomeGeometry *geometry);
 int __dome_park(void *_self);
 int __dome_park_off(void *_self);
 int __dome_stop(void *_self);
@@ -8,7 +8,9 @@
 #ifndef dome_r_h
 #define dome_r_h
 
+#include "dome_slave.h"
 #include "object_r.h"
+#include "simulator.h"
 #include "virtual_r.h"
 #include <string.h>
 #include <pthread.h>
@@ -28,11 +30,14 @@ struct __Dome {
     double window_open_speed;
     double window_close_speed;
     double window_position;
+    double azimuth;
     double slew_speed;
     double track_speed;
     double latitude;
     double longitude;
     double altitude;
+    struct DomeGeometry geometry;
+    struct Simulator simulator;     /* virtual dome only */
 	bool slew_available;
 };
 
@@ -53,6 +58,8 @@ struct __DomeClass {
 	struct Method set_window_close_speed;
     struct Method go_home;
 	struct Method slew;
+	struct Method get_azimuth;
+	struct Method get_geometry;
 	struct Method park;
 	struct Method park_off;
     struct Method stop;
@@ -77,6 +84,7 @@ struct __DomeVirtualTable {
 	struct Method set_window_close_speed;
     struct Method go_home;
     struct Method slew;
+    struct Method get_azimuth;
 	struct Method park;
 	struct Method park_off;
     struct Method stop;
@@ -87,6 +95,9 @@ struct VirtualDome {
 	struct __Dome _;
 	double last_window_open_time;
 	double last_window_close_time;
+	double last_slew_time;
+	double slew_from;
+	double slew_to;
 	pthread_t tid;
 };
 
@@ -11,6 +11,7 @@
 #include "dome.h"
 #include "dome_rpc.h"
 #include "dome_rpc_r.h"
+#include "dome_slave.h"
 #include "wrapper.h"
 
 void **domes;
@@ -660,6 +661,44 @@ Dome_stop(void *_self)
     return rpc_call(self);
 }
 
+int
+dome_get_geometry(void *_self, struct DomeGeometry *geometry)
+{
+    const struct DomeClass *class = (const struct DomeClass *) classOf(_self);
+    
+    if (isOf(class, DomeClass()) && class->get_geometry.method) {
+        return ((int (*)(void *, struct DomeGeometry *)) class->get_geometry.method)(_self, geometry);
+    } else {
+        int result;
+        forward(_self, &result, (Method) dome_get_geometry, "get_geometry", _self, geometry);
+        return result;
+    }
+}
+
+static int
+Dome_get_geometry(void *_self, struct DomeGeometry *geometry)
+{
+    struct Dome *self = cast(Dome(), _self);
+    
+    int ret;
+    void *buf;
+    size_t length;
+    
+    protobuf_set(self, PACKET_PROTOCOL, PROTO_DOME);
+    protobuf_set(self, PACKET_COMMAND, DOME_COMMAND_GET_GEOMETRY);
+    protobuf_set(self, PACKET_LENGTH, 0);
+    
+    if ((ret = rpc_call(self)) == AAOS_OK) {
+        protobuf_get(self, PACKET_BUF, &buf, &length);
+        if (length != sizeof(struct DomeGeometry)) {
+            return AAOS_EBADMSG;
+        }
+        memcpy(geometry, buf, sizeof(struct DomeGeometry));
+    }
+    
+    return ret;
+}
+
 int
 dome_raw(void *_self, const void *write_buffer, size_t write_buffer_size, size_t *write_size, void *read_buffer, size_t read_buffer_size, size_t *read_size)
 {
@@ -869,6 +908,33 @@ Dome_execute_status(struct Dome *self)
     return ret;
 }
 
+static int
+Dome_execute_get_geometry(struct Dome *self)
+{
+    int ret;
+    void *dome;
+    void *buf;
+    uint16_t index;
+    
+    protobuf_get(self, PACKET_INDEX, &index);
+    
+    if ((dome = get_dome_by_index(index)) == NULL) {
+        return AAOS_ENOTFOUND;
+    }
+    
+    protobuf_set(self, PACKET_LENGTH, 0);
+    if (protobuf_payload(self) < sizeof(struct DomeGeometry) && (ret = protobuf_reallocate(self, sizeof(struct DomeGeometry))) != AAOS_OK) {
+        return ret;
+    }
+    protobuf_get(self, PACKET_BUF, &buf, NULL);
+    
+    if ((ret = __dome_get_geometry(dome, (struct DomeGeometry *) buf)) == AAOS_OK) {
+        protobuf_set(self, PACKET_LENGTH, (uint32_t) sizeof(struct DomeGeometry));
+    }
+    
+    return ret;
+}
+
 static int
 Dome_execute_raw(struct Dome *self)
 {
@@ -1078,7 +1144,7 @@ Dome_execute_slew(struct Dome *self)
     }
 
     protobuf_get(self, PACKET_DF0, &ra);
-    protobuf_get(self, PACKET_DF0, &dec);
+    protobuf_get(self, PACKET_DF1, &dec);
     protobuf_set(self, PACKET_LENGTH, 0);
     
     return __dome_slew(dome, ra, dec);
@@ -1186,6 +1252,17 @@ Dome_execute_default(struct Dome *self)
     return AAOS_EBADCMD;
 }
 
+/*
+ * Cancellation from another connection, the dome is stopped where it is.
+ */
+static int
+Dome_cancel(void *_self)
+{
+    struct Dome *self = cast(Dome(), _self);
+    
+    return Dome_execute_abort(self);
+}
+
 static int
 Dome_execute(void *_self)
 {
@@ -1246,7 +1323,7 @@ Dome_execute(void *_self)
             ret = Dome_execute_raw(self);
             break;
         case DOME_COMMAND_SLEW:
-            ret = Dome_execute_raw(self);
+            ret = Dome_execute_slew(self);
             break;
         case DOME_COMMAND_PARK:
             ret = Dome_execute_park(self);
@@ -1260,6 +1337,9 @@ Dome_execute(void *_self)
         case DOME_COMMAND_STOP:
             ret = Dome_execute_stop(self);
             break;
+        case DOME_COMMAND_GET_GEOMETRY:
+            ret = Dome_execute_get_geometry(self);
+            break;
         default:
             return Dome_execute_default(self);
             break;
@@ -1295,6 +1375,7 @@ DomeClass_ctor(void *_self, va_list *app)
     Method selector;
     
     self->_.execute.method = (Method) 0;
+    self->_.abort.method = (Method) 0;
     
 #ifdef va_copy
     va_list ap;
@@ -1459,6 +1540,14 @@ DomeClass_ctor(void *_self, va_list *app)
             self->stop.method = method;
             continue;
         }
+        if (selector == (Method) dome_get_geometry) {
+            if (tag) {
+                self->get_geometry.tag = tag;
+                self->get_geometry.selector = selector;
+            }
+            self->get_geometry.method = method;
+            continue;
+        }
     }
     
 #ifdef va_copy
@@ -1533,6 +1622,7 @@ Dome_initialize(void)
                 dome_park_off, "park_off", Dome_park_off,
                 dome_abort, "abort", Dome_abort,
                 dome_stop, "stop", Dome_stop,
+                dome_get_geometry, "get_geometry", Dome_get_geometry,
                 
                 (void *) 0);
     
@@ -1567,6 +1657,7 @@ dome_virtual_table_initialize(void)
 {
     _dome_virtual_table = new(RPCVirtualTable(),
                               rpc_execute, "execute", Dome_execute,
+                              rpc_abort, "abort", Dome_cancel,
                               (void *) 0);
 #ifndef _USE_COMPILER_ATTRIBUTION_
     atexit(dome_virtual_table_destroy);
@@ -1758,10 +1849,9 @@ DomeServer_accept(void *_self, void **client)
 {
     struct RPCServer *self = cast(RPCServer(), _self);
     
-    int lfd, cfd;
+    int cfd;
     
-    lfd = tcp_server_get_lfd(self);
-    cfd = Accept(lfd, NULL, NULL);
+    cfd = rpc_server_accept_fd(self, TCPSERVER_OPTION_TCP);
     if (cfd < 0) {
         *client = NULL;
         return AAOS_ERROR;
@@ -1779,12 +1869,9 @@ DomeServer_accept2(void *_self, void **client)
 {
     struct RPCServer *self = cast(RPCServer(), _self);
     
-    int lfd, cfd, lfds[2];
-    
-    tcp_server_get_lfds(self, lfds);
-    lfd = lfds[1];
+    int cfd;
     
-    cfd = Accept(lfd, NULL, NULL);
+    cfd = rpc_server_accept_fd(self, TCPSERVER_OPTION_UDS);
     if (cfd < 0) {
         *client = NULL;
         return AAOS_ERROR;
@@ -12,6 +12,13 @@
 #include <stddef.h>
 #include <stdint.h>
 
+struct DomeGeometry;
+
+/*
+ * Every change of the state of a dome is published to the topic "dome/<name>",
+ * with the new state as a uint32_t payload, see rpc_subscribe.
+ */
+
 #define DOME_COMMAND_GET_INDEX_BY_NAME          1
 #define DOME_COMMAND_GET_NAME_BY_INDEX			2
 #define DOME_COMMAND_INIT						3
@@ -32,6 +39,7 @@
 #define DOME_COMMAND_STOP                       18
 #define DOME_COMMAND_ABORT                      19
 #define DOME_COMMAND_RAW						20
+#define DOME_COMMAND_GET_GEOMETRY               21
 
 
 #ifdef __cplusplus
@@ -55,6 +63,7 @@ int dome_park(void *_self);
 int dome_park_off(void *_self);
 int dome_abort(void *_self);
 int dome_stop(void *_self);
+int dome_get_geometry(void *_self, struct DomeGeometry *geometry);
 int dome_raw(void *_self, const void *write_buffer, size_t write_buffer_size, size_t *write_size, void *read_buffer, size_t read_buffer_size, size_t *read_size);
 int dome_get_index_by_name(void *_self, const char *name);
 int dome_get_name_by_index(void *_self, uint16_t index, char *name, size_t size);
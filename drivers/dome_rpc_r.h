@@ -34,6 +34,7 @@ struct DomeClass {
     struct Method park_off;
     struct Method abort;
     struct Method stop;
+    struct Method get_geometry;
     struct Method reg;
     struct Method inspect;
 };
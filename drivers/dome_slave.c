@@ -0,0 +1,229 @@
+//
+//  dome_slave.c
+//  AAOS
+//
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "def.h"
+#include "dome_slave.h"
+#include "wrapper.h"
+
+#define DOME_SLAVE_SIDEREAL_RATE    (360.98564736629 / 86400.)
+#define DOME_SLAVE_MIN_AHEAD        1.
+
+#define deg2rad(x)  ((x) * M_PI / 180.)
+#define rad2deg(x)  ((x) * 180. / M_PI)
+
+static double
+wrap180(double x)
+{
+    x = fmod(x, 360.);
+    if (x > 180.) {
+        x -= 360.;
+    } else if (x <= -180.) {
+        x += 360.;
+    }
+    
+    return x;
+}
+
+void
+dome_geometry_hadec(double latitude, double alt, double az, double *ha, double *dec)
+{
+    double e = cos(deg2rad(alt)) * sin(deg2rad(az)), n = cos(deg2rad(alt)) * cos(deg2rad(az)), u = sin(deg2rad(alt));
+    double sl = sin(deg2rad(latitude)), cl = cos(deg2rad(latitude));
+    double sd = n * cl + u * sl;
+    
+    *dec = rad2deg(asin(fmax(-1., fmin(1., sd))));
+    *ha = rad2deg(atan2(-e, u * cl - n * sl));
+}
+
+int
+dome_geometry_azimuth(const struct DomeGeometry *geometry, double ha, double dec, double *azimuth)
+{
+    double sh = sin(deg2rad(ha)), ch = cos(deg2rad(ha)), sd = sin(deg2rad(dec)), cd = cos(deg2rad(dec));
+    double sl = sin(deg2rad(geometry->latitude)), cl = cos(deg2rad(geometry->latitude));
+    double s[3], o[3], x[3], side, b, c;
+    
+    /*
+     * Pointing, and origin of the optical axis, in east, north and up.
+     * The declination axis is the normal of the hour circle, toward east on the meridian.
+     */
+    s[0] = -cd * sh;
+    s[1] = sd * cl - cd * ch * sl;
+    s[2] = sd * sl + cd * ch * cl;
+    side = (sh >= 0.) ? 1. : -1.;
+    o[0] = geometry->east + side * geometry->offset * ch;
+    o[1] = geometry->north - side * geometry->offset * sh * sl;
+    o[2] = geometry->up + side * geometry->offset * sh * cl;
+    
+    /*
+     * Without a radius, the slit follows the azimuth of the telescope.
+     */
+    if (geometry->radius <= 0.) {
+        o[0] = o[1] = o[2] = 0.;
+    }
+    b = o[0] * s[0] + o[1] * s[1] + o[2] * s[2];
+    c = o[0] * o[0] + o[1] * o[1] + o[2] * o[2] - geometry->radius * geometry->radius;
+    if (c > 0. || (c == 0. && geometry->radius > 0.)) {
+        return AAOS_EINVAL;
+    }
+    b = -b + sqrt(b * b - c);
+    x[0] = o[0] + b * s[0];
+    x[1] = o[1] + b * s[1];
+    x[2] = o[2] + b * s[2];
+    
+    if (x[0] == 0. && x[1] == 0.) {
+        *azimuth = rad2deg(atan2(s[0], s[1]));
+    } else {
+        *azimuth = rad2deg(atan2(x[0], x[1]));
+    }
+    if (*azimuth < 0.) {
+        *azimuth += 360.;
+    }
+    
+    return AAOS_OK;
+}
+
+void
+dome_slave_init(struct DomeSlave *slave, const struct DomeGeometry *geometry, double hysteresis, double lead, double interval)
+{
+    memset(slave, '\0', sizeof(struct DomeSlave));
+    slave->geometry = *geometry;
+    slave->hysteresis = hysteresis;
+    slave->lead = lead;
+    slave->interval = interval;
+    Pthread_mutex_init(&slave->mtx, NULL);
+    Pthread_cond_init(&slave->cond, NULL);
+}
+
+void
+dome_slave_destroy(struct DomeSlave *slave)
+{
+    dome_slave_stop(slave);
+    Pthread_mutex_destroy(&slave->mtx);
+    Pthread_cond_destroy(&slave->cond);
+}
+
+/*
+ * Tell whether the dome has to move for a telescope at (alt, az), and if so,
+ * where to, and how many seconds ahead of the telescope.
+ */
+bool
+dome_slave_update(struct DomeSlave *slave, double alt, double az, double now, double *azimuth, double *ahead)
+{
+    double ha, dec, required, aim, lead;
+    
+    dome_geometry_hadec(slave->geometry.latitude, alt, az, &ha, &dec);
+    if (dome_geometry_azimuth(&slave->geometry, ha, dec, &required) != AAOS_OK) {
+        return false;
+    }
+    if (slave->moved && (fabs(wrap180(required - slave->azimuth)) <= slave->hysteresis || now - slave->last < slave->interval)) {
+        return false;
+    }
+    
+    /*
+     * Near the zenith the azimuth runs fast, halve the lead until the aim is within the hysteresis.
+     */
+    aim = required;
+    for (lead = slave->lead; lead >= DOME_SLAVE_MIN_AHEAD; lead /= 2.) {
+        if (dome_geometry_azimuth(&slave->geometry, ha + lead * DOME_SLAVE_SIDEREAL_RATE, dec, &aim) == AAOS_OK && fabs(wrap180(aim - required)) <= slave->hysteresis) {
+            break;
+        }
+        aim = required;
+    }
+    if (lead < DOME_SLAVE_MIN_AHEAD) {
+        lead = 0.;
+    }
+    
+    slave->azimuth = aim;
+    slave->last = now;
+    slave->moved = true;
+    slave->n_move++;
+    *azimuth = aim;
+    *ahead = lead;
+    
+    return true;
+}
+
+/*
+ * The last move failed, the next update moves again.
+ */
+void
+dome_slave_reset(struct DomeSlave *slave)
+{
+    slave->moved = false;
+}
+
+static void *
+dome_slave_thr(void *arg)
+{
+    struct DomeSlave *slave = (struct DomeSlave *) arg;
+    struct timespec tp;
+    double ra, dec, alt, az, now, azimuth, ahead;
+    
+    Pthread_mutex_lock(&slave->mtx);
+    while (slave->running) {
+        Pthread_mutex_unlock(&slave->mtx);
+        Clock_gettime(CLOCK_REALTIME, &tp);
+        now = tp.tv_sec + tp.tv_nsec / 1000000000.;
+        if (slave->position(slave->telescope, &ra, &dec, &alt, &az) == AAOS_OK && dome_slave_update(slave, alt, az, now, &azimuth, &ahead)) {
+            ra = fmod(ra - ahead * DOME_SLAVE_SIDEREAL_RATE + 360., 360.);
+            if (slave->slew(slave->dome, ra, dec) != AAOS_OK) {
+                dome_slave_reset(slave);
+            }
+        }
+        now += slave->period;
+        tp.tv_sec = (time_t) floor(now);
+        tp.tv_nsec = (long) ((now - tp.tv_sec) * 1000000000.);
+        Pthread_mutex_lock(&slave->mtx);
+        while (slave->running && pthread_cond_timedwait(&slave->cond, &slave->mtx, &tp) == 0) {
+        }
+    }
+    Pthread_mutex_unlock(&slave->mtx);
+    
+    return NULL;
+}
+
+int
+dome_slave_start(struct DomeSlave *slave, void *telescope, int (*position)(void *, double *, double *, double *, double *), void *dome, int (*slew)(void *, double, double), double period)
+{
+    Pthread_mutex_lock(&slave->mtx);
+    if (slave->running) {
+        Pthread_mutex_unlock(&slave->mtx);
+        return AAOS_EALREADY;
+    }
+    slave->telescope = telescope;
+    slave->position = position;
+    slave->dome = dome;
+    slave->slew = slew;
+    slave->period = (period > 0.) ? period : DOME_SLAVE_PERIOD;
+    slave->moved = false;
+    slave->running = true;
+    Pthread_create(&slave->tid, NULL, dome_slave_thr, slave);
+    Pthread_mutex_unlock(&slave->mtx);
+    
+    return AAOS_OK;
+}
+
+/*
+ * Waits for the move in progress, if any.
+ */
+int
+dome_slave_stop(struct DomeSlave *slave)
+{
+    Pthread_mutex_lock(&slave->mtx);
+    if (!slave->running) {
+        Pthread_mutex_unlock(&slave->mtx);
+        return AAOS_OK;
+    }
+    slave->running = false;
+    Pthread_cond_broadcast(&slave->cond);
+    Pthread_mutex_unlock(&slave->mtx);
+    Pthread_join(slave->tid, NULL);
+    
+    return AAOS_OK;
+}
@@ -0,0 +1,88 @@
+//
+//  dome_slave.h
+//  AAOS
+//
+
+#ifndef dome_slave_h
+#define dome_slave_h
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Slaving a dome to a telescope.
+ *
+ * The geometry model finds the azimuth where the optical axis leaves the dome, a sphere
+ * around the dome center. The intersection of the mount axes may be offset from the dome center,
+ * and for a German equatorial mount, the optical axis is offset from the polar axis along
+ * the declination axis; the tube is on the east side of the pier while pointing west of the meridian.
+ * Without a radius, the slit follows the azimuth of the telescope.
+ * Azimuths are in degree, from north through east.
+ *
+ * The slave moves the dome only when the required azimuth is more than hysteresis away from
+ * the last move, and no more often than once per interval. Every move aims ahead, where
+ * the telescope will be up to lead seconds later, but never more than hysteresis ahead,
+ * so a tracking telescope is followed by one move per about twice the hysteresis.
+ *
+ * The service polls the position of the telescope every period seconds from a thread of its own,
+ * and moves the dome by the slew callback, with the right ascension shifted by the lead.
+ */
+
+#define DOME_SLAVE_HYSTERESIS   2.
+#define DOME_SLAVE_LEAD         300.
+#define DOME_SLAVE_INTERVAL     5.
+#define DOME_SLAVE_PERIOD       1.
+
+struct DomeGeometry {
+    double latitude;        /* degree */
+    double radius;          /* meter */
+    double east;            /* intersection of the mount axes from the dome center, meter */
+    double north;
+    double up;
+    double offset;          /* optical axis from the polar axis, along the declination axis, meter */
+};
+
+struct DomeSlave {
+    struct DomeGeometry geometry;
+    double hysteresis;      /* degree */
+    double lead;            /* longest time to aim ahead, in seconds */
+    double interval;        /* shortest time between two moves, in seconds */
+    double azimuth;         /* aim of the last move */
+    double last;            /* time of the last move */
+    bool moved;
+    uint64_t n_move;
+    /*
+     * Service.
+     */
+    void *telescope;
+    int (*position)(void *telescope, double *ra, double *dec, double *alt, double *az);
+    void *dome;
+    int (*slew)(void *dome, double ra, double dec);
+    double period;
+    bool running;
+    pthread_mutex_t mtx;
+    pthread_cond_t cond;
+    pthread_t tid;
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void dome_geometry_hadec(double latitude, double alt, double az, double *ha, double *dec);
+int dome_geometry_azimuth(const struct DomeGeometry *geometry, double ha, double dec, double *azimuth);
+
+void dome_slave_init(struct DomeSlave *slave, const struct DomeGeometry *geometry, double hysteresis, double lead, double interval);
+void dome_slave_destroy(struct DomeSlave *slave);
+bool dome_slave_update(struct DomeSlave *slave, double alt, double az, double now, double *azimuth, double *ahead);
+void dome_slave_reset(struct DomeSlave *slave);
+
+int dome_slave_start(struct DomeSlave *slave, void *telescope, int (*position)(void *, double *, double *, double *, double *), void *dome, int (*slew)(void *, double, double), double period);
+int dome_slave_stop(struct DomeSlave *slave);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* dome_slave_h */
@@ -12,6 +12,7 @@
 #include "pdu_r.h"
 #include "pdu.h"
 #include "protocol.h"
+#include "rpc.h"
 #include "serial_rpc.h"
 #include "virtual.h"
 #include "wrapper.h"
@@ -687,7 +688,7 @@ AAGSwitch_destroy(void)
 static void
 AAGSwitch_initialize(void)
 {
-    _AAGSwitch = new(AAGSwitchClass(), "AAGSwitch", AAGSwitch(), sizeof(struct AAGSwitch),
+    _AAGSwitch = new(AAGSwitchClass(), "AAGSwitch", Switch(), sizeof(struct AAGSwitch),
                      ctor, "ctor", AAGSwitch_ctor,
                      dtor, "dtor", AAGSwitch_dtor,
                      (void *) 0);
@@ -710,7 +711,7 @@ AAGSwitch(void)
 static int
 AAGSwitch_turn_on(void *_self)
 {
-    struct AAGSwitch *self = cast(__PDU(), _self);
+    struct AAGSwitch *self = cast(AAGSwitch(), _self);
     struct AAGPDU *pdu = (struct AAGPDU *) self->_.pdu;
     unsigned int channel = self->_.channel;
     void *serial = pdu->serial;
@@ -760,7 +761,7 @@ AAGSwitch_turn_on(void *_self)
 static int
 AAGSwitch_turn_off(void *_self)
 {
-    struct AAGSwitch *self = cast(__PDU(), _self);
+    struct AAGSwitch *self = cast(AAGSwitch(), _self);
     struct AAGPDU *pdu = (struct AAGPDU *) self->_.pdu;
     unsigned int channel = self->_.channel;
     void *serial = pdu->serial;
@@ -806,7 +807,7 @@ AAGSwitch_turn_off(void *_self)
 static int
 AAGSwitch_get_voltage_current(void *_self, double *voltage, double *current)
 {
-    struct AAGSwitch *self = cast(__PDU(), _self);
+    struct AAGSwitch *self = cast(AAGSwitch(), _self);
     struct AAGPDU *pdu = (struct AAGPDU *) self->_.pdu;
     unsigned int channel = self->_.channel;
     void *serial = pdu->serial;
@@ -849,10 +850,12 @@ error:
         if (i_str != NULL) {
             *i_str = '\0';
             i_str++;
-            *current = ((double) atoi(v_str)) / 400.;
+            if (current != NULL) {
+                *current = ((double) atoi(i_str)) / 400.;
+            }
         }
         v_str = strrchr(res, ':');
-        if (v_str != NULL) {
+        if (v_str != NULL && voltage != NULL) {
             v_str++;
             *voltage = ((double) atoi(v_str)) / 100.;
         }
@@ -894,7 +897,7 @@ AAGSwitch_status(void *_self, unsigned char *status)
     
     return AAOS_OK;
     /*
-    struct AAGSwitch *self = cast(__PDU(), _self);
+    struct AAGSwitch *self = cast(AAGSwitch(), _self);
     struct AAGPDU *pdu = (struct AAGPDU *) self->_.pdu;
     unsigned int channel = self->_.channel;
     void *serial = pdu->serial;
@@ -1091,6 +1094,501 @@ __PDUVirtualTable(void)
  * PDU class
  */
 
+/*
+ * Switch map.
+ * Built when a switch is set, the switches are not changed while the PDU is serving.
+ */
+
+static size_t
+__PDU_hash(const char *s)
+{
+    size_t h = 2166136261U;
+    
+    while (*s) {
+        h ^= (unsigned char) *s++;
+        h *= 16777619U;
+    }
+    
+    return h;
+}
+
+static void
+__PDU_map_build(struct __PDU *self)
+{
+    size_t i, j, mask = self->p_map.size - 1;
+    const char *name;
+    unsigned int channel;
+    
+    memset(self->p_map.by_name, '\0', sizeof(size_t) * self->p_map.size);
+    memset(self->p_map.by_channel, '\0', sizeof(size_t) * self->p_map.size);
+    self->p_map.max_channel = 0;
+    for (i = 0; i < self->n_swicth; i++) {
+        if (self->swicthes[i] == NULL) {
+            continue;
+        }
+        if ((name = switch_get_name(self->swicthes[i])) != NULL) {
+            for (j = __PDU_hash(name) & mask; self->p_map.by_name[j] != 0; j = (j + 1) & mask) {
+            }
+            self->p_map.by_name[j] = i + 1;
+        }
+        channel = switch_get_channel(self->swicthes[i]);
+        for (j = channel & mask; self->p_map.by_channel[j] != 0; j = (j + 1) & mask) {
+        }
+        self->p_map.by_channel[j] = i + 1;
+        self->p_map.max_channel = max(self->p_map.max_channel, channel);
+    }
+}
+
+static int
+__PDU_find_by_name(const struct __PDU *self, const char *name, size_t *index)
+{
+    size_t i, j, mask = self->p_map.size - 1;
+    
+    for (j = __PDU_hash(name) & mask; (i = self->p_map.by_name[j]) != 0; j = (j + 1) & mask) {
+        if (strcmp(name, switch_get_name(self->swicthes[i - 1])) == 0) {
+            *index = i - 1;
+            return AAOS_OK;
+        }
+    }
+    
+    return AAOS_ENOTFOUND;
+}
+
+static int
+__PDU_find_by_channel(const struct __PDU *self, unsigned int channel, size_t *index)
+{
+    size_t i, j, mask = self->p_map.size - 1;
+    
+    for (j = channel & mask; (i = self->p_map.by_channel[j]) != 0; j = (j + 1) & mask) {
+        if (switch_get_channel(self->swicthes[i - 1]) == channel) {
+            *index = i - 1;
+            return AAOS_OK;
+        }
+    }
+    
+    return AAOS_ENOTFOUND;
+}
+
+/*
+ * Cached status.
+ * The snapshot is taken by __pdu_refresh_status, either from a publisher thread
+ * running every p_status.interval seconds, or by a request that finds the snapshot stale.
+ * Concurrent requests share one refresh, so the hardware sees one poll per interval
+ * however many clients there are.
+ */
+
+static double
+__PDU_status_time(void)
+{
+    struct timespec tp;
+    
+    Clock_gettime(CLOCK_REALTIME, &tp);
+    
+    return tp.tv_sec + tp.tv_nsec / 1000000000.;
+}
+
+/*
+ * The status of all channels is read in one transaction where the PDU has a bulk read,
+ * the status method of its virtual table, else switch by switch.
+ * The channels whose status has changed are published on "pdu/" followed by the name of the PDU.
+ */
+static int
+__PDU_refresh_status_nl(struct __PDU *self)
+{
+    size_t i, n = self->n_swicth, n_event = 0;
+    unsigned int channel, max_channel = self->p_map.max_channel;
+    struct __PDUChannel *channels;
+    struct PDUStatusEvent *events;
+    unsigned char *status;
+    char topic[PATH_MAX];
+    Method method = (self->_vtab != NULL) ? virtualTo(self->_vtab, "status") : (Method) 0;
+    int ret = AAOS_OK;
+    
+    if ((channels = (struct __PDUChannel *) Malloc(sizeof(struct __PDUChannel) * (n + 1))) == NULL) {
+        return AAOS_ENOMEM;
+    }
+    if ((status = (unsigned char *) Malloc(max_channel + 1)) == NULL) {
+        free(channels);
+        return AAOS_ENOMEM;
+    }
+    if ((events = (struct PDUStatusEvent *) Malloc(sizeof(struct PDUStatusEvent) * (n + 1))) == NULL) {
+        free(status);
+        free(channels);
+        return AAOS_ENOMEM;
+    }
+    
+    /*
+     * Clear the stale flag before taking the snapshot,
+     * so that a switch turned during the refresh is not lost.
+     */
+    __atomic_store_n(&self->p_status.stale, 0, __ATOMIC_RELAXED);
+    
+    if (method != (Method) 0) {
+        memset(status, SWITCH_STATUS_UNKNOWN, max_channel + 1);
+        ret = ((int (*)(void *, unsigned char *, size_t)) method)(self, status, max_channel);
+    }
+    for (i = 0; i < n; i++) {
+        channels[i].status = SWITCH_STATUS_UNKNOWN;
+        channels[i].voltage = channels[i].current = 0.;
+        if (self->swicthes[i] == NULL) {
+            channels[i].ret = AAOS_ENOTFOUND;
+            continue;
+        }
+        channel = switch_get_channel(self->swicthes[i]);
+        if (method == (Method) 0) {
+            switch_status(self->swicthes[i], &channels[i].status);
+        } else if (ret == AAOS_OK && channel > 0 && channel <= max_channel) {
+            channels[i].status = status[channel - 1];
+        }
+        channels[i].ret = switch_get_voltage_current(self->swicthes[i], &channels[i].voltage, &channels[i].current);
+    }
+    free(status);
+    
+    Pthread_rwlock_wrlock(&self->p_status.rwlock);
+    if (self->p_status.sequence != 0) {
+        for (i = 0; i < n; i++) {
+            if (channels[i].status != self->p_status.channels[i].status && self->swicthes[i] != NULL) {
+                events[n_event].channel = (uint32_t) switch_get_channel(self->swicthes[i]);
+                events[n_event].status = (uint32_t) channels[i].status;
+                n_event++;
+            }
+        }
+    }
+    memcpy(self->p_status.channels, channels, sizeof(struct __PDUChannel) * n);
+    self->p_status.timestamp = __PDU_status_time();
+    __atomic_add_fetch(&self->p_status.sequence, 1, __ATOMIC_RELEASE);
+    Pthread_rwlock_unlock(&self->p_status.rwlock);
+    free(channels);
+    
+    if (n_event > 0 && rpc_has_subscriber()) {
+        snprintf(topic, PATH_MAX, "pdu/%s", self->name == NULL ? "" : self->name);
+        rpc_publish(topic, events, sizeof(struct PDUStatusEvent) * n_event);
+    }
+    free(events);
+    
+    return AAOS_OK;
+}
+
+int
+__pdu_refresh_status(void *_self)
+{
+    const struct __PDUClass *class = (const struct __PDUClass *) classOf(_self);
+    
+    if (isOf(class, __PDUClass()) && class->refresh_status.method) {
+        return ((int (*)(void *)) class->refresh_status.method)(_self);
+    } else {
+        int result;
+        forward(_self, &result, (Method) __pdu_refresh_status, "refresh_status", _self);
+        return result;
+    }
+}
+
+static int
+__PDU_refresh_status(void *_self)
+{
+    struct __PDU *self = cast(__PDU(), _self);
+    int ret;
+    
+    Pthread_mutex_lock(&self->p_status.refresh_mtx);
+    ret = __PDU_refresh_status_nl(self);
+    Pthread_mutex_unlock(&self->p_status.refresh_mtx);
+    
+    return ret;
+}
+
+/*
+ * Refresh in place when a switch has been turned, or when the snapshot is older than twice the interval,
+ * which means there is no publisher thread or it has fallen behind. Requests that find the snapshot
+ * stale together wait for the first one to refresh it.
+ */
+static int
+__PDU_check_status(struct __PDU *self)
+{
+    uint64_t sequence;
+    bool refresh;
+    int ret = AAOS_OK;
+    
+    Pthread_rwlock_rdlock(&self->p_status.rwlock);
+    sequence = self->p_status.sequence;
+    refresh = (sequence == 0 || self->p_status.interval <= 0. || __atomic_load_n(&self->p_status.stale, __ATOMIC_RELAXED) || __PDU_status_time() - self->p_status.timestamp > 2. * self->p_status.interval);
+    Pthread_rwlock_unlock(&self->p_status.rwlock);
+    
+    if (refresh) {
+        Pthread_mutex_lock(&self->p_status.refresh_mtx);
+        if (__atomic_load_n(&self->p_status.sequence, __ATOMIC_ACQUIRE) == sequence) {
+            ret = __PDU_refresh_status_nl(self);
+        }
+        Pthread_mutex_unlock(&self->p_status.refresh_mtx);
+    }
+    
+    return ret;
+}
+
+static int
+__PDU_cached_channel(struct __PDU *self, size_t index, double *voltage, double *current)
+{
+    int ret;
+    
+    if ((ret = __PDU_check_status(self)) != AAOS_OK) {
+        return ret;
+    }
+    
+    Pthread_rwlock_rdlock(&self->p_status.rwlock);
+    if ((ret = self->p_status.channels[index].ret) == AAOS_OK) {
+        if (voltage != NULL) {
+            *voltage = self->p_status.channels[index].voltage;
+        }
+        if (current != NULL) {
+            *current = self->p_status.channels[index].current;
+        }
+    }
+    Pthread_rwlock_unlock(&self->p_status.rwlock);
+    
+    return ret;
+}
+
+double
+__pdu_get_status_interval(const void *_self)
+{
+    const struct __PDUClass *class = (const struct __PDUClass *) classOf(_self);
+    
+    if (isOf(class, __PDUClass()) && class->get_status_interval.method) {
+        return ((double (*)(const void *)) class->get_status_interval.method)(_self);
+    } else {
+        double result;
+        forward(_self, &result, (Method) __pdu_get_status_interval, "get_status_interval", _self);
+        return result;
+    }
+}
+
+static double
+__PDU_get_status_interval(const void *_self)
+{
+    const struct __PDU *self = cast(__PDU(), _self);
+    
+    return self->p_status.interval;
+}
+
+/*
+ * Power sequence.
+ */
+
+static double
+__PDU_monotonic_time(void)
+{
+    struct timespec tp;
+    
+    Clock_gettime(CLOCK_MONOTONIC, &tp);
+    
+    return tp.tv_sec + tp.tv_nsec / 1000000000.;
+}
+
+static void
+__PDU_sleep_until(double deadline)
+{
+    double duration = deadline - __PDU_monotonic_time();
+    
+    if (duration > 0.) {
+        Nanosleep(duration);
+    }
+}
+
+/*
+ * Reads the current until it is in range, at most timeout seconds.
+ */
+static int
+__PDU_verify_current(void *myswitch, const struct PDUSequenceStep *step)
+{
+    double current, deadline = __PDU_monotonic_time() + step->timeout;
+    bool verified;
+    int ret;
+    
+    for (; ;) {
+        if ((ret = switch_get_current(myswitch, &current)) == AAOS_OK) {
+            if (step->action == PDU_SEQUENCE_ON) {
+                verified = (step->min_current <= 0. || current >= step->min_current) && (step->max_current <= 0. || current <= step->max_current);
+            } else {
+                verified = (current < PDU_SEQUENCE_OFF_CURRENT);
+            }
+            if (verified) {
+                return AAOS_OK;
+            }
+        }
+        if (__PDU_monotonic_time() + PDU_SEQUENCE_POLL > deadline) {
+            return (ret == AAOS_OK) ? AAOS_EFAILED : ret;
+        }
+        Nanosleep(PDU_SEQUENCE_POLL);
+    }
+}
+
+int
+__pdu_add_sequence(void *_self, const char *name, const struct PDUSequenceStep *steps, size_t n_step, unsigned int flag)
+{
+    const struct __PDUClass *class = (const struct __PDUClass *) classOf(_self);
+    
+    if (isOf(class, __PDUClass()) && class->add_sequence.method) {
+        return ((int (*)(void *, const char *, const struct PDUSequenceStep *, size_t, unsigned int)) class->add_sequence.method)(_self, name, steps, n_step, flag);
+    } else {
+        int result;
+        forward(_self, &result, (Method) __pdu_add_sequence, "add_sequence", _self, name, steps, n_step, flag);
+        return result;
+    }
+}
+
+/*
+ * The switches are resolved by name when the sequence is added, set the switches first.
+ */
+static int
+__PDU_add_sequence(void *_self, const char *name, const struct PDUSequenceStep *steps, size_t n_step, unsigned int flag)
+{
+    struct __PDU *self = cast(__PDU(), _self);
+    
+    struct __PDUSequence *sequence, *sequences;
+    size_t i;
+    int ret = AAOS_ENOMEM;
+    
+    if (name == NULL || n_step == 0) {
+        return AAOS_EINVAL;
+    }
+    for (i = 0; i < self->p_sequence.n_sequence; i++) {
+        if (strcmp(name, self->p_sequence.sequences[i].name) == 0) {
+            return AAOS_EEXIST;
+        }
+    }
+    
+    if ((sequences = (struct __PDUSequence *) Realloc(self->p_sequence.sequences, sizeof(struct __PDUSequence) * (self->p_sequence.n_sequence + 1))) == NULL) {
+        return AAOS_ENOMEM;
+    }
+    self->p_sequence.sequences = sequences;
+    sequence = sequences + self->p_sequence.n_sequence;
+    memset(sequence, '\0', sizeof(struct __PDUSequence));
+    sequence->steps = (struct PDUSequenceStep *) Malloc(sizeof(struct PDUSequenceStep) * n_step);
+    sequence->switches = (size_t *) Malloc(sizeof(size_t) * n_step);
+    sequence->name = (char *) Malloc(strlen(name) + 1);
+    if (sequence->steps == NULL || sequence->switches == NULL || sequence->name == NULL) {
+        goto error;
+    }
+    memcpy(sequence->steps, steps, sizeof(struct PDUSequenceStep) * n_step);
+    for (i = 0; i < n_step; i++) {
+        if ((steps[i].action != PDU_SEQUENCE_ON && steps[i].action != PDU_SEQUENCE_OFF) || steps[i].name == NULL || __PDU_find_by_name(self, steps[i].name, &sequence->switches[i]) != AAOS_OK) {
+            ret = AAOS_EINVAL;
+            goto error;
+        }
+        sequence->steps[i].name = switch_get_name(self->swicthes[sequence->switches[i]]);
+    }
+    snprintf(sequence->name, strlen(name) + 1, "%s", name);
+    sequence->n_step = n_step;
+    sequence->flag = flag;
+    self->p_sequence.n_sequence++;
+    
+    return AAOS_OK;
+    
+error:
+    free(sequence->steps);
+    free(sequence->switches);
+    free(sequence->name);
+    
+    return ret;
+}
+
+int
+__pdu_run_sequence(void *_self, const char *name, unsigned int *step)
+{
+    const struct __PDUClass *class = (const struct __PDUClass *) classOf(_self);
+    
+    if (isOf(class, __PDUClass()) && class->run_sequence.method) {
+        return ((int (*)(void *, const char *, unsigned int *)) class->run_sequence.method)(_self, name, step);
+    } else {
+        int result;
+        forward(_self, &result, (Method) __pdu_run_sequence, "run_sequence", _self, name, step);
+        return result;
+    }
+}
+
+/*
+ * Runs a sequence as a whole, single switch commands are refused with AAOS_EBUSY meanwhile,
+ * and other sequences wait for it.
+ * On failure, step is the number of the failed step, from 1, otherwise 0.
+ */
+static int
+__PDU_run_sequence(void *_self, const char *name, unsigned int *step)
+{
+    struct __PDU *self = cast(__PDU(), _self);
+    
+    const struct __PDUSequence *sequence = NULL;
+    const struct PDUSequenceStep *s;
+    void *myswitch;
+    unsigned char *prior = NULL;
+    double start, next = 0.;
+    size_t i, j;
+    int ret = AAOS_OK;
+    
+    if (step != NULL) {
+        *step = 0;
+    }
+    for (i = 0; i < self->p_sequence.n_sequence; i++) {
+        if (strcmp(name, self->p_sequence.sequences[i].name) == 0) {
+            sequence = self->p_sequence.sequences + i;
+            break;
+        }
+    }
+    if (sequence == NULL) {
+        return AAOS_ENOTFOUND;
+    }
+    if (sequence->flag & PDU_SEQUENCE_ROLLBACK) {
+        prior = (unsigned char *) Malloc(sequence->n_step);
+    }
+    Pthread_rwlock_wrlock(&self->p_sequence.rwlock);
+    
+    for (i = 0; i < sequence->n_step; i++) {
+        s = sequence->steps + i;
+        myswitch = self->swicthes[sequence->switches[i]];
+        /*
+         * Rollback must not turn off a switch which was on before the sequence came to it.
+         */
+        if (prior != NULL && switch_status(myswitch, prior + i) != AAOS_OK) {
+            prior[i] = SWITCH_STATUS_UNKNOWN;
+        }
+        __PDU_sleep_until(next);
+        start = __PDU_monotonic_time();
+        if (s->action == PDU_SEQUENCE_ON) {
+            ret = switch_turn_on(myswitch);
+            next = start + max(s->delay, s->inrush);
+        } else {
+            ret = switch_turn_off(myswitch);
+            next = start + s->delay;
+        }
+        __atomic_store_n(&self->p_status.stale, 1, __ATOMIC_RELAXED);
+        if (ret == AAOS_OK && s->timeout > 0.) {
+            if (s->action == PDU_SEQUENCE_ON) {
+                __PDU_sleep_until(start + s->inrush);
+            }
+            ret = __PDU_verify_current(myswitch, s);
+        }
+        if (ret != AAOS_OK) {
+            break;
+        }
+    }
+    
+    if (ret != AAOS_OK) {
+        if (step != NULL) {
+            *step = (unsigned int) i + 1;
+        }
+        if (prior != NULL) {
+            for (j = i + 1; j > 0; j--) {
+                if (sequence->steps[j - 1].action == PDU_SEQUENCE_ON && prior[j - 1] != SWITCH_STATUS_ON) {
+                    switch_turn_off(self->swicthes[sequence->switches[j - 1]]);
+                }
+            }
+            __atomic_store_n(&self->p_status.stale, 1, __ATOMIC_RELAXED);
+        }
+    }
+    Pthread_rwlock_unlock(&self->p_sequence.rwlock);
+    free(prior);
+    
+    return ret;
+}
+
 int
 __pdu_get_channel_by_name(const void *_self, const char *name, unsigned int *channel)
 {
@@ -1112,12 +1610,9 @@ __PDU_get_channel_by_name(const void *_self, const char *name, unsigned int *cha
     
     size_t i;
     
-    for (i = 0; i < self->n_swicth; i++) {
-        const char *s = switch_get_name(self->swicthes[i]);
-        if (strcmp(name, s) == 0) {
-            *channel = switch_get_channel(self->swicthes[i]);
-            return AAOS_OK;
-        }
+    if (__PDU_find_by_name(self, name, &i) == AAOS_OK) {
+        *channel = switch_get_channel(self->swicthes[i]);
+        return AAOS_OK;
     }
 
     return AAOS_ENOTFOUND;
@@ -1129,27 +1624,30 @@ __pdu_status(void *_self, unsigned char *status, size_t size)
     const struct __PDUClass *class = (const struct __PDUClass *) classOf(_self);
     
     if (isOf(class, __PDUClass()) && class->status.method) {
-        return ((int (*)(const void *)) class->status.method)(_self);
+        return ((int (*)(void *, unsigned char *, size_t)) class->status.method)(_self, status, size);
     } else {
         int result;
-        forward(_self, &result, (Method) __pdu_status, "status", _self);
+        forward(_self, &result, (Method) __pdu_status, "status", _self, status, size);
         return result;
     }
 }
 
 static int
-__PDU_status(const void *_self, unsigned char *status, size_t size)
+__PDU_status(void *_self, unsigned char *status, size_t size)
 {
-    const struct __PDU *self = cast(__PDU(), _self);
+    struct __PDU *self = cast(__PDU(), _self);
     size_t i, n = min(self->n_swicth, size);
     int ret;
     
+    if ((ret = __PDU_check_status(self)) != AAOS_OK) {
+        return ret;
+    }
+    
+    Pthread_rwlock_rdlock(&self->p_status.rwlock);
     for (i = 0; i < n; i++) {
-        ret = switch_status(self->swicthes[i], status + i);
-        if (ret != AAOS_OK) {
-            return ret;
-        }
+        status[i] = self->p_status.channels[i].status;
     }
+    Pthread_rwlock_unlock(&self->p_status.rwlock);
     
     return AAOS_OK;
 }
@@ -1209,6 +1707,7 @@ __PDU_set_switch(void *_self, const void *myswitch, size_t index)
     
     if (index < self->n_swicth && self->swicthes != NULL) {
         self->swicthes[index] = (void *) myswitch;
+        __PDU_map_build(self);
     }
 }
 
@@ -1289,17 +1788,13 @@ static int
 __PDU_get_current(void *_self, unsigned int channel, double *current)
 {
     struct __PDU *self = cast(__PDU(), _self);
-    size_t i, n = self->n_swicth;
+    size_t i;
     
-    for (i = 0; i < n; i++) {
-        unsigned int switch_channel = switch_get_channel(self->swicthes[i]);
-        if (switch_channel == channel) {
-            return switch_get_current(self->swicthes[i], current);
-            break;
-        }
+    if (__PDU_find_by_channel(self, channel, &i) != AAOS_OK) {
+        return AAOS_ENOTFOUND;
     }
     
-    return AAOS_ENOTFOUND;
+    return __PDU_cached_channel(self, i, NULL, current);
 }
 
 int
@@ -1320,17 +1815,13 @@ static int
 __PDU_get_current_by_name(void *_self, const char *name, double *current)
 {
     struct __PDU *self = cast(__PDU(), _self);
-    size_t i, n = self->n_swicth;
+    size_t i;
     
-    for (i = 0; i < n; i++) {
-        const char *switch_name = switch_get_name(self->swicthes[i]);
-        if (strcmp(name, switch_name) == 0) {
-            return switch_get_current(self->swicthes[i], current);
-            break;
-        }
+    if (__PDU_find_by_name(self, name, &i) != AAOS_OK) {
+        return AAOS_ENOTFOUND;
     }
     
-    return AAOS_ENOTFOUND;
+    return __PDU_cached_channel(self, i, NULL, current);
 }
 
 int
@@ -1351,17 +1842,13 @@ static int
 __PDU_get_voltage(void *_self, unsigned int channel, double *voltage)
 {
     struct __PDU *self = cast(__PDU(), _self);
-    size_t i, n = self->n_swicth;
+    size_t i;
     
-    for (i = 0; i < n; i++) {
-        unsigned int switch_channel = switch_get_channel(self->swicthes[i]);
-        if (switch_channel == channel) {
-            return switch_get_voltage(self->swicthes[i], voltage);
-            break;
-        }
+    if (__PDU_find_by_channel(self, channel, &i) != AAOS_OK) {
+        return AAOS_ENOTFOUND;
     }
     
-    return AAOS_ENOTFOUND;
+    return __PDU_cached_channel(self, i, voltage, NULL);
 }
 
 int
@@ -1382,17 +1869,13 @@ static int
 __PDU_get_voltage_by_name(void *_self, const char *name, double *voltage)
 {
     struct __PDU *self = cast(__PDU(), _self);
-    size_t i, n = self->n_swicth;
+    size_t i;
     
-    for (i = 0; i < n; i++) {
-        const char *switch_name = switch_get_name(self->swicthes[i]);
-        if (strcmp(name, switch_name) == 0) {
-            return switch_get_voltage(self->swicthes[i], voltage);
-            break;
-        }
+    if (__PDU_find_by_name(self, name, &i) != AAOS_OK) {
+        return AAOS_ENOTFOUND;
     }
     
-    return AAOS_ENOTFOUND;
+    return __PDU_cached_channel(self, i, voltage, NULL);
 }
 
 int
@@ -1413,17 +1896,13 @@ static int
 __PDU_get_voltage_current(void *_self, unsigned int channel, double *voltage, double *current)
 {
     struct __PDU *self = cast(__PDU(), _self);
-    size_t i, n = self->n_swicth;
+    size_t i;
     
-    for (i = 0; i < n; i++) {
-        unsigned int switch_channel = switch_get_channel(self->swicthes[i]);
-        if (switch_channel == channel) {
-            return switch_get_voltage_current(self->swicthes[i], voltage, current);
-            break;
-        }
+    if (__PDU_find_by_channel(self, channel, &i) != AAOS_OK) {
+        return AAOS_ENOTFOUND;
     }
     
-    return AAOS_ENOTFOUND;
+    return __PDU_cached_channel(self, i, voltage, current);
 }
 
 int
@@ -1444,17 +1923,13 @@ static int
 __PDU_get_voltage_current_by_name(void *_self, const char *name, double *voltage, double *current)
 {
     struct __PDU *self = cast(__PDU(), _self);
-    size_t i, n = self->n_swicth;
+    size_t i;
     
-    for (i = 0; i < n; i++) {
-        const char *switch_name = switch_get_name(self->swicthes[i]);
-        if (strcmp(name, switch_name) == 0) {
-            return switch_get_voltage_current(self->swicthes[i], voltage, current);
-            break;
-        }
+    if (__PDU_find_by_name(self, name, &i) != AAOS_OK) {
+        return AAOS_ENOTFOUND;
     }
     
-    return AAOS_ENOTFOUND;
+    return __PDU_cached_channel(self, i, voltage, current);
 }
 
 int
@@ -1475,17 +1950,20 @@ static int
 __PDU_turn_on(void *_self, unsigned int channel)
 {
     struct __PDU *self = cast(__PDU(), _self);
-    size_t i, n = self->n_swicth;
+    size_t i;
+    int ret;
     
-    for (i = 0; i < n; i++) {
-        unsigned int switch_channel = switch_get_channel(self->swicthes[i]);
-        if (switch_channel == channel) {
-            return switch_turn_on(self->swicthes[i]);
-            break;
-        }
+    if (__PDU_find_by_channel(self, channel, &i) != AAOS_OK) {
+        return AAOS_ENOTFOUND;
     }
+    if (pthread_rwlock_tryrdlock(&self->p_sequence.rwlock) != 0) {
+        return AAOS_EBUSY;
+    }
+    ret = switch_turn_on(self->swicthes[i]);
+    __atomic_store_n(&self->p_status.stale, 1, __ATOMIC_RELAXED);
+    Pthread_rwlock_unlock(&self->p_sequence.rwlock);
     
-    return AAOS_ENOTFOUND;
+    return ret;
 }
 
 int
@@ -1506,17 +1984,20 @@ static int
 __PDU_turn_on_by_name(void *_self, const char *name)
 {
     struct __PDU *self = cast(__PDU(), _self);
-    size_t i, n = self->n_swicth;
+    size_t i;
+    int ret;
     
-    for (i = 0; i < n; i++) {
-        const char *switch_name = switch_get_name(self->swicthes[i]);
-        if (strcmp(name, switch_name) == 0) {
-            return switch_turn_on(self->swicthes[i]);
-            break;
-        }
+    if (__PDU_find_by_name(self, name, &i) != AAOS_OK) {
+        return AAOS_ENOTFOUND;
+    }
+    if (pthread_rwlock_tryrdlock(&self->p_sequence.rwlock) != 0) {
+        return AAOS_EBUSY;
     }
+    ret = switch_turn_on(self->swicthes[i]);
+    __atomic_store_n(&self->p_status.stale, 1, __ATOMIC_RELAXED);
+    Pthread_rwlock_unlock(&self->p_sequence.rwlock);
     
-    return AAOS_ENOTFOUND;
+    return ret;
 }
 
 int
@@ -1537,17 +2018,20 @@ static int
 __PDU_turn_off(void *_self, unsigned int channel)
 {
     struct __PDU *self = cast(__PDU(), _self);
-    size_t i, n = self->n_swicth;
+    size_t i;
+    int ret;
     
-    for (i = 0; i < n; i++) {
-        unsigned int switch_channel = switch_get_channel(self->swicthes[i]);
-        if (switch_channel == channel) {
-            return switch_turn_off(self->swicthes[i]);
-            break;
-        }
+    if (__PDU_find_by_channel(self, channel, &i) != AAOS_OK) {
+        return AAOS_ENOTFOUND;
+    }
+    if (pthread_rwlock_tryrdlock(&self->p_sequence.rwlock) != 0) {
+        return AAOS_EBUSY;
     }
+    ret = switch_turn_off(self->swicthes[i]);
+    __atomic_store_n(&self->p_status.stale, 1, __ATOMIC_RELAXED);
+    Pthread_rwlock_unlock(&self->p_sequence.rwlock);
     
-    return AAOS_ENOTFOUND;
+    return ret;
 }
 
 int
@@ -1568,17 +2052,20 @@ static int
 __PDU_turn_off_by_name(void *_self, const char *name)
 {
     struct __PDU *self = cast(__PDU(), _self);
-    size_t i, n = self->n_swicth;
+    size_t i;
+    int ret;
     
-    for (i = 0; i < n; i++) {
-        const char *switch_name = switch_get_name(self->swicthes[i]);
-        if (strcmp(name, switch_name) == 0) {
-            return switch_turn_off(self->swicthes[i]);
-            break;
-        }
+    if (__PDU_find_by_name(self, name, &i) != AAOS_OK) {
+        return AAOS_ENOTFOUND;
+    }
+    if (pthread_rwlock_tryrdlock(&self->p_sequence.rwlock) != 0) {
+        return AAOS_EBUSY;
     }
+    ret = switch_turn_off(self->swicthes[i]);
+    __atomic_store_n(&self->p_status.stale, 1, __ATOMIC_RELAXED);
+    Pthread_rwlock_unlock(&self->p_sequence.rwlock);
     
-    return AAOS_ENOTFOUND;
+    return ret;
 }
 
 static void
@@ -1638,6 +2125,20 @@ __PDU_forward(const void *_self, void *result, Method selector, const char *name
         unsigned char *status = va_arg(*app, unsigned char *);
         size_t size = va_arg(*app, size_t);
         *((int *) result) = ((int (*)(void *, unsigned char *, size_t)) method)(obj, status, size);
+    } else if (selector == (Method) __pdu_refresh_status) {
+        *((int *) result) = ((int (*)(void *)) method)(obj);
+    } else if (selector == (Method) __pdu_get_status_interval) {
+        *((double *) result) = ((double (*)(const void *)) method)(obj);
+    } else if (selector == (Method) __pdu_add_sequence) {
+        const char *name = va_arg(*app, const char *);
+        const struct PDUSequenceStep *steps = va_arg(*app, const struct PDUSequenceStep *);
+        size_t n_step = va_arg(*app, size_t);
+        unsigned int flag = va_arg(*app, unsigned int);
+        *((int *) result) = ((int (*)(void *, const char *, const struct PDUSequenceStep *, size_t, unsigned int)) method)(obj, name, steps, n_step, flag);
+    } else if (selector == (Method) __pdu_run_sequence) {
+        const char *name = va_arg(*app, const char *);
+        unsigned int *step = va_arg(*app, unsigned int *);
+        *((int *) result) = ((int (*)(void *, const char *, unsigned int *)) method)(obj, name, step);
     } else {
         assert(0);
     }
@@ -1675,6 +2176,29 @@ __PDU_ctor(void *_self, va_list *app)
         free(self->switch_status);
         return NULL;
     }
+    memset(self->swicthes, '\0', sizeof(void *) * n_switch);
+    
+    self->p_map.size = 8;
+    while (self->p_map.size < 2 * n_switch) {
+        self->p_map.size <<= 1;
+    }
+    self->p_map.by_name = (size_t *) Malloc(sizeof(size_t) * self->p_map.size);
+    self->p_map.by_channel = (size_t *) Malloc(sizeof(size_t) * self->p_map.size);
+    self->p_status.channels = (struct __PDUChannel *) Malloc(sizeof(struct __PDUChannel) * (n_switch + 1));
+    if (self->p_map.by_name == NULL || self->p_map.by_channel == NULL || self->p_status.channels == NULL) {
+        free(self->p_map.by_name);
+        free(self->p_map.by_channel);
+        free(self->p_status.channels);
+        free(self->name);
+        free(self->switch_status);
+        free(self->swicthes);
+        return NULL;
+    }
+    __PDU_map_build(self);
+    self->p_status.interval = PDU_STATUS_INTERVAL;
+    Pthread_rwlock_init(&self->p_status.rwlock, NULL);
+    Pthread_mutex_init(&self->p_status.refresh_mtx, NULL);
+    Pthread_rwlock_init(&self->p_sequence.rwlock, NULL);
     
     while ((key = va_arg(*app, const char *))) {
         if (strcmp(key, "description") == 0) {
@@ -1693,6 +2217,10 @@ __PDU_ctor(void *_self, va_list *app)
             }
             continue;
         }
+        if (strcmp(key, "status_interval") == 0) {
+            self->p_status.interval = va_arg(*app, double);
+            continue;
+        }
     }
     
     return (void *) self;
@@ -1711,6 +2239,18 @@ __PDU_dtor(void *_self)
         }
     }
     
+    for (i = 0; i < self->p_sequence.n_sequence; i++) {
+        free(self->p_sequence.sequences[i].name);
+        free(self->p_sequence.sequences[i].steps);
+        free(self->p_sequence.sequences[i].switches);
+    }
+    free(self->p_sequence.sequences);
+    Pthread_rwlock_destroy(&self->p_sequence.rwlock);
+    Pthread_mutex_destroy(&self->p_status.refresh_mtx);
+    Pthread_rwlock_destroy(&self->p_status.rwlock);
+    free(self->p_status.channels);
+    free(self->p_map.by_name);
+    free(self->p_map.by_channel);
     free(self->swicthes);
     free(self->switch_status);
     free(self->name);
@@ -1745,6 +2285,38 @@ __PDUClass_ctor(void *_self, va_list *app)
             self->turn_on.method = method;
             continue;
         }
+        if (selector == (Method) __pdu_turn_off) {
+            if (tag) {
+                self->turn_off.tag = tag;
+                self->turn_off.selector = selector;
+            }
+            self->turn_off.method = method;
+            continue;
+        }
+        if (selector == (Method) __pdu_get_voltage) {
+            if (tag) {
+                self->get_voltage.tag = tag;
+                self->get_voltage.selector = selector;
+            }
+            self->get_voltage.method = method;
+            continue;
+        }
+        if (selector == (Method) __pdu_get_current) {
+            if (tag) {
+                self->get_current.tag = tag;
+                self->get_current.selector = selector;
+            }
+            self->get_current.method = method;
+            continue;
+        }
+        if (selector == (Method) __pdu_get_voltage_current) {
+            if (tag) {
+                self->get_voltage_current.tag = tag;
+                self->get_voltage_current.selector = selector;
+            }
+            self->get_voltage_current.method = method;
+            continue;
+        }
         if (selector == (Method) __pdu_turn_on_by_name) {
             if (tag) {
                 self->turn_on_by_name.tag = tag;
@@ -1841,6 +2413,38 @@ __PDUClass_ctor(void *_self, va_list *app)
             self->set_switch.method = method;
             continue;
         }
+        if (selector == (Method) __pdu_refresh_status) {
+            if (tag) {
+                self->refresh_status.tag = tag;
+                self->refresh_status.selector = selector;
+            }
+            self->refresh_status.method = method;
+            continue;
+        }
+        if (selector == (Method) __pdu_get_status_interval) {
+            if (tag) {
+                self->get_status_interval.tag = tag;
+                self->get_status_interval.selector = selector;
+            }
+            self->get_status_interval.method = method;
+            continue;
+        }
+        if (selector == (Method) __pdu_add_sequence) {
+            if (tag) {
+                self->add_sequence.tag = tag;
+                self->add_sequence.selector = selector;
+            }
+            self->add_sequence.method = method;
+            continue;
+        }
+        if (selector == (Method) __pdu_run_sequence) {
+            if (tag) {
+                self->run_sequence.tag = tag;
+                self->run_sequence.selector = selector;
+            }
+            self->run_sequence.method = method;
+            continue;
+        }
         
     }
     
@@ -1913,7 +2517,10 @@ __PDU_initialize(void)
                  __pdu_get_voltage_current, "get_voltage_current", __PDU_get_voltage_current,
                  __pdu_get_voltage_current_by_name, "get_voltage_current_by_name", __PDU_get_voltage_current_by_name,
                  __pdu_get_channel_by_name, "get_channel_by_name", __PDU_get_channel_by_name,
-                 
+                 __pdu_refresh_status, "refresh_status", __PDU_refresh_status,
+                 __pdu_get_status_interval, "get_status_interval", __PDU_get_status_interval,
+                 __pdu_add_sequence, "add_sequence", __PDU_add_sequence,
+                 __pdu_run_sequence, "run_sequence", __PDU_run_sequence,
                  (void *) 0);
 #ifndef _USE_COMPILER_ATTRIBUTION_
     atexit(__PDU_destroy);
@@ -2034,7 +2641,9 @@ AAGPDUClass_ctor(void *_self, va_list *app)
 {
     struct AAGPDUClass *self = super_ctor(AAGPDUClass(), _self, app);
     
-    self->_.status.method = (Method) 0;
+    /*
+     * The status is answered from the snapshot of __PDU, which takes it by AAGPDU_status in one transaction.
+     */
     self->_._.inspect.method = (Method) 0;
     
     return self;
@@ -2081,7 +2690,7 @@ AAGPDU_destroy(void)
 static void
 AAGPDU_initialize(void)
 {
-    _AAGPDU = new(AAGPDUClass(), "AAGPDU", AAGPDU(), sizeof(struct AAGPDU),
+    _AAGPDU = new(AAGPDUClass(), "AAGPDU", __PDU(), sizeof(struct AAGPDU),
                      ctor, "ctor", AAGPDU_ctor,
                      dtor, "dtor", AAGPDU_dtor,
                      (void *) 0);
@@ -2136,7 +2745,8 @@ AAGPDU_status(void *_self, unsigned char *status, size_t size)
     if ((ret1 = serial_raw(serial, "BR\n", 3, res, COMMANDSIZE, NULL)) != AAOS_OK) {
         if (ret1 < 0) {
             AAGPDU_try_connect(self);
-            if ((ret1 = serial_raw(serial, "BR\n", 3, res, COMMANDSIZE, NULL)) != AAOS_OK) {
+            serial = self->serial;
+            if ((ret1 = serial_raw(serial, "BR\n", 3, res, COMMANDSIZE, NULL)) == AAOS_OK) {
                 ret = AAOS_OK;
                 goto error;
             }
@@ -2144,6 +2754,8 @@ AAGPDU_status(void *_self, unsigned char *status, size_t size)
         protobuf_set(serial, PACKET_INDEX, idx2);
         ret2 = serial_raw(serial, "BR\n", 3, res, COMMANDSIZE, NULL);
         ret = ret2;
+    } else {
+        ret = AAOS_OK;
     }
     
 error:
@@ -2157,31 +2769,20 @@ error:
             sscanf(s, "%x", &mystatus);
         }
         
-        size_t i, n = min(size, AAGPDU_CHANNEL_NUMBER);
+        /*
+         * Bit i is channel i + 1, with the wrong wiring, the channels of a pair are swapped, as in AAGSwitch_turn_on.
+         */
+        size_t i, bit, n = min(size, AAGPDU_CHANNEL_NUMBER);
         for (i = 0; i < n; i++) {
             if (self->flag) {
-                if (i%2) {
-                    if (mystatus&1>>(i + 1)) {
-                        status[i] = SWITCH_STATUS_ON;
-                    } else {
-                        status[i] = SWITCH_STATUS_OFF;
-                    }
-                } else {
-                    if (mystatus&1>>(i - 1)) {
-                        status[i] = SWITCH_STATUS_ON;
-                    } else {
-                        status[i] = SWITCH_STATUS_OFF;
-                    }
-                }
-                if (mystatus&1>>i) {
-                    status[i] = SWITCH_STATUS_ON;
-                }
+                bit = (i%2) ? i - 1 : i + 1;
             } else {
-                if (mystatus&1>>i) {
-                    status[i] = SWITCH_STATUS_ON;
-                } else {
-                    status[i] = SWITCH_STATUS_OFF;
-                }
+                bit = i;
+            }
+            if (mystatus & (1U << bit)) {
+                status[i] = SWITCH_STATUS_ON;
+            } else {
+                status[i] = SWITCH_STATUS_OFF;
             }
         }
     } else if (ret < 0) {
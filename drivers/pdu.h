@@ -9,12 +9,15 @@
 #ifndef pdu_h
 #define pdu_h
 
+#include <stdint.h>
 #include <string.h>
 
 #define SWITCH_STATUS_ON        0
 #define SWITCH_STATUS_OFF       1
 #define SWITCH_STATUS_UNKNOWN   2
 
+struct PDUSequenceStep;
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -59,6 +62,10 @@ int __pdu_get_current_by_name(void *_self, const char *name, double *current);
 int __pdu_get_voltage_by_name(void *_self, const char *name, double *voltage);
 int __pdu_get_voltage_current_by_name(void *_self, const char *name, double *voltage, double *current);
 int __pdu_get_channel_by_name(const void *_self, const char *name, unsigned int *channel);
+int __pdu_refresh_status(void *_self);
+double __pdu_get_status_interval(const void *_self);
+int __pdu_add_sequence(void *_self, const char *name, const struct PDUSequenceStep *steps, size_t n_step, unsigned int flag);
+int __pdu_run_sequence(void *_self, const char *name, unsigned int *step);
 
 extern const void *__PDUVirtualTable(void);
 extern const void *__PDU(void);
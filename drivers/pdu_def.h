@@ -9,6 +9,49 @@
 #ifndef pdu_def_h
 #define pdu_def_h
 
+#include <stdint.h>
+
 #define PDU_TYPE_AAGPDU 1
 
+#define PDU_STATUS_INTERVAL     1.
+
+/*
+ * Event published on "pdu/" followed by the name of the PDU, one for each channel whose status has changed.
+ */
+struct PDUStatusEvent {
+    uint32_t channel;
+    uint32_t status;        /* SWITCH_STATUS_ON, SWITCH_STATUS_OFF or SWITCH_STATUS_UNKNOWN */
+};
+
+/*
+ * Power sequence.
+ *
+ * A sequence turns named switches on or off, one step after the other, on the PDU server.
+ * A step starts delay seconds after the previous one, but never before the inrush of a switch turned on
+ * by the previous step is over, so that inrush currents never overlap. If timeout is positive,
+ * the step is verified by reading the current of the switch, after the inrush, for at most timeout seconds:
+ * between min_current and max_current, where positive, for a switch turned on,
+ * below PDU_SEQUENCE_OFF_CURRENT for a switch turned off.
+ * On failure, the sequence stops, and with PDU_SEQUENCE_ROLLBACK, the switches it has turned on
+ * are turned off in reverse order, except those which were already on before their step.
+ */
+
+#define PDU_SEQUENCE_ON             1
+#define PDU_SEQUENCE_OFF            2
+
+#define PDU_SEQUENCE_ROLLBACK       0x01
+
+#define PDU_SEQUENCE_POLL           0.2
+#define PDU_SEQUENCE_OFF_CURRENT    0.02
+
+struct PDUSequenceStep {
+    const char *name;       /* switch */
+    unsigned int action;
+    double delay;           /* second */
+    double inrush;          /* second */
+    double min_current;     /* ampere */
+    double max_current;
+    double timeout;         /* second */
+};
+
 #endif /* pdu_def_h */
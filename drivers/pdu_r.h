@@ -10,9 +10,11 @@
 #define pdu_r_h
 
 #include "device_r.h"
+#include "pdu_def.h"
 #include "object_r.h"
 #include "virtual_r.h"
 #include <pthread.h>
+#include <stdint.h>
 
 #define _PDU_PRIORITY_  _VIRTUAL_PRIORITY_ + 1
 
@@ -71,6 +73,55 @@ struct __PDUVirtualTable {
     struct Method get_voltage_current;
 };
 
+struct __PDUChannel {
+    unsigned char status;
+    int ret;                /* of the last voltage and current read */
+    double voltage;
+    double current;
+};
+
+/*
+ * Snapshot of all channels, indexed as the switches, refreshed at most every interval seconds,
+ * or as soon as a switch is turned on or off.
+ */
+struct __PDUStatusCache {
+    double interval;
+    double timestamp;
+    unsigned int stale;
+    uint64_t sequence;
+    struct __PDUChannel *channels;
+    pthread_rwlock_t rwlock;
+    pthread_mutex_t refresh_mtx;
+};
+
+/*
+ * Open addressing tables, from the name or the channel of a switch to its index plus one.
+ */
+struct __PDUSwitchMap {
+    size_t size;
+    size_t *by_name;
+    size_t *by_channel;
+    unsigned int max_channel;
+};
+
+struct __PDUSequence {
+    char *name;
+    unsigned int flag;
+    size_t n_step;
+    struct PDUSequenceStep *steps;
+    size_t *switches;       /* index of the switch of each step */
+};
+
+/*
+ * A sequence holds the lock for writing while it runs, single switch commands for reading,
+ * so that they do not exclude each other.
+ */
+struct __PDUSequenceSet {
+    size_t n_sequence;
+    struct __PDUSequence *sequences;
+    pthread_rwlock_t rwlock;
+};
+
 struct __PDU {
     struct Device _;
     const void *_vtab;
@@ -80,6 +131,9 @@ struct __PDU {
     void **swicthes;
     unsigned char *switch_status;
     size_t n_swicth;
+    struct __PDUStatusCache p_status;
+    struct __PDUSwitchMap p_map;
+    struct __PDUSequenceSet p_sequence;
 };
 
 struct __PDUClass {
@@ -102,6 +156,10 @@ struct __PDUClass {
     struct Method get_current_by_name;
     struct Method get_voltage_current_by_name;
     struct Method get_channel_by_name;
+    struct Method refresh_status;
+    struct Method get_status_interval;
+    struct Method add_sequence;
+    struct Method run_sequence;
 };
 
 #define AAGPDU_CHANNEL_NUMBER 32
@@ -12,6 +12,9 @@
 #include "pdu_rpc_r.h"
 #include "wrapper.h"
 
+void **pdus;
+size_t n_pdu;
+
 static int
 get_index_by_name(const char *name, int *index)
 {
@@ -356,6 +359,64 @@ PDU_status(void *_self, double *status, size_t size)
     return AAOS_OK;
 }
 
+int
+pdu_run_sequence(void *_self, const char *name, unsigned int *step)
+{
+    const struct PDUClass *class = (const struct PDUClass *) classOf(_self);
+    
+    if (isOf(class, PDUClass()) && class->run_sequence.method) {
+        return ((int (*)(void *, const char *, unsigned int *)) class->run_sequence.method)(_self, name, step);
+    } else {
+        int result;
+        forward(_self, &result, (Method) pdu_run_sequence, "run_sequence", _self, name, step);
+        return result;
+    }
+}
+
+/*
+ * The whole sequence runs on the server, the call returns when it is done.
+ * On failure, step is the number of the failed step, from 1.
+ */
+static int
+PDU_run_sequence(void *_self, const char *name, unsigned int *step)
+{
+    struct PDU *self = cast(PDU(), _self);
+    
+    size_t length;
+    uint32_t failed;
+    int ret;
+    
+    protobuf_set(self, PACKET_PROTOCOL, PROTO_PDU);
+    protobuf_set(self, PACKET_COMMAND, PDU_COMMAND_RUN_SEQUENCE);
+    
+    length = strlen(name);
+    if (length < PACKETPARAMETERSIZE) {
+        char *s;
+        protobuf_get(self, PACKET_STR, &s);
+        if (s != name) {
+            snprintf(s, PACKETPARAMETERSIZE, "%s", name);
+        }
+        protobuf_set(self, PACKET_LENGTH, 0);
+    } else {
+        char *buf;
+        protobuf_get(self, PACKET_BUF, &buf, NULL);
+        if (name != buf) {
+            protobuf_set(self, PACKET_BUF, name, length + 1);
+        }
+        uint32_t len = (uint32_t) length + 1;
+        protobuf_set(self, PACKET_LENGTH, len);
+    }
+    
+    ret = rpc_call(self);
+    
+    if (step != NULL) {
+        protobuf_get(self, PACKET_U32F0, &failed);
+        *step = (ret == AAOS_OK) ? 0 : failed;
+    }
+    
+    return ret;
+}
+
 static int
 PDU_execute_get_index_by_name(struct PDU *self)
 {
@@ -557,6 +618,37 @@ PDU_execute_status(struct PDU *self)
     return AAOS_OK;
 }
 
+static int
+PDU_execute_run_sequence(struct PDU *self)
+{
+    void *pdu;
+    char *name;
+    uint16_t index;
+    uint32_t length, failed;
+    unsigned int step;
+    int ret;
+    
+    protobuf_get(self, PACKET_LENGTH, &length);
+    protobuf_get(self, PACKET_INDEX, &index);
+    
+    if (length == 0) {
+        protobuf_get(self, PACKET_STR, &name);
+    } else {
+        protobuf_get(self, PACKET_BUF, &name, NULL);
+    }
+    
+    if ((pdu = get_pdu_by_index(index)) == NULL) {
+        return AAOS_ENOTFOUND;
+    }
+    
+    ret = __pdu_run_sequence(pdu, name, &step);
+    failed = step;
+    protobuf_set(self, PACKET_U32F0, failed);
+    protobuf_set(self, PACKET_LENGTH, 0);
+    
+    return ret;
+}
+
 static int
 PDU_execute_default(struct PDU *self)
 {
@@ -601,6 +693,9 @@ PDU_execute(void *_self)
         case PDU_COMMAND_STATUS:
             ret = PDU_execute_status(self);
             break;
+        case PDU_COMMAND_RUN_SEQUENCE:
+            ret = PDU_execute_run_sequence(self);
+            break;
         default:
             return ret = PDU_execute_default(self);
             break;
@@ -712,6 +807,14 @@ PDUClass_ctor(void *_self, va_list *app)
             self->status.method = method;
             continue;
         }
+        if (selector == (Method) pdu_run_sequence) {
+            if (tag) {
+                self->run_sequence.tag = tag;
+                self->run_sequence.selector = selector;
+            }
+            self->run_sequence.method = method;
+            continue;
+        }
     }
     
 #ifdef va_copy
@@ -775,6 +878,7 @@ PDU_initialize(void)
                pdu_get_current, "get_current", PDU_get_current,
                pdu_get_voltage_current, "get_voltage_current", PDU_get_voltage_current,
                pdu_status, "status", PDU_status,
+               pdu_run_sequence, "run_sequence", PDU_run_sequence,
                (void *) 0);
     
 #ifndef _USE_COMPILER_ATTRIBUTION_
@@ -999,10 +1103,9 @@ PDUServer_accept(void *_self, void **client)
 {
     struct RPCServer *self = cast(RPCServer(), _self);
     
-    int lfd, cfd;
+    int cfd;
     
-    lfd = tcp_server_get_lfd(self);
-    cfd = Accept(lfd, NULL, NULL);
+    cfd = rpc_server_accept_fd(self, TCPSERVER_OPTION_TCP);
     if (cfd < 0) {
         *client = NULL;
         return AAOS_ERROR;
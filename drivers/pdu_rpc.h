@@ -17,12 +17,13 @@
 #define PDU_COMMAND_GET_CURRENT             4
 #define PDU_COMMAND_GET_VOLTAGE_CURRENT     5
 #define PDU_COMMAND_STATUS                  6
+#define PDU_COMMAND_RUN_SEQUENCE            7
 
 #define PDU_COMMAND_GET_INDEX_BY_NAME       23
 #define PDU_COMMAND_GET_CHANNEL_BY_NAME     24
 
-void **pdus;
-size_t n_pdu;
+extern void **pdus;
+extern size_t n_pdu;
 
 #ifdef __cplusplus
 extern "C" {
@@ -34,6 +35,7 @@ int pdu_get_current(void *_self, double *current);
 int pdu_get_voltage(void *_self, double *voltage);
 int pdu_get_voltage_current(void *_self, double *voltage, double *current);
 int pdu_status(void *_self, unsigned char *status, size_t size);
+int pdu_run_sequence(void *_self, const char *name, unsigned int *step);
 
 int pdu_turn_on_by_channle(void *_self, unsigned int channel);
 int pdu_turn_off_by_channle(void *_self, unsigned int channel);
@@ -27,6 +27,7 @@ struct PDUClass {
     struct Method status;
     struct Method turn_on;
     struct Method turn_off;
+    struct Method run_sequence;
 };
 
 struct PDUClient {
@@ -0,0 +1,216 @@
+//
+//  rtd.c
+//  AAOS
+//
+
+#include <math.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "def.h"
+#include "rtd.h"
+#include "wrapper.h"
+
+#define RTD_NEWTON_MAX_ITERATION    64
+#define RTD_NEWTON_TOLERANCE        1e-12
+
+double
+rtd_cvd_t2r(double r0, double a, double b, double c, double temperature)
+{
+    double t = temperature;
+    
+    if (t >= 0.) {
+        return r0 * (1. + t * (a + t * b));
+    } else {
+        return r0 * (1. + t * (a + t * (b + c * (t - 100.) * t)));
+    }
+}
+
+static double
+rtd_cvd_derivative(double r0, double a, double b, double c, double temperature)
+{
+    double t = temperature;
+    
+    if (t >= 0.) {
+        return r0 * (a + 2. * b * t);
+    } else {
+        return r0 * (a + 2. * b * t + c * t * t * (4. * t - 300.));
+    }
+}
+
+/*
+ * Exact inversion of Callendar-Van Dusen equation, by Newton's method.
+ */
+double
+rtd_cvd_r2t(double r0, double a, double b, double c, double resistance)
+{
+    double t, dt;
+    int i;
+    
+    t = (resistance / r0 - 1.) / a;
+    for (i = 0; i < RTD_NEWTON_MAX_ITERATION; i++) {
+        dt = (rtd_cvd_t2r(r0, a, b, c, t) - resistance) / rtd_cvd_derivative(r0, a, b, c, t);
+        t -= dt;
+        if (fabs(dt) < RTD_NEWTON_TOLERANCE) {
+            break;
+        }
+    }
+    
+    return t;
+}
+
+static double
+rtd_table_eval(const struct RTDTable *table, size_t i, double u)
+{
+    double t0 = table->temperature[i], t1 = table->temperature[i + 1];
+    
+    if (table->interpolation == RTD_INTERPOLATION_CUBIC) {
+        /*
+         * Cubic Hermite interpolation with exact node slopes.
+         */
+        double u2 = u * u, u3 = u2 * u;
+        double h00 = 2. * u3 - 3. * u2 + 1., h10 = u3 - 2. * u2 + u;
+        double h01 = -2. * u3 + 3. * u2, h11 = u3 - u2;
+    
+        return h00 * t0 + h10 * table->step * table->slope[i] + h01 * t1 + h11 * table->step * table->slope[i + 1];
+    } else {
+        return t0 + u * (t1 - t0);
+    }
+}
+
+int
+rtd_table_init(struct RTDTable *table, double r0, double a, double b, double c, double t_min, double t_max, size_t n, int interpolation)
+{
+    static const double sample[] = {0.125, 0.25, 0.375, 0.5, 0.625, 0.75, 0.875};
+    size_t i, j;
+    double r, t, e;
+    
+    if (n < 2 || !(r0 > 0.) || !(t_max > t_min)) {
+        return AAOS_EINVAL;
+    }
+    if (interpolation != RTD_INTERPOLATION_LINEAR && interpolation != RTD_INTERPOLATION_CUBIC) {
+        return AAOS_EINVAL;
+    }
+    
+    memset(table, '\0', sizeof(struct RTDTable));
+    table->r0 = r0;
+    table->a = a;
+    table->b = b;
+    table->c = c;
+    table->r_min = rtd_cvd_t2r(r0, a, b, c, t_min);
+    table->r_max = rtd_cvd_t2r(r0, a, b, c, t_max);
+    if (!(table->r_max > table->r_min)) {
+        return AAOS_EINVAL;
+    }
+    table->n = n;
+    table->interpolation = interpolation;
+    table->step = (table->r_max - table->r_min) / (n - 1);
+    table->inv_step = 1. / table->step;
+    table->temperature = (double *) Malloc(sizeof(double) * n);
+    table->slope = (double *) Malloc(sizeof(double) * n);
+    
+    for (i = 0; i < n; i++) {
+        r = (i == n - 1) ? table->r_max : table->r_min + i * table->step;
+        t = rtd_cvd_r2t(r0, a, b, c, r);
+        table->temperature[i] = t;
+        table->slope[i] = 1. / rtd_cvd_derivative(r0, a, b, c, t);
+    }
+    
+    /*
+     * Measure the accuracy bound inside every interval.
+     */
+    for (i = 0; i < n - 1; i++) {
+        for (j = 0; j < sizeof(sample) / sizeof(double); j++) {
+            r = table->r_min + (i + sample[j]) * table->step;
+            e = fabs(rtd_table_eval(table, i, sample[j]) - rtd_cvd_r2t(r0, a, b, c, r));
+            if (e > table->bound) {
+                table->bound = e;
+            }
+        }
+    }
+    
+    return AAOS_OK;
+}
+
+void
+rtd_table_destroy(struct RTDTable *table)
+{
+    free(table->temperature);
+    free(table->slope);
+    memset(table, '\0', sizeof(struct RTDTable));
+}
+
+double
+rtd_r2t(const struct RTDTable *table, double resistance)
+{
+    double x;
+    size_t i;
+    
+    if (table->n < 2 || !(resistance >= table->r_min && resistance <= table->r_max)) {
+        return RTD_INVALID;
+    }
+    
+    x = (resistance - table->r_min) * table->inv_step;
+    i = (size_t) x;
+    if (i > table->n - 2) {
+        i = table->n - 2;
+    }
+    
+    return rtd_table_eval(table, i, x - i);
+}
+
+double
+rtd_t2r(const struct RTDTable *table, double temperature)
+{
+    return rtd_cvd_t2r(table->r0, table->a, table->b, table->c, temperature);
+}
+
+static struct RTDTable rtd_pt100_table;
+static struct RTDTable rtd_pt1000_table;
+
+static void
+rtd_pt100_destroy(void)
+{
+    rtd_table_destroy(&rtd_pt100_table);
+}
+
+static void
+rtd_pt100_initialize(void)
+{
+    if (rtd_table_init(&rtd_pt100_table, 100., RTD_IEC60751_A, RTD_IEC60751_B, RTD_IEC60751_C, RTD_T_MIN, RTD_T_MAX, RTD_TABLE_SIZE, RTD_INTERPOLATION_CUBIC) == AAOS_OK) {
+        atexit(rtd_pt100_destroy);
+    }
+}
+
+const struct RTDTable *
+rtd_pt100(void)
+{
+    static pthread_once_t once_control = PTHREAD_ONCE_INIT;
+    Pthread_once(&once_control, rtd_pt100_initialize);
+    
+    return &rtd_pt100_table;
+}
+
+static void
+rtd_pt1000_destroy(void)
+{
+    rtd_table_destroy(&rtd_pt1000_table);
+}
+
+static void
+rtd_pt1000_initialize(void)
+{
+    if (rtd_table_init(&rtd_pt1000_table, 1000., RTD_IEC60751_A, RTD_IEC60751_B, RTD_IEC60751_C, RTD_T_MIN, RTD_T_MAX, RTD_TABLE_SIZE, RTD_INTERPOLATION_CUBIC) == AAOS_OK) {
+        atexit(rtd_pt1000_destroy);
+    }
+}
+
+const struct RTDTable *
+rtd_pt1000(void)
+{
+    static pthread_once_t once_control = PTHREAD_ONCE_INIT;
+    Pthread_once(&once_control, rtd_pt1000_initialize);
+    
+    return &rtd_pt1000_table;
+}
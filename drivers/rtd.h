@@ -0,0 +1,77 @@
+//
+//  rtd.h
+//  AAOS
+//
+
+#ifndef rtd_h
+#define rtd_h
+
+#include <stddef.h>
+
+/*
+ * Resistance-to-temperature conversion of platinum RTDs.
+ *
+ * A table is built once from the Callendar-Van Dusen equation
+ *     R(T) = R0 * (1 + A*T + B*T^2 + C*(T-100)*T^3),  C = 0 for T >= 0,
+ * sampled on a uniform resistance grid, and is never modified afterwards,
+ * so rtd_r2t() can be called from any thread without locking.
+ *
+ * The accuracy bound of a table is measured against the exact inversion of
+ * the equation when the table is built, and is kept in the table.
+ * With RTD_TABLE_SIZE nodes over RTD_T_MIN .. RTD_T_MAX, the bound is
+ * below 1e-9 degree Celsius with cubic correction and below 1e-5 with linear correction.
+ */
+
+#define RTD_IEC60751_A  3.9083e-3
+#define RTD_IEC60751_B  -5.775e-7
+#define RTD_IEC60751_C  -4.183e-12
+
+#define RTD_T_MIN       -200.
+#define RTD_T_MAX       850.
+#define RTD_TABLE_SIZE  4096
+
+#define RTD_INTERPOLATION_LINEAR    1
+#define RTD_INTERPOLATION_CUBIC     2
+
+/*
+ * Returned when the resistance is outside the range of the table.
+ */
+#define RTD_INVALID     9999.
+
+struct RTDTable {
+    double r0;
+    double a;
+    double b;
+    double c;
+    double r_min;
+    double r_max;
+    double step;
+    double inv_step;
+    size_t n;
+    int interpolation;
+    double *temperature;
+    double *slope;          /* dT/dR at each node */
+    double bound;           /* maximum absolute error, in degree Celsius */
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int rtd_table_init(struct RTDTable *table, double r0, double a, double b, double c, double t_min, double t_max, size_t n, int interpolation);
+void rtd_table_destroy(struct RTDTable *table);
+
+double rtd_r2t(const struct RTDTable *table, double resistance);
+double rtd_t2r(const struct RTDTable *table, double temperature);
+
+double rtd_cvd_t2r(double r0, double a, double b, double c, double temperature);
+double rtd_cvd_r2t(double r0, double a, double b, double c, double resistance);
+
+const struct RTDTable *rtd_pt100(void);
+const struct RTDTable *rtd_pt1000(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* rtd_h */
@@ -13,6 +13,7 @@
 #include "scheduler.h"
 #include "scheduler_r.h"
 #include "scheduler_rpc.h"
+#include "simulator.h"
 #include "utils.h"
 #include "wrapper.h"
 
@@ -1377,7 +1378,7 @@ __Scheduler_pop_task_block(void *_self)
                             fprintf(stderr, "%s %s %d: execution `%s` failed.\n", __FILE__, __func__, __LINE__, self->algorithm);
                         }
 #endif
-                        sleep(2);
+                        simulator_sleep(2.);
                     }
                 } else if (ret < 0) {
                     __scheduler_set_member(self, "connect_global");
@@ -1402,7 +1403,7 @@ __Scheduler_pop_task_block(void *_self)
                         fprintf(stderr, "%s %s %d: execution `%s` failed.\n", __FILE__, __func__, __LINE__, self->algorithm);
                     }
 #endif
-                    sleep(2);
+                    simulator_sleep(2.);
                 } else {
 #ifdef DEBUG
                     fprintf(stderr, "%s %s %d: popen fialed.\n", __FILE__, __func__, __LINE__);
@@ -1504,7 +1505,7 @@ __Scheduler_push_task_block(void *_self, const char *block_buf, unsigned int typ
         if (root_json != NULL && (general_json = cJSON_GetObjectItem(root_json, "GENERAL-INFO")) == NULL) {
             general_json = cJSON_CreateObject();
             cJSON_AddStringToObject(general_json, "operate", "push");
-            Clock_gettime(CLOCK_REALTIME, &tp);
+            simulator_timespec(&tp);
             gmtime_r(&tp.tv_sec, &time_buf);
             strftime(timestamp, TIMESTAMPSIZE, "%Y-%m-%dT%H:%M:%S", &time_buf);
             s = timestamp + strlen(timestamp);
@@ -1557,7 +1558,7 @@ __Scheduler_update_status_json(struct __Scheduler *self, const char *string)
     struct timespec tp;
     double timestamp;
     
-    Clock_gettime(CLOCK_REALTIME, &tp);
+    simulator_timespec(&tp);
     timestamp = tp.tv_sec + tp.tv_nsec / 1000000000.;
     
     
@@ -1820,7 +1821,7 @@ __Scheduler_add_site_json(struct __Scheduler *self, const char *info)
         return AAOS_EINVAL;
     }
 
-    Clock_gettime(CLOCK_REALTIME, &tp);
+    simulator_timespec(&tp);
     timestamp = tp.tv_sec + tp.tv_nsec / 1000000000.;
     __scheduler_create_sql(SCHEDULER_ADD_SITE, 0, self->site_db_table, sql, BUFSIZE, sitename, site_id, site_lon, site_lat, site_alt, timestamp);
     __Scheduler_database_query(self, sql, NULL);
@@ -2122,11 +2123,11 @@ __Scheduler_add_telescope_thr(void *arg)
     int ret;
     
     client = new(SchedulerClient(), self->global_addr, self->global_port);
-    if ((ret = rpc_client_connect(client, &scheduler_local)) != AAOS_OK) {
+    if ((ret = rpc_pool_get(client, &scheduler_local)) != AAOS_OK) {
         goto end;
     }
-    scheduler_add_telescope(scheduler_local, telescope_record->record, SCHEDULER_FORMAT_JSON);
-    delete(scheduler_local);
+    ret = scheduler_add_telescope(scheduler_local, telescope_record->record, SCHEDULER_FORMAT_JSON);
+    rpc_pool_put(scheduler_local, ret);
     
 end:
     free(telescope_record->record);
@@ -2172,7 +2173,7 @@ __Scheduler_add_telescope_json(struct __Scheduler *self, const char *info)
     char sql[BUFSIZE];
     void *client, *scheduler_local;
 
-    Clock_gettime(CLOCK_REALTIME, &tp);
+    simulator_timespec(&tp);
     timestamp = tp.tv_sec + tp.tv_nsec / 1000000000.;
 
     telescope_json = cJSON_Parse(info);
@@ -2282,11 +2283,11 @@ __Scheduler_delete_telescope_thr(void *arg)
     int ret;
     
     client = new(SchedulerClient(), self->global_addr, self->global_port);
-    if ((ret = rpc_client_connect(client, &scheduler_local)) != AAOS_OK) {
+    if ((ret = rpc_pool_get(client, &scheduler_local)) != AAOS_OK) {
         goto end;
     }
-    scheduler_delete_telescope_by_id(scheduler_local, telescope_staus->identifier);
-    delete(scheduler_local);
+    ret = scheduler_delete_telescope_by_id(scheduler_local, telescope_staus->identifier);
+    rpc_pool_put(scheduler_local, ret);
     
 end:
     delete(client);
@@ -2386,11 +2387,11 @@ __Scheduler_mask_telescope_thr(void *arg)
     int ret;
     
     client = new(SchedulerClient(), self->global_addr, self->global_port);
-    if ((ret = rpc_client_connect(client, &scheduler_local)) != AAOS_OK) {
+    if ((ret = rpc_pool_get(client, &scheduler_local)) != AAOS_OK) {
         goto end;
     }
-    scheduler_mask_telescope_by_id(scheduler_local, telescope_staus->identifier);
-    delete(scheduler_local);
+    ret = scheduler_mask_telescope_by_id(scheduler_local, telescope_staus->identifier);
+    rpc_pool_put(scheduler_local, ret);
     
 end:
     delete(client);
@@ -2502,11 +2503,11 @@ __Scheduler_unmask_telescope_thr(void *arg)
     int ret;
     
     client = new(SchedulerClient(), self->global_addr, self->global_port);
-    if ((ret = rpc_client_connect(client, &scheduler_local)) != AAOS_OK) {
+    if ((ret = rpc_pool_get(client, &scheduler_local)) != AAOS_OK) {
         goto end;
     }
-    scheduler_unmask_telescope_by_id(scheduler_local, telescope_staus->identifier);
-    delete(scheduler_local);
+    ret = scheduler_unmask_telescope_by_id(scheduler_local, telescope_staus->identifier);
+    rpc_pool_put(scheduler_local, ret);
     
 end:
     delete(client);
@@ -2643,7 +2644,7 @@ __Scheduler_add_target_json(struct __Scheduler *self, const char *info)
     char sql[BUFSIZE];
     struct TargetInfo *target;
 
-    Clock_gettime(CLOCK_REALTIME, &tp);
+    simulator_timespec(&tp);
     timestamp = tp.tv_sec + tp.tv_nsec / 1000000000.;
 
     target_json = cJSON_Parse(info);
@@ -2955,16 +2956,16 @@ __Scheduler_add_task_record_thr(void *arg)
     int ret;
     
     client = new(SchedulerClient(), self->global_addr, self->global_port);
-    if ((ret = rpc_client_connect(client, &scheduler_local)) != AAOS_OK) {
+    if ((ret = rpc_pool_get(client, &scheduler_local)) != AAOS_OK) {
         goto end;
     }
     if (task_record->record2 != NULL) {
-        scheduler_add_task_record(scheduler_local, task_record->record2, SCHEDULER_FORMAT_JSON);
+        ret = scheduler_add_task_record(scheduler_local, task_record->record2, SCHEDULER_FORMAT_JSON);
     } else {
         scheduler_add_task_record(scheduler_local, task_record->record2, SCHEDULER_FORMAT_JSON);
-        scheduler_add_task_record(scheduler_local, task_record->record, SCHEDULER_FORMAT_JSON);
+        ret = scheduler_add_task_record(scheduler_local, task_record->record, SCHEDULER_FORMAT_JSON);
     }
-    delete(scheduler_local);
+    rpc_pool_put(scheduler_local, ret);
 end:
     free(task_record->record2);
     delete(client);
@@ -2987,7 +2988,7 @@ __Scheduler_add_task_record_json(struct __Scheduler *self, int status, const cha
     void *client, *scheduler_local;
     
     struct timespec tp;
-    Clock_gettime(CLOCK_REALTIME, &tp);
+    simulator_timespec(&tp);
     timestamp = tp.tv_sec + tp.tv_nsec / 1000000000.;
     
     root_json = cJSON_Parse(info);
@@ -3101,12 +3102,12 @@ __Scheduler_update_task_record_thr(void *arg)
     int ret;
     
     client = new(SchedulerClient(), self->global_addr, self->global_port);
-    if ((ret = rpc_client_connect(client, &scheduler_local)) != AAOS_OK) {
+    if ((ret = rpc_pool_get(client, &scheduler_local)) != AAOS_OK) {
         goto end;
     }
-    scheduler_update_task_record(scheduler_local, task_record->identifier, task_record->record, SCHEDULER_FORMAT_JSON);
+    ret = scheduler_update_task_record(scheduler_local, task_record->identifier, task_record->record, SCHEDULER_FORMAT_JSON);
 
-    delete(scheduler_local);
+    rpc_pool_put(scheduler_local, ret);
 end:
     free(task_record->record);
     delete(client);
@@ -3138,7 +3139,7 @@ __Scheduler_update_task_record(void *_self, uint64_t identifier, const char *inf
     char sql[BUFSIZE];
     struct timespec tp;
     
-    Clock_gettime(CLOCK_REALTIME, &tp);
+    simulator_timespec(&tp);
     timestamp = tp.tv_sec + tp.tv_nsec / 1000000000.;
 
     __scheduler_create_sql(SCHEDULER_UPDATE_TASK_RECORD, identifier, self->task_db_table, sql, BUFSIZE, identifier, info);
@@ -3174,12 +3175,12 @@ __Scheduler_update_task_status_thr(void *arg)
     int ret;
     
     client = new(SchedulerClient(), self->global_addr, self->global_port);
-    if ((ret = rpc_client_connect(client, &scheduler_local)) != AAOS_OK) {
+    if ((ret = rpc_pool_get(client, &scheduler_local)) != AAOS_OK) {
         goto end;
     }
-    scheduler_update_task_status(scheduler_local, task_status->identifier, task_status->status);
+    ret = scheduler_update_task_status(scheduler_local, task_status->identifier, task_status->status);
 
-    delete(scheduler_local);
+    rpc_pool_put(scheduler_local, ret);
 end:
     delete(client);
     free(arg);
@@ -3209,7 +3210,7 @@ __Scheduler_update_task_status(void *_self, uint64_t identifier, int status)
     char sql[BUFSIZE];
     struct timespec tp;
    
-    Clock_gettime(CLOCK_REALTIME, &tp);
+    simulator_timespec(&tp);
     timestamp = tp.tv_sec + tp.tv_nsec / 1000000000.;
 
     __scheduler_create_sql(SCHEDULER_UPDATE_TASK_STATUS, identifier, self->task_db_table, sql, BUFSIZE, status, timestamp);
@@ -2255,7 +2255,7 @@ Scheduler_ctor(void *_self, va_list *app)
 {
     struct Scheduler *self = super_ctor(Scheduler(), _self, app);
 
-    protobuf_reallocate(self->_.protobuf, BUFSIZE * SCHEDULER_MAX_TASK_IN_BLOCK);
+    protobuf_reserve(self->_.protobuf, BUFSIZE * SCHEDULER_MAX_TASK_IN_BLOCK);
     self->_._vtab = scheduler_virtual_table();
 
     return (void *) self;
@@ -2838,10 +2838,9 @@ SchedulerServer_accept(void *_self, void **client)
 {
     struct RPCServer *self = cast(RPCServer(), _self);
     
-    int lfd, cfd;
+    int cfd;
     
-    lfd = tcp_server_get_lfd(self);
-    cfd = Accept(lfd, NULL, NULL);
+    cfd = rpc_server_accept_fd(self, TCPSERVER_OPTION_TCP);
     if (cfd < 0) {
         *client = NULL;
         return AAOS_ERROR;
@@ -2859,12 +2858,9 @@ SchedulerServer_accept2(void *_self, void **client)
 {
     struct RPCServer *self = cast(RPCServer(), _self);
     
-    int lfd, cfd, lfds[2];
+    int cfd;
     
-    tcp_server_get_lfds(self, lfds);
-    lfd = lfds[1];
-    
-    cfd = Accept(lfd, NULL, NULL);
+    cfd = rpc_server_accept_fd(self, TCPSERVER_OPTION_UDS);
     if (cfd < 0) {
         *client = NULL;
         return AAOS_ERROR;
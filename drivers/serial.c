@@ -923,6 +923,51 @@ __Serial_raw(void *_self, const void *write_buffer, size_t write_buffer_size, si
     return ret;
 }
 
+/*
+ * Hold the port across several raw calls, e.g. the items of a batch.
+ */
+void
+__serial_lock(void *_self)
+{
+    struct __Serial *self = cast(__Serial(), _self);
+    
+    Pthread_mutex_lock(&self->mtx);
+}
+
+void
+__serial_unlock(void *_self)
+{
+    struct __Serial *self = cast(__Serial(), _self);
+    
+    Pthread_mutex_unlock(&self->mtx);
+}
+
+/*
+ * Called with the port held once by __serial_lock, so that waiting for
+ * the tty releases it. The raw call which follows takes it again.
+ */
+int
+__serial_ready(void *_self)
+{
+    struct __Serial *self = cast(__Serial(), _self);
+    
+    while (self->state == SERIAL_STATE_WAIT_FOR_READY) {
+        Pthread_cond_wait(&self->cond, &self->mtx);
+    }
+    switch (self->state) {
+        case SERIAL_STATE_ERROR:
+            return AAOS_EDEVMAL;
+            break;
+        case SERIAL_STATE_UNLOADED:
+            return AAOS_EDEVNOTLOADED;
+            break;
+        default:
+            break;
+    }
+    
+    return AAOS_OK;
+}
+
 int
 __serial_raw_nl(void *_self, const void *write_buffer, size_t write_buffer_size, size_t *write_size, void *read_buffer, size_t read_buffer_size, size_t *read_size)
 {
@@ -1203,6 +1248,7 @@ __Serial_ctor(void *_self, va_list *app)
     struct __Serial *self = super_ctor(__Serial(), _self, app);
     
     const char *s, *key, *value;
+    pthread_mutexattr_t attr;
     
     s = va_arg(*app, const char *);
     if (s) {
@@ -1253,7 +1299,13 @@ __Serial_ctor(void *_self, va_list *app)
     }
     self->fd = -1;
     self->state = SERIAL_STATE_UNLOADED;
-    Pthread_mutex_init(&self->mtx, NULL);
+    /*
+     * Recursive, a batch holds the port across the raw calls of its items.
+     */
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    Pthread_mutex_init(&self->mtx, &attr);
+    pthread_mutexattr_destroy(&attr);
     Pthread_cond_init(&self->cond, NULL);
     
     return (void *) self;
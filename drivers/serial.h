@@ -33,6 +33,9 @@ int __serial_read3(void *_self, void *read_buffer, size_t buffer_size, size_t *r
 int __serial_set_command(void *_self, const void *data, size_t size);
 int __serial_raw(void *_self, const void *write_buffer, size_t write_buffer_size, size_t *write_size, void *read_buffer, size_t read_buffer_size, size_t *read_size);
 int __serial_raw2(void *_self);
+void __serial_lock(void *_self);
+void __serial_unlock(void *_self);
+int __serial_ready(void *_self);
 int __serial_get_fd(const void *_self);
 int __serial_get_result(const void *_self, void **result, size_t *size);
 int __serial_feed_dog(void *_self);
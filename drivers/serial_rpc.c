@@ -161,6 +161,59 @@ get_serial_by_index(int index)
     }
 }
 
+/*
+ * Batch payload, a sequence of struct SerialBatchItem, each followed by its data.
+ */
+
+int
+serial_batch_put(void *buf, size_t size, size_t *offset, uint16_t index, const void *cmd, size_t cmd_size)
+{
+    struct SerialBatchItem item;
+    
+    if (*offset + sizeof(item) + cmd_size > size) {
+        return AAOS_ENOSPC;
+    }
+    item.index = index;
+    item.errorcode = AAOS_OK;
+    item.length = (uint32_t) cmd_size;
+    memcpy((char *) buf + *offset, &item, sizeof(item));
+    if (cmd_size > 0) {
+        memcpy((char *) buf + *offset + sizeof(item), cmd, cmd_size);
+    }
+    *offset += sizeof(item) + cmd_size;
+    
+    return AAOS_OK;
+}
+
+int
+serial_batch_get(const void *buf, size_t length, size_t *offset, uint16_t *index, uint16_t *errorcode, const void **data, size_t *data_size)
+{
+    struct SerialBatchItem item;
+    
+    if (*offset + sizeof(item) > length) {
+        return AAOS_EBADMSG;
+    }
+    memcpy(&item, (const char *) buf + *offset, sizeof(item));
+    if (*offset + sizeof(item) + item.length > length) {
+        return AAOS_EBADMSG;
+    }
+    if (index != NULL) {
+        *index = item.index;
+    }
+    if (errorcode != NULL) {
+        *errorcode = item.errorcode;
+    }
+    if (data != NULL) {
+        *data = (const char *) buf + *offset + sizeof(item);
+    }
+    if (data_size != NULL) {
+        *data_size = item.length;
+    }
+    *offset += sizeof(item) + item.length;
+    
+    return AAOS_OK;
+}
+
 /*
  * Serial class
  */
@@ -469,6 +522,56 @@ Serial_raw(void *_self, const void *cmd, size_t cmd_size, void *res, size_t res_
     return ret;
 }
 
+int
+serial_batch(void *_self, const void *cmd, size_t cmd_size, size_t n_item, void *res, size_t res_size, size_t *res_length)
+{
+    const struct SerialClass *class = (const struct SerialClass *) classOf(_self);
+    
+    if (isOf(class, SerialClass()) && class->batch.method) {
+        return ((int (*)(void *, const void *, size_t, size_t, void *, size_t, size_t *)) class->batch.method)(_self, cmd, cmd_size, n_item, res, res_size, res_length);
+    } else {
+        int result;
+        forward(_self, &result, (Method) serial_batch, "batch", _self, cmd, cmd_size, n_item, res, res_size, res_length);
+        return result;
+    }
+}
+
+/*
+ * Execute a batch of raw commands, packed by serial_batch_put, in one round-trip.
+ * On success, `res` holds one reply item per request item, in the same order,
+ * each carrying its own error code.
+ */
+static int
+Serial_batch(void *_self, const void *cmd, size_t cmd_size, size_t n_item, void *res, size_t res_size, size_t *res_length)
+{
+    struct Serial *self = cast(Serial(), _self);
+    uint32_t length;
+    int ret;
+    
+    if (cmd == NULL || res == NULL || n_item == 0) {
+        return -1 * AAOS_EINVAL;
+    }
+    
+    protobuf_set(self, PACKET_PROTOCOL, PROTO_SERIAL);
+    protobuf_set(self, PACKET_COMMAND, SERIAL_COMMAND_BATCH);
+    protobuf_set(self, PACKET_U32F0, (uint32_t) n_item);
+    protobuf_set(self, PACKET_BUF, cmd, cmd_size);
+    
+    if ((ret = rpc_call(self)) == AAOS_OK) {
+        char *buf;
+        protobuf_get(self, PACKET_LENGTH, &length);
+        if (length > res_size) {
+            return AAOS_ENOSPC;
+        }
+        protobuf_get(self, PACKET_BUF, &buf, NULL);
+        memcpy(res, buf, length);
+        if (res_length != NULL) {
+            *res_length = length;
+        }
+    }
+    return ret;
+}
+
 int
 serial_register(void *_self, double timeout)
 {
@@ -819,6 +922,116 @@ Serial_execute_default(struct Serial *self)
     return AAOS_EBADCMD;
 }
 
+/*
+ * Run every item of a batch back-to-back on the server side, so that a client
+ * sweeping many sensors pays one network round-trip instead of one per sensor.
+ * A failing item does not abort the batch, its error code is returned in its reply item.
+ */
+static int
+Serial_execute_batch(struct Serial *self)
+{
+    char *buf, *request, *reply;
+    char command[BUFSIZE], answer[BUFSIZE];
+    struct SerialBatchItem item;
+    const void *data;
+    void *serial, *held = NULL;
+    size_t i, length, offset, reply_offset, reply_size, data_size, read_size;
+    uint32_t n_item;
+    uint16_t index, errorcode;
+    int ret;
+    
+    protobuf_get(self, PACKET_U32F0, &n_item);
+    protobuf_get(self, PACKET_BUF, &buf, &length);
+    if (n_item == 0 || length == 0) {
+        return AAOS_EBADCMD;
+    }
+    /*
+     * n_item comes from the wire, every item takes at least its header.
+     */
+    if (n_item > length / sizeof(struct SerialBatchItem)) {
+        return AAOS_EBADMSG;
+    }
+    /*
+     * Replies overwrite the payload, keep a copy of the request.
+     */
+    if ((request = (char *) Malloc(length)) == NULL) {
+        return AAOS_ENOMEM;
+    }
+    memcpy(request, buf, length);
+    reply_size = length + n_item * PACKETPARAMETERSIZE;
+    if ((reply = (char *) Malloc(reply_size)) == NULL) {
+        free(request);
+        return AAOS_ENOMEM;
+    }
+    
+    offset = 0;
+    reply_offset = 0;
+    for (i = 0; i < n_item; i++) {
+        if ((ret = serial_batch_get(request, length, &offset, &index, NULL, &data, &data_size)) != AAOS_OK) {
+            break;
+        }
+        read_size = 0;
+        if (data_size == 0 || data_size >= BUFSIZE) {
+            errorcode = AAOS_ECMDTOOLONG;
+        } else if ((serial = get_serial_by_index((int) index)) == NULL) {
+            errorcode = AAOS_ENOTFOUND;
+        } else {
+            /*
+             * Items of a port run back-to-back under one hold of its lock,
+             * let go of the previous port first, so that two batches cannot deadlock.
+             */
+            if (serial != held) {
+                if (held != NULL) {
+                    __serial_unlock(held);
+                }
+                __serial_lock(serial);
+                held = serial;
+            }
+            memcpy(command, data, data_size);
+            command[data_size] = '\0';
+            if ((ret = __serial_ready(serial)) == AAOS_OK && (ret = __serial_raw(serial, command, data_size, NULL, answer, BUFSIZE, &read_size)) < 0) {
+                ret = -1 * ret;
+            }
+            errorcode = (uint16_t) ret;
+            if (errorcode != AAOS_OK) {
+                read_size = 0;
+            }
+        }
+        if (reply_offset + sizeof(item) + read_size > reply_size) {
+            char *tmp;
+            reply_size = 2 * (reply_offset + sizeof(item) + read_size);
+            if ((tmp = (char *) Realloc(reply, reply_size)) == NULL) {
+                if (held != NULL) {
+                    __serial_unlock(held);
+                }
+                free(request);
+                free(reply);
+                return AAOS_ENOMEM;
+            }
+            reply = tmp;
+        }
+        item.index = index;
+        item.errorcode = errorcode;
+        item.length = (uint32_t) read_size;
+        memcpy(reply + reply_offset, &item, sizeof(item));
+        memcpy(reply + reply_offset + sizeof(item), answer, read_size);
+        reply_offset += sizeof(item) + read_size;
+    }
+    if (held != NULL) {
+        __serial_unlock(held);
+    }
+    free(request);
+    
+    protobuf_set(self, PACKET_U32F0, (uint32_t) i);
+    protobuf_set(self, PACKET_BUF, reply, reply_offset);
+    free(reply);
+    
+    if (i != n_item) {
+        return AAOS_EBADMSG;
+    }
+    return AAOS_OK;
+}
+
 static int
 Serial_execute_get_index_by_name(struct Serial *self)
 {
@@ -900,6 +1113,9 @@ Serial_execute(void *_self)
         case SERIAL_COMMAND_RAW:
             return Serial_execute_raw(self);
             break;
+        case SERIAL_COMMAND_BATCH:
+            return Serial_execute_batch(self);
+            break;
         case SERIAL_COMMAND_UNLOAD:
             return Serial_execute_unload(self);
             break;
@@ -980,6 +1196,14 @@ SerialClass_ctor(void *_self, va_list *app)
             self->raw.method = method;
             continue;
         }
+        if (selector == (Method) serial_batch) {
+            if (tag) {
+                self->batch.tag = tag;
+                self->batch.selector = selector;
+            }
+            self->batch.method = method;
+            continue;
+        }
         
         if (selector == (Method) serial_inspect) {
             if (tag) {
@@ -1054,6 +1278,7 @@ Serial_initialize(void)
                   ctor, "ctor", Serial_ctor,
                   dtor, "dtor", Serial_dtor,
                   serial_raw, "raw", Serial_raw,
+                  serial_batch, "batch", Serial_batch,
                   serial_inspect, "inspect", Serial_inspect,
                   serial_register, "register", Serial_register,
                   serial_info, "info", Serial_info,
@@ -1270,10 +1495,9 @@ SerialServer_accept(void *_self, void **client)
 {
     struct RPCServer *self = cast(RPCServer(), _self);
     
-    int lfd, cfd;
+    int cfd;
     
-    lfd = tcp_server_get_lfd(self);
-    cfd = Accept(lfd, NULL, NULL);
+    cfd = rpc_server_accept_fd(self, TCPSERVER_OPTION_TCP);
     if (cfd < 0) {
         *client = NULL;
         return AAOS_ERROR;
@@ -1291,12 +1515,9 @@ SerialServer_accept2(void *_self, void **client)
 {
     struct RPCServer *self = cast(RPCServer(), _self);
     
-    int lfd, cfd, lfds[2];
-    
-    tcp_server_get_lfds(self, lfds);
-    lfd = lfds[1];
+    int cfd;
     
-    cfd = Accept(lfd, NULL, NULL);
+    cfd = rpc_server_accept_fd(self, TCPSERVER_OPTION_UDS);
     if (cfd < 0) {
         *client = NULL;
         return AAOS_ERROR;
@@ -9,6 +9,7 @@
 #ifndef serial_rpc_h
 #define serial_rpc_h
 
+#include <stdint.h>
 #include "rpc.h"
 
 #define SERIAL_COMMAND_RAW 1
@@ -18,6 +19,7 @@
 #define SERIAL_COMMAND_UNLOAD 5
 #define SERIAL_COMMAND_GET_INDEX_BY_NAME 6
 #define SERIAL_COMMAND_GET_INDEX_BY_PATH 7
+#define SERIAL_COMMAND_BATCH             8
 #define SERIAL_COMMAND_INSPECT           0xFFFE
 #define SERIAL_COMMAND_REGISTER          0xFFFF
 
@@ -33,8 +35,15 @@ extern "C" {
 
 void start_feed_dog(double seconds);
 
+/*
+ * Pack and unpack the items of a SERIAL_COMMAND_BATCH payload.
+ */
+int serial_batch_put(void *buf, size_t size, size_t *offset, uint16_t index, const void *cmd, size_t cmd_size);
+int serial_batch_get(const void *buf, size_t length, size_t *offset, uint16_t *index, uint16_t *errorcode, const void **data, size_t *data_size);
+
 int serial_raw(void *_self, const void *cmd, size_t cmd_size, void *res, size_t res_size, size_t *res_length);
 int serial_info(void *_self, void *res, size_t res_size, size_t *res_length);
+int serial_batch(void *_self, const void *cmd, size_t cmd_size, size_t n_item, void *res, size_t res_size, size_t *res_length);
 int serial_get_index_by_name(void *_self, const char *name);
 int serial_get_index_by_path(void *_self, const char *path);
 int serial_inspect(void *_self);
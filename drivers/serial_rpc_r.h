@@ -17,11 +17,23 @@ struct Serial {
     struct RPC _;
 };
 
+/*
+ * Wire header of one item of a batch payload, followed by `length` bytes of data.
+ * In a request, data is the raw command; in a reply, data is the answer,
+ * and errorcode is the status of that item.
+ */
+struct SerialBatchItem {
+    uint16_t index;
+    uint16_t errorcode;
+    uint32_t length;
+};
+
 struct SerialClass {
     struct RPCClass _;
     struct Method get_index_by_name;
     struct Method get_index_by_path;
     struct Method raw;
+    struct Method batch;
     struct Method load;
     struct Method reload;
     struct Method unload;
@@ -0,0 +1,254 @@
+//
+//  simulator.c
+//  AAOS
+//
+
+#include <math.h>
+#include <time.h>
+
+#include "def.h"
+#include "simulator.h"
+#include "wrapper.h"
+
+#define SIMULATOR_SEED      2463534242U
+
+static double time_scale = 1.;
+static double time_epoch;
+
+/*
+ * Time to reach speed from rest, and how long the acceleration ramps up and down within it.
+ */
+static void
+simulator_axis_ramp(const struct SimulatorAxis *axis, double speed, double *ramp, double *jerk_time)
+{
+    double acceleration = axis->acceleration, jerk = axis->jerk;
+    
+    if (jerk > 0.) {
+        if (acceleration > 0. && speed * jerk >= acceleration * acceleration) {
+            *jerk_time = acceleration / jerk;
+            *ramp = speed / acceleration + *jerk_time;
+        } else {
+            *jerk_time = sqrt(speed / jerk);
+            *ramp = 2. * *jerk_time;
+        }
+    } else {
+        *jerk_time = 0.;
+        *ramp = (acceleration > 0.) ? speed / acceleration : 0.;
+    }
+}
+
+/*
+ * Highest speed of a move over distance, a ramp up and down covers speed * ramp.
+ */
+static double
+simulator_axis_peak(const struct SimulatorAxis *axis, double speed, double distance, double *ramp, double *jerk_time)
+{
+    double low = 0., high = speed, middle;
+    int i;
+    
+    simulator_axis_ramp(axis, speed, ramp, jerk_time);
+    if (speed * *ramp <= distance) {
+        return speed;
+    }
+    for (i = 0; i < 64; i++) {
+        middle = (low + high) / 2.;
+        simulator_axis_ramp(axis, middle, ramp, jerk_time);
+        if (middle * *ramp <= distance) {
+            low = middle;
+        } else {
+            high = middle;
+        }
+    }
+    simulator_axis_ramp(axis, low, ramp, jerk_time);
+    
+    return low;
+}
+
+/*
+ * Distance covered t seconds into a ramp from rest to speed.
+ * The speed is symmetric about the middle of the ramp.
+ */
+static double
+simulator_ramp_travel(double speed, double ramp, double jerk_time, double t)
+{
+    double acceleration;
+    
+    if (t > ramp / 2.) {
+        return speed * (t - ramp / 2.) + simulator_ramp_travel(speed, ramp, jerk_time, ramp - t);
+    }
+    acceleration = speed / (ramp - jerk_time);
+    if (t < jerk_time) {
+        return acceleration * t * t * t / (6. * jerk_time);
+    }
+    
+    return acceleration * jerk_time * jerk_time / 6. + acceleration * jerk_time * (t - jerk_time) / 2. + acceleration * (t - jerk_time) * (t - jerk_time) / 2.;
+}
+
+/*
+ * Seconds to move over distance and settle. A speed that is not positive is unlimited.
+ */
+double
+simulator_axis_duration(const struct SimulatorAxis *axis, double speed, double distance)
+{
+    double peak, ramp, jerk_time;
+    
+    distance = fabs(distance);
+    if (distance == 0.) {
+        return 0.;
+    }
+    if (speed <= 0.) {
+        return axis->settle;
+    }
+    peak = simulator_axis_peak(axis, speed, distance, &ramp, &jerk_time);
+    
+    return ramp + distance / peak + axis->settle;
+}
+
+/*
+ * Distance covered elapsed seconds into a move over distance, with the sign of distance.
+ */
+double
+simulator_axis_travel(const struct SimulatorAxis *axis, double speed, double distance, double elapsed)
+{
+    double d = fabs(distance), peak, ramp, jerk_time, cruise, s;
+    
+    if (d == 0. || elapsed <= 0.) {
+        return 0.;
+    }
+    if (speed <= 0.) {
+        return distance;
+    }
+    peak = simulator_axis_peak(axis, speed, d, &ramp, &jerk_time);
+    cruise = fmax(d / peak - ramp, 0.);
+    if (elapsed >= 2. * ramp + cruise) {
+        s = d;
+    } else if (elapsed <= ramp) {
+        s = simulator_ramp_travel(peak, ramp, jerk_time, elapsed);
+    } else if (elapsed <= ramp + cruise) {
+        s = peak * ramp / 2. + peak * (elapsed - ramp);
+    } else {
+        s = d - simulator_ramp_travel(peak, ramp, jerk_time, 2. * ramp + cruise - elapsed);
+    }
+    
+    return copysign(fmin(fmax(s, 0.), d), distance);
+}
+
+int
+simulator_axis_check(const struct SimulatorAxis *axis, double position)
+{
+    if (axis->min < axis->max && (position < axis->min || position > axis->max)) {
+        return AAOS_EINVAL;
+    }
+    
+    return AAOS_OK;
+}
+
+/*
+ * Uniform in [0, 1), by xorshift on the seed, safe to call from several threads.
+ */
+static double
+simulator_random(struct SimulatorFault *fault)
+{
+    unsigned int seed, next;
+    
+    seed = __atomic_load_n(&fault->seed, __ATOMIC_RELAXED);
+    do {
+        next = (seed != 0) ? seed : SIMULATOR_SEED;
+        next ^= next << 13;
+        next ^= next >> 17;
+        next ^= next << 5;
+    } while (!__atomic_compare_exchange_n(&fault->seed, &seed, next, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+    
+    return next / 4294967296.;
+}
+
+int
+simulator_fault_move(struct SimulatorFault *fault)
+{
+    double r;
+    
+    if (fault->stall <= 0. && fault->timeout <= 0.) {
+        return SIMULATOR_FAULT_NONE;
+    }
+    r = simulator_random(fault);
+    if (r < fault->stall) {
+        return SIMULATOR_FAULT_STALL;
+    } else if (r < fault->stall + fault->timeout) {
+        return SIMULATOR_FAULT_TIMEOUT;
+    }
+    
+    return SIMULATOR_FAULT_NONE;
+}
+
+bool
+simulator_fault_noise(struct SimulatorFault *fault)
+{
+    return fault->noise > 0. && simulator_random(fault) < fault->noise;
+}
+
+/*
+ * Part of the move done before a stall.
+ */
+double
+simulator_fault_stall_fraction(struct SimulatorFault *fault)
+{
+    return .2 + .6 * simulator_random(fault);
+}
+
+static double
+simulator_realtime(void)
+{
+    struct timespec tp;
+    
+    Clock_gettime(CLOCK_REALTIME, &tp);
+    
+    return tp.tv_sec + tp.tv_nsec / 1000000000.;
+}
+
+void
+simulator_set_time_scale(double scale, double epoch)
+{
+    time_epoch = (epoch > 0.) ? epoch : simulator_realtime();
+    time_scale = (scale > 0.) ? scale : 1.;
+}
+
+double
+simulator_get_time_scale(void)
+{
+    return time_scale;
+}
+
+/*
+ * Seconds since the epoch, on the clock of the simulation.
+ */
+double
+simulator_time(void)
+{
+    double t = simulator_realtime();
+    
+    if (time_scale == 1.) {
+        return t;
+    }
+    
+    return time_epoch + (t - time_epoch) * time_scale;
+}
+
+void
+simulator_timespec(struct timespec *tp)
+{
+    double t = simulator_time();
+    
+    tp->tv_sec = (time_t) t;
+    tp->tv_nsec = (long) ((t - tp->tv_sec) * 1000000000.);
+}
+
+/*
+ * Sleeps duration seconds of the simulation, a cancellation point.
+ */
+void
+simulator_sleep(double duration)
+{
+    if (duration > 0.) {
+        Nanosleep(duration / time_scale);
+    }
+}
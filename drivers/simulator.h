@@ -0,0 +1,86 @@
+//
+//  simulator.h
+//  AAOS
+//
+
+#ifndef simulator_h
+#define simulator_h
+
+#include <stdbool.h>
+#include <time.h>
+
+/*
+ * Motion and fault model shared by the virtual devices.
+ *
+ * An axis moves from rest to rest on a jerk limited profile: the acceleration ramps up at jerk,
+ * holds at acceleration, and ramps down until the speed is reached, then the axis cruises,
+ * and brakes the same way. Short moves never reach the speed, or even the acceleration.
+ * An acceleration or a jerk that is not positive is unlimited, without both, the axis moves at
+ * a constant speed as before. After arrival, the axis settles for settle seconds.
+ * The speed is given by the device, so that set_slew_speed and alike keep working.
+ *
+ * Faults are drawn per command: a move stalls part way with probability stall, a command is lost
+ * and times out after timeout_after seconds with probability timeout, and a status reply is garbled
+ * with probability noise. Draws are repeatable from seed.
+ *
+ * The clock of the simulation runs time_scale times faster than the wall clock, from epoch,
+ * or from the moment the scale is set without one, so that a whole night is simulated in minutes.
+ * Set it once, before any device starts. The virtual devices, the observation thread and the scheduler
+ * all keep time by it; daemons given the same epoch share the same clock.
+ */
+
+#define SIMULATOR_FAULT_NONE        0
+#define SIMULATOR_FAULT_STALL       1
+#define SIMULATOR_FAULT_TIMEOUT     2
+
+#define SIMULATOR_TIMEOUT_AFTER     10.
+
+struct SimulatorAxis {
+    double acceleration;    /* unit per second squared */
+    double jerk;            /* unit per second cubed */
+    double settle;          /* second */
+    double min;             /* travel limits, none unless min < max */
+    double max;
+};
+
+struct SimulatorFault {
+    double stall;
+    double timeout;
+    double noise;
+    double timeout_after;   /* second */
+    unsigned int seed;
+};
+
+/*
+ * For a telescope, x is the right ascension axis and y the declination axis;
+ * for a dome, x is the rotation and y the window.
+ */
+struct Simulator {
+    struct SimulatorAxis x;
+    struct SimulatorAxis y;
+    struct SimulatorFault fault;
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+double simulator_axis_duration(const struct SimulatorAxis *axis, double speed, double distance);
+double simulator_axis_travel(const struct SimulatorAxis *axis, double speed, double distance, double elapsed);
+int simulator_axis_check(const struct SimulatorAxis *axis, double position);
+
+int simulator_fault_move(struct SimulatorFault *fault);
+bool simulator_fault_noise(struct SimulatorFault *fault);
+double simulator_fault_stall_fraction(struct SimulatorFault *fault);
+
+void simulator_set_time_scale(double scale, double epoch);
+double simulator_get_time_scale(void);
+double simulator_time(void);
+void simulator_timespec(struct timespec *tp);
+void simulator_sleep(double duration);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* simulator_h */
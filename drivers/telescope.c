@@ -11,9 +11,31 @@
 #include "telescope_def.h"
 #include "telescope_r.h"
 #include "telescope.h"
+#include "rpc.h"
+#include "simulator.h"
 #include "virtual.h"
 #include "wrapper.h"
 #include <cjson/cJSON.h>
+#include <math.h>
+#include <sched.h>
+
+/*
+ * Wake up the waiters of the state, and push it to the subscribers of "telescope/<name>".
+ * Called with t_state.mtx held.
+ */
+static void
+__Telescope_state_broadcast(struct __Telescope *self)
+{
+    char topic[PATH_MAX];
+    uint32_t state;
+    
+    Pthread_cond_broadcast(&self->t_state.cond);
+    if (rpc_has_subscriber()) {
+        state = (uint32_t) self->t_state.state;
+        snprintf(topic, PATH_MAX, "telescope/%s", self->name == NULL ? "" : self->name);
+        rpc_publish(topic, &state, sizeof(state));
+    }
+}
 
 /*
  * TelescopeVirtualTable class.
@@ -300,6 +322,14 @@ __TelescopeVirtualTable_ctor(void *_self, va_list *app)
             self->info.method = method;
             continue;
         }
+        if (selector == (Method) __telescope_get_position) {
+            if (tag) {
+                self->get_position.tag = tag;
+                self->get_position.selector = selector;
+            }
+            self->get_position.method = method;
+            continue;
+        }
     }
     
     return _self;
@@ -430,7 +460,7 @@ __Telescope_release(void *_self)
     Pthread_mutex_lock(&self->t_state.mtx);
     if (self->t_state.state == TELESCOPE_STATE_TRACKING_WAIT) {
         self->t_state.state = TELESCOPE_STATE_TRACKING;
-        Pthread_cond_broadcast(&self->t_state.cond);
+        __Telescope_state_broadcast(self);
     }
     Pthread_mutex_unlock(&self->t_state.mtx);
     return AAOS_OK;
@@ -551,6 +581,11 @@ __Telescope_get(void *_self, va_list *app)
             *keyvalue = self->gmt_offset;
             break;
         }
+        if (strcmp(keyname, "status_interval") == 0) {
+            double *keyvalue = va_arg(*app, double *);
+            *keyvalue = self->t_status.interval;
+            break;
+        }
         
         if (strcmp(keyname, "slew_available") == 0) {
             bool *keyvalue = va_arg(*app, bool *);
@@ -849,7 +884,7 @@ __telescope_set(void *_self, ...)
 }
 
 static void
-__Telescope_set(void *_self, const char *name, va_list *app)
+__Telescope_set(void *_self, va_list *app)
 {
     struct __Telescope *self = cast(__Telescope(), _self);
     
@@ -888,6 +923,10 @@ __Telescope_set(void *_self, const char *name, va_list *app)
             self->gmt_offset = va_arg(*app, double);
             break;
         }
+        if (strcmp(keyname, "status_interval") == 0) {
+            self->t_status.interval = va_arg(*app, double);
+            break;
+        }
         
         if (strcmp(keyname, "slew_available") == 0) {
             unsigned int keyvalue = va_arg(*app, unsigned int);
@@ -1802,6 +1841,173 @@ __Telescope_inspect(const void *_self)
     return AAOS_ENOTSUP;
 }
 
+int
+__telescope_get_position(void *_self, double *ra, double *dec, double *alt, double *az)
+{
+    const struct __TelescopeClass *class = (const struct __TelescopeClass *) classOf(_self);
+    
+    if (isOf(class, __TelescopeClass()) && class->get_position.method) {
+        return ((int (*)(void *, double *, double *, double *, double *)) class->get_position.method)(_self, ra, dec, alt, az);
+    } else {
+        int result;
+        forward(_self, &result, (Method) __telescope_get_position, "get_position", _self, ra, dec, alt, az);
+        return result;
+    }
+}
+
+/*
+ * The position last read from the device, drivers update t_param when they read the status.
+ */
+static int
+__Telescope_get_position(void *_self, double *ra, double *dec, double *alt, double *az)
+{
+    struct __Telescope *self = cast(__Telescope(), _self);
+    
+    Pthread_mutex_lock(&self->t_state.mtx);
+    *ra = self->t_param.ra;
+    *dec = self->t_param.dec;
+    *alt = self->t_param.alt;
+    *az = self->t_param.az;
+    Pthread_mutex_unlock(&self->t_state.mtx);
+    
+    return AAOS_OK;
+}
+
+/*
+ * Cached status.
+ * The snapshot is taken by __telescope_refresh_status, by a request that finds the snapshot stale,
+ * or from a publisher thread running every t_status.interval seconds, if it is set.
+ */
+
+static double
+__Telescope_status_time(void)
+{
+    struct timespec tp;
+    
+    Clock_gettime(CLOCK_REALTIME, &tp);
+    
+    return tp.tv_sec + tp.tv_nsec / 1000000000.;
+}
+
+int
+__telescope_refresh_status(void *_self)
+{
+    const struct __TelescopeClass *class = (const struct __TelescopeClass *) classOf(_self);
+    
+    if (isOf(class, __TelescopeClass()) && class->refresh_status.method) {
+        return ((int (*)(void *)) class->refresh_status.method)(_self);
+    } else {
+        int result;
+        forward(_self, &result, (Method) __telescope_refresh_status, "refresh_status", _self);
+        return result;
+    }
+}
+
+static int
+__Telescope_refresh_status(void *_self)
+{
+    struct __Telescope *self = cast(__Telescope(), _self);
+    
+    char buf[TELESCOPE_STATUS_CACHE_SIZE];
+    struct TelescopeStatusRecord record;
+    size_t length;
+    int ret;
+    
+    /*
+     * Clear the stale flag before taking the snapshot,
+     * so that a state change during the refresh is not lost.
+     */
+    __atomic_store_n(&self->t_status.stale, 0, __ATOMIC_RELAXED);
+    record.timestamp = __Telescope_status_time();
+    
+    if ((ret = __telescope_status(_self, buf, sizeof(buf), NULL)) != AAOS_OK) {
+        __atomic_store_n(&self->t_status.stale, 1, __ATOMIC_RELAXED);
+        return ret;
+    }
+    buf[sizeof(buf) - 1] = '\0';
+    length = strlen(buf) + 1;
+    
+    record.version = TELESCOPE_STATUS_RECORD_VERSION;
+    record.reserved = 0;
+    record.state = __atomic_load_n(&self->t_state.state, __ATOMIC_RELAXED);
+    if (__telescope_get_position(_self, &record.ra, &record.dec, &record.alt, &record.az) != AAOS_OK) {
+        record.ra = record.dec = record.alt = record.az = NAN;
+    }
+    
+    Pthread_rwlock_wrlock(&self->t_status.rwlock);
+    record.sequence = self->t_status.record.sequence + 1;
+    memcpy(self->t_status.json, buf, length);
+    self->t_status.json_length = length;
+    memcpy(&self->t_status.record, &record, sizeof(struct TelescopeStatusRecord));
+    Pthread_rwlock_unlock(&self->t_status.rwlock);
+    
+    return AAOS_OK;
+}
+
+int
+__telescope_cached_status(void *_self, unsigned int format, void *res, size_t res_size, size_t *res_len)
+{
+    const struct __TelescopeClass *class = (const struct __TelescopeClass *) classOf(_self);
+    
+    if (isOf(class, __TelescopeClass()) && class->cached_status.method) {
+        return ((int (*)(void *, unsigned int, void *, size_t, size_t *)) class->cached_status.method)(_self, format, res, res_size, res_len);
+    } else {
+        int result;
+        forward(_self, &result, (Method) __telescope_cached_status, "cached_status", _self, format, res, res_size, res_len);
+        return result;
+    }
+}
+
+static int
+__Telescope_cached_status(void *_self, unsigned int format, void *res, size_t res_size, size_t *res_len)
+{
+    struct __Telescope *self = cast(__Telescope(), _self);
+    
+    bool refresh;
+    size_t length;
+    int ret = AAOS_OK;
+    
+    if (format != TELESCOPE_STATUS_FORMAT_JSON && format != TELESCOPE_STATUS_FORMAT_BINARY) {
+        return AAOS_EINVAL;
+    }
+    
+    /*
+     * Refresh in place on state change, or when the snapshot is older than TELESCOPE_STATUS_MAX_AGE,
+     * or twice the interval of the publisher thread, if it runs and has fallen behind.
+     */
+    Pthread_rwlock_rdlock(&self->t_status.rwlock);
+    refresh = (self->t_status.record.sequence == 0 || __atomic_load_n(&self->t_status.stale, __ATOMIC_RELAXED) || self->t_status.record.state != __atomic_load_n(&self->t_state.state, __ATOMIC_RELAXED) || __Telescope_status_time() - self->t_status.record.timestamp > fmax(TELESCOPE_STATUS_MAX_AGE, 2. * self->t_status.interval));
+    Pthread_rwlock_unlock(&self->t_status.rwlock);
+    
+    if (refresh && (ret = __telescope_refresh_status(_self)) != AAOS_OK) {
+        return ret;
+    }
+    
+    Pthread_rwlock_rdlock(&self->t_status.rwlock);
+    if (format == TELESCOPE_STATUS_FORMAT_JSON) {
+        length = self->t_status.json_length;
+        if (length > res_size) {
+            ret = AAOS_ENOSPC;
+        } else {
+            memcpy(res, self->t_status.json, length);
+        }
+    } else {
+        length = sizeof(struct TelescopeStatusRecord);
+        if (length > res_size) {
+            ret = AAOS_ENOSPC;
+        } else {
+            memcpy(res, &self->t_status.record, length);
+        }
+    }
+    Pthread_rwlock_unlock(&self->t_status.rwlock);
+    
+    if (ret == AAOS_OK && res_len != NULL) {
+        *res_len = length;
+    }
+    
+    return ret;
+}
+
 /*
  * Pure virtual function, mandatory functionalities.
  */
@@ -1942,6 +2148,12 @@ __Telescope_forward(const void *_self, void *result, Method selector, const char
     } else if (selector == (Method) __telescope_switch_instrument || selector == (Method) __telescope_switch_detector || selector == (Method) __telescope_switch_filter) {
         const char *name = va_arg(*app, const char *);
         *((int *) result) = ((int (*)(void *, const char *)) method)(obj, name);
+    } else if (selector == (Method) __telescope_get_position) {
+        double *ra = va_arg(*app, double *);
+        double *dec = va_arg(*app, double *);
+        double *alt = va_arg(*app, double *);
+        double *az = va_arg(*app, double *);
+        *((int *) result) = ((int (*)(void *, double *, double *, double *, double *)) method)(obj, ra, dec, alt, az);
     } else {
         assert(0);
     }
@@ -2089,10 +2301,20 @@ __Telescope_ctor(void *_self, va_list *app)
             self->t_cap.n_filter = dimension;
             continue;
         }
+        if (strcmp(name, "simulation") == 0) {
+            const struct Simulator *value;
+            value = va_arg(*app, const struct Simulator *);
+            if (value != NULL) {
+                self->simulator = *value;
+            }
+            continue;
+        }
     }
     
     TelescopeState_init(&self->t_state);
     TelescopeParameter_init(&self->t_param);
+    self->t_status.interval = TELESCOPE_STATUS_INTERVAL;
+    Pthread_rwlock_init(&self->t_status.rwlock, NULL);
     
     return (void *) self;
 }
@@ -2134,6 +2356,7 @@ __Telescope_dtor(void *_self)
     free(self->description);
     free(self->name);
     
+    Pthread_rwlock_destroy(&self->t_status.rwlock);
     TelescopeParameter_destroy(&self->t_param);
     TelescopeState_destroy(&self->t_state);
     
@@ -2446,6 +2669,30 @@ __TelescopeClass_ctor(void *_self, va_list *app)
             self->set.method = method;
             continue;
         }
+        if (selector == (Method) __telescope_cached_status) {
+            if (tag) {
+                self->cached_status.tag = tag;
+                self->cached_status.selector = selector;
+            }
+            self->cached_status.method = method;
+            continue;
+        }
+        if (selector == (Method) __telescope_refresh_status) {
+            if (tag) {
+                self->refresh_status.tag = tag;
+                self->refresh_status.selector = selector;
+            }
+            self->refresh_status.method = method;
+            continue;
+        }
+        if (selector == (Method) __telescope_get_position) {
+            if (tag) {
+                self->get_position.tag = tag;
+                self->get_position.selector = selector;
+            }
+            self->get_position.method = method;
+            continue;
+        }
     }
     
 #ifdef va_copy
@@ -2532,6 +2779,9 @@ __Telescope_initialize(void)
                        __telescope_get_focus_length, "get_focus_length", __Telescope_get_focus_length,
                        __telescope_get, "get", __Telescope_get,
                        __telescope_set, "set", __Telescope_set,
+                       __telescope_cached_status, "cached_status", __Telescope_cached_status,
+                       __telescope_refresh_status, "refresh_status", __Telescope_refresh_status,
+                       __telescope_get_position, "get_position", __Telescope_get_position,
                        
                        (void *) 0);
 #ifndef _USE_COMPILER_ATTRIBUTION_
@@ -2568,29 +2818,109 @@ get_current_time(void)
     return tp.tv_sec + tp.tv_nsec / 1000000000.;
 }
 
+/*
+ * Motion state of a virtual telescope.
+ *
+ * Writers modify self->motion while holding t_state.mtx, then publish it with
+ * VirtualTelescope_motion_publish(). Readers copy the published record without
+ * taking any lock, and retry if a writer has published in the meantime.
+ */
 static void
-VirtualTelescope_get_current_postion_r(struct VirtualTelescope *self, double *ra, double *dec, double *alt, double *az)
+VirtualTelescope_motion_publish(struct VirtualTelescope *self)
 {
-    unsigned int state = self->_.t_state.state & (~TELESCOPE_STATE_MALFUNCTION);
-    double current_time = get_current_time();
+    unsigned int seq = self->seq;
+    
+    self->motion.state = self->_.t_state.state;
+    
+    __atomic_store_n(&self->seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    memcpy(&self->snapshot, &self->motion, sizeof(struct VirtualTelescopeMotion));
+    __atomic_store_n(&self->seq, seq + 2, __ATOMIC_RELEASE);
+    __atomic_store_n(&self->_.t_status.stale, 1, __ATOMIC_RELAXED);
+    
+    /*
+     * __Telescope_puto reads the position from t_param.
+     */
+    self->_.t_param.ra = self->motion.ra;
+    self->_.t_param.dec = self->motion.dec;
+    self->_.t_param.alt = self->motion.alt;
+    self->_.t_param.az = self->motion.az;
+}
+
+static void
+VirtualTelescope_motion_read(struct VirtualTelescope *self, struct VirtualTelescopeMotion *motion)
+{
+    unsigned int seq;
+    
+    for (;;) {
+        seq = __atomic_load_n(&self->seq, __ATOMIC_ACQUIRE);
+        if (seq & 1) {
+            sched_yield();
+            continue;
+        }
+        memcpy(motion, &self->snapshot, sizeof(struct VirtualTelescopeMotion));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&self->seq, __ATOMIC_RELAXED) == seq) {
+            break;
+        }
+    }
+}
+
+/*
+ * Position elapsed seconds into a slew. Both axes start together, each on its own profile,
+ * right ascension the shortest way.
+ */
+static void
+VirtualTelescope_slew_position(struct VirtualTelescope *self, const struct VirtualTelescopeMotion *motion, double elapsed, double *ra, double *dec)
+{
+    double distance = fmod(motion->ra_to - motion->ra_from + 540., 360.) - 180.;
+    
+    *ra = fmod(motion->ra_from + simulator_axis_travel(&self->_.simulator.x, motion->slew_speed_x, distance, elapsed) + 360., 360.);
+    *dec = motion->dec_from + simulator_axis_travel(&self->_.simulator.y, motion->slew_speed_y, motion->dec_to - motion->dec_from, elapsed);
+}
+
+static double
+VirtualTelescope_slew_duration(struct VirtualTelescope *self, const struct VirtualTelescopeMotion *motion)
+{
+    double duration_x, duration_y;
+    
+    duration_x = simulator_axis_duration(&self->_.simulator.x, motion->slew_speed_x, fmod(motion->ra_to - motion->ra_from + 540., 360.) - 180.);
+    duration_y = simulator_axis_duration(&self->_.simulator.y, motion->slew_speed_y, motion->dec_to - motion->dec_from);
+    
+    return max(duration_x, duration_y);
+}
+
+/*
+ * Hour angle of (alt, az), in degree, where the limits of the right ascension axis apply.
+ */
+static double
+VirtualTelescope_hour_angle(struct VirtualTelescope *self, double alt, double az)
+{
+    double lat = self->_.location_lat * PI / 180.;
+    
+    alt *= PI / 180.;
+    az *= PI / 180.;
+    
+    return atan2(-cos(alt) * sin(az), sin(alt) * cos(lat) - cos(alt) * cos(az) * sin(lat)) * 180. / PI;
+}
+
+static void
+VirtualTelescope_motion_position(struct VirtualTelescope *self, const struct VirtualTelescopeMotion *motion, double *ra, double *dec, double *alt, double *az)
+{
+    unsigned int state = motion->state & (~TELESCOPE_STATE_MALFUNCTION);
+    double current_time = simulator_time();
     double ra_, dec_;
-    double last_park_begin_time, last_move_begin_time, last_slew_bigin_time, last_track_begin_time, time_diff;
-    double move_speed, slew_speed_x, slew_speed_y;
-    double dec_arrive_time, ra_arrive_time, ra_from, ra_to, dec_from, dec_to;
+    double last_park_begin_time, last_move_begin_time;
+    double move_speed;
     unsigned int move_direction;
-    int slew_direction_x, slew_direction_y;
     
-    Pthread_rwlock_rdlock(&self->_.t_param.position_rwlock);
-    ra_ = self->_.t_param.ra;
-    dec_ = self->_.t_param.dec;
-    Pthread_rwlock_unlock(&self->_.t_param.position_rwlock);
+    ra_ = motion->ra;
+    dec_ = motion->dec;
     
     switch (state) {
         case TELESCOPE_STATE_PARKED:
-            Pthread_rwlock_rdlock(&self->_.t_param.park_begin_rwlock);
-            last_park_begin_time = self->_.t_param.last_park_begin_time;
-            Pthread_rwlock_unlock(&self->_.t_param.park_begin_rwlock);
-            ra_ += SIDEREAL_TRACKING_SPEED * (current_time - self->_.t_param.last_park_begin_time);
+            last_park_begin_time = motion->last_park_begin_time;
+            ra_ += SIDEREAL_TRACKING_SPEED * (current_time - motion->last_park_begin_time);
             if (ra_ >= 360.) {
                 ra_ -= floor(fabs(ra_) / 360.)  * 360.;
             } else if (ra_ < 0.) {
@@ -2600,13 +2930,9 @@ VirtualTelescope_get_current_postion_r(struct VirtualTelescope *self, double *ra
             *dec = dec_;
             break;
         case TELESCOPE_STATE_MOVING:
-            Pthread_rwlock_rdlock(&self->_.t_param.move_begin_rwlock);
-            last_move_begin_time = self->_.t_param.last_move_begin_time;
-            Pthread_rwlock_unlock(&self->_.t_param.move_begin_rwlock);
-            Pthread_rwlock_rdlock(&self->_.t_param.move_speed_rwlock);
-            move_speed = self->_.t_param.move_speed;
-            move_direction = self->_.t_param.move_direction;
-            Pthread_rwlock_unlock(&self->_.t_param.move_speed_rwlock);
+            last_move_begin_time = motion->last_move_begin_time;
+            move_speed = motion->move_speed;
+            move_direction = motion->move_direction;
             switch (move_direction) {
                 case TELESCOPE_MOVE_EAST:
                     ra_ += (move_speed - SIDEREAL_TRACKING_SPEED) * (current_time - last_move_begin_time);
@@ -2618,8 +2944,8 @@ VirtualTelescope_get_current_postion_r(struct VirtualTelescope *self, double *ra
                     break;
                 case TELESCOPE_MOVE_WEST:
                     ra_ -= (move_speed + SIDEREAL_TRACKING_SPEED) * (current_time - last_move_begin_time);
-                    if (self->_.t_param.ra < 0.) {
-                        self->_.t_param.ra += (floor(fabs(self->_.t_param.ra) / 360.) + 1) * 360.;
+                    if (ra_ < 0.) {
+                        ra_ += (floor(fabs(ra_) / 360.) + 1) * 360.;
                     }
                     *ra = ra_;
                     *dec = dec_;
@@ -2663,44 +2989,7 @@ VirtualTelescope_get_current_postion_r(struct VirtualTelescope *self, double *ra
             }
             break;
         case TELESCOPE_STATE_SLEWING:
-            Pthread_rwlock_rdlock(&self->_.t_param.slew_begin_rwlock);
-            last_slew_bigin_time = self->_.t_param.last_slew_begin_time;
-            Pthread_rwlock_unlock(&self->_.t_param.slew_begin_rwlock);
-            Pthread_rwlock_rdlock(&self->_.t_param.slew_speed_rwlock);
-            slew_speed_x = self->_.t_param.slew_speed_x;
-            slew_speed_y = self->_.t_param.slew_speed_y;
-            Pthread_rwlock_unlock(&self->_.t_param.slew_speed_rwlock);
-            Pthread_rwlock_rdlock(&self->_.t_param.slew_rwlock);
-            ra_from = self->_.t_param.ra_from;
-            ra_to = self->_.t_param.ra_to;
-            dec_from = self->_.t_param.dec_from;
-            dec_to = self->_.t_param.dec_to;
-            slew_direction_x = self->_.t_param.slew_direction_x;
-            slew_direction_y = self->_.t_param.slew_direction_y;
-            Pthread_rwlock_unlock(&self->_.t_param.slew_rwlock);
-    
-            time_diff = current_time - last_slew_bigin_time;
-            dec_arrive_time = fabs(dec_to - dec_from) / slew_speed_y;
-            if (time_diff < dec_arrive_time) {
-                dec_ += slew_direction_y * slew_speed_y;
-            } else {
-                dec_ = dec_to;
-            }
-            if (fabs(ra_to - ra_from) > 180.) {
-                ra_arrive_time = (360. - fabs(ra_to - ra_from)) / slew_speed_x;
-            } else {
-                ra_arrive_time = fabs(ra_to - ra_from) / slew_speed_x;
-            }
-            if (time_diff < ra_arrive_time) {
-                ra_ += slew_direction_x * (slew_speed_x - slew_direction_x * SIDEREAL_TRACKING_SPEED);
-                if (ra_ > 360.) {
-                    ra_ -= 360.;
-                } else if (ra_ < 0.) {
-                    ra_ += 360.;
-                }
-            } else {
-                ra_ = ra_to;
-            }
+            VirtualTelescope_slew_position(self, motion, current_time - motion->last_slew_begin_time, &ra_, &dec_);
             *ra = ra_;
             *dec = dec_;
             break;
@@ -2717,65 +3006,73 @@ VirtualTelescope_get_current_postion_r(struct VirtualTelescope *self, double *ra
 }
 
 
+static void
+VirtualTelescope_get_current_postion_r(struct VirtualTelescope *self, double *ra, double *dec, double *alt, double *az)
+{
+    struct VirtualTelescopeMotion motion;
+    
+    VirtualTelescope_motion_read(self, &motion);
+    VirtualTelescope_motion_position(self, &motion, ra, dec, alt, az);
+}
+
 static void
 VirtualTelescope_get_current_postion(struct VirtualTelescope *self)
 {
     unsigned int state = self->_.t_state.state & (~TELESCOPE_STATE_MALFUNCTION);
-    double current_time = get_current_time();
+    double current_time = simulator_time();
     
-    double ra_arrive_time, dec_arrive_time, time_diff;
     switch (state) {
         case TELESCOPE_STATE_PARKED:
-            if (self->_.t_param.dec < 90. && self->_.t_param.dec > -90.) {
-                self->_.t_param.ra += SIDEREAL_TRACKING_SPEED * (current_time - self->_.t_param.last_park_begin_time);
-                if (self->_.t_param.ra >= 360.) {
-                    self->_.t_param.ra -= floor(fabs(self->_.t_param.ra) / 360.)  * 360.;
-                } else if (self->_.t_param.ra < 0.) {
-                    self->_.t_param.ra += (floor(fabs(self->_.t_param.ra) / 360.) + 1) * 360.;
+            if (self->motion.dec < 90. && self->motion.dec > -90.) {
+                self->motion.ra += SIDEREAL_TRACKING_SPEED * (current_time - self->motion.last_park_begin_time);
+                if (self->motion.ra >= 360.) {
+                    self->motion.ra -= floor(fabs(self->motion.ra) / 360.)  * 360.;
+                } else if (self->motion.ra < 0.) {
+                    self->motion.ra += (floor(fabs(self->motion.ra) / 360.) + 1) * 360.;
                 }
             }
             break;
         case TELESCOPE_STATE_MOVING:
-            switch (self->_.t_param.move_direction) {
+            switch (self->motion.move_direction) {
                 case TELESCOPE_MOVE_EAST:
-                    self->_.t_param.ra += (self->_.t_param.move_speed - SIDEREAL_TRACKING_SPEED) * (current_time - self->_.t_param.last_move_begin_time);
-                    if (self->_.t_param.ra >= 360.) {
-                        self->_.t_param.ra -= (floor(fabs(self->_.t_param.ra) / 360.) - 1) * 360.;
+                    self->motion.ra += (self->motion.move_speed - SIDEREAL_TRACKING_SPEED) * (current_time - self->motion.last_move_begin_time);
+                    if (self->motion.ra >= 360.) {
+                        self->motion.ra -= (floor(fabs(self->motion.ra) / 360.) - 1) * 360.;
                     }
                     break;
                 case TELESCOPE_MOVE_WEST:
-                    self->_.t_param.ra -= (self->_.t_param.move_speed + SIDEREAL_TRACKING_SPEED) * (current_time - self->_.t_param.last_move_begin_time);
-                    if (self->_.t_param.ra < 0.) {
-                        self->_.t_param.ra += (floor(fabs(self->_.t_param.ra) / 360.) + 1) * 360.;
+                    self->motion.ra -= (self->motion.move_speed + SIDEREAL_TRACKING_SPEED) * (current_time - self->motion.last_move_begin_time);
+                    if (self->motion.ra < 0.) {
+                        self->motion.ra += (floor(fabs(self->motion.ra) / 360.) + 1) * 360.;
                     }
                     break;
                 case TELESCOPE_MOVE_NORTH:
-                    self->_.t_param.dec += self->_.t_param.move_speed * (current_time - self->_.t_param.last_move_begin_time);
-                    if (self->_.t_param.dec > 90.) {
-                        self->_.t_param.dec -= floor(fabs(self->_.t_param.dec) / 360.) * 360.;
-                        if (self->_.t_param.dec > 90. && self->_.t_param.dec <= 270.) {
-                            self->_.t_param.dec = 180. - self->_.t_param.dec;
-                            self->_.t_param.ra += 180.;
-                            if (self->_.t_param.ra >= 360.) {
-                                self->_.t_param.ra -= 360.;
+                    self->motion.dec += self->motion.move_speed * (current_time - self->motion.last_move_begin_time);
+                    if (self->motion.dec > 90.) {
+                        self->motion.dec -= floor(fabs(self->motion.dec) / 360.) * 360.;
+                        if (self->motion.dec > 90. && self->motion.dec <= 270.) {
+                            self->motion.dec = 180. - self->motion.dec;
+                            self->motion.ra += 180.;
+                            if (self->motion.ra >= 360.) {
+                                self->motion.ra -= 360.;
                             }
-                        } else if (self->_.t_param.dec > 270.) {
-                            self->_.t_param.dec *= 360. - self->_.t_param.dec;
+                        } else if (self->motion.dec > 270.) {
+                            self->motion.dec *= 360. - self->motion.dec;
                         }
                     }
                     break;
                 case TELESCOPE_MOVE_SOUTH:
-                    self->_.t_param.dec -= self->_.t_param.move_speed * (current_time - self->_.t_param.last_move_begin_time);
-                    if (self->_.t_param.dec < -90.) {
-                        self->_.t_param.dec += floor(fabs(self->_.t_param.dec) / 360. + 1) * 360.;
-                        if (self->_.t_param.dec > 90. && self->_.t_param.dec <= 270.) {
-                            self->_.t_param.dec = 180. - self->_.t_param.dec;
-                            self->_.t_param.ra += 180.;
-                            if (self->_.t_param.ra >= 360.) {
-                                self->_.t_param.ra -= 360.;
+                    self->motion.dec -= self->motion.move_speed * (current_time - self->motion.last_move_begin_time);
+                    if (self->motion.dec < -90.) {
+                        self->motion.dec += floor(fabs(self->motion.dec) / 360. + 1) * 360.;
+                        if (self->motion.dec > 90. && self->motion.dec <= 270.) {
+                            self->motion.dec = 180. - self->motion.dec;
+                            self->motion.ra += 180.;
+                            if (self->motion.ra >= 360.) {
+                                self->motion.ra -= 360.;
                             }
-                        } else if (self->_.t_param.dec > 270.) {
-                            self->_.t_param.dec *= 360. - self->_.t_param.dec;
+                        } else if (self->motion.dec > 270.) {
+                            self->motion.dec *= 360. - self->motion.dec;
                         }
                     }
                     break;
@@ -2784,28 +3081,7 @@ VirtualTelescope_get_current_postion(struct VirtualTelescope *self)
             }
             break;
         case TELESCOPE_STATE_SLEWING:
-            time_diff = current_time - self->_.t_param.last_slew_begin_time;
-            dec_arrive_time = fabs(self->_.t_param.dec_to - self->_.t_param.dec_from) / self->_.t_param.slew_speed_y;
-            if (time_diff < dec_arrive_time) {
-                self->_.t_param.dec += self->_.t_param.slew_direction_y * self->_.t_param.slew_speed_y;
-            } else {
-                self->_.t_param.dec = self->_.t_param.dec_to;
-            }
-            if (fabs(self->_.t_param.ra_to - self->_.t_param.ra_from) > 180.) {
-                ra_arrive_time = (360. - fabs(self->_.t_param.ra_to - self->_.t_param.ra_from)) / self->_.t_param.slew_speed_x;
-            } else {
-                ra_arrive_time = fabs(self->_.t_param.ra_to - self->_.t_param.ra_from) / self->_.t_param.slew_speed_x;
-            }
-            if (time_diff < ra_arrive_time) {
-                self->_.t_param.ra += self->_.t_param.slew_direction_x * (self->_.t_param.slew_speed_x - self->_.t_param.slew_direction_x * SIDEREAL_TRACKING_SPEED);
-                if (self->_.t_param.ra > 360.) {
-                    self->_.t_param.ra -= 360.;
-                } else if (self->_.t_param.ra < 0.) {
-                    self->_.t_param.ra= 360. + self->_.t_param.ra;
-                }
-            } else {
-                self->_.t_param.ra = self->_.t_param.ra_to;
-            }
+            VirtualTelescope_slew_position(self, &self->motion, current_time - self->motion.last_slew_begin_time, &self->motion.ra, &self->motion.dec);
             break;
         default:
             break;
@@ -2813,7 +3089,7 @@ VirtualTelescope_get_current_postion(struct VirtualTelescope *self)
     
     double jul_d = jd(current_time);
 
-    radec2altaz(jul_d, self->_.t_param.ra, self->_.t_param.dec, self->_.location_lon, self->_.location_lat, self->_.location_ele, -1., -300., &self->_.t_param.alt, &self->_.t_param.az, NULL);
+    radec2altaz(jul_d, self->motion.ra, self->motion.dec, self->_.location_lon, self->_.location_lat, self->_.location_ele, -1., -300., &self->motion.alt, &self->motion.az, NULL);
     
 }
 
@@ -2821,26 +3097,92 @@ static void *
 motor_thr(void *arg)
 {
     double sleep_time = *((double *) arg);
-    struct timespec tp;
     
-    tp.tv_sec = floor(sleep_time);
-    tp.tv_nsec = (sleep_time - tp.tv_sec) * 1000000000;
-    nanosleep(&tp, NULL);
+    simulator_sleep(sleep_time);
     
     return NULL;
 }
 
+/*
+ * Called with t_state.mtx held, returns with it released.
+ */
 static int
-VirtualTelescope_status_json(struct VirtualTelescope *self, void *res, size_t res_size,  size_t *res_len)
+VirtualTelescope_slew_nl(struct VirtualTelescope *self, double ra, double dec, unsigned int flag)
 {
-    double ra, dec, az, alt;
-    unsigned int state, flag;
+    double ra_, dec_, alt, az, duration;
+    void *value = NULL;
+    int fault, ret = AAOS_OK;
+    
+    radec2altaz(jd(simulator_time()), ra, dec, self->_.location_lon, self->_.location_lat, self->_.location_ele, -1., -300., &alt, &az, NULL);
+    if (simulator_axis_check(&self->_.simulator.x, VirtualTelescope_hour_angle(self, alt, az)) != AAOS_OK || simulator_axis_check(&self->_.simulator.y, dec) != AAOS_OK) {
+        Pthread_mutex_unlock(&self->_.t_state.mtx);
+        return AAOS_EINVAL;
+    }
+    fault = simulator_fault_move(&self->_.simulator.fault);
+    if (fault == SIMULATOR_FAULT_TIMEOUT) {
+        Pthread_mutex_unlock(&self->_.t_state.mtx);
+        simulator_sleep(self->_.simulator.fault.timeout_after > 0. ? self->_.simulator.fault.timeout_after : SIMULATOR_TIMEOUT_AFTER);
+        return AAOS_ETIMEDOUT;
+    }
     
+    VirtualTelescope_get_current_postion_r(self, &ra_, &dec_, &alt, &az);
+    self->_.t_state.state = TELESCOPE_STATE_SLEWING | flag;
+    
+    self->motion.ra_from = ra_;
+    self->motion.dec_from = dec_;
+    self->motion.ra_to = ra;
+    self->motion.dec_to = dec;
+    if ((ra - ra_ > 0. && ra - ra_  <= 180.) || (ra - ra_ <= -180.)) {
+        self->motion.slew_direction_x = 1;
+    } else {
+        self->motion.slew_direction_x = -1;
+    }
+    self->motion.slew_direction_y = (dec > dec_) ? 1 : -1;
+    
+    self->motion.last_slew_begin_time = simulator_time();
+    VirtualTelescope_motion_publish(self);
+    
+    duration = VirtualTelescope_slew_duration(self, &self->motion);
+    if (fault == SIMULATOR_FAULT_STALL) {
+        duration *= simulator_fault_stall_fraction(&self->_.simulator.fault);
+    }
+    Pthread_create(&self->_.tid, NULL, motor_thr, &duration);
+    Pthread_mutex_unlock(&self->_.t_state.mtx);
+    
+    Pthread_join(self->_.tid, &value);
+    if (value == PTHREAD_CANCELED) {
+        return AAOS_ECANCELED;
+    }
+    /*
+     * sleeping, update ra and dec, update last_park_off time
+     */
     Pthread_mutex_lock(&self->_.t_state.mtx);
-    state = self->_.t_state.state;
-    VirtualTelescope_get_current_postion_r(self, &ra, &dec, &alt, &az);
+    if (fault == SIMULATOR_FAULT_STALL) {
+        VirtualTelescope_slew_position(self, &self->motion, duration, &ra, &dec);
+        ret = AAOS_EDEVMAL;
+    }
+    self->motion.ra = ra;
+    self->motion.dec = dec;
+    self->motion.last_track_begin_time = simulator_time();
+    self->_.t_state.state = TELESCOPE_STATE_TRACKING | flag;
+    VirtualTelescope_motion_publish(self);
+    __Telescope_state_broadcast(&self->_);
     Pthread_mutex_unlock(&self->_.t_state.mtx);
     
+    return ret;
+}
+
+static int
+VirtualTelescope_status_json(struct VirtualTelescope *self, void *res, size_t res_size,  size_t *res_len)
+{
+    struct VirtualTelescopeMotion motion;
+    double ra = 0., dec = 0., az = 0., alt = 0.;
+    unsigned int state, flag;
+    
+    VirtualTelescope_motion_read(self, &motion);
+    state = motion.state;
+    VirtualTelescope_motion_position(self, &motion, &ra, &dec, &alt, &az);
+    
     flag = state & TELESCOPE_STATE_MALFUNCTION;
     state = state & (~TELESCOPE_STATE_MALFUNCTION);
     
@@ -2909,9 +3251,29 @@ VirtualTelescope_status(void *_self, void *res, size_t res_size,  size_t *res_le
     fclose(fp);
      */
     
+    /*
+     * A garbled reply.
+     */
+    if (simulator_fault_noise(&self->_.simulator.fault)) {
+        return AAOS_EBADMSG;
+    }
+    
     return VirtualTelescope_status_json(self, res, res_size, res_len);
 }
 
+static int
+VirtualTelescope_get_position(void *_self, double *ra, double *dec, double *alt, double *az)
+{
+    struct VirtualTelescope *self = cast(VirtualTelescope(), _self);
+    
+    struct VirtualTelescopeMotion motion;
+    
+    VirtualTelescope_motion_read(self, &motion);
+    VirtualTelescope_motion_position(self, &motion, ra, dec, alt, az);
+    
+    return AAOS_OK;
+}
+
 static int
 VirtualTelescope_info_json(struct VirtualTelescope *self, void *res, size_t res_size,  size_t *res_len)
 {
@@ -3089,6 +3451,7 @@ VirtualTelescope_power_on(void *_self)
     switch (state) {
         case TELESCOPE_STATE_POWERED_OFF:
             self->_.t_state.state = TELESCOPE_STATE_UNINITIALIZED | flag;
+            VirtualTelescope_motion_publish(self);
             break;
         default:
             break;
@@ -3119,6 +3482,7 @@ VirtualTelescope_power_off(void *_self)
             break;
     }
     self->_.t_state.state = TELESCOPE_STATE_POWERED_OFF | flag;
+    VirtualTelescope_motion_publish(self);
     Pthread_mutex_unlock(&self->_.t_state.mtx);
     
     return AAOS_OK;
@@ -3129,22 +3493,21 @@ VirtualTelescope_init(void *_self)
 {
     struct VirtualTelescope *self = cast(VirtualTelescope(), _self);
     
-    self->_.t_param.ra = 0.0000001;
-    self->_.t_param.dec = 90.;
-    
-    double current_time = get_current_time();
+    double current_time = simulator_time();
     double jul_d = jd(current_time);
-
-    radec2altaz(jul_d, self->_.t_param.ra, self->_.t_param.dec, self->_.location_lon, self->_.location_lat, self->_.location_ele, -1., -300., &self->_.t_param.alt, &self->_.t_param.az, NULL);
-
+    
+    Pthread_mutex_lock(&self->_.t_state.mtx);
+    self->motion.ra = 0.0000001;
+    self->motion.dec = 90.;
+    radec2altaz(jul_d, self->motion.ra, self->motion.dec, self->_.location_lon, self->_.location_lat, self->_.location_ele, -1., -300., &self->motion.alt, &self->motion.az, NULL);
     
     self->_.t_param.track_rate_x = SIDEREAL_TRACKING_SPEED;
     self->_.t_param.track_rate_y = 0.;
-    self->_.t_param.slew_speed_x = SIDEREAL_TRACKING_SPEED * 1200.;
-    self->_.t_param.slew_speed_y = SIDEREAL_TRACKING_SPEED * 1200.;
-    self->_.t_param.move_speed = SIDEREAL_TRACKING_SPEED * 1200.;
+    self->motion.slew_speed_x = SIDEREAL_TRACKING_SPEED * 1200.;
+    self->motion.slew_speed_y = SIDEREAL_TRACKING_SPEED * 1200.;
+    self->motion.move_speed = SIDEREAL_TRACKING_SPEED * 1200.;
+    VirtualTelescope_motion_publish(self);
     
-    Pthread_mutex_lock(&self->_.t_state.mtx);
     unsigned int state = self->_.t_state.state & (~TELESCOPE_STATE_MALFUNCTION);
     unsigned int flag = state & TELESCOPE_STATE_MALFUNCTION;
     if (!(self->_.option&TELESCOPE_OPTION_IGNORE_MALFUNCTION) && flag) {
@@ -3154,7 +3517,8 @@ VirtualTelescope_init(void *_self)
     switch (state) {
         case TELESCOPE_STATE_UNINITIALIZED:
             self->_.t_state.state = TELESCOPE_STATE_PARKED | flag;
-	    self->_.t_param.last_park_begin_time = get_current_time();
+            self->motion.last_park_begin_time = simulator_time();
+            VirtualTelescope_motion_publish(self);
             break;
         default:
             Pthread_mutex_unlock(&self->_.t_state.mtx);
@@ -3199,17 +3563,16 @@ VirtualTelescope_stop(void *_self)
         case TELESCOPE_STATE_SLEWING:
         case TELESCOPE_STATE_TRACKING_WAIT:
             VirtualTelescope_get_current_postion_r(self, &ra, &dec, &alt, &az);
-            Pthread_rwlock_wrlock(&self->_.t_param.position_rwlock);
-            self->_.t_param.ra = ra;
-            self->_.t_param.dec = dec;
-            self->_.t_param.az = az;
-            self->_.t_param.alt = alt;
-            Pthread_rwlock_unlock(&self->_.t_param.position_rwlock);
+            self->motion.ra = ra;
+            self->motion.dec = dec;
+            self->motion.az = az;
+            self->motion.alt = alt;
             
             Pthread_cancel(self->_.tid);
             self->_.t_state.state = TELESCOPE_STATE_TRACKING | flag;
+            VirtualTelescope_motion_publish(self);
+            __Telescope_state_broadcast(&self->_);
             Pthread_mutex_unlock(&self->_.t_state.mtx);
-            Pthread_cond_broadcast(&self->_.t_state.cond);
             return AAOS_OK;
             break;
         default:
@@ -3267,12 +3630,10 @@ VirtualTelescope_move(void *_self, unsigned int direction, double duration)
                     break;
                 case TELESCOPE_STATE_PARKED:
                     VirtualTelescope_get_current_postion_r(self, &ra, &dec, &alt, &az);
-                    Pthread_rwlock_wrlock(&self->_.t_param.position_rwlock);
-                    self->_.t_param.ra = ra;
-                    self->_.t_param.dec = dec;
-                    self->_.t_param.az = az;
-                    self->_.t_param.alt = alt;
-                    Pthread_rwlock_unlock(&self->_.t_param.position_rwlock);
+                    self->motion.ra = ra;
+                    self->motion.dec = dec;
+                    self->motion.az = az;
+                    self->motion.alt = alt;
                     break;
                 case TELESCOPE_STATE_TRACKING:
                     break;
@@ -3299,11 +3660,10 @@ VirtualTelescope_move(void *_self, unsigned int direction, double duration)
         default:
             break;
     }
-    Pthread_rwlock_wrlock(&self->_.t_param.move_begin_rwlock);
-    self->_.t_param.last_move_begin_time = get_current_time();
-    self->_.t_param.move_direction = direction;
-    Pthread_rwlock_unlock(&self->_.t_param.move_begin_rwlock);
+    self->motion.last_move_begin_time = simulator_time();
+    self->motion.move_direction = direction;
     self->_.t_state.state = TELESCOPE_STATE_MOVING | flag;
+    VirtualTelescope_motion_publish(self);
     Pthread_create(&self->_.tid, NULL, motor_thr, &duration);
     Pthread_mutex_unlock(&self->_.t_state.mtx);
     
@@ -3315,19 +3675,16 @@ VirtualTelescope_move(void *_self, unsigned int direction, double duration)
      * sleeping, update ra and dec, update current position, last tracking begin time.
      */
     Pthread_mutex_lock(&self->_.t_state.mtx);
-    Pthread_rwlock_wrlock(&self->_.t_param.track_begin_rwlock);
-    self->_.t_param.last_track_begin_time = get_current_time();
-    Pthread_rwlock_unlock(&self->_.t_param.track_begin_rwlock);
+    self->motion.last_track_begin_time = simulator_time();
     VirtualTelescope_get_current_postion_r(self, &ra, &dec, &alt, &az);
-    Pthread_rwlock_wrlock(&self->_.t_param.position_rwlock);
-    self->_.t_param.ra = ra;
-    self->_.t_param.dec = dec;
-    self->_.t_param.az = az;
-    self->_.t_param.alt = alt;
-    Pthread_rwlock_unlock(&self->_.t_param.position_rwlock);
+    self->motion.ra = ra;
+    self->motion.dec = dec;
+    self->motion.az = az;
+    self->motion.alt = alt;
     self->_.t_state.state = TELESCOPE_STATE_TRACKING | flag;
+    VirtualTelescope_motion_publish(self);
+    __Telescope_state_broadcast(&self->_);
     Pthread_mutex_unlock(&self->_.t_state.mtx);
-    Pthread_cond_broadcast(&self->_.t_state.cond);
     
     return AAOS_OK;
 }
@@ -3370,23 +3727,20 @@ VirtualTelescope_try_move(void *_self, unsigned int direction, double duration)
             break;
         case TELESCOPE_STATE_PARKED:
             VirtualTelescope_get_current_postion_r(self, &ra, &dec, &alt, &az);
-            Pthread_rwlock_wrlock(&self->_.t_param.position_rwlock);
-            self->_.t_param.ra = ra;
-            self->_.t_param.dec = dec;
-            self->_.t_param.az = az;
-            self->_.t_param.alt = alt;
-            Pthread_rwlock_unlock(&self->_.t_param.position_rwlock);
+            self->motion.ra = ra;
+            self->motion.dec = dec;
+            self->motion.az = az;
+            self->motion.alt = alt;
             break;
         case TELESCOPE_STATE_TRACKING:
             break;
         default:
             break;
     }
-    Pthread_rwlock_wrlock(&self->_.t_param.move_begin_rwlock);
-    self->_.t_param.last_move_begin_time = get_current_time();
-    self->_.t_param.move_direction = direction;
-    Pthread_rwlock_unlock(&self->_.t_param.move_begin_rwlock);
+    self->motion.last_move_begin_time = simulator_time();
+    self->motion.move_direction = direction;
     self->_.t_state.state = TELESCOPE_STATE_MOVING | flag;
+    VirtualTelescope_motion_publish(self);
     Pthread_create(&self->_.tid, NULL, motor_thr, &duration);
     Pthread_mutex_unlock(&self->_.t_state.mtx);
     
@@ -3398,19 +3752,16 @@ VirtualTelescope_try_move(void *_self, unsigned int direction, double duration)
      * sleeping, update ra and dec, update current position, last tracking begin time.
      */
     Pthread_mutex_lock(&self->_.t_state.mtx);
-    Pthread_rwlock_wrlock(&self->_.t_param.track_begin_rwlock);
-    self->_.t_param.last_track_begin_time = get_current_time();
-    Pthread_rwlock_unlock(&self->_.t_param.track_begin_rwlock);
+    self->motion.last_track_begin_time = simulator_time();
     VirtualTelescope_get_current_postion_r(self, &ra, &dec, &alt, &az);
-    Pthread_rwlock_wrlock(&self->_.t_param.position_rwlock);
-    self->_.t_param.ra = ra;
-    self->_.t_param.dec = dec;
-    self->_.t_param.az = az;
-    self->_.t_param.alt = alt;
-    Pthread_rwlock_unlock(&self->_.t_param.position_rwlock);
+    self->motion.ra = ra;
+    self->motion.dec = dec;
+    self->motion.az = az;
+    self->motion.alt = alt;
     self->_.t_state.state = TELESCOPE_STATE_TRACKING | flag;
+    VirtualTelescope_motion_publish(self);
+    __Telescope_state_broadcast(&self->_);
     Pthread_mutex_unlock(&self->_.t_state.mtx);
-    Pthread_cond_broadcast(&self->_.t_state.cond);
     
     return AAOS_OK;
 }
@@ -3429,7 +3780,7 @@ VirtualTelescope_timed_move(void *_self, unsigned int direction, double duration
         return AAOS_EINVAL;
     }
     
-    timeout += get_current_time();
+    timeout = timeout / simulator_get_time_scale() + get_current_time();
     tp.tv_sec = floor(timeout);
     tp.tv_nsec = (timeout - tp.tv_sec) * 1000000000.;
     
@@ -3489,23 +3840,20 @@ VirtualTelescope_timed_move(void *_self, unsigned int direction, double duration
             break;
         case TELESCOPE_STATE_PARKED:
             VirtualTelescope_get_current_postion_r(self, &ra, &dec, &alt, &az);
-            Pthread_rwlock_wrlock(&self->_.t_param.position_rwlock);
-            self->_.t_param.ra = ra;
-            self->_.t_param.dec = dec;
-            self->_.t_param.az = az;
-            self->_.t_param.alt = alt;
-            Pthread_rwlock_unlock(&self->_.t_param.position_rwlock);
+            self->motion.ra = ra;
+            self->motion.dec = dec;
+            self->motion.az = az;
+            self->motion.alt = alt;
             break;
         case TELESCOPE_STATE_TRACKING:
             break;
         default:
             break;
     }
-    Pthread_rwlock_wrlock(&self->_.t_param.move_begin_rwlock);
-    self->_.t_param.last_move_begin_time = get_current_time();
-    self->_.t_param.move_direction = direction;
-    Pthread_rwlock_unlock(&self->_.t_param.move_begin_rwlock);
+    self->motion.last_move_begin_time = simulator_time();
+    self->motion.move_direction = direction;
     self->_.t_state.state = TELESCOPE_STATE_MOVING | flag;
+    VirtualTelescope_motion_publish(self);
     Pthread_create(&self->_.tid, NULL, motor_thr, &duration);
     Pthread_mutex_unlock(&self->_.t_state.mtx);
     
@@ -3517,19 +3865,16 @@ VirtualTelescope_timed_move(void *_self, unsigned int direction, double duration
      * sleeping, update ra and dec, update current position, last tracking begin time.
      */
     Pthread_mutex_lock(&self->_.t_state.mtx);
-    Pthread_rwlock_wrlock(&self->_.t_param.track_begin_rwlock);
-    self->_.t_param.last_track_begin_time = get_current_time();
-    Pthread_rwlock_unlock(&self->_.t_param.track_begin_rwlock);
+    self->motion.last_track_begin_time = simulator_time();
     VirtualTelescope_get_current_postion_r(self, &ra, &dec, &alt, &az);
-    Pthread_rwlock_wrlock(&self->_.t_param.position_rwlock);
-    self->_.t_param.ra = ra;
-    self->_.t_param.dec = dec;
-    self->_.t_param.az = az;
-    self->_.t_param.alt = alt;
-    Pthread_rwlock_unlock(&self->_.t_param.position_rwlock);
+    self->motion.ra = ra;
+    self->motion.dec = dec;
+    self->motion.az = az;
+    self->motion.alt = alt;
     self->_.t_state.state = TELESCOPE_STATE_TRACKING | flag;
+    VirtualTelescope_motion_publish(self);
+    __Telescope_state_broadcast(&self->_);
     Pthread_mutex_unlock(&self->_.t_state.mtx);
-    Pthread_cond_broadcast(&self->_.t_state.cond);
     
     return AAOS_OK;
 }
@@ -3539,11 +3884,6 @@ VirtualTelescope_slew(void *_self, double ra, double dec)
 {
     struct VirtualTelescope *self = cast(VirtualTelescope(), _self);
     
-    double time_diff_ra, time_diff_dec, time_diff, ra_diff;
-    double slew_speed_x, slew_speed_y;
-    double ra_, dec_, az, alt;
-    void *value = NULL;
-    
     Pthread_mutex_lock(&self->_.t_state.mtx);
     unsigned int state = self->_.t_state.state & (~TELESCOPE_STATE_MALFUNCTION);
     unsigned int flag = self->_.t_state.state & TELESCOPE_STATE_MALFUNCTION;
@@ -3609,63 +3949,7 @@ VirtualTelescope_slew(void *_self, double ra, double dec)
         default:
             break;
     }
-    VirtualTelescope_get_current_postion_r(self, &ra_, &dec_, &alt, &az);
-    
-    self->_.t_state.state = TELESCOPE_STATE_SLEWING | flag;
-    
-    Pthread_rwlock_wrlock(&self->_.t_param.slew_rwlock);
-    self->_.t_param.ra_from = ra_;
-    self->_.t_param.dec_from = dec_;
-    self->_.t_param.ra_to = ra;
-    self->_.t_param.dec_to = dec;
-    if ((ra - ra_ > 0. && ra - ra_  <= 180.) || (ra - ra_ <= -180.)) {
-        self->_.t_param.slew_direction_x = 1;
-    } else {
-        self->_.t_param.slew_direction_x = -1;
-    }
-    self->_.t_param.slew_direction_y = (dec > dec_) ? 1 : -1;
-    Pthread_rwlock_unlock(&self->_.t_param.slew_rwlock);
-    
-    Pthread_rwlock_wrlock(&self->_.t_param.slew_begin_rwlock);
-    self->_.t_param.last_slew_begin_time = get_current_time();
-    Pthread_rwlock_unlock(&self->_.t_param.slew_begin_rwlock);
-    
-    Pthread_rwlock_rdlock(&self->_.t_param.slew_speed_rwlock);
-    slew_speed_x = self->_.t_param.slew_speed_x;
-    slew_speed_y = self->_.t_param.slew_speed_y;
-    Pthread_rwlock_unlock(&self->_.t_param.slew_speed_rwlock);
-    
-    
-    ra_diff = fabs(ra - ra_);
-    ra_diff = ra_diff < 180. ? ra_diff : 360. - ra_diff;
-    time_diff_ra = ra_diff / (slew_speed_x - slew_speed_x * SIDEREAL_TRACKING_SPEED);
-    time_diff_dec = fabs(dec - dec_) / slew_speed_y;
-    time_diff = max(time_diff_ra, time_diff_dec);
-
-    Pthread_create(&self->_.tid, NULL, motor_thr, &time_diff);
-    Pthread_mutex_unlock(&self->_.t_state.mtx);
-    
-    Pthread_join(self->_.tid, &value);
-    if (value == PTHREAD_CANCELED) {
-        return AAOS_ECANCELED;
-    }
-    /*
-     * sleeping, update ra and dec, update last_park_off time 
-     */
-    Pthread_rwlock_wrlock(&self->_.t_param.position_rwlock);
-    self->_.t_param.ra = ra;
-    self->_.t_param.dec = dec;
-    Pthread_rwlock_unlock(&self->_.t_param.position_rwlock);
-    Pthread_rwlock_wrlock(&self->_.t_param.track_begin_rwlock);
-    self->_.t_param.last_track_begin_time = get_current_time();
-    Pthread_rwlock_unlock(&self->_.t_param.track_begin_rwlock);
-    
-    Pthread_mutex_lock(&self->_.t_state.mtx);
-    self->_.t_state.state = TELESCOPE_STATE_TRACKING | flag;
-    Pthread_mutex_unlock(&self->_.t_state.mtx);
-    Pthread_cond_broadcast(&self->_.t_state.cond);
-
-    return AAOS_OK;
+    return VirtualTelescope_slew_nl(self, ra, dec, flag);
 }
 
 static int
@@ -3673,11 +3957,6 @@ VirtualTelescope_try_slew(void *_self, double ra, double dec)
 {
     struct VirtualTelescope *self = cast(VirtualTelescope(), _self);
     
-    double time_diff_ra, time_diff_dec, time_diff, ra_diff;
-    double slew_speed_x, slew_speed_y;
-    double ra_, dec_, az, alt;
-    void *value = NULL;
-    
     if (Pthread_mutex_trylock(&self->_.t_state.mtx) != 0) {
         return AAOS_EBUSY;
     }
@@ -3713,61 +3992,7 @@ VirtualTelescope_try_slew(void *_self, double ra, double dec)
         default:
             break;
     }
-    VirtualTelescope_get_current_postion_r(self, &ra_, &dec_, &alt, &az);
-    self->_.t_state.state = TELESCOPE_STATE_SLEWING | flag;
-    
-    Pthread_rwlock_wrlock(&self->_.t_param.slew_rwlock);
-    self->_.t_param.ra_from = ra_;
-    self->_.t_param.dec_from = dec_;
-    self->_.t_param.ra_to = ra;
-    self->_.t_param.dec_to = dec;
-    if ((ra - ra_ > 0. && ra - ra_  <= 180.) || (ra - ra_ <= -180.)) {
-        self->_.t_param.slew_direction_x = 1;
-    } else {
-        self->_.t_param.slew_direction_x = -1;
-    }
-    self->_.t_param.slew_direction_y = (dec > dec_) ? 1 : -1;
-    Pthread_rwlock_unlock(&self->_.t_param.slew_rwlock);
-    
-    Pthread_rwlock_wrlock(&self->_.t_param.slew_begin_rwlock);
-    self->_.t_param.last_slew_begin_time = get_current_time();
-    Pthread_rwlock_unlock(&self->_.t_param.slew_begin_rwlock);
-    
-    Pthread_rwlock_rdlock(&self->_.t_param.slew_speed_rwlock);
-    slew_speed_x = self->_.t_param.slew_speed_x;
-    slew_speed_y = self->_.t_param.slew_speed_y;
-    Pthread_rwlock_unlock(&self->_.t_param.slew_speed_rwlock);
-    
-    
-    ra_diff = fabs(ra - ra_);
-    ra_diff = ra_diff < 180. ? ra_diff : 360. - ra_diff;
-    time_diff_ra = ra_diff / (slew_speed_x - slew_speed_x * SIDEREAL_TRACKING_SPEED);
-    time_diff_dec = fabs(dec - dec_) / slew_speed_y;
-    time_diff = max(time_diff_ra, time_diff_dec);
-    Pthread_create(&self->_.tid, NULL, motor_thr, &time_diff);
-    Pthread_mutex_unlock(&self->_.t_state.mtx);
-    
-    Pthread_join(self->_.tid, &value);
-    if (value == PTHREAD_CANCELED) {
-        return AAOS_ECANCELED;
-    }
-    /*
-     * sleeping, update ra and dec, update last_park_off time
-     */
-    Pthread_rwlock_wrlock(&self->_.t_param.position_rwlock);
-    self->_.t_param.ra = ra;
-    self->_.t_param.dec = dec;
-    Pthread_rwlock_unlock(&self->_.t_param.position_rwlock);
-    Pthread_rwlock_wrlock(&self->_.t_param.track_begin_rwlock);
-    self->_.t_param.last_track_begin_time = get_current_time();
-    Pthread_rwlock_unlock(&self->_.t_param.track_begin_rwlock);
-    
-    Pthread_mutex_lock(&self->_.t_state.mtx);
-    self->_.t_state.state = TELESCOPE_STATE_TRACKING | flag;
-    Pthread_mutex_unlock(&self->_.t_state.mtx);
-    Pthread_cond_broadcast(&self->_.t_state.cond);
-    
-    return AAOS_OK;
+    return VirtualTelescope_slew_nl(self, ra, dec, flag);
 }
 
 static int
@@ -3775,17 +4000,13 @@ VirtualTelescope_timed_slew(void *_self, double ra, double dec, double timeout)
 {
     struct VirtualTelescope *self = cast(VirtualTelescope(), _self);
     
-    double time_diff_ra, time_diff_dec, time_diff, ra_diff;
-    double slew_speed_x, slew_speed_y;
-    double ra_, dec_, az, alt;
-    void *value = NULL;
     struct timespec tp;
     
     if (timeout <= 0.) {
         return AAOS_EINVAL;
     }
     
-    timeout += get_current_time();
+    timeout = timeout / simulator_get_time_scale() + get_current_time();
     tp.tv_sec = floor(timeout);
     tp.tv_nsec = (timeout - tp.tv_sec) * 1000000000.;
     
@@ -3854,61 +4075,7 @@ VirtualTelescope_timed_slew(void *_self, double ra, double dec, double timeout)
         default:
             break;
     }
-    VirtualTelescope_get_current_postion_r(self, &ra_, &dec_, &alt, &az);
-    self->_.t_state.state = TELESCOPE_STATE_SLEWING | flag;
-    
-    Pthread_rwlock_wrlock(&self->_.t_param.slew_rwlock);
-    self->_.t_param.ra_from = ra_;
-    self->_.t_param.dec_from = dec_;
-    self->_.t_param.ra_to = ra;
-    self->_.t_param.dec_to = dec;
-    if ((ra - ra_ > 0. && ra - ra_  <= 180.) || (ra - ra_ <= -180.)) {
-        self->_.t_param.slew_direction_x = 1;
-    } else {
-        self->_.t_param.slew_direction_x = -1;
-    }
-    self->_.t_param.slew_direction_y = (dec > dec_) ? 1 : -1;
-    Pthread_rwlock_unlock(&self->_.t_param.slew_rwlock);
-    
-    Pthread_rwlock_wrlock(&self->_.t_param.slew_begin_rwlock);
-    self->_.t_param.last_slew_begin_time = get_current_time();
-    Pthread_rwlock_unlock(&self->_.t_param.slew_begin_rwlock);
-    
-    Pthread_rwlock_rdlock(&self->_.t_param.slew_speed_rwlock);
-    slew_speed_x = self->_.t_param.slew_speed_x;
-    slew_speed_y = self->_.t_param.slew_speed_y;
-    Pthread_rwlock_unlock(&self->_.t_param.slew_speed_rwlock);
-    
-    
-    ra_diff = fabs(ra - ra_);
-    ra_diff = ra_diff < 180. ? ra_diff : 360. - ra_diff;
-    time_diff_ra = ra_diff / (slew_speed_x - slew_speed_x * SIDEREAL_TRACKING_SPEED);
-    time_diff_dec = fabs(dec - dec_) / slew_speed_y;
-    time_diff = max(time_diff_ra, time_diff_dec);
-    Pthread_create(&self->_.tid, NULL, motor_thr, &time_diff);
-    Pthread_mutex_unlock(&self->_.t_state.mtx);
-    
-    Pthread_join(self->_.tid, &value);
-    if (value == PTHREAD_CANCELED) {
-        return AAOS_ECANCELED;
-    }
-    /*
-     * sleeping, update ra and dec, update last_park_off time
-     */
-    Pthread_rwlock_wrlock(&self->_.t_param.position_rwlock);
-    self->_.t_param.ra = ra;
-    self->_.t_param.dec = dec;
-    Pthread_rwlock_unlock(&self->_.t_param.position_rwlock);
-    Pthread_rwlock_wrlock(&self->_.t_param.track_begin_rwlock);
-    self->_.t_param.last_track_begin_time = get_current_time();
-    Pthread_rwlock_unlock(&self->_.t_param.track_begin_rwlock);
-    
-    Pthread_mutex_lock(&self->_.t_state.mtx);
-    self->_.t_state.state = TELESCOPE_STATE_TRACKING | flag;
-    Pthread_mutex_unlock(&self->_.t_state.mtx);
-    Pthread_cond_broadcast(&self->_.t_state.cond);
-    
-    return AAOS_OK;
+    return VirtualTelescope_slew_nl(self, ra, dec, flag);
 }
 
 static int
@@ -3932,17 +4099,17 @@ VirtualTelescope_park(void *_self)
             break;
         case TELESCOPE_STATE_TRACKING:
             self->_.t_state.state = TELESCOPE_STATE_PARKED | flag;
-            Pthread_rwlock_wrlock(&self->_.t_param.park_begin_rwlock);
-            self->_.t_param.last_park_begin_time = get_current_time();
-            Pthread_rwlock_unlock(&self->_.t_param.park_begin_rwlock);
+            self->motion.last_park_begin_time = simulator_time();
+            VirtualTelescope_motion_publish(self);
             Pthread_mutex_unlock(&self->_.t_state.mtx);
             return AAOS_OK;
             break;
         case TELESCOPE_STATE_TRACKING_WAIT:
             self->_.t_state.state = TELESCOPE_STATE_PARKED | flag;
-            self->_.t_param.last_park_begin_time = get_current_time();
+            self->motion.last_park_begin_time = simulator_time();
+            VirtualTelescope_motion_publish(self);
+            __Telescope_state_broadcast(&self->_);
             Pthread_mutex_unlock(&self->_.t_state.mtx);
-            Pthread_cond_broadcast(&self->_.t_state.cond);
             return AAOS_OK;
             break;
         case TELESCOPE_STATE_UNINITIALIZED:
@@ -3960,17 +4127,14 @@ VirtualTelescope_park(void *_self)
             VirtualTelescope_get_current_postion_r(self, &ra, &dec, &alt, &az);
             Pthread_cancel(self->_.tid);
             self->_.t_state.state = TELESCOPE_STATE_PARKED | flag;
-            Pthread_rwlock_wrlock(&self->_.t_param.park_begin_rwlock);
-            self->_.t_param.last_park_begin_time = get_current_time();
-            Pthread_rwlock_unlock(&self->_.t_param.park_begin_rwlock);
-            Pthread_rwlock_wrlock(&self->_.t_param.position_rwlock);
-            self->_.t_param.ra = ra;
-            self->_.t_param.dec = dec;
-            self->_.t_param.az = az;
-            self->_.t_param.alt = alt;
-            Pthread_rwlock_unlock(&self->_.t_param.position_rwlock);
+            self->motion.last_park_begin_time = simulator_time();
+            self->motion.ra = ra;
+            self->motion.dec = dec;
+            self->motion.az = az;
+            self->motion.alt = alt;
+            VirtualTelescope_motion_publish(self);
+            __Telescope_state_broadcast(&self->_);
             Pthread_mutex_unlock(&self->_.t_state.mtx);
-            Pthread_cond_broadcast(&self->_.t_state.cond);
             return AAOS_OK;
         default:
             break;
@@ -3995,13 +4159,12 @@ VirtualTelescope_park_off(void *_self)
     switch (state) {
         case TELESCOPE_STATE_PARKED:
             VirtualTelescope_get_current_postion_r(self, &ra, &dec, &alt, &az);
-            Pthread_rwlock_wrlock(&self->_.t_param.position_rwlock);
-            self->_.t_param.ra = ra;
-            self->_.t_param.dec = dec;
-            self->_.t_param.az = az;
-            self->_.t_param.alt = alt;
-            Pthread_rwlock_unlock(&self->_.t_param.position_rwlock);
+            self->motion.ra = ra;
+            self->motion.dec = dec;
+            self->motion.az = az;
+            self->motion.alt = alt;
             self->_.t_state.state = TELESCOPE_STATE_TRACKING | flag;
+            VirtualTelescope_motion_publish(self);
             break;
         default:
             break;
@@ -4063,9 +4226,8 @@ VirtualTelescope_set_move_speed(void *_self, double move_speed)
                         return AAOS_EDEVMAL;
                     }
                     ret = AAOS_OK;
-                    Pthread_rwlock_wrlock(&self->_.t_param.move_speed_rwlock);
-                    self->_.t_param.move_speed = move_speed;
-                    Pthread_rwlock_unlock(&self->_.t_param.move_speed_rwlock);
+                    self->motion.move_speed = move_speed;
+                    VirtualTelescope_motion_publish(self);
                     break;
             }
             break;
@@ -4075,9 +4237,8 @@ VirtualTelescope_set_move_speed(void *_self, double move_speed)
                 return AAOS_EDEVMAL;
             }
             ret = AAOS_OK;
-            Pthread_rwlock_wrlock(&self->_.t_param.move_speed_rwlock);
-            self->_.t_param.move_speed = move_speed;
-            Pthread_rwlock_unlock(&self->_.t_param.move_speed_rwlock);
+            self->motion.move_speed = move_speed;
+            VirtualTelescope_motion_publish(self);
             break;
     }
     Pthread_mutex_unlock(&self->_.t_state.mtx);
@@ -4108,9 +4269,7 @@ VirtualTelescope_get_move_speed(void *_self, double *move_speed)
             break;
         default:
             ret = AAOS_OK;
-            Pthread_rwlock_rdlock(&self->_.t_param.move_speed_rwlock);
-            *move_speed = self->_.t_param.move_speed;
-            Pthread_rwlock_unlock(&self->_.t_param.move_speed_rwlock);
+            *move_speed = self->motion.move_speed;
             break;
     }
     Pthread_mutex_unlock(&self->_.t_state.mtx);
@@ -4161,8 +4320,9 @@ VirtualTelescope_set_slew_speed(void *_self, double slew_speed_x, double slew_sp
                         return AAOS_EDEVMAL;
                     }
                     ret = AAOS_OK;
-                    self->_.t_param.slew_speed_x = slew_speed_x;
-                    self->_.t_param.slew_speed_y = slew_speed_y;
+                    self->motion.slew_speed_x = slew_speed_x;
+                    self->motion.slew_speed_y = slew_speed_y;
+                    VirtualTelescope_motion_publish(self);
                     break;
             }
             break;
@@ -4172,10 +4332,9 @@ VirtualTelescope_set_slew_speed(void *_self, double slew_speed_x, double slew_sp
                 return AAOS_EDEVMAL;
             }
             ret = AAOS_OK;
-            Pthread_rwlock_wrlock(&self->_.t_param.slew_speed_rwlock);
-            self->_.t_param.slew_speed_x = slew_speed_x;
-            self->_.t_param.slew_speed_y = slew_speed_y;
-            Pthread_rwlock_unlock(&self->_.t_param.slew_speed_rwlock);
+            self->motion.slew_speed_x = slew_speed_x;
+            self->motion.slew_speed_y = slew_speed_y;
+            VirtualTelescope_motion_publish(self);
             break;
     }
     Pthread_mutex_unlock(&self->_.t_state.mtx);
@@ -4207,10 +4366,8 @@ VirtualTelescope_get_slew_speed(void *_self, double *slew_speed_x, double *slew_
             break;
         default:
             ret = AAOS_OK;
-            Pthread_rwlock_rdlock(&self->_.t_param.slew_speed_rwlock);
-            *slew_speed_x = self->_.t_param.slew_speed_x;
-            *slew_speed_y = self->_.t_param.slew_speed_y;
-            Pthread_rwlock_unlock(&self->_.t_param.slew_speed_rwlock);
+            *slew_speed_x = self->motion.slew_speed_x;
+            *slew_speed_y = self->motion.slew_speed_y;
             break;
     }
     Pthread_mutex_unlock(&self->_.t_state.mtx);
@@ -4300,6 +4457,10 @@ VirtualTelescope_ctor(void *_self, va_list *app)
     
     self->_._vtab = virtual_telescope_virtual_table();
     
+    Pthread_mutex_lock(&self->_.t_state.mtx);
+    VirtualTelescope_motion_publish(self);
+    Pthread_mutex_unlock(&self->_.t_state.mtx);
+    
     return (void *) self;
 }
 
@@ -4330,6 +4491,7 @@ VirtualTelescopeClass_ctor(void *_self, va_list *app)
     self->_.get_move_speed.method = (Method) 0;
     self->_.get_track_rate.method = (Method) 0;
     self->_.get_track_rate.method = (Method) 0;
+    self->_.get_position.method = (Method) 0;
     
 
     return self;
@@ -4413,6 +4575,7 @@ virtual_telescope_virtual_table_initialize(void)
 {
     _virtual_telescope_virtual_table = new(__TelescopeVirtualTable(),
                                            __telescope_status, "status", VirtualTelescope_status,
+                                           __telescope_get_position, "get_position", VirtualTelescope_get_position,
                                            __telescope_info, "info", VirtualTelescope_info,
                                            __telescope_power_on, "power_on", VirtualTelescope_power_on,
                                            __telescope_power_off, "power_off", VirtualTelescope_power_off,
@@ -5471,8 +5634,8 @@ AICMount_inspect(void *_self)
     if ((ret = AICMount_raw(_self, "ReadScopeStatus\n", 17, NULL, buf, BUFSIZE, NULL)) == AAOS_OK) {
         Pthread_mutex_lock(&self->_.t_state.mtx);
         self->_.t_state.state &= ~TELESCOPE_STATE_MALFUNCTION;
+        __Telescope_state_broadcast(&self->_);
         Pthread_mutex_unlock(&self->_.t_state.mtx);
-        Pthread_cond_broadcast(&self->_.t_state.cond);
     } else {
         Pthread_mutex_lock(&self->_.t_state.mtx);
         self->_.t_state.state |= TELESCOPE_STATE_MALFUNCTION;
@@ -5590,8 +5753,8 @@ AICMount_slew(void *_self, double ra, double dec)
         Nanosleep(self->_.t_ctrl.slew_settle_time);
         Pthread_mutex_lock(&self->_.t_state.mtx);
         self->_.t_state.state = (self->_.t_state.state&TELESCOPE_STATE_MALFUNCTION) | TELESCOPE_STATE_TRACKING;
+        __Telescope_state_broadcast(&self->_);
         Pthread_mutex_unlock(&self->_.t_state.mtx);
-        Pthread_cond_broadcast(&self->_.t_state.cond);
     }
     
     return ret;
@@ -5808,8 +5971,8 @@ AICMount_move(void *_self, int direction, double duration)
     
     Pthread_mutex_lock(&self->_.t_state.mtx);
     self->_.t_state.state = (self->_.t_state.state&TELESCOPE_STATE_MALFUNCTION) | TELESCOPE_STATE_TRACKING;
+    __Telescope_state_broadcast(&self->_);
     Pthread_mutex_unlock(&self->_.t_state.mtx);
-    Pthread_cond_broadcast(&self->_.t_state.cond);
 	
     return ret;
 }
@@ -6669,8 +6832,8 @@ SYSU80_inspect(void *_self)
     } else {
 		Pthread_mutex_lock(&self->_.t_state.mtx);
 		self->_.t_state.state &= (~TELESCOPE_STATE_MALFUNCTION);
+		__Telescope_state_broadcast(&self->_);
 		Pthread_mutex_unlock(&self->_.t_state.mtx);
-		Pthread_cond_broadcast(&self->_.t_state.cond);
 		return AAOS_OK;
     }
 }
@@ -8133,8 +8296,8 @@ APMount_stop(void *_self)
                 return AAOS_EDEVMAL;
             }
             self->_.t_state.state = TELESCOPE_STATE_TRACKING | flag;
+            __Telescope_state_broadcast(&self->_);
             Pthread_mutex_unlock(&self->_.t_state.mtx);
-            Pthread_cond_broadcast(&self->_.t_state.cond);
             return AAOS_OK;
             break;
         default:
@@ -8309,29 +8472,29 @@ APMount_move(void *_self, unsigned int direction, double duration)
             Pthread_mutex_unlock(&self->_.t_state.mtx);
             return AAOS_EDEVMAL;
         }
+        __Telescope_state_broadcast(&self->_);
         Pthread_mutex_unlock(&self->_.t_state.mtx);
-        Pthread_cond_broadcast(&self->_.t_state.cond);
         self->_.t_param.last_track_begin_time = get_current_time();
         return AAOS_OK;
     } else if (value == PTHREAD_CANCELED) {
+        __Telescope_state_broadcast(&self->_);
         Pthread_mutex_unlock(&self->_.t_state.mtx);
-        Pthread_cond_broadcast(&self->_.t_state.cond);
         return AAOS_ECANCELED;
     } else {
         if (value == (void *) AAOS_EDEVMAL) {
             self->_.t_state.state = TELESCOPE_STATE_MALFUNCTION;
+            __Telescope_state_broadcast(&self->_);
             Pthread_mutex_unlock(&self->_.t_state.mtx);
-            Pthread_cond_broadcast(&self->_.t_state.cond);
             return AAOS_EDEVMAL;
         } else if (value == (void *) AAOS_EDEVMAL) {
             self->_.t_state.state = TELESCOPE_STATE_MALFUNCTION;
+            __Telescope_state_broadcast(&self->_);
             Pthread_mutex_unlock(&self->_.t_state.mtx);
-            Pthread_cond_broadcast(&self->_.t_state.cond);
             return AAOS_ETIMEDOUT;
         }
     }
+    __Telescope_state_broadcast(&self->_);
     Pthread_mutex_unlock(&self->_.t_state.mtx);
-    Pthread_cond_broadcast(&self->_.t_state.cond);
     return AAOS_ERROR;
 }
 
@@ -8446,28 +8609,28 @@ APMount_try_move(void *_self, unsigned int direction, double duration)
             return AAOS_EDEVMAL;
         }
         self->_.t_param.last_track_begin_time = get_current_time();
+        __Telescope_state_broadcast(&self->_);
         Pthread_mutex_unlock(&self->_.t_state.mtx);
-        Pthread_cond_broadcast(&self->_.t_state.cond);
         return AAOS_OK;
     } else if (value == PTHREAD_CANCELED) {
+        __Telescope_state_broadcast(&self->_);
         Pthread_mutex_unlock(&self->_.t_state.mtx);
-        Pthread_cond_broadcast(&self->_.t_state.cond);
         return AAOS_ECANCELED;
     } else {
         if (value == (void *) AAOS_EDEVMAL) {
             self->_.t_state.state = TELESCOPE_STATE_MALFUNCTION;
+            __Telescope_state_broadcast(&self->_);
             Pthread_mutex_unlock(&self->_.t_state.mtx);
-            Pthread_cond_broadcast(&self->_.t_state.cond);
             return AAOS_EDEVMAL;
         } else if (value == (void *) AAOS_EDEVMAL) {
             self->_.t_state.state = TELESCOPE_STATE_MALFUNCTION;
+            __Telescope_state_broadcast(&self->_);
             Pthread_mutex_unlock(&self->_.t_state.mtx);
-            Pthread_cond_broadcast(&self->_.t_state.cond);
             return AAOS_ETIMEDOUT;
         }
     }
+    __Telescope_state_broadcast(&self->_);
     Pthread_mutex_unlock(&self->_.t_state.mtx);
-    Pthread_cond_broadcast(&self->_.t_state.cond);
     return AAOS_ERROR;
 }
 
@@ -8615,29 +8778,29 @@ APMount_timed_move(void *_self, unsigned int direction, double duration, double
             return AAOS_EDEVMAL;
         }
         self->_.t_param.last_track_begin_time = get_current_time();
+        __Telescope_state_broadcast(&self->_);
         Pthread_mutex_unlock(&self->_.t_state.mtx);
-        Pthread_cond_broadcast(&self->_.t_state.cond);
         return AAOS_OK;
     } else if (value == PTHREAD_CANCELED) {
+        __Telescope_state_broadcast(&self->_);
         Pthread_mutex_unlock(&self->_.t_state.mtx);
-        Pthread_cond_broadcast(&self->_.t_state.cond);
         return AAOS_ECANCELED;
     } else {
         if (value == (void *) AAOS_EDEVMAL) {
             self->_.t_state.state = TELESCOPE_STATE_MALFUNCTION;
+            __Telescope_state_broadcast(&self->_);
             Pthread_mutex_unlock(&self->_.t_state.mtx);
-            Pthread_cond_broadcast(&self->_.t_state.cond);
             return AAOS_EDEVMAL;
         } else if (value == (void *) AAOS_EDEVMAL) {
             self->_.t_state.state = TELESCOPE_STATE_MALFUNCTION;
+            __Telescope_state_broadcast(&self->_);
             Pthread_mutex_unlock(&self->_.t_state.mtx);
-            Pthread_cond_broadcast(&self->_.t_state.cond);
             return AAOS_ETIMEDOUT;
         }
     }
     
+    __Telescope_state_broadcast(&self->_);
     Pthread_mutex_unlock(&self->_.t_state.mtx);
-    Pthread_cond_broadcast(&self->_.t_state.cond);
     return AAOS_ERROR;
 }
 
@@ -8815,30 +8978,30 @@ APMount_slew(void *_self, double ra, double dec)
     if (value == NULL) {
         flag = self->_.t_state.state & TELESCOPE_STATE_MALFUNCTION;
         self->_.t_state.state = TELESCOPE_STATE_TRACKING | flag;
+        __Telescope_state_broadcast(&self->_);
         Pthread_mutex_unlock(&self->_.t_state.mtx);
-        Pthread_cond_broadcast(&self->_.t_state.cond);
         return AAOS_OK;
     } else if (value == PTHREAD_CANCELED) {
+        __Telescope_state_broadcast(&self->_);
         Pthread_mutex_unlock(&self->_.t_state.mtx);
-        Pthread_cond_broadcast(&self->_.t_state.cond);
         return AAOS_ECANCELED;
     } else {
         if (value == (void *) AAOS_EDEVMAL) {
             self->_.t_state.state = TELESCOPE_STATE_MALFUNCTION;
+            __Telescope_state_broadcast(&self->_);
             Pthread_mutex_unlock(&self->_.t_state.mtx);
-            Pthread_cond_broadcast(&self->_.t_state.cond);
             return AAOS_EDEVMAL;
         } else if (value == (void *) AAOS_ETIMEDOUT) {
             flag = self->_.t_state.state & TELESCOPE_STATE_MALFUNCTION;
             self->_.t_state.state = TELESCOPE_STATE_TRACKING | flag;
+            __Telescope_state_broadcast(&self->_);
             Pthread_mutex_unlock(&self->_.t_state.mtx);
-            Pthread_cond_broadcast(&self->_.t_state.cond);
             return AAOS_ETIMEDOUT;
         }
     }
     self->_.t_param.last_track_begin_time = get_current_time();
+    __Telescope_state_broadcast(&self->_);
     Pthread_mutex_unlock(&self->_.t_state.mtx);
-    Pthread_cond_broadcast(&self->_.t_state.cond);
     return AAOS_ERROR;
 }
 
@@ -8922,28 +9085,28 @@ APMount_try_slew(void *_self, double ra, double dec)
     if (value == NULL) {
         flag = self->_.t_state.state & TELESCOPE_STATE_MALFUNCTION;
         self->_.t_state.state = TELESCOPE_STATE_TRACKING | flag;
+        __Telescope_state_broadcast(&self->_);
         Pthread_mutex_unlock(&self->_.t_state.mtx);
-        Pthread_cond_broadcast(&self->_.t_state.cond);
         return AAOS_OK;
     } else if (value == PTHREAD_CANCELED) {
+        __Telescope_state_broadcast(&self->_);
         Pthread_mutex_unlock(&self->_.t_state.mtx);
-        Pthread_cond_broadcast(&self->_.t_state.cond);
         return AAOS_ECANCELED;
     } else {
         if (value == (void *) AAOS_EDEVMAL) {
             self->_.t_state.state = TELESCOPE_STATE_MALFUNCTION;
+            __Telescope_state_broadcast(&self->_);
             Pthread_mutex_unlock(&self->_.t_state.mtx);
-            Pthread_cond_broadcast(&self->_.t_state.cond);
             return AAOS_EDEVMAL;
         } else if (value == (void *) AAOS_ETIMEDOUT) {
+            __Telescope_state_broadcast(&self->_);
             Pthread_mutex_unlock(&self->_.t_state.mtx);
-            Pthread_cond_broadcast(&self->_.t_state.cond);
             return AAOS_ETIMEDOUT;
         }
     }
     self->_.t_param.last_track_begin_time = get_current_time();
+    __Telescope_state_broadcast(&self->_);
     Pthread_mutex_unlock(&self->_.t_state.mtx);
-    Pthread_cond_broadcast(&self->_.t_state.cond);
     return AAOS_ERROR;
 }
 
@@ -9063,29 +9226,29 @@ APMount_timed_slew(void *_self, double ra, double dec, double timeout)
     Pthread_mutex_lock(&self->_.t_state.mtx);
     if (value == NULL) {
         self->_.t_state.state = TELESCOPE_STATE_TRACKING | flag;
+        __Telescope_state_broadcast(&self->_);
         Pthread_mutex_unlock(&self->_.t_state.mtx);
-        Pthread_cond_broadcast(&self->_.t_state.cond);
         return AAOS_OK;
     } else if (value == PTHREAD_CANCELED) {
+        __Telescope_state_broadcast(&self->_);
         Pthread_mutex_unlock(&self->_.t_state.mtx);
-        Pthread_cond_broadcast(&self->_.t_state.cond);
         return AAOS_ECANCELED;
     } else {
         if (value == (void *) AAOS_EDEVMAL) {
             self->_.t_state.state = TELESCOPE_STATE_MALFUNCTION;
+            __Telescope_state_broadcast(&self->_);
             Pthread_mutex_unlock(&self->_.t_state.mtx);
-            Pthread_cond_broadcast(&self->_.t_state.cond);
             return AAOS_EDEVMAL;
         } else if (value == (void *) AAOS_ETIMEDOUT) {
             self->_.t_state.state = TELESCOPE_STATE_MALFUNCTION;
+            __Telescope_state_broadcast(&self->_);
             Pthread_mutex_unlock(&self->_.t_state.mtx);
-            Pthread_cond_broadcast(&self->_.t_state.cond);
             return AAOS_ETIMEDOUT;
         }
     }
     self->_.t_param.last_track_begin_time = get_current_time();
+    __Telescope_state_broadcast(&self->_);
     Pthread_mutex_unlock(&self->_.t_state.mtx);
-    Pthread_cond_broadcast(&self->_.t_state.cond);
     return AAOS_ERROR;
 }
 
@@ -9119,8 +9282,8 @@ APMount_park(void *_self)
             break;
         case TELESCOPE_STATE_TRACKING_WAIT:
             self->_.t_state.state = TELESCOPE_STATE_PARKED | flag;
+            __Telescope_state_broadcast(&self->_);
             Pthread_mutex_unlock(&self->_.t_state.mtx);
-            Pthread_cond_broadcast(&self->_.t_state.cond);
             return AAOS_OK;
             break;
         case TELESCOPE_STATE_UNINITIALIZED:
@@ -9137,8 +9300,8 @@ APMount_park(void *_self)
         case TELESCOPE_STATE_SLEWING:
             Pthread_cancel(self->_.tid);
             self->_.t_state.state = TELESCOPE_STATE_PARKED | flag;
+            __Telescope_state_broadcast(&self->_);
             Pthread_mutex_unlock(&self->_.t_state.mtx);
-            Pthread_cond_broadcast(&self->_.t_state.cond);
             return AAOS_OK;
         default:
             break;
@@ -9769,7 +9932,7 @@ APMount_inspect(void *_self)
     }
     if (flag && ret == AAOS_OK) {
         self->_.t_state.state = state;
-        Pthread_cond_broadcast(&self->_.t_state.cond);
+        __Telescope_state_broadcast(&self->_);
     }
     if (ret != AAOS_OK) {
         self->_.t_state.state = state | TELESCOPE_STATE_MALFUNCTION;
@@ -9985,6 +10148,158 @@ ap_mount_virtual_table(void)
 #include "ascom.h"
 #include <cjson/cJSON.h>
 
+/*
+ * Status of the mount.
+ * The properties are fetched by parallel GET requests, and kept as one snapshot
+ * for status_validity seconds, concurrent callers wait for the same round trip.
+ * The round trip is made without status_mtx held, which only guards the snapshot,
+ * so that a caller cancelled meanwhile does not leave it locked.
+ */
+
+static const char *ascom_mount_status_commands[] = {"rightascension", "declination", "altitude", "azimuth", "slewing", "tracking", "atpark"};
+
+#define ASCOM_MOUNT_N_STATUS (sizeof(ascom_mount_status_commands) / sizeof(ascom_mount_status_commands[0]))
+
+static void
+ASCOMMount_status_cleanup(void *arg)
+{
+    Pthread_mutex_unlock((pthread_mutex_t *) arg);
+}
+
+static int
+ASCOMMount_get_status(struct ASCOMMount *self, struct ASCOMMountStatus *status, double validity)
+{
+    struct ASCOMMountStatus snapshot;
+    char *responses[ASCOM_MOUNT_N_STATUS];
+    size_t sizes[ASCOM_MOUNT_N_STATUS], i;
+    int results[ASCOM_MOUNT_N_STATUS], error_code, ret = AAOS_OK;
+    double timestamp;
+    bool fresh;
+    
+    Pthread_mutex_lock(&self->status_mtx);
+    pthread_cleanup_push(ASCOMMount_status_cleanup, &self->status_mtx);
+    while (!(fresh = (self->status.error_code == AAOS_OK && __Telescope_status_time() - self->status.timestamp < validity)) && self->status_fetching) {
+        Pthread_cond_wait(&self->status_cond, &self->status_mtx);
+    }
+    if (fresh) {
+        memcpy(status, &self->status, sizeof(struct ASCOMMountStatus));
+    } else {
+        self->status_fetching = true;
+    }
+    pthread_cleanup_pop(1);
+    if (fresh) {
+        return AAOS_OK;
+    }
+    
+    /*
+     * ascom_get_multi is not a cancellation point, status_fetching is always cleared.
+     */
+    memset(&snapshot, '\0', sizeof(snapshot));
+    memset(responses, '\0', sizeof(responses));
+    timestamp = __Telescope_status_time();
+    ret = ascom_get_multi(self->ascom, ASCOM_MOUNT_N_STATUS, ascom_mount_status_commands, responses, sizes, results);
+    for (i = 0; i < ASCOM_MOUNT_N_STATUS && ret == AAOS_OK; i++) {
+        if (ascom_get_error_code(responses[i], &error_code) != AAOS_OK || error_code != 0) {
+            ret = AAOS_ERROR;
+        }
+    }
+    if (ret == AAOS_OK) {
+        if (ascom_get_double_value(responses[0], &snapshot.ra) != AAOS_OK ||
+            ascom_get_double_value(responses[1], &snapshot.dec) != AAOS_OK ||
+            ascom_get_double_value(responses[2], &snapshot.alt) != AAOS_OK ||
+            ascom_get_double_value(responses[3], &snapshot.az) != AAOS_OK ||
+            ascom_get_bool_value(responses[4], &snapshot.slewing) != AAOS_OK ||
+            ascom_get_bool_value(responses[5], &snapshot.tracking) != AAOS_OK ||
+            ascom_get_bool_value(responses[6], &snapshot.at_park) != AAOS_OK) {
+            ret = AAOS_ERROR;
+        }
+    }
+    for (i = 0; i < ASCOM_MOUNT_N_STATUS; i++) {
+        free(responses[i]);
+    }
+    if (ret == AAOS_OK) {
+        /*
+         * Alpaca gives right ascension in hours.
+         */
+        snapshot.ra *= 15.;
+        snapshot.timestamp = timestamp;
+    }
+    snapshot.error_code = ret;
+    
+    Pthread_mutex_lock(&self->status_mtx);
+    if (ret == AAOS_OK) {
+        memcpy(&self->status, &snapshot, sizeof(struct ASCOMMountStatus));
+    } else {
+        self->status.error_code = ret;
+    }
+    self->status_fetching = false;
+    Pthread_mutex_unlock(&self->status_mtx);
+    Pthread_cond_broadcast(&self->status_cond);
+    memcpy(status, &snapshot, sizeof(struct ASCOMMountStatus));
+    
+    return ret;
+}
+
+/*
+ * A command changes the state of the mount, the snapshot taken before is no longer valid.
+ */
+static void
+ASCOMMount_invalidate_status(struct ASCOMMount *self)
+{
+    Pthread_mutex_lock(&self->status_mtx);
+    self->status.timestamp = 0.;
+    Pthread_mutex_unlock(&self->status_mtx);
+}
+
+static int
+ASCOMMount_status(void *_self, void *res, size_t res_size, size_t *res_len)
+{
+    struct ASCOMMount *self = cast(ASCOMMount(), _self);
+    
+    struct ASCOMMountStatus status;
+    cJSON *root_json;
+    unsigned int state;
+    int ret;
+    
+    if ((ret = ASCOMMount_get_status(self, &status, self->status_validity)) != AAOS_OK) {
+        return ret;
+    }
+    if ((root_json = cJSON_CreateObject()) == NULL) {
+        return AAOS_ENOMEM;
+    }
+    
+    cJSON_AddStringToObject(root_json, "name", (self->_.name != NULL) ? self->_.name : "null");
+    cJSON_AddStringToObject(root_json, "description", (self->_.description != NULL) ? self->_.description : "null");
+    Pthread_mutex_lock(&self->_.t_state.mtx);
+    state = self->_.t_state.state;
+    Pthread_mutex_unlock(&self->_.t_state.mtx);
+    if (state & TELESCOPE_STATE_MALFUNCTION) {
+        cJSON_AddStringToObject(root_json, "state", "malfunction");
+    } else if (status.at_park) {
+        cJSON_AddStringToObject(root_json, "state", "parked");
+    } else if (status.slewing) {
+        cJSON_AddStringToObject(root_json, "state", "slewing");
+    } else if (status.tracking) {
+        cJSON_AddStringToObject(root_json, "state", "tracking");
+    } else {
+        cJSON_AddStringToObject(root_json, "state", "stopped");
+    }
+    cJSON_AddNumberToObject(root_json, "ra", status.ra);
+    cJSON_AddNumberToObject(root_json, "dec", status.dec);
+    cJSON_AddNumberToObject(root_json, "az", status.az);
+    cJSON_AddNumberToObject(root_json, "alt", status.alt);
+    cJSON_AddNumberToObject(root_json, "timestamp", status.timestamp);
+    
+    cJSON_PrintPreallocated(root_json, (char *) res, (int) res_size, 1);
+    cJSON_Delete(root_json);
+    
+    if (res_len != NULL) {
+        *res_len = strlen((char *) res) + 1;
+    }
+    
+    return AAOS_OK;
+}
+
 static int
 ASCOMMount_power_on(void *_self)
 {
@@ -10019,7 +10334,7 @@ ASCOMMount_init(void *_self)
     switch (state) {
         case TELESCOPE_STATE_UNINITIALIZED:
             snprintf(data, BUFSIZE, "sitelatitude=%.6f", self->_.location_lat);
-            if ((ret = ascom_put(self->ascom, "sitelatitude", data, buf, &size)) != AAOS_OK) {
+            if ((ret = ascom_put(self->ascom, "sitelatitude", data, &buf, &size)) != AAOS_OK) {
                 goto error;
             }
             if (ascom_get_error_code(buf, &ret) != AAOS_OK || ret != AAOS_OK) {
@@ -10028,7 +10343,7 @@ ASCOMMount_init(void *_self)
             }
             
             snprintf(data, BUFSIZE, "sitelongitude=%.6f", self->_.location_lon);
-            if ((ret = ascom_put(self->ascom, "sitelongitude", data, buf, &size)) != AAOS_OK) {
+            if ((ret = ascom_put(self->ascom, "sitelongitude", data, &buf, &size)) != AAOS_OK) {
                 goto error;
             }
             if (ascom_get_error_code(buf, &ret) != AAOS_OK || ret != AAOS_OK) {
@@ -10037,7 +10352,7 @@ ASCOMMount_init(void *_self)
             }
             
             snprintf(data, BUFSIZE, "siteelevation=%.2f", self->_.location_lon);
-            if ((ret = ascom_put(self->ascom, "siteelevation", data, buf, &size)) != AAOS_OK) {
+            if ((ret = ascom_put(self->ascom, "siteelevation", data, &buf, &size)) != AAOS_OK) {
                 goto error;
             }
             if (ascom_get_error_code(buf, &ret) != AAOS_OK || ret != AAOS_OK) {
@@ -10050,7 +10365,7 @@ ASCOMMount_init(void *_self)
             gmtime_r(&current_time, &tm);
             strftime(time_buf, BUFSIZE, "%Y-%m-%dT%H:%M:%S", &tm);
             snprintf(data, BUFSIZE, "utcdate=%s.%07ldZ", time_buf, tp.tv_nsec * 100);
-            if ((ascom_put(self->ascom, "utcdate", data, buf, &size)) == AAOS_OK) {
+            if ((ascom_put(self->ascom, "utcdate", data, &buf, &size)) == AAOS_OK) {
                 goto error;
             }
             if (ascom_get_error_code(buf, &ret) != AAOS_OK || ret != AAOS_OK) {
@@ -10108,7 +10423,7 @@ ASCOMMount_stop(void *_self)
         case TELESCOPE_STATE_SLEWING:
         case TELESCOPE_STATE_TRACKING_WAIT:
             Pthread_cancel(self->_.tid);
-            if ((ret = ascom_put(self->ascom, "abortslew", NULL, buf, &size)) != AAOS_OK) {
+            if ((ret = ascom_put(self->ascom, "abortslew", NULL, &buf, &size)) != AAOS_OK) {
                 goto error;
             }
             if (ascom_get_error_code(buf, &ret) != AAOS_OK || ret != AAOS_OK) {
@@ -10121,8 +10436,8 @@ ASCOMMount_stop(void *_self)
             } else {
                 self->_.t_state.state = TELESCOPE_STATE_TRACKING | flag;
             }
+            __Telescope_state_broadcast(&self->_);
             Pthread_mutex_unlock(&self->_.t_state.mtx);
-            Pthread_cond_broadcast(&self->_.t_state.cond);
             return ret;
             break;
         default:
@@ -10147,7 +10462,7 @@ ASCOMMount_do_move(void *arg)
     int ret;
     
     snprintf(data, BUFSIZE, "direction=%d&duration=%d", my_arg->guide_direction, my_arg->guide_duration);
-    if ((ret = ascom_put(my_arg->self->ascom, "pulseguide", data, buf, &size)) != AAOS_OK) {
+    if ((ret = ascom_put(my_arg->self->ascom, "pulseguide", data, &buf, &size)) != AAOS_OK) {
         my_arg->error_code = ret;
         goto error;
     }
@@ -10264,8 +10579,8 @@ ASCOMMount_move(void *_self, unsigned int direction, double duration)
             break;
     }
 
-    self->_.last_move_begin_time = get_current_time();
-    self->_.move_duration = duration;
+    self->_.t_param.last_move_begin_time = get_current_time();
+    self->_.t_param.move_duration = duration;
     Pthread_create(&tid, NULL, ASCOMMount_do_move, &arg);
     self->_.tid = tid;
     self->_.t_state.state = TELESCOPE_STATE_MOVING | flag;
@@ -10283,17 +10598,17 @@ ASCOMMount_move(void *_self, unsigned int direction, double duration)
         } else {
             self->_.t_state.state = TELESCOPE_STATE_TRACKING | flag;
         }
+        __Telescope_state_broadcast(&self->_);
         Pthread_mutex_unlock(&self->_.t_state.mtx);
-        Pthread_cond_broadcast(&self->_.t_state.cond);
-        self->_.last_track_begin_time = get_current_time();
+        self->_.t_param.last_track_begin_time = get_current_time();
         return arg.error_code;
     } else if (value == PTHREAD_CANCELED) {
+        __Telescope_state_broadcast(&self->_);
         Pthread_mutex_unlock(&self->_.t_state.mtx);
-        Pthread_cond_broadcast(&self->_.t_state.cond);
         return AAOS_ECANCELED;
     }
+    __Telescope_state_broadcast(&self->_);
     Pthread_mutex_unlock(&self->_.t_state.mtx);
-    Pthread_cond_broadcast(&self->_.t_state.cond);
     return AAOS_ERROR;
 }
 
@@ -10375,8 +10690,8 @@ ASCOMMount_try_move(void *_self, unsigned int direction, double duration)
             break;
     }
     
-    self->_.last_move_begin_time = get_current_time();
-    self->_.move_duration = duration;
+    self->_.t_param.last_move_begin_time = get_current_time();
+    self->_.t_param.move_duration = duration;
     Pthread_create(&tid, NULL, ASCOMMount_do_move, &arg);
     self->_.tid = tid;
     self->_.t_state.state = TELESCOPE_STATE_MOVING | flag;
@@ -10394,17 +10709,17 @@ ASCOMMount_try_move(void *_self, unsigned int direction, double duration)
         } else {
             self->_.t_state.state = TELESCOPE_STATE_TRACKING | flag;
         }
-        self->_.last_track_begin_time = get_current_time();
+        self->_.t_param.last_track_begin_time = get_current_time();
+        __Telescope_state_broadcast(&self->_);
         Pthread_mutex_unlock(&self->_.t_state.mtx);
-        Pthread_cond_broadcast(&self->_.t_state.cond);
         return AAOS_OK;
     } else if (value == PTHREAD_CANCELED) {
+        __Telescope_state_broadcast(&self->_);
         Pthread_mutex_unlock(&self->_.t_state.mtx);
-        Pthread_cond_broadcast(&self->_.t_state.cond);
         return AAOS_ECANCELED;
     }
+    __Telescope_state_broadcast(&self->_);
     Pthread_mutex_unlock(&self->_.t_state.mtx);
-    Pthread_cond_broadcast(&self->_.t_state.cond);
     return AAOS_ERROR;
 }
 
@@ -10517,8 +10832,8 @@ ASCOMMount_timed_move(void *_self, unsigned int direction, double duration, doub
 
     
     self->_.t_state.state = TELESCOPE_STATE_MOVING | flag;
-    self->_.last_move_begin_time = get_current_time();
-    self->_.move_duration = duration;
+    self->_.t_param.last_move_begin_time = get_current_time();
+    self->_.t_param.move_duration = duration;
     Pthread_create(&tid, NULL, ASCOMMount_do_move, &arg);
     self->_.tid = tid;
     Pthread_mutex_unlock(&self->_.t_state.mtx);
@@ -10535,17 +10850,17 @@ ASCOMMount_timed_move(void *_self, unsigned int direction, double duration, doub
         } else {
             self->_.t_state.state = TELESCOPE_STATE_TRACKING | flag;
         }
-        self->_.last_track_begin_time = get_current_time();
+        self->_.t_param.last_track_begin_time = get_current_time();
+        __Telescope_state_broadcast(&self->_);
         Pthread_mutex_unlock(&self->_.t_state.mtx);
-        Pthread_cond_broadcast(&self->_.t_state.cond);
         return AAOS_OK;
     } else if (value == PTHREAD_CANCELED) {
+        __Telescope_state_broadcast(&self->_);
         Pthread_mutex_unlock(&self->_.t_state.mtx);
-        Pthread_cond_broadcast(&self->_.t_state.cond);
         return AAOS_ECANCELED;
     }
+    __Telescope_state_broadcast(&self->_);
     Pthread_mutex_unlock(&self->_.t_state.mtx);
-    Pthread_cond_broadcast(&self->_.t_state.cond);
     return AAOS_ERROR;
 }
 
@@ -10557,23 +10872,19 @@ struct ASCOMSlewThreadArg {
 };
 
 static int
-ASCOMMount_is_slewing(void *ascom, bool *is_slewing)
+ASCOMMount_is_slewing(struct ASCOMMount *self, bool *is_slewing)
 {
-    char *buf = NULL;
-    size_t size = 0;
-    int ret = AAOS_OK;
+    struct ASCOMMountStatus status;
+    int ret;
     
-    if ((ret = ascom_put(ascom, "slewing", NULL, buf, &size)) != AAOS_OK) {
-        goto error;
-    }
-    if (ascom_get_error_code(buf, &ret) != AAOS_OK || ret != AAOS_OK) {
-        ret = AAOS_ERROR;
-        goto error;
+    /*
+     * Always a fresh snapshot, it also refreshes the status for other callers.
+     */
+    if ((ret = ASCOMMount_get_status(self, &status, 0.)) == AAOS_OK) {
+        *is_slewing = status.slewing;
     }
     
-error:
-    free(buf);
-    return 0;
+    return ret;
 }
 
 static void *
@@ -10587,37 +10898,39 @@ ASCOMMount_do_slew(void *arg)
     snprintf(data, BUFSIZE, "ra=%11.6f&dec=%11.6f", my_arg->ra, my_arg->dec);
     
     if (my_arg->self->can_slew_async) {
-        if ((ret = ascom_put(my_arg->self->ascom, "slewcoordinatesasync", data, buf, &size)) != AAOS_OK) {
+        if ((ret = ascom_put(my_arg->self->ascom, "slewcoordinatesasync", data, &buf, &size)) != AAOS_OK) {
             my_arg->error_code = ret;
             goto error;
         }
+        ASCOMMount_invalidate_status(my_arg->self);
         if (ascom_get_error_code(buf, &ret) != AAOS_OK || ret != AAOS_OK) {
             ret = AAOS_ERROR;
             goto error;
         }
         int count;
         bool is_slewing;
+        ret = AAOS_ETIMEDOUT;
         for (count = 0; count < APMOUNT_MAX_POLL_COUNT; count++) {
             Nanosleep(APMOUNT_SLEW_WAIT_TIME);
-            if (ASCOMMount_is_slewing(my_arg->self->ascom, &is_slewing) != AAOS_OK) {
+            if (ASCOMMount_is_slewing(my_arg->self, &is_slewing) != AAOS_OK) {
                 ret = AAOS_ERROR;
                 goto error;
             }
-            if (is_slewing) {
+            if (!is_slewing) {
+                ret = AAOS_OK;
                 break;
             }
         }
-        ret = AAOS_ETIMEDOUT;
     } else {
-        if ((ret = ascom_put(my_arg->self->ascom, "slewcoordinates", data, buf, &size)) != AAOS_OK) {
+        if ((ret = ascom_put(my_arg->self->ascom, "slewcoordinates", data, &buf, &size)) != AAOS_OK) {
             my_arg->error_code = ret;
             goto error;
         }
+        ASCOMMount_invalidate_status(my_arg->self);
         if (ascom_get_error_code(buf, &ret) != AAOS_OK || ret != AAOS_OK) {
             ret = AAOS_ERROR;
             goto error;
         }
-        free(buf);
     }
     
 error:
@@ -10704,7 +11017,7 @@ ASCOMMount_slew(void *_self, double ra, double dec)
     }
     
     self->_.t_state.state = TELESCOPE_STATE_SLEWING | flag;
-    self->_.last_slew_begin_time = get_current_time();
+    self->_.t_param.last_slew_begin_time = get_current_time();
     Pthread_create(&tid, NULL, ASCOMMount_do_slew, &arg);
     self->_.tid = tid;
     Pthread_mutex_unlock(&self->_.t_state.mtx);
@@ -10722,17 +11035,17 @@ ASCOMMount_slew(void *_self, double ra, double dec)
         } else {
             self->_.t_state.state = TELESCOPE_STATE_TRACKING | flag;
         }
+        __Telescope_state_broadcast(&self->_);
         Pthread_mutex_unlock(&self->_.t_state.mtx);
-        Pthread_cond_broadcast(&self->_.t_state.cond);
         return arg.error_code;
     } else if (value == PTHREAD_CANCELED) {
+        __Telescope_state_broadcast(&self->_);
         Pthread_mutex_unlock(&self->_.t_state.mtx);
-        Pthread_cond_broadcast(&self->_.t_state.cond);
         return AAOS_ECANCELED;
     }
-    self->_.last_track_begin_time = get_current_time();
+    self->_.t_param.last_track_begin_time = get_current_time();
+    __Telescope_state_broadcast(&self->_);
     Pthread_mutex_unlock(&self->_.t_state.mtx);
-    Pthread_cond_broadcast(&self->_.t_state.cond);
     return AAOS_ERROR;
 }
 
@@ -10786,7 +11099,7 @@ ASCOMMount_try_slew(void *_self, double ra, double dec)
     }
     
     self->_.t_state.state = TELESCOPE_STATE_SLEWING | flag;
-    self->_.last_slew_begin_time = get_current_time();
+    self->_.t_param.last_slew_begin_time = get_current_time();
     Pthread_create(&tid, NULL, ASCOMMount_do_slew, &arg);
     self->_.tid = tid;
     Pthread_mutex_unlock(&self->_.t_state.mtx);
@@ -10804,17 +11117,17 @@ ASCOMMount_try_slew(void *_self, double ra, double dec)
         } else {
             self->_.t_state.state = TELESCOPE_STATE_TRACKING | flag;
         }
+        __Telescope_state_broadcast(&self->_);
         Pthread_mutex_unlock(&self->_.t_state.mtx);
-        Pthread_cond_broadcast(&self->_.t_state.cond);
         return arg.error_code;
     } else if (value == PTHREAD_CANCELED) {
+        __Telescope_state_broadcast(&self->_);
         Pthread_mutex_unlock(&self->_.t_state.mtx);
-        Pthread_cond_broadcast(&self->_.t_state.cond);
         return AAOS_ECANCELED;
     }
-    self->_.last_track_begin_time = get_current_time();
+    self->_.t_param.last_track_begin_time = get_current_time();
+    __Telescope_state_broadcast(&self->_);
     Pthread_mutex_unlock(&self->_.t_state.mtx);
-    Pthread_cond_broadcast(&self->_.t_state.cond);
     return AAOS_ERROR;
 }
 
@@ -10905,7 +11218,7 @@ ASCOMMount_timed_slew(void *_self, double ra, double dec, double timeout)
     }
     
     self->_.t_state.state = TELESCOPE_STATE_SLEWING | flag;
-    self->_.last_slew_begin_time = get_current_time();
+    self->_.t_param.last_slew_begin_time = get_current_time();
     Pthread_create(&tid, NULL, ASCOMMount_do_slew, self);
     self->_.tid = tid;
     Pthread_mutex_unlock(&self->_.t_state.mtx);
@@ -10921,17 +11234,17 @@ ASCOMMount_timed_slew(void *_self, double ra, double dec, double timeout)
         } else {
             self->_.t_state.state = TELESCOPE_STATE_TRACKING | flag;
         }
+        __Telescope_state_broadcast(&self->_);
         Pthread_mutex_unlock(&self->_.t_state.mtx);
-        Pthread_cond_broadcast(&self->_.t_state.cond);
         return arg.error_code;
     } else if (value == PTHREAD_CANCELED) {
+        __Telescope_state_broadcast(&self->_);
         Pthread_mutex_unlock(&self->_.t_state.mtx);
-        Pthread_cond_broadcast(&self->_.t_state.cond);
         return AAOS_ECANCELED;
     }
-    self->_.last_track_begin_time = get_current_time();
+    self->_.t_param.last_track_begin_time = get_current_time();
+    __Telescope_state_broadcast(&self->_);
     Pthread_mutex_unlock(&self->_.t_state.mtx);
-    Pthread_cond_broadcast(&self->_.t_state.cond);
     return AAOS_ERROR;
 }
 
@@ -10955,7 +11268,7 @@ ASCOMMount_park(void *_self)
         Pthread_mutex_unlock(&self->_.t_state.mtx);
         return AAOS_EDEVMAL;
     }
-    if ((ret = ascom_put(self->ascom, "setpark", NULL, buf, &size)) != AAOS_OK) {
+    if ((ret = ascom_put(self->ascom, "setpark", NULL, &buf, &size)) != AAOS_OK) {
         Pthread_mutex_unlock(&self->_.t_state.mtx);
         free(buf);
         return ret;
@@ -10968,7 +11281,7 @@ ASCOMMount_park(void *_self)
         }
         return error_code;
     }
-    if ((ret = ascom_put(self->ascom, "park", NULL, buf, &size)) != AAOS_OK) {
+    if ((ret = ascom_put(self->ascom, "park", NULL, &buf, &size)) != AAOS_OK) {
         Pthread_mutex_unlock(&self->_.t_state.mtx);
         free(buf);
         return ret;
@@ -10981,7 +11294,7 @@ ASCOMMount_park(void *_self)
         }
         return error_code;
     }
-    self->_.last_park_begin_time = get_current_time();
+    self->_.t_param.last_park_begin_time = get_current_time();
     switch (state) {
         case TELESCOPE_STATE_TRACKING:
             self->_.t_state.state = TELESCOPE_STATE_PARKED | flag;
@@ -10990,8 +11303,8 @@ ASCOMMount_park(void *_self)
             break;
         case TELESCOPE_STATE_TRACKING_WAIT:
             self->_.t_state.state = TELESCOPE_STATE_PARKED | flag;
+            __Telescope_state_broadcast(&self->_);
             Pthread_mutex_unlock(&self->_.t_state.mtx);
-            Pthread_cond_broadcast(&self->_.t_state.cond);
             return AAOS_OK;
             break;
         case TELESCOPE_STATE_UNINITIALIZED:
@@ -11008,8 +11321,8 @@ ASCOMMount_park(void *_self)
         case TELESCOPE_STATE_SLEWING:
             Pthread_cancel(self->_.tid);
             self->_.t_state.state = TELESCOPE_STATE_PARKED | flag;
+            __Telescope_state_broadcast(&self->_);
             Pthread_mutex_unlock(&self->_.t_state.mtx);
-            Pthread_cond_broadcast(&self->_.t_state.cond);
             return AAOS_OK;
         default:
             break;
@@ -11039,7 +11352,7 @@ ASCOMMount_park_off(void *_self)
     }
     switch (state) {
         case TELESCOPE_STATE_PARKED:
-            if ((ret = ascom_put(self->ascom, "unpark", NULL, buf, &size)) != AAOS_OK) {
+            if ((ret = ascom_put(self->ascom, "unpark", NULL, &buf, &size)) != AAOS_OK) {
                 Pthread_mutex_unlock(&self->_.t_state.mtx);
                 free(buf);
                 return ret;
@@ -11116,7 +11429,7 @@ ASCOMMount_set_move_speed(void *_self, double move_speed)
                     break;
                 default:
                     ret = AAOS_OK;
-                    if ((ret = ascom_put(self->ascom, "guideratedeclination", NULL, buf, &size)) != AAOS_OK) {
+                    if ((ret = ascom_put(self->ascom, "guideratedeclination", NULL, &buf, &size)) != AAOS_OK) {
                         Pthread_mutex_unlock(&self->_.t_state.mtx);
                         free(buf);
                         return ret;
@@ -11129,7 +11442,7 @@ ASCOMMount_set_move_speed(void *_self, double move_speed)
                         }
                         return error_code;
                     }
-                    if ((ret = ascom_put(self->ascom, "guideraterightascension", NULL, buf, &size)) != AAOS_OK) {
+                    if ((ret = ascom_put(self->ascom, "guideraterightascension", NULL, &buf, &size)) != AAOS_OK) {
                         Pthread_mutex_unlock(&self->_.t_state.mtx);
                         free(buf);
                         return ret;
@@ -11142,13 +11455,13 @@ ASCOMMount_set_move_speed(void *_self, double move_speed)
                         }
                         return error_code;
                     }
-                    self->_.move_speed = move_speed;
+                    self->_.t_param.move_speed = move_speed;
                     break;
             }
             break;
         default:
             ret = AAOS_OK;
-            if ((ret = ascom_put(self->ascom, "guideratedeclination", NULL, buf, &size)) != AAOS_OK) {
+            if ((ret = ascom_put(self->ascom, "guideratedeclination", NULL, &buf, &size)) != AAOS_OK) {
                 Pthread_mutex_unlock(&self->_.t_state.mtx);
                 free(buf);
                 return ret;
@@ -11161,7 +11474,7 @@ ASCOMMount_set_move_speed(void *_self, double move_speed)
                 }
                 return error_code;
             }
-            if ((ret = ascom_put(self->ascom, "guideraterightascension", NULL, buf, &size)) != AAOS_OK) {
+            if ((ret = ascom_put(self->ascom, "guideraterightascension", NULL, &buf, &size)) != AAOS_OK) {
                 Pthread_mutex_unlock(&self->_.t_state.mtx);
                 free(buf);
                 return ret;
@@ -11174,7 +11487,7 @@ ASCOMMount_set_move_speed(void *_self, double move_speed)
                 }
                 return error_code;
             }
-            self->_.move_speed = move_speed;
+            self->_.t_param.move_speed = move_speed;
             break;
     }
     Pthread_mutex_unlock(&self->_.t_state.mtx);
@@ -11206,7 +11519,7 @@ ASCOMMount_get_move_speed(void *_self, double *move_speed)
             break;
         default:
             ret = AAOS_OK;
-            *move_speed = self->_.move_speed;
+            *move_speed = self->_.t_param.move_speed;
             break;
     }
 error:
@@ -11259,7 +11572,7 @@ ASCOMMount_set_slew_speed(void *_self, double slew_speed_x, double slew_speed_y)
                     break;
                 default:
                     ret = AAOS_OK;
-                    if ((ret = ascom_put(self->ascom, "guideratedeclination", NULL, buf, &size)) != AAOS_OK) {
+                    if ((ret = ascom_put(self->ascom, "guideratedeclination", NULL, &buf, &size)) != AAOS_OK) {
                         Pthread_mutex_unlock(&self->_.t_state.mtx);
                         free(buf);
                         return ret;
@@ -11272,7 +11585,7 @@ ASCOMMount_set_slew_speed(void *_self, double slew_speed_x, double slew_speed_y)
                         }
                         return error_code;
                     }
-                    if ((ret = ascom_put(self->ascom, "guideraterightascension", NULL, buf, &size)) != AAOS_OK) {
+                    if ((ret = ascom_put(self->ascom, "guideraterightascension", NULL, &buf, &size)) != AAOS_OK) {
                         Pthread_mutex_unlock(&self->_.t_state.mtx);
                         free(buf);
                         return ret;
@@ -11285,14 +11598,14 @@ ASCOMMount_set_slew_speed(void *_self, double slew_speed_x, double slew_speed_y)
                         }
                         return error_code;
                     }
-                    self->_.slew_speed_x = slew_speed_x;
-                    self->_.slew_speed_y = slew_speed_y;
+                    self->_.t_param.slew_speed_x = slew_speed_x;
+                    self->_.t_param.slew_speed_y = slew_speed_y;
                     break;
             }
             break;
         default:
             ret = AAOS_OK;
-            if ((ret = ascom_put(self->ascom, "guideratedeclination", NULL, buf, &size)) != AAOS_OK) {
+            if ((ret = ascom_put(self->ascom, "guideratedeclination", NULL, &buf, &size)) != AAOS_OK) {
                 Pthread_mutex_unlock(&self->_.t_state.mtx);
                 free(buf);
                 return ret;
@@ -11305,7 +11618,7 @@ ASCOMMount_set_slew_speed(void *_self, double slew_speed_x, double slew_speed_y)
                 }
                 return error_code;
             }
-            if ((ret = ascom_put(self->ascom, "guideraterightascension", NULL, buf, &size)) != AAOS_OK) {
+            if ((ret = ascom_put(self->ascom, "guideraterightascension", NULL, &buf, &size)) != AAOS_OK) {
                 Pthread_mutex_unlock(&self->_.t_state.mtx);
                 free(buf);
                 return ret;
@@ -11318,8 +11631,8 @@ ASCOMMount_set_slew_speed(void *_self, double slew_speed_x, double slew_speed_y)
                 }
                 return error_code;
             }
-            self->_.slew_speed_x = slew_speed_x;
-            self->_.slew_speed_y = slew_speed_y;
+            self->_.t_param.slew_speed_x = slew_speed_x;
+            self->_.t_param.slew_speed_y = slew_speed_y;
             break;
     }
     Pthread_mutex_unlock(&self->_.t_state.mtx);
@@ -11350,8 +11663,8 @@ ASCOMMount_get_slew_speed(void *_self, double *slew_speed_x, double *slew_speed_
             break;
         default:
             ret = AAOS_OK;
-            *slew_speed_x = self->_.slew_speed_x;
-            *slew_speed_y = self->_.slew_speed_y;
+            *slew_speed_x = self->_.t_param.slew_speed_x;
+            *slew_speed_y = self->_.t_param.slew_speed_y;
             break;
     }
 error:
@@ -11403,7 +11716,7 @@ ASCOMMount_set_track_rate(void *_self, double track_rate_x, double track_rate_y)
                     break;
                 default:
                     ret = AAOS_OK;
-                    if ((ret = ascom_put(self->ascom, "declinationrate", NULL, buf, &size)) != AAOS_OK) {
+                    if ((ret = ascom_put(self->ascom, "declinationrate", NULL, &buf, &size)) != AAOS_OK) {
                         Pthread_mutex_unlock(&self->_.t_state.mtx);
                         free(buf);
                         return ret;
@@ -11416,7 +11729,7 @@ ASCOMMount_set_track_rate(void *_self, double track_rate_x, double track_rate_y)
                         }
                         return error_code;
                     }
-                    if ((ret = ascom_put(self->ascom, "rightascensionrate", NULL, buf, &size)) != AAOS_OK) {
+                    if ((ret = ascom_put(self->ascom, "rightascensionrate", NULL, &buf, &size)) != AAOS_OK) {
                         Pthread_mutex_unlock(&self->_.t_state.mtx);
                         free(buf);
                         return ret;
@@ -11429,14 +11742,14 @@ ASCOMMount_set_track_rate(void *_self, double track_rate_x, double track_rate_y)
                         }
                         return error_code;
                     }
-                    self->_.track_rate_x = track_rate_x;
-                    self->_.track_rate_y = track_rate_y;
+                    self->_.t_param.track_rate_x = track_rate_x;
+                    self->_.t_param.track_rate_y = track_rate_y;
                     break;
             }
             break;
         default:
             ret = AAOS_OK;
-            if ((ret = ascom_put(self->ascom, "declinationrate", NULL, buf, &size)) != AAOS_OK) {
+            if ((ret = ascom_put(self->ascom, "declinationrate", NULL, &buf, &size)) != AAOS_OK) {
                 Pthread_mutex_unlock(&self->_.t_state.mtx);
                 free(buf);
                 return ret;
@@ -11449,7 +11762,7 @@ ASCOMMount_set_track_rate(void *_self, double track_rate_x, double track_rate_y)
                 }
                 return error_code;
             }
-            if ((ret = ascom_put(self->ascom, "rightascensionrate", NULL, buf, &size)) != AAOS_OK) {
+            if ((ret = ascom_put(self->ascom, "rightascensionrate", NULL, &buf, &size)) != AAOS_OK) {
                 Pthread_mutex_unlock(&self->_.t_state.mtx);
                 free(buf);
                 return ret;
@@ -11462,8 +11775,8 @@ ASCOMMount_set_track_rate(void *_self, double track_rate_x, double track_rate_y)
                 }
                 return error_code;
             }
-            self->_.track_rate_x = track_rate_x;
-            self->_.track_rate_y = track_rate_y;
+            self->_.t_param.track_rate_x = track_rate_x;
+            self->_.t_param.track_rate_y = track_rate_y;
 
             break;
     }
@@ -11495,8 +11808,8 @@ ASCOMMount_get_track_rate(void *_self, double *track_rate_x, double *track_rate_
             break;
         default:
             ret = AAOS_OK;
-            *track_rate_x = self->_.track_rate_x;
-            *track_rate_y = self->_.track_rate_y;
+            *track_rate_x = self->_.t_param.track_rate_x;
+            *track_rate_y = self->_.t_param.track_rate_y;
             
             break;
     }
@@ -11528,15 +11841,22 @@ ASCOMMount_ctor(void *_self, va_list *app)
     port = va_arg(*app, const char *);
     version = va_arg(*app, const char *);
     device_number = va_arg(*app, unsigned int);
+    self->status_validity = va_arg(*app, double);
+    if (self->status_validity <= 0.) {
+        self->status_validity = ASCOM_MOUNT_STATUS_VALIDITY;
+    }
+    Pthread_mutex_init(&self->status_mtx, NULL);
+    Pthread_cond_init(&self->status_cond, NULL);
     
     self->ascom = new(ASCOM(), address, port, version, "telescope", device_number);
     
-    ascom_get(self->ascom, "canpark", buf, &size);
+    ascom_get(self->ascom, "canpark", &buf, &size);
     ascom_get_bool_value(buf, &self->can_park);
-    ascom_get(self->ascom, "canslew", buf, &size);
+    ascom_get(self->ascom, "canslew", &buf, &size);
     ascom_get_bool_value(buf, &self->can_slew_sync);
-    ascom_get(self->ascom, "canslewasync", buf, &size);
+    ascom_get(self->ascom, "canslewasync", &buf, &size);
     ascom_get_bool_value(buf, &self->can_slew_async);
+    free(buf);
     
     self->_._vtab = ascom_mount_virtual_table();
     
@@ -11550,6 +11870,8 @@ ASCOMMount_dtor(void *_self)
     struct ASCOMMount *self = cast(ASCOMMount(), _self);
     
     delete(self->ascom);
+    Pthread_mutex_destroy(&self->status_mtx);
+    Pthread_cond_destroy(&self->status_cond);
     
     return super_dtor(ASCOMMount(), _self);
 }
@@ -11637,7 +11959,7 @@ static void
 ascom_mount_virtual_table_initialize(void)
 {
     _ascom_mount_virtual_table = new(__TelescopeVirtualTable(),
-                                     //__telescope_status, "status", _status,
+                                     __telescope_status, "status", ASCOMMount_status,
                                      __telescope_power_on, "power_on", ASCOMMount_power_on,
                                      __telescope_power_off, "power_off", ASCOMMount_power_off,
                                      __telescope_init, "init", ASCOMMount_init,
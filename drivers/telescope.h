@@ -60,6 +60,10 @@ int __telescope_get_focus_length(void *_self, double *focus_length);
 void __telescope_get(void *_self, ...);
 void __telescope_set(void *_self, ...);
 
+int __telescope_cached_status(void *_self, unsigned int format, void *res, size_t res_size, size_t *res_len);
+int __telescope_refresh_status(void *_self);
+int __telescope_get_position(void *_self, double *ra, double *dec, double *alt, double *az);
+
 
 const char *__telescope_get_name(const void *_self);
 
@@ -9,6 +9,8 @@
 #ifndef telescope_def_h
 #define telescope_def_h
 
+#include <stdint.h>
+
 #define TELESCOPE_STATE_POWERED_OFF     0
 #define TELESCOPE_STATE_UNINITIALIZED   1
 #define TELESCOPE_STATE_PARKED          2
@@ -36,4 +38,25 @@
 #define TELESCOPE_TRACK_RATE_SOLAR     10002
 #define TELESCOPE_TRACK_RATE_SIDEREAL  10004
 
+#define TELESCOPE_STATUS_FORMAT_JSON    1
+#define TELESCOPE_STATUS_FORMAT_BINARY  2
+
+#define TELESCOPE_STATUS_RECORD_VERSION 1
+
+/*
+ * Fixed-layout telescope status, as served by the cached status command
+ * in TELESCOPE_STATUS_FORMAT_BINARY.
+ */
+struct TelescopeStatusRecord {
+    uint32_t version;
+    uint32_t state;         /* including TELESCOPE_STATE_MALFUNCTION */
+    uint32_t sequence;      /* incremented on every refresh */
+    uint32_t reserved;
+    double timestamp;       /* UTC seconds when the snapshot was taken */
+    double ra;
+    double dec;
+    double alt;
+    double az;
+};
+
 #endif /* telescope_def_h */
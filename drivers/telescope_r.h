@@ -12,7 +12,9 @@
 #include <stdint.h>
 #include <pthread.h>
 #include "object_r.h"
+#include "simulator.h"
 #include "virtual_r.h"
+#include "telescope_def.h"
 
 #define _TELESCOPE_PRIORITY_ _VIRTUAL_PRIORITY_ + 1
 
@@ -23,6 +25,24 @@ struct TelescopeState {
     pthread_cond_t cond;
 };
 
+#define TELESCOPE_STATUS_CACHE_SIZE     4096
+#define TELESCOPE_STATUS_INTERVAL       0.
+#define TELESCOPE_STATUS_MAX_AGE        0.5
+
+/*
+ * Snapshot of the status, refreshed when it is older than TELESCOPE_STATUS_MAX_AGE,
+ * or as soon as the state changes. If interval is not 0, a publisher thread refreshes it
+ * every interval seconds.
+ */
+struct TelescopeStatusCache {
+    double interval;
+    unsigned int stale;
+    char json[TELESCOPE_STATUS_CACHE_SIZE];
+    size_t json_length;
+    struct TelescopeStatusRecord record;
+    pthread_rwlock_t rwlock;
+};
+
 struct TelescopeControl {
     double home_ra;
     double home_dec;
@@ -177,6 +197,8 @@ struct __Telescope {
 	struct TelescopeParameter t_param;
     struct TelescopeCapbility t_cap;
     struct TelescopeControl t_ctrl;
+    struct TelescopeStatusCache t_status;
+    struct Simulator simulator;     /* virtual telescope only */
 };
 
 struct __TelescopeClass {
@@ -225,6 +247,10 @@ struct __TelescopeClass {
     
     struct Method get;
     struct Method set;
+    
+    struct Method cached_status;
+    struct Method refresh_status;
+    struct Method get_position;
 };
 
 struct __TelescopeVirtualTable {
@@ -263,10 +289,43 @@ struct __TelescopeVirtualTable {
     struct Method get_focus_length;
     struct Method inspect;
     struct Method wait;
+    struct Method get_position;
+};
+
+/*
+ * Motion state of a virtual telescope, published as one record.
+ */
+struct VirtualTelescopeMotion {
+    unsigned int state;
+    unsigned int move_direction;
+    int slew_direction_x;
+    int slew_direction_y;
+    
+    double ra;
+    double dec;
+    double alt;
+    double az;
+    
+    double move_speed;
+    double slew_speed_x;
+    double slew_speed_y;
+    
+    double ra_from;
+    double dec_from;
+    double ra_to;
+    double dec_to;
+    
+    double last_slew_begin_time;
+    double last_track_begin_time;
+    double last_move_begin_time;
+    double last_park_begin_time;
 };
 
 struct VirtualTelescope {
     struct __Telescope _;
+    struct VirtualTelescopeMotion motion;   /* written under t_state.mtx */
+    unsigned int seq;                       /* odd while snapshot is being updated */
+    struct VirtualTelescopeMotion snapshot; /* read without lock */
 };
 
 struct VirtualTelescopeClass {
@@ -288,12 +347,34 @@ struct APMountClass {
     struct __TelescopeClass _;
 };
 
+#define ASCOM_MOUNT_STATUS_VALIDITY     0.5
+
+/*
+ * Properties of the mount, fetched together in one parallel round trip.
+ */
+struct ASCOMMountStatus {
+    double timestamp;
+    double ra;
+    double dec;
+    double alt;
+    double az;
+    bool slewing;
+    bool tracking;
+    bool at_park;
+    int error_code;
+};
+
 struct ASCOMMount {
     struct __Telescope _;
     void *ascom;
     bool can_slew_async;
     bool can_slew_sync;
     bool can_park;
+    double status_validity;
+    struct ASCOMMountStatus status;
+    bool status_fetching;
+    pthread_mutex_t status_mtx;
+    pthread_cond_t status_cond;
 };
 
 struct ASCOMMountClass {
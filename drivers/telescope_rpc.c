@@ -44,11 +44,10 @@ get_telescope_by_index(int index)
 inline static int
 Telescope_protocol_check(void *_self)
 {
-    uint16_t protocol;
-    protobuf_get(_self, PACKET_PROTOCOL, &protocol);
-    if (protocol != PROTO_TELESCOPE) {
-        protobuf_set(_self, PACKET_ERRORCODE, AAOS_EPROTOWRONG);
-        protobuf_set(_self, PACKET_LENGTH, 0);
+    struct Packet *packet = rpc_packet(_self);
+    
+    if (packet->protocol != PROTO_TELESCOPE) {
+        packet_reply(packet, AAOS_EPROTOWRONG, 0);
         return AAOS_EPROTOWRONG;
     } else {
         return AAOS_OK;
@@ -491,6 +490,53 @@ Telescope_status(void *_self, char *res, size_t res_size, size_t *res_len)
     return ret;
 }
 
+int
+telescope_cached_status(void *_self, unsigned int format, void *res, size_t res_size, size_t *res_len)
+{
+    const struct TelescopeClass *class = (const struct TelescopeClass *) classOf(_self);
+    
+    if (isOf(class, TelescopeClass()) && class->cached_status.method) {
+        return ((int (*)(void *, unsigned int, void *, size_t, size_t *)) class->cached_status.method)(_self, format, res, res_size, res_len);
+    } else {
+        int result;
+        forward(_self, &result, (Method) telescope_cached_status, "cached_status", _self, format, res, res_size, res_len);
+        return result;
+    }
+}
+
+static int
+Telescope_cached_status(void *_self, unsigned int format, void *res, size_t res_size, size_t *res_len)
+{
+    struct Telescope *self = cast(Telescope(), _self);
+    int ret;
+    
+    if (res == NULL) {
+        return -1 * AAOS_EINVAL;
+    }
+    
+    protobuf_set(self, PACKET_PROTOCOL, PROTO_TELESCOPE);
+    protobuf_set(self, PACKET_COMMAND, TELESCOPE_COMMAND_CACHED_STATUS);
+    protobuf_set(self, PACKET_U32F0, (uint32_t) format);
+    
+    if ((ret = rpc_call(self)) == AAOS_OK) {
+        uint32_t length;
+        void *buf;
+        protobuf_get(self, PACKET_LENGTH, &length);
+        if (length > res_size) {
+            return AAOS_ENOSPC;
+        }
+        protobuf_get(self, PACKET_BUF, &buf, NULL);
+        if (buf != res) {
+            memcpy(res, buf, length);
+        }
+        if (res_len != NULL) {
+            *res_len = length;
+        }
+    }
+    
+    return ret;
+}
+
 
 int
 telescope_info(void *_self, char *res, size_t res_size, size_t *res_len)
@@ -1211,24 +1257,14 @@ Telescope_register(void *_self, double timeout)
 static int
 Telescope_execute_get_index_by_name(struct Telescope *self)
 {
-    char *name;
+    struct Packet *packet = rpc_packet(self);
     int index, ret;
-    uint32_t length;
     
-    protobuf_get(self, PACKET_LENGTH, &length);
-    
-    if (length == 0) {
-        protobuf_get(self, PACKET_STR, &name);
-    } else {
-        protobuf_get(self, PACKET_BUF, &name, NULL);
-    }
-    
-    if ((ret = get_index_by_name(name, &index)) != AAOS_OK) {
+    if ((ret = get_index_by_name(packet_string(packet), &index)) != AAOS_OK) {
         return ret;
     } else {
-        uint16_t idx = (uint16_t) index;
-        protobuf_set(self, PACKET_INDEX, idx);
-        protobuf_set(self, PACKET_LENGTH, 0);
+        packet->index = (uint16_t) index;
+        packet->length = 0;
     }
     
     return AAOS_OK;
@@ -1237,25 +1273,16 @@ Telescope_execute_get_index_by_name(struct Telescope *self)
 static int
 Telescope_execute_switch_instrument(struct Telescope *self)
 {
+    struct Packet *packet = rpc_packet(self);
     char *name;
-    int index, ret;
-    uint32_t length;
     void *telescope;
     
-    protobuf_get(self, PACKET_LENGTH, &length);
-    protobuf_get(self, PACKET_INDEX, &index);
-
-    if ((telescope = get_telescope_by_index(index)) == NULL) {
+    if ((telescope = get_telescope_by_index(packet->index)) == NULL) {
         return AAOS_ENOTFOUND;
     }
     
-    if (length == 0) {
-        protobuf_get(self, PACKET_STR, &name);
-    } else {
-        protobuf_get(self, PACKET_BUF, &name, NULL);
-    }
-    
-    protobuf_set(self, PACKET_LENGTH, 0);
+    name = packet_string(packet);
+    packet->length = 0;
 
     return __telescope_switch_instrument(telescope, name);
 }
@@ -1263,26 +1290,16 @@ Telescope_execute_switch_instrument(struct Telescope *self)
 static int
 Telescope_execute_switch_filter(struct Telescope *self)
 {
+    struct Packet *packet = rpc_packet(self);
     char *name;
-    int ret;
-    uint32_t length;
     void *telescope;
-    uint16_t index;
     
-    protobuf_get(self, PACKET_LENGTH, &length);
-    protobuf_get(self, PACKET_INDEX, &index);
-
-    if ((telescope = get_telescope_by_index(index)) == NULL) {
+    if ((telescope = get_telescope_by_index(packet->index)) == NULL) {
         return AAOS_ENOTFOUND;
     }
     
-    if (length == 0) {
-        protobuf_get(self, PACKET_STR, &name);
-    } else {
-        protobuf_get(self, PACKET_BUF, &name, NULL);
-    }
-    
-    protobuf_set(self, PACKET_LENGTH, 0);
+    name = packet_string(packet);
+    packet->length = 0;
 
     return __telescope_switch_filter(telescope, name);
 }
@@ -1290,26 +1307,16 @@ Telescope_execute_switch_filter(struct Telescope *self)
 static int
 Telescope_execute_switch_detector(struct Telescope *self)
 {
+    struct Packet *packet = rpc_packet(self);
     char *name;
-    int ret;
-    uint32_t length;
     void *telescope;
-    uint16_t index;
     
-    protobuf_get(self, PACKET_LENGTH, &length);
-    protobuf_get(self, PACKET_INDEX, &index);
-
-    if ((telescope = get_telescope_by_index(index)) == NULL) {
+    if ((telescope = get_telescope_by_index(packet->index)) == NULL) {
         return AAOS_ENOTFOUND;
     }
     
-    if (length == 0) {
-        protobuf_get(self, PACKET_STR, &name);
-    } else {
-        protobuf_get(self, PACKET_BUF, &name, NULL);
-    }
-    
-    protobuf_set(self, PACKET_LENGTH, 0);
+    name = packet_string(packet);
+    packet->length = 0;
 
     return __telescope_switch_detector(telescope, name);
 }
@@ -1317,69 +1324,74 @@ Telescope_execute_switch_detector(struct Telescope *self)
 static int
 Telescope_execute_focus(struct Telescope *self)
 {
-    int ret;
-    uint16_t index;
-    uint32_t length;
+    struct Packet *packet = rpc_packet(self);
     void *telescope;
-    uint32_t absolute;
-    double step;
     
-    protobuf_get(self, PACKET_LENGTH, &length);
-    protobuf_get(self, PACKET_INDEX, &index);
-    protobuf_get(self, PACKET_U32F0, &absolute);
-    protobuf_get(self, PACKET_DF1, &step);
-
-    if ((telescope = get_telescope_by_index(index)) == NULL) {
+    if ((telescope = get_telescope_by_index(packet->index)) == NULL) {
         return AAOS_ENOTFOUND;
     }
     
-    protobuf_set(self, PACKET_LENGTH, 0);
+    packet->length = 0;
 
-    return __telescope_focus(telescope, absolute, step);
+    return __telescope_focus(telescope, packet->carrier.u32[0], packet->carrier.df[1]);
 }
 
 static int
 Telescope_execute_status(struct Telescope *self)
 {
+    struct Packet *packet = rpc_packet(self);
     int ret;
-    uint16_t index;
-    uint32_t length;
     void *telescope;
-    void *buf;
-    size_t payload;
     
-    protobuf_get(self, PACKET_LENGTH, &length);
-    protobuf_get(self, PACKET_INDEX, &index);
-    
-    if (index == 0) {
-        char *name;
+    if (packet->index == 0) {
         int idx;
-        if (length == 0) {
-            protobuf_get(self, PACKET_STR, &name);
-        } else {
-            protobuf_get(self, PACKET_BUF, &name, NULL);
-        }
-        if ((ret = get_index_by_name(name, &idx)) != AAOS_OK) {
+        if ((ret = get_index_by_name(packet_string(packet), &idx)) != AAOS_OK) {
             return ret;
         }
-        index = (int) idx;
-        protobuf_set(self, PACKET_INDEX, index);
+        packet->index = (uint16_t) idx;
     }
     
-    if ((telescope = get_telescope_by_index(index)) == NULL) {
+    if ((telescope = get_telescope_by_index(packet->index)) == NULL) {
         return AAOS_ENOTFOUND;
     }
     
-    protobuf_get(self, PACKET_BUF, &buf, NULL);
-    payload = protobuf_payload(self);
+    ret = __telescope_status(telescope, packet->buf, protobuf_payload(self), NULL);
+
+    if (ret != AAOS_OK) {
+        packet->length = 0;
+    } else {
+        packet->length = (uint32_t) strlen(packet->buf) + 1;
+    }
     
-    ret = __telescope_status(telescope, buf, payload, NULL);
+    return ret;
+}
 
+static int
+Telescope_execute_cached_status(struct Telescope *self)
+{
+    struct Packet *packet = rpc_packet(self);
+    int ret;
+    void *telescope;
+    size_t res_len;
+    
+    if (packet->index == 0) {
+        int idx;
+        if ((ret = get_index_by_name(packet_string(packet), &idx)) != AAOS_OK) {
+            return ret;
+        }
+        packet->index = (uint16_t) idx;
+    }
+    
+    if ((telescope = get_telescope_by_index(packet->index)) == NULL) {
+        return AAOS_ENOTFOUND;
+    }
+    
+    ret = __telescope_cached_status(telescope, packet->carrier.u32[0], packet->buf, protobuf_payload(self), &res_len);
+    
     if (ret != AAOS_OK) {
-        protobuf_set(self, PACKET_LENGTH, 0);
+        packet->length = 0;
     } else {
-        length = (uint32_t) strlen(buf) + 1;
-        protobuf_set(self, PACKET_LENGTH, length);
+        packet->length = (uint32_t) res_len;
     }
     
     return ret;
@@ -2294,26 +2306,37 @@ Telescope_execute_default(struct Telescope *self)
     return AAOS_EBADCMD;
 }
 
+/*
+ * Cancellation from another connection, the slew or move in progress is stopped.
+ */
+static int
+Telescope_cancel(void *_self)
+{
+    struct Telescope *self = cast(Telescope(), _self);
+    
+    return Telescope_execute_stop(self);
+}
+
 static int
 Telescope_execute(void *_self)
 {
     struct Telescope *self = cast(Telescope(), _self);
-    uint16_t command;
     int ret;
     
     if (Telescope_protocol_check(self) != AAOS_OK) {
         return AAOS_EPROTOWRONG;
     }
     
-    protobuf_get(self, PACKET_COMMAND, &command);
-    
-    switch (command) {
+    switch (rpc_packet(self)->command) {
         case TELESCOPE_COMMAND_GET_INDEX_BY_NAME:
             ret = Telescope_execute_get_index_by_name(self);
             break;
         case TELESCOPE_COMMAND_STATUS:
             ret = Telescope_execute_status(self);
             break;
+        case TELESCOPE_COMMAND_CACHED_STATUS:
+            ret = Telescope_execute_cached_status(self);
+            break;
         case TELESCOPE_COMMAND_INFO:
             ret = Telescope_execute_info(self);
             break;
@@ -2451,6 +2474,7 @@ TelescopeClass_ctor(void *_self, va_list *app)
     Method selector;
     
     self->_.execute.method = (Method) 0;
+    self->_.abort.method = (Method) 0;
     
 #ifdef va_copy
     va_list ap;
@@ -2471,6 +2495,14 @@ TelescopeClass_ctor(void *_self, va_list *app)
             self->status.method = method;
             continue;
         }
+        if (selector == (Method) telescope_cached_status) {
+            if (tag) {
+                self->cached_status.tag = tag;
+                self->cached_status.selector = selector;
+            }
+            self->cached_status.method = method;
+            continue;
+        }
         if (selector == (Method) telescope_info) {
             if (tag) {
                 self->info.tag = tag;
@@ -2809,6 +2841,7 @@ Telescope_initialize(void)
                      telescope_get_index_by_name, "get_index_by_name", Telescope_get_index_by_name,
                      telescope_raw, "raw", Telescope_raw,
                      telescope_status, "status", Telescope_status,
+                     telescope_cached_status, "cached_status", Telescope_cached_status,
                      telescope_info, "info", Telescope_info,
                      telescope_power_on, "power_on", Telescope_power_on,
                      telescope_power_off, "power_off", Telescope_power_off,
@@ -2875,6 +2908,7 @@ telescope_virtual_table_initialize(void)
 {
     _telescope_virtual_table = new(RPCVirtualTable(),
                                    rpc_execute, "execute", Telescope_execute,
+                                   rpc_abort, "abort", Telescope_cancel,
                                    (void *)0);
     
 #ifndef _USE_COMPILER_ATTRIBUTION_
@@ -3071,10 +3105,9 @@ TelescopeServer_accept(void *_self, void **client)
 {
     struct RPCServer *self = cast(RPCServer(), _self);
     
-    int lfd, cfd;
+    int cfd;
     
-    lfd = tcp_server_get_lfd(self);
-    cfd = Accept(lfd, NULL, NULL);
+    cfd = rpc_server_accept_fd(self, TCPSERVER_OPTION_TCP);
     if (cfd < 0) {
         *client = NULL;
         return AAOS_ERROR;
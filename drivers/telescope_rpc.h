@@ -17,6 +17,11 @@
 #include "telescope_def.h"
 #include <stdint.h>
 
+/*
+ * Every change of the state of a telescope is published to the topic "telescope/<name>",
+ * with the new state as a uint32_t payload, see rpc_subscribe.
+ */
+
 #define TELESCOPE_COMMAND_RAW                   1
 #define TELESCOPE_COMMAND_STATUS                2
 #define TELESCOPE_COMMAND_POWER_ON              3
@@ -54,6 +59,7 @@
 #define TELESCOPE_COMMAND_DISABLE_DEROTATOR     35
 #define TELESCOPE_COMMAND_GET_DEROTATOR_ANGLE   36
 #define TELESCOPE_COMMAND_GET_FOCUS_LENGTH      37
+#define TELESCOPE_COMMAND_CACHED_STATUS         38
 
 #ifdef __cplusplus
 extern "C" {
@@ -74,6 +80,23 @@ int telescope_get_index_by_name(void *_self, const char *name);
  */
 int telescope_status(void *_self, char *res, size_t res_size, size_t *res_len);
 
+/**
+ * Cached status method of telescope object.
+ * @details The status is served from a snapshot refreshed by the telescope server periodically or on state change, instead of being recomputed on each request.
+ * @param[in,out] _self telescope object.
+ * @param[in] format \b TELESCOPE_STATUS_FORMAT_JSON for a JSON string, or \b TELESCOPE_STATUS_FORMAT_BINARY for a struct TelescopeStatusRecord.
+ * @param[in] res a pointer to restore the result.
+ * @param[in] res_size size of \b res.
+ * @param[in] res_len data length of \b res. If \b res_len is \b NULL, do nothing.
+ * @retval AAOS_OK
+ * No errors.
+ * @retval AAOS_EINVAL
+ * Unknown format.
+ * @retval AAOS_ENOSPC
+ * \b res is too small.
+ */
+int telescope_cached_status(void *_self, unsigned int format, void *res, size_t res_size, size_t *res_len);
+
 /**
  * Set options.
  * @param[in,out] _self telescope object.
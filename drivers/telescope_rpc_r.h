@@ -23,6 +23,7 @@ struct TelescopeClass {
     struct Method set_option;
 
     struct Method status;
+    struct Method cached_status;
     struct Method info;
     struct Method power_on;
     struct Method power_off;
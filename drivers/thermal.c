@@ -7,12 +7,26 @@
 //
 
 #include "def.h"
+#include "pdu_rpc.h"
+#include "rpc.h"
+#include "thermal_controller.h"
 #include "thermal_def.h"
 #include "thermal.h"
 #include "thermal_r.h"
 #include "virtual.h"
 #include "wrapper.h"
 
+#include <fcntl.h>
+#include <math.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#ifdef LINUX
+#include <sys/timerfd.h>
+#endif
+
 /*
  * ThermalUnit virtual table.
  */
@@ -55,10 +69,18 @@ __ThermalUnitVirtualTable_ctor(void *_self, va_list *app)
         
         if (selector == (Method) __thermal_unit_thermal_control) {
             if (tag) {
-                self->get_temperature.tag = tag;
-                self->get_temperature.selector = selector;
+                self->thermal_control.tag = tag;
+                self->thermal_control.selector = selector;
             }
-            self->get_temperature.method = method;
+            self->thermal_control.method = method;
+            continue;
+        }
+        if (selector == (Method) __thermal_unit_control_step) {
+            if (tag) {
+                self->control_step.tag = tag;
+                self->control_step.selector = selector;
+            }
+            self->control_step.method = method;
             continue;
         }
         if (selector == (Method) __thermal_unit_status) {
@@ -142,7 +164,7 @@ __thermal_unit_status(void *_self, void *buffer, size_t size, size_t *res_len)
         return ((int (*)(void *, void *, size_t, size_t *)) class->status.method)(_self, buffer, size, res_len);
     } else {
         int result;
-        forward(_self, &result, (Method) __thermal_unit_turn_on, "status", _self, buffer, size, res_len);
+        forward(_self, &result, (Method) __thermal_unit_status, "status", _self, buffer, size, res_len);
         return result;
     }
 }
@@ -185,28 +207,141 @@ __thermal_unit_thermal_control(void *_self)
     }
 }
 
+/*
+ * When the PWM of the heater switches next, the unit steps then as well as once per period.
+ */
+static double
+__ThermalUnit_next_switch(struct __ThermalUnit *self, double now)
+{
+    double next;
+    
+    Pthread_mutex_lock(&self->mtx);
+    next = thermal_controller_next_switch(&self->controller, now);
+    Pthread_mutex_unlock(&self->mtx);
+    
+    return next;
+}
+
+/*
+ * Control loop of a unit in a thread of its own, units run by a ThermalExecutor do not need it.
+ */
 static void *
 __ThermalUnit_thermal_control(void *_self)
 {
     struct __ThermalUnit *self = cast(__ThermalUnit(), _self);
-    double temperature;
-    int ret;
+    
+    struct timespec tp;
+    double now, next;
+    
     for (; ;) {
-        if ((ret = __thermal_unit_get_temperature(_self, &temperature)) != AAOS_OK) {
-            /*
-             *
-             */
-        }
-        if (temperature > self->highest && self->state == THERMAL_UNIT_STATE_ON) {
-            __thermal_unit_turn_off(_self);
-        } else if (temperature < self->lowest && self->state == THERMAL_UNIT_STATE_OFF) {
-            __thermal_unit_turn_on(_self);
+        __thermal_unit_control_step(_self);
+        Clock_gettime(CLOCK_MONOTONIC, &tp);
+        now = tp.tv_sec + tp.tv_nsec / 1000000000.;
+        next = __ThermalUnit_next_switch(self, now);
+        if (next - now < self->period) {
+            if (next > now) {
+                Nanosleep(next - now);
+            }
+        } else {
+            Nanosleep(self->period);
         }
-        Nanosleep(self->period);
     }
     return NULL;
 }
 
+int
+__thermal_unit_control_step(void *_self)
+{
+    const struct __ThermalUnitClass *class = (const struct __ThermalUnitClass *) classOf(_self);
+    
+    if (isOf(class, __ThermalUnitClass()) && class->control_step.method) {
+        return ((int (*)(void *)) class->control_step.method)(_self);
+    } else {
+        int result;
+        forward(_self, &result, (Method) __thermal_unit_control_step, "control_step", _self);
+        return result;
+    }
+}
+
+/*
+ * One step of on/off control around [lowest, highest], it must not sleep.
+ */
+static int
+__ThermalUnit_control_step(void *_self)
+{
+    double temperature;
+    int ret;
+    
+    if ((ret = __thermal_unit_get_temperature(_self, &temperature)) != AAOS_OK) {
+        __thermal_unit_regulate(_self, THERMAL_TEMPERATURE_INVALID);
+        return ret;
+    }
+    
+    return __thermal_unit_regulate(_self, temperature);
+}
+
+/*
+ * Feed a temperature to the controller of the unit, and switch the heater(s) as it decides.
+ * THERMAL_TEMPERATURE_INVALID, for a failed reading, turns the heater(s) off.
+ */
+int
+__thermal_unit_regulate(void *_self, double temperature)
+{
+    struct __ThermalUnit *self = cast(__ThermalUnit(), _self);
+    
+    struct timespec tp;
+    double now;
+    unsigned int state;
+    bool on;
+    int ret = AAOS_OK;
+    
+    Clock_gettime(CLOCK_MONOTONIC, &tp);
+    now = tp.tv_sec + tp.tv_nsec / 1000000000.;
+    
+    Pthread_mutex_lock(&self->mtx);
+    thermal_controller_update(&self->controller, temperature, now);
+    on = thermal_controller_switch(&self->controller, now);
+    state = self->state;
+    Pthread_mutex_unlock(&self->mtx);
+    
+    if (on && state == THERMAL_UNIT_STATE_OFF) {
+        ret = __thermal_unit_turn_on(_self);
+    } else if (!on && state == THERMAL_UNIT_STATE_ON) {
+        ret = __thermal_unit_turn_off(_self);
+    } else {
+        return AAOS_OK;
+    }
+    if (ret == AAOS_OK) {
+        Pthread_mutex_lock(&self->mtx);
+        self->controller.n_switch++;
+        Pthread_mutex_unlock(&self->mtx);
+    }
+    
+    return ret;
+}
+
+void
+__thermal_unit_get_controller(const void *_self, struct ThermalController *controller)
+{
+    struct __ThermalUnit *self = cast(__ThermalUnit(), _self);
+    
+    Pthread_mutex_lock(&self->mtx);
+    memcpy(controller, &self->controller, sizeof(struct ThermalController));
+    Pthread_mutex_unlock(&self->mtx);
+    controller->autotune.temperature = NULL;
+    controller->autotune.n = controller->autotune.capacity = 0;
+}
+
+void
+__thermal_unit_get_timing(const void *_self, struct ThermalUnitTiming *timing)
+{
+    struct __ThermalUnit *self = cast(__ThermalUnit(), _self);
+    
+    Pthread_mutex_lock(&self->mtx);
+    memcpy(timing, &self->timing, sizeof(struct ThermalUnitTiming));
+    Pthread_mutex_unlock(&self->mtx);
+}
+
 int
 __thermal_unit_turn_on(void *_self)
 {
@@ -241,7 +376,7 @@ __thermal_unit_get_temperature(const void *_self, double *temperature)
     const struct __ThermalUnitClass *class = (const struct __ThermalUnitClass *) classOf(_self);
     
     if (isOf(class, __ThermalUnitClass()) && class->get_temperature.method) {
-        return ((int (*)(const void *, double *)) class->turn_off.method)(_self, temperature);
+        return ((int (*)(const void *, double *)) class->get_temperature.method)(_self, temperature);
     } else {
         int result;
         forward(_self, &result, (Method) __thermal_unit_get_temperature, "get_temperature", _self, temperature);
@@ -264,7 +399,7 @@ __ThermalUnit_forward(const void *_self, void *result, Method selector, const ch
     
     void *obj = va_arg(*app, void *);
     
-    if (selector == (Method) __thermal_unit_turn_on || selector == (Method) __thermal_unit_turn_off) {
+    if (selector == (Method) __thermal_unit_turn_on || selector == (Method) __thermal_unit_turn_off || selector == (Method) __thermal_unit_control_step) {
         *((int *) result) = ((int (*)(void *)) method)(obj);
     } else if (selector == (Method) __thermal_unit_get_temperature) {
         double *temperature = va_arg(*app, double *);
@@ -294,7 +429,9 @@ __ThermalUnit_ctor(void *_self, va_list *app)
 {
     struct __ThermalUnit *self = super_ctor(__ThermalUnit(), _self, app);
     
-    const char *s, *key, *value;
+    const char *s, *key, *value, *controller = NULL;
+    double setpoint, kp = 0., ki = 0., kd = 0.;
+    int autotune = 0;
     
     s = va_arg(*app, const char *);
     if (s) {
@@ -306,6 +443,8 @@ __ThermalUnit_ctor(void *_self, va_list *app)
     self->highest = va_arg(*app, double);
     self->lowest = va_arg(*app, double);
     self->period = va_arg(*app, double);
+    thermal_controller_init(&self->controller, THERMAL_CONTROLLER_HYSTERESIS, self->lowest, self->highest);
+    setpoint = self->controller.setpoint;
     
     while ((key = va_arg(*app, const char *))) {
         if (strcmp(key, "description") == 0) {
@@ -316,6 +455,62 @@ __ThermalUnit_ctor(void *_self, va_list *app)
             }
             continue;
         }
+        if (strcmp(key, "helper") == 0) {
+            value = va_arg(*app, const char *);
+            if (value) {
+                self->helper = new(ThermalHelper(), value);
+            }
+            continue;
+        }
+        /*
+         * Controller, see thermal_controller.h.
+         */
+        if (strcmp(key, "controller") == 0) {
+            controller = va_arg(*app, const char *);
+            continue;
+        }
+        if (strcmp(key, "setpoint") == 0) {
+            setpoint = va_arg(*app, double);
+            continue;
+        }
+        if (strcmp(key, "kp") == 0) {
+            kp = va_arg(*app, double);
+            continue;
+        }
+        if (strcmp(key, "ki") == 0) {
+            ki = va_arg(*app, double);
+            continue;
+        }
+        if (strcmp(key, "kd") == 0) {
+            kd = va_arg(*app, double);
+            continue;
+        }
+        if (strcmp(key, "pwm_window") == 0) {
+            self->controller.pwm.window = va_arg(*app, double);
+            continue;
+        }
+        if (strcmp(key, "min_on") == 0) {
+            self->controller.pwm.min_on = va_arg(*app, double);
+            continue;
+        }
+        if (strcmp(key, "autotune") == 0) {
+            autotune = va_arg(*app, int);
+            continue;
+        }
+    }
+    
+    if (controller != NULL && strcmp(controller, "pid") == 0) {
+        thermal_controller_set_pid(&self->controller, setpoint, kp, ki, kd);
+    } else {
+        self->controller.setpoint = setpoint;
+    }
+    /*
+     * Autotune steps the heater(s) from off to on, after a baseline of ten periods,
+     * and stops the step at the highest temperature.
+     */
+    if (autotune) {
+        self->controller.setpoint = setpoint;
+        thermal_controller_autotune(&self->controller, 0., 1., 10. * self->period, THERMAL_AUTOTUNE_DURATION, self->highest);
     }
     
     Pthread_mutex_init(&self->mtx, NULL);
@@ -330,6 +525,10 @@ __ThermalUnit_dtor(void *_self)
     
     free(self->name);
     free(self->description);
+    if (self->helper != NULL) {
+        delete(self->helper);
+    }
+    thermal_controller_destroy(&self->controller);
     
     Pthread_mutex_destroy(&self->mtx);
     
@@ -376,6 +575,14 @@ __ThermalUnitClass_ctor(void *_self, va_list *app)
             self->thermal_control.method = method;
             continue;
         }
+        if (selector == (Method) __thermal_unit_control_step) {
+            if (tag) {
+                self->control_step.tag = tag;
+                self->control_step.selector = selector;
+            }
+            self->control_step.method = method;
+            continue;
+        }
         if (selector == (Method) __thermal_unit_get_temperature) {
             if (tag) {
                 self->get_temperature.tag = tag;
@@ -393,76 +600,670 @@ __ThermalUnitClass_ctor(void *_self, va_list *app)
             continue;
         }
     }
-    
-#ifdef va_copy
-    va_end(ap);
-#endif
+    
+#ifdef va_copy
+    va_end(ap);
+#endif
+    
+    return (void *) self;
+}
+
+static const void *___ThermalUnitClass;
+
+static void
+__ThermalUnitClass_destroy(void)
+{
+    free((void *) ___ThermalUnitClass);
+}
+
+static void
+__ThermalUnitClass_initialize(void)
+{
+    ___ThermalUnitClass = new(Class(), "__ThermalUnitClass", Class(), sizeof(struct __ThermalUnitClass),
+                              ctor, "ctor", __ThermalUnitClass_ctor,
+                              (void *) 0);
+#ifndef _USE_COMPILER_ATTRIBUTION_
+    atexit(__ThermalUnitClass_destroy);
+#endif
+}
+
+const void *
+__ThermalUnitClass(void)
+{
+#ifndef _USE_COMPILER_ATTRIBUTION_
+    static pthread_once_t once_control = PTHREAD_ONCE_INIT;
+    Pthread_once(&once_control, __ThermalUnitClass_initialize);
+#endif
+    
+    return ___ThermalUnitClass;
+}
+
+static const void *___ThermalUnit;
+
+static void
+__ThermalUnit_destroy(void)
+{
+    free((void *)___ThermalUnit);
+}
+
+static void
+__ThermalUnit_initialize(void)
+{
+    ___ThermalUnit = new(__ThermalUnitClass(), "__ThermalUnit", Object(), sizeof(struct __ThermalUnit),
+                         ctor, "ctor", __ThermalUnit_ctor,
+                         dtor, "dtor", __ThermalUnit_dtor,
+                         forward, "forward", __ThermalUnit_forward,
+                         __thermal_unit_get_name, "get_name", __ThermalUnit_get_name,
+                         __thermal_unit_thermal_control, "thermal_control", __ThermalUnit_thermal_control,
+                         __thermal_unit_control_step, "control_step", __ThermalUnit_control_step,
+                       (void *) 0);
+#ifndef _USE_COMPILER_ATTRIBUTION_
+    atexit(__ThermalUnit_destroy);
+#endif
+}
+
+const void *
+__ThermalUnit(void)
+{
+#ifndef _USE_COMPILER_ATTRIBUTION_
+    static pthread_once_t once_control = PTHREAD_ONCE_INIT;
+    Pthread_once(&once_control, __ThermalUnit_initialize);
+#endif
+    
+    return ___ThermalUnit;
+}
+
+/*
+ * Helper co-process of a unit.
+ */
+
+static int
+ThermalHelper_start(struct ThermalHelper *self)
+{
+    int sockfd[2];
+    pid_t pid;
+    
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sockfd) < 0) {
+        return AAOS_ERROR;
+    }
+    fcntl(sockfd[0], F_SETFD, FD_CLOEXEC);
+    fcntl(sockfd[1], F_SETFD, FD_CLOEXEC);
+    
+    if ((pid = fork()) < 0) {
+        Close(sockfd[0]);
+        Close(sockfd[1]);
+        return AAOS_ERROR;
+    } else if (pid == 0) {
+        setpgid(0, 0);
+        dup2(sockfd[1], STDIN_FILENO);
+        dup2(sockfd[1], STDOUT_FILENO);
+        execl("/bin/sh", "sh", "-c", self->command, (char *) NULL);
+        _exit(127);
+    }
+    
+    setpgid(pid, pid);
+    Close(sockfd[1]);
+    self->sockfd = sockfd[0];
+    self->pid = pid;
+    self->length = 0;
+    
+    return AAOS_OK;
+}
+
+static void
+ThermalHelper_stop(struct ThermalHelper *self)
+{
+    int i;
+    
+    /*
+     * A helper exits when its stdin is closed, otherwise it is terminated, and then killed,
+     * together with its children, since it leads a process group of its own.
+     */
+    if (self->sockfd >= 0) {
+        Close(self->sockfd);
+        self->sockfd = -1;
+    }
+    if (self->pid > 0) {
+        for (i = 0; i < 20 && waitpid(self->pid, NULL, WNOHANG) == 0; i++) {
+            if (i == 10) {
+                kill(-self->pid, SIGTERM);
+            }
+            Nanosleep(0.01);
+        }
+        if (i == 20) {
+            kill(-self->pid, SIGKILL);
+            waitpid(self->pid, NULL, 0);
+        }
+        self->pid = -1;
+    }
+    self->length = 0;
+}
+
+static int
+ThermalHelper_send(struct ThermalHelper *self, const char *request)
+{
+    char buf[THERMAL_HELPER_BUFSIZE];
+    size_t length, offset = 0;
+    ssize_t n;
+    
+    length = (size_t) snprintf(buf, sizeof(buf), "%s\n", request);
+    if (length >= sizeof(buf)) {
+        return AAOS_ECMDTOOLONG;
+    }
+    while (offset < length) {
+        if ((n = send(self->sockfd, buf + offset, length - offset, MSG_NOSIGNAL)) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return AAOS_EPIPE;
+        }
+        offset += n;
+    }
+    
+    return AAOS_OK;
+}
+
+static int
+ThermalHelper_receive(struct ThermalHelper *self, char *reply, size_t size)
+{
+    struct timespec tp;
+    struct pollfd pfd;
+    double deadline, now;
+    size_t length;
+    ssize_t n;
+    char *s;
+    
+    Clock_gettime(CLOCK_MONOTONIC, &tp);
+    deadline = tp.tv_sec + tp.tv_nsec / 1000000000. + self->timeout;
+    
+    while ((s = memchr(self->buf, '\n', self->length)) == NULL) {
+        if (self->length == sizeof(self->buf)) {
+            return AAOS_EBADMSG;
+        }
+        Clock_gettime(CLOCK_MONOTONIC, &tp);
+        now = tp.tv_sec + tp.tv_nsec / 1000000000.;
+        if (now >= deadline) {
+            return AAOS_ETIMEDOUT;
+        }
+        pfd.fd = self->sockfd;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        if (poll(&pfd, 1, (int) ((deadline - now) * 1000.) + 1) <= 0) {
+            continue;
+        }
+        if ((n = recv(self->sockfd, self->buf + self->length, sizeof(self->buf) - self->length, MSG_DONTWAIT)) > 0) {
+            self->length += n;
+        } else if (n == 0) {
+            return AAOS_EPIPE;
+        } else if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+            return AAOS_EIO;
+        }
+    }
+    
+    length = s - self->buf;
+    if (length > 0 && self->buf[length - 1] == '\r') {
+        length--;
+    }
+    if (reply != NULL && size > 0) {
+        if (length > size - 1) {
+            length = size - 1;
+        }
+        memcpy(reply, self->buf, length);
+        reply[length] = '\0';
+    }
+    self->length -= s + 1 - self->buf;
+    memmove(self->buf, s + 1, self->length);
+    
+    return AAOS_OK;
+}
+
+/*
+ * Send one request line, and wait for one reply line, at most timeout seconds.
+ * The helper is started on the first request, and after any failure,
+ * so that a late reply is never taken for the reply of the next request.
+ */
+int
+thermal_helper_request(void *_self, const char *request, char *reply, size_t size)
+{
+    struct ThermalHelper *self = cast(ThermalHelper(), _self);
+    
+    int ret = AAOS_OK;
+    
+    Pthread_mutex_lock(&self->mtx);
+    if (self->pid <= 0) {
+        ret = ThermalHelper_start(self);
+    }
+    if (ret == AAOS_OK && (ret = ThermalHelper_send(self, request)) == AAOS_OK) {
+        ret = ThermalHelper_receive(self, reply, size);
+    }
+    if (ret != AAOS_OK) {
+        ThermalHelper_stop(self);
+    }
+    Pthread_mutex_unlock(&self->mtx);
+    
+    return ret;
+}
+
+/*
+ * helper = new(ThermalHelper(), command)
+ */
+static void *
+ThermalHelper_ctor(void *_self, va_list *app)
+{
+    struct ThermalHelper *self = super_ctor(ThermalHelper(), _self, app);
+    
+    const char *s;
+    
+    s = va_arg(*app, const char *);
+    self->command = (char *) Malloc(strlen(s) + 1);
+    snprintf(self->command, strlen(s) + 1, "%s", s);
+    self->pid = -1;
+    self->sockfd = -1;
+    self->timeout = THERMAL_HELPER_TIMEOUT;
+    self->length = 0;
+    Pthread_mutex_init(&self->mtx, NULL);
+    
+    return (void *) self;
+}
+
+static void *
+ThermalHelper_dtor(void *_self)
+{
+    struct ThermalHelper *self = cast(ThermalHelper(), _self);
+    
+    ThermalHelper_stop(self);
+    free(self->command);
+    Pthread_mutex_destroy(&self->mtx);
+    
+    return super_dtor(ThermalHelper(), _self);
+}
+
+static const void *_ThermalHelper;
+
+static void
+ThermalHelper_destroy(void)
+{
+    free((void *) _ThermalHelper);
+}
+
+static void
+ThermalHelper_initialize(void)
+{
+    _ThermalHelper = new(Class(), "ThermalHelper", Object(), sizeof(struct ThermalHelper),
+                         ctor, "ctor", ThermalHelper_ctor,
+                         dtor, "dtor", ThermalHelper_dtor,
+                         (void *) 0);
+#ifndef _USE_COMPILER_ATTRIBUTION_
+    atexit(ThermalHelper_destroy);
+#endif
+}
+
+const void *
+ThermalHelper(void)
+{
+#ifndef _USE_COMPILER_ATTRIBUTION_
+    static pthread_once_t once_control = PTHREAD_ONCE_INIT;
+    Pthread_once(&once_control, ThermalHelper_initialize);
+#endif
+    
+    return _ThermalHelper;
+}
+
+/*
+ * Thermal channel.
+ */
+
+static char *
+ThermalChannel_copy(const char *s)
+{
+    char *copy = (char *) Malloc(strlen(s) + 1);
+    
+    snprintf(copy, strlen(s) + 1, "%s", s);
+    
+    return copy;
+}
+
+static int
+ThermalChannel_read_file(struct ThermalChannel *self, double *value)
+{
+    char buf[BUFSIZE], *end;
+    ssize_t n;
+    double v;
+    
+    if (self->fd < 0 && (self->fd = open(self->path, O_RDONLY)) < 0) {
+        return (errno == ENOENT) ? AAOS_ENOENT : AAOS_EIO;
+    }
+    fcntl(self->fd, F_SETFD, FD_CLOEXEC);
+    
+    /*
+     * sysfs attributes are refreshed by every read from offset 0.
+     */
+    if ((n = pread(self->fd, buf, sizeof(buf) - 1, 0)) <= 0) {
+        Close(self->fd);
+        self->fd = -1;
+        return AAOS_EIO;
+    }
+    buf[n] = '\0';
+    v = strtod(buf, &end);
+    if (end == buf) {
+        return AAOS_EBADMSG;
+    }
+    *value = v * self->scale;
+    
+    return AAOS_OK;
+}
+
+static int
+ThermalChannel_write_file(struct ThermalChannel *self, unsigned int state)
+{
+    const char *value;
+    size_t length;
+    
+    if (self->value != NULL) {
+        value = self->value;
+    } else {
+        value = (state == THERMAL_UNIT_STATE_ON) ? "1" : "0";
+    }
+    length = strlen(value);
+    
+    if (self->fd < 0 && (self->fd = open(self->path, O_WRONLY)) < 0) {
+        return (errno == ENOENT) ? AAOS_ENOENT : AAOS_EIO;
+    }
+    fcntl(self->fd, F_SETFD, FD_CLOEXEC);
+    
+    if (pwrite(self->fd, value, length, 0) != (ssize_t) length) {
+        Close(self->fd);
+        self->fd = -1;
+        return AAOS_EIO;
+    }
+    
+    return AAOS_OK;
+}
+
+static int
+ThermalChannel_connect_pdu(struct ThermalChannel *self)
+{
+    void *client;
+    char *end;
+    unsigned long n;
+    int ret;
+    
+    client = new(PDUClient(), self->address, self->port);
+    ret = rpc_client_connect(client, &self->pdu);
+    delete(client);
+    if (ret != AAOS_OK) {
+        self->pdu = NULL;
+        return ret;
+    }
+    
+    n = strtoul(self->pdu_name, &end, 0);
+    if (*end == '\0') {
+        self->index = (uint16_t) n;
+    } else if ((ret = pdu_get_index_by_name(self->pdu, self->pdu_name)) == AAOS_OK) {
+        protobuf_get(self->pdu, PACKET_INDEX, &self->index);
+    }
+    
+    n = strtoul(self->switch_name, &end, 0);
+    if (*end == '\0') {
+        self->channel = (uint16_t) n;
+    } else if (ret == AAOS_OK && (ret = pdu_get_channel_by_name(self->pdu, self->switch_name)) == AAOS_OK) {
+        protobuf_get(self->pdu, PACKET_CHANNEL, &self->channel);
+    }
+    
+    if (ret != AAOS_OK) {
+        delete(self->pdu);
+        self->pdu = NULL;
+    }
+    
+    return ret;
+}
+
+static int
+ThermalChannel_write_pdu(struct ThermalChannel *self, unsigned int state)
+{
+    int ret;
+    
+    if (self->address == NULL) {
+        return AAOS_EINVAL;
+    }
+    if (self->pdu == NULL && (ret = ThermalChannel_connect_pdu(self)) != AAOS_OK) {
+        return ret;
+    }
+    
+    protobuf_set(self->pdu, PACKET_INDEX, self->index);
+    protobuf_set(self->pdu, PACKET_CHANNEL, self->channel);
+    if (state == THERMAL_UNIT_STATE_ON) {
+        ret = pdu_turn_on(self->pdu);
+    } else {
+        ret = pdu_turn_off(self->pdu);
+    }
+    
+    /*
+     * Reconnect next time, if the connection is broken.
+     */
+    if (ret < 0) {
+        delete(self->pdu);
+        self->pdu = NULL;
+    }
+    
+    return ret;
+}
+
+static int
+ThermalChannel_read_command(struct ThermalChannel *self, double *value)
+{
+    int ret = AAOS_ERROR;
+    FILE *fp;
+    
+    if ((fp = popen(self->spec, "r")) != NULL) {
+        if (fscanf(fp, "%lf", value) == 1) {
+            ret = AAOS_OK;
+        }
+        pclose(fp);
+    }
+    
+    return ret;
+}
+
+static int
+ThermalChannel_write_command(struct ThermalChannel *self)
+{
+    FILE *fp;
+    
+    if ((fp = popen(self->spec, "r")) == NULL) {
+        return AAOS_ERROR;
+    }
+    pclose(fp);
+    
+    return AAOS_OK;
+}
+
+int
+thermal_channel_read(void *_self, double *value)
+{
+    struct ThermalChannel *self = cast(ThermalChannel(), _self);
+    
+    char reply[THERMAL_HELPER_BUFSIZE], *end;
+    int ret = AAOS_EINVAL;
+    
+    *value = 9999.;
+    Pthread_mutex_lock(&self->mtx);
+    switch (self->type) {
+        case THERMAL_CHANNEL_TYPE_FILE:
+            ret = ThermalChannel_read_file(self, value);
+            break;
+        case THERMAL_CHANNEL_TYPE_HELPER:
+            if (self->helper == NULL) {
+                break;
+            }
+            if ((ret = thermal_helper_request(self->helper, self->request, reply, sizeof(reply))) == AAOS_OK) {
+                *value = strtod(reply, &end);
+                if (end == reply) {
+                    *value = 9999.;
+                    ret = AAOS_EBADMSG;
+                }
+            }
+            break;
+        case THERMAL_CHANNEL_TYPE_COMMAND:
+            ret = ThermalChannel_read_command(self, value);
+            break;
+        default:
+            break;
+    }
+    Pthread_mutex_unlock(&self->mtx);
+    
+    return ret;
+}
+
+int
+thermal_channel_write(void *_self, unsigned int state)
+{
+    struct ThermalChannel *self = cast(ThermalChannel(), _self);
+    
+    char reply[THERMAL_HELPER_BUFSIZE];
+    int ret = AAOS_EINVAL;
+    
+    Pthread_mutex_lock(&self->mtx);
+    switch (self->type) {
+        case THERMAL_CHANNEL_TYPE_FILE:
+            ret = ThermalChannel_write_file(self, state);
+            break;
+        case THERMAL_CHANNEL_TYPE_PDU:
+            ret = ThermalChannel_write_pdu(self, state);
+            break;
+        case THERMAL_CHANNEL_TYPE_HELPER:
+            if (self->helper == NULL) {
+                break;
+            }
+            if ((ret = thermal_helper_request(self->helper, self->request, reply, sizeof(reply))) == AAOS_OK && strncmp(reply, "OK", 2) != 0) {
+                ret = AAOS_EFAILED;
+            }
+            break;
+        case THERMAL_CHANNEL_TYPE_COMMAND:
+            ret = ThermalChannel_write_command(self);
+            break;
+        default:
+            break;
+    }
+    Pthread_mutex_unlock(&self->mtx);
+    
+    return ret;
+}
+
+/*
+ * channel = new(ThermalChannel(), spec, helper)
+ * helper is the ThermalHelper of the unit, or NULL.
+ */
+static void *
+ThermalChannel_ctor(void *_self, va_list *app)
+{
+    struct ThermalChannel *self = super_ctor(ThermalChannel(), _self, app);
+    
+    const char *spec;
+    char *s, *fields[3];
+    int i;
+    
+    spec = va_arg(*app, const char *);
+    self->helper = va_arg(*app, struct ThermalHelper *);
+    self->spec = ThermalChannel_copy(spec);
+    self->fd = -1;
+    self->scale = 1.;
+    
+    if (strncmp(spec, "file:", 5) == 0) {
+        self->type = THERMAL_CHANNEL_TYPE_FILE;
+        self->path = ThermalChannel_copy(spec + 5);
+        if ((s = strrchr(self->path, '=')) != NULL) {
+            *s = '\0';
+            self->value = ThermalChannel_copy(s + 1);
+        } else if ((s = strrchr(self->path, '*')) != NULL) {
+            *s = '\0';
+            self->scale = atof(s + 1);
+        }
+    } else if (strncmp(spec, "pdu:", 4) == 0) {
+        /*
+         * Split from the right, the address may be an IPv6 address.
+         */
+        self->type = THERMAL_CHANNEL_TYPE_PDU;
+        self->address = ThermalChannel_copy(spec + 4);
+        for (i = 2; i >= 0; i--) {
+            if ((s = strrchr(self->address, ':')) == NULL) {
+                break;
+            }
+            *s = '\0';
+            fields[i] = s + 1;
+        }
+        if (i >= 0) {
+            free(self->address);
+            self->address = NULL;
+        } else {
+            self->port = ThermalChannel_copy(fields[0]);
+            self->pdu_name = ThermalChannel_copy(fields[1]);
+            self->switch_name = ThermalChannel_copy(fields[2]);
+        }
+    } else if (strncmp(spec, "helper:", 7) == 0) {
+        self->type = THERMAL_CHANNEL_TYPE_HELPER;
+        self->request = ThermalChannel_copy(spec + 7);
+    } else {
+        self->type = THERMAL_CHANNEL_TYPE_COMMAND;
+    }
+    Pthread_mutex_init(&self->mtx, NULL);
     
     return (void *) self;
 }
 
-static const void *___ThermalUnitClass;
-
-static void
-__ThermalUnitClass_destroy(void)
-{
-    free((void *) ___ThermalUnitClass);
-}
-
-static void
-__ThermalUnitClass_initialize(void)
-{
-    ___ThermalUnitClass = new(Class(), "__ThermalUnitClass", Class(), sizeof(struct __ThermalUnitClass),
-                              ctor, "ctor", __ThermalUnitClass_ctor,
-                              (void *) 0);
-#ifndef _USE_COMPILER_ATTRIBUTION_
-    atexit(__ThermalUnitClass_destroy);
-#endif
-}
-
-const void *
-__ThermalUnitClass(void)
+static void *
+ThermalChannel_dtor(void *_self)
 {
-#ifndef _USE_COMPILER_ATTRIBUTION_
-    static pthread_once_t once_control = PTHREAD_ONCE_INIT;
-    Pthread_once(&once_control, __ThermalUnitClass_initialize);
-#endif
+    struct ThermalChannel *self = cast(ThermalChannel(), _self);
     
-    return ___ThermalUnitClass;
+    if (self->fd >= 0) {
+        Close(self->fd);
+    }
+    if (self->pdu != NULL) {
+        delete(self->pdu);
+    }
+    free(self->spec);
+    free(self->path);
+    free(self->value);
+    free(self->address);
+    free(self->port);
+    free(self->pdu_name);
+    free(self->switch_name);
+    free(self->request);
+    Pthread_mutex_destroy(&self->mtx);
+    
+    return super_dtor(ThermalChannel(), _self);
 }
 
-static const void *___ThermalUnit;
+static const void *_ThermalChannel;
 
 static void
-__ThermalUnit_destroy(void)
+ThermalChannel_destroy(void)
 {
-    free((void *)___ThermalUnit);
+    free((void *) _ThermalChannel);
 }
 
 static void
-__ThermalUnit_initialize(void)
+ThermalChannel_initialize(void)
 {
-    ___ThermalUnit = new(__ThermalUnitClass(), "__ThermalUnit", Object(), sizeof(struct __ThermalUnit),
-                         ctor, "ctor", __ThermalUnit_ctor,
-                         dtor, "dtor", __ThermalUnit_dtor,
-                         forward, "forward", __ThermalUnit_forward,
-                         __thermal_unit_get_name, "get_name", __ThermalUnit_get_name,
-                         __thermal_unit_thermal_control, "thermal_control", __ThermalUnit_thermal_control,
-                       (void *) 0);
+    _ThermalChannel = new(Class(), "ThermalChannel", Object(), sizeof(struct ThermalChannel),
+                          ctor, "ctor", ThermalChannel_ctor,
+                          dtor, "dtor", ThermalChannel_dtor,
+                          (void *) 0);
 #ifndef _USE_COMPILER_ATTRIBUTION_
-    atexit(__ThermalUnit_destroy);
+    atexit(ThermalChannel_destroy);
 #endif
 }
 
 const void *
-__ThermalUnit(void)
+ThermalChannel(void)
 {
 #ifndef _USE_COMPILER_ATTRIBUTION_
     static pthread_once_t once_control = PTHREAD_ONCE_INIT;
-    Pthread_once(&once_control, __ThermalUnit_initialize);
+    Pthread_once(&once_control, ThermalChannel_initialize);
 #endif
     
-    return ___ThermalUnit;
+    return _ThermalChannel;
 }
 
 /*
@@ -473,7 +1274,8 @@ __ThermalUnit(void)
 static const void *simple_thermal_unit_virtual_table(void);
 
 /*
- * tu = new(SimpleThermalUnit(), ..., temp_cmd, turn_on_cmd, turn_off_cmd)
+ * tu = new(SimpleThermalUnit(), ..., temp, turn_on, turn_off)
+ * Every command is a channel specification, see thermal_channel_read.
  */
 static void *
 SimpleThermalUnit_ctor(void *_self, va_list *app)
@@ -486,18 +1288,15 @@ SimpleThermalUnit_ctor(void *_self, va_list *app)
     
     s = va_arg(*app, char *);
     if (s) {
-        self->temp_cmd = (char *) Malloc(strlen(s) + 1);
-        snprintf(self->temp_cmd, strlen(s) + 1, "%s", s);
+        self->temp_channel = new(ThermalChannel(), s, self->_.helper);
     }
     s = va_arg(*app, char *);
     if (s) {
-        self->turn_on_cmd = (char *) Malloc(strlen(s) + 1);
-        snprintf(self->turn_on_cmd, strlen(s) + 1, "%s", s);
+        self->turn_on_channel = new(ThermalChannel(), s, self->_.helper);
     }
     s = va_arg(*app, char *);
     if (s) {
-        self->turn_off_cmd = (char *) Malloc(strlen(s) + 1);
-        snprintf(self->turn_off_cmd, strlen(s) + 1, "%s", s);
+        self->turn_off_channel = new(ThermalChannel(), s, self->_.helper);
     }
     
     return (void *) self;
@@ -508,9 +1307,9 @@ SimpleThermalUnit_dtor(void *_self)
 {
     struct SimpleThermalUnit *self = cast(SimpleThermalUnit(), _self);
     
-    free(self->temp_cmd);
-    free(self->turn_on_cmd);
-    free(self->turn_off_cmd);
+    delete(self->temp_channel);
+    delete(self->turn_on_channel);
+    delete(self->turn_off_channel);
     
     return super_dtor(KLCAMSimpleThermalUnit(), _self);
 }
@@ -596,13 +1395,11 @@ SimpleThermalUnit_turn_on(void *_self)
     struct SimpleThermalUnit *self = cast(SimpleThermalUnit(), _self);
     
     int ret = AAOS_ERROR;
-    FILE *fp;
     
-    if (self->turn_on_cmd != NULL && (fp = popen(self->turn_on_cmd, "r")) != NULL) {
+    if (self->turn_on_channel != NULL && (ret = thermal_channel_write(self->turn_on_channel, THERMAL_UNIT_STATE_ON)) == AAOS_OK) {
         Pthread_mutex_lock(&self->_.mtx);
         self->_.state = THERMAL_UNIT_STATE_ON;
         Pthread_mutex_unlock(&self->_.mtx);
-        pclose(fp);
     }
     
     return ret;
@@ -614,13 +1411,11 @@ SimpleThermalUnit_turn_off(void *_self)
     struct SimpleThermalUnit *self = cast(SimpleThermalUnit(), _self);
     
     int ret = AAOS_ERROR;
-    FILE *fp;
     
-    if (self->turn_off_cmd != NULL && (fp = popen(self->turn_off_cmd, "r")) != NULL) {
+    if (self->turn_off_channel != NULL && (ret = thermal_channel_write(self->turn_off_channel, THERMAL_UNIT_STATE_OFF)) == AAOS_OK) {
         Pthread_mutex_lock(&self->_.mtx);
         self->_.state = THERMAL_UNIT_STATE_OFF;
         Pthread_mutex_unlock(&self->_.mtx);
-        pclose(fp);
     }
     
     return ret;
@@ -631,16 +1426,12 @@ SimpleThermalUnit_get_temperature(void *_self, double *temperature)
 {
     struct SimpleThermalUnit *self = cast(SimpleThermalUnit(), _self);
     
-    int ret = AAOS_ERROR;
-    FILE *fp;
-    
     *temperature = 9999.;
-    if (self->temp_cmd != NULL && (fp = popen(self->temp_cmd, "r")) != NULL) {
-        fscanf(fp, "%lf", temperature);
-        pclose(fp);
+    if (self->temp_channel == NULL) {
+        return AAOS_ERROR;
     }
     
-    return ret;
+    return thermal_channel_read(self->temp_channel, temperature);
 }
 
 static const void *_simple_thermal_unit_virtual_table;
@@ -683,7 +1474,8 @@ simple_thermal_unit_virtual_table(void)
 static const void *klcam_simple_thermal_unit_virtual_table(void);
 
 /*
- * tu = new(KLCAMSimpleThermalUnit(), ..., temp_cmd, turn_on_cmd, turn_off_cmd, temp_cmd2, turn_on_cmd2, turn_off_cmd2, temp_cmd3, threshold)
+ * tu = new(KLCAMSimpleThermalUnit(), ..., temp, turn_on, turn_off, temp2, turn_on2, turn_off2, temp3, threshold)
+ * Every command is a channel specification, see thermal_channel_read.
  */
 static void *
 KLCAMSimpleThermalUnit_ctor(void *_self, va_list *app)
@@ -696,39 +1488,33 @@ KLCAMSimpleThermalUnit_ctor(void *_self, va_list *app)
     
     s = va_arg(*app, char *);
     if (s) {
-        self->temp_cmd = (char *) Malloc(strlen(s) + 1);
-        snprintf(self->temp_cmd, strlen(s) + 1, "%s", s);
+        self->temp_channel = new(ThermalChannel(), s, self->_.helper);
     }
     s = va_arg(*app, char *);
     if (s) {
-        self->turn_on_cmd = (char *) Malloc(strlen(s) + 1);
-        snprintf(self->turn_on_cmd, strlen(s) + 1, "%s", s);
+        self->turn_on_channel = new(ThermalChannel(), s, self->_.helper);
     }
     s = va_arg(*app, char *);
     if (s) {
-        self->turn_off_cmd = (char *) Malloc(strlen(s) + 1);
-        snprintf(self->turn_off_cmd, strlen(s) + 1, "%s", s);
+        self->turn_off_channel = new(ThermalChannel(), s, self->_.helper);
     }
     s = va_arg(*app, char *);
     if (s) {
-        self->temp_cmd2 = (char *) Malloc(strlen(s) + 1);
-        snprintf(self->temp_cmd2, strlen(s) + 1, "%s", s);
+        self->temp_channel2 = new(ThermalChannel(), s, self->_.helper);
     }
     s = va_arg(*app, char *);
     if (s) {
-        self->turn_on_cmd2 = (char *) Malloc(strlen(s) + 1);
-        snprintf(self->turn_on_cmd2, strlen(s) + 1, "%s", s);
+        self->turn_on_channel2 = new(ThermalChannel(), s, self->_.helper);
     }
     s = va_arg(*app, char *);
     if (s) {
-        self->turn_off_cmd2 = (char *) Malloc(strlen(s) + 1);
-        snprintf(self->turn_off_cmd2, strlen(s) + 1, "%s", s);
+        self->turn_off_channel2 = new(ThermalChannel(), s, self->_.helper);
     }
     s = va_arg(*app, char *);
     if (s) {
-        self->temp_cmd3 = (char *) Malloc(strlen(s) + 1);
-        snprintf(self->temp_cmd3, strlen(s) + 1, "%s", s);
+        self->temp_channel3 = new(ThermalChannel(), s, self->_.helper);
     }
+    self->threshold = va_arg(*app, double);
     
     Pthread_mutex_init(&self->mtx, NULL);
     return (void *) self;
@@ -739,13 +1525,13 @@ KLCAMSimpleThermalUnit_dtor(void *_self)
 {
     struct KLCAMSimpleThermalUnit *self = cast(KLCAMSimpleThermalUnit(), _self);
     
-    free(self->temp_cmd);
-    free(self->turn_on_cmd);
-    free(self->turn_off_cmd);
-    free(self->temp_cmd2);
-    free(self->turn_on_cmd2);
-    free(self->turn_off_cmd2);
-    free(self->temp_cmd3);
+    delete(self->temp_channel);
+    delete(self->turn_on_channel);
+    delete(self->turn_off_channel);
+    delete(self->temp_channel2);
+    delete(self->turn_on_channel2);
+    delete(self->turn_off_channel2);
+    delete(self->temp_channel3);
     
     Pthread_mutex_destroy(&self->mtx);
     
@@ -760,7 +1546,7 @@ KLCAMSimpleThermalUnitClass_ctor(void *_self, va_list *app)
     self->_.get_temperature.method = (Method) 0;
     self->_.turn_on.method = (Method) 0;
     self->_.turn_off.method = (Method) 0;
-    self->_.thermal_control.method = (Method) 0;
+    self->_.control_step.method = (Method) 0;
     self->_.status.method = (Method) 0;
     
     return self;
@@ -835,13 +1621,11 @@ KLCAMSimpleThermalUnit_turn_on(void *_self)
     struct KLCAMSimpleThermalUnit *self = cast(KLCAMSimpleThermalUnit(), _self);
     
     int ret = AAOS_ERROR;
-    FILE *fp;
     
-    if (self->turn_on_cmd != NULL && (fp = popen(self->turn_on_cmd, "r")) != NULL) {
+    if (self->turn_on_channel != NULL && (ret = thermal_channel_write(self->turn_on_channel, THERMAL_UNIT_STATE_ON)) == AAOS_OK) {
         Pthread_mutex_lock(&self->_.mtx);
         self->_.state = THERMAL_UNIT_STATE_ON;
         Pthread_mutex_unlock(&self->_.mtx);
-        pclose(fp);
     }
     
     return ret;
@@ -853,13 +1637,11 @@ KLCAMSimpleThermalUnit_turn_off(void *_self)
     struct KLCAMSimpleThermalUnit *self = cast(KLCAMSimpleThermalUnit(), _self);
     
     int ret = AAOS_ERROR;
-    FILE *fp;
     
-    if (self->turn_off_cmd != NULL && (fp = popen(self->turn_off_cmd, "r")) != NULL) {
+    if (self->turn_off_channel != NULL && (ret = thermal_channel_write(self->turn_off_channel, THERMAL_UNIT_STATE_OFF)) == AAOS_OK) {
         Pthread_mutex_lock(&self->_.mtx);
         self->_.state = THERMAL_UNIT_STATE_OFF;
         Pthread_mutex_unlock(&self->_.mtx);
-        pclose(fp);
     }
     
     return ret;
@@ -870,101 +1652,97 @@ KLCAMSimpleThermalUnit_get_temperature(void *_self, double *temperature)
 {
     struct KLCAMSimpleThermalUnit *self = cast(KLCAMSimpleThermalUnit(), _self);
     
-    int ret = AAOS_ERROR;
-    FILE *fp;
-    
     *temperature = 9999.;
-    if (self->temp_cmd != NULL && (fp = popen(self->temp_cmd, "r")) != NULL) {
-        fscanf(fp, "%lf", temperature);
-        pclose(fp);
+    if (self->temp_channel == NULL) {
+        return AAOS_ERROR;
+    }
+    
+    return thermal_channel_read(self->temp_channel, temperature);
+}
+
+static int
+KLCAMSimpleThermalUnit_switch(void *channel, unsigned int state, pthread_mutex_t *mtx, unsigned int *current)
+{
+    int ret;
+    
+    if (channel == NULL) {
+        return AAOS_ENOTSUP;
+    }
+    if ((ret = thermal_channel_write(channel, state)) == AAOS_OK) {
+        Pthread_mutex_lock(mtx);
+        *current = state;
+        Pthread_mutex_unlock(mtx);
     }
     
     return ret;
 }
 
-static void *
-KLCAMSimpleThermalUnit_thermal_control(void *_self)
+static int
+KLCAMSimpleThermalUnit_control_step(void *_self)
 {
     struct KLCAMSimpleThermalUnit *self = cast(KLCAMSimpleThermalUnit(), _self);
     
-    double temp, temp2, temp3, highest = self->_.highest, lowest = self->_.lowest, threshold = self->threshold;
-    FILE *fp;
+    struct timespec tp;
+    double temp, temp2, temp3, threshold = self->threshold;
+    unsigned int state, state2;
+    bool on;
     
-    if (self->turn_off_cmd != NULL && (fp = popen(self->turn_off_cmd, "r")) != NULL) {
-        Pthread_mutex_lock(&self->_.mtx);
-        self->_.state = THERMAL_UNIT_STATE_OFF;
-        Pthread_mutex_unlock(&self->_.mtx);
-        pclose(fp);
+    if (!self->started) {
+        KLCAMSimpleThermalUnit_switch(self->turn_off_channel, THERMAL_UNIT_STATE_OFF, &self->_.mtx, &self->_.state);
+        KLCAMSimpleThermalUnit_switch(self->turn_off_channel2, THERMAL_UNIT_STATE_OFF, &self->mtx, &self->state);
+        self->started = true;
     }
     
-    if (self->turn_off_cmd2 != NULL && (fp = popen(self->turn_off_cmd2, "r")) != NULL) {
-        Pthread_mutex_lock(&self->mtx);
-        self->state = THERMAL_UNIT_STATE_OFF;
-        Pthread_mutex_unlock(&self->mtx);
-        pclose(fp);
+    temp = temp2 = temp3 = 9999.;
+    if (self->temp_channel != NULL) {
+        thermal_channel_read(self->temp_channel, &temp);
+    }
+    if (self->temp_channel2 != NULL) {
+        thermal_channel_read(self->temp_channel2, &temp2);
+    }
+    if (self->temp_channel3 != NULL) {
+        thermal_channel_read(self->temp_channel3, &temp3);
+    }
+    if (temp == 9999. && temp2 != 9999.) {
+        temp = temp2;
     }
     
-    for (;;) {
-        temp = 9999.;
-        if (self->temp_cmd != NULL && (fp = popen(self->temp_cmd, "r")) != NULL) {
-            fscanf(fp, "%lf", &temp);
-            pclose(fp);
-        }
-        temp2 = 9999.;
-        if (self->temp_cmd2 != NULL && (fp = popen(self->temp_cmd2, "r")) != NULL) {
-            fscanf(fp, "%lf", &temp2);
-            pclose(fp);
-        }
-        temp3 = 9999.;
-        if (self->temp_cmd3 != NULL && (fp = popen(self->temp_cmd3, "r")) != NULL) {
-            fscanf(fp, "%lf", &temp3);
-            pclose(fp);
-        }
-        if (temp == 9999. && temp2 != 9999.) {
-            temp = temp2;
-        }
-        
-        /*
-         * internal heater(s)
-         */
-        if (temp < lowest && self->_.state == THERMAL_UNIT_STATE_OFF) {
-            if (self->turn_on_cmd != NULL && (fp = popen(self->turn_on_cmd, "r")) != NULL) {
-                Pthread_mutex_lock(&self->_.mtx);
-                self->_.state = THERMAL_UNIT_STATE_ON;
-                Pthread_mutex_unlock(&self->_.mtx);
-                pclose(fp);
-            }
-        } else if (temp > highest && self->state == THERMAL_UNIT_STATE_ON) {
-            if (self->turn_off_cmd != NULL && (fp = popen(self->turn_off_cmd, "r")) != NULL) {
-                Pthread_mutex_lock(&self->_.mtx);
-                self->_.state = THERMAL_UNIT_STATE_OFF;
-                Pthread_mutex_unlock(&self->_.mtx);
-                pclose(fp);
-            }
+    Clock_gettime(CLOCK_MONOTONIC, &tp);
+    Pthread_mutex_lock(&self->_.mtx);
+    thermal_controller_update(&self->_.controller, temp, tp.tv_sec + tp.tv_nsec / 1000000000.);
+    on = thermal_controller_switch(&self->_.controller, tp.tv_sec + tp.tv_nsec / 1000000000.);
+    state = self->_.state;
+    Pthread_mutex_unlock(&self->_.mtx);
+    Pthread_mutex_lock(&self->mtx);
+    state2 = self->state;
+    Pthread_mutex_unlock(&self->mtx);
+    
+    /*
+     * internal heater(s), by the controller of the unit
+     */
+    if (on && state == THERMAL_UNIT_STATE_OFF) {
+        if (KLCAMSimpleThermalUnit_switch(self->turn_on_channel, THERMAL_UNIT_STATE_ON, &self->_.mtx, &self->_.state) == AAOS_OK) {
+            Pthread_mutex_lock(&self->_.mtx);
+            self->_.controller.n_switch++;
+            Pthread_mutex_unlock(&self->_.mtx);
         }
-        /*
-         * external heater(s)
-         */
-        if (temp3 < threshold && self->state == THERMAL_UNIT_STATE_OFF) {
-            if (self->turn_on_cmd2 != NULL && (fp = popen(self->turn_on_cmd2, "r")) != NULL) {
-                Pthread_mutex_lock(&self->mtx);
-                self->state = THERMAL_UNIT_STATE_ON;
-                Pthread_mutex_unlock(&self->mtx);
-                pclose(fp);
-            }
-        } else if (temp3 > threshold && self->state == THERMAL_UNIT_STATE_ON) {
-            if (self->turn_off_cmd != NULL && (fp = popen(self->turn_off_cmd, "r")) != NULL) {
-                Pthread_mutex_lock(&self->mtx);
-                self->state = THERMAL_UNIT_STATE_OFF;
-                Pthread_mutex_unlock(&self->mtx);
-                pclose(fp);
-            }
+    } else if (!on && state == THERMAL_UNIT_STATE_ON) {
+        if (KLCAMSimpleThermalUnit_switch(self->turn_off_channel, THERMAL_UNIT_STATE_OFF, &self->_.mtx, &self->_.state) == AAOS_OK) {
+            Pthread_mutex_lock(&self->_.mtx);
+            self->_.controller.n_switch++;
+            Pthread_mutex_unlock(&self->_.mtx);
         }
-        
-        Nanosleep(self->_.period);
+    }
+    /*
+     * external heater(s)
+     */
+    if (temp3 < threshold && state2 == THERMAL_UNIT_STATE_OFF) {
+        KLCAMSimpleThermalUnit_switch(self->turn_on_channel2, THERMAL_UNIT_STATE_ON, &self->mtx, &self->state);
+    } else if (temp3 > threshold && state2 == THERMAL_UNIT_STATE_ON) {
+        KLCAMSimpleThermalUnit_switch(self->turn_off_channel2, THERMAL_UNIT_STATE_OFF, &self->mtx, &self->state);
     }
     
-    return NULL;
+    return AAOS_OK;
 }
 
 static int
@@ -979,7 +1757,7 @@ KLCAMSimpleThermalUnit_status(void *_self, void *buffer, size_t size, size_t *re
     Pthread_mutex_unlock(&self->mtx);
     
     Pthread_mutex_lock(&self->_.mtx);
-    status2 = self->_.state;
+    status = self->_.state;
     Pthread_mutex_unlock(&self->_.mtx);
     
     if (size < 4) {
@@ -1012,7 +1790,7 @@ klcam_simple_thermal_unit_virtual_table_initialize(void)
                                                    __thermal_unit_turn_off, "turn_off", KLCAMSimpleThermalUnit_turn_off,
                                                    __thermal_unit_status, "status", KLCAMSimpleThermalUnit_status,
                                                    __thermal_unit_get_temperature, "get_temperature", KLCAMSimpleThermalUnit_get_temperature,
-                                                   __thermal_unit_thermal_control, "thermal_control", KLCAMSimpleThermalUnit_thermal_control,
+                                                   __thermal_unit_control_step, "control_step", KLCAMSimpleThermalUnit_control_step,
                                                    (void *)0);
 #ifndef _USE_COMPILER_ATTRIBUTION_
     atexit(klcam_simple_thermal_unit_virtual_table_destroy);
@@ -1323,3 +2101,314 @@ klcam_thermal_unit_virtual_table(void)
     return _klcam_thermal_unit_virtual_table;
 }
 */
+
+/*
+ * Control executor.
+ */
+
+static double
+ThermalExecutor_now(void)
+{
+    struct timespec tp;
+    
+    Clock_gettime(CLOCK_MONOTONIC, &tp);
+    
+    return tp.tv_sec + tp.tv_nsec / 1000000000.;
+}
+
+static void
+ThermalExecutor_sift_up(struct ThermalExecutor *self, size_t i)
+{
+    struct ThermalExecutorEntry entry = self->heap[i];
+    size_t parent;
+    
+    while (i > 0) {
+        parent = (i - 1) / 2;
+        if (self->heap[parent].release <= entry.release) {
+            break;
+        }
+        self->heap[i] = self->heap[parent];
+        i = parent;
+    }
+    self->heap[i] = entry;
+}
+
+static void
+ThermalExecutor_sift_down(struct ThermalExecutor *self, size_t i)
+{
+    struct ThermalExecutorEntry entry = self->heap[i];
+    size_t child;
+    
+    while ((child = 2 * i + 1) < self->n_entry) {
+        if (child + 1 < self->n_entry && self->heap[child + 1].release < self->heap[child].release) {
+            child++;
+        }
+        if (entry.release <= self->heap[child].release) {
+            break;
+        }
+        self->heap[i] = self->heap[child];
+        i = child;
+    }
+    self->heap[i] = entry;
+}
+
+static void
+ThermalExecutor_wake(struct ThermalExecutor *self)
+{
+    char c = 0;
+    
+    write(self->wake[1], &c, 1);
+}
+
+/*
+ * Sleep until release, or forever if it is negative.
+ * AAOS_OK is returned when release is reached, AAOS_EINTR when woken up by
+ * thermal_executor_add or thermal_executor_stop.
+ */
+static int
+ThermalExecutor_wait(struct ThermalExecutor *self, double release)
+{
+    struct pollfd pfd[2];
+    nfds_t nfds = 1;
+    int n, timeout = -1;
+    char buf[64];
+    
+    pfd[0].fd = self->wake[0];
+    pfd[0].events = POLLIN;
+    pfd[0].revents = 0;
+#ifdef LINUX
+    if (release >= 0. && self->timerfd >= 0) {
+        struct itimerspec its;
+        memset(&its, '\0', sizeof(its));
+        its.it_value.tv_sec = (time_t) release;
+        its.it_value.tv_nsec = (long) ((release - its.it_value.tv_sec) * 1000000000.);
+        if (its.it_value.tv_sec == 0 && its.it_value.tv_nsec == 0) {
+            its.it_value.tv_nsec = 1;
+        }
+        timerfd_settime(self->timerfd, TFD_TIMER_ABSTIME, &its, NULL);
+        pfd[1].fd = self->timerfd;
+        pfd[1].events = POLLIN;
+        pfd[1].revents = 0;
+        nfds = 2;
+    }
+#endif
+    if (release >= 0. && nfds == 1) {
+        double remaining = release - ThermalExecutor_now();
+        timeout = remaining > 0. ? (int) (remaining * 1000.) + 1 : 0;
+    }
+    
+    if ((n = poll(pfd, nfds, timeout)) < 0) {
+        return errno == EINTR ? AAOS_EINTR : AAOS_ERROR;
+    }
+    if (pfd[0].revents & POLLIN) {
+        while (read(self->wake[0], buf, sizeof(buf)) > 0) {
+        }
+        return AAOS_EINTR;
+    }
+    if (nfds == 2 && (pfd[1].revents & POLLIN)) {
+        uint64_t expirations;
+        read(self->timerfd, &expirations, sizeof(expirations));
+        return AAOS_OK;
+    }
+    
+    return n == 0 ? AAOS_OK : AAOS_EINTR;
+}
+
+static void *
+ThermalExecutor_thr(void *arg)
+{
+    struct ThermalExecutor *self = (struct ThermalExecutor *) arg;
+    struct ThermalExecutorEntry entry;
+    struct __ThermalUnit *unit;
+    double release, start, end, jitter;
+    uint64_t k;
+    
+    Pthread_mutex_lock(&self->mtx);
+    while (!self->stop) {
+        release = self->n_entry > 0 ? self->heap[0].release : -1.;
+        Pthread_mutex_unlock(&self->mtx);
+        ThermalExecutor_wait(self, release);
+        Pthread_mutex_lock(&self->mtx);
+        if (self->stop || self->n_entry == 0 || self->heap[0].release > (start = ThermalExecutor_now())) {
+            continue;
+        }
+        /*
+         * Take the unit out of the heap while its step runs, units may be added meanwhile.
+         */
+        entry = self->heap[0];
+        self->heap[0] = self->heap[--self->n_entry];
+        if (self->n_entry > 0) {
+            ThermalExecutor_sift_down(self, 0);
+        }
+        Pthread_mutex_unlock(&self->mtx);
+        
+        unit = entry.unit;
+        __thermal_unit_control_step(unit);
+        end = ThermalExecutor_now();
+        
+        /*
+         * The next release is the first one after the step has finished, the ones before are missed.
+         * A step at a PWM edge, between two releases, misses none.
+         */
+        k = (end < entry.tick) ? 0 : (uint64_t) ((end - entry.tick) / unit->period) + 1;
+        jitter = start - entry.release;
+        Pthread_mutex_lock(&unit->mtx);
+        unit->timing.n_step++;
+        unit->timing.n_missed += (k > 0) ? k - 1 : 0;
+        unit->timing.last_jitter = jitter;
+        unit->timing.sum_jitter += jitter;
+        if (jitter > unit->timing.max_jitter) {
+            unit->timing.max_jitter = jitter;
+        }
+        if (end - start > unit->timing.max_duration) {
+            unit->timing.max_duration = end - start;
+        }
+        Pthread_mutex_unlock(&unit->mtx);
+        
+        entry.tick += k * unit->period;
+        entry.release = fmin(entry.tick, __ThermalUnit_next_switch(unit, end));
+        Pthread_mutex_lock(&self->mtx);
+        self->heap[self->n_entry++] = entry;
+        ThermalExecutor_sift_up(self, self->n_entry - 1);
+    }
+    Pthread_mutex_unlock(&self->mtx);
+    
+    return NULL;
+}
+
+/*
+ * The first step of a unit is released at once.
+ */
+int
+thermal_executor_add(void *_self, void *unit)
+{
+    struct ThermalExecutor *self = cast(ThermalExecutor(), _self);
+    struct __ThermalUnit *u = cast(__ThermalUnit(), unit);
+    
+    if (!(u->period > 0.)) {
+        return AAOS_EINVAL;
+    }
+    
+    Pthread_mutex_lock(&self->mtx);
+    if (self->n_entry == self->capacity) {
+        self->capacity = self->capacity == 0 ? 8 : 2 * self->capacity;
+        self->heap = (struct ThermalExecutorEntry *) Realloc(self->heap, sizeof(struct ThermalExecutorEntry) * self->capacity);
+    }
+    self->heap[self->n_entry].unit = u;
+    self->heap[self->n_entry].release = self->heap[self->n_entry].tick = ThermalExecutor_now();
+    self->n_entry++;
+    ThermalExecutor_sift_up(self, self->n_entry - 1);
+    Pthread_mutex_unlock(&self->mtx);
+    
+    ThermalExecutor_wake(self);
+    
+    return AAOS_OK;
+}
+
+int
+thermal_executor_start(void *_self)
+{
+    struct ThermalExecutor *self = cast(ThermalExecutor(), _self);
+    
+    if (self->running) {
+        return AAOS_EALREADY;
+    }
+    self->stop = false;
+    if (Pthread_create(&self->tid, NULL, ThermalExecutor_thr, self) != 0) {
+        return AAOS_ERROR;
+    }
+    self->running = true;
+    
+    return AAOS_OK;
+}
+
+void
+thermal_executor_stop(void *_self)
+{
+    struct ThermalExecutor *self = cast(ThermalExecutor(), _self);
+    
+    if (!self->running) {
+        return;
+    }
+    Pthread_mutex_lock(&self->mtx);
+    self->stop = true;
+    Pthread_mutex_unlock(&self->mtx);
+    ThermalExecutor_wake(self);
+    Pthread_join(self->tid, NULL);
+    self->running = false;
+}
+
+/*
+ * executor = new(ThermalExecutor())
+ */
+static void *
+ThermalExecutor_ctor(void *_self, va_list *app)
+{
+    struct ThermalExecutor *self = super_ctor(ThermalExecutor(), _self, app);
+    
+    Pthread_mutex_init(&self->mtx, NULL);
+    self->wake[0] = self->wake[1] = -1;
+    if (pipe(self->wake) == 0) {
+        fcntl(self->wake[0], F_SETFL, fcntl(self->wake[0], F_GETFL) | O_NONBLOCK);
+        fcntl(self->wake[1], F_SETFL, fcntl(self->wake[1], F_GETFL) | O_NONBLOCK);
+        fcntl(self->wake[0], F_SETFD, FD_CLOEXEC);
+        fcntl(self->wake[1], F_SETFD, FD_CLOEXEC);
+    }
+#ifdef LINUX
+    self->timerfd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+#else
+    self->timerfd = -1;
+#endif
+    
+    return (void *) self;
+}
+
+static void *
+ThermalExecutor_dtor(void *_self)
+{
+    struct ThermalExecutor *self = cast(ThermalExecutor(), _self);
+    
+    thermal_executor_stop(self);
+    if (self->wake[0] >= 0) {
+        Close(self->wake[0]);
+        Close(self->wake[1]);
+    }
+    if (self->timerfd >= 0) {
+        Close(self->timerfd);
+    }
+    free(self->heap);
+    Pthread_mutex_destroy(&self->mtx);
+    
+    return super_dtor(ThermalExecutor(), _self);
+}
+
+static const void *_ThermalExecutor;
+
+static void
+ThermalExecutor_destroy(void)
+{
+    free((void *) _ThermalExecutor);
+}
+
+static void
+ThermalExecutor_initialize(void)
+{
+    _ThermalExecutor = new(Class(), "ThermalExecutor", Object(), sizeof(struct ThermalExecutor),
+                           ctor, "ctor", ThermalExecutor_ctor,
+                           dtor, "dtor", ThermalExecutor_dtor,
+                           (void *) 0);
+#ifndef _USE_COMPILER_ATTRIBUTION_
+    atexit(ThermalExecutor_destroy);
+#endif
+}
+
+const void *
+ThermalExecutor(void)
+{
+#ifndef _USE_COMPILER_ATTRIBUTION_
+    static pthread_once_t once_control = PTHREAD_ONCE_INIT;
+    Pthread_once(&once_control, ThermalExecutor_initialize);
+#endif
+    
+    return _ThermalExecutor;
+}
@@ -9,8 +9,23 @@
 #ifndef thermal_h
 #define thermal_h
 
+#include <stdint.h>
 #include <string.h>
 
+/*
+ * Timing of the control steps of a unit, see ThermalExecutor.
+ * Jitter is how late a step starts after its release; a release is missed
+ * when the previous step is still running, or the executor is late, past it.
+ */
+struct ThermalUnitTiming {
+    uint64_t n_step;
+    uint64_t n_missed;
+    double last_jitter;
+    double max_jitter;
+    double sum_jitter;
+    double max_duration;
+};
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -20,7 +35,13 @@ int __thermal_unit_turn_off(void *_self);
 int __thermal_unit_get_temperature(const void *_self, double *temperature);
 int __thermal_unit_status(void *_self, void *buffer, size_t size, size_t *res_len);
 void *__thermal_unit_thermal_control(void *_self);
+int __thermal_unit_control_step(void *_self);
+int __thermal_unit_regulate(void *_self, double temperature);
 const char *__thermal_unit_get_name(const void *_self);
+void __thermal_unit_get_timing(const void *_self, struct ThermalUnitTiming *timing);
+
+struct ThermalController;
+void __thermal_unit_get_controller(const void *_self, struct ThermalController *controller);
 
 extern const void *__ThermalUnit(void);
 extern const void *__ThermalUnitClass(void);
@@ -35,6 +56,42 @@ extern const void *SimpleThermalUnitClass(void);
 extern const void *KLCAMSimpleThermalUnit(void);
 extern const void *KLCAMSimpleThermalUnitClass(void);
 
+/*
+ * Channels, where a unit reads a temperature or switches heaters, in place of shell commands.
+ *
+ *     file:PATH[*SCALE]            read the first number in PATH, e.g. a hwmon temp*_input,
+ *                                  multiplied by SCALE; the file is kept open and re-read.
+ *     file:PATH=VALUE              write VALUE into PATH, e.g. a GPIO value.
+ *     pdu:ADDRESS:PORT:PDU:SWITCH  turn on or off a switch through a PDU server;
+ *                                  PDU and SWITCH are names or numbers.
+ *     helper:REQUEST               send REQUEST as one line to the helper co-process of the unit,
+ *                                  and read one line back, a number, or `OK` for a switch.
+ *
+ * Anything else is run as a shell command, as before, once per call.
+ * The helper of a unit is started once, by `/bin/sh -c`, and restarted when it exits or times out.
+ */
+int thermal_channel_read(void *_self, double *value);
+int thermal_channel_write(void *_self, unsigned int state);
+
+int thermal_helper_request(void *_self, const char *request, char *reply, size_t size);
+
+extern const void *ThermalChannel(void);
+extern const void *ThermalHelper(void);
+
+/*
+ * Control executor.
+ * A single thread runs the control step of every unit added, once per period of the unit,
+ * and at the PWM edges of its heater in between, earliest release first. It sleeps on an absolute timerfd on Linux, and in poll elsewhere.
+ * Releases passed while a step is late are skipped and counted, never run in a burst.
+ * Units may be added while the executor is running; thermal_executor_stop returns
+ * after the step in progress, if any, has finished.
+ */
+int thermal_executor_add(void *_self, void *unit);
+int thermal_executor_start(void *_self);
+void thermal_executor_stop(void *_self);
+
+extern const void *ThermalExecutor(void);
+
 #ifdef __cplusplus
 }
 #endif
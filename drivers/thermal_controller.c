@@ -0,0 +1,514 @@
+//
+//  thermal_controller.c
+//  AAOS
+//
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "def.h"
+#include "thermal_controller.h"
+#include "wrapper.h"
+
+#define THERMAL_AUTOTUNE_MIN_SAMPLE     8
+#define THERMAL_AUTOTUNE_GRID           48
+#define THERMAL_AUTOTUNE_GOLDEN         40
+#define THERMAL_PID_FILTER_RATIO        10.
+
+void
+thermal_controller_init(struct ThermalController *controller, int type, double lowest, double highest)
+{
+    memset(controller, '\0', sizeof(struct ThermalController));
+    controller->type = type;
+    controller->lowest = lowest;
+    controller->highest = highest;
+    controller->setpoint = (lowest + highest) / 2.;
+}
+
+void
+thermal_controller_destroy(struct ThermalController *controller)
+{
+    free(controller->autotune.temperature);
+    controller->autotune.temperature = NULL;
+    controller->autotune.n = controller->autotune.capacity = 0;
+}
+
+void
+thermal_controller_set_pid(struct ThermalController *controller, double setpoint, double kp, double ki, double kd)
+{
+    struct ThermalPID *pid = &controller->pid;
+    
+    controller->type = THERMAL_CONTROLLER_PID;
+    controller->setpoint = setpoint;
+    pid->kp = kp;
+    pid->ki = ki;
+    pid->kd = kd;
+    pid->tf = (kp > 0.) ? kd / kp / THERMAL_PID_FILTER_RATIO : 0.;
+    pid->integral = 0.;
+    pid->derivative = 0.;
+    pid->initialized = false;
+}
+
+static double
+thermal_clamp(double x, double low, double high)
+{
+    return (x < low) ? low : ((x > high) ? high : x);
+}
+
+static double
+ThermalPID_update(struct ThermalPID *pid, double setpoint, double temperature, double now)
+{
+    double e = setpoint - temperature, dt = 0., p, i, v;
+    
+    if (pid->initialized) {
+        dt = now - pid->last_time;
+    } else {
+        pid->derivative = 0.;
+        pid->initialized = true;
+    }
+    
+    p = pid->kp * e;
+    if (dt > 0.) {
+        double d = -pid->kd * (temperature - pid->last_input) / dt;
+        pid->derivative += dt / (pid->tf + dt) * (d - pid->derivative);
+    
+        /*
+         * Conditional integration, the integral is frozen while the output is saturated
+         * and the error would drive it further.
+         */
+        i = pid->integral + pid->ki * e * dt;
+        v = p + i + pid->derivative;
+        if (!((v > 1. && e > 0.) || (v < 0. && e < 0.))) {
+            pid->integral = thermal_clamp(i, 0., 1.);
+        }
+    }
+    pid->last_input = temperature;
+    pid->last_time = now;
+    
+    return thermal_clamp(p + pid->integral + pid->derivative, 0., 1.);
+}
+
+static double ThermalController_regulate(struct ThermalController *controller, double temperature, bool valid, double now);
+
+static void
+ThermalController_autotune_finish(struct ThermalController *controller)
+{
+    struct ThermalAutotune *autotune = &controller->autotune;
+    double dt, kp, ki, kd;
+    
+    autotune->state = THERMAL_AUTOTUNE_FAILED;
+    if (autotune->n > 1) {
+        dt = (autotune->last - autotune->start) / (autotune->n - 1);
+        if (thermal_step_response_fit(autotune->temperature, autotune->n, autotune->k_step, dt, autotune->u1 - autotune->u0, &autotune->model) == AAOS_OK &&
+            thermal_pid_tune(&autotune->model, dt + controller->pwm.window, 0., &kp, &ki, &kd) == AAOS_OK) {
+            thermal_controller_set_pid(controller, controller->setpoint, kp, ki, kd);
+            autotune->state = THERMAL_AUTOTUNE_DONE;
+        }
+    }
+    free(autotune->temperature);
+    autotune->temperature = NULL;
+    autotune->n = autotune->capacity = 0;
+}
+
+static double
+ThermalController_autotune_update(struct ThermalController *controller, double temperature, bool valid, double now)
+{
+    struct ThermalAutotune *autotune = &controller->autotune;
+    
+    /*
+     * Without a reading, the step is not safe to continue.
+     */
+    if (!valid) {
+        free(autotune->temperature);
+        autotune->temperature = NULL;
+        autotune->n = autotune->capacity = 0;
+        autotune->state = THERMAL_AUTOTUNE_FAILED;
+        return ThermalController_regulate(controller, temperature, valid, now);
+    }
+    
+    if (autotune->n == autotune->capacity) {
+        autotune->capacity = (autotune->capacity == 0) ? 256 : autotune->capacity * 2;
+        autotune->temperature = (double *) Realloc(autotune->temperature, sizeof(double) * autotune->capacity);
+    }
+    if (autotune->n == 0) {
+        autotune->start = now;
+    }
+    autotune->temperature[autotune->n++] = temperature;
+    autotune->last = now;
+    
+    if (autotune->state == THERMAL_AUTOTUNE_BASELINE) {
+        if (now - autotune->start < autotune->baseline || autotune->n < THERMAL_AUTOTUNE_MIN_SAMPLE / 2) {
+            return autotune->u0;
+        }
+        /*
+         * The duty returned with a sample holds until the next sample.
+         */
+        autotune->state = THERMAL_AUTOTUNE_STEP;
+        autotune->k_step = autotune->n - 1;
+        autotune->step_start = now;
+        return autotune->u1;
+    }
+    
+    if (temperature >= autotune->limit || now - autotune->step_start >= autotune->duration) {
+        ThermalController_autotune_finish(controller);
+        return ThermalController_regulate(controller, temperature, valid, now);
+    }
+    
+    return autotune->u1;
+}
+
+static double
+ThermalController_regulate(struct ThermalController *controller, double temperature, bool valid, double now)
+{
+    if (!valid) {
+        /*
+         * Heaters are off without a reading, and the derivative restarts.
+         */
+        controller->pid.initialized = false;
+        return 0.;
+    }
+    
+    switch (controller->type) {
+        case THERMAL_CONTROLLER_PID:
+            return ThermalPID_update(&controller->pid, controller->setpoint, temperature, now);
+        case THERMAL_CONTROLLER_HYSTERESIS:
+        default:
+            if (temperature < controller->lowest) {
+                return 1.;
+            } else if (temperature > controller->highest) {
+                return 0.;
+            }
+            return controller->output;
+    }
+}
+
+double
+thermal_controller_update(struct ThermalController *controller, double temperature, double now)
+{
+    bool valid = (temperature != THERMAL_TEMPERATURE_INVALID && isfinite(temperature));
+    
+    if (controller->autotune.state == THERMAL_AUTOTUNE_BASELINE || controller->autotune.state == THERMAL_AUTOTUNE_STEP) {
+        controller->output = ThermalController_autotune_update(controller, temperature, valid, now);
+    } else {
+        controller->output = ThermalController_regulate(controller, temperature, valid, now);
+    }
+    
+    return controller->output;
+}
+
+int
+thermal_controller_autotune(struct ThermalController *controller, double u0, double u1, double baseline, double duration, double limit)
+{
+    struct ThermalAutotune *autotune = &controller->autotune;
+    
+    if (autotune->state == THERMAL_AUTOTUNE_BASELINE || autotune->state == THERMAL_AUTOTUNE_STEP) {
+        return AAOS_EALREADY;
+    }
+    if (u0 < 0. || u1 > 1. || !(u1 > u0) || baseline < 0. || !(duration > 0.)) {
+        return AAOS_EINVAL;
+    }
+    
+    autotune->u0 = u0;
+    autotune->u1 = u1;
+    autotune->baseline = baseline;
+    autotune->duration = duration;
+    autotune->limit = limit;
+    autotune->n = 0;
+    autotune->k_step = 0;
+    autotune->state = THERMAL_AUTOTUNE_BASELINE;
+    
+    return AAOS_OK;
+}
+
+/*
+ * While autotune runs, the step goes to the heater at once, not at the next window.
+ */
+bool
+thermal_controller_switch(struct ThermalController *controller, double now)
+{
+    if (controller->autotune.state == THERMAL_AUTOTUNE_BASELINE || controller->autotune.state == THERMAL_AUTOTUNE_STEP) {
+        controller->pwm.started = false;
+        return controller->output >= 0.5;
+    }
+    
+    return thermal_pwm_update(&controller->pwm, controller->output, now);
+}
+
+/*
+ * Within a window, the heater only switches at the end of the on time and at the end of the window.
+ */
+double
+thermal_controller_next_switch(const struct ThermalController *controller, double now)
+{
+    const struct ThermalPWM *pwm = &controller->pwm;
+    
+    if (!(pwm->window > 0.) || !pwm->started || controller->autotune.state == THERMAL_AUTOTUNE_BASELINE || controller->autotune.state == THERMAL_AUTOTUNE_STEP) {
+        return HUGE_VAL;
+    }
+    if (pwm->on_time > 0. && pwm->on_time < pwm->window && now < pwm->start + pwm->on_time) {
+        return pwm->start + pwm->on_time;
+    }
+    
+    return pwm->start + pwm->window;
+}
+
+bool
+thermal_pwm_update(struct ThermalPWM *pwm, double duty, double now)
+{
+    if (!(pwm->window > 0.)) {
+        return duty >= 0.5;
+    }
+    
+    if (!pwm->started || now - pwm->start >= pwm->window) {
+        /*
+         * Windows stay on their grid, unless the caller fell a whole window behind.
+         */
+        if (pwm->started && now - pwm->start < 2. * pwm->window) {
+            pwm->start += pwm->window;
+        } else {
+            pwm->start = now;
+        }
+        pwm->started = true;
+        pwm->on_time = thermal_clamp(duty, 0., 1.) * pwm->window;
+        if (pwm->on_time < pwm->min_on) {
+            pwm->on_time = 0.;
+        } else if (pwm->window - pwm->on_time < pwm->min_on) {
+            pwm->on_time = pwm->window;
+        }
+    }
+    
+    return now - pwm->start < pwm->on_time;
+}
+
+/*
+ * Solve 3 linear equations, augmented matrix m, by Gauss-Jordan elimination with partial pivoting.
+ */
+static int
+thermal_solve3(double m[3][4], double x[3])
+{
+    size_t i, j, k, p;
+    double r;
+    
+    for (i = 0; i < 3; i++) {
+        p = i;
+        for (j = i + 1; j < 3; j++) {
+            if (fabs(m[j][i]) > fabs(m[p][i])) {
+                p = j;
+            }
+        }
+        if (!(fabs(m[p][i]) > 1e-12)) {
+            return AAOS_EINVAL;
+        }
+        if (p != i) {
+            for (k = 0; k < 4; k++) {
+                r = m[i][k];
+                m[i][k] = m[p][k];
+                m[p][k] = r;
+            }
+        }
+        for (j = 0; j < 3; j++) {
+            if (j != i) {
+                r = m[j][i] / m[i][i];
+                for (k = i; k < 4; k++) {
+                    m[j][k] -= r * m[i][k];
+                }
+            }
+        }
+    }
+    for (i = 0; i < 3; i++) {
+        x[i] = m[i][3] / m[i][i];
+    }
+    
+    return AAOS_OK;
+}
+
+/*
+ * For a time constant and a dead time of d samples, the response sampled with a zero order hold is
+ *     y[k] = c0 + c1 * a^k + g * (1 - a^(k - k_step - d)) for k > k_step + d, a = exp(-dt / tau),
+ * linear in c0, the level the baseline drifts to, c1, the drift, and g, the step gain.
+ * Returns the residual sum of squares, and x = (c0, c1, g).
+ */
+static double
+thermal_step_response_residual(const double *temperature, size_t n, size_t k_step, size_t d, double dt, double tau, double x[3])
+{
+    double m[3][4], v[3], a = exp(-dt / tau), ak = 1., as, r = 0., z;
+    size_t i, j, k;
+    
+    memset(m, '\0', sizeof(m));
+    for (k = 0, as = 1.; k < n; k++, ak *= a) {
+        v[0] = 1.;
+        v[1] = ak;
+        if (k > k_step + d) {
+            as *= a;
+            v[2] = 1. - as;
+        } else {
+            v[2] = 0.;
+        }
+        for (i = 0; i < 3; i++) {
+            for (j = 0; j < 3; j++) {
+                m[i][j] += v[i] * v[j];
+            }
+            m[i][3] += v[i] * temperature[k];
+        }
+    }
+    if (thermal_solve3(m, x) != AAOS_OK) {
+        return HUGE_VAL;
+    }
+    for (k = 0, ak = 1., as = 1.; k < n; k++, ak *= a) {
+        z = temperature[k] - x[0] - x[1] * ak;
+        if (k > k_step + d) {
+            as *= a;
+            z -= x[2] * (1. - as);
+        }
+        r += z * z;
+    }
+    
+    return r;
+}
+
+/*
+ * Output error fit of a first order plus dead time model to a step response, sampled every dt seconds,
+ * where the duty changed by du at sample k_step. For every dead time, the time constant is searched
+ * on a logarithmic grid, refined by golden section; the other parameters are linear.
+ * Unlike a fit of one step predictions, the noise of the sensor does not bias the time constant,
+ * a baseline still drifting is allowed for, and the step does not need to settle.
+ */
+int
+thermal_step_response_fit(const double *temperature, size_t n, size_t k_step, double dt, double du, struct ThermalStepModel *model)
+{
+    const double golden = 0.6180339887498949;
+    double x[3], r, best = HUGE_VAL, best_tau = 0., best_gain = 0., best_level = 0.;
+    double lo, hi, u, v, ru, rv, log_min, log_max, log_tau;
+    size_t i, d, best_d = 0;
+    
+    if (n < THERMAL_AUTOTUNE_MIN_SAMPLE || k_step + THERMAL_AUTOTUNE_MIN_SAMPLE / 2 > n || !(dt > 0.) || du == 0.) {
+        return AAOS_EINVAL;
+    }
+    
+    log_min = log(dt / 4.);
+    log_max = log(100. * n * dt);
+    for (d = 0; k_step + d + THERMAL_AUTOTUNE_MIN_SAMPLE / 2 < n; d++) {
+        double grid_r = HUGE_VAL, grid_log = log_min;
+        for (i = 0; i <= THERMAL_AUTOTUNE_GRID; i++) {
+            log_tau = log_min + (log_max - log_min) * i / THERMAL_AUTOTUNE_GRID;
+            r = thermal_step_response_residual(temperature, n, k_step, d, dt, exp(log_tau), x);
+            if (r < grid_r) {
+                grid_r = r;
+                grid_log = log_tau;
+            }
+        }
+        lo = grid_log - (log_max - log_min) / THERMAL_AUTOTUNE_GRID;
+        hi = grid_log + (log_max - log_min) / THERMAL_AUTOTUNE_GRID;
+        u = hi - golden * (hi - lo);
+        v = lo + golden * (hi - lo);
+        ru = thermal_step_response_residual(temperature, n, k_step, d, dt, exp(u), x);
+        rv = thermal_step_response_residual(temperature, n, k_step, d, dt, exp(v), x);
+        for (i = 0; i < THERMAL_AUTOTUNE_GOLDEN; i++) {
+            if (ru < rv) {
+                hi = v;
+                v = u;
+                rv = ru;
+                u = hi - golden * (hi - lo);
+                ru = thermal_step_response_residual(temperature, n, k_step, d, dt, exp(u), x);
+            } else {
+                lo = u;
+                u = v;
+                ru = rv;
+                v = lo + golden * (hi - lo);
+                rv = thermal_step_response_residual(temperature, n, k_step, d, dt, exp(v), x);
+            }
+        }
+        log_tau = (ru < rv) ? u : v;
+        r = thermal_step_response_residual(temperature, n, k_step, d, dt, exp(log_tau), x);
+        if (r < best && x[2] / du > 0.) {
+            best = r;
+            best_tau = exp(log_tau);
+            best_gain = x[2];
+            best_level = x[0] + x[1] * exp(-k_step * dt / best_tau);
+            best_d = d;
+        }
+    }
+    if (best == HUGE_VAL) {
+        return AAOS_EFAILED;
+    }
+    
+    model->gain = best_gain / du;
+    model->tau = best_tau;
+    model->dead_time = best_d * dt;
+    model->baseline = best_level;
+    model->residual = sqrt(best / n);
+    
+    return AAOS_OK;
+}
+
+/*
+ * SIMC rules for a first order plus dead time model, PI only.
+ * hold is how long an output is held, the sample interval, plus the PWM window if any;
+ * half of it adds to the dead time.
+ * tau_c is the closed loop time constant, the effective dead time when it is not positive.
+ */
+int
+thermal_pid_tune(const struct ThermalStepModel *model, double hold, double tau_c, double *kp, double *ki, double *kd)
+{
+    double theta = model->dead_time + hold / 2., kc, ti;
+    
+    if (!(model->gain > 0.) || !(model->tau > 0.) || !(theta > 0.)) {
+        return AAOS_EINVAL;
+    }
+    if (!(tau_c > 0.)) {
+        tau_c = theta;
+    }
+    
+    kc = model->tau / (model->gain * (tau_c + theta));
+    ti = fmin(model->tau, 4. * (tau_c + theta));
+    *kp = kc;
+    *ki = kc / ti;
+    *kd = 0.;
+    
+    return AAOS_OK;
+}
+
+int
+thermal_plant_init(struct ThermalPlant *plant, double ambient, double gain, double tau, double dead_time, double dt)
+{
+    if (!(tau > 0.) || !(dt > 0.) || dead_time < 0.) {
+        return AAOS_EINVAL;
+    }
+    
+    memset(plant, '\0', sizeof(struct ThermalPlant));
+    plant->temperature = ambient;
+    plant->ambient = ambient;
+    plant->gain = gain;
+    plant->tau = tau;
+    plant->dt = dt;
+    plant->n_delay = (size_t) floor(dead_time / dt + 0.5);
+    if (plant->n_delay > 0) {
+        plant->delay = (double *) Malloc(sizeof(double) * plant->n_delay);
+        memset(plant->delay, '\0', sizeof(double) * plant->n_delay);
+    }
+    
+    return AAOS_OK;
+}
+
+void
+thermal_plant_destroy(struct ThermalPlant *plant)
+{
+    free(plant->delay);
+    memset(plant, '\0', sizeof(struct ThermalPlant));
+}
+
+double
+thermal_plant_step(struct ThermalPlant *plant, double duty)
+{
+    double u = duty;
+    
+    if (plant->n_delay > 0) {
+        u = plant->delay[plant->head];
+        plant->delay[plant->head] = duty;
+        plant->head = (plant->head + 1) % plant->n_delay;
+    }
+    plant->temperature += (plant->ambient + plant->gain * u - plant->temperature) * (1. - exp(-plant->dt / plant->tau));
+    
+    return plant->temperature;
+}
@@ -0,0 +1,143 @@
+//
+//  thermal_controller.h
+//  AAOS
+//
+
+#ifndef thermal_controller_h
+#define thermal_controller_h
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Controllers of thermal units.
+ *
+ * A controller turns a temperature into a heater duty between 0 and 1.
+ * The hysteresis controller is the on/off control around [lowest, highest] used so far.
+ * The PID controller works on the measurement for the derivative, which is low-pass filtered,
+ * and stops integrating while the output is saturated in the direction of the error (anti-windup).
+ *
+ * The duty is applied to an on/off switch either directly, on when the duty is at least 0.5,
+ * or by PWM: the duty is latched at the beginning of every window, and the heater is on for
+ * that fraction of the window. On or off times shorter than min_on are not switched at all.
+ * Against a narrow on/off band, which chatters on the sensor noise, PID by PWM saves switches
+ * of the relay, it does not regulate tighter: the ripple of a window costs about what the band does.
+ *
+ * thermal_controller_switch tells whether the heater is on, from the last duty and the PWM of the controller.
+ * thermal_controller_next_switch tells when that may change without a new sample, HUGE_VAL without PWM;
+ * a caller sampling only once per period would round the duty to a multiple of period / window.
+ *
+ * Autotune applies a step of the duty, after a baseline, records the response, and fits
+ * a first order plus dead time model, from which PI gains are chosen by the SIMC rules.
+ * The step stops early when the temperature reaches the limit.
+ */
+
+#define THERMAL_CONTROLLER_HYSTERESIS   1
+#define THERMAL_CONTROLLER_PID          2
+
+#define THERMAL_AUTOTUNE_IDLE       0
+#define THERMAL_AUTOTUNE_BASELINE   1
+#define THERMAL_AUTOTUNE_STEP       2
+#define THERMAL_AUTOTUNE_DONE       3
+#define THERMAL_AUTOTUNE_FAILED     4
+
+#define THERMAL_TEMPERATURE_INVALID 9999.
+
+struct ThermalPID {
+    double kp;
+    double ki;              /* per second */
+    double kd;              /* in seconds */
+    double tf;              /* derivative filter, in seconds */
+    double integral;
+    double derivative;
+    double last_input;
+    double last_time;
+    bool initialized;
+};
+
+struct ThermalStepModel {
+    double gain;            /* steady temperature change per unit duty */
+    double tau;             /* time constant, in seconds */
+    double dead_time;       /* in seconds */
+    double baseline;
+    double residual;        /* RMS of one step prediction error */
+};
+
+struct ThermalAutotune {
+    int state;
+    double u0;
+    double u1;
+    double baseline;        /* duration of the baseline, in seconds */
+    double duration;        /* longest step, in seconds */
+    double limit;           /* temperature where the step stops */
+    double start;           /* time of the first sample */
+    double last;            /* time of the last sample */
+    double step_start;
+    size_t k_step;          /* first sample of the step */
+    double *temperature;
+    size_t n;
+    size_t capacity;
+    struct ThermalStepModel model;
+};
+
+struct ThermalPWM {
+    double window;          /* 0, no PWM */
+    double min_on;
+    double start;
+    double on_time;
+    bool started;
+};
+
+struct ThermalController {
+    int type;
+    double setpoint;
+    double lowest;
+    double highest;
+    double output;
+    struct ThermalPID pid;
+    struct ThermalAutotune autotune;
+    struct ThermalPWM pwm;
+    uint64_t n_switch;
+};
+
+/*
+ * First order plus dead time plant, integrated exactly between samples, for tests and simulations.
+ */
+struct ThermalPlant {
+    double temperature;
+    double ambient;
+    double gain;
+    double tau;
+    double dt;
+    double *delay;
+    size_t n_delay;
+    size_t head;
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void thermal_controller_init(struct ThermalController *controller, int type, double lowest, double highest);
+void thermal_controller_destroy(struct ThermalController *controller);
+void thermal_controller_set_pid(struct ThermalController *controller, double setpoint, double kp, double ki, double kd);
+double thermal_controller_update(struct ThermalController *controller, double temperature, double now);
+int thermal_controller_autotune(struct ThermalController *controller, double u0, double u1, double baseline, double duration, double limit);
+
+bool thermal_controller_switch(struct ThermalController *controller, double now);
+double thermal_controller_next_switch(const struct ThermalController *controller, double now);
+bool thermal_pwm_update(struct ThermalPWM *pwm, double duty, double now);
+
+int thermal_step_response_fit(const double *temperature, size_t n, size_t k_step, double dt, double du, struct ThermalStepModel *model);
+int thermal_pid_tune(const struct ThermalStepModel *model, double hold, double tau_c, double *kp, double *ki, double *kd);
+
+int thermal_plant_init(struct ThermalPlant *plant, double ambient, double gain, double tau, double dead_time, double dt);
+void thermal_plant_destroy(struct ThermalPlant *plant);
+double thermal_plant_step(struct ThermalPlant *plant, double duty);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* thermal_controller_h */
@@ -16,4 +16,13 @@
 #define THERMAL_UNIT_STATE_ON   1
 #define THERMAL_UNIT_STATE_OFF  0
 
+#define THERMAL_CHANNEL_TYPE_COMMAND    0
+#define THERMAL_CHANNEL_TYPE_FILE       1
+#define THERMAL_CHANNEL_TYPE_PDU        2
+#define THERMAL_CHANNEL_TYPE_HELPER     3
+
+#define THERMAL_HELPER_TIMEOUT  10.
+
+#define THERMAL_AUTOTUNE_DURATION   14400.
+
 #endif /* thermal_def_h */
@@ -10,9 +10,12 @@
 #define thermal_r_h
 
 #include "object_r.h"
+#include "thermal.h"
+#include "thermal_controller.h"
 #include "virtual_r.h"
 
 #include <pthread.h>
+#include <sys/types.h>
 
 struct __ThermalUnit {
     struct Object _;
@@ -24,6 +27,9 @@ struct __ThermalUnit {
     double period;
     unsigned int state;
     pthread_mutex_t mtx;
+    struct ThermalUnitTiming timing;
+    void *helper;
+    struct ThermalController controller;
 };
 
 struct __ThermalUnitClass {
@@ -32,6 +38,7 @@ struct __ThermalUnitClass {
     struct Method get_name;
     struct Method status;
     struct Method thermal_control;
+    struct Method control_step;
     struct Method turn_on;
     struct Method turn_off;
 };
@@ -41,6 +48,7 @@ struct __ThermalUnitVirtualTable {
     struct Method get_temperature;
     struct Method status;
     struct Method thermal_control;
+    struct Method control_step;
     struct Method turn_on;
     struct Method turn_off;
 };
@@ -71,11 +79,50 @@ struct KLCAMThermalUnitClass {
 };
  */
 
+/*
+ * Persistent helper co-process of a unit, see ThermalChannel.
+ */
+#define THERMAL_HELPER_BUFSIZE  1024
+
+struct ThermalHelper {
+    struct Object _;
+    char *command;
+    pid_t pid;
+    int sockfd;             /* stdin and stdout of the helper */
+    double timeout;
+    char buf[THERMAL_HELPER_BUFSIZE];
+    size_t length;          /* bytes buffered but not yet returned */
+    pthread_mutex_t mtx;
+};
+
+struct ThermalChannel {
+    struct Object _;
+    int type;
+    char *spec;
+    /* file */
+    char *path;
+    int fd;
+    double scale;
+    char *value;
+    /* pdu */
+    char *address;
+    char *port;
+    char *pdu_name;
+    char *switch_name;
+    void *pdu;
+    uint16_t index;
+    uint16_t channel;
+    /* helper */
+    struct ThermalHelper *helper;
+    char *request;
+    pthread_mutex_t mtx;
+};
+
 struct SimpleThermalUnit {
     struct __ThermalUnit _;
-    char *temp_cmd;
-    char *turn_on_cmd;
-    char *turn_off_cmd;
+    void *temp_channel;
+    void *turn_on_channel;
+    void *turn_off_channel;
 };
 
 struct SimpleThermalUnitClass {
@@ -84,21 +131,43 @@ struct SimpleThermalUnitClass {
 
 struct KLCAMSimpleThermalUnit {
     struct __ThermalUnit _;
-    char *temp_cmd;         /* get temperature command, internal */
-    char *turn_on_cmd;      /* turn on heater(s) command, internal */
-    char *turn_off_cmd;     /* turn off command, internal */
-    char *temp_cmd2;        /* turn on command, external */
-    char *turn_on_cmd2;     /* turn off command, external */
-    char *turn_off_cmd2;    /* turn off command, external */
-    char *temp_cmd3;        /* get ambient temperature command */
+    void *temp_channel;     /* temperature, internal */
+    void *turn_on_channel;  /* turn on heater(s), internal */
+    void *turn_off_channel; /* turn off heater(s), internal */
+    void *temp_channel2;    /* temperature, external */
+    void *turn_on_channel2; /* turn on heater(s), external */
+    void *turn_off_channel2;/* turn off heater(s), external */
+    void *temp_channel3;    /* ambient temperature */
     double threshold;       /* thershold for turn on/off external heater(s) */
     unsigned int state;     /* external heater state */
     pthread_mutex_t mtx;
-    
+    bool started;           /* heaters have been switched off before the first step */
 };
 
 struct KLCAMSimpleThermalUnitClass {
     struct __ThermalUnitClass _;
 };
 
+/*
+ * Control executor, the units are kept in a binary heap ordered by their next release.
+ */
+struct ThermalExecutorEntry {
+    struct __ThermalUnit *unit;
+    double release;         /* in seconds of CLOCK_MONOTONIC */
+    double tick;            /* next release of the period, release is sooner at a PWM edge */
+};
+
+struct ThermalExecutor {
+    struct Object _;
+    struct ThermalExecutorEntry *heap;
+    size_t n_entry;
+    size_t capacity;
+    int timerfd;
+    int wake[2];
+    bool running;
+    bool stop;
+    pthread_t tid;
+    pthread_mutex_t mtx;
+};
+
 #endif /* thermal_r_h */
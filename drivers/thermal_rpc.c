@@ -7,6 +7,7 @@
 //
 
 #include "def.h"
+#include "thermal_controller.h"
 #include "thermal_def.h"
 #include "thermal.h"
 #include "thermal_rpc.h"
@@ -181,23 +182,10 @@ ThermalUnit_info(void *_self, FILE *fp)
     
     if ((ret = rpc_call(self)) == AAOS_OK) {
         size_t length;
-        uint16_t status;
-        void *buf;
+        char *buf;
         protobuf_get(self, PACKET_BUF, &buf, &length);
-        
-        size_t i;
-        for (i = 0; i < length/sizeof(uint16_t); i++) {
-            memcpy(&status, (char *) buf + i * sizeof(uint16_t), sizeof(uint16_t));
-            switch (status) {
-                case THERMAL_UNIT_STATE_ON:
-                    fprintf(fp, "%02zd thermal unit: on\n", i + 1);
-                    break;
-                case THERMAL_UNIT_STATE_OFF:
-                    fprintf(fp, "%02zd thermal unit: off\n", i + 1);
-                    break;
-                default:
-                    break;
-            }
+        if (length > 0) {
+            fprintf(fp, "%.*s", (int) length, buf);
         }
     }
     
@@ -315,9 +303,33 @@ ThermalUnit_execute_info(struct ThermalUnit *self)
     }
     
     /*
-    ret = __thermal_unit_power_on(thermal_unit);
-    protobuf_set(self, PACKET_LENGTH, 0);
+     * Timing of the control steps.
      */
+    struct ThermalUnitTiming timing;
+    struct ThermalController controller;
+    size_t payload = protobuf_payload(self);
+    char *buf;
+    int n, m = 0;
+    static const char *autotune_states[] = {"idle", "baseline", "step", "done", "failed"};
+    
+    __thermal_unit_get_timing(unit, &timing);
+    __thermal_unit_get_controller(unit, &controller);
+    protobuf_get(self, PACKET_BUF, &buf, NULL);
+    n = snprintf(buf, payload, "steps: %llu\nmissed: %llu\njitter: last %.6f s, mean %.6f s, max %.6f s\nduration: max %.6f s\n",
+                 (unsigned long long) timing.n_step, (unsigned long long) timing.n_missed, timing.last_jitter,
+                 timing.n_step > 0 ? timing.sum_jitter / timing.n_step : 0., timing.max_jitter, timing.max_duration);
+    /*
+     * Controller.
+     */
+    if (n >= 0 && (size_t) n < payload) {
+        m = snprintf(buf + n, payload - n, "controller: %s, setpoint %.2f, kp %.4g, ki %.4g, kd %.4g\nduty: %.3f, pwm window %.0f s\nswitches: %llu\nautotune: %s\n",
+                     controller.type == THERMAL_CONTROLLER_PID ? "pid" : "hysteresis", controller.setpoint, controller.pid.kp, controller.pid.ki, controller.pid.kd,
+                     controller.output, controller.pwm.window, (unsigned long long) controller.n_switch,
+                     autotune_states[(controller.autotune.state >= 0 && controller.autotune.state <= THERMAL_AUTOTUNE_FAILED) ? controller.autotune.state : 0]);
+        n = (m < 0) ? n : n + m;
+    }
+    length = (n < 0) ? 0 : (uint32_t) ((size_t) n < payload ? n : payload - 1);
+    protobuf_set(self, PACKET_LENGTH, length);
     
     return ret;
 }
@@ -704,10 +716,9 @@ ThermalUnitServer_accept(void *_self, void **client)
 {
     struct RPCServer *self = cast(RPCServer(), _self);
     
-    int lfd, cfd;
+    int cfd;
     
-    lfd = tcp_server_get_lfd(self);
-    cfd = Accept(lfd, NULL, NULL);
+    cfd = rpc_server_accept_fd(self, TCPSERVER_OPTION_TCP);
     if (cfd < 0) {
         *client = NULL;
         return AAOS_ERROR;
@@ -12,6 +12,7 @@
 #include "rpc.h"
 #include "scheduler_def.h"
 #include "scheduler_rpc.h"
+#include "simulator.h"
 #include "telescope_rpc.h"
 #include "thread.h"
 #include "thread_r.h"
@@ -66,6 +67,92 @@ slew_dome_thr(void *arg)
     return NULL;
 }
 
+/*
+ * The dome slave polls the telescope and moves the dome on connections of its own,
+ * since the cycle keeps using the others. The dome only follows a tracking telescope.
+ */
+static int
+__ObservationThread_slave_position(void *_self, double *ra, double *dec, double *alt, double *az)
+{
+    struct __ObservationThread *self = (struct __ObservationThread *) _self;
+    
+    struct TelescopeStatusRecord record;
+    void *telescope;
+    int ret;
+    
+    if ((ret = rpc_pool_get(self->telescope_client, &telescope)) != AAOS_OK) {
+        return ret;
+    }
+    if (self->telescope_name != NULL) {
+        telescope_get_index_by_name(telescope, self->telescope_name);
+    } else {
+        protobuf_set(telescope, PACKET_INDEX, 1);
+    }
+    ret = telescope_cached_status(telescope, TELESCOPE_STATUS_FORMAT_BINARY, &record, sizeof(record), NULL);
+    rpc_pool_put(telescope, ret);
+    if (ret != AAOS_OK) {
+        return ret;
+    }
+    if ((record.state & ~TELESCOPE_STATE_MALFUNCTION) != TELESCOPE_STATE_TRACKING) {
+        return AAOS_EBUSY;
+    }
+    *ra = record.ra;
+    *dec = record.dec;
+    *alt = record.alt;
+    *az = record.az;
+    
+    return AAOS_OK;
+}
+
+static int
+__ObservationThread_slave_slew(void *_self, double ra, double dec)
+{
+    struct __ObservationThread *self = (struct __ObservationThread *) _self;
+    
+    void *dome;
+    int ret;
+    
+    if ((ret = rpc_pool_get(self->dome_client, &dome)) != AAOS_OK) {
+        return ret;
+    }
+    if (self->dome_name != NULL) {
+        dome_get_index_by_name(dome, self->dome_name);
+    } else {
+        protobuf_set(dome, PACKET_INDEX, 1);
+    }
+    ret = dome_slew(dome, ra, dec);
+    rpc_pool_put(dome, ret);
+    
+    return ret;
+}
+
+/*
+ * The geometry of the dome is configured on the dome, read it before slaving.
+ */
+static int
+__ObservationThread_slave_geometry(struct __ObservationThread *self)
+{
+    struct DomeGeometry geometry;
+    void *dome;
+    int ret;
+    
+    if ((ret = rpc_pool_get(self->dome_client, &dome)) != AAOS_OK) {
+        return ret;
+    }
+    if (self->dome_name != NULL) {
+        dome_get_index_by_name(dome, self->dome_name);
+    } else {
+        protobuf_set(dome, PACKET_INDEX, 1);
+    }
+    ret = dome_get_geometry(dome, &geometry);
+    rpc_pool_put(dome, ret);
+    if (ret == AAOS_OK) {
+        self->dome_slave.geometry = geometry;
+    }
+    
+    return ret;
+}
+
 static void *
 telescope_initialize_thr(void *arg)
 {
@@ -78,6 +165,19 @@ telescope_finalize_thr(void *arg)
     return NULL;
 }
 
+/*
+ * A detector server listening on a Unix domain socket is on the same host,
+ * move the connection onto shared memory, so that the status polls during an exposure
+ * do not go through the kernel. Servers without the transport keep the socket.
+ */
+static void
+__ObservationThread_detector_shm(struct __ObservationThread *self)
+{
+    if (self->detector != NULL && self->detector_addr != NULL && Access(self->detector_addr, F_OK) == 0) {
+        rpc_shm(self->detector, OT_DETECTOR_SHM_RING_SIZE);
+    }
+}
+
 static void
 __ObservationThread_check_before_cycle(struct __ObservationThread *self)
 {
@@ -90,6 +190,9 @@ __ObservationThread_check_before_cycle(struct __ObservationThread *self)
     Pthread_rwlock_wrlock(&self->scheduler_rwlock);
     if (self->has_scheduler && self->scheduler_client != NULL && self->scheduler == NULL) {
         rpc_client_connect(self->scheduler_client, &self->scheduler);
+        if (self->scheduler != NULL) {
+            rpc_set_timeout(self->scheduler, OT_SCHEDULER_TIMEOUT);
+        }
     }
     Pthread_rwlock_unlock(&self->scheduler_rwlock);
     
@@ -102,12 +205,13 @@ __ObservationThread_check_before_cycle(struct __ObservationThread *self)
     Pthread_rwlock_wrlock(&self->detector_rwlock);
     if (self->has_detector && self->detector_client != NULL && self->detector == NULL) {
         rpc_client_connect(self->detector_client, &self->detector);
+        __ObservationThread_detector_shm(self);
     }
     Pthread_rwlock_unlock(&self->detector_rwlock);
     
     Pthread_rwlock_wrlock(&self->aws_rwlock);
-    if (self->has_aws && self->aws_client != NULL && self->aws == NULL) {
-        rpc_client_connect(self->aws_client, &self->aws);
+    if (self->has_aws && self->aws_client != NULL && self->aws == NULL && rpc_client_connect(self->aws_client, &self->aws) == AAOS_OK) {
+        rpc_pipeline(self->aws);
     }
     Pthread_rwlock_unlock(&self->aws_rwlock);
     
@@ -118,27 +222,99 @@ __ObservationThread_check_before_cycle(struct __ObservationThread *self)
     Pthread_rwlock_unlock(&self->pipeline_rwlock);
 }
 
+/*
+ * Stop a slew which has outlived its deadline, through a connection of its own,
+ * since the one of the slew is not usable any more.
+ */
 static void
-__ObservationThread_format_aws_data(struct __ObservationThread *self, cJSON *site_json)
+__ObservationThread_cancel_telescope(struct __ObservationThread *self)
+{
+    void *telescope = NULL;
+    uint16_t index;
+    
+    protobuf_get(self->telescope, PACKET_INDEX, &index);
+    if (rpc_client_connect(self->telescope_client, &telescope) == AAOS_OK) {
+        rpc_set_timeout(telescope, OT_CANCEL_TIMEOUT);
+        rpc_cancel(telescope, index, self->telescope_name);
+    }
+    if (telescope != NULL) {
+        delete(telescope);
+    }
+}
+
+static int
+__ObservationThread_aws_channel(struct __ObservationThread *self)
 {
     size_t i;
-    cJSON *value_json;
-    double value;
+    uint16_t index, channel;
     int ret;
     
-    if (self->aws_keyname == NULL || self->aws_keyvalue == NULL) {
+    if (self->aws_name == NULL) {
+        protobuf_set(self->aws, PACKET_INDEX, 1);
+    } else if ((ret = aws_get_index_by_name(self->aws, self->aws_name)) != AAOS_OK) {
+        return ret;
+    }
+    protobuf_get(self->aws, PACKET_INDEX, &index);
+    self->aws_index = index;
+    self->aws_channel = (unsigned int *) Malloc(sizeof(unsigned int) * self->n_aws_keypair);
+    for (i = 0; i < self->n_aws_keypair; i++) {
+        self->aws_channel[i] = 0;
+        protobuf_set(self->aws, PACKET_INDEX, index);
+        if (self->aws_keyname[i] != NULL && self->aws_keyvalue[i] != NULL && aws_get_channel_by_name(self->aws, self->aws_keyvalue[i]) == AAOS_OK) {
+            protobuf_get(self->aws, PACKET_CHANNEL, &channel);
+            self->aws_channel[i] = channel;
+        }
+    }
+    
+    return AAOS_OK;
+}
+
+/*
+ * The channels are looked up on the first exposure, then the values of all of them are read in one round trip.
+ */
+static void
+__ObservationThread_format_aws_data(struct __ObservationThread *self, cJSON *site_json)
+{
+    size_t i, n = 0;
+    cJSON *value_json;
+    unsigned int *channels;
+    size_t *keys;
+    double *values;
+    int *results;
+    
+    if (self->aws_keyname == NULL || self->aws_keyvalue == NULL || self->n_aws_keypair == 0) {
+        return;
+    }
+    if (self->aws_channel == NULL && __ObservationThread_aws_channel(self) != AAOS_OK) {
         return;
     }
 
+    channels = (unsigned int *) Malloc(sizeof(unsigned int) * self->n_aws_keypair);
+    keys = (size_t *) Malloc(sizeof(size_t) * self->n_aws_keypair);
+    values = (double *) Malloc(sizeof(double) * self->n_aws_keypair);
+    results = (int *) Malloc(sizeof(int) * self->n_aws_keypair);
     for (i = 0; i < self->n_aws_keypair; i++) {
-        if (self->aws_keyname[i] != NULL && self->aws_keyvalue != NULL && (ret = aws_get_data_by_name(self->aws, self->aws_name, self->aws_keyvalue[i], &value, 1)) == AAOS_OK) {
-            if ((value_json = cJSON_GetObjectItemCaseSensitive(site_json, self->aws_keyname[i])) == NULL) {
-                cJSON_AddNumberToObject(site_json, self->aws_keyname[i], value);
+        if (self->aws_channel[i] != 0) {
+            channels[n] = self->aws_channel[i];
+            keys[n++] = i;
+        }
+    }
+    if (n != 0 && aws_get_data_by_channels(self->aws, self->aws_index, channels, values, results, n) == AAOS_OK) {
+        for (i = 0; i < n; i++) {
+            if (results[i] != AAOS_OK) {
+                continue;
+            }
+            if ((value_json = cJSON_GetObjectItemCaseSensitive(site_json, self->aws_keyname[keys[i]])) == NULL) {
+                cJSON_AddNumberToObject(site_json, self->aws_keyname[keys[i]], values[i]);
             } else {
-                cJSON_SetNumberValue(value_json, value);
+                cJSON_SetNumberValue(value_json, values[i]);
             }
         }
     }
+    free(channels);
+    free(keys);
+    free(values);
+    free(results);
 }
 
 static void
@@ -196,9 +372,12 @@ __ObservationThread_cycle(void *_self)
     Pthread_rwlock_rdlock(&self->scheduler_rwlock);
     if (self->has_scheduler && self->scheduler != NULL) {
         Pthread_rwlock_rdlock(&self->telescope_rwlock);
+        /*
+         * The scheduler wrappers flip the sign of the network errors of rpc_call, they come back positive.
+         */
         if (self->telescope_identifier != 0) {
             if (((ret = scheduler_get_task_by_telescope_id(self->scheduler, self->telescope_identifier, buf, BUFSIZE, NULL, NULL))) != AAOS_OK) {
-                if (ret == AAOS_EPIPE) {
+                if (ret == AAOS_EPIPE || ret == AAOS_ETIMEDOUT) {
                     delete(self->scheduler);
                     self->scheduler = NULL;
                 }
@@ -208,7 +387,7 @@ __ObservationThread_cycle(void *_self)
             }
         } else {
             if (((ret = scheduler_get_task_by_telescope_name(self->scheduler, self->telescope_name, buf, BUFSIZE, NULL, NULL))) != AAOS_OK) {
-                if (ret == AAOS_EPIPE) {
+                if (ret == AAOS_EPIPE || ret == AAOS_ETIMEDOUT) {
                     delete(self->scheduler);
                     self->scheduler = NULL;
                 }
@@ -252,13 +431,10 @@ __ObservationThread_cycle(void *_self)
             iso_str_to_tp(value_json->valuestring, &tp);
         }
         if (is_daytime | is_badweather) {
-#ifdef MACOSX
-            Clock_nanosleep(CLOCK_REALTIME, 1, &tp, NULL);
-#endif
-
-#ifdef LINUX
-            Clock_nanosleep(CLOCK_REALTIME, TIMER_ABSTIME, &tp, NULL);
-#endif
+            /*
+             * Until the SIU expires, on the clock of the simulation, the wall clock unless it is scaled.
+             */
+            simulator_sleep(tp.tv_sec + tp.tv_nsec / 1000000000. - simulator_time());
             cJSON_Delete(root_json);
             return AAOS_OK;
         }
@@ -368,8 +544,19 @@ __ObservationThread_cycle(void *_self)
                 Pthread_create(&dome_tid, NULL, slew_dome_thr, dome_arg);
             }
             Pthread_rwlock_unlock(&self->dome_rwlock);
-            if (self->telescope != NULL && (ret = telescope_slew(self->telescope, ra, dec)) != AAOS_OK) {
-                if (ret == AAOS_EPIPE) {
+            if (self->telescope != NULL) {
+                rpc_set_timeout(self->telescope, OT_SLEW_TIMEOUT);
+                ret = telescope_slew(self->telescope, ra, dec);
+                rpc_set_timeout(self->telescope, 0.);
+            }
+            /*
+             * telescope_slew returns what rpc_call does, network errors negative.
+             */
+            if (self->telescope != NULL && ret != AAOS_OK) {
+                if (ret == -1 * AAOS_ETIMEDOUT) {
+                    __ObservationThread_cancel_telescope(self);
+                }
+                if (ret == -1 * AAOS_EPIPE || ret == -1 * AAOS_ETIMEDOUT) {
                     delete(self->telescope);
                     self->telescope = NULL;
                 }
@@ -499,6 +686,12 @@ __ObservationThread_cycle(void *_self)
         header = cJSON_Print(root_json);
     }
 
+    Pthread_rwlock_rdlock(&self->dome_rwlock);
+    if (self->has_dome_slave && self->dome_client != NULL && self->telescope_client != NULL && __ObservationThread_slave_geometry(self) == AAOS_OK) {
+        dome_slave_start(&self->dome_slave, self, __ObservationThread_slave_position, self, __ObservationThread_slave_slew, self->dome_slave_period);
+    }
+    Pthread_rwlock_unlock(&self->dome_rwlock);
+
     Pthread_rwlock_rdlock(&self->detector_rwlock);
     if (self->has_detector) {
         if (self->detector != NULL && (ret = detector_get_index_by_name(self->detector, detname)) != AAOS_OK) {
@@ -516,6 +709,7 @@ __ObservationThread_cycle(void *_self)
                 cJSON_Delete(root_json);
             }
             free(header);
+            dome_slave_stop(&self->dome_slave);
             return ret;
         }
         Pthread_mutex_lock(&self->mtx);
@@ -552,6 +746,7 @@ __ObservationThread_cycle(void *_self)
                     cJSON_Delete(root_json);
                 }
                 free(header);
+                dome_slave_stop(&self->dome_slave);
                 return ret;
             }
             Pthread_mutex_unlock(&self->mtx);
@@ -581,6 +776,7 @@ __ObservationThread_cycle(void *_self)
     free(header);
     
 end:
+    dome_slave_stop(&self->dome_slave);
     Pthread_mutex_lock(&self->mtx);
     self->state = OT_STATE_IDLE;
     Pthread_mutex_unlock(&self->mtx);
@@ -639,6 +835,52 @@ __ObservationThread_start(void *_self)
 
 
 
+/*
+ * Stop the slew or the exposure in progress on a connection from the pool, since the cycle
+ * is blocked on its own. self->mtx is not held, the pool may wait for a free connection.
+ */
+static void
+__ObservationThread_stop_telescope(struct __ObservationThread *self)
+{
+    void *telescope;
+    int ret;
+    
+    if (!self->has_telescope || self->telescope_client == NULL || rpc_pool_get(self->telescope_client, &telescope) != AAOS_OK) {
+        return;
+    }
+    if (self->telescope_name != NULL) {
+        telescope_get_index_by_name(telescope, self->telescope_name);
+    } else {
+        protobuf_set(telescope, PACKET_INDEX, 1);
+    }
+    ret = telescope_stop(telescope);
+    rpc_pool_put(telescope, ret);
+}
+
+static void
+__ObservationThread_stop_detector(struct __ObservationThread *self, uint32_t flag)
+{
+    void *detector;
+    int ret = AAOS_OK;
+    
+    if (!self->has_detector || self->detector_client == NULL || rpc_pool_get(self->detector_client, &detector) != AAOS_OK) {
+        return;
+    }
+    if (self->detector_name != NULL) {
+        detector_get_index_by_name(detector, self->detector_name);
+    } else {
+        protobuf_set(detector, PACKET_INDEX, 1);
+    }
+    if (flag == OT_FLAG_L0) {
+        if ((ret = detector_abort(detector)) == AAOS_ENOTSUP) {
+            ret = detector_stop(detector);
+        }
+    } else if (flag == OT_FLAG_L1) {
+        ret = detector_stop(detector);
+    }
+    rpc_pool_put(detector, ret);
+}
+
 int
 __observation_thread_stop(void *_self, uint32_t flag)
 {
@@ -658,28 +900,19 @@ __ObservationThread_stop(void *_self, uint32_t flag)
 {
     struct __ObservationThread *self = cast(__ObservationThread(), _self);
     
-    void *telescope = NULL, *detector = NULL;
-    int ret;
+    unsigned int state;
     
     Pthread_mutex_lock(&self->mtx);
-	if (self->state == OT_STATE_SLEW) {
-		if (self->has_telescope && self->telescope_client != NULL && (ret = rpc_client_connect(self->telescope_client, &telescope)) == AAOS_OK) {
-            telescope_stop(telescope);
-            delete(telescope);
-		}
-	} else if (self->state == OT_STATE_EXPOSE) {
-		if (self->has_detector && self->detector_client != NULL && (ret = rpc_client_connect(self->detector_client, &detector)) == AAOS_OK) {
-            if (flag == OT_FLAG_L0) {
-                detector_abort(self->detector);
-            } else if (flag == OT_FLAG_L1) {
-                detector_stop(self->detector);
-            }
-            delete(detector);
-		}
-	}
+    state = self->state;
     self->state = OT_STATE_STOP;
     self->flag = flag;
-    Pthread_mutex_lock(&self->mtx);
+    Pthread_mutex_unlock(&self->mtx);
+    
+    if (state == OT_STATE_SLEW) {
+        __ObservationThread_stop_telescope(self);
+    } else if (state == OT_STATE_EXPOSE) {
+        __ObservationThread_stop_detector(self, flag);
+    }
 
     return AAOS_OK;
 }
@@ -761,30 +994,19 @@ __ObservationThread_cancel(void *_self, uint32_t flag)
 {
     struct __ObservationThread *self = cast(__ObservationThread(), _self);
     
-    void *telescope = NULL, *detector = NULL;
-    int ret;
+    unsigned int state;
     
     Pthread_mutex_lock(&self->mtx);
-    if (self->state == OT_STATE_SLEW) {
-        if (self->has_telescope && self->telescope_client != NULL && (ret = rpc_client_connect(self->telescope_client, &telescope)) == AAOS_OK) {
-            telescope_stop(telescope);
-            delete(telescope);
-        }
-    } else if (self->state == OT_STATE_EXPOSE) {
-        if (self->has_detector && self->detector_client != NULL && (ret = rpc_client_connect(self->detector_client, &detector)) == AAOS_OK) {
-            if (flag == OT_FLAG_L0) {
-                if ((ret = detector_abort(self->detector)) == AAOS_ENOTSUP) {
-                    detector_stop(self->detector);
-                }
-            } else if (flag == OT_FLAG_L1) {
-                detector_stop(self->detector);
-            }
-            delete(detector);
-        }
-    }
+    state = self->state;
     self->state = OT_STATE_CANCEL;
     self->flag = flag;
     Pthread_mutex_unlock(&self->mtx);
+    
+    if (state == OT_STATE_SLEW) {
+        __ObservationThread_stop_telescope(self);
+    } else if (state == OT_STATE_EXPOSE) {
+        __ObservationThread_stop_detector(self, flag);
+    }
 
     return AAOS_OK;
 }
@@ -794,11 +1016,11 @@ __observation_thread_terminate(void *_self)
 {
     const struct __ObservationThreadClass *class = (const struct __ObservationThreadClass *) classOf(_self);
     
-    if (isOf(class, __ObservationThreadClass()) && class->cancel.method) {
-        return ((int (*)(void *)) class->cancel.method)(_self);
+    if (isOf(class, __ObservationThreadClass()) && class->terminate.method) {
+        return ((int (*)(void *)) class->terminate.method)(_self);
     } else {
         int result;
-        forward(_self, &result, (Method) __observation_thread_terminate, "terminal", _self);
+        forward(_self, &result, (Method) __observation_thread_terminate, "terminate", _self);
         return result;
     }
 }
@@ -812,6 +1034,10 @@ __ObservationThread_terminate(void *_self)
     
     if (Pthread_cancel(self->tid) == 0) {
         Pthread_join(self->tid, NULL);
+        /*
+         * The cycle may have been cancelled in the middle of an exposure, with the dome still slaved.
+         */
+        dome_slave_stop(&self->dome_slave);
         Pthread_mutex_lock(&self->mtx);
         self->state = OT_STATE_TERMINATE;
         Pthread_mutex_unlock(&self->mtx);
@@ -921,6 +1147,9 @@ __ObservationThread_set_member(void *_self, const char *name, va_list *app)
         }
         rpc_client_connect(self->scheduler_client, &self->scheduler);
         rpc_client_connect(self->scheduler_client, &self->scheduler2);
+        if (self->scheduler != NULL) {
+            rpc_set_timeout(self->scheduler, OT_SCHEDULER_TIMEOUT);
+        }
         self->has_scheduler = true;
         Pthread_rwlock_unlock(&self->scheduler_rwlock);
     } else if (strcmp(name, "dome") == 0) {
@@ -967,6 +1196,20 @@ __ObservationThread_set_member(void *_self, const char *name, va_list *app)
         }
         self->has_dome = true;
         Pthread_rwlock_unlock(&self->dome_rwlock);
+    } else if (strcmp(name, "dome_slave") == 0) {
+        double hysteresis, lead, interval, period;
+        hysteresis = va_arg(*app, double);
+        lead = va_arg(*app, double);
+        interval = va_arg(*app, double);
+        period = va_arg(*app, double);
+        Pthread_rwlock_wrlock(&self->dome_rwlock);
+        dome_slave_stop(&self->dome_slave);
+        self->dome_slave.hysteresis = hysteresis;
+        self->dome_slave.lead = lead;
+        self->dome_slave.interval = interval;
+        self->dome_slave_period = period;
+        self->has_dome_slave = true;
+        Pthread_rwlock_unlock(&self->dome_rwlock);
     } else if (strcmp(name, "telescope") == 0) {
         const char *addr, *port, *telescope_name;
         uint64_t telescope_identifier;
@@ -1001,7 +1244,7 @@ __ObservationThread_set_member(void *_self, const char *name, va_list *app)
         if (self->telescope_client != NULL) {
             delete(self->telescope_client);
         }
-        self->telescope_client = new(DomeClient(), self->telescope_addr, self->telescope_port);
+        self->telescope_client = new(TelescopeClient(), self->telescope_addr, self->telescope_port);
         if (self->telescope != NULL) {
             delete(self->telescope);
         }
@@ -1050,6 +1293,7 @@ __ObservationThread_set_member(void *_self, const char *name, va_list *app)
             delete(self->detector);
         }
         if (rpc_client_connect(self->detector_client, &self->detector) == AAOS_OK) {
+            __ObservationThread_detector_shm(self);
             if (self->detector_name != NULL) {
                 detector_get_index_by_name(self->detector, self->detector_name);
             } else {
@@ -1095,6 +1339,7 @@ __ObservationThread_set_member(void *_self, const char *name, va_list *app)
             delete(self->aws);
         }
         if (rpc_client_connect(self->aws_client, &self->aws) == AAOS_OK) {
+            rpc_pipeline(self->aws);
             if (self->aws_name != NULL) {
                 aws_get_index_by_name(self->aws, self->aws_name);
             } else {
@@ -1104,6 +1349,8 @@ __ObservationThread_set_member(void *_self, const char *name, va_list *app)
         self->aws_keyname = va_arg(*app, char **);
         self->aws_keyvalue = va_arg(*app, char **);
         self->n_aws_keypair = va_arg(*app, size_t);   
+        free(self->aws_channel);
+        self->aws_channel = NULL;
         self->has_aws = true;
         Pthread_rwlock_unlock(&self->aws_rwlock);
     } else if (strcmp(name, "pipeline") == 0) {
@@ -1170,6 +1417,7 @@ __ObservationThread_ctor(void *_self, va_list *app)
     struct __ObservationThread *self = super_ctor(__ObservationThread(), _self, app);
 
     const char *s, *key, *value, *value2, *value3;
+    struct DomeGeometry geometry;
 
     s = va_arg(*app, const char *);
     if (s) {
@@ -1337,6 +1585,10 @@ __ObservationThread_ctor(void *_self, va_list *app)
     Pthread_rwlock_init(&self->aws_rwlock, NULL);
     Pthread_rwlock_init(&self->pipeline_rwlock, NULL);
     
+    memset(&geometry, '\0', sizeof(struct DomeGeometry));
+    dome_slave_init(&self->dome_slave, &geometry, DOME_SLAVE_HYSTERESIS, DOME_SLAVE_LEAD, DOME_SLAVE_INTERVAL);
+    self->dome_slave_period = DOME_SLAVE_PERIOD;
+    
     Pthread_cond_init(&self->cond, NULL);
     Pthread_mutex_init(&self->mtx, NULL);
 
@@ -1350,6 +1602,7 @@ __ObservationThread_dtor(void *_self)
     
     size_t i, n = self->n_aws_keypair;
     
+    dome_slave_destroy(&self->dome_slave);
     Pthread_mutex_destroy(&self->mtx);
     Pthread_cond_destroy(&self->cond);
 
@@ -1381,6 +1634,7 @@ __ObservationThread_dtor(void *_self)
         }
         free(self->aws_keyvalue);
     }
+    free(self->aws_channel);
     
     if (self->dome_client) {
         delete(self->dome_client);
@@ -1547,6 +1801,7 @@ __ObservationThread_initialize(void)
                                __observation_thread_cycle, "cycle", __ObservationThread_cycle,
                                __observation_thread_start, "start", __ObservationThread_start,
                                __observation_thread_cancel, "cancel", __ObservationThread_cancel,
+                               __observation_thread_terminate, "terminate", __ObservationThread_terminate,
                                __observation_thread_stop, "stop", __ObservationThread_stop,
                                __observation_thread_suspend, "suspend", __ObservationThread_suspend,
                                __observation_thread_resume, "resume", __ObservationThread_resume,
@@ -17,6 +17,18 @@
 #define OT_STATE_TERMINATE  0x0040
 #define OT_STATE_IDLE       0x8000
 
+/*
+ * Time allowed to the calls to the scheduler, to a slew, and to its cancellation, in seconds.
+ */
+#define OT_SCHEDULER_TIMEOUT    30.
+#define OT_SLEW_TIMEOUT         600.
+#define OT_CANCEL_TIMEOUT       10.
+
+/*
+ * Ring size of the shared-memory connection to a detector server on the same host.
+ */
+#define OT_DETECTOR_SHM_RING_SIZE   65536
+
 
 #define OT_FLAG_L0          0x0001
 #define OT_FLAG_L1          0x0002
@@ -7,6 +7,7 @@
 #ifndef thread_r_h
 #define thread_r_h
 
+#include "dome_slave.h"
 #include "object_r.h"
 #include <stdbool.h>
 #include <stdint.h>
@@ -36,6 +37,9 @@ struct __ObservationThread {
     uint16_t dome_index;
     uint64_t dome_identifier;
     bool has_dome;
+    struct DomeSlave dome_slave;    /* Keeps the slit on the telescope during exposures */
+    double dome_slave_period;
+    bool has_dome_slave;
     
     char *telescope_addr;
     char *telescope_port;
@@ -67,6 +71,8 @@ struct __ObservationThread {
     char **aws_keyname;
     char **aws_keyvalue;
     size_t n_aws_keypair;
+    unsigned int aws_index;
+    unsigned int *aws_channel;      /* channels of aws_keyvalue, 0 if not found, looked up once */
     bool has_aws;
     
     pthread_rwlock_t scheduler_rwlock;
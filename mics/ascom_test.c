@@ -0,0 +1,428 @@
+//
+//  ascom_test.c
+//  AAOS
+//
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifdef __USE_ASCOM__
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <cjson/cJSON.h>
+
+#include "ascom.h"
+#include "def.h"
+#include "object.h"
+#include "telescope.h"
+#include "wrapper.h"
+
+/*
+ * Run ASCOM requests against a tiny Alpaca stub on the loopback interface.
+ * The stub answers every request with the command as the value, and the body of PUT requests
+ * as the error message, and counts the connections it accepts, so that the reuse of
+ * the connections can be checked. The command `slow` is answered after two seconds.
+ * Telescope 1 is a mount, its properties are answered with the values in stub_mount_values.
+ */
+
+#define ASCOM_TEST_PORT     17800
+#define ASCOM_TEST_REQUEST  200
+
+static const char *stub_mount_values[][2] = {
+    {"rightascension", "1.5"}, {"declination", "40.5"}, {"altitude", "60"}, {"azimuth", "180"},
+    {"slewing", "false"}, {"tracking", "true"}, {"atpark", "false"},
+    {"canpark", "true"}, {"canslew", "true"}, {"canslewasync", "true"},
+};
+
+static int listen_fd;
+static pthread_mutex_t mtx = PTHREAD_MUTEX_INITIALIZER;
+static size_t n_connection;
+static size_t n_mount_status;
+
+static void *
+stub_connection_thr(void *arg)
+{
+    int fd = (int) (intptr_t) arg;
+    char buf[8192], response[4 * BUFSIZE], body[BUFSIZE], json[3 * BUFSIZE], method[16], path[BUFSIZE], *s, *command;
+    size_t n = 0, length, content_length, i;
+    ssize_t ret;
+    
+    for (;;) {
+        buf[n] = '\0';
+        while ((s = strstr(buf, "\r\n\r\n")) == NULL) {
+            if (n == sizeof(buf) - 1 || (ret = read(fd, buf + n, sizeof(buf) - 1 - n)) <= 0) {
+                goto end;
+            }
+            n += ret;
+            buf[n] = '\0';
+        }
+        length = s + 4 - buf;
+        content_length = 0;
+        if ((s = strstr(buf, "Content-Length:")) != NULL && s < buf + length) {
+            content_length = strtoul(s + 15, NULL, 10);
+        }
+        while (n < length + content_length) {
+            if ((ret = read(fd, buf + n, sizeof(buf) - 1 - n)) <= 0) {
+                goto end;
+            }
+            n += ret;
+        }
+        snprintf(body, sizeof(body), "%.*s", (int) content_length, buf + length);
+        if (sscanf(buf, "%15s %1023s", method, path) != 2) {
+            goto end;
+        }
+        memmove(buf, buf + length + content_length, n - length - content_length);
+        n -= length + content_length;
+    
+        command = ((s = strrchr(path, '/')) != NULL) ? s + 1 : path;
+        if (strcmp(command, "slow") == 0) {
+            sleep(2);
+        }
+        snprintf(json, sizeof(json), "{\"Value\":\"%s\",\"ErrorNumber\":0,\"ErrorMessage\":\"%s\"}", command, body);
+        if (strstr(path, "/telescope/1/") != NULL) {
+            for (i = 0; i < sizeof(stub_mount_values) / sizeof(stub_mount_values[0]); i++) {
+                if (strcmp(command, stub_mount_values[i][0]) == 0) {
+                    snprintf(json, sizeof(json), "{\"Value\":%s,\"ErrorNumber\":0,\"ErrorMessage\":\"\"}", stub_mount_values[i][1]);
+                    break;
+                }
+            }
+            if (strcmp(command, "rightascension") == 0) {
+                Pthread_mutex_lock(&mtx);
+                n_mount_status++;
+                Pthread_mutex_unlock(&mtx);
+            }
+        }
+        length = snprintf(response, sizeof(response), "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nContent-Length: %zu\r\n\r\n%s", strlen(json), json);
+        if (write(fd, response, length) != (ssize_t) length) {
+            goto end;
+        }
+    }
+    
+end:
+    close(fd);
+    return NULL;
+}
+
+static void *
+stub_thr(void *arg)
+{
+    pthread_t tid;
+    int fd;
+    
+    while ((fd = accept(listen_fd, NULL, NULL)) >= 0) {
+        Pthread_mutex_lock(&mtx);
+        n_connection++;
+        Pthread_mutex_unlock(&mtx);
+        Pthread_create(&tid, NULL, stub_connection_thr, (void *) (intptr_t) fd);
+        pthread_detach(tid);
+    }
+    
+    return NULL;
+}
+
+static size_t
+get_n_mount_status(void)
+{
+    size_t n;
+    
+    Pthread_mutex_lock(&mtx);
+    n = n_mount_status;
+    Pthread_mutex_unlock(&mtx);
+    
+    return n;
+}
+
+static size_t
+get_n_connection(void)
+{
+    size_t n;
+    
+    Pthread_mutex_lock(&mtx);
+    n = n_connection;
+    Pthread_mutex_unlock(&mtx);
+    
+    return n;
+}
+
+static int
+test_reuse(void *ascom, void *ascom2)
+{
+    struct timespec tp0, tp1;
+    char *buf = NULL;
+    size_t size = 0, i, n;
+    int ret;
+    
+    Clock_gettime(CLOCK_MONOTONIC, &tp0);
+    for (i = 0; i < ASCOM_TEST_REQUEST; i++) {
+        if ((ret = ascom_get(ascom, "altitude", &buf, &size)) != AAOS_OK || strstr(buf, "\"Value\":\"altitude\"") == NULL) {
+            fprintf(stderr, "`%s` failed at line %d: %d.\n", __func__, __LINE__, ret);
+            free(buf);
+            return -1;
+        }
+    }
+    Clock_gettime(CLOCK_MONOTONIC, &tp1);
+    n = get_n_connection();
+    printf("get      %d requests, %zu connection(s), %.1f us per request\n", ASCOM_TEST_REQUEST, n,
+           ((tp1.tv_sec - tp0.tv_sec) + (tp1.tv_nsec - tp0.tv_nsec) / 1000000000.) / ASCOM_TEST_REQUEST * 1e6);
+    if (n != 1) {
+        fprintf(stderr, "`%s` failed at line %d.\n", __func__, __LINE__);
+        free(buf);
+        return -1;
+    }
+    
+    if ((ret = ascom_put(ascom, "sitelatitude", "SiteLatitude=40.393", &buf, &size)) != AAOS_OK || strstr(buf, "SiteLatitude=40.393") == NULL) {
+        fprintf(stderr, "`%s` failed at line %d: %d.\n", __func__, __LINE__, ret);
+        free(buf);
+        return -1;
+    }
+    /*
+     * Another device on the same server uses the same connection.
+     */
+    if ((ret = ascom_get(ascom2, "shutterstatus", &buf, &size)) != AAOS_OK || strstr(buf, "shutterstatus") == NULL) {
+        fprintf(stderr, "`%s` failed at line %d: %d.\n", __func__, __LINE__, ret);
+        free(buf);
+        return -1;
+    }
+    printf("put      and another device, %zu connection(s)\n", get_n_connection());
+    free(buf);
+    if (get_n_connection() != 1) {
+        fprintf(stderr, "`%s` failed at line %d.\n", __func__, __LINE__);
+        return -1;
+    }
+    
+    return 0;
+}
+
+static int
+test_multi(void *ascom)
+{
+    const char *commands[] = {"rightascension", "declination", "slewing", "atpark"};
+    char *responses[4] = {NULL, NULL, NULL, NULL};
+    size_t sizes[4], i, n = sizeof(commands) / sizeof(commands[0]);
+    int results[4], ret;
+    
+    if ((ret = ascom_get_multi(ascom, n, commands, responses, sizes, results)) != AAOS_OK) {
+        fprintf(stderr, "`%s` failed at line %d: %d.\n", __func__, __LINE__, ret);
+    }
+    for (i = 0; i < n; i++) {
+        if (results[i] != AAOS_OK || responses[i] == NULL || strstr(responses[i], commands[i]) == NULL) {
+            fprintf(stderr, "`%s` failed at line %d: %s.\n", __func__, __LINE__, commands[i]);
+            ret = AAOS_ERROR;
+        }
+        free(responses[i]);
+    }
+    printf("multi    %zu properties, %zu connection(s)\n", n, get_n_connection());
+    
+    return ret == AAOS_OK ? 0 : -1;
+}
+
+struct CancelTest {
+    void *ascom;
+    char *responses[2];
+    int results[2];
+    bool done;
+};
+
+static void *
+cancel_thr(void *arg)
+{
+    struct CancelTest *test = (struct CancelTest *) arg;
+    const char *commands[] = {"slow", "altitude"};
+    size_t sizes[2];
+    
+    ascom_get_multi(test->ascom, 2, commands, test->responses, sizes, test->results);
+    test->done = true;
+    pthread_testcancel();
+    
+    return NULL;
+}
+
+/*
+ * A caller cancelled in the middle of ascom_get_multi gets its responses back,
+ * and the handles return to the pool.
+ */
+static int
+test_cancel(void *ascom)
+{
+    struct CancelTest test;
+    pthread_t tid;
+    void *result;
+    char *buf = NULL;
+    size_t size = 0;
+    int ret = 0;
+    
+    memset(&test, '\0', sizeof(test));
+    test.ascom = ascom;
+    ascom_set_timeout(ascom, 1., 5.);
+    Pthread_create(&tid, NULL, cancel_thr, &test);
+    usleep(200000);
+    pthread_cancel(tid);
+    Pthread_join(tid, &result);
+    if (result != PTHREAD_CANCELED || !test.done || test.results[0] != AAOS_OK || test.results[1] != AAOS_OK || test.responses[0] == NULL || strstr(test.responses[0], "slow") == NULL) {
+        fprintf(stderr, "`%s` failed at line %d.\n", __func__, __LINE__);
+        ret = -1;
+    }
+    free(test.responses[0]);
+    free(test.responses[1]);
+    if (ascom_get(ascom, "altitude", &buf, &size) != AAOS_OK) {
+        fprintf(stderr, "`%s` failed at line %d.\n", __func__, __LINE__);
+        ret = -1;
+    }
+    free(buf);
+    printf("cancel   %s\n", ret == 0 ? "deferred" : "lost");
+    
+    return ret;
+}
+
+static int
+test_timeout(void *ascom)
+{
+    char *buf = NULL;
+    size_t size = 0;
+    int ret;
+    
+    ascom_set_timeout(ascom, 1., 0.5);
+    ret = ascom_get(ascom, "slow", &buf, &size);
+    free(buf);
+    printf("timeout  %d\n", ret);
+    if (ret != AAOS_ETIMEDOUT) {
+        fprintf(stderr, "`%s` failed at line %d: %d.\n", __func__, __LINE__, ret);
+        return -1;
+    }
+    
+    return 0;
+}
+
+#define ASCOM_TEST_N_STATUS 8
+
+struct StatusTest {
+    void *mount;
+    char res[BUFSIZE];
+    int ret;
+};
+
+static void *
+status_thr(void *arg)
+{
+    struct StatusTest *test = (struct StatusTest *) arg;
+    
+    test->ret = __telescope_status(test->mount, test->res, sizeof(test->res), NULL);
+    
+    return NULL;
+}
+
+/*
+ * Concurrent callers of the status of a mount share one round trip while the snapshot is valid.
+ */
+static int
+test_mount_status(const char *port)
+{
+    struct StatusTest tests[ASCOM_TEST_N_STATUS];
+    pthread_t tids[ASCOM_TEST_N_STATUS];
+    cJSON *root_json, *ra_json, *state_json;
+    void *mount;
+    size_t i, n;
+    int ret = 0;
+    
+    mount = new(ASCOMMount(), "mount", "description", "ASCOM test mount", (char *) 0, "http://127.0.0.1", port, "v1", 1U, 1.);
+    for (i = 0; i < ASCOM_TEST_N_STATUS; i++) {
+        tests[i].mount = mount;
+        Pthread_create(&tids[i], NULL, status_thr, &tests[i]);
+    }
+    for (i = 0; i < ASCOM_TEST_N_STATUS; i++) {
+        Pthread_join(tids[i], NULL);
+        if (tests[i].ret != AAOS_OK || (root_json = cJSON_Parse(tests[i].res)) == NULL) {
+            fprintf(stderr, "`%s` failed at line %d: %d.\n", __func__, __LINE__, tests[i].ret);
+            ret = -1;
+            continue;
+        }
+        /*
+         * Alpaca gives right ascension in hours.
+         */
+        if ((ra_json = cJSON_GetObjectItem(root_json, "ra")) == NULL || ra_json->valuedouble != 22.5 || (state_json = cJSON_GetObjectItem(root_json, "state")) == NULL || strcmp(state_json->valuestring, "tracking") != 0) {
+            fprintf(stderr, "`%s` failed at line %d: %s.\n", __func__, __LINE__, tests[i].res);
+            ret = -1;
+        }
+        cJSON_Delete(root_json);
+    }
+    n = get_n_mount_status();
+    printf("status   %d callers, %zu round trip(s)\n", ASCOM_TEST_N_STATUS, n);
+    if (n != 1) {
+        fprintf(stderr, "`%s` failed at line %d.\n", __func__, __LINE__);
+        ret = -1;
+    }
+    /*
+     * The snapshot expires after status_validity.
+     */
+    usleep(1100000);
+    if (__telescope_status(mount, tests[0].res, sizeof(tests[0].res), NULL) != AAOS_OK || get_n_mount_status() != 2) {
+        fprintf(stderr, "`%s` failed at line %d.\n", __func__, __LINE__);
+        ret = -1;
+    }
+    delete(mount);
+    
+    return ret;
+}
+
+int
+main(int argc, char *argv[])
+{
+    struct sockaddr_in addr;
+    pthread_t tid;
+    void *ascom, *ascom2;
+    char port[16];
+    int on = 1, ret = 0;
+    
+    listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(ASCOM_TEST_PORT);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(listen_fd, (struct sockaddr *) &addr, sizeof(addr)) < 0 || listen(listen_fd, 16) < 0) {
+        fprintf(stderr, "`%s` failed at line %d.\n", __func__, __LINE__);
+        return EXIT_FAILURE;
+    }
+    Pthread_create(&tid, NULL, stub_thr, NULL);
+    
+    snprintf(port, sizeof(port), "%d", ASCOM_TEST_PORT);
+    ascom = new(ASCOM(), "http://127.0.0.1", port, "v1", "telescope", 0);
+    ascom2 = new(ASCOM(), "http://127.0.0.1", port, "v1", "dome", 0);
+    if (test_reuse(ascom, ascom2) != 0) {
+        ret = -1;
+    }
+    if (test_multi(ascom) != 0) {
+        ret = -1;
+    }
+    if (test_cancel(ascom) != 0) {
+        ret = -1;
+    }
+    if (test_timeout(ascom) != 0) {
+        ret = -1;
+    }
+    if (test_mount_status(port) != 0) {
+        ret = -1;
+    }
+    delete(ascom2);
+    delete(ascom);
+    
+    return ret == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+#else
+
+int
+main(int argc, char *argv[])
+{
+    fprintf(stderr, "ASCOM is not enabled.\n");
+    
+    return EXIT_SUCCESS;
+}
+
+#endif
@@ -0,0 +1,289 @@
+//
+//  dome_slave_test.c
+//  AAOS
+//
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "def.h"
+#include "dome.h"
+#include "dome_slave.h"
+#include "telescope.h"
+#include "telescope_def.h"
+#include "wrapper.h"
+
+/*
+ * Check the geometry model of the dome, follow a telescope tracking through the meridian
+ * close to the zenith for six hours, and slave a VirtualDome to a VirtualTelescope.
+ * The dome is 3 m in radius, with a German equatorial mount 0.3 m north of the center,
+ * and the optical axis 0.5 m from the polar axis.
+ */
+
+#define DOME_TEST_LATITUDE      40.393
+#define DOME_TEST_LONGITUDE     117.575
+#define DOME_TEST_RADIUS        3.
+#define DOME_TEST_NORTH         0.3
+#define DOME_TEST_OFFSET        0.5
+#define DOME_TEST_HYSTERESIS    2.
+#define DOME_TEST_STEP          1.
+
+static double
+azimuth_distance(double a, double b)
+{
+    double x = fmod(fabs(a - b), 360.);
+    
+    return x > 180. ? 360. - x : x;
+}
+
+static void
+hadec2altaz(double latitude, double ha, double dec, double *alt, double *az)
+{
+    double sh = sin(ha * M_PI / 180.), ch = cos(ha * M_PI / 180.), sd = sin(dec * M_PI / 180.), cd = cos(dec * M_PI / 180.);
+    double sl = sin(latitude * M_PI / 180.), cl = cos(latitude * M_PI / 180.);
+    
+    *alt = asin(sd * sl + cd * ch * cl) * 180. / M_PI;
+    *az = atan2(-cd * sh, sd * cl - cd * ch * sl) * 180. / M_PI;
+    if (*az < 0.) {
+        *az += 360.;
+    }
+}
+
+static void
+test_geometry_init(struct DomeGeometry *geometry)
+{
+    geometry->latitude = DOME_TEST_LATITUDE;
+    geometry->radius = DOME_TEST_RADIUS;
+    geometry->east = 0.;
+    geometry->north = DOME_TEST_NORTH;
+    geometry->up = 0.;
+    geometry->offset = DOME_TEST_OFFSET;
+}
+
+static int
+test_geometry(void)
+{
+    struct DomeGeometry geometry;
+    double alt, az, ha, dec, azimuth, azimuth2, worst = 0.;
+    int ret;
+    
+    /*
+     * A mount at the center sees the slit at its own azimuth.
+     */
+    memset(&geometry, '\0', sizeof(struct DomeGeometry));
+    geometry.latitude = DOME_TEST_LATITUDE;
+    geometry.radius = DOME_TEST_RADIUS;
+    for (alt = 5.; alt < 90.; alt += 5.) {
+        for (az = 0.; az < 360.; az += 10.) {
+            dome_geometry_hadec(geometry.latitude, alt, az, &ha, &dec);
+            if ((ret = dome_geometry_azimuth(&geometry, ha, dec, &azimuth)) != AAOS_OK) {
+                fprintf(stderr, "`%s` failed at line %d: %d.\n", __func__, __LINE__, ret);
+                return -1;
+            }
+            worst = fmax(worst, azimuth_distance(azimuth, az));
+        }
+    }
+    printf("center   largest difference %.2e degree\n", worst);
+    if (worst > 1e-9) {
+        fprintf(stderr, "`%s` failed at line %d.\n", __func__, __LINE__);
+        return -1;
+    }
+    
+    /*
+     * 1 m north of the center, the east horizon is seen at atan(sqrt(8)).
+     */
+    geometry.north = 1.;
+    dome_geometry_hadec(geometry.latitude, 0., 90., &ha, &dec);
+    dome_geometry_azimuth(&geometry, ha, dec, &azimuth);
+    printf("offset   east horizon at %.4f degree\n", azimuth);
+    if (fabs(azimuth - atan(sqrt(8.)) * 180. / M_PI) > 1e-9) {
+        fprintf(stderr, "`%s` failed at line %d.\n", __func__, __LINE__);
+        return -1;
+    }
+    
+    /*
+     * A German equatorial mount at the center is mirrored about the meridian, with the tube on the other side.
+     */
+    geometry.north = 0.;
+    geometry.offset = DOME_TEST_OFFSET;
+    dome_geometry_azimuth(&geometry, 30., 20., &azimuth);
+    dome_geometry_azimuth(&geometry, -30., 20., &azimuth2);
+    printf("german   %.4f and %.4f degree at hour angle +-2h\n", azimuth, azimuth2);
+    hadec2altaz(geometry.latitude, 30., 20., &alt, &az);
+    if (fabs(azimuth + azimuth2 - 360.) > 1e-9 || azimuth_distance(azimuth, az) < 1.) {
+        fprintf(stderr, "`%s` failed at line %d.\n", __func__, __LINE__);
+        return -1;
+    }
+    
+    geometry.radius = 0.3;
+    if (dome_geometry_azimuth(&geometry, 30., 20., &azimuth) != AAOS_EINVAL) {
+        fprintf(stderr, "`%s` failed at line %d.\n", __func__, __LINE__);
+        return -1;
+    }
+    
+    return 0;
+}
+
+/*
+ * Track from three hours east to three hours west of the meridian, passing 5 degree from the zenith,
+ * where the tube changes side. The dome reaches every aim before the next poll.
+ * Returns the moves, the fraction of the time the slit is more than hysteresis off the telescope
+ * while the dome can keep up, and the polls where it cannot.
+ */
+static uint64_t
+simulate(double lead, double *off, uint64_t *fast)
+{
+    struct DomeGeometry geometry;
+    struct DomeSlave slave;
+    double t, ha, dec = DOME_TEST_LATITUDE - 5., alt, az, required, dome = 0., azimuth, ahead, later;
+    uint64_t n_move;
+    
+    test_geometry_init(&geometry);
+    dome_slave_init(&slave, &geometry, DOME_TEST_HYSTERESIS, lead, DOME_SLAVE_INTERVAL);
+    *off = 0.;
+    *fast = 0;
+    for (t = 0.; t < 6. * 3600.; t += DOME_TEST_STEP) {
+        ha = -45. + t * 15.041 / 3600.;
+        /*
+         * The slave sees the telescope by altitude and azimuth, as reported by the mount.
+         */
+        hadec2altaz(geometry.latitude, ha, dec, &alt, &az);
+        if (dome_slave_update(&slave, alt, az, t, &azimuth, &ahead)) {
+            dome = azimuth;
+        }
+        /*
+         * Where the slit runs more than the hysteresis per interval, the dome falls behind by design.
+         */
+        dome_geometry_azimuth(&geometry, ha, dec, &required);
+        dome_geometry_azimuth(&geometry, ha + DOME_SLAVE_INTERVAL * 15.041 / 3600., dec, &later);
+        if (azimuth_distance(required, later) > DOME_TEST_HYSTERESIS) {
+            (*fast)++;
+        } else if (azimuth_distance(required, dome) > DOME_TEST_HYSTERESIS) {
+            *off += DOME_TEST_STEP / (6. * 3600.);
+        }
+    }
+    n_move = slave.n_move;
+    dome_slave_destroy(&slave);
+    
+    return n_move;
+}
+
+static int
+test_tracking(void)
+{
+    double off_lead, off_plain;
+    uint64_t n_lead, n_plain, n_fast, n_poll = (uint64_t) (6. * 3600. / DOME_TEST_STEP);
+    
+    n_plain = simulate(0., &off_plain, &n_fast);
+    n_lead = simulate(DOME_SLAVE_LEAD, &off_lead, &n_fast);
+    printf("tracking %llu polls (%llu near the zenith), %llu moves without lead (%.3f%% off), %llu moves with lead (%.3f%% off)\n",
+           (unsigned long long) n_poll, (unsigned long long) n_fast, (unsigned long long) n_plain, off_plain * 100., (unsigned long long) n_lead, off_lead * 100.);
+    if (off_lead > 0.001 || off_plain > 0.001 || !(n_lead < n_plain) || n_plain > n_poll / 100 || n_fast > n_poll / 10) {
+        fprintf(stderr, "`%s` failed at line %d.\n", __func__, __LINE__);
+        return -1;
+    }
+    
+    return 0;
+}
+
+static int
+telescope_position(void *telescope, double *ra, double *dec, double *alt, double *az)
+{
+    struct TelescopeStatusRecord record;
+    int ret;
+    
+    if ((ret = __telescope_cached_status(telescope, TELESCOPE_STATUS_FORMAT_BINARY, &record, sizeof(record), NULL)) != AAOS_OK) {
+        return ret;
+    }
+    if ((record.state & ~TELESCOPE_STATE_MALFUNCTION) != TELESCOPE_STATE_TRACKING) {
+        return AAOS_EBUSY;
+    }
+    *ra = record.ra;
+    *dec = record.dec;
+    *alt = record.alt;
+    *az = record.az;
+    
+    return AAOS_OK;
+}
+
+static int
+test_virtual(void)
+{
+    struct DomeGeometry geometry, expected;
+    struct DomeSlave slave;
+    double ra, dec, alt, az, ha, required, azimuth;
+    void *telescope, *dome;
+    uint64_t n_move;
+    int ret = 0;
+    
+    telescope = new(VirtualTelescope(), "telescope", "longitude", DOME_TEST_LONGITUDE, "latitude", DOME_TEST_LATITUDE, '\0');
+    __telescope_power_on(telescope);
+    __telescope_init(telescope);
+    __telescope_set_slew_speed(telescope, 60., 60.);
+    dome = new(VirtualDome(), "dome", "slew_speed", 90., "latitude", DOME_TEST_LATITUDE, "longitude", DOME_TEST_LONGITUDE,
+               "radius", DOME_TEST_RADIUS, "mount_north", DOME_TEST_NORTH, "mount_offset", DOME_TEST_OFFSET, '\0');
+    __dome_init(dome);
+    
+    /*
+     * The slave takes the geometry configured on the dome.
+     */
+    test_geometry_init(&expected);
+    if ((ret = __dome_get_geometry(dome, &geometry)) != AAOS_OK || memcmp(&geometry, &expected, sizeof(struct DomeGeometry)) != 0) {
+        fprintf(stderr, "`%s` failed at line %d: %d.\n", __func__, __LINE__, ret);
+        delete(dome);
+        delete(telescope);
+        return -1;
+    }
+    dome_slave_init(&slave, &geometry, DOME_TEST_HYSTERESIS, DOME_SLAVE_LEAD, DOME_SLAVE_INTERVAL);
+    dome_slave_start(&slave, telescope, telescope_position, dome, __dome_slew, 0.2);
+    /*
+     * The dome stays while the telescope slews.
+     */
+    if ((ret = __telescope_slew(telescope, 120., 60.)) != AAOS_OK || slave.n_move != 0) {
+        fprintf(stderr, "`%s` failed at line %d: %d.\n", __func__, __LINE__, ret);
+        ret = -1;
+    }
+    Nanosleep(3.);
+    n_move = slave.n_move;
+    dome_slave_stop(&slave);
+    
+    telescope_position(telescope, &ra, &dec, &alt, &az);
+    dome_geometry_hadec(geometry.latitude, alt, az, &ha, &dec);
+    dome_geometry_azimuth(&geometry, ha, dec, &required);
+    __dome_get_azimuth(dome, &azimuth);
+    printf("virtual  telescope at alt %.2f az %.2f, slit required at %.2f, dome at %.2f, %llu move(s)\n", alt, az, required, azimuth, (unsigned long long) n_move);
+    if (azimuth_distance(required, azimuth) > DOME_TEST_HYSTERESIS || n_move != 1) {
+        fprintf(stderr, "`%s` failed at line %d.\n", __func__, __LINE__);
+        ret = -1;
+    }
+    
+    dome_slave_destroy(&slave);
+    delete(dome);
+    delete(telescope);
+    
+    return ret;
+}
+
+int
+main(int argc, char *argv[])
+{
+    int ret = 0;
+    
+    if (test_geometry() != 0) {
+        ret = -1;
+    }
+    if (test_tracking() != 0) {
+        ret = -1;
+    }
+    if (test_virtual() != 0) {
+        ret = -1;
+    }
+    
+    return ret == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
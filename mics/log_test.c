@@ -0,0 +1,206 @@
+//
+//  log_test.c
+//  AAOS
+//
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "def.h"
+#include "log.h"
+#include "log_def.h"
+#include "log_rpc.h"
+#include "rpc.h"
+#include "wrapper.h"
+
+/*
+ * Check that a log buffers its records until an urgent one comes, rotates its file,
+ * and serve a facility from a LogServer over a Unix domain socket, with a client submitting
+ * a batch of records and another one tailing the facility.
+ */
+
+#define LOG_TEST_DIRECTORY  "/tmp"
+#define LOG_TEST_FACILITY   "log_test"
+#define LOG_TEST_SOCKET     "/tmp/log_test.sock"
+#define LOG_TEST_PORT       "17750"
+#define LOG_TEST_RECORD     1000
+
+extern void **logs;
+extern size_t n_log;
+
+static size_t
+count_lines(const char *path)
+{
+    FILE *fp;
+    size_t n = 0;
+    int c;
+    
+    if ((fp = fopen(path, "r")) == NULL) {
+        return 0;
+    }
+    while ((c = fgetc(fp)) != EOF) {
+        if (c == '\n') {
+            n++;
+        }
+    }
+    fclose(fp);
+    
+    return n;
+}
+
+static void
+remove_files(void)
+{
+    char path[PATHSIZE];
+    int i;
+    
+    snprintf(path, PATHSIZE, "%s/%s.log", LOG_TEST_DIRECTORY, LOG_TEST_FACILITY);
+    unlink(path);
+    for (i = 1; i <= 3; i++) {
+        snprintf(path, PATHSIZE, "%s/%s.log.%d", LOG_TEST_DIRECTORY, LOG_TEST_FACILITY, i);
+        unlink(path);
+    }
+}
+
+static int
+test_buffer(void)
+{
+    void *log_;
+    char path[PATHSIZE], path2[PATHSIZE];
+    size_t i, n;
+    
+    remove_files();
+    snprintf(path, PATHSIZE, "%s/%s.log", LOG_TEST_DIRECTORY, LOG_TEST_FACILITY);
+    log_ = new(__Log(), LOG_TEST_FACILITY, LOG_TEST_DIRECTORY, "buffer_size", (size_t) 4096, "flush_interval", 60., "max_size", (size_t) 16384, "max_files", 2, '\0');
+    for (i = 0; i < 10; i++) {
+        __log_write(log_, LOG_LEVEL_INFO, "buffered");
+    }
+    n = count_lines(path);
+    __log_write(log_, LOG_LEVEL_ERR, "urgent");
+    printf("buffer   %zu line(s) before an urgent record, %zu after\n", n, count_lines(path));
+    if (n != 0 || count_lines(path) != 11) {
+        fprintf(stderr, "`%s` failed at line %d.\n", __func__, __LINE__);
+        delete(log_);
+        return -1;
+    }
+    
+    for (i = 0; i < LOG_TEST_RECORD; i++) {
+        __log_write(log_, LOG_LEVEL_INFO, "a record long enough to rotate the file a few times");
+    }
+    delete(log_);
+    snprintf(path, PATHSIZE, "%s/%s.log.2", LOG_TEST_DIRECTORY, LOG_TEST_FACILITY);
+    snprintf(path2, PATHSIZE, "%s/%s.log.3", LOG_TEST_DIRECTORY, LOG_TEST_FACILITY);
+    printf("rotate   %s %s, %s %s\n", path, Access(path, F_OK) == 0 ? "kept" : "missing", path2, Access(path2, F_OK) == 0 ? "kept" : "removed");
+    if (Access(path, F_OK) != 0 || Access(path2, F_OK) == 0) {
+        fprintf(stderr, "`%s` failed at line %d.\n", __func__, __LINE__);
+        return -1;
+    }
+    
+    return 0;
+}
+
+static void *
+server_thr(void *arg)
+{
+    rpc_server_start(arg);
+    
+    return NULL;
+}
+
+static int
+test_server(void)
+{
+    void *server, *client, *log_rpc, *tail_rpc;
+    pthread_t tid;
+    char path[PATHSIZE];
+    const char *topic;
+    const void *event;
+    size_t i, j, size, n_line = 0;
+    int ret, status = 0;
+    
+    remove_files();
+    unlink(LOG_TEST_SOCKET);
+    n_log = 1;
+    logs = (void **) Malloc(sizeof(void *));
+    logs[0] = new(__Log(), LOG_TEST_FACILITY, LOG_TEST_DIRECTORY, "flush_interval", 60., '\0');
+    server = new(LogServer(), LOG_TEST_PORT);
+    tcp_server_set_path(server, LOG_TEST_SOCKET);
+    tcp_server_set_option(server, TCPSERVER_OPTION_BLOCK_PERTHREAD | TCPSERVER_OPTION_UDS);
+    Pthread_create(&tid, NULL, server_thr, server);
+    for (i = 0; i < 100 && Access(LOG_TEST_SOCKET, F_OK) != 0; i++) {
+        Nanosleep(0.01);
+    }
+    
+    client = new(LogClient(), LOG_TEST_SOCKET, LOG_TEST_PORT);
+    if ((ret = rpc_client_connect(client, &tail_rpc)) != AAOS_OK || (ret = rpc_subscribe(tail_rpc, "log/" LOG_TEST_FACILITY)) != AAOS_OK) {
+        fprintf(stderr, "`%s` failed at line %d: %d.\n", __func__, __LINE__, ret);
+        return -1;
+    }
+    if ((ret = rpc_client_connect(client, &log_rpc)) != AAOS_OK || (ret = log_get_index_by_facility(log_rpc, LOG_TEST_FACILITY)) != AAOS_OK) {
+        fprintf(stderr, "`%s` failed at line %d: %d.\n", __func__, __LINE__, ret);
+        return -1;
+    }
+    for (i = 0; i < LOG_TEST_RECORD; i++) {
+        if ((ret = log_submit(log_rpc, LOG_LEVEL_INFO, "submitted")) != AAOS_OK) {
+            fprintf(stderr, "`%s` failed at line %d: %d.\n", __func__, __LINE__, ret);
+            status = -1;
+            break;
+        }
+    }
+    if ((ret = log_submit(log_rpc, LOG_LEVEL_CRIT, "submitted")) != AAOS_OK) {
+        fprintf(stderr, "`%s` failed at line %d: %d.\n", __func__, __LINE__, ret);
+        status = -1;
+    }
+    
+    while (rpc_next_event(tail_rpc, 1., &topic, &event, &size) == AAOS_OK) {
+        if (strcmp(topic, "log/" LOG_TEST_FACILITY) == 0) {
+            for (j = 0; j < size; j++) {
+                if (((const char *) event)[j] == '\n') {
+                    n_line++;
+                }
+            }
+        }
+        if (n_line == LOG_TEST_RECORD + 1) {
+            break;
+        }
+    }
+    snprintf(path, PATHSIZE, "%s/%s.log", LOG_TEST_DIRECTORY, LOG_TEST_FACILITY);
+    printf("server   %zu line(s) written, %zu tailed\n", count_lines(path), n_line);
+    if (count_lines(path) != LOG_TEST_RECORD + 1 || n_line != LOG_TEST_RECORD + 1) {
+        fprintf(stderr, "`%s` failed at line %d.\n", __func__, __LINE__);
+        status = -1;
+    }
+    
+    if (log_get_index_by_facility(log_rpc, "nonexistent") != AAOS_ENOTFOUND) {
+        fprintf(stderr, "`%s` failed at line %d.\n", __func__, __LINE__);
+        status = -1;
+    }
+    
+    delete(log_rpc);
+    delete(tail_rpc);
+    delete(client);
+    unlink(LOG_TEST_SOCKET);
+    remove_files();
+    
+    return status;
+}
+
+int
+main(int argc, char *argv[])
+{
+    int ret = 0;
+    
+    if (test_buffer() != 0) {
+        ret = -1;
+    }
+    if (test_server() != 0) {
+        ret = -1;
+    }
+    
+    return ret == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
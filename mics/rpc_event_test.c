@@ -0,0 +1,214 @@
+//
+//  rpc_event_test.c
+//  AAOS
+//
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+
+#include "def.h"
+#include "object.h"
+#include "net.h"
+#include "net_r.h"
+#include "rpc.h"
+#include "rpc_r.h"
+#include "wrapper.h"
+
+/*
+ * Event subscription against a server, started in a child process, whose requests publish
+ * the value in U32F0 to the topics "dome/a" and "telescope/b", as the state broadcasts of the devices do.
+ */
+
+#define RPC_EVENT_TEST_PORT             "17810"
+#define RPC_EVENT_TEST_CONNECT_WAIT     200
+#define RPC_EVENT_TEST_PROTOCOL         0x101
+#define RPC_EVENT_TEST_EVENTS           16
+#define RPC_EVENT_TEST_TIMEOUT          2.
+
+static const void *test_rpc_class, *test_server_class;
+
+static int
+EventTestRPC_execute(void *_self)
+{
+    uint32_t value;
+    
+    protobuf_get(_self, PACKET_U32F0, &value);
+    rpc_publish("dome/a", &value, sizeof(value));
+    rpc_publish("telescope/b", &value, sizeof(value));
+    protobuf_set(_self, PACKET_LENGTH, 0);
+    
+    return AAOS_OK;
+}
+
+static int
+EventTestServer_accept(void *_self, void **client)
+{
+    int cfd;
+    
+    if ((cfd = rpc_server_accept_fd(_self, TCPSERVER_OPTION_TCP)) < 0) {
+        *client = NULL;
+        return AAOS_ERROR;
+    }
+    if ((*client = new(test_rpc_class, cfd)) == NULL) {
+        Close(cfd);
+        return AAOS_ERROR;
+    }
+    
+    return AAOS_OK;
+}
+
+static void
+serve(void)
+{
+    void *server;
+    
+    test_rpc_class = new(RPCClass(), "EventTestRPC", RPC(), sizeof(struct RPC),
+                         rpc_execute, "execute", EventTestRPC_execute,
+                         (void *) 0);
+    test_server_class = new(RPCServerClass(), "EventTestServer", RPCServer(), sizeof(struct RPCServer),
+                            rpc_server_accept, "accept", EventTestServer_accept,
+                            (void *) 0);
+    server = new(test_server_class, RPC_EVENT_TEST_PORT);
+    tcp_server_set_option(server, TCPSERVER_OPTION_TCP);
+    rpc_server_start(server);
+    exit(EXIT_SUCCESS);
+}
+
+static void *
+connect_server(void)
+{
+    void *client, *rpc = NULL;
+    size_t i;
+    
+    client = new(RPCClient(), "127.0.0.1", RPC_EVENT_TEST_PORT);
+    for (i = 0; i < RPC_EVENT_TEST_CONNECT_WAIT; i++) {
+        if (rpc_client_connect(client, &rpc) == AAOS_OK) {
+            break;
+        }
+        Nanosleep(0.01);
+    }
+    delete(client);
+    
+    return rpc;
+}
+
+static int
+publish(void *rpc, uint32_t value)
+{
+    protobuf_set(rpc, PACKET_PROTOCOL, RPC_EVENT_TEST_PROTOCOL);
+    protobuf_set(rpc, PACKET_COMMAND, 1);
+    protobuf_set(rpc, PACKET_U32F0, value);
+    protobuf_set(rpc, PACKET_LENGTH, 0);
+    
+    return rpc_call(rpc);
+}
+
+/*
+ * Only the events of the subscribed pattern arrive, in order and numbered without gaps.
+ */
+static int
+test_subscribe(void *subscriber, void *publisher)
+{
+    const char *topic;
+    const void *event;
+    size_t i, size;
+    uint64_t sequence, last_sequence = 0;
+    uint32_t value;
+    int ret = 0;
+    
+    if (rpc_subscribe(subscriber, "dome/*") != AAOS_OK) {
+        fprintf(stderr, "`%s` failed at line %d.\n", __func__, __LINE__);
+        return -1;
+    }
+    for (i = 0; i < RPC_EVENT_TEST_EVENTS; i++) {
+        if (publish(publisher, (uint32_t) i + 1) != AAOS_OK) {
+            fprintf(stderr, "`%s` failed at line %d.\n", __func__, __LINE__);
+            return -1;
+        }
+    }
+    for (i = 0; i < RPC_EVENT_TEST_EVENTS; i++) {
+        if (rpc_next_event(subscriber, RPC_EVENT_TEST_TIMEOUT, &topic, &event, &size) != AAOS_OK) {
+            fprintf(stderr, "`%s` failed at line %d: event %zu.\n", __func__, __LINE__, i);
+            return -1;
+        }
+        memcpy(&value, event, sizeof(value));
+        protobuf_get(subscriber, PACKET_U64F0, &sequence);
+        if (strcmp(topic, "dome/a") != 0 || size != sizeof(value) || value != i + 1 || (i > 0 && sequence != last_sequence + 1)) {
+            fprintf(stderr, "`%s` failed at line %d: topic %s, value %u, sequence %llu.\n", __func__, __LINE__, topic, value, (unsigned long long) sequence);
+            ret = -1;
+        }
+        last_sequence = sequence;
+    }
+    if (rpc_next_event(subscriber, 0.2, &topic, &event, &size) != AAOS_ETIMEDOUT) {
+        fprintf(stderr, "`%s` failed at line %d.\n", __func__, __LINE__);
+        ret = -1;
+    }
+    printf("subscribe   %d event(s) of \"dome/a\", none of \"telescope/b\"\n", RPC_EVENT_TEST_EVENTS);
+    
+    return ret;
+}
+
+/*
+ * Nothing arrives after the last pattern is removed.
+ */
+static int
+test_unsubscribe(void *subscriber, void *publisher)
+{
+    const char *topic;
+    const void *event;
+    size_t size;
+    int ret = 0;
+    
+    if (rpc_unsubscribe(subscriber, NULL) != AAOS_OK) {
+        fprintf(stderr, "`%s` failed at line %d.\n", __func__, __LINE__);
+        return -1;
+    }
+    publish(publisher, 0);
+    if (rpc_next_event(subscriber, 0.2, &topic, &event, &size) != AAOS_ETIMEDOUT) {
+        fprintf(stderr, "`%s` failed at line %d.\n", __func__, __LINE__);
+        ret = -1;
+    }
+    printf("unsubscribe no event\n");
+    
+    return ret;
+}
+
+int
+main(int argc, char *argv[])
+{
+    void *subscriber, *publisher;
+    pid_t pid;
+    int ret = 0;
+    
+    if ((pid = fork()) < 0) {
+        return EXIT_FAILURE;
+    } else if (pid == 0) {
+        serve();
+    }
+    
+    if ((subscriber = connect_server()) == NULL || (publisher = connect_server()) == NULL) {
+        fprintf(stderr, "`%s` failed at line %d.\n", __func__, __LINE__);
+        ret = -1;
+    } else {
+        if (test_subscribe(subscriber, publisher) != 0) {
+            ret = -1;
+        }
+        if (test_unsubscribe(subscriber, publisher) != 0) {
+            ret = -1;
+        }
+        delete(subscriber);
+        delete(publisher);
+    }
+    
+    kill(pid, SIGTERM);
+    waitpid(pid, NULL, 0);
+    
+    return ret == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,270 @@
+//
+//  rpc_load_test.c
+//  AAOS
+//
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+
+#include "def.h"
+#include "net.h"
+#include "rpc.h"
+#include "wrapper.h"
+
+/*
+ * Compare the threading modes of RPC servers.
+ * For every mode, a server is started in a child process, and concurrent clients
+ * send SYSTEM_COMMAND_PING requests with a payload, which the server echoes without
+ * going through rpc_execute, so only the transport and the threading are measured.
+ */
+
+#define RPC_LOAD_TEST_PORT          17700
+#define RPC_LOAD_TEST_CONNECT_WAIT  200
+
+struct LoadTestMode {
+    const char *name;
+    unsigned int option;
+};
+
+static struct LoadTestMode modes[] = {
+    {"block_perthread", TCPSERVER_OPTION_BLOCK_PERTHREAD},
+    {"nonblock_perthread", TCPSERVER_OPTION_NONBLOCK_PERTHREAD},
+    {"block_prethreaded", TCPSERVER_OPTION_BLOCK_PRETHEADED},
+    {"nonblock_prethreaded", TCPSERVER_OPTION_NONBLOCK_PRETHEADED},
+};
+
+struct LoadTestClient {
+    char port[16];
+    size_t n_request;
+    size_t size;
+    double *latency;
+    size_t n_done;
+};
+
+static size_t n_connection = 8, n_request = 10000, size = 64, n_thread = 0;
+static int port = RPC_LOAD_TEST_PORT;
+
+static struct option longopts[] = {
+    {"connections", required_argument, NULL, 'c'},
+    {"help", no_argument, NULL, 'h'},
+    {"mode", required_argument, NULL, 'm'},
+    {"requests", required_argument, NULL, 'n'},
+    {"port", required_argument, NULL, 'p'},
+    {"size", required_argument, NULL, 's'},
+    {"threads", required_argument, NULL, 't'},
+    {NULL, 0, NULL, 0}};
+
+static void
+usage(void)
+{
+    fprintf(stderr, "usage: rpc_load_test [-h | --help]\n");
+    fprintf(stderr, "      [-c <n> | --connections <n>] [-n <n> | --requests <n>]\n");
+    fprintf(stderr, "      [-s <bytes> | --size <bytes>] [-t <n> | --threads <n>]\n");
+    fprintf(stderr, "      [-p <port> | --port <port>] [-m <mode> | --mode <mode>]\n\n");
+    fprintf(stderr, "    -c  concurrent client connections, 8 by default\n");
+    fprintf(stderr, "    -n  requests sent by every connection, 10000 by default\n");
+    fprintf(stderr, "    -s  payload of every request, 64 bytes by default\n");
+    fprintf(stderr, "    -t  threads of prethreaded servers, the number of CPUs by default\n");
+    fprintf(stderr, "    -p  first port, every mode is served on a port of its own\n");
+    fprintf(stderr, "    -m  block_perthread, nonblock_perthread, block_prethreaded or nonblock_prethreaded,\n");
+    fprintf(stderr, "        all modes by default\n");
+    exit(EXIT_FAILURE);
+}
+
+static double
+elapsed(const struct timespec *tp0, const struct timespec *tp1)
+{
+    return (tp1->tv_sec - tp0->tv_sec) + (tp1->tv_nsec - tp0->tv_nsec) / 1000000000.;
+}
+
+static int
+compare_double(const void *a, const void *b)
+{
+    double x = *(const double *) a, y = *(const double *) b;
+    
+    return (x > y) - (x < y);
+}
+
+static void
+serve(unsigned int option, const char *service)
+{
+    void *server;
+    
+    server = new(RPCServer(), service);
+    tcp_server_set_option(server, option | TCPSERVER_OPTION_TCP);
+    tcp_server_set_threads(server, n_thread, n_connection);
+    rpc_server_start(server);
+    delete(server);
+    exit(EXIT_SUCCESS);
+}
+
+static void *
+client_thr(void *arg)
+{
+    struct LoadTestClient *client = (struct LoadTestClient *) arg;
+    struct timespec tp0, tp1;
+    void *tcp_client, *rpc = NULL;
+    char *payload;
+    size_t i;
+    
+    tcp_client = new(RPCClient(), "127.0.0.1", client->port);
+    for (i = 0; i < RPC_LOAD_TEST_CONNECT_WAIT; i++) {
+        if (rpc_client_connect(tcp_client, &rpc) == AAOS_OK) {
+            break;
+        }
+        Nanosleep(0.01);
+    }
+    if (rpc == NULL) {
+        fprintf(stderr, "`%s` failed at line %d.\n", __func__, __LINE__);
+        delete(tcp_client);
+        return NULL;
+    }
+    
+    payload = (char *) Malloc(client->size + 1);
+    memset(payload, 'x', client->size);
+    protobuf_set(rpc, PACKET_PROTOCOL, PROTO_SYSTEM);
+    protobuf_set(rpc, PACKET_COMMAND, SYSTEM_COMMAND_PING);
+    if (client->size > 0) {
+        protobuf_set(rpc, PACKET_BUF, payload, client->size);
+    } else {
+        protobuf_set(rpc, PACKET_LENGTH, 0);
+    }
+    for (i = 0; i < client->n_request; i++) {
+        Clock_gettime(CLOCK_MONOTONIC, &tp0);
+        if (rpc_call(rpc) != AAOS_OK) {
+            fprintf(stderr, "`%s` failed at line %d.\n", __func__, __LINE__);
+            break;
+        }
+        Clock_gettime(CLOCK_MONOTONIC, &tp1);
+        client->latency[i] = elapsed(&tp0, &tp1);
+    }
+    client->n_done = i;
+    
+    free(payload);
+    delete(rpc);
+    delete(tcp_client);
+    
+    return NULL;
+}
+
+static int
+test_mode(const struct LoadTestMode *mode, int mode_port)
+{
+    struct LoadTestClient *clients;
+    struct timespec tp0, tp1;
+    pthread_t *tids;
+    double *latency, duration;
+    size_t i, n = 0;
+    pid_t pid;
+    char service[16];
+    
+    snprintf(service, sizeof(service), "%d", mode_port);
+    if ((pid = fork()) < 0) {
+        fprintf(stderr, "`%s` failed at line %d.\n", __func__, __LINE__);
+        return -1;
+    } else if (pid == 0) {
+        serve(mode->option, service);
+    }
+    
+    clients = (struct LoadTestClient *) Malloc(sizeof(struct LoadTestClient) * n_connection);
+    tids = (pthread_t *) Malloc(sizeof(pthread_t) * n_connection);
+    latency = (double *) Malloc(sizeof(double) * n_connection * n_request);
+    
+    Clock_gettime(CLOCK_MONOTONIC, &tp0);
+    for (i = 0; i < n_connection; i++) {
+        snprintf(clients[i].port, sizeof(clients[i].port), "%s", service);
+        clients[i].n_request = n_request;
+        clients[i].size = size;
+        clients[i].latency = latency + i * n_request;
+        clients[i].n_done = 0;
+        Pthread_create(&tids[i], NULL, client_thr, &clients[i]);
+    }
+    for (i = 0; i < n_connection; i++) {
+        Pthread_join(tids[i], NULL);
+    }
+    Clock_gettime(CLOCK_MONOTONIC, &tp1);
+    duration = elapsed(&tp0, &tp1);
+    
+    kill(pid, SIGTERM);
+    waitpid(pid, NULL, 0);
+    
+    for (i = 0; i < n_connection; i++) {
+        memmove(latency + n, clients[i].latency, sizeof(double) * clients[i].n_done);
+        n += clients[i].n_done;
+    }
+    if (n == 0) {
+        printf("%-22s no request completed\n", mode->name);
+    } else {
+        qsort(latency, n, sizeof(double), compare_double);
+        printf("%-22s %10.0f %10.2f %10.1f %10.1f %10.1f %10.1f\n", mode->name, n / duration, 2. * n * (size + PACKETHEADERSIZE) / duration / 1048576.,
+               latency[n / 2] * 1e6, latency[n * 9 / 10] * 1e6, latency[n * 99 / 100] * 1e6, latency[n - 1] * 1e6);
+    }
+    
+    free(latency);
+    free(tids);
+    free(clients);
+    
+    return n == n_connection * n_request ? 0 : -1;
+}
+
+int
+main(int argc, char *argv[])
+{
+    const char *mode = NULL;
+    size_t i;
+    int ch, ret = 0;
+    bool found = false;
+    
+    while ((ch = getopt_long(argc, argv, "c:hm:n:p:s:t:", longopts, NULL)) != -1) {
+        switch (ch) {
+            case 'c':
+                n_connection = strtoul(optarg, NULL, 0);
+                break;
+            case 'm':
+                mode = optarg;
+                break;
+            case 'n':
+                n_request = strtoul(optarg, NULL, 0);
+                break;
+            case 'p':
+                port = atoi(optarg);
+                break;
+            case 's':
+                size = strtoul(optarg, NULL, 0);
+                break;
+            case 't':
+                n_thread = strtoul(optarg, NULL, 0);
+                break;
+            default:
+                usage();
+                break;
+        }
+    }
+    if (n_connection == 0 || n_request == 0) {
+        usage();
+    }
+    
+    printf("%zu connections, %zu requests of %zu bytes each\n", n_connection, n_request, size);
+    printf("%-22s %10s %10s %10s %10s %10s %10s\n", "mode", "calls/s", "MiB/s", "p50 us", "p90 us", "p99 us", "max us");
+    for (i = 0; i < sizeof(modes) / sizeof(modes[0]); i++) {
+        if (mode != NULL && strcasecmp(mode, modes[i].name) != 0) {
+            continue;
+        }
+        found = true;
+        if (test_mode(&modes[i], port + (int) i) != 0) {
+            fprintf(stderr, "`%s` failed at line %d: %s.\n", __func__, __LINE__, modes[i].name);
+            ret = -1;
+        }
+    }
+    if (!found) {
+        usage();
+    }
+    
+    return ret == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
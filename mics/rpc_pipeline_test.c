@@ -0,0 +1,325 @@
+//
+//  rpc_pipeline_test.c
+//  AAOS
+//
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+
+#include "def.h"
+#include "object.h"
+#include "net.h"
+#include "net_r.h"
+#include "rpc.h"
+#include "rpc_r.h"
+#include "wrapper.h"
+
+/*
+ * Pipelined calls against a server, started in a child process, whose requests sleep
+ * for the number of milliseconds in U32F0 and echo the tag in U32F1.
+ * Several clients run at once, each with calls in flight finishing out of order.
+ */
+
+#define RPC_PIPELINE_TEST_PORT          "17800"
+#define RPC_PIPELINE_TEST_CONNECT_WAIT  200
+#define RPC_PIPELINE_TEST_CALLS         8
+#define RPC_PIPELINE_TEST_STEP          50
+#define RPC_PIPELINE_TEST_CLIENTS       4
+#define RPC_PIPELINE_TEST_PROTOCOL      0x100
+
+struct PipelineTestCall {
+    uint32_t tag;
+    int result;
+    size_t order;
+    size_t *n_done;
+};
+
+static const void *test_rpc_class, *test_server_class;
+
+static int
+PipelineTestRPC_execute(void *_self)
+{
+    uint32_t delay;
+    
+    protobuf_get(_self, PACKET_U32F0, &delay);
+    Nanosleep(delay / 1000.);
+    protobuf_set(_self, PACKET_LENGTH, 0);
+    
+    return AAOS_OK;
+}
+
+static int
+PipelineTestServer_accept(void *_self, void **client)
+{
+    int cfd;
+    
+    if ((cfd = rpc_server_accept_fd(_self, TCPSERVER_OPTION_TCP)) < 0) {
+        *client = NULL;
+        return AAOS_ERROR;
+    }
+    if ((*client = new(test_rpc_class, cfd)) == NULL) {
+        Close(cfd);
+        return AAOS_ERROR;
+    }
+    
+    return AAOS_OK;
+}
+
+static void
+serve(void)
+{
+    void *server;
+    
+    test_rpc_class = new(RPCClass(), "PipelineTestRPC", RPC(), sizeof(struct RPC),
+                         rpc_execute, "execute", PipelineTestRPC_execute,
+                         (void *) 0);
+    test_server_class = new(RPCServerClass(), "PipelineTestServer", RPCServer(), sizeof(struct RPCServer),
+                            rpc_server_accept, "accept", PipelineTestServer_accept,
+                            (void *) 0);
+    server = new(test_server_class, RPC_PIPELINE_TEST_PORT);
+    tcp_server_set_option(server, TCPSERVER_OPTION_TCP);
+    rpc_server_start(server);
+    exit(EXIT_SUCCESS);
+}
+
+static void *
+connect_pipelined(void)
+{
+    void *client, *rpc = NULL;
+    size_t i;
+    
+    client = new(RPCClient(), "127.0.0.1", RPC_PIPELINE_TEST_PORT);
+    for (i = 0; i < RPC_PIPELINE_TEST_CONNECT_WAIT; i++) {
+        if (rpc_client_connect(client, &rpc) == AAOS_OK) {
+            break;
+        }
+        Nanosleep(0.01);
+    }
+    delete(client);
+    if (rpc != NULL && rpc_pipeline(rpc) != AAOS_OK) {
+        delete(rpc);
+        rpc = NULL;
+    }
+    
+    return rpc;
+}
+
+static void
+request(void *rpc, uint32_t delay, uint32_t tag)
+{
+    protobuf_set(rpc, PACKET_PROTOCOL, RPC_PIPELINE_TEST_PROTOCOL);
+    protobuf_set(rpc, PACKET_COMMAND, 1);
+    protobuf_set(rpc, PACKET_U32F0, delay);
+    protobuf_set(rpc, PACKET_U32F1, tag);
+    protobuf_set(rpc, PACKET_LENGTH, 0);
+}
+
+static void
+completion(void *rpc, uint32_t id, int result, void *arg)
+{
+    struct PipelineTestCall *call = (struct PipelineTestCall *) arg;
+    
+    call->result = result;
+    protobuf_get(rpc, PACKET_U32F1, &call->tag);
+    call->order = (*call->n_done)++;
+}
+
+static double
+elapsed(const struct timespec *tp0, const struct timespec *tp1)
+{
+    return (tp1->tv_sec - tp0->tv_sec) + (tp1->tv_nsec - tp0->tv_nsec) / 1000000000.;
+}
+
+/*
+ * The later a call is sent, the sooner it finishes, so the replies arrive in reverse.
+ */
+static void *
+test_out_of_order(void *arg)
+{
+    struct PipelineTestCall calls[RPC_PIPELINE_TEST_CALLS];
+    struct timespec tp0, tp1;
+    size_t i, n_done = 0;
+    void *rpc;
+    int *ret = (int *) arg;
+    
+    *ret = 0;
+    if ((rpc = connect_pipelined()) == NULL) {
+        fprintf(stderr, "`%s` failed at line %d.\n", __func__, __LINE__);
+        *ret = -1;
+        return NULL;
+    }
+    Clock_gettime(CLOCK_MONOTONIC, &tp0);
+    for (i = 0; i < RPC_PIPELINE_TEST_CALLS; i++) {
+        calls[i].tag = 0;
+        calls[i].result = -1;
+        calls[i].n_done = &n_done;
+        request(rpc, (uint32_t) (RPC_PIPELINE_TEST_CALLS - i) * RPC_PIPELINE_TEST_STEP, (uint32_t) i + 1);
+        if (rpc_call_async(rpc, completion, &calls[i], NULL) != AAOS_OK) {
+            fprintf(stderr, "`%s` failed at line %d.\n", __func__, __LINE__);
+            *ret = -1;
+        }
+    }
+    if (rpc_wait(rpc, 0) != AAOS_OK) {
+        fprintf(stderr, "`%s` failed at line %d.\n", __func__, __LINE__);
+        *ret = -1;
+    }
+    Clock_gettime(CLOCK_MONOTONIC, &tp1);
+    for (i = 0; i < RPC_PIPELINE_TEST_CALLS; i++) {
+        if (calls[i].result != AAOS_OK || calls[i].tag != i + 1 || calls[i].order != RPC_PIPELINE_TEST_CALLS - 1 - i) {
+            fprintf(stderr, "`%s` failed at line %d: call %zu, result %d, tag %u, order %zu.\n", __func__, __LINE__, i, calls[i].result, calls[i].tag, calls[i].order);
+            *ret = -1;
+        }
+    }
+    /*
+     * Executed one after another, the calls would take 1.8 seconds.
+     */
+    if (elapsed(&tp0, &tp1) > 2. * RPC_PIPELINE_TEST_CALLS * RPC_PIPELINE_TEST_STEP / 1000.) {
+        fprintf(stderr, "`%s` failed at line %d: %.3f seconds.\n", __func__, __LINE__, elapsed(&tp0, &tp1));
+        *ret = -1;
+    }
+    delete(rpc);
+    
+    return NULL;
+}
+
+/*
+ * A reply read while waiting for another call is kept until it is waited for.
+ */
+static int
+test_wait(void)
+{
+    uint32_t id1, id2, tag;
+    void *rpc;
+    int ret = 0;
+    
+    if ((rpc = connect_pipelined()) == NULL) {
+        fprintf(stderr, "`%s` failed at line %d.\n", __func__, __LINE__);
+        return -1;
+    }
+    request(rpc, 0, 1);
+    rpc_call_async(rpc, NULL, NULL, &id1);
+    request(rpc, RPC_PIPELINE_TEST_STEP, 2);
+    rpc_call_async(rpc, NULL, NULL, &id2);
+    if (rpc_wait(rpc, id2) != AAOS_OK || (protobuf_get(rpc, PACKET_U32F1, &tag), tag != 2)) {
+        fprintf(stderr, "`%s` failed at line %d.\n", __func__, __LINE__);
+        ret = -1;
+    }
+    if (rpc_wait(rpc, id1) != AAOS_OK || (protobuf_get(rpc, PACKET_U32F1, &tag), tag != 1)) {
+        fprintf(stderr, "`%s` failed at line %d.\n", __func__, __LINE__);
+        ret = -1;
+    }
+    if (rpc_wait(rpc, id1) != -1 * AAOS_ENOTFOUND) {
+        fprintf(stderr, "`%s` failed at line %d.\n", __func__, __LINE__);
+        ret = -1;
+    }
+    /*
+     * rpc_call on a pipelined connection.
+     */
+    request(rpc, 0, 3);
+    if (rpc_call(rpc) != AAOS_OK || (protobuf_get(rpc, PACKET_U32F1, &tag), tag != 3)) {
+        fprintf(stderr, "`%s` failed at line %d.\n", __func__, __LINE__);
+        ret = -1;
+    }
+    delete(rpc);
+    
+    return ret;
+}
+
+/*
+ * Calls beyond RPC_PIPELINE_MAX_IN_FLIGHT wait for a call in flight to be answered,
+ * so that all are executed, in two rounds.
+ */
+static int
+test_busy(void)
+{
+    struct PipelineTestCall calls[RPC_PIPELINE_MAX_IN_FLIGHT + 8];
+    struct timespec tp0, tp1;
+    size_t i, n = sizeof(calls) / sizeof(calls[0]), n_done = 0, n_ok = 0;
+    double delay = 10. * RPC_PIPELINE_TEST_STEP / 1000.;
+    void *rpc;
+    int ret = 0;
+    
+    if ((rpc = connect_pipelined()) == NULL) {
+        fprintf(stderr, "`%s` failed at line %d.\n", __func__, __LINE__);
+        return -1;
+    }
+    Clock_gettime(CLOCK_MONOTONIC, &tp0);
+    for (i = 0; i < n; i++) {
+        calls[i].result = -1;
+        calls[i].n_done = &n_done;
+        request(rpc, 10 * RPC_PIPELINE_TEST_STEP, (uint32_t) i + 1);
+        rpc_call_async(rpc, completion, &calls[i], NULL);
+    }
+    rpc_wait(rpc, 0);
+    Clock_gettime(CLOCK_MONOTONIC, &tp1);
+    for (i = 0; i < n; i++) {
+        if (calls[i].result == AAOS_OK) {
+            n_ok++;
+        }
+    }
+    printf("busy     %zu call(s) executed in %.3f seconds\n", n_ok, elapsed(&tp0, &tp1));
+    if (n_ok != n || elapsed(&tp0, &tp1) < 1.9 * delay || elapsed(&tp0, &tp1) > 4. * delay) {
+        fprintf(stderr, "`%s` failed at line %d.\n", __func__, __LINE__);
+        ret = -1;
+    }
+    delete(rpc);
+    
+    return ret;
+}
+
+static int
+test_concurrent(void)
+{
+    pthread_t tids[RPC_PIPELINE_TEST_CLIENTS];
+    int results[RPC_PIPELINE_TEST_CLIENTS];
+    size_t i;
+    int ret = 0;
+    
+    for (i = 0; i < RPC_PIPELINE_TEST_CLIENTS; i++) {
+        Pthread_create(&tids[i], NULL, test_out_of_order, &results[i]);
+    }
+    for (i = 0; i < RPC_PIPELINE_TEST_CLIENTS; i++) {
+        Pthread_join(tids[i], NULL);
+        if (results[i] != 0) {
+            ret = -1;
+        }
+    }
+    printf("pipeline %d client(s) with %d call(s) in flight each\n", RPC_PIPELINE_TEST_CLIENTS, RPC_PIPELINE_TEST_CALLS);
+    
+    return ret;
+}
+
+int
+main(int argc, char *argv[])
+{
+    pid_t pid;
+    int ret = 0;
+    
+    if ((pid = fork()) < 0) {
+        return EXIT_FAILURE;
+    } else if (pid == 0) {
+        serve();
+    }
+    
+    if (test_concurrent() != 0) {
+        ret = -1;
+    }
+    if (test_wait() != 0) {
+        ret = -1;
+    }
+    if (test_busy() != 0) {
+        ret = -1;
+    }
+    
+    kill(pid, SIGTERM);
+    waitpid(pid, NULL, 0);
+    
+    return ret == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
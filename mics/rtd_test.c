@@ -0,0 +1,138 @@
+//
+//  rtd_test.c
+//  AAOS
+//
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "def.h"
+#include "rtd.h"
+
+#ifdef __USE_GSL__
+#include <gsl/gsl_errno.h>
+#include <gsl/gsl_spline.h>
+#endif
+
+/*
+ * Check the precomputed RTD tables against the exact inversion of Callendar-Van Dusen equation,
+ * and, when GSL is available, against a cubic spline through the PT100 resistance at every degree
+ * from RTD_T_MIN to RTD_T_MAX, which is how PT100 sensors were converted before.
+ */
+
+#define RTD_TEST_SAMPLE         100000
+#define RTD_TEST_SPLINE_LIMIT   1e-4
+
+static int
+test_table(const char *name, const struct RTDTable *table)
+{
+    double r, t, e, max_e = 0.;
+    size_t i;
+    
+    if (table->n < 2) {
+        fprintf(stderr, "`%s` failed at line %d.\n", __func__, __LINE__);
+        return -1;
+    }
+    for (i = 0; i <= RTD_TEST_SAMPLE; i++) {
+        r = table->r_min + (table->r_max - table->r_min) * i / RTD_TEST_SAMPLE;
+        t = rtd_cvd_r2t(table->r0, table->a, table->b, table->c, r);
+        e = fabs(rtd_r2t(table, r) - t);
+        if (e > max_e) {
+            max_e = e;
+        }
+    }
+    printf("%-8s %zu nodes, %.3f .. %.3f ohm, bound %.3e, measured %.3e\n", name, table->n, table->r_min, table->r_max, table->bound, max_e);
+    if (max_e > table->bound * 1.01 + 1e-12) {
+        fprintf(stderr, "`%s` failed at line %d: %s exceeds its bound.\n", __func__, __LINE__, name);
+        return -1;
+    }
+    if (rtd_r2t(table, table->r_min - 1.) != RTD_INVALID || rtd_r2t(table, table->r_max + 1.) != RTD_INVALID || rtd_r2t(table, NAN) != RTD_INVALID) {
+        fprintf(stderr, "`%s` failed at line %d: %s accepts out of range resistance.\n", __func__, __LINE__, name);
+        return -1;
+    }
+    if (fabs(rtd_r2t(table, rtd_t2r(table, 0.))) > 1e-6 || fabs(rtd_r2t(table, rtd_t2r(table, 100.)) - 100.) > 1e-6) {
+        fprintf(stderr, "`%s` failed at line %d: %s fails at fixed points.\n", __func__, __LINE__, name);
+        return -1;
+    }
+    
+    return 0;
+}
+
+#ifdef __USE_GSL__
+static int
+test_spline(void)
+{
+    size_t n = (size_t) (RTD_T_MAX - RTD_T_MIN) + 1, i;
+    double *resistance, *temperature;
+    gsl_interp_accel *acc;
+    gsl_spline *spline;
+    double r, t, e, max_e = 0., max_e_spline = 0.;
+    int ret = 0;
+    
+    resistance = (double *) malloc(sizeof(double) * n);
+    temperature = (double *) malloc(sizeof(double) * n);
+    for (i = 0; i < n; i++) {
+        temperature[i] = RTD_T_MIN + i;
+        resistance[i] = rtd_t2r(rtd_pt100(), temperature[i]);
+    }
+    
+    gsl_set_error_handler_off();
+    acc = gsl_interp_accel_alloc();
+    spline = gsl_spline_alloc(gsl_interp_cspline, n);
+    gsl_spline_init(spline, resistance, temperature, n);
+    
+    for (i = 0; i <= RTD_TEST_SAMPLE; i++) {
+        r = resistance[0] + (resistance[n - 1] - resistance[0]) * i / RTD_TEST_SAMPLE;
+        if (gsl_spline_eval_e(spline, r, acc, &t) != GSL_SUCCESS) {
+            continue;
+        }
+        e = fabs(rtd_r2t(rtd_pt100(), r) - t);
+        if (e > max_e) {
+            max_e = e;
+        }
+        e = fabs(rtd_cvd_r2t(100., RTD_IEC60751_A, RTD_IEC60751_B, RTD_IEC60751_C, r) - t);
+        if (e > max_e_spline) {
+            max_e_spline = e;
+        }
+    }
+    printf("spline   %zu nodes, %.3f .. %.3f ohm, error %.3e, difference %.3e\n", n, resistance[0], resistance[n - 1], max_e_spline, max_e);
+    if (max_e > RTD_TEST_SPLINE_LIMIT || rtd_pt100()->bound > max_e_spline) {
+        fprintf(stderr, "`%s` failed at line %d.\n", __func__, __LINE__);
+        ret = -1;
+    }
+    
+    gsl_spline_free(spline);
+    gsl_interp_accel_free(acc);
+    free(resistance);
+    free(temperature);
+    
+    return ret;
+}
+#endif
+
+int
+main(int argc, char *argv[])
+{
+    struct RTDTable table;
+    int ret = 0;
+    
+    ret |= test_table("PT100", rtd_pt100());
+    ret |= test_table("PT1000", rtd_pt1000());
+    if (rtd_table_init(&table, 100., RTD_IEC60751_A, RTD_IEC60751_B, RTD_IEC60751_C, RTD_T_MIN, RTD_T_MAX, RTD_TABLE_SIZE, RTD_INTERPOLATION_LINEAR) != AAOS_OK) {
+        fprintf(stderr, "`%s` failed at line %d.\n", __func__, __LINE__);
+        ret = -1;
+    } else {
+        ret |= test_table("linear", &table);
+        rtd_table_destroy(&table);
+    }
+#ifdef __USE_GSL__
+    ret |= test_spline();
+#endif
+    
+    return ret == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,188 @@
+//
+//  shm_ring_test.c
+//  AAOS
+//
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+
+#include "def.h"
+#include "object.h"
+#include "net.h"
+#include "net_r.h"
+#include "wrapper.h"
+
+/*
+ * Exercise the shared-memory rings of TCPSocket over a socketpair.
+ * A transfer several times the ring size must arrive intact across the wrap-around,
+ * and indices left inconsistent by the peer must be refused instead of being followed
+ * outside of the ring.
+ */
+
+#define SHM_RING_TEST_SIZE      4096
+#define SHM_RING_TEST_LENGTH    (3 * SHM_RING_TEST_SIZE + 123)
+
+struct ShmRingTestWriter {
+    void *socket;
+    const unsigned char *buffer;
+    size_t length;
+    int ret;
+};
+
+static void *
+writer_thr(void *arg)
+{
+    struct ShmRingTestWriter *writer = (struct ShmRingTestWriter *) arg;
+    size_t i;
+    
+    /*
+     * Odd-sized pieces, so that the writes do not line up with the ring.
+     */
+    for (i = 0; i < writer->length; i += 1000) {
+        if ((writer->ret = tcp_socket_write(writer->socket, writer->buffer + i, writer->length - i < 1000 ? writer->length - i : 1000, NULL)) != AAOS_OK) {
+            break;
+        }
+    }
+    
+    return NULL;
+}
+
+static int
+open_pair(void **client, void **server)
+{
+    int sv[2];
+    char message[8] = "shmring", buf[8];
+    
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) < 0) {
+        return -1;
+    }
+    *client = new(TCPSocket(), sv[0]);
+    *server = new(TCPSocket(), sv[1]);
+    if (tcp_socket_shm_offer(*server, SHM_RING_TEST_SIZE, message, sizeof(message)) != AAOS_OK || tcp_socket_shm_accept(*client, buf, sizeof(buf)) != AAOS_OK || memcmp(message, buf, sizeof(buf)) != 0) {
+        delete(*client);
+        delete(*server);
+        return -1;
+    }
+    
+    return 0;
+}
+
+static int
+test_transfer(void)
+{
+    void *client, *server;
+    unsigned char *sent, *received;
+    struct ShmRingTestWriter writer;
+    pthread_t tid;
+    size_t i, n;
+    int ret = 0;
+    
+    if (open_pair(&client, &server) != 0) {
+        fprintf(stderr, "`%s` failed at line %d.\n", __func__, __LINE__);
+        return -1;
+    }
+    sent = (unsigned char *) Malloc(SHM_RING_TEST_LENGTH);
+    received = (unsigned char *) Malloc(SHM_RING_TEST_LENGTH);
+    for (i = 0; i < SHM_RING_TEST_LENGTH; i++) {
+        sent[i] = (unsigned char) (i * 131 + 7);
+    }
+    writer.socket = server;
+    writer.buffer = sent;
+    writer.length = SHM_RING_TEST_LENGTH;
+    writer.ret = AAOS_OK;
+    Pthread_create(&tid, NULL, writer_thr, &writer);
+    if (tcp_socket_read(client, received, SHM_RING_TEST_LENGTH, &n) != AAOS_OK || n != SHM_RING_TEST_LENGTH) {
+        fprintf(stderr, "`%s` failed at line %d.\n", __func__, __LINE__);
+        ret = -1;
+    }
+    Pthread_join(tid, NULL);
+    if (ret == 0 && (writer.ret != AAOS_OK || memcmp(sent, received, SHM_RING_TEST_LENGTH) != 0)) {
+        fprintf(stderr, "`%s` failed at line %d.\n", __func__, __LINE__);
+        ret = -1;
+    }
+    if (ret == 0) {
+        printf("transfer %d bytes through a %d-byte ring\n", SHM_RING_TEST_LENGTH, SHM_RING_TEST_SIZE);
+    }
+    free(sent);
+    free(received);
+    delete(client);
+    delete(server);
+    
+    return ret;
+}
+
+/*
+ * The server side plays the hostile peer, and moves the indices of the ring the client
+ * reads from or writes to.
+ */
+static int
+test_hostile(bool on_read)
+{
+    void *client, *server;
+    struct TCPSocketSHMHeader *header;
+    char buf[SHM_RING_TEST_SIZE];
+    size_t n;
+    int ret = 0;
+    
+    if (open_pair(&client, &server) != 0) {
+        fprintf(stderr, "`%s` failed at line %d.\n", __func__, __LINE__);
+        return -1;
+    }
+    header = ((struct TCPSocket *) server)->shm->header;
+    memset(buf, 'x', sizeof(buf));
+    if (on_read) {
+        /*
+         * Claim more data than the ring can hold, the client must not copy it out.
+         */
+        header->ring[1].head = header->ring[1].tail + 2 * SHM_RING_TEST_SIZE;
+        ret = tcp_socket_read(client, buf, sizeof(buf), &n);
+    } else {
+        /*
+         * Consume beyond what was produced, the free space would underflow.
+         */
+        header->ring[0].tail = header->ring[0].head + 1;
+        ret = tcp_socket_write(client, buf, sizeof(buf), &n);
+    }
+    if (ret != AAOS_EBADMSG || n != 0 || tcp_socket_shm_enabled(client)) {
+        fprintf(stderr, "`%s` failed at line %d: %s returns %d.\n", __func__, __LINE__, on_read ? "read" : "write", ret);
+        ret = -1;
+    } else if ((ret = tcp_socket_read(server, buf, 1, &n)) != AAOS_ECLOSED && ret != AAOS_EBADMSG) {
+        /*
+         * The client hangs up, and the peer must see it, unless it trips over the indices it has moved itself.
+         */
+        fprintf(stderr, "`%s` failed at line %d.\n", __func__, __LINE__);
+        ret = -1;
+    } else {
+        printf("hostile %-5s refused\n", on_read ? "read" : "write");
+        ret = 0;
+    }
+    delete(client);
+    delete(server);
+    
+    return ret;
+}
+
+int
+main(int argc, char *argv[])
+{
+    int ret = 0;
+    
+    if (test_transfer() != 0) {
+        ret = -1;
+    }
+    if (test_hostile(true) != 0) {
+        ret = -1;
+    }
+    if (test_hostile(false) != 0) {
+        ret = -1;
+    }
+    
+    return ret == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
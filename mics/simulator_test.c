@@ -0,0 +1,309 @@
+//
+//  simulator_test.c
+//  AAOS
+//
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "def.h"
+#include "dome.h"
+#include "simulator.h"
+#include "telescope.h"
+#include "telescope_def.h"
+#include "wrapper.h"
+
+/*
+ * Check the jerk limited profile against its limits, the fault draws, the compressed clock,
+ * and run the virtual devices on a compressed night, counting the slews done per hour.
+ */
+
+#define SIMULATOR_TEST_LATITUDE     40.393
+#define SIMULATOR_TEST_LONGITUDE    117.575
+#define SIMULATOR_TEST_DRAW         100000
+#define SIMULATOR_TEST_TIME_SCALE   600.
+#define SIMULATOR_TEST_NIGHT        1800.
+
+static double
+realtime(void)
+{
+    struct timespec tp;
+    
+    Clock_gettime(CLOCK_MONOTONIC, &tp);
+    
+    return tp.tv_sec + tp.tv_nsec / 1000000000.;
+}
+
+/*
+ * Samples a move, and checks it ends on time, at distance, without exceeding speed, acceleration or jerk.
+ */
+static int
+check_profile(const struct SimulatorAxis *axis, double speed, double distance, double *duration, double *peak)
+{
+    double dt = 0.001, t, s0, s1, s2, s3, v, a, j, v_max = 0., a_max = 0., j_max = 0.;
+    
+    *duration = simulator_axis_duration(axis, speed, distance);
+    for (t = 0.; t < *duration - axis->settle; t += dt) {
+        s0 = simulator_axis_travel(axis, speed, distance, t);
+        s1 = simulator_axis_travel(axis, speed, distance, t + dt);
+        s2 = simulator_axis_travel(axis, speed, distance, t + 2. * dt);
+        s3 = simulator_axis_travel(axis, speed, distance, t + 3. * dt);
+        if (fabs(s1) < fabs(s0) - 1e-12) {
+            fprintf(stderr, "`%s` failed at line %d: backward at %f.\n", __func__, __LINE__, t);
+            return -1;
+        }
+        v = (s1 - s0) / dt;
+        a = (s2 - 2. * s1 + s0) / (dt * dt);
+        j = (s3 - 3. * s2 + 3. * s1 - s0) / (dt * dt * dt);
+        v_max = fmax(v_max, fabs(v));
+        a_max = fmax(a_max, fabs(a));
+        j_max = fmax(j_max, fabs(j));
+    }
+    *peak = v_max;
+    if (fabs(simulator_axis_travel(axis, speed, distance, *duration - axis->settle) - distance) > 1e-9 || v_max > speed * 1.001 ||
+        (axis->acceleration > 0. && a_max > axis->acceleration * 1.01) || (axis->jerk > 0. && axis->acceleration > 0. && j_max > axis->jerk * 1.5)) {
+        fprintf(stderr, "`%s` failed at line %d: speed %.4f, acceleration %.4f, jerk %.4f.\n", __func__, __LINE__, v_max, a_max, j_max);
+        return -1;
+    }
+    
+    return 0;
+}
+
+static int
+test_profile(void)
+{
+    struct SimulatorAxis axis;
+    double duration, peak;
+    
+    memset(&axis, '\0', sizeof(struct SimulatorAxis));
+    axis.acceleration = 1.;
+    axis.jerk = 2.;
+    axis.settle = 3.;
+    
+    /*
+     * A long move cruises at speed, and the ramps cost speed / acceleration + acceleration / jerk.
+     */
+    if (check_profile(&axis, 5., -90., &duration, &peak) != 0) {
+        return -1;
+    }
+    printf("long     90 degree in %.3f s, peak %.3f degree/s\n", duration, peak);
+    if (fabs(duration - (90. / 5. + 5. / 1. + 1. / 2. + 3.)) > 1e-9) {
+        fprintf(stderr, "`%s` failed at line %d.\n", __func__, __LINE__);
+        return -1;
+    }
+    
+    /*
+     * A short move never reaches speed.
+     */
+    if (check_profile(&axis, 5., 2., &duration, &peak) != 0) {
+        return -1;
+    }
+    printf("short    2 degree in %.3f s, peak %.3f degree/s\n", duration, peak);
+    if (peak > 2.) {
+        fprintf(stderr, "`%s` failed at line %d.\n", __func__, __LINE__);
+        return -1;
+    }
+    
+    /*
+     * Without limits, the axis moves at a constant speed.
+     */
+    memset(&axis, '\0', sizeof(struct SimulatorAxis));
+    if (simulator_axis_duration(&axis, 5., 90.) != 18. || simulator_axis_travel(&axis, 5., 90., 9.) != 45.) {
+        fprintf(stderr, "`%s` failed at line %d.\n", __func__, __LINE__);
+        return -1;
+    }
+    
+    axis.min = -30.;
+    axis.max = 90.;
+    if (simulator_axis_check(&axis, -45.) != AAOS_EINVAL || simulator_axis_check(&axis, 45.) != AAOS_OK) {
+        fprintf(stderr, "`%s` failed at line %d.\n", __func__, __LINE__);
+        return -1;
+    }
+    
+    return 0;
+}
+
+static int
+test_fault(void)
+{
+    struct SimulatorFault fault, fault2;
+    size_t i, n_stall = 0, n_timeout = 0, n_noise = 0;
+    int ret;
+    
+    memset(&fault, '\0', sizeof(struct SimulatorFault));
+    fault.stall = 0.1;
+    fault.timeout = 0.05;
+    fault.noise = 0.01;
+    fault.seed = 7;
+    fault2 = fault;
+    for (i = 0; i < SIMULATOR_TEST_DRAW; i++) {
+        if ((ret = simulator_fault_move(&fault)) == SIMULATOR_FAULT_STALL) {
+            n_stall++;
+        } else if (ret == SIMULATOR_FAULT_TIMEOUT) {
+            n_timeout++;
+        }
+        if (simulator_fault_noise(&fault)) {
+            n_noise++;
+        }
+    }
+    printf("fault    %zu stalls, %zu timeouts, %zu garbled replies in %d draws\n", n_stall, n_timeout, n_noise, SIMULATOR_TEST_DRAW);
+    if (fabs(n_stall - 0.1 * SIMULATOR_TEST_DRAW) > 0.01 * SIMULATOR_TEST_DRAW || fabs(n_timeout - 0.05 * SIMULATOR_TEST_DRAW) > 0.01 * SIMULATOR_TEST_DRAW ||
+        fabs(n_noise - 0.01 * SIMULATOR_TEST_DRAW) > 0.005 * SIMULATOR_TEST_DRAW) {
+        fprintf(stderr, "`%s` failed at line %d.\n", __func__, __LINE__);
+        return -1;
+    }
+    
+    /*
+     * The same seed draws the same faults.
+     */
+    for (i = 0; i < SIMULATOR_TEST_DRAW; i++) {
+        if ((ret = simulator_fault_move(&fault2)) == SIMULATOR_FAULT_STALL) {
+            n_stall--;
+        } else if (ret == SIMULATOR_FAULT_TIMEOUT) {
+            n_timeout--;
+        }
+        simulator_fault_noise(&fault2);
+    }
+    if (n_stall != 0 || n_timeout != 0 || fault.seed != fault2.seed) {
+        fprintf(stderr, "`%s` failed at line %d.\n", __func__, __LINE__);
+        return -1;
+    }
+    
+    return 0;
+}
+
+static int
+test_clock(void)
+{
+    double t0, t1, real0, real1, epoch;
+    struct timespec tp;
+    
+    simulator_set_time_scale(SIMULATOR_TEST_TIME_SCALE, 0.);
+    t0 = simulator_time();
+    real0 = realtime();
+    simulator_sleep(60.);
+    t1 = simulator_time();
+    real1 = realtime();
+    printf("clock    60 s simulated in %.3f s\n", real1 - real0);
+    if (t1 - t0 < 60. || t1 - t0 > 70. || real1 - real0 > 60. / SIMULATOR_TEST_TIME_SCALE + 0.05) {
+        fprintf(stderr, "`%s` failed at line %d.\n", __func__, __LINE__);
+        return -1;
+    }
+    
+    /*
+     * Another daemon given the same epoch, a second ago on the wall clock, reads the same clock.
+     */
+    Clock_gettime(CLOCK_REALTIME, &tp);
+    epoch = tp.tv_sec + tp.tv_nsec / 1000000000. - 1.;
+    simulator_set_time_scale(SIMULATOR_TEST_TIME_SCALE, epoch);
+    t1 = simulator_time();
+    Clock_gettime(CLOCK_REALTIME, &tp);
+    if (fabs(t1 - epoch - SIMULATOR_TEST_TIME_SCALE * (tp.tv_sec + tp.tv_nsec / 1000000000. - epoch)) > 0.01 * SIMULATOR_TEST_TIME_SCALE) {
+        fprintf(stderr, "`%s` failed at line %d.\n", __func__, __LINE__);
+        return -1;
+    }
+    
+    return 0;
+}
+
+/*
+ * A telescope and a dome under faults, on the compressed clock.
+ */
+static int
+test_virtual(void)
+{
+    struct Simulator simulator;
+    void *telescope, *dome;
+    double t0, real0, ra, dec, position;
+    char buf[BUFSIZE];
+    size_t n_slew = 0, n_stall = 0, n_timeout = 0, n_other = 0;
+    int ret, status = 0;
+    
+    memset(&simulator, '\0', sizeof(struct Simulator));
+    simulator.x.acceleration = simulator.y.acceleration = 1.;
+    simulator.x.jerk = simulator.y.jerk = 2.;
+    simulator.x.settle = simulator.y.settle = 3.;
+    simulator.y.min = -30.;
+    simulator.y.max = 90.;
+    simulator.fault.stall = 0.05;
+    simulator.fault.timeout = 0.05;
+    simulator.fault.timeout_after = 30.;
+    simulator.fault.seed = 11;
+    telescope = new(VirtualTelescope(), "telescope", "longitude", SIMULATOR_TEST_LONGITUDE, "latitude", SIMULATOR_TEST_LATITUDE, "simulation", &simulator, '\0');
+    __telescope_power_on(telescope);
+    __telescope_init(telescope);
+    
+    if ((ret = __telescope_slew(telescope, 30., -45.)) != AAOS_EINVAL) {
+        fprintf(stderr, "`%s` failed at line %d: %d.\n", __func__, __LINE__, ret);
+        status = -1;
+    }
+    
+    t0 = simulator_time();
+    real0 = realtime();
+    srand(3);
+    while (simulator_time() - t0 < SIMULATOR_TEST_NIGHT) {
+        ra = rand() % 360;
+        dec = rand() % 90;
+        ret = __telescope_slew(telescope, ra, dec);
+        if (ret == AAOS_OK) {
+            n_slew++;
+        } else if (ret == AAOS_EDEVMAL) {
+            n_stall++;
+        } else if (ret == AAOS_ETIMEDOUT) {
+            n_timeout++;
+        } else {
+            n_other++;
+        }
+    }
+    printf("night    %.0f s simulated in %.2f s, %.1f slews per hour, %zu stalled, %zu timed out\n", simulator_time() - t0, realtime() - real0,
+           n_slew / ((simulator_time() - t0) / 3600.), n_stall, n_timeout);
+    if (n_slew == 0 || n_stall == 0 || n_timeout == 0 || n_other != 0) {
+        fprintf(stderr, "`%s` failed at line %d.\n", __func__, __LINE__);
+        status = -1;
+    }
+    delete(telescope);
+    
+    memset(&simulator, '\0', sizeof(struct Simulator));
+    simulator.y.acceleration = 0.01;
+    simulator.fault.stall = 1.;
+    simulator.fault.noise = 1.;
+    dome = new(VirtualDome(), "dome", "window_open_speed", 1. / 60., "window_close_speed", 1. / 60., "simulation", &simulator, '\0');
+    __dome_init(dome);
+    ret = __dome_open_window(dome);
+    __dome_get_window_position(dome, &position);
+    printf("dome     window stalled at %.3f: %d\n", position, ret);
+    if (ret != AAOS_EDEVMAL || position <= 0. || position >= 1. || __dome_status(dome, buf, sizeof(buf), NULL) != AAOS_EBADMSG) {
+        fprintf(stderr, "`%s` failed at line %d.\n", __func__, __LINE__);
+        status = -1;
+    }
+    delete(dome);
+    
+    return status;
+}
+
+int
+main(int argc, char *argv[])
+{
+    int ret = 0;
+    
+    if (test_profile() != 0) {
+        ret = -1;
+    }
+    if (test_fault() != 0) {
+        ret = -1;
+    }
+    if (test_clock() != 0) {
+        ret = -1;
+    }
+    if (test_virtual() != 0) {
+        ret = -1;
+    }
+    
+    return ret == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
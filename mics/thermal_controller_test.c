@@ -0,0 +1,285 @@
+//
+//  thermal_controller_test.c
+//  AAOS
+//
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "def.h"
+#include "thermal_controller.h"
+
+/*
+ * Run the thermal controllers against a simulated first order plus dead time plant,
+ * a heated enclosure at -20 degree Celsius, which a full duty warms by 30 degrees,
+ * with a time constant of half an hour, a dead time of one minute, and a sensor noise of 0.2 degree.
+ * The step response fit has to recover the plant. A PID controller, tuned by autotune
+ * and driving the heater by PWM, has to wear the relay less than an on/off control of a narrow band,
+ * which chatters on the noise: fewer switches, for an RMS within a quarter of the band's.
+ * It does not regulate tighter, the ripple of a PWM window costs what the band does.
+ */
+
+#define THERMAL_TEST_AMBIENT    -20.
+#define THERMAL_TEST_GAIN       30.
+#define THERMAL_TEST_TAU        1800.
+#define THERMAL_TEST_DEAD_TIME  60.
+#define THERMAL_TEST_DT         10.
+#define THERMAL_TEST_SETPOINT   0.
+#define THERMAL_TEST_SETTLE     (6. * 3600.)
+#define THERMAL_TEST_DURATION   (30. * 3600.)
+#define THERMAL_TEST_NOISE      0.2
+#define THERMAL_TEST_WINDOW     600.
+#define THERMAL_TEST_PERIOD     300.
+
+struct ThermalTestResult {
+    double rms;
+    double peak;
+    unsigned long n_switch;
+};
+
+static int
+test_fit(void)
+{
+    struct ThermalPlant plant;
+    struct ThermalStepModel model;
+    double temperature[400];
+    size_t i, k_step = 30;
+    int ret;
+    
+    /*
+     * The baseline is still drifting when the step comes.
+     */
+    thermal_plant_init(&plant, THERMAL_TEST_AMBIENT, THERMAL_TEST_GAIN, THERMAL_TEST_TAU, THERMAL_TEST_DEAD_TIME, THERMAL_TEST_DT);
+    for (i = 0; i < 60; i++) {
+        thermal_plant_step(&plant, 0.2);
+    }
+    for (i = 0; i < sizeof(temperature) / sizeof(double); i++) {
+        temperature[i] = plant.temperature;
+        thermal_plant_step(&plant, (i >= k_step) ? 0.8 : 0.2);
+    }
+    thermal_plant_destroy(&plant);
+    
+    /*
+     * Only a third of the way to the steady state.
+     */
+    if ((ret = thermal_step_response_fit(temperature, 80, k_step, THERMAL_TEST_DT, 0.6, &model)) != AAOS_OK) {
+        fprintf(stderr, "`%s` failed at line %d: %d.\n", __func__, __LINE__, ret);
+        return -1;
+    }
+    printf("fit      gain %.3f, tau %.1f s, dead time %.1f s, residual %.2e\n", model.gain, model.tau, model.dead_time, model.residual);
+    if (fabs(model.gain - THERMAL_TEST_GAIN) > 0.01 * THERMAL_TEST_GAIN || fabs(model.tau - THERMAL_TEST_TAU) > 0.01 * THERMAL_TEST_TAU ||
+        fabs(model.dead_time - THERMAL_TEST_DEAD_TIME) > THERMAL_TEST_DT / 2.) {
+        fprintf(stderr, "`%s` failed at line %d.\n", __func__, __LINE__);
+        return -1;
+    }
+    
+    return 0;
+}
+
+/*
+ * Gaussian noise of the sensor, from a fixed seed, so that every run is the same.
+ */
+static double
+gaussian(unsigned long *seed)
+{
+    double u1, u2;
+    
+    *seed = *seed * 6364136223846793005UL + 1442695040888963407UL;
+    u1 = ((*seed >> 11) + 1.) / 9007199254740993.;
+    *seed = *seed * 6364136223846793005UL + 1442695040888963407UL;
+    u2 = (*seed >> 11) / 9007199254740992.;
+    
+    return sqrt(-2. * log(u1)) * cos(2. * M_PI * u2);
+}
+
+static void
+simulate(struct ThermalController *controller, struct ThermalTestResult *result)
+{
+    struct ThermalPlant plant;
+    double t, e, sum = 0., low = HUGE_VAL, high = -HUGE_VAL;
+    unsigned long seed = 20261019;
+    bool state = false, on;
+    size_t n = 0;
+    
+    thermal_plant_init(&plant, THERMAL_TEST_AMBIENT, THERMAL_TEST_GAIN, THERMAL_TEST_TAU, THERMAL_TEST_DEAD_TIME, THERMAL_TEST_DT);
+    result->n_switch = 0;
+    for (t = 0.; t < THERMAL_TEST_DURATION; t += THERMAL_TEST_DT) {
+        /*
+         * A cold front after the first day.
+         */
+        if (t >= 24. * 3600.) {
+            plant.ambient = THERMAL_TEST_AMBIENT - 5.;
+        }
+        thermal_controller_update(controller, plant.temperature + THERMAL_TEST_NOISE * gaussian(&seed), t);
+        on = thermal_controller_switch(controller, t);
+        if (t >= THERMAL_TEST_SETTLE) {
+            e = plant.temperature - THERMAL_TEST_SETPOINT;
+            sum += e * e;
+            n++;
+            low = fmin(low, e);
+            high = fmax(high, e);
+            if (on != state) {
+                result->n_switch++;
+            }
+        }
+        state = on;
+        thermal_plant_step(&plant, on ? 1. : 0.);
+    }
+    thermal_plant_destroy(&plant);
+    
+    result->rms = sqrt(sum / n);
+    result->peak = fmax(fabs(low), fabs(high));
+}
+
+static int
+test_regulation(void)
+{
+    struct ThermalController controller;
+    struct ThermalTestResult wide, narrow, pid;
+    int ret;
+    
+    thermal_controller_init(&controller, THERMAL_CONTROLLER_HYSTERESIS, THERMAL_TEST_SETPOINT - 5., THERMAL_TEST_SETPOINT + 5.);
+    simulate(&controller, &wide);
+    thermal_controller_destroy(&controller);
+    printf("on/off   +-5.0    rms %.3f, peak %.3f, %lu switches\n", wide.rms, wide.peak, wide.n_switch);
+    
+    thermal_controller_init(&controller, THERMAL_CONTROLLER_HYSTERESIS, THERMAL_TEST_SETPOINT - 0.5, THERMAL_TEST_SETPOINT + 0.5);
+    simulate(&controller, &narrow);
+    thermal_controller_destroy(&controller);
+    printf("on/off   +-0.5    rms %.3f, peak %.3f, %lu switches\n", narrow.rms, narrow.peak, narrow.n_switch);
+    
+    /*
+     * Autotune from the cold plant, then PID by PWM.
+     */
+    thermal_controller_init(&controller, THERMAL_CONTROLLER_HYSTERESIS, THERMAL_TEST_SETPOINT - 5., THERMAL_TEST_SETPOINT + 5.);
+    controller.pwm.window = THERMAL_TEST_WINDOW;
+    controller.pwm.min_on = 2. * THERMAL_TEST_DT;
+    if ((ret = thermal_controller_autotune(&controller, 0., 1., 300., 4. * 3600., THERMAL_TEST_SETPOINT)) != AAOS_OK) {
+        fprintf(stderr, "`%s` failed at line %d: %d.\n", __func__, __LINE__, ret);
+        return -1;
+    }
+    simulate(&controller, &pid);
+    printf("autotune gain %.3f, tau %.1f s, dead time %.1f s, kp %.4f, ki %.3e\n", controller.autotune.model.gain, controller.autotune.model.tau,
+           controller.autotune.model.dead_time, controller.pid.kp, controller.pid.ki);
+    printf("pid/pwm  %4.0f s  rms %.3f, peak %.3f, %lu switches\n", THERMAL_TEST_WINDOW, pid.rms, pid.peak, pid.n_switch);
+    if (controller.autotune.state != THERMAL_AUTOTUNE_DONE || controller.type != THERMAL_CONTROLLER_PID) {
+        fprintf(stderr, "`%s` failed at line %d.\n", __func__, __LINE__);
+        thermal_controller_destroy(&controller);
+        return -1;
+    }
+    thermal_controller_destroy(&controller);
+    
+    /*
+     * The narrow band is the baseline. The claim is relay wear, the PID switches less,
+     * and gives up at most a quarter of the RMS for it; its peak after the cold front is higher.
+     */
+    printf("relay    pid %.1f, on/off %.1f switches per hour\n", pid.n_switch * 3600. / (THERMAL_TEST_DURATION - THERMAL_TEST_SETTLE),
+           narrow.n_switch * 3600. / (THERMAL_TEST_DURATION - THERMAL_TEST_SETTLE));
+    if (!(pid.n_switch < narrow.n_switch)) {
+        fprintf(stderr, "`%s` failed at line %d.\n", __func__, __LINE__);
+        return -1;
+    }
+    if (!(pid.rms < 1.25 * narrow.rms)) {
+        fprintf(stderr, "`%s` failed at line %d.\n", __func__, __LINE__);
+        return -1;
+    }
+    
+    return 0;
+}
+
+/*
+ * Sampled every THERMAL_TEST_PERIOD, half the window, the heater would be on for 0, 1/2 or 1 of a window;
+ * waking up at the next switch as well, it is on for the duty.
+ */
+static int
+test_pwm_edges(void)
+{
+    struct ThermalController controller;
+    double duty[] = {0.1, 0.3, 0.75}, t, next, on_time;
+    size_t i, n_step;
+    int ret = 0;
+    
+    for (i = 0; i < sizeof(duty) / sizeof(duty[0]); i++) {
+        thermal_controller_init(&controller, THERMAL_CONTROLLER_PID, -5., 5.);
+        controller.pwm.window = THERMAL_TEST_WINDOW;
+        controller.output = duty[i];
+        on_time = 0.;
+        n_step = 0;
+        for (t = 0.; t < 100. * THERMAL_TEST_WINDOW; t = next) {
+            bool on = thermal_controller_switch(&controller, t);
+            next = fmin(t + THERMAL_TEST_PERIOD, thermal_controller_next_switch(&controller, t));
+            if (on) {
+                on_time += next - t;
+            }
+            n_step++;
+        }
+        thermal_controller_destroy(&controller);
+        printf("pwm      duty %.2f, on %.4f, %.2f steps per window\n", duty[i], on_time / t, (double) n_step / 100.);
+        if (fabs(on_time / t - duty[i]) > 1e-6) {
+            fprintf(stderr, "`%s` failed at line %d.\n", __func__, __LINE__);
+            ret = -1;
+        }
+    }
+    
+    return ret;
+}
+
+/*
+ * A cold spell the heater cannot make up for saturates the output for hours;
+ * once it is over, the integral must not keep the heater on long past the setpoint.
+ */
+static int
+test_windup(void)
+{
+    struct ThermalController controller;
+    struct ThermalPlant plant;
+    double t, duty, high = -HUGE_VAL;
+    
+    thermal_plant_init(&plant, THERMAL_TEST_AMBIENT, THERMAL_TEST_GAIN, THERMAL_TEST_TAU, THERMAL_TEST_DEAD_TIME, THERMAL_TEST_DT);
+    thermal_controller_init(&controller, THERMAL_CONTROLLER_PID, -5., 5.);
+    thermal_controller_set_pid(&controller, THERMAL_TEST_SETPOINT, 0.1, 0.1 / 600., 0.);
+    for (t = 0.; t < 16. * 3600.; t += THERMAL_TEST_DT) {
+        plant.ambient = (t >= 4. * 3600. && t < 8. * 3600.) ? THERMAL_TEST_AMBIENT - 25. : THERMAL_TEST_AMBIENT;
+        duty = thermal_controller_update(&controller, plant.temperature, t);
+        if (t >= 8. * 3600. && plant.temperature - THERMAL_TEST_SETPOINT > high) {
+            high = plant.temperature - THERMAL_TEST_SETPOINT;
+        }
+        thermal_plant_step(&plant, duty);
+    }
+    thermal_plant_destroy(&plant);
+    thermal_controller_destroy(&controller);
+    
+    printf("windup   overshoot %.3f after 4 hours saturated\n", high);
+    if (high > 1.) {
+        fprintf(stderr, "`%s` failed at line %d.\n", __func__, __LINE__);
+        return -1;
+    }
+    
+    return 0;
+}
+
+int
+main(int argc, char *argv[])
+{
+    int ret = 0;
+    
+    if (test_fit() != 0) {
+        ret = -1;
+    }
+    if (test_regulation() != 0) {
+        ret = -1;
+    }
+    if (test_pwm_edges() != 0) {
+        ret = -1;
+    }
+    if (test_windup() != 0) {
+        ret = -1;
+    }
+    
+    return ret == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -9,6 +9,7 @@
 #include "def.h"
 #include "daemon.h"
 #include "aws.h"
+#include "aws_archive.h"
 #include "aws_def.h"
 #include "aws_rpc.h"
 #include "wrapper.h"
@@ -71,8 +72,13 @@ read_configuration(void)
         exit(EXIT_FAILURE);
     } else {
         const char *port;
+        long long max_packet = 0;
+        double buffer_idle_timeout = -1.;
         config_setting_lookup_string(setting, "port", &port);
         server = new(AWSServer(), port);
+        config_setting_lookup_int64(setting, "max_packet", &max_packet);
+        config_setting_lookup_float(setting, "buffer_idle_timeout", &buffer_idle_timeout);
+        protobuf_pool_configure(max_packet > 0 ? (size_t) max_packet : 0, buffer_idle_timeout);
     }
     
     setting = config_lookup(&cfg, "awses");
@@ -251,15 +257,52 @@ read_configuration(void)
                     }
                 }
             }
+            /*
+             * optional time-series archive, e.g.
+             * archive = { directory = "/opt/aaos/var/aws"; interval = 10.; };
+             */
+            config_setting_t *archive_setting;
+            if (awses[i] != NULL && (archive_setting = config_setting_get_member(aws_setting, "archive")) != NULL) {
+                const char *directory;
+                double interval;
+                if (config_setting_lookup_string(archive_setting, "directory", &directory) == CONFIG_TRUE) {
+                    if (config_setting_lookup_float(archive_setting, "interval", &interval) != CONFIG_TRUE) {
+                        interval = 60.;
+                    }
+                    __aws_set_archive(awses[i], new(AWSArchive(), directory, interval));
+                }
+            }
         }
         
     }
 }
 
+static void *
+archive_thr(void *arg)
+{
+    void *aws = arg;
+    double interval = aws_archive_get_interval(__aws_get_archive(aws));
+    
+    for (; ;) {
+        __aws_archive(aws);
+        Nanosleep(interval);
+    }
+    
+    return NULL;
+}
+
 static void
 init(void)
 {
+    size_t i;
+    pthread_t tid;
+    
     read_configuration();
+    for (i = 0; i < n_aws; i++) {
+        if (awses[i] != NULL && __aws_get_archive(awses[i]) != NULL) {
+            Pthread_create(&tid, NULL, archive_thr, awses[i]);
+        }
+    }
     rpc_server_start(server);
 }
 
@@ -12,6 +12,7 @@
 #include "detector_def.h"
 #include "detector.h"
 #include "detector_rpc.h"
+#include "simulator.h"
 #include "wrapper.h"
 
 #include <libconfig.h>
@@ -303,6 +304,10 @@ read_configuration(void)
     } else {
         const char *port = NULL, *path = NULL;
         int option = 0;
+        int threads = 0, max_connections = 0, max_per_peer = 0;
+        double timeout, idle_timeout = 0.;
+        long long max_packet = 0;
+        double buffer_idle_timeout = -1.;
         
         config_setting_lookup_string(setting, "port", &port);
         if (port == NULL) {
@@ -317,6 +322,29 @@ read_configuration(void)
         }
         config_setting_lookup_int(setting, "option", &option);
         tcp_server_set_option(server, option);
+        if (config_setting_lookup_int(setting, "threads", &threads) == CONFIG_TRUE && threads > 0) {
+            tcp_server_set_threads(server, (size_t) threads, 0);
+        }
+        if (config_setting_lookup_float(setting, "timeout", &timeout) == CONFIG_TRUE) {
+            tcp_server_set_timeout(server, timeout);
+        }
+        config_setting_lookup_int(setting, "max_connections", &max_connections);
+        config_setting_lookup_int(setting, "max_per_peer", &max_per_peer);
+        config_setting_lookup_float(setting, "idle_timeout", &idle_timeout);
+        tcp_server_set_limits(server, (size_t) max_connections, (size_t) max_per_peer, idle_timeout);
+        config_setting_lookup_int64(setting, "max_packet", &max_packet);
+        config_setting_lookup_float(setting, "buffer_idle_timeout", &buffer_idle_timeout);
+        protobuf_pool_configure(max_packet > 0 ? (size_t) max_packet : 0, buffer_idle_timeout);
+    }
+    
+    /*
+     * The clock of all the virtual detectors of the server.
+     */
+    if ((setting = config_lookup(&cfg, "simulation")) != NULL) {
+        double time_scale = 1., time_epoch = 0.;
+        config_setting_lookup_float(setting, "time_scale", &time_scale);
+        config_setting_lookup_float(setting, "time_epoch", &time_epoch);
+        simulator_set_time_scale(time_scale, time_epoch);
     }
     
     setting = config_lookup(&cfg, "detectors");
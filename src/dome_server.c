@@ -12,6 +12,7 @@
 #include "dome_def.h"
 #include "dome.h"
 #include "dome_rpc.h"
+#include "simulator.h"
 #include "wrapper.h"
 
 #include <libconfig.h>
@@ -57,6 +58,41 @@ read_daemon(void)
     }
 }
 
+/*
+ * Motion and faults of a virtual device, in its `simulation` group.
+ */
+static void
+read_simulation_axis(config_setting_t *setting, struct SimulatorAxis *axis)
+{
+    if (setting != NULL) {
+        config_setting_lookup_float(setting, "acceleration", &axis->acceleration);
+        config_setting_lookup_float(setting, "jerk", &axis->jerk);
+        config_setting_lookup_float(setting, "settle", &axis->settle);
+        config_setting_lookup_float(setting, "min", &axis->min);
+        config_setting_lookup_float(setting, "max", &axis->max);
+    }
+}
+
+static void
+read_simulation(config_setting_t *setting, struct Simulator *simulator)
+{
+    int seed;
+    
+    memset(simulator, '\0', sizeof(struct Simulator));
+    if ((setting = config_setting_lookup(setting, "simulation")) == NULL) {
+        return;
+    }
+    read_simulation_axis(config_setting_lookup(setting, "x"), &simulator->x);
+    read_simulation_axis(config_setting_lookup(setting, "y"), &simulator->y);
+    config_setting_lookup_float(setting, "stall", &simulator->fault.stall);
+    config_setting_lookup_float(setting, "timeout", &simulator->fault.timeout);
+    config_setting_lookup_float(setting, "noise", &simulator->fault.noise);
+    config_setting_lookup_float(setting, "timeout_after", &simulator->fault.timeout_after);
+    if (config_setting_lookup_int(setting, "seed", &seed) == CONFIG_TRUE) {
+        simulator->fault.seed = (unsigned int) seed;
+    }
+}
+
 static void
 read_configuration(void)
 {
@@ -70,6 +106,8 @@ read_configuration(void)
         server = new (DomeServer(), DOM_RPC_PORT);
     } else {
         const char *port = NULL, *path = NULL;
+        long long max_packet = 0;
+        double buffer_idle_timeout = -1.;
         config_setting_lookup_string(setting, "port", &port);
         config_setting_lookup_string(setting, "path", &path);
         if (port == NULL) {
@@ -80,6 +118,19 @@ read_configuration(void)
         if (path != NULL) {
             tcp_server_set_path(server, path);
         }
+        config_setting_lookup_int64(setting, "max_packet", &max_packet);
+        config_setting_lookup_float(setting, "buffer_idle_timeout", &buffer_idle_timeout);
+        protobuf_pool_configure(max_packet > 0 ? (size_t) max_packet : 0, buffer_idle_timeout);
+    }
+    
+    /*
+     * The clock of all the virtual devices of the server.
+     */
+    if ((setting = config_lookup(&cfg, "simulation")) != NULL) {
+        double time_scale = 1., time_epoch = 0.;
+        config_setting_lookup_float(setting, "time_scale", &time_scale);
+        config_setting_lookup_float(setting, "time_epoch", &time_epoch);
+        simulator_set_time_scale(time_scale, time_epoch);
     }
     
     setting = config_lookup(&cfg, "domes");
@@ -96,19 +147,34 @@ read_configuration(void)
         for (i = 0; i < n_dome; i++) {
             dome_setting = config_setting_get_elem(setting, (unsigned int) i);
             const char *name = NULL, *description = NULL, *type = NULL;
-            double window_open_speed = 1./60., window_close_speed = 1./60.;
+            double window_open_speed = 1./60., window_close_speed = 1./60., slew_speed = 0.;
+            double latitude = 0., longitude = 0., altitude = 0., radius = 0., mount_east = 0., mount_north = 0., mount_up = 0., mount_offset = 0.;
+            struct Simulator simulator;
             
             config_setting_lookup_string(dome_setting, "name", &name);
             config_setting_lookup_string(dome_setting, "type", &type);
             config_setting_lookup_string(dome_setting, "description", &description);
             config_setting_lookup_float(dome_setting, "window_open_speed", &window_open_speed);
             config_setting_lookup_float(dome_setting, "window_close_speed", &window_close_speed);
+            config_setting_lookup_float(dome_setting, "slew_speed", &slew_speed);
+            config_setting_lookup_float(dome_setting, "latitude", &latitude);
+            config_setting_lookup_float(dome_setting, "longitude", &longitude);
+            config_setting_lookup_float(dome_setting, "altitude", &altitude);
+            config_setting_lookup_float(dome_setting, "radius", &radius);
+            config_setting_lookup_float(dome_setting, "mount_east", &mount_east);
+            config_setting_lookup_float(dome_setting, "mount_north", &mount_north);
+            config_setting_lookup_float(dome_setting, "mount_up", &mount_up);
+            config_setting_lookup_float(dome_setting, "mount_offset", &mount_offset);
+            read_simulation(dome_setting, &simulator);
             if (type == NULL) {
                 domes[i] = NULL;
                 continue;
             }
             if (strcmp(type, "VIRTUAL") == 0) {
-                domes[i] = new(VirtualDome(), name, "description", description, "window_open_speed", window_open_speed, "window_close_speed", window_close_speed, '\0');
+                domes[i] = new(VirtualDome(), name, "description", description, "window_open_speed", window_open_speed, "window_close_speed", window_close_speed,
+                               "slew_speed", slew_speed, "latitude", latitude, "longitude", longitude, "altitude", altitude,
+                               "radius", radius, "mount_east", mount_east, "mount_north", mount_north, "mount_up", mount_up, "mount_offset", mount_offset,
+                               "simulation", &simulator, '\0');
             } else {
                 
             }
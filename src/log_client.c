@@ -0,0 +1,185 @@
+//
+//  log_client.c
+//  AAOS
+//
+
+#include "def.h"
+#include "log_def.h"
+#include "log_rpc.h"
+#include "rpc.h"
+#include "wrapper.h"
+
+static const char *facility;
+static unsigned int level = LOG_LEVEL_NOTICE;
+
+static const char *help_string = "\
+Usage:  log [options] COMMAND [PARAMETERS ... ]\n\
+        -f, --facility    <facility>, specify the facility\n\
+        -h, --help        print help doc and exit\n\
+        -l, --level       <level>, emerg, alert, crit, err, warn, notice, info or debug\n\
+        -p, --log         <address:[port]|path> address (and port), or Unix domain socket, of logd\n\
+Commands:\n\
+    submit\t\t<message>, write a record to the facility\n\
+    tail\t\tprint the records of the facility, or of all the facilities, as they are written\n\
+";
+
+static struct option longopts[] = {
+    {"facility",    required_argument,  NULL,       'f' },
+    {"help",        no_argument,        NULL,       'h' },
+    {"level",       required_argument,  NULL,       'l' },
+    {"log",         required_argument,  NULL,       'p' },
+    {"version",     no_argument,        NULL,       'v' },
+    { NULL,         0,                  NULL,       0 }
+};
+
+static const char *levels[] = {"emerg", "alert", "crit", "err", "warn", "notice", "info", "debug"};
+
+static void
+usage(void)
+{
+    fprintf(stderr, "%s", help_string);
+    exit(EXIT_FAILURE);
+}
+
+static unsigned int
+level_by_name(const char *name)
+{
+    size_t i;
+    
+    for (i = 0; i < sizeof(levels) / sizeof(levels[0]); i++) {
+        if (strcmp(name, levels[i]) == 0) {
+            return LOG_LEVEL_EMERG >> i;
+        }
+    }
+    fprintf(stderr, "Unknown level `%s`.\n", name);
+    exit(EXIT_FAILURE);
+}
+
+int
+main(int argc, char *argv[])
+{
+    int ch, ret;
+    char address[PATHSIZE], port[PORTSIZE], topic[PATHSIZE], *s;
+    void *client, *log_;
+    
+    snprintf(address, PATHSIZE, "localhost");
+    snprintf(port, PORTSIZE, LOG_RPC_PORT);
+    
+    while ((ch = getopt_long(argc, argv, "f:hl:p:v", longopts, NULL)) != -1) {
+        switch (ch) {
+            case 'f':
+                facility = optarg;
+                break;
+            case 'h':
+                usage();
+                break;
+            case 'l':
+                level = level_by_name(optarg);
+                break;
+            case 'p':
+                s = strrchr(optarg, ':');
+                if (s == NULL) { //input like "example.com" or "/opt/aaos/run/logd.sock"
+                    if (strlen(optarg) >= PATHSIZE) {
+                        fprintf(stderr, "Address is too long.\n");
+                        fprintf(stderr, "Exit...\n");
+                        exit(EXIT_FAILURE);
+                    }
+                    snprintf(address, PATHSIZE, "%s", optarg);
+                } else {
+                    if (s - optarg >= PATHSIZE || strlen(s + 1) >= PORTSIZE) {
+                        fprintf(stderr, "Address or port is too long.\n");
+                        fprintf(stderr, "Exit...\n");
+                        exit(EXIT_FAILURE);
+                    }
+                    if (s != optarg) { //input like localhost:8000
+                        memset(address, '\0', PATHSIZE);
+                        memcpy(address, optarg, s - optarg);
+                    }
+                    snprintf(port, PORTSIZE, "%s", s + 1);
+                }
+                break;
+            default:
+                usage();
+                break;
+        }
+    }
+    
+    argc -= optind;
+    argv += optind;
+    
+    if (argc == 0) {
+        usage();
+    }
+    
+    client = new(LogClient(), address, port);
+    if ((ret = rpc_client_connect(client, &log_)) != AAOS_OK) {
+        switch (ret) {
+            case AAOS_ECONNREFUSED:
+                fprintf(stderr, "Port `%s` on `%s` might not be listened.\n", port, address);
+                break;
+            case AAOS_ENETUNREACH:
+                fprintf(stderr, "Network is unreachable.\n");
+                break;
+            case AAOS_ETIMEDOUT:
+                fprintf(stderr, "Connecting is timeout.\n");
+                break;
+            default:
+            {
+                char buf[BUFSIZE];
+                strerror_r(errno, buf, BUFSIZE);
+                fprintf(stderr, "%s.\n", buf);
+            }
+                break;
+        }
+        exit(EXIT_FAILURE);
+    }
+    
+    if (strcmp(argv[0], "submit") == 0) {
+        if (argc < 2 || facility == NULL) {
+            usage();
+        }
+        if ((ret = log_get_index_by_facility(log_, facility)) != AAOS_OK) {
+            fprintf(stderr, "Facility `%s` is not found in the log server's configuration file.\n", facility);
+            exit(EXIT_FAILURE);
+        }
+        if ((ret = log_submit(log_, level, argv[1])) != AAOS_OK || (ret = log_flush(log_)) != AAOS_OK) {
+            fprintf(stderr, "`submit` failed: %d.\n", ret);
+            exit(EXIT_FAILURE);
+        }
+    } else if (strcmp(argv[0], "tail") == 0) {
+        const char *event_topic;
+        const void *event;
+        size_t size;
+        snprintf(topic, PATHSIZE, "log/%s", facility != NULL ? facility : "*");
+        if ((ret = rpc_subscribe(log_, topic)) != AAOS_OK) {
+            fprintf(stderr, "`tail` failed: %d.\n", ret);
+            exit(EXIT_FAILURE);
+        }
+        for (; ;) {
+            if ((ret = rpc_next_event(log_, -1., &event_topic, &event, &size)) == AAOS_OK) {
+                const char *line = event, *end = line + size, *next;
+                for (; line < end; line = next) {
+                    if ((next = memchr(line, '\n', end - line)) == NULL) {
+                        next = end;
+                    } else {
+                        next++;
+                    }
+                    if (facility == NULL) {
+                        printf("%s ", event_topic + strlen("log/"));
+                    }
+                    fwrite(line, 1, next - line, stdout);
+                }
+                fflush(stdout);
+            } else if (ret != AAOS_ETIMEDOUT) {
+                fprintf(stderr, "The log server is absent.\n");
+                break;
+            }
+        }
+    } else {
+        usage();
+    }
+    
+    delete(log_);
+    delete(client);
+    return 0;
+}
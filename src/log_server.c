@@ -0,0 +1,251 @@
+//
+//  log_server.c
+//  AAOS
+//
+
+#include "def.h"
+#include "daemon.h"
+#include "log.h"
+#include "log_def.h"
+#include "log_rpc.h"
+#include "wrapper.h"
+#include <libconfig.h>
+
+extern void **logs;
+extern size_t n_log;
+
+static void *d;
+static void *server;
+static const char *config_path = "/opt/aaos/etc/logd.cfg";
+static bool daemon_flag = true;
+static double flush_interval = LOG_FLUSH_INTERVAL;
+
+static struct option longopts[] = {
+    {"config-file", required_argument,  NULL,       'c' },
+    {"help",        no_argument,        NULL,       'h' },
+    {"version",     no_argument,        NULL,       'v' },
+    { NULL,         0,                  NULL,       0 }
+};
+
+static config_t cfg;
+
+static void
+usage(void)
+{
+    fprintf(stderr, "\t\t[-c|--config-file <config>] [-D] [start|stop|restart|reload]");
+    exit(EXIT_FAILURE);
+}
+
+static void
+read_daemon(void)
+{
+    config_setting_t *setting;
+        
+    setting = config_lookup(&cfg, "daemon");
+    if (setting != NULL) {
+        const char *name = NULL, *username = "aaos", *rootdir = "/opt/aaos", *lockfile = NULL;
+        int daemonized = 1;
+        config_setting_lookup_string(setting, "name", &name);
+        config_setting_lookup_string(setting, "rootdir", &rootdir);
+        config_setting_lookup_string(setting, "lockfile", &lockfile);
+        config_setting_lookup_string(setting, "username", &username);
+        config_setting_lookup_int(setting, "daemonized", &daemonized);
+        if (daemonized && daemon_flag) {
+            d = new(Daemon(), name, rootdir, lockfile, username, true);
+        } else {
+            d = new(Daemon(), name, rootdir, lockfile, username, false);
+        }
+    }
+}
+
+/*
+ * logs = ( { facility = "telescope"; directory = "/opt/aaos/log"; level = 255; max_size = 67108864; max_files = 8; }, ... );
+ */
+static void
+read_configuration(void)
+{
+    config_setting_t *setting;
+    size_t i;
+    
+    setting = config_lookup(&cfg, "server");
+    if (setting == NULL) {
+        server = new(LogServer(), LOG_RPC_PORT);
+    } else {
+        const char *port = NULL, *path = NULL;
+        int threads = 0, max_connections = 0, max_per_peer = 0;
+        double idle_timeout = 0.;
+        long long max_packet = 0;
+        double buffer_idle_timeout = -1.;
+        
+        config_setting_lookup_string(setting, "port", &port);
+        server = new(LogServer(), port != NULL ? port : LOG_RPC_PORT);
+        if (config_setting_lookup_string(setting, "path", &path) == CONFIG_TRUE) {
+            tcp_server_set_path(server, path);
+        }
+        if (config_setting_lookup_int(setting, "threads", &threads) == CONFIG_TRUE && threads > 0) {
+            tcp_server_set_threads(server, (size_t) threads, 0);
+        }
+        config_setting_lookup_int(setting, "max_connections", &max_connections);
+        config_setting_lookup_int(setting, "max_per_peer", &max_per_peer);
+        config_setting_lookup_float(setting, "idle_timeout", &idle_timeout);
+        tcp_server_set_limits(server, (size_t) max_connections, (size_t) max_per_peer, idle_timeout);
+        config_setting_lookup_float(setting, "flush_interval", &flush_interval);
+        config_setting_lookup_int64(setting, "max_packet", &max_packet);
+        config_setting_lookup_float(setting, "buffer_idle_timeout", &buffer_idle_timeout);
+        protobuf_pool_configure(max_packet > 0 ? (size_t) max_packet : 0, buffer_idle_timeout);
+    }
+    
+    setting = config_lookup(&cfg, "logs");
+    if (setting == NULL) {
+        fprintf(stderr, "`logs` section does not exist in configuration file.\n");
+        exit(EXIT_FAILURE);
+    }
+    n_log = config_setting_length(setting);
+    logs = (void **) Malloc(n_log * sizeof(void *));
+    if (logs == NULL) {
+        exit(EXIT_FAILURE);
+    }
+    memset(logs, '\0', n_log * sizeof(void *));
+    for (i = 0; i < n_log; i++) {
+        config_setting_t *log_setting = config_setting_get_elem(setting, (unsigned int) i);
+        const char *facility = NULL, *directory = "/opt/aaos/log";
+        int level = LOG_LEVEL_ALL, max_size = LOG_MAX_SIZE, max_files = LOG_MAX_FILES;
+        
+        if (config_setting_lookup_string(log_setting, "facility", &facility) != CONFIG_TRUE) {
+            fprintf(stderr, "Log %zu has no facility.\n", i + 1);
+            continue;
+        }
+        config_setting_lookup_string(log_setting, "directory", &directory);
+        config_setting_lookup_int(log_setting, "level", &level);
+        config_setting_lookup_int(log_setting, "max_size", &max_size);
+        config_setting_lookup_int(log_setting, "max_files", &max_files);
+        if ((logs[i] = new(__Log(), facility, directory, "level", (unsigned int) level, "flush_interval", flush_interval,
+                           "max_size", (size_t) max_size, "max_files", max_files, '\0')) == NULL) {
+            fprintf(stderr, "Cannot open the log of `%s` in `%s`.\n", facility, directory);
+        }
+    }
+}
+
+/*
+ * Writes out the records left in the buffers of quiet facilities.
+ */
+static void *
+flush_thr(void *arg)
+{
+    size_t i;
+    
+    for (; ;) {
+        Nanosleep(flush_interval);
+        for (i = 0; i < n_log; i++) {
+            if (logs[i] != NULL) {
+                __log_flush(logs[i]);
+            }
+        }
+    }
+    
+    return NULL;
+}
+
+static void
+init(void)
+{
+    pthread_t tid;
+    
+    read_configuration();
+    Pthread_create(&tid, NULL, flush_thr, NULL);
+    rpc_server_start(server);
+}
+
+static void
+destroy(void)
+{
+    size_t i;
+    
+    for (i = 0; i < n_log; i++) {
+        if (logs[i] != NULL) {
+            delete(logs[i]);
+        }
+    }
+    free(logs);
+    if (server != NULL) {
+        delete(server);
+    }
+    if (d != NULL) {
+        delete(d);
+    }
+}
+
+int
+main(int argc, char *argv[])
+{
+    int ch, ret;
+    
+    while ((ch = getopt_long(argc, argv, "c:Dv", longopts, NULL)) != -1) {
+        switch (ch) {
+            case 'c':
+                config_path = optarg;
+                break;
+            case 'D':
+                daemon_flag = false;
+                break;
+            default:
+                usage();
+                break;
+        }
+    }
+    
+    argc -= optind;
+    argv += optind;
+    
+    if ((ret = Access(config_path, F_OK)) < 0) {
+        if ((ret = Access("logd.cfg", F_OK)) == 0) {
+            config_path = "logd.cfg";
+        } else if ((ret = Access("etc/logd.cfg", F_OK)) == 0) {
+            config_path = "etc/logd.cfg";
+        } else if ((ret = Access("/usr/local/aaos/etc/logd.cfg", F_OK)) == 0) {
+            config_path = "/usr/local/aaos/etc/logd.cfg";
+        } else if ((ret = Access("/etc/aaos/logd.cfg", F_OK)) == 0) {
+            config_path = "/etc/aaos/logd.cfg";
+        } else {
+            fprintf(stderr, "configuration file does not exist.\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    
+    config_init(&cfg);
+    if(config_read_file(&cfg, config_path) == CONFIG_FALSE) {
+        fprintf(stderr, "fail to read configuration file.\n");
+        fprintf(stderr, "Exit...\n");
+        exit(EXIT_FAILURE);
+    }
+    
+    read_daemon();
+    if (argc == 0) {
+        daemon_start(d);
+        init();
+    } else {
+        if (strcmp(argv[0], "start") == 0) {
+            daemon_start(d);
+            init();
+        } else if (strcmp(argv[0], "restart") == 0) {
+            daemon_stop(d);
+            daemon_start(d);
+            init();
+        } else if (strcmp(argv[0], "reload") == 0) {
+            daemon_stop(d);
+            daemon_reload(d);
+            init();
+        } else if (strcmp(argv[0], "stop") == 0) {
+            daemon_stop(d);
+        } else {
+            fprintf(stderr, "Unknow argument.\n");
+            fprintf(stderr, "Exit...");
+            destroy();
+            exit(EXIT_FAILURE);
+        }
+    }
+    destroy();
+    config_destroy(&cfg);
+    
+    return 0;
+}
@@ -33,6 +33,7 @@ Commands:\n\
     on\t\tpower on a switch\n\
     raw\t\tsend a raw command to PDU\n\
     register\t\twait until PDU recovered or timed out\n\
+    sequence\t\t<sequence>, run a power sequence of PDU\n\
     status\t\tprint all the switches status of PDU\n\
     volcur\t\tprint the voltage and current of a switch\n\
     voltage\t\tprint the voltage of a switch\n\
@@ -239,6 +240,20 @@ main(int argc, char *argv[])
             } else {
                 fatal_handler(ret, "`get voltage` failed\n");
             }
+        } else if (strcmp(argv[0], "sequence") == 0) {
+            unsigned int step;
+            if (argc < 2) {
+                usage();
+            }
+            if ((ret = pdu_run_sequence(pdu, argv[1], &step)) == AAOS_OK) {
+                fprintf(stderr, "OK\n");
+            } else if (step != 0) {
+                fatal_handler(ret, "`sequence %s` failed at step %u\n", argv[1], step);
+            } else {
+                fatal_handler(ret, "`sequence %s` failed\n", argv[1]);
+            }
+            argc--;
+            argv++;
         } else if (strcmp(argv[0], "inspect") == 0) {
             if ((ret = device_inspect(pdu)) == AAOS_OK) {
                 if (pdu_name != NULL) {
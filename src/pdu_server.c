@@ -61,6 +61,52 @@ read_daemon(void)
     }
 }
 
+/*
+ * sequences = ( { name = "startup"; rollback = 1; steps = ( { switch = "mount"; action = "on"; delay = 2.; inrush = 1.; min_current = 0.1; timeout = 5.; }, ... ); }, ... );
+ */
+static void
+read_sequences(void *pdu, config_setting_t *setting)
+{
+    size_t i, j, n_sequence, n_step;
+    
+    n_sequence = config_setting_length(setting);
+    for (i = 0; i < n_sequence; i++) {
+        config_setting_t *sequence_setting = config_setting_get_elem(setting, (unsigned int) i), *steps_setting;
+        struct PDUSequenceStep *steps;
+        const char *name, *action;
+        int rollback = 0, ret;
+        
+        if (config_setting_lookup_string(sequence_setting, "name", &name) != CONFIG_TRUE || (steps_setting = config_setting_get_member(sequence_setting, "steps")) == NULL) {
+            fprintf(stderr, "Sequence %zu has no name or no step.\n", i + 1);
+            continue;
+        }
+        config_setting_lookup_int(sequence_setting, "rollback", &rollback);
+        n_step = config_setting_length(steps_setting);
+        steps = (struct PDUSequenceStep *) Malloc(sizeof(struct PDUSequenceStep) * (n_step + 1));
+        memset(steps, '\0', sizeof(struct PDUSequenceStep) * (n_step + 1));
+        for (j = 0; j < n_step; j++) {
+            config_setting_t *step_setting = config_setting_get_elem(steps_setting, (unsigned int) j);
+            config_setting_lookup_string(step_setting, "switch", &steps[j].name);
+            if (config_setting_lookup_string(step_setting, "action", &action) == CONFIG_TRUE) {
+                if (strcmp(action, "on") == 0) {
+                    steps[j].action = PDU_SEQUENCE_ON;
+                } else if (strcmp(action, "off") == 0) {
+                    steps[j].action = PDU_SEQUENCE_OFF;
+                }
+            }
+            config_setting_lookup_float(step_setting, "delay", &steps[j].delay);
+            config_setting_lookup_float(step_setting, "inrush", &steps[j].inrush);
+            config_setting_lookup_float(step_setting, "min_current", &steps[j].min_current);
+            config_setting_lookup_float(step_setting, "max_current", &steps[j].max_current);
+            config_setting_lookup_float(step_setting, "timeout", &steps[j].timeout);
+        }
+        if ((ret = __pdu_add_sequence(pdu, name, steps, n_step, rollback ? PDU_SEQUENCE_ROLLBACK : 0)) != AAOS_OK) {
+            fprintf(stderr, "Sequence `%s` is invalid: %d.\n", name, ret);
+        }
+        free(steps);
+    }
+}
+
 static void
 read_configuration(void)
 {
@@ -73,8 +119,13 @@ read_configuration(void)
         exit(EXIT_FAILURE);
     } else {
         const char *port;
+        long long max_packet = 0;
+        double buffer_idle_timeout = -1.;
         config_setting_lookup_string(setting, "port", &port);
         server = new(PDUServer(), port);
+        config_setting_lookup_int64(setting, "max_packet", &max_packet);
+        config_setting_lookup_float(setting, "buffer_idle_timeout", &buffer_idle_timeout);
+        protobuf_pool_configure(max_packet > 0 ? (size_t) max_packet : 0, buffer_idle_timeout);
     }
     
     setting = config_lookup(&cfg, "pdus");
@@ -93,6 +144,7 @@ read_configuration(void)
             config_setting_t *pdu_setting;
             pdu_setting = config_setting_get_elem(setting, (unsigned int) i);
             const char *name, *description, *type;
+            double status_interval;
             if (config_setting_lookup_string(pdu_setting, "name", &name) != CONFIG_TRUE) {
                 name = NULL;
             }
@@ -102,6 +154,9 @@ read_configuration(void)
             if (config_setting_lookup_string(pdu_setting, "type", &type) != CONFIG_TRUE) {
                 type = NULL;
             }
+            if (config_setting_lookup_float(pdu_setting, "status_interval", &status_interval) != CONFIG_TRUE) {
+                status_interval = PDU_STATUS_INTERVAL;
+            }
             size_t j, n_switches;
             config_setting_t *switches_setting;
             switches_setting = config_setting_get_member(pdu_setting, "switches");
@@ -127,7 +182,7 @@ read_configuration(void)
                 if (config_setting_lookup_string(serial_setting, "inspect2", &inspect2) != CONFIG_TRUE) {
                     serial2 = NULL;
                 }
-                pdus[i] = new(AAGPDU(), name, n_switches, "description", description, "type", type, '\0', address, port, serial1, inspect1, serial2, inspect2);
+                pdus[i] = new(AAGPDU(), name, n_switches, "description", description, "type", type, "status_interval", status_interval, '\0', address, port, serial1, inspect1, serial2, inspect2);
             } else {
                 fprintf(stderr, "Unsupported PDU type `%s`\n", type);
                 exit(EXIT_FAILURE);
@@ -158,15 +213,45 @@ read_configuration(void)
                 } else {
                     switch_set_channel(myswitch, (unsigned int) j + 1);
                 }
+                __pdu_set_switch(pdus[i], myswitch, j);
+            }
+            config_setting_t *sequences_setting;
+            if ((sequences_setting = config_setting_get_member(pdu_setting, "sequences")) != NULL) {
+                read_sequences(pdus[i], sequences_setting);
             }
         }
     }
 }
 
+/*
+ * Takes the snapshot of a PDU every status_interval seconds, all clients are answered from it.
+ */
+static void *
+status_thr(void *arg)
+{
+    void *pdu = arg;
+    double interval = __pdu_get_status_interval(pdu);
+    
+    for (; ;) {
+        __pdu_refresh_status(pdu);
+        Nanosleep(interval);
+    }
+    
+    return NULL;
+}
+
 static void
 init(void)
 {
     read_configuration();
+    size_t i;
+    pthread_t tid;
+    
+    for (i = 0; i < n_pdu; i++) {
+        if (pdus[i] != NULL && __pdu_get_status_interval(pdus[i]) > 0.) {
+            Pthread_create(&tid, NULL, status_thr, pdus[i]);
+        }
+    }
     
     rpc_server_start(server);
 }
@@ -13,6 +13,7 @@
 #include "scheduler_def.h"
 #include "scheduler.h"
 #include "scheduler_rpc.h"
+#include "simulator.h"
 #include "wrapper.h"
 #include <libconfig.h>
 
@@ -68,8 +69,23 @@ read_configuration(void)
         exit(EXIT_FAILURE);
     } else {
         const char *port;
+        long long max_packet = 0;
+        double buffer_idle_timeout = -1.;
         config_setting_lookup_string(setting, "port", &port);
         server = new (SchedulerServer(), port);
+        config_setting_lookup_int64(setting, "max_packet", &max_packet);
+        config_setting_lookup_float(setting, "buffer_idle_timeout", &buffer_idle_timeout);
+        protobuf_pool_configure(max_packet > 0 ? (size_t) max_packet : 0, buffer_idle_timeout);
+    }
+
+    /*
+     * The clock of the timestamps of the tasks, the same as of a simulated night.
+     */
+    if ((setting = config_lookup(&cfg, "simulation")) != NULL) {
+        double time_scale = 1., time_epoch = 0.;
+        config_setting_lookup_float(setting, "time_scale", &time_scale);
+        config_setting_lookup_float(setting, "time_epoch", &time_epoch);
+        simulator_set_time_scale(time_scale, time_epoch);
     }
 
     setting = config_lookup(&cfg, "scheduler");
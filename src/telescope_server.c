@@ -9,6 +9,7 @@
 #include "def.h"
 #include "daemon.h"
 #include "telescope.h"
+#include "simulator.h"
 #include "telescope_rpc.h"
 #include "wrapper.h"
 #include <libconfig.h>
@@ -65,6 +66,41 @@ read_daemon(void)
     }
 }
 
+/*
+ * Motion and faults of a virtual device, in its `simulation` group.
+ */
+static void
+read_simulation_axis(config_setting_t *setting, struct SimulatorAxis *axis)
+{
+    if (setting != NULL) {
+        config_setting_lookup_float(setting, "acceleration", &axis->acceleration);
+        config_setting_lookup_float(setting, "jerk", &axis->jerk);
+        config_setting_lookup_float(setting, "settle", &axis->settle);
+        config_setting_lookup_float(setting, "min", &axis->min);
+        config_setting_lookup_float(setting, "max", &axis->max);
+    }
+}
+
+static void
+read_simulation(config_setting_t *setting, struct Simulator *simulator)
+{
+    int seed;
+    
+    memset(simulator, '\0', sizeof(struct Simulator));
+    if ((setting = config_setting_lookup(setting, "simulation")) == NULL) {
+        return;
+    }
+    read_simulation_axis(config_setting_lookup(setting, "x"), &simulator->x);
+    read_simulation_axis(config_setting_lookup(setting, "y"), &simulator->y);
+    config_setting_lookup_float(setting, "stall", &simulator->fault.stall);
+    config_setting_lookup_float(setting, "timeout", &simulator->fault.timeout);
+    config_setting_lookup_float(setting, "noise", &simulator->fault.noise);
+    config_setting_lookup_float(setting, "timeout_after", &simulator->fault.timeout_after);
+    if (config_setting_lookup_int(setting, "seed", &seed) == CONFIG_TRUE) {
+        simulator->fault.seed = (unsigned int) seed;
+    }
+}
+
 static void
 read_configuration(void)
 {
@@ -79,6 +115,8 @@ read_configuration(void)
         server = new(TelescopeServer(), TEL_RPC_PORT);
     } else {
         const char *port = NULL, *path = NULL;
+        long long max_packet = 0;
+        double buffer_idle_timeout = -1.;
         config_setting_lookup_string(setting, "port", &port);
         config_setting_lookup_string(setting, "path", &path);
         if (port == NULL) {
@@ -91,6 +129,19 @@ read_configuration(void)
         if (path != NULL) {
             tcp_server_set_path(server, path);
         }
+        config_setting_lookup_int64(setting, "max_packet", &max_packet);
+        config_setting_lookup_float(setting, "buffer_idle_timeout", &buffer_idle_timeout);
+        protobuf_pool_configure(max_packet > 0 ? (size_t) max_packet : 0, buffer_idle_timeout);
+    }
+    
+    /*
+     * The clock of all the virtual devices of the server.
+     */
+    if ((setting = config_lookup(&cfg, "simulation")) != NULL) {
+        double time_scale = 1., time_epoch = 0.;
+        config_setting_lookup_float(setting, "time_scale", &time_scale);
+        config_setting_lookup_float(setting, "time_epoch", &time_epoch);
+        simulator_set_time_scale(time_scale, time_epoch);
     }
     
     setting = config_lookup(&cfg, "telescopes");
@@ -109,7 +160,8 @@ read_configuration(void)
             const char *name = NULL, *description = NULL, *type = NULL, *instrument = NULL, *detector = NULL, *filter = NULL;
             char **instruments = NULL, ***detectors = NULL, ****filters = NULL;
             size_t n_instrument = 0, *n_detector = NULL, **n_filter = NULL, j, k, l;
-            double lon, lat, ele, gmt_offset = -8.;
+            double lon, lat, ele, gmt_offset = -8., status_interval;
+            struct Simulator simulator;
             config_setting_lookup_string(telescope_setting, "name", &name);
             config_setting_lookup_string(telescope_setting, "type", &type);
             config_setting_lookup_string(telescope_setting, "description", &description);
@@ -117,6 +169,7 @@ read_configuration(void)
             config_setting_lookup_float(telescope_setting, "latitude", &lat);
             config_setting_lookup_float(telescope_setting, "elevation", &ele);
             config_setting_lookup_float(telescope_setting, "gmt_offset", &gmt_offset);
+            read_simulation(telescope_setting, &simulator);
             if (type == NULL) {
                 telescopes[i] = NULL;
                 break;
@@ -176,7 +229,8 @@ read_configuration(void)
             }
 
             if (strcmp(type, "VIRTUAL") == 0) {
-                telescopes[i] = new(VirtualTelescope(), name, "description", description, "longitude", lon, "latitude", lat, "gmt_offset", gmt_offset, '\0');
+                telescopes[i] = new(VirtualTelescope(), name, "description", description, "longitude", lon, "latitude", lat, "gmt_offset", gmt_offset,
+                                    "simulation", &simulator, '\0');
                 if (instruments != NULL && n_instrument != 0) {
                     __telescope_set(telescopes[i], "instruments", instruments, n_instrument, (void *) 0);
                 }
@@ -266,20 +320,48 @@ read_configuration(void)
             } else {
                 
             }
-            
+            if (telescopes[i] != NULL && config_setting_lookup_float(telescope_setting, "status_interval", &status_interval) == CONFIG_TRUE) {
+                __telescope_set(telescopes[i], "status_interval", status_interval, (void *) 0);
+            }
         }
     }
 }
 
+/*
+ * Only started if "status_interval" is set, otherwise requests refresh the cached status themselves.
+ */
+static void *
+status_thr(void *arg)
+{
+    void *telescope = arg;
+    double interval;
+    
+    __telescope_get(telescope, "status_interval", &interval, (void *) 0);
+    
+    for (; ;) {
+        __telescope_refresh_status(telescope);
+        Nanosleep(interval);
+    }
+    
+    return NULL;
+}
+
 static void
 init(void)
 {
     read_configuration();
     size_t i;
+    pthread_t tid;
+    double interval;
+    
     for (i = 0; i < n_telescope; i++) {
         if (telescopes[i] != NULL) {
             __telescope_power_on(telescopes[i]);
             __telescope_init(telescopes[i]);
+            __telescope_get(telescopes[i], "status_interval", &interval, (void *) 0);
+            if (interval > 0.) {
+                Pthread_create(&tid, NULL, status_thr, telescopes[i]);
+            }
         }
     }
     
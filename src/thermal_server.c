@@ -15,9 +15,8 @@
 
 extern void **units;
 extern size_t n_unit;
-pthread_t *tids;
 
-static void *d, *server;
+static void *d, *server, *executor;
 static const char *conf_path = "/usr/local/aaos/etc/telescopes.cfg";
 static config_t cfg;
 static bool daemon_flag = true;
@@ -71,8 +70,13 @@ read_configuration(void)
         exit(EXIT_FAILURE);
     } else {
         const char *port;
+        long long max_packet = 0;
+        double buffer_idle_timeout = -1.;
         config_setting_lookup_string(setting, "port", &port);
         server = new(ThermalUnitServer(), port);
+        config_setting_lookup_int64(setting, "max_packet", &max_packet);
+        config_setting_lookup_float(setting, "buffer_idle_timeout", &buffer_idle_timeout);
+        protobuf_pool_configure(max_packet > 0 ? (size_t) max_packet : 0, buffer_idle_timeout);
     }
     
     setting = config_lookup(&cfg, "units");
@@ -90,8 +94,9 @@ read_configuration(void)
         for (i = 0; i < n_unit; i++) {
             config_setting_t *unit_setting;
             unit_setting = config_setting_get_elem(setting, (unsigned int) i);
-            const char *name, *description, *type;
-            double highest, lowest, period;
+            const char *name, *description, *type, *helper, *controller;
+            double highest, lowest, period, setpoint, kp, ki, kd, pwm_window, min_on;
+            int autotune;
             if (config_setting_lookup_string(unit_setting, "name", &name) != CONFIG_TRUE) {
                 name = NULL;
             }
@@ -101,6 +106,9 @@ read_configuration(void)
             if (config_setting_lookup_string(unit_setting, "type", &type) != CONFIG_TRUE) {
                 type = NULL;
             }
+            if (config_setting_lookup_string(unit_setting, "helper", &helper) != CONFIG_TRUE) {
+                helper = NULL;
+            }
             if (config_setting_lookup_float(unit_setting, "highest", &highest) != CONFIG_TRUE) {
                 highest = 10.;
             }
@@ -110,6 +118,33 @@ read_configuration(void)
             if (config_setting_lookup_float(unit_setting, "period", &period) != CONFIG_TRUE) {
                 period = 300.;
             }
+            /*
+             * Controller of the unit, on/off between lowest and highest by default.
+             */
+            if (config_setting_lookup_string(unit_setting, "controller", &controller) != CONFIG_TRUE) {
+                controller = "hysteresis";
+            }
+            if (config_setting_lookup_float(unit_setting, "setpoint", &setpoint) != CONFIG_TRUE) {
+                setpoint = (highest + lowest) / 2.;
+            }
+            if (config_setting_lookup_float(unit_setting, "kp", &kp) != CONFIG_TRUE) {
+                kp = 0.;
+            }
+            if (config_setting_lookup_float(unit_setting, "ki", &ki) != CONFIG_TRUE) {
+                ki = 0.;
+            }
+            if (config_setting_lookup_float(unit_setting, "kd", &kd) != CONFIG_TRUE) {
+                kd = 0.;
+            }
+            if (config_setting_lookup_float(unit_setting, "pwm_window", &pwm_window) != CONFIG_TRUE) {
+                pwm_window = 0.;
+            }
+            if (config_setting_lookup_float(unit_setting, "min_on", &min_on) != CONFIG_TRUE) {
+                min_on = 0.;
+            }
+            if (config_setting_lookup_bool(unit_setting, "autotune", &autotune) != CONFIG_TRUE) {
+                autotune = 0;
+            }
             if (strcmp(type, "klcam_simple") == 0) {
                 const char *temp_cmd, *turn_on_cmd, *turn_off_cmd, *temp_cmd2, *turn_on_cmd2, *turn_off_cmd2, *temp_cmd3;
                 double threshold;
@@ -138,7 +173,7 @@ read_configuration(void)
                 if (config_setting_lookup_float(unit_setting, "threshold", &threshold) != CONFIG_TRUE) {
                     threshold = -40.;
                 }
-                units[i] = new(KLCAMSimpleThermalUnit(), name, highest, lowest, period, "description", description, '\0', temp_cmd, turn_on_cmd, turn_off_cmd, temp_cmd2, turn_on_cmd2, turn_off_cmd2, temp_cmd3, threshold);
+                units[i] = new(KLCAMSimpleThermalUnit(), name, highest, lowest, period, "description", description, "helper", helper, "controller", controller, "setpoint", setpoint, "kp", kp, "ki", ki, "kd", kd, "pwm_window", pwm_window, "min_on", min_on, "autotune", autotune, '\0', temp_cmd, turn_on_cmd, turn_off_cmd, temp_cmd2, turn_on_cmd2, turn_off_cmd2, temp_cmd3, threshold);
             } else if (strcmp(type, "simple") == 0) {
                 const char *temp_cmd, *turn_on_cmd, *turn_off_cmd;
                 if (config_setting_lookup_string(unit_setting, "temp_cmd", &temp_cmd) != CONFIG_TRUE) {
@@ -150,7 +185,7 @@ read_configuration(void)
                 if (config_setting_lookup_string(unit_setting, "turn_off_cmd", &turn_off_cmd) != CONFIG_TRUE) {
                     turn_off_cmd = NULL;
                 }
-                units[i] = new(SimpleThermalUnit(), name, highest, lowest, period, "description", description, '\0', temp_cmd, turn_on_cmd, turn_off_cmd);
+                units[i] = new(SimpleThermalUnit(), name, highest, lowest, period, "description", description, "helper", helper, "controller", controller, "setpoint", setpoint, "kp", kp, "ki", ki, "kd", kd, "pwm_window", pwm_window, "min_on", min_on, "autotune", autotune, '\0', temp_cmd, turn_on_cmd, turn_off_cmd);
             }
         }
     }
@@ -161,27 +196,30 @@ static void
 init(void)
 {
     read_configuration();
-    tids = (pthread_t *) Malloc(sizeof(pthread_t));
     size_t i;
-    void *retval;
 
+    /*
+     * All the units are controlled by a single executor thread.
+     */
+    executor = new(ThermalExecutor());
     for (i = 0; i < n_unit; i++) {
-        if (units[i] != NULL) {
-            Pthread_create(&tids[i], NULL, __thermal_unit_thermal_control, units[i]);
+        if (units[i] != NULL && thermal_executor_add(executor, units[i]) != AAOS_OK) {
+            fprintf(stderr, "thermal unit `%s` has an invalid period.\n", __thermal_unit_get_name(units[i]));
         }
     }
+    thermal_executor_start(executor);
     rpc_server_start(server);
-    for (i = 0; i < n_unit; i++) {
-        if (units[i] != NULL) {
-            Pthread_join(tids[i], &retval);
-        }
-    }
+    thermal_executor_stop(executor);
 }
 
 static void
 destroy(void)
 {
     size_t i;
+    
+    if (executor != NULL) {
+        delete(executor);
+    }
     if (units != NULL) {
         for (i = 0; i < n_unit; i++) {
             if (units[i] != NULL) {
@@ -190,7 +228,6 @@ destroy(void)
         }
     }
     free(units);
-    free(tids);
     
     if (server != NULL) {
         delete(server);
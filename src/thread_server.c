@@ -6,6 +6,8 @@
 //
 
 #include "daemon.h"
+#include "dome_slave.h"
+#include "simulator.h"
 #include "thread.h"
 #include "thread_rpc.h"
 #include "wrapper.h"
@@ -68,9 +70,19 @@ read_daemon(void)
 static void
 read_configuration(void)
 {
-    config_setting_t *setting = NULL, *thread_setting = NULL, *scheduler_setting = NULL, *telescope_setting = NULL, *dome_setting = NULL, *detector_setting = NULL, *aws_setting = NULL, *pipeline_setting = NULL;
+    config_setting_t *setting = NULL, *thread_setting = NULL, *scheduler_setting = NULL, *telescope_setting = NULL, *dome_setting = NULL, *slave_setting = NULL, *detector_setting = NULL, *aws_setting = NULL, *pipeline_setting = NULL;
     int i;
 
+    /*
+     * The clock of the observation threads, the same as of the simulated devices they drive.
+     */
+    if ((setting = config_lookup(&cfg, "simulation")) != NULL) {
+        double time_scale = 1., time_epoch = 0.;
+        config_setting_lookup_float(setting, "time_scale", &time_scale);
+        config_setting_lookup_float(setting, "time_epoch", &time_epoch);
+        simulator_set_time_scale(time_scale, time_epoch);
+    }
+
     if ((setting = config_lookup(&cfg, "threads")) == NULL) {
         fprintf(stderr, "`threads` section does not exist in configuration file.\n");   
     }
@@ -98,6 +110,14 @@ read_configuration(void)
             config_setting_lookup_string(dome_setting, "port", &dome_port);
             config_setting_lookup_string(dome_setting, "name", &dome_name);
             __observation_thread_set_member(threads[i], "dome", dome_address, dome_port, dome_name);
+            if ((slave_setting = config_setting_lookup(dome_setting, "slaving")) != NULL) {
+                double hysteresis = DOME_SLAVE_HYSTERESIS, lead = DOME_SLAVE_LEAD, interval = DOME_SLAVE_INTERVAL, period = DOME_SLAVE_PERIOD;
+                config_setting_lookup_float(slave_setting, "hysteresis", &hysteresis);
+                config_setting_lookup_float(slave_setting, "lead", &lead);
+                config_setting_lookup_float(slave_setting, "interval", &interval);
+                config_setting_lookup_float(slave_setting, "period", &period);
+                __observation_thread_set_member(threads[i], "dome_slave", hysteresis, lead, interval, period);
+            }
         }
         if ((telescope_setting = config_setting_lookup(thread_setting, "telescope")) != NULL) {
             const char *telescope_address  = NULL, *telescope_port = NULL, *telescope_name = NULL;